@@ -26,12 +26,23 @@
 #pragma link C++ nestedtypedef;
 
 #pragma link C++ class Qn::Axis<double>+;
+#pragma read sourceClass="Qn::Axis<double>" targetClass="Qn::Axis<double>" version="[1-]" \
+  source="" target="uniform_" \
+  code="{ newObj->DetermineUniformBinning(); }"
 #pragma link C++ class vector<Qn::Axis >+;
 #pragma link C++ class Qn::QVec+;
 #pragma link C++ class Qn::QVector+;
+#pragma read sourceClass="Qn::QVector" targetClass="Qn::QVector" version="[-12]" \
+  source="std::vector<Qn::QVec> q_" target="q_" \
+  code="{ for (std::size_t i = 0; i < onfile.q_.size() && i < q_.size(); ++i) q_[i] = onfile.q_[i]; }"
+#pragma link C++ class Qn::QVectorGF+;
 #pragma link C++ class Qn::CorrelationResult+;
 #pragma link C++ class Qn::ReSamples+;
+#pragma read sourceClass="Qn::ReSamples" targetClass="Qn::ReSamples" version="[-2]" \
+  source="std::vector<Qn::Statistic> statistics_" target="statistics_" \
+  code="{ statistics_.Assign(onfile.statistics_); }"
 #pragma link C++ class Qn::Statistic+;
+#pragma link C++ class Qn::StatisticArray+;
 #pragma link C++ class Qn::Stats+;
 #pragma link C++ class Qn::EventShape+;
 #pragma link C++ class Qn::Cuts+;
@@ -40,10 +51,14 @@
 #pragma link C++ class Qn::DataContainer<Qn::Stats,Qn::Axis<double>>+;
 #pragma link C++ class Qn::DataContainer<Qn::Statistic,Qn::Axis<double>>+;
 #pragma link C++ class Qn::DataContainer<Qn::QVector,Qn::Axis<double>>+;
+#pragma link C++ class Qn::DataContainer<Qn::QVectorGF,Qn::Axis<double>>+;
 #pragma link C++ class Qn::DataContainer<double,Qn::Axis<double>>+;
 #pragma link C++ class Qn::DataContainer<TH1F, Qn::Axis<double>>+;
+#pragma link C++ class Qn::SparseDataContainer<Qn::Stats,Qn::Axis<double>>+;
+#pragma link C++ class Qn::SparseDataContainer<Qn::Statistic,Qn::Axis<double>>+;
 #pragma link C++ class Qn::DataContainerHelper+;
 #pragma link C++ class Qn::EqualEntriesBinner+;
+#pragma link C++ class Qn::QuantileSketch+;
 
 
 #pragma link C++ typedef Qn::AxisF;
@@ -52,13 +67,20 @@
 #pragma link C++ typedef Qn::DataContainerStats;
 #pragma link C++ typedef Qn::DataContainerStatistic;
 #pragma link C++ typedef Qn::DataContainerQVector;
+#pragma link C++ typedef Qn::DataContainerQVectorGF;
 #pragma link C++ typedef Qn::DataContainerEventShape;
+#pragma link C++ typedef Qn::SparseDataContainerStats;
+#pragma link C++ typedef Qn::SparseDataContainerStatistic;
 #pragma link C++ typedef Qn::Errors;
 
 #pragma link C++ function Qn::ToTGraph;
 #pragma link C++ function Qn::ToBootstrapScatterGraph;
 #pragma link C++ function Qn::ToErrorComparisionGraph;
 #pragma link C++ function Qn::ToTMultiGraph;
-#pragma link C++ function Qn::Sqrt<DataContainer<Qn::Stats>>;
+#pragma link C++ function Qn::Sqrt<Qn::Stats, Qn::AxisD>;
+#pragma link C++ function Qn::PowSqrt<Qn::AxisD>;
+#pragma link C++ enum Qn::SinCosMode;
+#pragma link C++ function Qn::SetSinCosMode;
+#pragma link C++ function Qn::GetSinCosMode;
 
 #endif
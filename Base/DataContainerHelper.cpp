@@ -72,12 +72,11 @@ TGraphAsymmErrors *DataContainerHelper::ToTGraphShifted(const DataContainerStats
   auto graph = new TGraphAsymmErrors();
   unsigned int ibin = 0;
   for (const auto &bin : data) {
-    auto tbin = bin;
-    if (tbin.N()==0 && tbin.GetState()!=Stats::State::MEAN_ERROR) continue;
-    if (tbin.GetState()!=Stats::State::MEAN_ERROR) tbin.CalculateMeanAndError();
-    auto y = tbin.Mean();
-    auto ylo = tbin.LowerMeanError();
-    auto yhi = tbin.UpperMeanError();
+    // the results of bins in the state MOMENTS are calculated on access without copying the samples.
+    if (bin.N()==0 && bin.GetState()!=Stats::State::MEAN_ERROR) continue;
+    auto y = bin.Mean();
+    auto ylo = bin.LowerMeanError();
+    auto yhi = bin.UpperMeanError();
     auto xhi = data.GetAxes().front().GetUpperBinEdge(ibin);
     auto xlo = data.GetAxes().front().GetLowerBinEdge(ibin);
     auto x = xlo + ((xhi - xlo)*static_cast<double>(i)/maxi);
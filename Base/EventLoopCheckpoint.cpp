@@ -0,0 +1,267 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "EventLoopCheckpoint.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+#include "TClass.h"
+#include "TFile.h"
+#include "TH1.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TROOT.h"
+
+namespace Qn {
+namespace {
+constexpr auto kEntriesName = "checkpoint_entries_"; ///< key of the processed entries in the checkpoint files
+
+bool Exists(const std::string &file_name) {
+  return std::ifstream(file_name).good();
+}
+
+void Rename(const std::string &from, const std::string &to) {
+  if (std::rename(from.data(), to.data())!=0) {
+    throw std::runtime_error("Cannot rename the checkpoint " + from + " to " + to + ".");
+  }
+}
+
+/**
+ * Transfers the ownership of a read object and its content from the file to the checkpoint.
+ */
+void Detach(TObject *object) {
+  if (auto histogram = dynamic_cast<TH1 *>(object)) histogram->SetDirectory(nullptr);
+  if (auto collection = dynamic_cast<TCollection *>(object)) {
+    collection->SetOwner(true);
+    TIter next(collection);
+    while (auto entry = next()) Detach(entry);
+  }
+}
+
+/**
+ * Merges the source into the target. Lists are merged by the names of their entries, such that the histograms of
+ * runs, which are only found in the source, are moved to the target.
+ */
+void MergeInto(TObject *target, TObject *source, const std::string &path) {
+  if (auto list = dynamic_cast<TList *>(target)) {
+    auto other = dynamic_cast<TList *>(source);
+    if (!other) throw std::runtime_error("The checkpoints of " + path + " are of different classes.");
+    std::vector<TObject *> missing;
+    for (auto entry : *other) {
+      auto found = list->FindObject(entry->GetName());
+      if (found) {
+        MergeInto(found, entry, path + "/" + entry->GetName());
+      } else {
+        missing.push_back(entry);
+      }
+    }
+    for (auto entry : missing) {
+      other->Remove(entry);
+      list->Add(entry);
+    }
+    return;
+  }
+  auto merge = target->IsA()->GetMerge();
+  if (!merge) throw std::runtime_error("The checkpoint of " + path + " cannot be merged.");
+  TList others;
+  others.Add(source);
+  merge(target, &others, nullptr);
+}
+
+/**
+ * Sorts the [first, last) pairs of entries and joins overlapping and adjacent ranges.
+ */
+std::vector<Long64_t> JoinRanges(const std::vector<Long64_t> &ranges) {
+  std::vector<std::pair<Long64_t, Long64_t>> pairs;
+  for (std::size_t i = 0; i + 1 < ranges.size(); i += 2) pairs.emplace_back(ranges[i], ranges[i + 1]);
+  std::sort(pairs.begin(), pairs.end());
+  std::vector<Long64_t> joined;
+  for (const auto &range : pairs) {
+    if (!joined.empty() && range.first <= joined.back()) {
+      joined.back() = std::max(joined.back(), range.second);
+    } else {
+      joined.push_back(range.first);
+      joined.push_back(range.second);
+    }
+  }
+  return joined;
+}
+}
+
+EventLoopCheckpoint::EventLoopCheckpoint(std::string prefix,
+                                         ULong64_t interval_entries,
+                                         double interval_seconds,
+                                         unsigned int n_slots) :
+    prefix_(std::move(prefix)),
+    interval_entries_(interval_entries),
+    interval_seconds_(interval_seconds) {
+  if (n_slots==0) n_slots = ROOT::IsImplicitMTEnabled() ? ROOT::GetImplicitMTPoolSize() : 1;
+  slots_.resize(n_slots);
+}
+
+std::string EventLoopCheckpoint::FileName(unsigned int generation, const std::string &part) const {
+  return prefix_ + "_g" + std::to_string(generation) + "_" + part + ".root";
+}
+
+void EventLoopCheckpoint::Register(const std::string &name, Snapshot snapshot) {
+  if (restored_) throw std::logic_error("The result " + name + " is registered after the checkpoint is restored.");
+  for (const auto &registered : snapshots_) {
+    if (registered.first==name) throw std::logic_error("The result " + name + " is already registered.");
+  }
+  snapshots_.emplace_back(name, std::move(snapshot));
+}
+
+void EventLoopCheckpoint::Restore() {
+  if (restored_) throw std::logic_error("The checkpoint " + prefix_ + " is already restored.");
+  // the index holds the generation and the number of slots of the previous job.
+  const auto index_name = prefix_ + "_checkpoint.txt";
+  unsigned int previous = 0;
+  unsigned int previous_slots = 0;
+  {
+    std::ifstream index(index_name);
+    if (index) index >> previous >> previous_slots;
+  }
+  std::vector<std::string> files;
+  if (previous > 0) {
+    files.push_back(FileName(previous, "base"));
+    if (!Exists(files.front())) throw std::runtime_error("The checkpoint " + files.front() + " is missing.");
+    for (unsigned int slot = 0; slot < previous_slots; ++slot) {
+      const auto name = FileName(previous, "slot" + std::to_string(slot));
+      if (Exists(name)) files.push_back(name);
+    }
+  }
+  std::vector<Long64_t> ranges;
+  for (const auto &file_name : files) {
+    TDirectory::TContext context;
+    std::unique_ptr<TFile> file(TFile::Open(file_name.data(), "READ"));
+    if (!file || file->IsZombie()) throw std::runtime_error("Cannot open the checkpoint " + file_name + ".");
+    std::vector<Long64_t> *entries = nullptr;
+    file->GetObject(kEntriesName, entries);
+    if (entries) {
+      ranges.insert(ranges.end(), entries->begin(), entries->end());
+      delete entries;
+    }
+    for (const auto &snapshot : snapshots_) {
+      std::unique_ptr<TObject> object(file->Get(snapshot.first.data()));
+      if (!object) continue;
+      Detach(object.get());
+      auto restored = restored_results_.find(snapshot.first);
+      if (restored==restored_results_.end()) {
+        restored_results_.emplace(snapshot.first, std::move(object));
+      } else {
+        MergeInto(restored->second.get(), object.get(), snapshot.first);
+      }
+    }
+  }
+  completed_ = JoinRanges(ranges);
+  // the merged checkpoint becomes valid, when the index points to it. The files of the previous generation are
+  // removed afterwards, such that a preempted Restore is repeated from the same files.
+  generation_ = previous + 1;
+  const auto base_name = FileName(generation_, "base");
+  {
+    TDirectory::TContext context;
+    TFile base((base_name + ".tmp").data(), "RECREATE");
+    if (base.IsZombie()) throw std::runtime_error("Cannot write the checkpoint " + base_name + ".");
+    for (const auto &restored : restored_results_) {
+      base.WriteTObject(restored.second.get(), restored.first.data(), "SingleKey");
+    }
+    base.WriteObject(&completed_, kEntriesName);
+    base.Close();
+  }
+  Rename(base_name + ".tmp", base_name);
+  {
+    std::ofstream index(index_name + ".tmp");
+    index << generation_ << " " << slots_.size() << std::endl;
+    if (!index) throw std::runtime_error("Cannot write the checkpoint index " + index_name + ".");
+  }
+  Rename(index_name + ".tmp", index_name);
+  for (const auto &file_name : files) std::remove(file_name.data());
+  const auto now = std::chrono::steady_clock::now();
+  for (auto &slot : slots_) slot.last = now;
+  restored_ = true;
+}
+
+bool EventLoopCheckpoint::IsCompleted(ULong64_t entry) const {
+  // the entry is completed, if it follows the first entry of a range.
+  const auto position = std::upper_bound(completed_.begin(), completed_.end(), static_cast<Long64_t>(entry));
+  return std::distance(completed_.begin(), position)%2==1;
+}
+
+bool EventLoopCheckpoint::Next(unsigned int slot, ULong64_t entry) {
+  if (!restored_) throw std::logic_error("The checkpoint " + prefix_ + " is used before it is restored.");
+  if (IsCompleted(entry)) return false;
+  auto &state = slots_.at(slot);
+  // the clock is only read every 64 entries.
+  constexpr ULong64_t kClockInterval = 64;
+  const bool entries_passed = interval_entries_ > 0 && state.entries >= interval_entries_;
+  const bool time_passed = interval_seconds_ > 0. && state.entries%kClockInterval==0 && state.entries > 0 &&
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - state.last).count() >= interval_seconds_;
+  if (entries_passed || time_passed) Write(slot);
+  const auto value = static_cast<Long64_t>(entry);
+  if (!state.ranges.empty() && state.ranges.back()==value) {
+    ++state.ranges.back();
+  } else {
+    state.ranges.push_back(value);
+    state.ranges.push_back(value + 1);
+  }
+  ++state.entries;
+  return true;
+}
+
+void EventLoopCheckpoint::Write(unsigned int slot) {
+  if (!restored_) throw std::logic_error("The checkpoint " + prefix_ + " is written before it is restored.");
+  auto &state = slots_.at(slot);
+  state.ranges = JoinRanges(state.ranges);
+  const auto file_name = FileName(generation_, "slot" + std::to_string(slot));
+  {
+    TDirectory::TContext context;
+    TFile file((file_name + ".tmp").data(), "RECREATE");
+    if (file.IsZombie()) throw std::runtime_error("Cannot write the checkpoint " + file_name + ".");
+    for (const auto &snapshot : snapshots_) {
+      if (auto object = snapshot.second(slot)) file.WriteTObject(object, snapshot.first.data(), "SingleKey");
+    }
+    file.WriteObject(&state.ranges, kEntriesName);
+    file.Close();
+  }
+  Rename(file_name + ".tmp", file_name);
+  state.entries = 0;
+  state.last = std::chrono::steady_clock::now();
+}
+
+TObject *EventLoopCheckpoint::GetRestored(const std::string &name) const {
+  const auto restored = restored_results_.find(name);
+  return restored==restored_results_.end() ? nullptr : restored->second.get();
+}
+
+ULong64_t EventLoopCheckpoint::GetNumberOfCompletedEntries() const {
+  ULong64_t n = 0;
+  for (std::size_t i = 0; i + 1 < completed_.size(); i += 2) n += completed_[i + 1] - completed_[i];
+  return n;
+}
+
+void EventLoopCheckpoint::Clear() {
+  if (!restored_) return;
+  for (unsigned int slot = 0; slot < slots_.size(); ++slot) {
+    std::remove(FileName(generation_, "slot" + std::to_string(slot)).data());
+  }
+  std::remove(FileName(generation_, "base").data());
+  std::remove((prefix_ + "_checkpoint.txt").data());
+}
+}
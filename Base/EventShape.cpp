@@ -28,4 +28,13 @@ void Qn::EventShape::FitWithSpline() {
   IntegrateHist();
   spline_ = new TSpline3(integral_, "sp3");
   spline_->SetName("spline");
+  const auto lower = integral_->GetXaxis()->GetXmin();
+  const auto upper = integral_->GetXaxis()->GetXmax();
+  const auto step = (upper - lower)/(kTableSize - 1);
+  table_.resize(kTableSize);
+  for (std::size_t i = 0; i < kTableSize; ++i) {
+    table_[i] = static_cast<float>(std::min(std::max(spline_->Eval(lower + i*step), 0.), 1.));
+  }
+  table_lower_ = static_cast<float>(lower);
+  table_inverse_step_ = static_cast<float>(1./step);
 }
\ No newline at end of file
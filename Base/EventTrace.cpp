@@ -0,0 +1,128 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "EventTrace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+namespace Qn {
+namespace {
+std::atomic<std::uint64_t> next_serial{1}; ///< serial number of the next trace
+
+/**
+ * Writes a string as JSON string literal.
+ */
+void WriteString(std::ostream &stream, const std::string &value) {
+  stream << '"';
+  for (const auto c : value) {
+    if (c=='"' || c=='\\') {
+      stream << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      stream << ' ';
+    } else {
+      stream << c;
+    }
+  }
+  stream << '"';
+}
+}
+
+EventTrace::EventTrace(const unsigned int sampling, const std::size_t capacity) :
+    sampling_(std::max(sampling, 1u)),
+    capacity_(std::max<std::size_t>(capacity, 1)),
+    serial_(next_serial++),
+    epoch_(Clock::now()) {}
+
+std::size_t EventTrace::AddName(const std::string &name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto found = ids_.find(name);
+  if (found!=ids_.end()) return found->second;
+  ids_.emplace(name, names_.size());
+  names_.push_back(name);
+  return names_.size() - 1;
+}
+
+EventTrace::ThreadBuffer &EventTrace::GetBuffer() {
+  thread_local std::uint64_t cached_serial = 0;
+  thread_local ThreadBuffer *cached_buffer = nullptr;
+  if (cached_serial==serial_) return *cached_buffer;
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto thread = std::this_thread::get_id();
+  auto found = std::find_if(buffers_.begin(), buffers_.end(),
+                            [thread](const std::unique_ptr<ThreadBuffer> &buffer) { return buffer->thread==thread; });
+  if (found==buffers_.end()) {
+    buffers_.push_back(std::make_unique<ThreadBuffer>());
+    buffers_.back()->thread = thread;
+    buffers_.back()->spans.resize(capacity_);
+    found = std::prev(buffers_.end());
+  }
+  cached_serial = serial_;
+  cached_buffer = found->get();
+  return *cached_buffer;
+}
+
+std::size_t EventTrace::GetNumberOfSpans() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::size_t n = 0;
+  for (const auto &buffer : buffers_) n += std::min<unsigned long long>(buffer->n, capacity_);
+  return n;
+}
+
+void EventTrace::Write(std::ostream &stream) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto microseconds = [this](const Clock::time_point time) {
+    return std::chrono::duration<double, std::micro>(time - epoch_).count();
+  };
+  // the timestamps of long jobs need more digits than the default precision.
+  const auto flags = stream.flags();
+  const auto precision = stream.precision();
+  stream << std::fixed << std::setprecision(3);
+  stream << "{\"traceEvents\":[";
+  bool first = true;
+  for (std::size_t tid = 0; tid < buffers_.size(); ++tid) {
+    const auto &buffer = *buffers_[tid];
+    stream << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+           << ",\"args\":{\"name\":\"thread " << tid << "\"}}";
+    first = false;
+    // the oldest kept span follows the latest one in a full ring.
+    const auto n = std::min<unsigned long long>(buffer.n, capacity_);
+    const auto oldest = buffer.n > capacity_ ? buffer.n%capacity_ : 0;
+    for (unsigned long long i = 0; i < n; ++i) {
+      const auto &span = buffer.spans[(oldest + i)%capacity_];
+      stream << ",\n{\"name\":";
+      WriteString(stream, names_.at(span.name));
+      stream << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+             << ",\"ts\":" << microseconds(span.begin)
+             << ",\"dur\":" << std::chrono::duration<double, std::micro>(span.end - span.begin).count() << "}";
+    }
+  }
+  stream << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  stream.flags(flags);
+  stream.precision(precision);
+}
+
+void EventTrace::Write(const std::string &file_name) const {
+  std::ofstream file(file_name);
+  if (!file) throw std::runtime_error("The trace file " + file_name + " cannot be opened.");
+  Write(file);
+}
+
+}
@@ -0,0 +1,190 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "FlatQVectors.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+
+
+namespace Qn {
+
+FlatQVectors::Encoding FlatQVectors::Encoding::Truncated(const unsigned int mantissa_bits) {
+  if (mantissa_bits < 1 || mantissa_bits > 23) {
+    throw std::out_of_range("The truncated floats keep from 1 to 23 bits of the mantissa.");
+  }
+  Encoding encoding;
+  encoding.method = Method::kTruncated;
+  encoding.mantissa_bits = mantissa_bits;
+  return encoding;
+}
+
+FlatQVectors::Encoding FlatQVectors::Encoding::FixedPoint(const float range) {
+  if (!(range > 0.f) || !std::isfinite(range)) {
+    throw std::out_of_range("The range of the fixed-point encoding needs to be positive.");
+  }
+  Encoding encoding;
+  encoding.method = Method::kFixedPoint;
+  encoding.range = range;
+  return encoding;
+}
+
+FlatQVectors::Encoding FlatQVectors::Encoding::FromString(const std::string &description) {
+  const auto separator = description.find(':');
+  const auto method = description.substr(0, separator);
+  const auto parameter = separator==std::string::npos ? std::string() : description.substr(separator + 1);
+  if (method.empty() || method=="float") return {};
+  if (method=="truncated") return Truncated(std::stoul(parameter));
+  if (method=="fixed") return FixedPoint(std::stof(parameter));
+  throw std::runtime_error("The encoding " + description + " of the Q-vectors is unknown.");
+}
+
+std::string FlatQVectors::Encoding::ToString() const {
+  std::ostringstream description;
+  description.precision(9);
+  switch (method) {
+    case Method::kFloat: description << "float";
+      break;
+    case Method::kTruncated: description << "truncated:" << mantissa_bits;
+      break;
+    case Method::kFixedPoint: description << "fixed:" << range;
+      break;
+  }
+  return description.str();
+}
+
+double FlatQVectors::Encoding::GetErrorBound() const {
+  switch (method) {
+    case Method::kTruncated: return std::ldexp(1., -static_cast<int>(mantissa_bits + 1));
+    case Method::kFixedPoint: return 0.5*GetStep();
+    default: return std::ldexp(1., -24);
+  }
+}
+
+FlatQVectors::FlatQVectors(const DataContainerQVector &layout) : FlatQVectors(layout, Encoding()) {}
+
+FlatQVectors::FlatQVectors(const DataContainerQVector &layout, Encoding encoding) :
+    n_bins_(layout.size()),
+    n_harmonics_(layout.size() > 0 ? layout.At(0).GetNoOfHarmonics() : 0),
+    encoding_(encoding),
+    n_(n_bins_, 0),
+    sumw_(n_bins_, 0.),
+    quality_(n_bins_, 0) {
+  if (n_harmonics_==0) throw std::logic_error("The flat Q-vectors need at least one harmonic.");
+  if (encoding_.method==Encoding::Method::kFixedPoint) {
+    x_fixed_.assign(n_bins_*n_harmonics_, 0);
+    y_fixed_.assign(n_bins_*n_harmonics_, 0);
+  } else {
+    x_.assign(n_bins_*n_harmonics_, 0.);
+    y_.assign(n_bins_*n_harmonics_, 0.);
+  }
+  if (encoding_.IsCompact()) quality_bits_.assign(QualityBytes(n_bins_), 0);
+}
+
+std::int16_t FlatQVectors::ToFixed(const double value, unsigned char &quality) const {
+  const auto scaled = value/encoding_.GetStep();
+  // NaN is clamped as well.
+  if (!(std::abs(scaled) <= kFixedPointMax)) {
+    quality |= kSaturated;
+    return static_cast<std::int16_t>(scaled < 0. ? -kFixedPointMax : kFixedPointMax);
+  }
+  return static_cast<std::int16_t>(std::lround(scaled));
+}
+
+void FlatQVectors::PackQuality() {
+  constexpr unsigned int kPerByte = 8/kQualityBits;
+  std::fill(quality_bits_.begin(), quality_bits_.end(), 0);
+  for (std::size_t ibin = 0; ibin < n_bins_; ++ibin) {
+    quality_bits_[ibin/kPerByte] |= quality_[ibin] << (kQualityBits*(ibin%kPerByte));
+  }
+}
+
+void FlatQVectors::Set(const DataContainerQVector &q_vectors) {
+  if (q_vectors.size()!=n_bins_) throw std::logic_error("The Q-vectors do not match the flat layout.");
+  const bool fixed = encoding_.method==Encoding::Method::kFixedPoint;
+  std::size_t i = 0;
+  for (std::size_t ibin = 0; ibin < n_bins_; ++ibin) {
+    const auto &q = q_vectors.At(ibin);
+    unsigned char quality = q.IsGoodQuality() ? kGood : 0;
+    for (std::size_t position = 0; position < n_harmonics_; ++position, ++i) {
+      const auto &component = q.GetComponent(position);
+      if (fixed) {
+        x_fixed_[i] = ToFixed(component.x, quality);
+        y_fixed_[i] = ToFixed(component.y, quality);
+      } else {
+        x_[i] = Truncate(component.x, encoding_.mantissa_bits);
+        y_[i] = Truncate(component.y, encoding_.mantissa_bits);
+      }
+    }
+    n_[ibin] = q.n();
+    sumw_[ibin] = q.sumweights();
+    quality_[ibin] = quality;
+  }
+  if (encoding_.IsCompact()) PackQuality();
+}
+
+void FlatQVectors::Set(const FlatQVectors &other) {
+  std::copy(other.x_.begin(), other.x_.end(), x_.begin());
+  std::copy(other.y_.begin(), other.y_.end(), y_.begin());
+  std::copy(other.x_fixed_.begin(), other.x_fixed_.end(), x_fixed_.begin());
+  std::copy(other.y_fixed_.begin(), other.y_fixed_.end(), y_fixed_.begin());
+  std::copy(other.n_.begin(), other.n_.end(), n_.begin());
+  std::copy(other.sumw_.begin(), other.sumw_.end(), sumw_.begin());
+  std::copy(other.quality_.begin(), other.quality_.end(), quality_.begin());
+  std::copy(other.quality_bits_.begin(), other.quality_bits_.end(), quality_bits_.begin());
+}
+
+std::vector<TBranch *> FlatQVectors::Branch(TTree *tree, const std::string &name, int basket_size) const {
+  const auto components = std::to_string(n_bins_*n_harmonics_);
+  const auto bins = std::to_string(n_bins_);
+  auto branch = [tree, &name, basket_size](const std::string &field, const void *address,
+                                           const std::string &size, const char *type) {
+    const auto leaf = field + "[" + size + "]/" + type;
+    return tree->Branch((name + "_" + field).data(), const_cast<void *>(address), leaf.data(), basket_size);
+  };
+  std::vector<TBranch *> branches;
+  if (encoding_.method==Encoding::Method::kFixedPoint) {
+    branches.push_back(branch("xfix", x_fixed_.data(), components, "S"));
+    branches.push_back(branch("yfix", y_fixed_.data(), components, "S"));
+  } else {
+    branches.push_back(branch("x", x_.data(), components, "F"));
+    branches.push_back(branch("y", y_.data(), components, "F"));
+  }
+  branches.push_back(branch("n", n_.data(), bins, "I"));
+  branches.push_back(branch("sumw", sumw_.data(), bins, "F"));
+  if (encoding_.IsCompact()) {
+    branches.push_back(branch("qualitybits", quality_bits_.data(), std::to_string(quality_bits_.size()), "b"));
+  } else {
+    branches.push_back(branch("quality", quality_.data(), bins, "b"));
+  }
+  return branches;
+}
+
+void FlatQVectors::Unpack(const float *x, const float *y, const int *n, const float *sumw,
+                          const unsigned char *quality, DataContainerQVector &q_vectors) {
+  for (auto &q : q_vectors) {
+    const auto n_harmonics = q.GetNoOfHarmonics();
+    for (std::size_t position = 0; position < n_harmonics; ++position) {
+      q.SetComponent(position, {*x++, *y++});
+    }
+    q.SetNumberOfContributors(*n++, *sumw++, *quality++ & kGood);
+  }
+}
+
+}
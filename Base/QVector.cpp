@@ -28,14 +28,13 @@ namespace Qn {
  * @param b Q vector
  * @return unnormalized sum of the two QVectors
  */
-QVector operator+(const QVector a, const QVector b) {
-  QVector at = a.DeNormal();
-  QVector bt = b.DeNormal();
+QVector operator+(QVector a, QVector b) {
+  a.Denormalize();
+  b.Denormalize();
   QVector c;
-  c.q_.resize(a.q_.size());
-  std::transform(at.q_.begin(),
-                 at.q_.end(),
-                 bt.q_.begin(),
+  std::transform(a.q_.begin(),
+                 a.q_.end(),
+                 b.q_.begin(),
                  c.q_.begin(),
                  [](const QVec qa, const QVec qb) {
                    QVec ta = {0., 0.};
@@ -44,8 +43,8 @@ QVector operator+(const QVector a, const QVector b) {
                    if (!(std::isnan(qb.x) || std::isnan(qb.y))) tb = qb;
                    return ta + tb;
                  });
-  c.n_ = at.n_ + bt.n_;
-  c.sum_weights_ = at.sum_weights_ + bt.sum_weights_;
+  c.n_ = a.n_ + b.n_;
+  c.sum_weights_ = a.sum_weights_ + b.sum_weights_;
   c.bits_ = b.bits_;
   return c;
 }
@@ -57,72 +56,168 @@ QVector operator+(const QVector a, const QVector b) {
  */
 QVector QVector::Normal(const QVector::Normalization norm) const {
   QVector c(*this);
-  c.CopyHarmonics(*this);
-  if (norm_!=Normalization::NONE) {
-    c = c.DeNormal();
-  }
+  c.Normalize(norm);
+  return c;
+}
+
+/**
+ * Remove normalization of Q vector
+ * @return unnormalized Q vector
+ */
+QVector QVector::DeNormal() const {
+  QVector c(*this);
+  c.Denormalize();
+  return c;
+}
+
+/**
+ * Normalizes the Q vector in place with a given normalization method.
+ * An existing normalization is removed first.
+ * @param norm normalization method
+ */
+void QVector::Normalize(const QVector::Normalization norm) {
+  Denormalize();
   switch (norm) {
     case (Normalization::NONE): {
       break;
     }
     case (Normalization::M): {
-      auto norm = [this](const QVec q) {
+      auto normalize = [this](const QVec q) {
         if (sum_weights_!=0) return q/sum_weights_;
         return QVec{0., 0.};
       };
-      std::transform(c.q_.begin(), c.q_.end(), c.q_.begin(), norm);
+      std::transform(q_.begin(), q_.end(), q_.begin(), normalize);
       break;
     }
     case (Normalization::SQRT_M): {
-      auto add = [this](const QVec q) {
+      auto normalize = [this](const QVec q) {
         if (sum_weights_ > 0) return q/std::sqrt(sum_weights_);
         return QVec{0., 0.};
       };
-      std::transform(c.q_.begin(), c.q_.end(), c.q_.begin(), add);
+      std::transform(q_.begin(), q_.end(), q_.begin(), normalize);
       break;
     }
     case (Normalization::MAGNITUDE): {
-      auto add = [](const QVec q) {
+      auto normalize = [](const QVec q) {
         if (Qn::norm(q)!=0) {
           return q/Qn::norm(q);
         }
         return QVec{0., 0.};
       };
-      std::transform(c.q_.begin(), c.q_.end(), c.q_.begin(), add);
+      std::transform(q_.begin(), q_.end(), q_.begin(), normalize);
       break;
     }
   }
-  c.norm_ = norm;
-  return c;
+  norm_ = norm;
 }
 
 /**
- * Remove normalization of Q vector
- * @return unnormalized Q vector
+ * Removes the normalization of the Q vector in place.
  */
-QVector QVector::DeNormal() const {
-  QVector c(*this);
-  c.CopyHarmonics(*this);
+void QVector::Denormalize() {
   switch (norm_) {
     case (Normalization::NONE): {
       break;
     }
     case (Normalization::M): {
-      std::transform(q_.begin(), q_.end(), c.q_.begin(), [this](const QVec q) { return q*this->sum_weights_; });
+      std::transform(q_.begin(), q_.end(), q_.begin(), [this](const QVec q) { return q*this->sum_weights_; });
       break;
     }
     case (Normalization::SQRT_M): {
-      std::transform(q_.begin(), q_.end(), c.q_.begin(),
-                     [this](const QVec q) { return q*std::sqrt(sum_weights_); });
+      const float factor = std::sqrt(sum_weights_);
+      std::transform(q_.begin(), q_.end(), q_.begin(), [factor](const QVec q) { return q*factor; });
       break;
     }
     case (Normalization::MAGNITUDE): {
-      std::transform(q_.begin(), q_.end(), c.q_.begin(), [](const QVec q) { return q*Qn::norm(q); });
+      std::transform(q_.begin(), q_.end(), q_.begin(), [](const QVec q) { return q*Qn::norm(q); });
       break;
     }
   }
-  c.norm_ = Normalization::NONE;
-  return c;
+  norm_ = Normalization::NONE;
 }
 
-}
\ No newline at end of file
+/**
+ * Adds a batch of data vectors to the Q vector.
+ * The blocks are sized to stay in the L1 cache. The inner loops run over the data vectors of a block
+ * and do not carry dependencies between them, so that they are vectorized by the compiler.
+ * If a Q vector with the double harmonic multiplier is passed, it is filled in the same sweep. Its components are
+ * taken from the even terms of the harmonic recurrence of this Q vector, such that the trigonometric functions are
+ * evaluated only once per data vector. The sine and cosine of a block are evaluated in the mode set with
+ * SetSinCosMode.
+ * @param phi angles of the particles or channels.
+ * @param offset offsets of the phi channels. If nullptr, an offset of 1 is used for all data vectors.
+ * @param weight weights of the particles or channels.
+ * @param n number of data vectors.
+ * @param doubled Q vector with twice the harmonic multiplier of this Q vector. Ignored if nullptr.
+ */
+void QVector::AddBatch(const float *phi, const float *offset, const float *weight, const std::size_t n,
+                       QVector *doubled) {
+  if (doubled && doubled->harmonic_multiplier_!=2*harmonic_multiplier_) {
+    throw std::logic_error("Q vector filled in the same sweep needs to have the double harmonic multiplier.");
+  }
+  constexpr std::size_t kblocksize = 64;
+  const unsigned int highest = doubled ? std::max(static_cast<unsigned int>(maximum_harmonic_),
+                                                  2U*doubled->maximum_harmonic_) : maximum_harmonic_;
+  double w[kblocksize];
+  double angles[kblocksize];
+  double cos1[kblocksize];
+  double sin1[kblocksize];
+  double cosh[kblocksize];
+  double sinh[kblocksize];
+  auto sum = [&w, &cosh, &sinh](const std::size_t size, QVec &q) {
+    double qx = 0.;
+    double qy = 0.;
+    for (std::size_t i = 0; i < size; ++i) {
+      qx += w[i]*cosh[i];
+      qy += w[i]*sinh[i];
+    }
+    q.x += qx;
+    q.y += qy;
+  };
+  for (std::size_t begin = 0; begin < n; begin += kblocksize) {
+    const std::size_t size = std::min(kblocksize, n - begin);
+    const float *block_phi = phi + begin;
+    const float *block_weight = weight + begin;
+    double block_sum_weights = 0.;
+    int block_n = 0;
+    for (std::size_t i = 0; i < size; ++i) {
+      const bool accepted = !(block_weight[i] < kminimumweight);
+      const double block_offset = offset ? offset[begin + i] : 1.;
+      w[i] = accepted ? block_weight[i]*block_offset : 0.;
+      block_sum_weights += accepted ? block_weight[i] : 0.;
+      block_n += accepted;
+    }
+    for (std::size_t i = 0; i < size; ++i) angles[i] = harmonic_multiplier_*static_cast<double>(block_phi[i]);
+    SinCos(angles, size, sin1, cos1);
+    for (std::size_t i = 0; i < size; ++i) {
+      cosh[i] = cos1[i];
+      sinh[i] = sin1[i];
+    }
+    unsigned int pos = 0;
+    unsigned int doubled_pos = 0;
+    for (unsigned int h = 1; h <= highest; ++h) {
+      if (h <= maximum_harmonic_ && bits_.test(h - 1)) {
+        sum(size, q_[pos]);
+        ++pos;
+      }
+      if (doubled && h%2==0 && doubled->bits_.test(h/2 - 1)) {
+        sum(size, doubled->q_[doubled_pos]);
+        ++doubled_pos;
+      }
+      if (h==highest) break;
+      for (std::size_t i = 0; i < size; ++i) {
+        const double cosn = cosh[i]*cos1[i] - sinh[i]*sin1[i];
+        sinh[i] = sinh[i]*cos1[i] + cosh[i]*sin1[i];
+        cosh[i] = cosn;
+      }
+    }
+    sum_weights_ += block_sum_weights;
+    n_ += block_n;
+    if (doubled) {
+      doubled->sum_weights_ += block_sum_weights;
+      doubled->n_ += block_n;
+    }
+  }
+}
+
+}
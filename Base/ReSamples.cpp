@@ -19,70 +19,110 @@
 
 namespace Qn {
 
-ConfidenceInterval ConfidenceIntervalPercentile(std::vector<double > means) {
-  if (means.empty()) {throw std::out_of_range("vector of samples is empty.");}
+ConfidenceInterval ConfidenceIntervalPercentile(double *first, double *last) {
+  if (first==last) {throw std::out_of_range("vector of samples is empty.");}
   const double alpha = 0.3173;
-  std::sort(means.begin(), means.end());
-  auto lowerpos = std::round(means.size()*alpha/2.);
-  auto upperpos = std::floor(means.size()*(1 - alpha/2.));
-  return ConfidenceInterval{means.at(lowerpos), means.at(upperpos)};
+  const auto n = static_cast<std::size_t>(last - first);
+  const auto lowerpos = static_cast<std::size_t>(std::round(n*alpha/2.));
+  const auto upperpos = static_cast<std::size_t>(std::floor(n*(1 - alpha/2.)));
+  std::nth_element(first, first + lowerpos, last);
+  const auto lower = first[lowerpos];
+  std::nth_element(first + lowerpos, first + upperpos, last);
+  return ConfidenceInterval{lower, first[upperpos]};
 }
 
-ConfidenceInterval ConfidenceIntervalPivot(std::vector<double> means, const double real_mean) {
-  if (means.empty()) {throw std::out_of_range("vector of samples is empty.");}
+ConfidenceInterval ConfidenceIntervalPivot(double *first, double *last, const double real_mean) {
+  if (first==last) {throw std::out_of_range("vector of samples is empty.");}
   const double alpha = 0.3173;
-  std::sort(means.begin(), means.end());
-  auto upperpos = std::round(means.size()*alpha/2.);
-  auto lowerpos = std::floor(means.size()*(1 - alpha/2.));
-  return ConfidenceInterval{2*real_mean - means.at(lowerpos), 2*real_mean - means.at(upperpos)};
+  const auto n = static_cast<std::size_t>(last - first);
+  const auto upperpos = static_cast<std::size_t>(std::round(n*alpha/2.));
+  const auto lowerpos = static_cast<std::size_t>(std::floor(n*(1 - alpha/2.)));
+  std::nth_element(first, first + upperpos, last);
+  const auto upper = first[upperpos];
+  std::nth_element(first + upperpos, first + lowerpos, last);
+  return ConfidenceInterval{2*real_mean - first[lowerpos], 2*real_mean - upper};
 }
 
-ConfidenceInterval ConfidenceIntervalNormal(std::vector<double> means, const double real_mean) {
-  if (means.empty()) {throw std::out_of_range("vector of samples is empty.");}
+ConfidenceInterval ConfidenceIntervalNormal(const double *first, const double *last, const double real_mean) {
+  if (first==last) {throw std::out_of_range("vector of samples is empty.");}
   Statistic stats;
-  for (const auto &mean : means) {
-    stats.Fill(mean, 1.0);
+  for (auto mean = first; mean!=last; ++mean) {
+    stats.Fill(*mean, 1.0);
   }
   auto stddev = std::sqrt(stats.Variance());
   return ConfidenceInterval{real_mean - stddev, real_mean + stddev};
 }
 
+ReSamples &ReSamples::operator+=(const ReSamples &b) {
+  ResetCache();
+  Truncate(b.size());
+  for (size_t i = 0; i < means_.size(); ++i) {
+    means_[i] += b.means_[i];
+  }
+  return *this;
+}
+
+ReSamples &ReSamples::operator-=(const ReSamples &b) {
+  ResetCache();
+  Truncate(b.size());
+  for (size_t i = 0; i < means_.size(); ++i) {
+    means_[i] -= b.means_[i];
+  }
+  return *this;
+}
+
+ReSamples &ReSamples::operator*=(const ReSamples &b) {
+  ResetCache();
+  Truncate(b.size());
+  for (size_t i = 0; i < means_.size(); ++i) {
+    means_[i] *= b.means_[i];
+  }
+  return *this;
+}
+
+ReSamples &ReSamples::operator/=(const ReSamples &b) {
+  ResetCache();
+  Truncate(b.size());
+  for (size_t i = 0; i < means_.size(); ++i) {
+    means_[i] /= b.means_[i];
+  }
+  return *this;
+}
+
+ReSamples &ReSamples::operator*=(const double scale) {
+  ResetCache();
+  for (auto &mean : means_) {
+    mean *= scale;
+  }
+  return *this;
+}
+
 ReSamples ReSamples::Addition(const ReSamples &a, const ReSamples &b) {
   ReSamples result(a);
-  for (size_t i = 0; i < result.means_.size(); ++i) {
-    result.means_[i] += b.means_[i];
-  }
+  result += b;
   return result;
 }
 
 ReSamples ReSamples::Subtraction(const ReSamples &a, const ReSamples &b) {
   ReSamples result(a);
-  for (size_t i = 0; i < result.means_.size(); ++i) {
-    result.means_[i] -= b.means_[i];
-  }
+  result -= b;
   return result;
 }
 ReSamples ReSamples::Division(const ReSamples &a, const ReSamples &b) {
   ReSamples result(a);
-  for (size_t i = 0; i < result.means_.size(); ++i) {
-    result.means_[i] /= b.means_[i];
-  }
+  result /= b;
   return result;
 }
 
 ReSamples ReSamples::Multiplication(const ReSamples &a, const ReSamples &b) {
   ReSamples result(a);
-  for (size_t i = 0; i < result.means_.size(); ++i) {
-    result.means_[i] *= b.means_[i];
-  }
+  result *= b;
   return result;
 }
 
 ReSamples ReSamples::Scaling(const ReSamples &a, const double scale) {
   ReSamples result(a);
-  for (auto &mean : result.means_) {
-    mean *= scale;
-  }
+  result *= scale;
   return result;
 }
 
@@ -106,6 +146,7 @@ ReSamples ReSamples::PowSqrt(const ReSamples &a, unsigned int k) {
 
 ReSamples ReSamples::Merge(const ReSamples &a, const ReSamples &b, bool merge_weights) {
   ReSamples result(b);
+  if (a.size() > 0) result.Truncate(a.size());
   for (size_t i = 0; i < result.means_.size(); ++i) {
     ValueType a_mean = 0.;
     ValueType a_weight = 0.;
@@ -125,11 +166,11 @@ ReSamples ReSamples::Merge(const ReSamples &a, const ReSamples &b, bool merge_we
 
 ReSamples ReSamples::MergeStatistics(const ReSamples &a, const ReSamples &b) {
   ReSamples result(b);
+  if (a.statistics_.size() > 0) result.Truncate(a.statistics_.size());
   for (size_t i = 0; i < result.statistics_.size(); ++i) {
     Statistic stat_a;
-    if (i < a.size()) stat_a = a.statistics_[i];
-    auto stat_b = b.statistics_[i];
-    result.statistics_[i] = Qn::Merge(stat_a, stat_b);
+    if (i < a.statistics_.size()) stat_a = a.statistics_.Get(i);
+    result.statistics_.Set(i, Qn::Merge(stat_a, b.statistics_.Get(i)));
   }
   return result;
 }
@@ -138,10 +179,65 @@ ReSamples ReSamples::Concatenate(const ReSamples &a, const ReSamples &b) {
   ReSamples result(a);
   result.means_.insert(result.means_.end(), b.means_.begin(), b.means_.end());
   result.weights_.insert(result.weights_.end(), b.weights_.begin(), b.weights_.end());
-  result.statistics_.insert(result.statistics_.end(), b.statistics_.begin(), b.statistics_.end());
+  result.statistics_.Append(b.statistics_);
   return result;
 }
 
+void ReSamples::MergeStatisticsInto(ReSamples &a, const ReSamples &b) {
+  a.ResetCache();
+  if (a.statistics_.size()==0) {
+    a.method_ = b.method_;
+    a.statistics_.SetStorage(b.statistics_.GetStorage());
+    a.statistics_.SetAccumulation(b.statistics_.GetAccumulation());
+    a.statistics_.resize(b.statistics_.size());
+  }
+  a.statistics_.resize(std::min(a.statistics_.size(), b.statistics_.size()));
+  a.statistics_.MergeInto(b.statistics_);
+  a.means_.assign(b.means_.begin(), b.means_.begin() + std::min(a.statistics_.size(), b.means_.size()));
+  a.weights_.assign(b.weights_.begin(), b.weights_.begin() + std::min(a.statistics_.size(), b.weights_.size()));
+  a.using_means_ = false;
+}
+
+void ReSamples::ConcatenateInto(ReSamples &a, const ReSamples &b) {
+  if (&a==&b) {
+    const ReSamples copy(b);
+    ConcatenateInto(a, copy);
+    return;
+  }
+  a.ResetCache();
+  a.means_.insert(a.means_.end(), b.means_.begin(), b.means_.end());
+  a.weights_.insert(a.weights_.end(), b.weights_.begin(), b.weights_.end());
+  a.statistics_.Append(b.statistics_);
+  a.using_means_ = false;
+}
+
+ReSamples::size_type ReSamples::ConvergedNumberOfSamples(const double mean,
+                                                        const double tolerance,
+                                                        const size_type n_min,
+                                                        CIMethod method) const {
+  const auto n_samples = statistics_.size();
+  auto width = [this, mean, method](size_type n) {
+    auto ci = ComputeConfidenceInterval(n,
+                                        [this](size_type i) { return statistics_.Mean(i); },
+                                        [this](size_type i) { return statistics_.SumWeights(i); },
+                                        mean, method);
+    return ci.upper_limit - ci.lower_limit;
+  };
+  if (n_samples==0) return n_samples;
+  const auto width_all = width(n_samples);
+  if (!(width_all > 0.)) return n_samples;
+  // the smallest n, for which the widths of all larger numbers of samples agree with the width of all samples.
+  auto converged = n_samples;
+  for (auto n = std::max<size_type>(n_min, 2); n < n_samples; n *= 2) {
+    if (std::fabs(width(n) - width_all) < tolerance*width_all) {
+      if (converged==n_samples) converged = n;
+    } else {
+      converged = n_samples;
+    }
+  }
+  return converged;
+}
+
 std::pair<TGraph *, TGraph *> ReSamples::CIvsNSamples(double mean,
                                                       ReSamples::CIMethod method,
                                                       unsigned int nsteps) const {
@@ -0,0 +1,198 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ResultFileMerger.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include "TClass.h"
+#include "TFile.h"
+#include "TKey.h"
+#include "TList.h"
+
+#include "DataContainer.h"
+#include "EventShape.h"
+
+namespace Qn {
+namespace {
+/**
+ * Objects of the top level keys of a file in the order of the keys. Only the highest cycle of each key is read.
+ */
+struct FileContent {
+  std::vector<std::string> names;
+  std::map<std::string, std::unique_ptr<TObject>> objects;
+};
+
+FileContent ReadFile(const std::string &file_name) {
+  FileContent content;
+  std::unique_ptr<TFile> file(TFile::Open(file_name.data(), "READ"));
+  if (!file || file->IsZombie()) throw std::runtime_error("Cannot open the input file " + file_name + ".");
+  for (auto object : *file->GetListOfKeys()) {
+    auto key = static_cast<TKey *>(object);
+    const std::string name = key->GetName();
+    if (content.objects.find(name)!=content.objects.end()) continue;
+    std::unique_ptr<TObject> read(key->ReadObj());
+    // the histograms are owned by the merge and not by the file.
+    if (auto collection = dynamic_cast<TCollection *>(read.get())) collection->SetOwner(true);
+    content.names.push_back(name);
+    content.objects.emplace(name, std::move(read));
+  }
+  return content;
+}
+
+/**
+ * Reads the files of a batch in parallel.
+ */
+std::vector<FileContent> ReadBatch(const std::vector<std::string> &file_names, std::size_t n_threads) {
+  std::vector<FileContent> contents(file_names.size());
+  std::vector<std::exception_ptr> errors(n_threads);
+  std::vector<std::thread> threads;
+  for (std::size_t thread = 0; thread < n_threads; ++thread) {
+    threads.emplace_back([&, thread]() {
+      try {
+        for (std::size_t i = thread; i < file_names.size(); i += n_threads) contents[i] = ReadFile(file_names[i]);
+      } catch (...) {
+        errors[thread] = std::current_exception();
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  for (const auto &error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+  return contents;
+}
+
+template<typename CONTAINER>
+bool MergeContainers(TObject *target, const std::vector<TObject *> &others) {
+  auto container = dynamic_cast<CONTAINER *>(target);
+  if (!container) return false;
+  std::vector<CONTAINER *> containers;
+  for (auto other : others) containers.push_back(static_cast<CONTAINER *>(other));
+  container->MergeTree(containers, Qn::Execution::kParallel);
+  return true;
+}
+
+bool MergeEventShapes(TObject *target, const std::vector<TObject *> &others) {
+  auto container = dynamic_cast<Qn::DataContainerEventShape *>(target);
+  if (!container) return false;
+  for (auto other : others) {
+    auto shapes = static_cast<Qn::DataContainerEventShape *>(other);
+    if (shapes->size()!=container->size()) throw std::out_of_range("DataContainers do not have the same size.");
+    for (std::size_t ibin = 0; ibin < container->size(); ++ibin) (*container)[ibin].Add((*shapes)[ibin]);
+  }
+  return true;
+}
+
+/**
+ * Merges the objects of the other files into the target. The objects of the other files are modified.
+ * @param target merged object
+ * @param others objects of the same name and class of the other files
+ * @param path name of the object used in the messages
+ */
+void MergeObjects(TObject *target, const std::vector<TObject *> &others, const std::string &path) {
+  for (auto other : others) {
+    if (other->IsA()!=target->IsA()) {
+      throw std::runtime_error("The class of " + path + " differs between the input files.");
+    }
+  }
+  if (MergeContainers<Qn::DataContainerStats>(target, others)) return;
+  if (MergeContainers<Qn::DataContainerStatistic>(target, others)) return;
+  if (MergeEventShapes(target, others)) return;
+  if (auto list = dynamic_cast<TList *>(target)) {
+    // the entries, which are missing in the target, are moved from the first list containing them and merged with
+    // the entries of the following lists below.
+    for (auto other : others) {
+      auto other_list = static_cast<TList *>(other);
+      std::vector<TObject *> missing;
+      for (auto entry : *other_list) {
+        if (!list->FindObject(entry->GetName())) missing.push_back(entry);
+      }
+      for (auto entry : missing) {
+        other_list->Remove(entry);
+        list->Add(entry);
+      }
+    }
+    for (auto object : *list) {
+      const std::string name = object->GetName();
+      std::vector<TObject *> entries;
+      for (auto other : others) {
+        if (auto entry = static_cast<TList *>(other)->FindObject(name.data())) entries.push_back(entry);
+      }
+      if (!entries.empty()) MergeObjects(object, entries, path + "/" + name);
+    }
+    return;
+  }
+  auto merge = target->IsA()->GetMerge();
+  if (!merge) {
+    std::cerr << "flow_merge: " << path << " of class " << target->ClassName() << " cannot be merged. "
+              << "Keeping the object of the first file." << std::endl;
+    return;
+  }
+  TList list;
+  for (auto other : others) list.Add(other);
+  merge(target, &list, nullptr);
+}
+
+/**
+ * Fits the event shapes after all histograms have been accumulated.
+ */
+void FinalizeObject(TObject *object) {
+  if (auto shapes = dynamic_cast<Qn::DataContainerEventShape *>(object)) {
+    for (auto &shape : *shapes) shape.FitWithSpline();
+  } else if (auto list = dynamic_cast<TList *>(object)) {
+    for (auto entry : *list) FinalizeObject(entry);
+  }
+}
+}
+
+void ResultFileMerger::MergeBatch(const std::vector<std::string> &file_names) {
+  if (file_names.empty()) return;
+  auto contents = ReadBatch(file_names, std::min(n_threads_, file_names.size()));
+  // keys, which are missing in the result, are moved from the first file containing them.
+  for (auto &content : contents) {
+    for (const auto &name : content.names) {
+      if (objects_.find(name)!=objects_.end()) continue;
+      names_.push_back(name);
+      objects_.emplace(name, std::move(content.objects[name]));
+      content.objects.erase(name);
+    }
+  }
+  for (const auto &name : names_) {
+    std::vector<TObject *> others;
+    for (const auto &content : contents) {
+      const auto object = content.objects.find(name);
+      if (object!=content.objects.end()) others.push_back(object->second.get());
+    }
+    if (!others.empty()) MergeObjects(objects_[name].get(), others, name);
+  }
+}
+
+void ResultFileMerger::Write(const std::string &file_name) {
+  TFile output(file_name.data(), "RECREATE");
+  if (output.IsZombie()) throw std::runtime_error("Cannot open the output file " + file_name + ".");
+  for (const auto &name : names_) {
+    auto object = objects_[name].get();
+    FinalizeObject(object);
+    object->Write(name.data(), TObject::kSingleKey);
+  }
+  output.Close();
+}
+}
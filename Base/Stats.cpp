@@ -20,6 +20,22 @@
 namespace Qn {
 using STAT = Qn::Stats::State;
 
+namespace {
+/**
+ * Returns the Stats in the state MEAN_ERROR. A copy is only made, if the Stats needs to be converted.
+ * Avoids copying the bootstrap samples of the operands of chained arithmetic operations.
+ * @param stats Stats to be returned in the state MEAN_ERROR
+ * @param converted buffer for the converted copy
+ * @return reference to stats or to the converted copy.
+ */
+const Stats &InMeanErrorState(const Stats &stats, Stats &converted) {
+  if (stats.GetState()==STAT::MEAN_ERROR) return stats;
+  converted = stats;
+  converted.CalculateMeanAndError();
+  return converted;
+}
+}
+
 Stats MergeBins(const Stats &lhs, const Stats &rhs) {
   if (!rhs.mergeable_) throw std::logic_error("Cannot merge Stats. Please check prior operations.");
   Stats result;
@@ -54,98 +70,149 @@ Stats MergeBins(const Stats &lhs, const Stats &rhs) {
   return result;
 }
 //
-Stats Merge(const Stats &lhs, const Stats &rhs) {
+void MergeInto(Stats &lhs, const Stats &rhs) {
   if (!lhs.mergeable_ || !rhs.mergeable_) throw std::logic_error("Cannot merge Stats. Please check prior operations.");
-  Stats result;
-  result.state_ = lhs.state_;
-  result.bits_ = lhs.bits_;
-  result.weights_flag = lhs.weights_flag;
-  result.mergeable_ = lhs.mergeable_;
   if (lhs.TestBit(Qn::Stats::CONCATENATE_SUBSAMPLES)) {
-    result.statistic_ = lhs.statistic_;
-    result.resamples_ = ReSamples::Concatenate(lhs.resamples_, rhs.resamples_);
+    ReSamples::ConcatenateInto(lhs.resamples_, rhs.resamples_);
   } else {
-    result.statistic_ = Qn::Merge(lhs.statistic_, rhs.statistic_);
-    result.resamples_ = ReSamples::MergeStatistics(lhs.resamples_, rhs.resamples_);
+    Qn::MergeInto(lhs.statistic_, rhs.statistic_);
+    ReSamples::MergeStatisticsInto(lhs.resamples_, rhs.resamples_);
   }
+  lhs.mean_ = 0.;
+  lhs.error_ = 0.;
+  lhs.weight_ = 0.;
+}
+
+Stats Merge(const Stats &lhs, const Stats &rhs) {
+  Stats result(lhs);
+  MergeInto(result, rhs);
   return result;
 }
 
+Stats &Stats::operator+=(const Stats &rhs) {
+  Stats rhs_converted;
+  const auto &trhs = InMeanErrorState(rhs, rhs_converted);
+  CalculateMeanAndError();
+  double weight = 0.;
+  if (weights_flag==Stats::Weights::OBSERVABLE) weight = weight_;
+  if (trhs.weights_flag==Stats::Weights::OBSERVABLE) weight = trhs.weight_;
+  error_ = std::sqrt(error_*error_ + trhs.error_*trhs.error_);
+  mean_ = mean_ + trhs.mean_;
+  weight_ = weight;
+  resamples_ += trhs.resamples_;
+  statistic_ = Statistic();
+  mergeable_ = false;
+  return *this;
+}
+
+Stats &Stats::operator-=(const Stats &rhs) {
+  Stats rhs_converted;
+  const auto &trhs = InMeanErrorState(rhs, rhs_converted);
+  CalculateMeanAndError();
+  double weight = 0.;
+  if (weights_flag==Stats::Weights::OBSERVABLE) weight = weight_;
+  if (trhs.weights_flag==Stats::Weights::OBSERVABLE) weight = trhs.weight_;
+  error_ = std::sqrt(error_*error_ + trhs.error_*trhs.error_);
+  mean_ = mean_ - trhs.mean_;
+  weight_ = weight;
+  resamples_ -= trhs.resamples_;
+  statistic_ = Statistic();
+  mergeable_ = false;
+  return *this;
+}
+
+Stats &Stats::operator*=(const Stats &rhs) {
+  Stats rhs_converted;
+  const auto &trhs = InMeanErrorState(rhs, rhs_converted);
+  CalculateMeanAndError();
+  double weight = 0.;
+  bool mergeable = true;
+  if (weights_flag==Stats::Weights::OBSERVABLE && trhs.weights_flag==Stats::Weights::REFERENCE) {
+    weight = weight_;
+  } else if (trhs.weights_flag==Stats::Weights::OBSERVABLE && weights_flag==Stats::Weights::REFERENCE) {
+    weight = trhs.weight_;
+  } else if (trhs.weights_flag==Stats::Weights::OBSERVABLE && weights_flag==Stats::Weights::OBSERVABLE) {
+    mergeable = false;
+  }
+  auto t1 = trhs.mean_*error_;
+  auto t2 = mean_*trhs.error_;
+  error_ = std::sqrt(t1*t1 + t2*t2);
+  mean_ = mean_*trhs.mean_;
+  weight_ = weight;
+  resamples_ *= trhs.resamples_;
+  statistic_ = Statistic();
+  weights_flag = Stats::Weights::REFERENCE;
+  mergeable_ = mergeable;
+  return *this;
+}
+
+Stats &Stats::operator/=(const Stats &den) {
+  Stats den_converted;
+  const auto &trhs = InMeanErrorState(den, den_converted);
+  CalculateMeanAndError();
+  double weight = 0.;
+  bool mergeable = true;
+  if (weights_flag==Stats::Weights::OBSERVABLE && trhs.weights_flag==Stats::Weights::REFERENCE) {
+    weight = weight_;
+  } else if (trhs.weights_flag==Stats::Weights::OBSERVABLE && weights_flag==Stats::Weights::REFERENCE) {
+    weight = trhs.weight_;
+  } else if (trhs.weights_flag==Stats::Weights::OBSERVABLE && weights_flag==Stats::Weights::OBSERVABLE) {
+    mergeable = false;
+  }
+  double denominator_mean;
+  if (trhs.mean_ != 0.) {
+    denominator_mean = trhs.mean_;
+  } else {
+    denominator_mean = 1.;
+  }
+  auto t1 = error_ / denominator_mean;
+  auto t2 = mean_*trhs.error_ / (denominator_mean*denominator_mean);
+  error_ = std::sqrt(t1*t1+t2*t2);
+  mean_ = mean_/trhs.mean_;
+  weight_ = weight;
+  resamples_ /= trhs.resamples_;
+  statistic_ = Statistic();
+  weights_flag = Stats::Weights::REFERENCE;
+  mergeable_ = mergeable;
+  return *this;
+}
+
+Stats &Stats::operator*=(const double scale) {
+  CalculateMeanAndError();
+  mean_ *= scale;
+  error_ *= scale;
+  resamples_ *= scale;
+  return *this;
+}
+
 Stats operator+(const Stats &lhs, const Stats &rhs) {
-  Stats result;
-  result.state_ = STAT::MEAN_ERROR;
-  result.bits_ = lhs.bits_;
-  auto tlhs = lhs;
-  auto trhs = rhs;
-  if (tlhs.state_!=STAT::MEAN_ERROR) tlhs.CalculateMeanAndError();
-  if (trhs.state_!=STAT::MEAN_ERROR) trhs.CalculateMeanAndError();
-  if (tlhs.weights_flag==Stats::Weights::OBSERVABLE) result.weight_ = tlhs.weight_;
-  if (trhs.weights_flag==Stats::Weights::OBSERVABLE) result.weight_ = trhs.weight_;
-  result.mean_ = tlhs.mean_ + trhs.mean_;
-  result.error_ = std::sqrt(tlhs.error_*tlhs.error_ + trhs.error_*trhs.error_);
-  result.resamples_ = ReSamples::Addition(tlhs.resamples_, trhs.resamples_);
-  result.weights_flag = lhs.weights_flag;
-  result.mergeable_ = false;
+  Stats result(lhs);
+  result += rhs;
   return result;
 }
 
 Stats operator-(const Stats &lhs, const Stats &rhs) {
-  Stats result;
-  result.state_ = STAT::MEAN_ERROR;
-  result.bits_ = lhs.bits_;
-  auto tlhs = lhs;
-  auto trhs = rhs;
-  if (tlhs.state_!=STAT::MEAN_ERROR) tlhs.CalculateMeanAndError();
-  if (trhs.state_!=STAT::MEAN_ERROR) trhs.CalculateMeanAndError();
-  if (tlhs.weights_flag==Stats::Weights::OBSERVABLE) result.weight_ = tlhs.weight_;
-  if (trhs.weights_flag==Stats::Weights::OBSERVABLE) result.weight_ = trhs.weight_;
-  result.mean_ = tlhs.mean_ - trhs.mean_;
-  result.error_ = std::sqrt(tlhs.error_*tlhs.error_ + trhs.error_*trhs.error_);
-  result.resamples_ = ReSamples::Subtraction(tlhs.resamples_, trhs.resamples_);
-  result.weights_flag = lhs.weights_flag;
-  result.mergeable_ = false;
+  Stats result(lhs);
+  result -= rhs;
   return result;
 }
 
 Stats operator*(const Stats &lhs, const Stats &rhs) {
-  Stats result;
-  result.state_ = STAT::MEAN_ERROR;
-  result.bits_ = lhs.bits_;
-  auto tlhs = lhs;
-  auto trhs = rhs;
-  if (tlhs.state_!=STAT::MEAN_ERROR) tlhs.CalculateMeanAndError();
-  if (trhs.state_!=STAT::MEAN_ERROR) trhs.CalculateMeanAndError();
-  if (tlhs.weights_flag==Stats::Weights::OBSERVABLE && trhs.weights_flag==Stats::Weights::REFERENCE) {
-    result.weight_ = tlhs.weight_;
-  } else if (trhs.weights_flag==Stats::Weights::OBSERVABLE && tlhs.weights_flag==Stats::Weights::REFERENCE) {
-    result.weight_ = trhs.weight_;
-  } else if (trhs.weights_flag==Stats::Weights::OBSERVABLE && tlhs.weights_flag==Stats::Weights::OBSERVABLE) {
-    result.mergeable_ = false;
-  }
-  result.mean_ = tlhs.mean_*trhs.mean_;
-  auto t1 = trhs.mean_*tlhs.error_;
-  auto t2 = tlhs.mean_*trhs.error_;
-  result.error_ = std::sqrt(t1*t1 + t2*t2);
-  result.resamples_ = ReSamples::Multiplication(tlhs.resamples_, trhs.resamples_);
+  Stats result(lhs);
+  result *= rhs;
   return result;
 }
 
 //
 Stats operator*(const Stats &stat, const double scale) {
-  Stats result = stat;
-  if (result.state_!=STAT::MEAN_ERROR) result.CalculateMeanAndError();
-  result.mean_ *= scale;
-  result.error_ *= scale;
-  result.resamples_ = ReSamples::Scaling(result.resamples_, scale);
+  Stats result(stat);
+  result *= scale;
   return result;
 }
 
 Stats operator*(const double scale, const Stats &stat) {
-  Stats result = stat;
-  if (result.state_!=STAT::MEAN_ERROR) result.CalculateMeanAndError();
-  result.mean_ *= scale;
-  result.error_ *= scale;
-  result.resamples_ = ReSamples::Scaling(result.resamples_, scale);
+  Stats result(stat);
+  result *= scale;
   return result;
 }
 
@@ -160,31 +227,8 @@ Stats operator/(const Stats &stat, const double scale) {
 }
 
 Stats operator/(const Stats &num, const Stats &den) {
-  Stats result;
-  result.state_ = STAT::MEAN_ERROR;
-  result.bits_ = num.bits_;
-  auto tlhs = num;
-  auto trhs = den;
-  if (tlhs.state_!=STAT::MEAN_ERROR) tlhs.CalculateMeanAndError();
-  if (trhs.state_!=STAT::MEAN_ERROR) trhs.CalculateMeanAndError();
-  if (tlhs.weights_flag==Stats::Weights::OBSERVABLE && trhs.weights_flag==Stats::Weights::REFERENCE) {
-    result.weight_ = tlhs.weight_;
-  } else if (trhs.weights_flag==Stats::Weights::OBSERVABLE && tlhs.weights_flag==Stats::Weights::REFERENCE) {
-    result.weight_ = trhs.weight_;
-  } else if (trhs.weights_flag==Stats::Weights::OBSERVABLE && tlhs.weights_flag==Stats::Weights::OBSERVABLE) {
-    result.mergeable_ = false;
-  }
-  result.mean_ = tlhs.mean_/trhs.mean_;
-  double denominator_mean;
-  if (trhs.mean_ != 0.) {
-    denominator_mean = trhs.mean_;
-  } else {
-    denominator_mean = 1.;
-  }
-  auto t1 = tlhs.error_ / denominator_mean;
-  auto t2 = tlhs.mean_*trhs.error_ / (denominator_mean*denominator_mean);
-  result.error_ = std::sqrt(t1*t1+t2*t2);
-  result.resamples_ = ReSamples::Division(tlhs.resamples_, trhs.resamples_);
+  Stats result(num);
+  result /= den;
   return result;
 }
 
@@ -0,0 +1,293 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "StatsColumnarFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Qn {
+
+using namespace StatsFileFormat;
+
+namespace {
+/**
+ * Appends aligned blocks to the columnar file and keeps track of their offsets.
+ */
+class ColumnarWriter {
+ public:
+  explicit ColumnarWriter(const std::string &file_name) : file_name_(file_name) {
+    file_ = std::fopen(file_name_.data(), "wb");
+    if (!file_) throw std::runtime_error("Cannot open the Stats file " + file_name_ + ".");
+  }
+  ~ColumnarWriter() {
+    if (file_) std::fclose(file_);
+  }
+  ColumnarWriter(const ColumnarWriter &) = delete;
+  ColumnarWriter &operator=(const ColumnarWriter &) = delete;
+
+  /**
+   * Aligns the end of the file.
+   * @return offset of the next block
+   */
+  std::uint64_t Align() {
+    static constexpr char padding[kAlignment] = {};
+    const auto n_padding = (kAlignment - position_%kAlignment)%kAlignment;
+    Write(padding, n_padding);
+    return position_;
+  }
+
+  /**
+   * Writes data at the end of the file without aligning it. Used for the parts of a block.
+   */
+  void Write(const void *data, std::size_t size) {
+    if (std::fwrite(data, 1, size, file_)!=size) {
+      throw std::runtime_error("Cannot write to the Stats file " + file_name_ + ".");
+    }
+    position_ += size;
+  }
+
+  /**
+   * Writes an aligned block.
+   * @return offset of the block
+   */
+  std::uint64_t Append(const void *data, std::size_t size) {
+    const auto offset = Align();
+    Write(data, size);
+    return offset;
+  }
+
+  /**
+   * Writes the header at the start of the file and closes it.
+   */
+  void Close(const Header &header) {
+    if (std::fseek(file_, 0, SEEK_SET)!=0 || std::fwrite(&header, sizeof(Header), 1, file_)!=1) {
+      throw std::runtime_error("Cannot write to the Stats file " + file_name_ + ".");
+    }
+    if (std::fclose(file_)!=0) throw std::runtime_error("Cannot write to the Stats file " + file_name_ + ".");
+    file_ = nullptr;
+  }
+
+ private:
+  std::string file_name_; ///< name of the file
+  std::FILE *file_ = nullptr; ///< the file
+  std::uint64_t position_ = 0; ///< current size of the file
+};
+}
+
+void StatsColumnarFile::Write(const std::string &file_name, const DataContainerStats &container) {
+  ColumnarWriter writer(file_name);
+  Header header{};
+  writer.Append(&header, sizeof(Header));
+  const auto n_bins = container.size();
+  header.n_bins = n_bins;
+  // data of the axes. The directory is written after them.
+  const auto &axes = container.GetAxes();
+  std::vector<AxisRecord> records(axes.size());
+  for (std::size_t i = 0; i < axes.size(); ++i) {
+    const auto name = axes[i].Name();
+    records[i].name_offset = writer.Append(name.data(), name.size());
+    records[i].name_size = name.size();
+    records[i].n_bins = axes[i].size();
+    records[i].edges_offset = writer.Append(axes[i].GetPtr(), (axes[i].size() + 1)*sizeof(double));
+  }
+  header.n_axes = static_cast<std::uint32_t>(axes.size());
+  header.axes_offset = writer.Append(records.data(), records.size()*sizeof(AxisRecord));
+  // columns of the bins
+  std::vector<double> column(n_bins);
+  const auto write_column = [&](Column index, double (Stats::*value)() const) {
+    for (std::size_t ibin = 0; ibin < n_bins; ++ibin) column[ibin] = (container[ibin].*value)();
+    header.columns_offset[index] = writer.Append(column.data(), n_bins*sizeof(double));
+  };
+  write_column(kMean, &Stats::Mean);
+  write_column(kErrorStat, &Stats::MeanErrorStat);
+  write_column(kWeight, &Stats::Weight);
+  write_column(kEntries, &Stats::N);
+  write_column(kNeff, &Stats::Neff);
+  std::vector<std::uint32_t> bits(n_bins);
+  std::vector<std::uint8_t> flags(n_bins);
+  std::vector<std::uint32_t> n_samples(n_bins);
+  for (std::size_t ibin = 0; ibin < n_bins; ++ibin) {
+    const auto &stats = container[ibin];
+    bits[ibin] = stats.bits_;
+    if (stats.weights_flag==Stats::Weights::OBSERVABLE) flags[ibin] |= kObservable;
+    if (stats.mergeable_) flags[ibin] |= kMergeable;
+    if (stats.resamples_.GetMethod()==ReSamples::Method::kSubSamples) flags[ibin] |= kSubSamples;
+    n_samples[ibin] = static_cast<std::uint32_t>(stats.GetNSamples());
+    header.n_samples = std::max<std::uint64_t>(header.n_samples, n_samples[ibin]);
+  }
+  header.bits_offset = writer.Append(bits.data(), n_bins*sizeof(std::uint32_t));
+  header.flags_offset = writer.Append(flags.data(), n_bins*sizeof(std::uint8_t));
+  header.n_samples_offset = writer.Append(n_samples.data(), n_bins*sizeof(std::uint32_t));
+  // samples of the bins. The samples are written bin by bin, such that only one bin is buffered.
+  std::vector<double> samples(header.n_samples);
+  const auto write_samples = [&](bool means) {
+    const auto offset = writer.Align();
+    for (std::size_t ibin = 0; ibin < n_bins; ++ibin) {
+      const auto &stats = container[ibin];
+      const auto &resamples = stats.resamples_;
+      const bool calculated = stats.GetState()==Stats::State::MEAN_ERROR && resamples.using_means_;
+      std::fill(samples.begin(), samples.end(), 0.);
+      for (std::size_t i = 0; i < n_samples[ibin]; ++i) {
+        if (calculated) {
+          samples[i] = means ? resamples.means_[i] : resamples.weights_[i];
+        } else {
+          samples[i] = means ? resamples.statistics_.Mean(i) : resamples.statistics_.SumWeights(i);
+        }
+      }
+      writer.Write(samples.data(), samples.size()*sizeof(double));
+    }
+    return offset;
+  };
+  header.sample_means_offset = write_samples(true);
+  header.sample_weights_offset = write_samples(false);
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  writer.Close(header);
+}
+
+StatsColumnarFile::~StatsColumnarFile() {
+  Unmap();
+}
+
+void StatsColumnarFile::Unmap() {
+  if (mapped_) munmap(const_cast<char *>(mapped_), size_);
+  mapped_ = nullptr;
+  size_ = 0;
+  header_ = nullptr;
+  bits_ = nullptr;
+  flags_ = nullptr;
+  n_samples_ = nullptr;
+  sample_means_ = nullptr;
+  sample_weights_ = nullptr;
+  axes_.clear();
+  stride_.clear();
+}
+
+void StatsColumnarFile::Open(const std::string &file_name) {
+  if (mapped_) throw std::logic_error("The Stats file is already open.");
+  const auto descriptor = open(file_name.data(), O_RDONLY);
+  if (descriptor < 0) throw std::runtime_error("Cannot open the Stats file " + file_name + ".");
+  struct stat status{};
+  if (fstat(descriptor, &status)!=0 || static_cast<std::size_t>(status.st_size) < sizeof(Header)) {
+    close(descriptor);
+    throw std::runtime_error("The Stats file " + file_name + " is not valid.");
+  }
+  const std::size_t size = status.st_size;
+  auto mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  close(descriptor);
+  if (mapped==MAP_FAILED) throw std::runtime_error("Cannot map the Stats file " + file_name + ".");
+  mapped_ = static_cast<const char *>(mapped);
+  size_ = size;
+  // an invalid file is unmapped, such that the file can be opened again.
+  try {
+    ReadLayout(file_name);
+  } catch (...) {
+    Unmap();
+    throw;
+  }
+}
+
+void StatsColumnarFile::ReadLayout(const std::string &file_name) {
+  header_ = reinterpret_cast<const Header *>(mapped_);
+  const auto n_bins = header_->n_bins;
+  const auto n_samples = n_bins*header_->n_samples;
+  bool valid = std::memcmp(header_->magic, kMagic, sizeof(kMagic))==0 && header_->version==kVersion
+      && header_->axes_offset + header_->n_axes*sizeof(AxisRecord) <= size_
+      && header_->bits_offset + n_bins*sizeof(std::uint32_t) <= size_
+      && header_->flags_offset + n_bins*sizeof(std::uint8_t) <= size_
+      && header_->n_samples_offset + n_bins*sizeof(std::uint32_t) <= size_
+      && header_->sample_means_offset + n_samples*sizeof(double) <= size_
+      && header_->sample_weights_offset + n_samples*sizeof(double) <= size_;
+  for (auto offset : header_->columns_offset) valid = valid && offset + n_bins*sizeof(double) <= size_;
+  if (!valid) throw std::runtime_error("The Stats file " + file_name + " is not valid.");
+  bits_ = reinterpret_cast<const std::uint32_t *>(mapped_ + header_->bits_offset);
+  flags_ = reinterpret_cast<const std::uint8_t *>(mapped_ + header_->flags_offset);
+  n_samples_ = reinterpret_cast<const std::uint32_t *>(mapped_ + header_->n_samples_offset);
+  sample_means_ = reinterpret_cast<const double *>(mapped_ + header_->sample_means_offset);
+  sample_weights_ = reinterpret_cast<const double *>(mapped_ + header_->sample_weights_offset);
+  const auto records = reinterpret_cast<const AxisRecord *>(mapped_ + header_->axes_offset);
+  std::size_t total_bins = 1;
+  for (std::uint32_t i = 0; i < header_->n_axes; ++i) {
+    const auto &record = records[i];
+    if (record.name_offset + record.name_size > size_ || record.edges_offset + (record.n_bins + 1)*sizeof(double) > size_) {
+      throw std::runtime_error("The Stats file " + file_name + " is not valid.");
+    }
+    const auto edges = reinterpret_cast<const double *>(mapped_ + record.edges_offset);
+    axes_.emplace_back(std::string(mapped_ + record.name_offset, record.name_size),
+                       std::vector<double>(edges, edges + record.n_bins + 1));
+    total_bins *= record.n_bins;
+  }
+  if (total_bins!=n_bins) throw std::runtime_error("The Stats file " + file_name + " is not valid.");
+  stride_.resize(axes_.size() + 1);
+  stride_[axes_.size()] = 1;
+  for (std::size_t i = axes_.size(); i > 0; --i) stride_[i - 1] = stride_[i]*axes_[i - 1].size();
+}
+
+StatsColumnarFile::size_type StatsColumnarFile::GetLinearIndex(const std::vector<size_type> &indices) const {
+  if (indices.size()!=axes_.size()) throw std::out_of_range("The number of indices does not match the axes.");
+  size_type offset = 0;
+  for (std::size_t i = 0; i < axes_.size(); ++i) {
+    if (indices[i] >= axes_[i].size()) throw std::out_of_range("The index is out of the range of the axis.");
+    offset += stride_[i + 1]*indices[i];
+  }
+  return offset;
+}
+
+Stats StatsColumnarFile::GetStats(size_type bin) const {
+  if (bin >= size()) throw std::out_of_range("The bin is out of the range of the Stats file.");
+  Stats stats;
+  stats.state_ = Stats::State::MEAN_ERROR;
+  stats.mean_ = Mean(bin);
+  stats.error_ = MeanErrorStat(bin);
+  stats.weight_ = Weight(bin);
+  stats.bits_ = bits_[bin];
+  stats.weights_flag = (flags_[bin] & kObservable) ? Stats::Weights::OBSERVABLE : Stats::Weights::REFERENCE;
+  // the moments of the samples are not stored, such that the bins cannot be merged.
+  stats.mergeable_ = false;
+  // the sums of the statistic are restored from the columns of the bins, which kept their moments.
+  if (N(bin) > 0) {
+    auto &statistic = stats.statistic_;
+    statistic.n_entries_ = N(bin);
+    statistic.sum_weights_ = Weight(bin);
+    statistic.sum_values_ = Mean(bin)*Weight(bin);
+    if (Neff(bin) > 0) {
+      statistic.sum_weights2_ = Weight(bin)*Weight(bin)/Neff(bin);
+      statistic.sum_sq_ = MeanErrorStat(bin)*MeanErrorStat(bin)*Neff(bin)*(Weight(bin) - 1);
+    }
+  }
+  auto &resamples = stats.resamples_;
+  resamples.method_ = (flags_[bin] & kSubSamples) ? ReSamples::Method::kSubSamples : ReSamples::Method::kBootstrap;
+  resamples.means_.assign(SampleMeans(bin), SampleMeans(bin) + n_samples_[bin]);
+  resamples.weights_.assign(SampleWeights(bin), SampleWeights(bin) + n_samples_[bin]);
+  resamples.using_means_ = n_samples_[bin] > 0;
+  return stats;
+}
+
+DataContainerStats StatsColumnarFile::ToDataContainer() const {
+  DataContainerStats container;
+  const bool integrated = axes_.size()==1 && axes_[0].size()==1 && axes_[0].Name()=="integrated";
+  if (!integrated) container.AddAxes(axes_);
+  for (size_type ibin = 0; ibin < size(); ++ibin) container[ibin] = GetStats(ibin);
+  return container;
+}
+
+}
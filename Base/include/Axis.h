@@ -22,6 +22,9 @@
 #include <vector>
 #include <string>
 #include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
 
 #include "Rtypes.h"
 
@@ -46,7 +49,9 @@ class Axis {
    * @param bin_edges vector of bin edges. starting with lowest bin edge and ending with uppermost bin edge.
    */
   Axis(std::string name, std::vector<T> bin_edges)
-      : name_(std::move(name)), bin_edges_(std::move(bin_edges)) {}
+      : name_(std::move(name)), bin_edges_(std::move(bin_edges)) {
+    DetermineUniformBinning();
+  }
 
   /**
    * Constructor for fixed bin width. Calculates bin width automatically and sets bin edges.
@@ -61,17 +66,21 @@ class Axis {
       T bin_width = (upbin - lowbin)/(T) nbins;
       bin_edges_.push_back(lowbin + i*bin_width);
     }
+    DetermineUniformBinning();
   }
 
-  Axis(const Axis<T> &axis) : name_(axis.name_), bin_edges_(axis.bin_edges_) {}
+  Axis(const Axis<T> &axis) :
+      name_(axis.name_),
+      bin_edges_(axis.bin_edges_),
+      uniform_(axis.uniform_),
+      inverse_bin_width_(axis.inverse_bin_width_),
+      bin_lookup_(axis.bin_lookup_),
+      inverse_cell_width_(axis.inverse_cell_width_) {}
   bool operator==(const Axis &axis) const { return name_==axis.name_; }
 
   typedef typename std::vector<T>::const_iterator citerator;
-  typedef typename std::vector<T>::iterator iterator;
   citerator begin() const { return bin_edges_.cbegin(); } ///< iterator for external use
   citerator end() const { return bin_edges_.cend(); } ///< iterator for external use
-  iterator begin() { return bin_edges_.begin(); } ///< iterator for external use
-  iterator end() { return bin_edges_.end(); } ///< iterator for external use
   /**
    * Set Name of axis.
    * @param name name of axis
@@ -88,10 +97,14 @@ class Axis {
   /**
    * Finds bin index for a given value
    * if value is smaller than lowest bin return -1.
+   * For uniform binnings the bin is calculated directly instead of searching the bin edges. For variable binnings
+   * the candidate bins are looked up in a table of equidistant cells.
    * @param value for finding corresponding bin
    * @return bin index
    */
   inline long FindBin(const T value) const {
+    if (uniform_) return FindBinUniform(value);
+    if (!bin_lookup_.empty()) return FindBinLookup(value);
     long bin = 0;
     if (value < *bin_edges_.begin()) {
       bin = -1;
@@ -153,9 +166,144 @@ class Axis {
     std::cout << bin_edges_.back() << "\n";
   }
 
+  /**
+   * Adds the bin indices of a batch of values multiplied by a stride to the linear indices of the values.
+   * The choice between the uniform and the general binning is made once for the whole batch.
+   * @param values values of the batch
+   * @param n number of values
+   * @param stride stride of the axis
+   * @param bins linear indices of the values. Set to -1 if the value is outside of the range.
+   */
+  template<typename V>
+  void AccumulateBins(const V *values, const std::size_t n, const long stride, long *bins) const {
+    if (uniform_) {
+      for (std::size_t i = 0; i < n; ++i) {
+        const long bin = FindBinUniform(values[i]);
+        bins[i] = (bin < 0 || bins[i] < 0) ? -1 : bins[i] + stride*bin;
+      }
+    } else {
+      for (std::size_t i = 0; i < n; ++i) {
+        const long bin = FindBin(values[i]);
+        bins[i] = (bin < 0 || bins[i] < 0) ? -1 : bins[i] + stride*bin;
+      }
+    }
+  }
+
+  /**
+   * Checks if the bin edges are equidistant and caches the inverse bin width used by FindBin.
+   * Otherwise builds the lookup table of the variable binning. Called by the constructors and by the read rule
+   * of the dictionary, after the bin edges have been read from a file.
+   */
+  void DetermineUniformBinning() {
+    uniform_ = false;
+    bin_lookup_.clear();
+    if (bin_edges_.size() < 2) return;
+    const auto nbins = bin_edges_.size() - 1;
+    const T bin_width = (bin_edges_.back() - bin_edges_.front())/(T) nbins;
+    if (!(bin_width > 0)) return;
+    for (std::size_t i = 0; i < bin_edges_.size(); ++i) {
+      const T expected = bin_edges_.front() + i*bin_width;
+      if (std::abs(bin_edges_[i] - expected) > kUniformTolerance*bin_width) {
+        BuildBinLookup();
+        return;
+      }
+    }
+    inverse_bin_width_ = 1/bin_width;
+    uniform_ = true;
+  }
+
  private:
+  /**
+   * Finds the bin index for a given value of a uniform binning.
+   * The bin is estimated from the bin width and afterwards validated against the bin edges,
+   * such that the result is identical to the search of the bin edges.
+   * @param value for finding corresponding bin
+   * @return bin index
+   */
+  inline long FindBinUniform(const T value) const {
+    if (!(value >= bin_edges_.front() && value < bin_edges_.back())) {
+      // NaN is found in the first bin by the search of the bin edges.
+      return value!=value ? 0 : -1;
+    }
+    const long last = static_cast<long>(bin_edges_.size()) - 2;
+    long bin = static_cast<long>((value - bin_edges_.front())*inverse_bin_width_);
+    if (bin > last) bin = last;
+    while (bin > 0 && value < bin_edges_[bin]) --bin;
+    while (bin < last && value >= bin_edges_[bin + 1]) ++bin;
+    return bin;
+  }
+
+  /**
+   * Finds the bin index for a given value of a variable binning.
+   * The cell of the value gives the range of bins, which contain values of the cell. The bin is found by counting
+   * the lower bin edges of the range below the value, which is a short loop without data dependent branches.
+   * @param value for finding corresponding bin
+   * @return bin index
+   */
+  inline long FindBinLookup(const T value) const {
+    if (!(value >= bin_edges_.front() && value < bin_edges_.back())) {
+      // NaN is found in the first bin by the search of the bin edges.
+      return value!=value ? 0 : -1;
+    }
+    const auto cell = FindCell(value);
+    const long first = bin_lookup_[cell];
+    const long last = bin_lookup_[cell + 1];
+    if (last - first > kMaxLookupScan) {
+      return std::upper_bound(bin_edges_.begin() + first + 1, bin_edges_.begin() + last + 1, value)
+          - bin_edges_.begin() - 1;
+    }
+    long bin = first;
+    for (long edge = first + 1; edge <= last; ++edge) bin += bin_edges_[edge] <= value;
+    return bin;
+  }
+
+  /**
+   * Finds the cell of a value in the range of the axis. Monotonic in the value, also with rounding.
+   * @param value for finding corresponding cell
+   * @return cell index
+   */
+  inline std::size_t FindCell(const T value) const {
+    const auto cell = static_cast<long>((value - bin_edges_.front())*inverse_cell_width_);
+    const auto last = static_cast<long>(bin_lookup_.size()) - 2;
+    return static_cast<std::size_t>(std::max(0l, std::min(cell, last)));
+  }
+
+  /**
+   * Builds the lookup table of a variable binning. Cell c covers the bins from bin_lookup_[c] to bin_lookup_[c + 1].
+   * The table is only used for strictly increasing bin edges, for which the result is identical to the search of
+   * the bin edges.
+   */
+  void BuildBinLookup() {
+    bin_lookup_.clear();
+    if (bin_edges_.size() < 3) return;
+    for (std::size_t i = 1; i < bin_edges_.size(); ++i) {
+      if (!(bin_edges_[i - 1] < bin_edges_[i])) return;
+    }
+    if (!std::isfinite(bin_edges_.front()) || !std::isfinite(bin_edges_.back())) return;
+    const auto nbins = bin_edges_.size() - 1;
+    const auto ncells = kLookupCellsPerBin*nbins;
+    inverse_cell_width_ = (T) ncells/(bin_edges_.back() - bin_edges_.front());
+    if (!std::isfinite(inverse_cell_width_)) return;
+    bin_lookup_.resize(ncells + 1);
+    // the first bin of a cell is the lowest bin, whose upper edge is not in a lower cell.
+    std::size_t bin = 0;
+    for (std::size_t cell = 0; cell < ncells; ++cell) {
+      while (bin < nbins - 1 && FindCell(bin_edges_[bin + 1]) < cell) ++bin;
+      bin_lookup_[cell] = static_cast<std::uint32_t>(bin);
+    }
+    bin_lookup_[ncells] = static_cast<std::uint32_t>(nbins - 1);
+  }
+
+  static constexpr double kUniformTolerance = 1e-6; ///< relative tolerance on the bin edges of a uniform binning
+  static constexpr std::size_t kLookupCellsPerBin = 4; ///< cells of the lookup table of a variable binning per bin
+  static constexpr long kMaxLookupScan = 8; ///< largest range of bins of a cell, which is counted instead of searched
+
   std::string name_;
   std::vector<T> bin_edges_;
+  bool uniform_ = false; //!<! bin edges are equidistant
+  T inverse_bin_width_ = 0; //!<! inverse of the bin width for uniform binnings
+  std::vector<std::uint32_t> bin_lookup_; //!<! first bin of each cell for variable binnings
+  T inverse_cell_width_ = 0; //!<! inverse of the cell width of the lookup table
 
   /// \cond CLASSIMP
  ClassDef(Axis, 5);
@@ -0,0 +1,122 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_BASE_INCLUDE_BOUNDEDQUEUE_H_
+#define FLOW_BASE_INCLUDE_BOUNDEDQUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace Qn {
+/**
+ * @class BoundedQueue
+ * @brief Lock-free bounded queue for several producers and consumers.
+ * Each cell of the ring carries a sequence number, which tells the producers and consumers whether the cell is free
+ * or filled in the current round. The producers and the consumers claim a position with a compare and swap on their
+ * counter and wait only for the cell they claimed, such that threads do not block each other. TryPush and TryPop
+ * return false instead of waiting, if the queue is full or empty.
+ * @tparam T type of the elements, which needs to be movable.
+ */
+template<typename T>
+class BoundedQueue {
+ public:
+  /**
+   * Constructor
+   * @param capacity capacity of the queue, which is rounded up to a power of two
+   */
+  explicit BoundedQueue(std::size_t capacity) {
+    std::size_t size = 2;
+    while (size < capacity) size *= 2;
+    mask_ = size - 1;
+    cells_ = std::make_unique<Cell[]>(size);
+    for (std::size_t i = 0; i < size; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  BoundedQueue(const BoundedQueue &) = delete;
+  BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+  /**
+   * Adds an element, if the queue is not full.
+   * @param value the element
+   * @return false if the queue is full
+   */
+  bool TryPush(T &&value) {
+    auto position = push_position_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells_[position & mask_];
+      const auto sequence = cell->sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+      if (difference==0) {
+        if (push_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = push_position_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Removes the oldest element, if the queue is not empty.
+   * @param value the removed element
+   * @return false if the queue is empty
+   */
+  bool TryPop(T &value) {
+    auto position = pop_position_.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells_[position & mask_];
+      const auto sequence = cell->sequence.load(std::memory_order_acquire);
+      const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+      if (difference==0) {
+        if (pop_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = pop_position_.load(std::memory_order_relaxed);
+      }
+    }
+    value = std::move(cell->value);
+    cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+ private:
+  /**
+   * Cell of the ring. Aligned to a cache line, such that neighbouring cells used by different threads do not
+   * share cache lines.
+   */
+  struct alignas(64) Cell {
+    std::atomic<std::size_t> sequence{0}; ///< round, in which the cell is free or filled
+    T value{}; ///< the element
+  };
+
+  std::unique_ptr<Cell[]> cells_; ///< ring of cells
+  std::size_t mask_ = 0; ///< capacity - 1
+  alignas(64) std::atomic<std::size_t> push_position_{0}; ///< next position of the producers
+  alignas(64) std::atomic<std::size_t> pop_position_{0}; ///< next position of the consumers
+};
+}
+
+#endif //FLOW_BASE_INCLUDE_BOUNDEDQUEUE_H_
@@ -18,7 +18,14 @@
 #ifndef FLOW_CORRELATIONRESULT_H
 #define FLOW_CORRELATIONRESULT_H
 
+#include <algorithm>
+#include <atomic>
+#include <bitset>
 #include <cmath>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <numeric>
 #include "Rtypes.h"
@@ -27,7 +34,6 @@ namespace Qn {
 
 struct CorrelationResult {
   CorrelationResult() = default;
-  virtual ~CorrelationResult() = default;
   CorrelationResult(double result, bool valid, double inweight) :
       result(result),
       validity(valid),
@@ -37,10 +43,189 @@ struct CorrelationResult {
   double weight = 1.;    // weight
 
   /// \cond CLASSIMP
- ClassDef(CorrelationResult, 1);
+ ClassDefNV(CorrelationResult, 2);
 /// \endcond
 };
 
+static_assert(std::is_trivially_copyable<CorrelationResult>::value, "CorrelationResult needs to be trivially copyable.");
+
+/**
+ * @class CorrelationResultBuffer
+ * @brief Per event results of all bins of a correlation.
+ * The values and weights are stored in separate arrays and the validity in a bitmask, such that the valid bins
+ * can be found without touching the values of the invalid ones. Only used during the calculation and not saved.
+ */
+class CorrelationResultBuffer {
+ public:
+  using size_type = std::size_t;
+  static constexpr size_type kBitsPerWord = 64;
+
+  CorrelationResultBuffer() = default;
+  CorrelationResultBuffer(const CorrelationResultBuffer &other) : values_(other.values_), weights_(other.weights_) {
+    CopyValidity(other);
+  }
+  CorrelationResultBuffer &operator=(const CorrelationResultBuffer &other) {
+    if (this==&other) return *this;
+    values_ = other.values_;
+    weights_ = other.weights_;
+    CopyValidity(other);
+    return *this;
+  }
+  CorrelationResultBuffer(CorrelationResultBuffer &&other) noexcept :
+      values_(std::move(other.values_)), weights_(std::move(other.weights_)),
+      n_words_(std::exchange(other.n_words_, 0)), validity_(std::move(other.validity_)) {}
+  CorrelationResultBuffer &operator=(CorrelationResultBuffer &&other) noexcept {
+    values_ = std::move(other.values_);
+    weights_ = std::move(other.weights_);
+    n_words_ = std::exchange(other.n_words_, 0);
+    validity_ = std::move(other.validity_);
+    return *this;
+  }
+
+  /**
+   * Resizes the buffer. All bins are invalid afterwards.
+   * @param size number of bins
+   */
+  void Resize(size_type size) {
+    values_.assign(size, 0.);
+    weights_.assign(size, 1.);
+    n_words_ = (size + kBitsPerWord - 1)/kBitsPerWord;
+    validity_.reset(new std::atomic<std::uint64_t>[n_words_]);
+    Invalidate();
+  }
+
+  /**
+   * Marks all bins as invalid. Called before the results of a new event are calculated.
+   */
+  void Invalidate() {
+    for (size_type iword = 0; iword < n_words_; ++iword) validity_[iword].store(0, std::memory_order_relaxed);
+  }
+
+  /**
+   * Sets the result of a bin.
+   * @param ibin linear index of the bin
+   * @param value value of the correlation
+   * @param valid validity of the correlation
+   * @param weight weight of the correlation
+   */
+  void Set(size_type ibin, double value, bool valid, double weight) {
+    values_[ibin] = value;
+    weights_[ibin] = weight;
+    const auto bit = std::uint64_t{1} << (ibin%kBitsPerWord);
+    auto &word = validity_[ibin/kBitsPerWord];
+    const auto bits = word.load(std::memory_order_relaxed);
+    word.store(valid ? bits | bit : bits & ~bit, std::memory_order_relaxed);
+  }
+
+  /**
+   * Sets the result of a bin, while other threads set the results of other bins. The validity is updated with an
+   * atomic operation, because the bits of neighbouring bins share a word. The results are visible to other threads
+   * after the setting threads are joined.
+   * @param ibin linear index of the bin
+   * @param value value of the correlation
+   * @param valid validity of the correlation
+   * @param weight weight of the correlation
+   */
+  void SetConcurrent(size_type ibin, double value, bool valid, double weight) {
+    values_[ibin] = value;
+    weights_[ibin] = weight;
+    const auto bit = std::uint64_t{1} << (ibin%kBitsPerWord);
+    if (valid) {
+      validity_[ibin/kBitsPerWord].fetch_or(bit, std::memory_order_relaxed);
+    } else {
+      validity_[ibin/kBitsPerWord].fetch_and(~bit, std::memory_order_relaxed);
+    }
+  }
+
+  size_type size() const { return values_.size(); }
+  bool IsValid(size_type ibin) const { return (Word(ibin/kBitsPerWord) >> (ibin%kBitsPerWord)) & 1U; }
+  double Value(size_type ibin) const { return values_[ibin]; }
+  double Weight(size_type ibin) const { return weights_[ibin]; }
+
+  /**
+   * Returns the result of a bin as CorrelationResult.
+   * @param ibin linear index of the bin
+   * @return result of the bin
+   */
+  CorrelationResult operator[](size_type ibin) const { return {values_[ibin], IsValid(ibin), weights_[ibin]}; }
+
+  /**
+   * Returns the number of valid bins.
+   */
+  size_type CountValid() const {
+    size_type n = 0;
+    for (size_type iword = 0; iword < n_words_; ++iword) n += std::bitset<kBitsPerWord>(Word(iword)).count();
+    return n;
+  }
+
+  /**
+   * Calls the function for all valid bins in increasing order.
+   * @tparam Function type of the function
+   * @param function function with the signature void(size_type ibin, double value, double weight)
+   */
+  template<typename Function>
+  void ForEachValid(Function &&function) const {
+    for (size_type iword = 0; iword < n_words_; ++iword) {
+      auto word = Word(iword);
+      while (word) {
+        const auto ibin = iword*kBitsPerWord + LowestBit(word);
+        function(ibin, values_[ibin], weights_[ibin]);
+        word &= word - 1;
+      }
+    }
+  }
+
+  /**
+   * Calls the function for the valid bins in [first, last) in increasing order.
+   * @tparam Function type of the function
+   * @param first first bin
+   * @param last end of the bins
+   * @param function function with the signature void(size_type ibin, double value, double weight)
+   */
+  template<typename Function>
+  void ForEachValid(size_type first, size_type last, Function &&function) const {
+    last = std::min(last, size());
+    for (auto iword = first/kBitsPerWord; iword*kBitsPerWord < last; ++iword) {
+      auto word = Word(iword);
+      if (iword==first/kBitsPerWord) word &= ~std::uint64_t{0} << (first%kBitsPerWord);
+      const auto end = last - iword*kBitsPerWord;
+      if (end < kBitsPerWord) word &= (std::uint64_t{1} << end) - 1;
+      while (word) {
+        const auto ibin = iword*kBitsPerWord + LowestBit(word);
+        function(ibin, values_[ibin], weights_[ibin]);
+        word &= word - 1;
+      }
+    }
+  }
+
+ private:
+  std::uint64_t Word(size_type iword) const { return validity_[iword].load(std::memory_order_relaxed); }
+
+  /**
+   * Returns the position of the lowest set bit of a non-zero word.
+   */
+  static size_type LowestBit(std::uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    return std::bitset<kBitsPerWord>((word & -word) - 1).count();
+#endif
+  }
+
+  void CopyValidity(const CorrelationResultBuffer &other) {
+    n_words_ = other.n_words_;
+    validity_.reset(n_words_ ? new std::atomic<std::uint64_t>[n_words_] : nullptr);
+    for (size_type iword = 0; iword < n_words_; ++iword) {
+      validity_[iword].store(other.Word(iword), std::memory_order_relaxed);
+    }
+  }
+
+  std::vector<double> values_;         ///< values of the bins
+  std::vector<double> weights_;        ///< weights of the bins
+  size_type n_words_ = 0;              ///< number of words of the validity bitmask
+  std::unique_ptr<std::atomic<std::uint64_t>[]> validity_; ///< validity bitmask of the bins
+};
+
 }
 
 #endif
\ No newline at end of file
@@ -20,6 +20,7 @@
 #ifndef QNCUTS_H
 #define QNCUTS_H
 
+#include <array>
 #include <string>
 #include "ROOT/RMakeUnique.hxx"
 #include "ROOT/RIntegerSequence.hxx"
@@ -33,6 +34,13 @@ struct CutBase {
   virtual ~CutBase() = default;
   virtual bool Check() const = 0;
   virtual bool Check(unsigned int) const = 0;
+  /**
+   * Removes the entries failing the cut from a list of entries. The order of the remaining entries is kept.
+   * @param entries offsets of the entries from the variable ids
+   * @param n number of entries
+   * @return number of entries passing the cut
+   */
+  virtual std::size_t Select(unsigned int *entries, std::size_t n) const = 0;
   virtual std::string Name() const = 0;
 };
 
@@ -57,6 +65,9 @@ class Cut : public CutBase {
     return CheckImpl(i_channel, std::make_index_sequence<sizeof...(T)>{});
   }
   bool Check() const override { return CheckImpl(0, std::make_index_sequence<sizeof...(T)>{}); }
+  std::size_t Select(unsigned int *entries, const std::size_t n) const override {
+    return SelectImpl(entries, n, std::make_index_sequence<sizeof...(T)>{});
+  }
 
   std::string Name() const override { return name_; }
 
@@ -71,11 +82,65 @@ class Cut : public CutBase {
   bool CheckImpl(const unsigned int i, std::index_sequence<I...>) const {
     return lambda_(*(variables_[I].Get() + i)...);
   }
+  /**
+   * Implements the selection of the entries passing the cut.
+   * @tparam I index sequence
+   * @param entries offsets of the entries from the variable id.
+   * @param n number of entries
+   * @return number of entries passing the cut.
+   */
+  template<std::size_t... I>
+  std::size_t SelectImpl(unsigned int *entries, const std::size_t n, std::index_sequence<I...>) const {
+    const std::array<const double *, sizeof...(T)> values = {{variables_[I].Get()...}};
+    std::size_t n_passed = 0;
+    for (std::size_t k = 0; k < n; ++k) {
+      const auto entry = entries[k];
+      entries[n_passed] = entry;
+      n_passed += lambda_(*(values[I] + entry)...);
+    }
+    return n_passed;
+  }
   std::array<VAR, sizeof...(T)> variables_; /// array of the variables used in the cut.
   std::function<bool(T...)> lambda_; /// function used to evaluate the cut.
   std::string name_;
 };
 
+/**
+ * Cut requiring a variable to be in a closed interval. An equality cut is a range with equal bounds.
+ * The comparisons are evaluated without the call of a cut function and without branches, such that the selection
+ * of entries can be vectorized by the compiler.
+ * @tparam VAR type of the variable
+ */
+template<typename VAR>
+class RangeCut : public CutBase {
+ public:
+  RangeCut(VAR variable, double low, double high, std::string name)
+      : variable_(std::move(variable)), low_(low), high_(high), name_(std::move(name)) {}
+  bool Check(const unsigned int i_channel) const override {
+    const auto value = *(variable_.Get() + i_channel);
+    return low_ <= value && value <= high_;
+  }
+  bool Check() const override { return Check(0); }
+  std::size_t Select(unsigned int *entries, const std::size_t n) const override {
+    const auto values = variable_.Get();
+    std::size_t n_passed = 0;
+    for (std::size_t k = 0; k < n; ++k) {
+      const auto entry = entries[k];
+      const auto value = values[entry];
+      entries[n_passed] = entry;
+      n_passed += (low_ <= value) & (value <= high_);
+    }
+    return n_passed;
+  }
+  std::string Name() const override { return name_; }
+
+ private:
+  VAR variable_; /// variable used in the cut.
+  double low_; /// lower bound of the range
+  double high_; /// upper bound of the range
+  std::string name_;
+};
+
 namespace Details {
 template<typename T, std::size_t>
 using CutDataType = T &;
@@ -0,0 +1,309 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_DATACONTAINEREXPRESSION_H
+#define FLOW_DATACONTAINEREXPRESSION_H
+
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Qn {
+//Forward declaration of DataContainer
+template<typename T, typename AxisType>
+class DataContainer;
+
+namespace Internal {
+
+/**
+ * Checks if a type is a lazy DataContainer expression.
+ * @tparam T type to be checked
+ */
+template<typename T>
+struct IsContainerExpression : std::false_type {};
+
+/**
+ * Checks if a type is a DataContainer.
+ * @tparam T type to be checked
+ */
+template<typename T>
+struct IsDataContainer : std::false_type {};
+
+template<typename T, typename AxisType>
+struct IsDataContainer<DataContainer<T, AxisType>> : std::true_type {};
+
+/**
+ * Checks if a type is an operand of the lazy DataContainer arithmetic.
+ * Operations with at least one lazy operand return an expression instead of a DataContainer.
+ * @tparam T type to be checked
+ */
+template<typename T>
+constexpr bool IsLazyOperand() {
+  return IsContainerExpression<std::decay_t<T>>::value;
+}
+
+/**
+ * Checks if a type can be used as an operand of the DataContainer arithmetic.
+ * @tparam T type to be checked
+ */
+template<typename T>
+constexpr bool IsContainerOperand() {
+  using Decayed = std::decay_t<T>;
+  return IsDataContainer<Decayed>::value || IsContainerExpression<Decayed>::value;
+}
+
+/**
+ * Calculates for every bin of a container with the larger set of axes the linear index of the corresponding bin
+ * in the container with the smaller set of axes. The leading axes of the larger container correspond to the axes
+ * of the smaller container. Bins without corresponding bin are marked with -1.
+ * Matches the broadcasting of DataContainer::Apply.
+ * @tparam AxisType type of the axes
+ * @param smaller axes of the smaller container
+ * @param larger axes of the larger container
+ * @return linear indices in the smaller container
+ */
+template<typename AxisType>
+std::vector<long> BroadcastIndices(const std::vector<AxisType> &smaller, const std::vector<AxisType> &larger) {
+  std::vector<long> stride(smaller.size() + 1, 1);
+  for (auto i = smaller.size(); i > 0; --i) {
+    stride[i - 1] = stride[i]*smaller[i - 1].size();
+  }
+  std::size_t size = 1;
+  for (const auto &axis : larger) size *= axis.size();
+  std::vector<long> indices(size, -1);
+  std::vector<std::size_t> index(larger.size(), 0);
+  for (std::size_t ibin = 0; ibin < size; ++ibin) {
+    long target = 0;
+    bool valid = true;
+    for (std::size_t i = 0; i < smaller.size(); ++i) {
+      if (index[i] < smaller[i].size()) {
+        target += index[i]*stride[i + 1];
+      } else {
+        valid = false;
+      }
+    }
+    if (valid) indices[ibin] = target;
+    for (auto i = static_cast<long>(larger.size()) - 1; i >= 0; --i) {
+      if (++index[i] < larger[i].size()) break;
+      index[i] = 0;
+    }
+  }
+  return indices;
+}
+
+/**
+ * @brief Leaf of an expression referencing a DataContainer.
+ * The referenced DataContainer needs to outlive the expression.
+ */
+template<typename T, typename AxisType>
+class ContainerReference {
+ public:
+  using ValueType = T;
+  using Axis = AxisType;
+  explicit ContainerReference(const DataContainer<T, AxisType> &container) : container_(&container) {}
+  const std::vector<AxisType> &GetAxes() const { return container_->GetAxes(); }
+  std::size_t size() const { return container_->size(); }
+  bool IsIntegrated() const { return container_->IsIntegrated(); }
+  const T &Evaluate(std::size_t ibin) const { return *(container_->begin() + ibin); }
+ private:
+  const DataContainer<T, AxisType> *container_;
+};
+
+/**
+ * @brief Leaf of an expression owning a DataContainer.
+ * Used for temporary DataContainers, which would not outlive the expression.
+ */
+template<typename T, typename AxisType>
+class ContainerValue {
+ public:
+  using ValueType = T;
+  using Axis = AxisType;
+  explicit ContainerValue(DataContainer<T, AxisType> &&container) : container_(std::move(container)) {}
+  const std::vector<AxisType> &GetAxes() const { return container_.GetAxes(); }
+  std::size_t size() const { return container_.size(); }
+  bool IsIntegrated() const { return container_.IsIntegrated(); }
+  const T &Evaluate(std::size_t ibin) const { return *(container_.begin() + ibin); }
+ private:
+  DataContainer<T, AxisType> container_;
+};
+
+/**
+ * @brief Expression node applying a unary operation to each bin of its operand.
+ */
+template<typename Operation, typename Operand>
+class UnaryExpression {
+ public:
+  using ValueType = typename Operand::ValueType;
+  using Axis = typename Operand::Axis;
+  UnaryExpression(Operand operand, Operation operation) :
+      operand_(std::move(operand)), operation_(std::move(operation)) {}
+  const std::vector<Axis> &GetAxes() const { return operand_.GetAxes(); }
+  std::size_t size() const { return operand_.size(); }
+  bool IsIntegrated() const { return operand_.IsIntegrated(); }
+  ValueType Evaluate(std::size_t ibin) const { return operation_(operand_.Evaluate(ibin)); }
+ private:
+  Operand operand_;
+  Operation operation_;
+};
+
+/**
+ * @brief Expression node combining the bins of two operands with a binary operation.
+ * The axes of the result and the broadcasting of the operand with fewer axes follow DataContainer::Apply.
+ * The index mapping of the broadcasted operand is calculated once, when the node is created.
+ */
+template<typename Operation, typename Lhs, typename Rhs>
+class BinaryExpression {
+ public:
+  using ValueType = typename Lhs::ValueType;
+  using Axis = typename Lhs::Axis;
+  static_assert(std::is_same<ValueType, typename Rhs::ValueType>::value, "Operands have different content types.");
+  static_assert(std::is_same<Axis, typename Rhs::Axis>::value, "Operands have different axis types.");
+
+  BinaryExpression(Lhs lhs, Rhs rhs, Operation operation) :
+      lhs_(std::move(lhs)), rhs_(std::move(rhs)), operation_(std::move(operation)) {
+    const auto &lhs_axes = lhs_.GetAxes();
+    const auto &rhs_axes = rhs_.GetAxes();
+    if (lhs_axes.size() > rhs_axes.size()) {
+      for (std::size_t iaxis = 0; iaxis < rhs_axes.size() - 1; ++iaxis) {
+        if (lhs_axes[iaxis].Name()!=rhs_axes[iaxis].Name()) throw std::logic_error("Axes do not match.");
+      }
+      lhs_shape_ = true;
+      rhs_indices_ = BroadcastIndices(rhs_axes, lhs_axes);
+    } else {
+      for (std::size_t iaxis = lhs_axes.size() - 1; iaxis > 0; --iaxis) {
+        if (lhs_axes[iaxis].Name()!=rhs_axes[iaxis].Name()) throw std::logic_error("Axes do not match.");
+      }
+      if (lhs_axes.size()==rhs_axes.size()) {
+        if (lhs_.size() < rhs_.size()) throw std::out_of_range("DataContainers do not have the same size.");
+      } else {
+        lhs_indices_ = BroadcastIndices(lhs_axes, rhs_axes);
+      }
+    }
+  }
+  const std::vector<Axis> &GetAxes() const { return lhs_shape_ ? lhs_.GetAxes() : rhs_.GetAxes(); }
+  std::size_t size() const { return lhs_shape_ ? lhs_.size() : rhs_.size(); }
+  bool IsIntegrated() const { return false; }
+  ValueType Evaluate(std::size_t ibin) const {
+    const long ilhs = lhs_indices_.empty() ? static_cast<long>(ibin) : lhs_indices_[ibin];
+    const long irhs = rhs_indices_.empty() ? static_cast<long>(ibin) : rhs_indices_[ibin];
+    if (ilhs < 0 || irhs < 0) return ValueType();
+    return operation_(lhs_.Evaluate(ilhs), rhs_.Evaluate(irhs));
+  }
+ private:
+  Lhs lhs_;
+  Rhs rhs_;
+  Operation operation_;
+  bool lhs_shape_ = false;        ///< result has the axes of the left operand instead of the right one.
+  std::vector<long> lhs_indices_; ///< indices of the broadcasted left operand. Empty if not broadcasted.
+  std::vector<long> rhs_indices_; ///< indices of the broadcasted right operand. Empty if not broadcasted.
+};
+
+template<typename T, typename AxisType>
+struct IsContainerExpression<ContainerReference<T, AxisType>> : std::true_type {};
+
+template<typename T, typename AxisType>
+struct IsContainerExpression<ContainerValue<T, AxisType>> : std::true_type {};
+
+template<typename Operation, typename Operand>
+struct IsContainerExpression<UnaryExpression<Operation, Operand>> : std::true_type {};
+
+template<typename Operation, typename Lhs, typename Rhs>
+struct IsContainerExpression<BinaryExpression<Operation, Lhs, Rhs>> : std::true_type {};
+
+/**
+ * Wraps an operand into the corresponding expression node.
+ * Named DataContainers are referenced, temporary DataContainers are moved into the expression.
+ */
+template<typename T, typename AxisType>
+ContainerReference<T, AxisType> MakeOperand(const DataContainer<T, AxisType> &container) {
+  return ContainerReference<T, AxisType>(container);
+}
+
+template<typename T, typename AxisType>
+ContainerReference<T, AxisType> MakeOperand(DataContainer<T, AxisType> &container) {
+  return ContainerReference<T, AxisType>(container);
+}
+
+template<typename T, typename AxisType>
+ContainerValue<T, AxisType> MakeOperand(DataContainer<T, AxisType> &&container) {
+  return ContainerValue<T, AxisType>(std::move(container));
+}
+
+template<typename Expression, typename = std::enable_if_t<IsContainerExpression<std::decay_t<Expression>>::value>>
+std::decay_t<Expression> MakeOperand(Expression &&expression) {
+  return std::forward<Expression>(expression);
+}
+
+template<typename Operand>
+using OperandType = decltype(MakeOperand(std::declval<Operand>()));
+
+template<typename Operation, typename Operand>
+UnaryExpression<Operation, OperandType<Operand>> MakeUnaryExpression(Operand &&operand, Operation operation) {
+  return {MakeOperand(std::forward<Operand>(operand)), std::move(operation)};
+}
+
+template<typename Operation, typename Lhs, typename Rhs>
+BinaryExpression<Operation, OperandType<Lhs>, OperandType<Rhs>>
+MakeBinaryExpression(Lhs &&lhs, Rhs &&rhs, Operation operation) {
+  return {MakeOperand(std::forward<Lhs>(lhs)), MakeOperand(std::forward<Rhs>(rhs)), std::move(operation)};
+}
+
+/**
+ * Operations used in the DataContainer arithmetic.
+ */
+struct Addition {
+  template<typename T>
+  T operator()(const T &a, const T &b) const { return a + b; }
+};
+
+struct Subtraction {
+  template<typename T>
+  T operator()(const T &a, const T &b) const { return a - b; }
+};
+
+struct Multiplication {
+  template<typename T>
+  T operator()(const T &a, const T &b) const { return a*b; }
+};
+
+struct Division {
+  template<typename T>
+  T operator()(const T &a, const T &b) const { return a/b; }
+};
+
+struct Scaling {
+  double scale;
+  template<typename T>
+  T operator()(const T &a) const { return a*scale; }
+};
+
+struct SquareRoot {
+  template<typename T>
+  T operator()(const T &a) const { return Sqrt(a); }
+};
+
+struct Root {
+  unsigned int k;
+  template<typename T>
+  T operator()(const T &a) const { return PowSqrt(a, k); }
+};
+
+}
+}
+
+#endif //FLOW_DATACONTAINEREXPRESSION_H
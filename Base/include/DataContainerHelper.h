@@ -36,6 +36,14 @@ class DataContainer;
 
 inline float MergeBins(const float &a, const float &b) { return a + b; }
 
+/**
+ * Merges rhs into lhs. Used for types without a dedicated in-place merge.
+ * @param lhs object, which is updated.
+ * @param rhs object, which is merged.
+ */
+template<typename T>
+inline void MergeInto(T &lhs, const T &rhs) { lhs = Merge(lhs, rhs); }
+
 namespace Internal {
 
 /**
@@ -20,6 +20,7 @@
 #include <vector>
 #include <numeric>
 #include "Math/Interpolator.h"
+#include "QuantileSketch.h"
 namespace Qn {
 class EqualEntriesBinner {
  public:
@@ -59,6 +60,44 @@ class EqualEntriesBinner {
     return bin_edges;
   }
 
+  /**
+   * Calculates the bin edges of equal populated bins from a quantile sketch, which is filled in the event loop
+   * instead of collecting all values.
+   * @param sketch the sketch of the values
+   * @param nbins number of bins
+   * @return the bin edges. The last edge lies slightly above the largest value.
+   */
+  std::vector<double> CalculateBins(const QuantileSketch &sketch, unsigned int nbins) {
+    std::vector<double> bin_edges(nbins + 1);
+    for (unsigned int ibin = 0; ibin < nbins + 1; ++ibin) {
+      bin_edges[ibin] = sketch.Quantile(static_cast<double>(ibin)/nbins);
+    }
+    double epsilon = 1e-5;
+    bin_edges[nbins] = sketch.Max() + epsilon;
+    return bin_edges;
+  }
+
+  /**
+   * Calculates the bin edges of equal populated bins between low and high from a quantile sketch.
+   * @param sketch the sketch of the values
+   * @param nbins number of bins
+   * @param low lower edge of the first bin
+   * @param high upper edge of the last bin
+   * @return the bin edges
+   */
+  std::vector<double> CalculateBins(const QuantileSketch &sketch, unsigned int nbins, double low, double high) {
+    const auto n = static_cast<double>(sketch.N());
+    const auto quantile_low = sketch.Rank(low)/n;
+    const auto quantile_high = sketch.Rank(high)/n;
+    std::vector<double> bin_edges(nbins + 1);
+    for (unsigned int ibin = 0; ibin < nbins + 1; ++ibin) {
+      bin_edges[ibin] = sketch.Quantile(quantile_low + (quantile_high - quantile_low)*ibin/nbins);
+    }
+    bin_edges.front() = low;
+    bin_edges.back() = high;
+    return bin_edges;
+  }
+
  private:
   // Linear interpolation following MATLAB linspace
   std::vector<double> linespace(double start, double ed, int num) {
@@ -0,0 +1,162 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_BASE_INCLUDE_EVENTLOOPCHECKPOINT_H_
+#define FLOW_BASE_INCLUDE_EVENTLOOPCHECKPOINT_H_
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "RtypesCore.h"
+#include "TObject.h"
+
+namespace Qn {
+/**
+ * @class EventLoopCheckpoint
+ * @brief Periodic checkpoints of the partial results of an event loop, from which a preempted job is resumed.
+ * The results are registered by name with a function returning the partial result of a slot, e.g. the result data
+ * container of a correlation or the calibration histograms of the correction manager of the slot. Every slot
+ * writes its partial results together with the entries it has processed to its own file, after a number of entries
+ * or a time interval. The checkpoint is written by the thread processing the slot before the next entry, such that
+ * the partial results are consistent with the processed entries without synchronizing the slots.
+ *
+ * Restore is called before the event loop. It merges the files of the previous job into one file and reads the
+ * merged results and the processed entries. Processed entries are skipped by Next and the merged results are added
+ * to the results at the end of the event loop. The files carry a generation number, which is increased by Restore,
+ * such that a job preempted during Restore does not count the results twice.
+ *
+ * auto checkpoint = std::make_shared<Qn::EventLoopCheckpoint>("job", 100000, 600.);
+ * ... register the results, e.g. with CorrelationHelper::SetCheckpoint
+ * checkpoint->Restore();
+ * auto resumed = checkpoint->SkipCompleted(df);
+ */
+class EventLoopCheckpoint {
+ public:
+  /**
+   * Function returning the partial result of a slot or nullptr, if the slot has no result.
+   */
+  using Snapshot = std::function<TObject *(unsigned int slot)>;
+
+  /**
+   * Constructor
+   * @param prefix prefix of the checkpoint files
+   * @param interval_entries number of entries of a slot between two checkpoints. Disabled if 0.
+   * @param interval_seconds time between two checkpoints of a slot. Disabled if 0.
+   * @param n_slots number of slots. The size of the implicit multithreading pool if 0.
+   */
+  EventLoopCheckpoint(std::string prefix, ULong64_t interval_entries, double interval_seconds = 0.,
+                      unsigned int n_slots = 0);
+
+  /**
+   * Registers a result. To be called before Restore.
+   * @param name name of the result, which needs to be unique
+   * @param snapshot function returning the partial result of a slot
+   */
+  void Register(const std::string &name, Snapshot snapshot);
+
+  /**
+   * Merges the checkpoint of the previous job and reads it. To be called before the event loop, also by the
+   * first job.
+   */
+  void Restore();
+
+  /**
+   * Checks if an entry has been processed by the previous jobs.
+   * @param entry entry
+   * @return true if the entry is completed
+   */
+  bool IsCompleted(ULong64_t entry) const;
+
+  /**
+   * Announces the next entry of a slot. Called by the thread processing the slot before the entry is processed.
+   * Writes the checkpoint of the slot, if the interval has passed.
+   * @param slot slot
+   * @param entry entry
+   * @return false if the entry has been processed by the previous jobs and is skipped
+   */
+  bool Next(unsigned int slot, ULong64_t entry);
+
+  /**
+   * Writes the checkpoint of a slot. Called by the thread processing the slot.
+   * @param slot slot
+   */
+  void Write(unsigned int slot);
+
+  /**
+   * Returns the merged result of the previous jobs.
+   * @param name name of the result
+   * @return the result, which is owned by the checkpoint, or nullptr if there is none
+   */
+  TObject *GetRestored(const std::string &name) const;
+
+  unsigned int GetNumberOfSlots() const { return slots_.size(); }
+
+  /**
+   * Returns the number of entries processed by the previous jobs.
+   */
+  ULong64_t GetNumberOfCompletedEntries() const;
+
+  /**
+   * Removes the checkpoint files. To be called after the results of the complete event loop have been written.
+   */
+  void Clear();
+
+  /**
+   * Skips the completed entries of a data frame and writes the checkpoints in its event loop. The actions booked
+   * on the returned node need to be booked before the event loop starts.
+   * @tparam DATAFRAME RDataFrame or node of it
+   * @param df data frame
+   * @return filtered node
+   */
+  template<typename DATAFRAME>
+  auto SkipCompleted(DATAFRAME &df) {
+    return df.DefineSlot(kColumnName, [this](unsigned int slot, ULong64_t entry) { return Next(slot, entry); },
+                         {"rdfentry_"})
+        .Filter([](bool next) { return next; }, {kColumnName});
+  }
+
+ private:
+  static constexpr auto kColumnName = "checkpoint_next_"; ///< column of the data frame announcing the entries
+
+  /**
+   * State of a slot. Aligned to a cache line, as every slot updates its state for every entry.
+   */
+  struct alignas(64) SlotState {
+    std::vector<Long64_t> ranges; ///< processed entries as [first, last) pairs
+    ULong64_t entries = 0; ///< entries since the last checkpoint
+    std::chrono::steady_clock::time_point last; ///< time of the last checkpoint
+  };
+
+  std::string FileName(unsigned int generation, const std::string &part) const;
+
+  std::string prefix_; ///< prefix of the checkpoint files
+  ULong64_t interval_entries_ = 0; ///< entries of a slot between two checkpoints
+  double interval_seconds_ = 0.; ///< seconds between two checkpoints of a slot
+  bool restored_ = false; ///< true after Restore
+  unsigned int generation_ = 0; ///< generation of the files of this job
+  std::vector<std::pair<std::string, Snapshot>> snapshots_; ///< registered results
+  std::vector<SlotState> slots_; ///< state of each slot
+  std::vector<Long64_t> completed_; ///< sorted [first, last) pairs of the entries of the previous jobs
+  std::map<std::string, std::unique_ptr<TObject>> restored_results_; ///< merged results of the previous jobs
+};
+}
+
+#endif //FLOW_BASE_INCLUDE_EVENTLOOPCHECKPOINT_H_
@@ -0,0 +1,275 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_BASE_INCLUDE_EVENTPIPELINE_H_
+#define FLOW_BASE_INCLUDE_EVENTPIPELINE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BoundedQueue.h"
+
+namespace Qn {
+/**
+ * @class EventPipeline
+ * @brief Processes the events in stages, which run in their own threads and overlap in time.
+ * A fixed number of event records circulates through the stages: the source fills a free record, e.g. by reading and
+ * decompressing the input, and passes it on to the following stages through bounded lock-free queues. After the last
+ * stage the record is reused for the next event. Ordered stages run in a single thread and see the events in the
+ * order of the source, as needed by the CorrectionManager, which processes the events of a run in sequence. Parallel
+ * stages run in several workers, e.g. filling the correlations with one CorrelationStream per worker, and are only
+ * followed by further parallel stages. The latency of the input is hidden behind the computation of the other
+ * stages, as long as enough records are in flight.
+ *
+ * Qn::EventPipeline<Event> pipeline(32);
+ * pipeline.SetSource([&](Event &event) { return reader.Next() && event.Read(reader); })
+ *     .AddOrderedStage("correction", [&](Event &event) { event.Correct(manager); })
+ *     .AddOrderedStage("output", [&](Event &event) { event.Write(tree); })
+ *     .AddParallelStage("correlation", [&](unsigned int worker, Event &event) { event.Correlate(streams[worker]); },
+ *                       n_workers);
+ * pipeline.Run();
+ *
+ * ROOT needs to be thread safe (ROOT::EnableThreadSafety), if several stages use it.
+ * @tparam Event record of an event passed between the stages. Default constructible.
+ */
+template<typename Event>
+class EventPipeline {
+ public:
+  using Source = std::function<bool(Event &)>;
+  using OrderedStage = std::function<void(Event &)>;
+  using ParallelStage = std::function<void(unsigned int worker, Event &)>;
+
+  /**
+   * Processing statistics of a stage.
+   */
+  struct StageStatistics {
+    std::string name; ///< name of the stage
+    unsigned int n_workers = 1; ///< number of workers
+    unsigned long long events = 0; ///< processed events
+    double busy_seconds = 0.; ///< time spent processing the events summed over the workers
+    double waiting_seconds = 0.; ///< time waited for the events of the previous stage summed over the workers
+  };
+
+  /**
+   * Constructor
+   * @param n_records number of event records in flight, which bounds the memory and the queues
+   */
+  explicit EventPipeline(std::size_t n_records = 16) : records_(std::max<std::size_t>(n_records, 1)) {}
+
+  /**
+   * Sets the source of the events.
+   * @param source function filling the next event into a record. Returns false after the last event.
+   */
+  EventPipeline &SetSource(Source source) {
+    source_ = std::move(source);
+    return *this;
+  }
+
+  /**
+   * Adds a stage processing the events in the order of the source in a single thread.
+   * @param name name of the stage
+   * @param stage function processing an event
+   */
+  EventPipeline &AddOrderedStage(std::string name, OrderedStage stage) {
+    if (!stages_.empty() && !stages_.back().ordered) {
+      throw std::logic_error("The ordered stage " + name + " cannot follow a parallel stage.");
+    }
+    stages_.push_back({std::move(name), 1, true,
+                       [stage = std::move(stage)](unsigned int, Event &event) { stage(event); }});
+    return *this;
+  }
+
+  /**
+   * Adds a stage processing the events in several workers. The events are processed in arbitrary order.
+   * @param name name of the stage
+   * @param stage function processing an event, which receives the index of the worker
+   * @param n_workers number of workers
+   */
+  EventPipeline &AddParallelStage(std::string name, ParallelStage stage, unsigned int n_workers) {
+    stages_.push_back({std::move(name), std::max(n_workers, 1u), false, std::move(stage)});
+    return *this;
+  }
+
+  /**
+   * Processes all events of the source. Rethrows the first exception of a stage after all threads have stopped.
+   * @return number of events
+   */
+  unsigned long long Run() {
+    if (!source_) throw std::logic_error("The source of the pipeline is not set.");
+    // queue 0 holds the free records and queue i the records for stage i. Each queue has room for all records and
+    // for the end markers of the workers, such that pushing never waits.
+    const auto n_stages = stages_.size() + 1;
+    std::size_t capacity = records_.size();
+    for (const auto &stage : stages_) capacity = std::max<std::size_t>(capacity, records_.size() + stage.n_workers);
+    queues_.clear();
+    for (std::size_t i = 0; i < n_stages; ++i) queues_.push_back(std::make_unique<BoundedQueue<Event *>>(capacity));
+    for (auto &record : records_) Push(0, &record);
+    statistics_.assign(n_stages, StageStatistics());
+    statistics_[0].name = "source";
+    for (std::size_t i = 1; i < n_stages; ++i) {
+      statistics_[i].name = stages_[i - 1].name;
+      statistics_[i].n_workers = stages_[i - 1].n_workers;
+    }
+    active_ = std::make_unique<std::atomic<unsigned int>[]>(n_stages);
+    for (std::size_t i = 1; i < n_stages; ++i) active_[i] = stages_[i - 1].n_workers;
+    failed_ = false;
+    error_ = nullptr;
+    std::vector<std::thread> threads;
+    std::vector<StageStatistics> worker_statistics;
+    for (std::size_t i = 1; i < n_stages; ++i) {
+      for (unsigned int worker = 0; worker < stages_[i - 1].n_workers; ++worker) worker_statistics.emplace_back();
+    }
+    std::size_t position = 0;
+    for (std::size_t i = 1; i < n_stages; ++i) {
+      for (unsigned int worker = 0; worker < stages_[i - 1].n_workers; ++worker) {
+        threads.emplace_back(&EventPipeline::Work, this, i, worker, &worker_statistics[position++]);
+      }
+    }
+    Read();
+    for (auto &thread : threads) thread.join();
+    position = 0;
+    for (std::size_t i = 1; i < n_stages; ++i) {
+      for (unsigned int worker = 0; worker < stages_[i - 1].n_workers; ++worker) {
+        const auto &statistics = worker_statistics[position++];
+        statistics_[i].events += statistics.events;
+        statistics_[i].busy_seconds += statistics.busy_seconds;
+        statistics_[i].waiting_seconds += statistics.waiting_seconds;
+      }
+    }
+    if (error_) std::rethrow_exception(error_);
+    return statistics_[0].events;
+  }
+
+  /**
+   * Returns the statistics of the source and the stages of the last Run. The stage with the largest busy time per
+   * worker limits the throughput.
+   */
+  const std::vector<StageStatistics> &GetStatistics() const { return statistics_; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * Thrown in the waiting threads, if another thread failed.
+   */
+  struct Abort {};
+
+  struct Stage {
+    std::string name; ///< name of the stage
+    unsigned int n_workers; ///< number of workers
+    bool ordered; ///< the events are processed in the order of the source
+    ParallelStage function; ///< processing of an event
+  };
+
+  void Push(std::size_t queue, Event *event) {
+    while (!queues_[queue]->TryPush(std::move(event))) std::this_thread::yield();
+  }
+
+  /**
+   * Waits for the next record of a queue. Spins shortly before yielding, as the next event is usually available.
+   */
+  Event *Pop(std::size_t queue) {
+    Event *event = nullptr;
+    for (unsigned int spin = 0; !queues_[queue]->TryPop(event); ++spin) {
+      if (failed_.load(std::memory_order_relaxed)) throw Abort();
+      if (spin > 64) std::this_thread::yield();
+    }
+    return event;
+  }
+
+  void Fail() {
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    if (!error_) error_ = std::current_exception();
+    failed_ = true;
+  }
+
+  /**
+   * Marks the end of the events for the workers of the next stage.
+   */
+  void Finish(std::size_t stage) {
+    if (stage + 1 >= queues_.size()) return;
+    for (unsigned int worker = 0; worker < stages_[stage].n_workers; ++worker) Push(stage + 1, nullptr);
+  }
+
+  void Read() {
+    auto &statistics = statistics_[0];
+    try {
+      while (true) {
+        const auto start = Clock::now();
+        auto event = Pop(0);
+        const auto popped = Clock::now();
+        const bool next = source_(*event);
+        statistics.waiting_seconds += std::chrono::duration<double>(popped - start).count();
+        statistics.busy_seconds += std::chrono::duration<double>(Clock::now() - popped).count();
+        if (!next) {
+          Push(0, event);
+          break;
+        }
+        ++statistics.events;
+        Push(1 % queues_.size(), event);
+      }
+    } catch (const Abort &) {
+    } catch (...) {
+      Fail();
+    }
+    Finish(0);
+  }
+
+  void Work(std::size_t stage, unsigned int worker, StageStatistics *statistics) {
+    const auto output = (stage + 1)%queues_.size();
+    auto &function = stages_[stage - 1].function;
+    try {
+      while (true) {
+        const auto start = Clock::now();
+        auto event = Pop(stage);
+        if (!event) break;
+        const auto popped = Clock::now();
+        function(worker, *event);
+        statistics->waiting_seconds += std::chrono::duration<double>(popped - start).count();
+        statistics->busy_seconds += std::chrono::duration<double>(Clock::now() - popped).count();
+        ++statistics->events;
+        Push(output, event);
+      }
+    } catch (const Abort &) {
+    } catch (...) {
+      Fail();
+    }
+    if (--active_[stage]==0) Finish(stage);
+  }
+
+  std::vector<Event> records_; ///< event records in flight
+  Source source_; ///< source of the events
+  std::vector<Stage> stages_; ///< stages after the source
+  std::vector<std::unique_ptr<BoundedQueue<Event *>>> queues_; ///< free records and inputs of the stages
+  std::unique_ptr<std::atomic<unsigned int>[]> active_; ///< running workers of each stage
+  std::vector<StageStatistics> statistics_; ///< statistics of the last run
+  std::atomic<bool> failed_{false}; ///< a stage failed and the pipeline is stopped
+  std::mutex error_mutex_; ///< guards the first exception
+  std::exception_ptr error_; ///< first exception of a stage
+};
+}
+
+#endif //FLOW_BASE_INCLUDE_EVENTPIPELINE_H_
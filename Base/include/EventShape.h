@@ -18,7 +18,9 @@
 #ifndef FLOW_EVENTSHAPE_H
 #define FLOW_EVENTSHAPE_H
 
+#include <algorithm>
 #include <iostream>
+#include <vector>
 
 #include "TH1F.h"
 #include "TSpline.h"
@@ -81,11 +83,21 @@ class EventShape : public TObject {
   std::string Name() const { return name_; }
 
   /**
-   * Gets the percentile of the given q vector magnitude
+   * Gets the percentile of the given q vector magnitude. The percentile is interpolated linearly in the table of the
+   * spline, which is sampled uniformly by FitWithSpline, such that the lookup is allocation free and does not
+   * search the knots of the spline. Values outside of the range of the histogram give the percentile of the first
+   * or the last edge. The spline is evaluated for event shapes written without the table.
    * @param q magnitude of the q vector.
    * @return percentile of the current event.
    */
-  inline float GetPercentile(float q) { return static_cast<float>(spline_->Eval(q)); }
+  inline float GetPercentile(float q) const {
+    if (table_.empty()) return static_cast<float>(spline_->Eval(q));
+    const auto position = std::min(std::max((q - table_lower_)*table_inverse_step_, 0.f),
+                                   static_cast<float>(table_.size() - 1));
+    const auto index = std::min(static_cast<std::size_t>(position), table_.size() - 2);
+    const auto fraction = position - static_cast<float>(index);
+    return table_[index] + fraction*(table_[index + 1] - table_[index]);
+  }
 
   /**
    * Calculate the integrated histogram of the distribution.
@@ -93,12 +105,21 @@ class EventShape : public TObject {
   void IntegrateHist();
 
   /**
-   * Fit the histogram with a spline to calculate the percentiles.
+   * Fit the histogram with a spline to calculate the percentiles and sample the spline in the lookup table used by
+   * GetPercentile.
    */
   void FitWithSpline();
 
   /**
-   * Fill the current subevent information to the histogram.
+   * Adds the distribution of another event shape with the same binning, e.g. the one filled in another slot. The
+   * histograms are added in place. Call FitWithSpline after all slots have been added.
+   * @param other the other event shape
+   */
+  void Add(const EventShape &other) { histo_->Add(other.histo_); }
+
+  /**
+   * Fill the current subevent information to the histogram. The histogram is not shared between threads. Each slot
+   * fills its own event shape, which are combined with Add at the end.
    * @param product
    */
   void Fill(const CorrelationResult &product) { if (product.validity) histo_->Fill(product.result); }
@@ -112,26 +133,33 @@ class EventShape : public TObject {
   friend Qn::EventShape operator+(const Qn::EventShape &a, const Qn::EventShape &b);
   friend Qn::EventShape Merge(const Qn::EventShape &a, const Qn::EventShape &b);
 
+  static constexpr std::size_t kTableSize = 4096; ///< number of points of the lookup table
+
   std::string name_;
   TSpline3 *spline_ = nullptr;
   TH1F *histo_ = nullptr;
   TH1F *integral_ = nullptr;
+  std::vector<float> table_; ///< percentiles at uniformly spaced magnitudes
+  float table_lower_ = 0.; ///< magnitude of the first point of the table
+  float table_inverse_step_ = 0.; ///< inverse distance of the points of the table
 
   /// \cond CLASSIMP
- ClassDef(EventShape, 5);
+ ClassDef(EventShape, 6);
   /// \endcond
 };
 
 inline Qn::EventShape operator+(const Qn::EventShape &a, const Qn::EventShape &b) {
   Qn::EventShape c(a.name_, *a.histo_);
-  c.histo_->Add(b.histo_);
+  c.Add(a);
+  c.Add(b);
   c.FitWithSpline();
   return c;
 }
 
 inline Qn::EventShape Merge(const Qn::EventShape &a, const Qn::EventShape &b) {
   Qn::EventShape c(a.name_, *a.histo_);
-  c.histo_->Add(b.histo_);
+  c.Add(a);
+  c.Add(b);
   c.FitWithSpline();
   return c;
 }
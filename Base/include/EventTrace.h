@@ -0,0 +1,159 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_BASE_INCLUDE_EVENTTRACE_H_
+#define FLOW_BASE_INCLUDE_EVENTTRACE_H_
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Qn {
+/**
+ * @class EventTrace
+ * @brief Timeline of the stages of the event processing, e.g. the corrections of a detector or the filling of a
+ * correlation, for the inspection of stalls and of the load of the threads. Each thread records the begin and the
+ * end of its stages into its own ring buffer, which keeps the latest spans, such that the threads do not
+ * synchronize while recording. The stages of only one event in N are recorded. Stages outside of the events, e.g.
+ * the run switch, are recorded by their producers independent of the sampling.
+ * The timeline is written in the JSON trace event format, which is opened with Perfetto or chrome://tracing.
+ *
+ * auto trace = std::make_shared<Qn::EventTrace>(100);
+ * manager.SetTrace(trace);
+ * ... event loop
+ * trace->Write("trace.json");
+ */
+class EventTrace {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @class Scope
+   * @brief Records the time until the end of the scope as a span. Does nothing without a trace.
+   */
+  class Scope {
+   public:
+    /**
+     * Constructor. Starts the span.
+     * @param trace non-owning pointer to the trace. The span is not recorded if nullptr.
+     * @param name id of the name of the span
+     */
+    Scope(EventTrace *trace, std::size_t name) : trace_(trace), name_(name) {
+      if (trace_) begin_ = Clock::now();
+    }
+    ~Scope() {
+      if (trace_) trace_->Record(name_, begin_, Clock::now());
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+   private:
+    EventTrace *trace_; ///< trace. nullptr if disabled.
+    std::size_t name_; ///< id of the name
+    Clock::time_point begin_; ///< begin of the span
+  };
+
+  /**
+   * Constructor
+   * @param sampling the stages of every sampling-th event are recorded
+   * @param capacity number of spans kept for each thread
+   */
+  explicit EventTrace(unsigned int sampling = 1, std::size_t capacity = std::size_t{1} << 16);
+
+  EventTrace(const EventTrace &) = delete;
+  EventTrace &operator=(const EventTrace &) = delete;
+
+  /**
+   * Adds the name of a stage. Names are only added once. Thread safe.
+   * @param name name of the stage
+   * @return id of the name
+   */
+  std::size_t AddName(const std::string &name);
+
+  /**
+   * Checks if the stages of an event are recorded.
+   * @param event number of the event counted by the producer
+   */
+  bool IsSampled(unsigned long long event) const { return event%sampling_==0; }
+
+  /**
+   * Records a span in the buffer of the calling thread. The oldest span of the thread is overwritten, if the
+   * buffer is full.
+   * @param name id of the name of the stage
+   * @param begin begin of the stage
+   * @param end end of the stage
+   */
+  void Record(std::size_t name, Clock::time_point begin, Clock::time_point end) {
+    auto &buffer = GetBuffer();
+    buffer.spans[buffer.n%capacity_] = Span{name, begin, end};
+    ++buffer.n;
+  }
+
+  /**
+   * Returns the number of recorded spans, which are still kept in the buffers. To be called after the threads
+   * finished recording.
+   */
+  std::size_t GetNumberOfSpans() const;
+
+  /**
+   * Writes the spans of all threads in the JSON trace event format. The timestamps are in microseconds since the
+   * construction of the trace. To be called after the threads finished recording.
+   * @param stream the output stream
+   */
+  void Write(std::ostream &stream) const;
+
+  /**
+   * Writes the spans of all threads to a file in the JSON trace event format.
+   * @param file_name name of the file
+   */
+  void Write(const std::string &file_name) const;
+
+ private:
+  struct Span {
+    std::size_t name; ///< id of the name
+    Clock::time_point begin; ///< begin of the span
+    Clock::time_point end; ///< end of the span
+  };
+
+  struct ThreadBuffer {
+    std::thread::id thread; ///< the recording thread
+    std::vector<Span> spans; ///< ring of the latest spans
+    unsigned long long n = 0; ///< number of recorded spans
+  };
+
+  /**
+   * Returns the buffer of the calling thread. The buffer is looked up once per thread and cached.
+   */
+  ThreadBuffer &GetBuffer();
+
+  unsigned int sampling_; ///< the stages of every sampling-th event are recorded
+  std::size_t capacity_; ///< number of spans kept for each thread
+  std::uint64_t serial_; ///< unique number of the trace identifying the cached buffers of the threads
+  Clock::time_point epoch_; ///< construction of the trace
+  mutable std::mutex mutex_; ///< guards the names and the list of buffers
+  std::vector<std::string> names_; ///< names of the stages
+  std::map<std::string, std::size_t> ids_; ///< ids of the names
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_; ///< buffers of the threads
+};
+}
+
+#endif //FLOW_BASE_INCLUDE_EVENTTRACE_H_
@@ -0,0 +1,280 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_FLATQVECTORS_H
+#define FLOW_FLATQVECTORS_H
+
+#include <bitset>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "TTree.h"
+#include "TBranch.h"
+
+#include "QVector.h"
+#include "DataContainer.h"
+
+namespace Qn {
+/**
+ * @class FlatQVectors
+ * @brief Flat layout of the Q-vectors of all bins of a DataContainerQVector in the output tree.
+ * Each field is written as a fixed size array to its own branch "<name>_<field>": the components x and y of each
+ * bin and harmonic ordered by bin, the number of contributors n, the sum of weights sumw and the quality bitmask
+ * of each bin. The axes, the harmonics and the normalization are the same in all events and are read from the
+ * output layout of the Q-vectors.
+ * With a compact encoding the components are stored with reduced precision, either as floats with a truncated
+ * mantissa in x and y or as 16 bit fixed-point numbers in xfix and yfix, and the quality bitmasks of all bins are
+ * packed into qualitybits instead of quality. The encoding is written to the output layout.
+ */
+class FlatQVectors {
+ public:
+  /**
+   * Bits of the quality bitmask.
+   */
+  enum Quality : unsigned char {
+    kGood = 1u << 0u, ///< the Q-vector can be used in the further processing steps
+    kSaturated = 1u << 1u ///< a component exceeds the range of the fixed-point encoding and is clamped
+  };
+  static constexpr unsigned int kQualityBits = 2; ///< bits of the quality bitmask of a bin in the packed quality
+  static constexpr int kFixedPointMax = 32767; ///< largest magnitude of a fixed-point component
+
+  /**
+   * @brief Encoding of the components of the Q-vectors.
+   */
+  struct Encoding {
+    enum class Method : unsigned char {
+      kFloat, ///< full single precision
+      kTruncated, ///< floats rounded to mantissa_bits bits of the mantissa
+      kFixedPoint ///< 16 bit integers in units of range/kFixedPointMax
+    };
+    Method method = Method::kFloat; ///< encoding method
+    unsigned int mantissa_bits = 23; ///< kept bits of the mantissa of the truncated floats
+    float range = 0.; ///< largest magnitude of the fixed-point components
+
+    /**
+     * Floats with a truncated mantissa. The components keep their dynamic range and have a relative error of at most
+     * 2^-(mantissa_bits + 1). The zeroed bits are removed by the compression of the file.
+     * @param mantissa_bits kept bits of the mantissa from 1 to 23
+     */
+    static Encoding Truncated(unsigned int mantissa_bits);
+
+    /**
+     * Fixed-point numbers of 16 bits. The components in [-range, range] have an absolute error of at most
+     * range/(2*kFixedPointMax). Larger components are clamped and flag the Q-vector as kSaturated.
+     * @param range largest magnitude of the components, e.g. 1 for normalized Q-vectors
+     */
+    static Encoding FixedPoint(float range);
+
+    /**
+     * Reads an encoding written with ToString.
+     * @param description description of the encoding. Full precision if empty.
+     */
+    static Encoding FromString(const std::string &description);
+    std::string ToString() const;
+
+    bool IsCompact() const { return method!=Method::kFloat; }
+
+    /**
+     * Returns the bound of the error of the components with respect to the Q-vectors in double precision. Relative
+     * for floats and absolute for fixed-point numbers within the range.
+     */
+    double GetErrorBound() const;
+
+    /**
+     * Returns the value of the unit of the fixed-point numbers.
+     */
+    float GetStep() const { return range/kFixedPointMax; }
+  };
+
+  FlatQVectors() = default;
+
+  /**
+   * Constructor
+   * @param layout Q-vectors defining the number of bins and harmonics
+   */
+  explicit FlatQVectors(const DataContainerQVector &layout);
+
+  /**
+   * Constructor
+   * @param layout Q-vectors defining the number of bins and harmonics
+   * @param encoding encoding of the components
+   */
+  FlatQVectors(const DataContainerQVector &layout, Encoding encoding);
+
+  /**
+   * Copies the Q-vectors into the flat arrays.
+   * @param q_vectors Q-vectors with the layout of the constructor
+   */
+  void Set(const DataContainerQVector &q_vectors);
+
+  /**
+   * Copies the flat arrays of the other Q-vectors without reallocating the arrays, which are referred to by the
+   * branches.
+   * @param other flat Q-vectors with the same layout
+   */
+  void Set(const FlatQVectors &other);
+
+  /**
+   * Creates the branches of the flat arrays.
+   * @param tree output tree
+   * @param name name of the Q-vectors. Used as prefix of the branches.
+   * @param basket_size size of the baskets of the branches
+   * @return the created branches
+   */
+  std::vector<TBranch *> Branch(TTree *tree, const std::string &name, int basket_size) const;
+
+  std::size_t GetNumberOfBins() const { return n_bins_; }
+  std::size_t GetNumberOfHarmonics() const { return n_harmonics_; }
+  const Encoding &GetEncoding() const { return encoding_; }
+  const std::vector<float> &GetX() const { return x_; }
+  const std::vector<float> &GetY() const { return y_; }
+  const std::vector<std::int16_t> &GetXFixed() const { return x_fixed_; }
+  const std::vector<std::int16_t> &GetYFixed() const { return y_fixed_; }
+  const std::vector<int> &GetN() const { return n_; }
+  const std::vector<float> &GetSumW() const { return sumw_; }
+  const std::vector<unsigned char> &GetQuality() const { return quality_; }
+  const std::vector<unsigned char> &GetQualityBits() const { return quality_bits_; }
+
+  /**
+   * Rounds a float to the nearest float with a truncated mantissa.
+   * @param value the value
+   * @param mantissa_bits kept bits of the mantissa
+   * @return the rounded value
+   */
+  static float Truncate(float value, unsigned int mantissa_bits) {
+    const unsigned int dropped = 23 - mantissa_bits;
+    if (dropped==0) return value;
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    bits = (bits + (1u << (dropped - 1)))&~((1u << dropped) - 1);
+    std::memcpy(&value, &bits, sizeof(bits));
+    return value;
+  }
+
+  /**
+   * Decodes fixed-point components.
+   * @param fixed fixed-point components
+   * @param n number of components
+   * @param step value of the unit of the fixed-point numbers
+   * @param values the decoded components
+   */
+  static void Decode(const std::int16_t *fixed, std::size_t n, float step, float *values) {
+    for (std::size_t i = 0; i < n; ++i) values[i] = fixed[i]*step;
+  }
+
+  /**
+   * Unpacks the quality bitmasks of the bins.
+   * @param bits packed quality bitmasks with kQualityBits bits per bin
+   * @param n_bins number of bins
+   * @param quality the quality bitmask of each bin
+   */
+  static void UnpackQuality(const unsigned char *bits, std::size_t n_bins, unsigned char *quality) {
+    constexpr unsigned int kPerByte = 8/kQualityBits;
+    for (std::size_t i = 0; i < n_bins; ++i) {
+      quality[i] = (bits[i/kPerByte] >> (kQualityBits*(i%kPerByte)))&((1u << kQualityBits) - 1);
+    }
+  }
+
+  /**
+   * Returns the number of bytes of the packed quality bitmasks.
+   * @param n_bins number of bins
+   */
+  static std::size_t QualityBytes(std::size_t n_bins) { return (n_bins*kQualityBits + 7)/8; }
+
+  /**
+   * Restores the Q-vectors from the flat arrays of one event.
+   * @param x x-components of all bins and harmonics
+   * @param y y-components of all bins and harmonics
+   * @param n number of contributors of all bins
+   * @param sumw sum of weights of all bins
+   * @param quality quality bitmask of all bins
+   * @param q_vectors Q-vectors with the layout of the written ones, which are overwritten.
+   */
+  static void Unpack(const float *x, const float *y, const int *n, const float *sumw, const unsigned char *quality,
+                     DataContainerQVector &q_vectors);
+
+ private:
+  std::int16_t ToFixed(double value, unsigned char &quality) const;
+  void PackQuality();
+
+  std::size_t n_bins_ = 0; ///< number of bins
+  std::size_t n_harmonics_ = 0; ///< number of harmonics of each bin
+  Encoding encoding_; ///< encoding of the components
+  std::vector<float> x_; ///< x-components of all bins and harmonics
+  std::vector<float> y_; ///< y-components of all bins and harmonics
+  std::vector<std::int16_t> x_fixed_; ///< fixed-point x-components of all bins and harmonics
+  std::vector<std::int16_t> y_fixed_; ///< fixed-point y-components of all bins and harmonics
+  std::vector<int> n_; ///< number of contributors of all bins
+  std::vector<float> sumw_; ///< sum of weights of all bins
+  std::vector<unsigned char> quality_; ///< quality bitmask of all bins
+  std::vector<unsigned char> quality_bits_; ///< packed quality bitmasks of all bins
+};
+
+/**
+ * @class FlatQVectorView
+ * @brief Read-only view of the Q-vector of one bin in the flat arrays, e.g. in the buffers of a TTreeReaderArray.
+ * The harmonics are resolved at runtime from the set of harmonics of the layout.
+ */
+class FlatQVectorView {
+ public:
+  /**
+   * Constructor
+   * @param x pointer to the x-components of the bin
+   * @param y pointer to the y-components of the bin
+   * @param n number of contributors
+   * @param sumw sum of weights
+   * @param quality quality bitmask
+   * @param harmonics set of harmonics of the layout
+   */
+  FlatQVectorView(const float *x, const float *y, int n, float sumw, unsigned char quality,
+                  std::bitset<QVector::kmaxharmonics> harmonics) :
+      x_(x), y_(y), n_(n), sumw_(sumw), quality_(quality), harmonics_(harmonics) {}
+
+  /**
+   * Returns x-component of Q-vector of the harmonic h.
+   * @param h harmonic. Needs to be part of the layout.
+   * @return x-component
+   */
+  float x(const unsigned int h) const { return x_[Position(h)]; }
+
+  /**
+   * Returns y-component of Q-vector of the harmonic h.
+   * @param h harmonic. Needs to be part of the layout.
+   * @return y-component
+   */
+  float y(const unsigned int h) const { return y_[Position(h)]; }
+
+  float sumweights() const { return sumw_; }
+  float n() const { return n_; }
+  bool IsGoodQuality() const { return quality_ & FlatQVectors::kGood; }
+
+ private:
+  std::size_t Position(const unsigned int h) const {
+    return QVector::kHarmonicSlotTable[harmonics_.to_ulong()][h - 1];
+  }
+
+  const float *x_ = nullptr; ///< x-components of the bin
+  const float *y_ = nullptr; ///< y-components of the bin
+  int n_ = 0; ///< number of contributors
+  float sumw_ = 0.; ///< sum of weights
+  unsigned char quality_ = 0; ///< quality bitmask
+  std::bitset<QVector::kmaxharmonics> harmonics_; ///< set of harmonics of the layout
+};
+}
+
+#endif //FLOW_FLATQVECTORS_H
@@ -0,0 +1,138 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_OUTPUTLAYOUT_H
+#define FLOW_OUTPUTLAYOUT_H
+
+#include <stdexcept>
+#include <string>
+
+#include "TDirectory.h"
+#include "TList.h"
+#include "TNamed.h"
+#include "TTree.h"
+
+namespace Qn {
+/**
+ * The layouts of the output data containers are copies of the containers without content. They describe the axes
+ * and the harmonics of the outputs, which are the same in all events. The correction manager writes them once to
+ * the user info of the output tree or next to the RNTuple, such that the correlations are configured from the
+ * layouts without reading events. Each layout is stored as a list with the name of the output holding the copy.
+ */
+
+/**
+ * Name of the list of the layouts of a RNTuple in its file.
+ * @param ntuple_name name of the RNTuple
+ */
+inline std::string OutputLayoutsName(const std::string &ntuple_name) { return ntuple_name + "_layouts"; }
+
+/**
+ * Adds the layout of an output to a list of layouts, e.g. the user info of the tree, if it is not already present.
+ * @tparam Container type of the data container
+ * @param layouts list of layouts
+ * @param name name of the output
+ * @param container the output
+ */
+template<typename Container>
+void WriteOutputLayout(TList *layouts, const std::string &name, const Container &container) {
+  if (layouts->FindObject(name.data())) return;
+  auto entry = new TList();
+  entry->SetName(name.data());
+  entry->SetOwner(true);
+  auto layout = new Container(container);
+  for (auto &bin : *layout) bin.Reset();
+  entry->Add(layout);
+  layouts->Add(entry);
+}
+
+/**
+ * Adds the description of the encoding of an output to its layout, which needs to be added before.
+ * @param layouts list of layouts
+ * @param name name of the output
+ * @param encoding description of the encoding
+ */
+inline void WriteOutputEncoding(TList *layouts, const std::string &name, const std::string &encoding) {
+  auto entry = dynamic_cast<TList *>(layouts->FindObject(name.data()));
+  if (!entry) throw std::logic_error("The layout of the output " + name + " is not written.");
+  if (!entry->FindObject("encoding")) entry->Add(new TNamed("encoding", encoding.data()));
+}
+
+/**
+ * Reads the description of the encoding of an output from a list of layouts.
+ * @param layouts list of layouts. May be nullptr.
+ * @param name name of the output
+ * @return the description. Empty if the output has no encoding.
+ */
+inline std::string ReadOutputEncoding(const TList *layouts, const std::string &name) {
+  auto entry = layouts ? dynamic_cast<TList *>(layouts->FindObject(name.data())) : nullptr;
+  auto encoding = entry ? entry->FindObject("encoding") : nullptr;
+  return encoding ? encoding->GetTitle() : "";
+}
+
+/**
+ * Finds the layout of an output in a list of layouts.
+ * @tparam Container type of the data container
+ * @param layouts list of layouts. May be nullptr.
+ * @param name name of the output
+ * @return the layout. nullptr if it is not found or has a different type.
+ */
+template<typename Container>
+const Container *FindOutputLayout(const TList *layouts, const std::string &name) {
+  auto entry = layouts ? dynamic_cast<TList *>(layouts->FindObject(name.data())) : nullptr;
+  return entry ? dynamic_cast<const Container *>(entry->First()) : nullptr;
+}
+
+/**
+ * Reads the layout of an output from a list of layouts.
+ * @tparam Container type of the data container
+ * @param layouts list of layouts. May be nullptr.
+ * @param name name of the output
+ * @return copy of the layout
+ */
+template<typename Container>
+Container ReadOutputLayout(const TList *layouts, const std::string &name) {
+  auto layout = FindOutputLayout<Container>(layouts, name);
+  if (!layout) throw std::runtime_error("The layout of the output " + name + " is not found.");
+  return *layout;
+}
+
+/**
+ * Reads the layout of an output from the user info of a tree.
+ * @tparam Container type of the data container
+ * @param tree the tree. The tree of a file, not a chain.
+ * @param name name of the output
+ * @return copy of the layout
+ */
+template<typename Container>
+Container ReadOutputLayout(TTree *tree, const std::string &name) {
+  return ReadOutputLayout<Container>(tree->GetUserInfo(), name);
+}
+
+/**
+ * Reads the layout of an output of a RNTuple from its file.
+ * @tparam Container type of the data container
+ * @param file file of the RNTuple
+ * @param ntuple_name name of the RNTuple
+ * @param name name of the output
+ * @return copy of the layout
+ */
+template<typename Container>
+Container ReadOutputLayout(TDirectory *file, const std::string &ntuple_name, const std::string &name) {
+  return ReadOutputLayout<Container>(dynamic_cast<TList *>(file->Get(OutputLayoutsName(ntuple_name).data())), name);
+}
+}
+
+#endif //FLOW_OUTPUTLAYOUT_H
@@ -22,9 +22,12 @@
 #include <bitset>
 #include <cmath>
 #include <stdexcept>      // std::out_of_range
+#include <type_traits>
 
 #include "Rtypes.h"
 
+#include "SinCos.h"
+
 namespace Qn {
 /**
  * Struct of a Q-vector of a single harmonic with x and y component
@@ -71,6 +74,27 @@ inline QVec operator*(const QVec a, const float s) { return {a.x*s, a.y*s}; }
  */
 inline float norm(QVec a) { return std::sqrt(a.x*a.x + a.y*a.y); }
 
+namespace Details {
+/**
+ * Creates the lookup table of the storage position of a harmonic for every possible set of activated harmonics.
+ * The position of harmonic h for the set of harmonics bits is given by table[bits][h-1].
+ * @tparam N maximum number of harmonics
+ * @return lookup table
+ */
+template<std::size_t N>
+constexpr std::array<std::array<unsigned char, N>, (1UL << N)> MakeHarmonicSlotTable() {
+  std::array<std::array<unsigned char, N>, (1UL << N)> table{};
+  for (std::size_t bits = 0; bits < (1UL << N); ++bits) {
+    unsigned char position = 0;
+    for (std::size_t h = 0; h < N; ++h) {
+      table[bits][h] = position;
+      if (bits & (1UL << h)) ++position;
+    }
+  }
+  return table;
+}
+}
+
 /**
  * @class QVector
  * @brief It carries the information of multiple harmonics of a specified normalization and correction step.
@@ -80,6 +104,11 @@ class QVector {
   static constexpr int kmaxharmonics = 8;
   static constexpr float kminimumweight = 1e-6;
   static constexpr float kPi = 3.14159265358979323846;
+  /**
+   * Lookup table of the storage position of the harmonics for all combinations of activated harmonics.
+   */
+  static constexpr std::array<std::array<unsigned char, kmaxharmonics>, (1UL << kmaxharmonics)>
+      kHarmonicSlotTable = Details::MakeHarmonicSlotTable<kmaxharmonics>();
   /**
    * @enum available correction steps in the order of application
    */
@@ -104,7 +133,7 @@ class QVector {
 
   QVector() = default;
 
-  virtual ~QVector() = default;
+  ~QVector() = default;
 
   /**
    * Constructor
@@ -114,7 +143,6 @@ class QVector {
   QVector(std::bitset<kmaxharmonics> bits, CorrectionStep step) :
       correction_step_(step),
       bits_(bits) {
-    q_.resize(bits.count());
     maximum_harmonic_ = highestharmonic();
   }
 
@@ -128,7 +156,6 @@ class QVector {
       norm_(norm),
       correction_step_(step),
       bits_(bits) {
-    q_.resize(bits.count());
     maximum_harmonic_ = highestharmonic();
   }
 
@@ -144,7 +171,6 @@ class QVector {
    */
   void CopyHarmonics(const QVector &other) {
     this->bits_ = other.bits_;
-    this->q_.resize(other.q_.size());
   }
 
   /**
@@ -154,6 +180,7 @@ class QVector {
     n_ = 0;
     sum_weights_ = 0.;
     quality_ = false;
+    q_.fill(QVec());
   }
 
   /**
@@ -219,7 +246,6 @@ class QVector {
    */
   void ActivateHarmonic(const unsigned int i) {
     bits_.set(i - 1);
-    q_.resize(static_cast<size_t>(bits_.count()));
   }
 
   /**
@@ -242,7 +268,7 @@ class QVector {
    */
   inline float x(const unsigned int i) const {
     if (bits_.test(i - 1)) {
-      auto position = std::bitset<kmaxharmonics>(bits_ & std::bitset<kmaxharmonics>((1UL << (i)) - 1)).count() - 1;
+      auto position = kHarmonicSlotTable[bits_.to_ulong()][i - 1];
       return q_[position].x;
     } else {
       throw std::out_of_range("harmonic not in range.");
@@ -256,20 +282,49 @@ class QVector {
    */
   inline float y(const unsigned int i) const {
     if (bits_.test(i - 1)) {
-      auto position = std::bitset<kmaxharmonics>(bits_ & std::bitset<kmaxharmonics>((1UL << (i)) - 1)).count() - 1;
+      auto position = kHarmonicSlotTable[bits_.to_ulong()][i - 1];
       return q_[position].y;
     } else {
       throw std::out_of_range("harmonic not in range.");
     }
   }
 
+  /**
+   * Returns the Q-vector stored at the given position without checking the activated harmonics.
+   * Used by views, which resolve the storage position of the harmonics at compile time.
+   * @param position storage position of the harmonic
+   * @return Q-vector of a single harmonic
+   */
+  inline const QVec &GetComponent(const std::size_t position) const { return q_[position]; }
+
+  /**
+   * Sets the Q-vector stored at the given position without checking the activated harmonics.
+   * Used to restore Q-vectors from the flat output layout.
+   * @param position storage position of the harmonic
+   * @param q Q-vector of a single harmonic
+   */
+  inline void SetComponent(const std::size_t position, const QVec q) { q_[position] = q; }
+
+  /**
+   * Sets the number of contributors, the sum of weights and the quality.
+   * Used to restore Q-vectors from the flat output layout.
+   * @param n number of data vectors
+   * @param sum_weights sum of weights
+   * @param quality quality of the Q-vector
+   */
+  void SetNumberOfContributors(const int n, const float sum_weights, const bool quality) {
+    n_ = n;
+    sum_weights_ = sum_weights;
+    quality_ = quality;
+  }
+
   /**
    * Sets the x-component of the Q-vector of the i-th harmonic.
    * @param i harmonic i of the Q-vector
    * @param x new x component.
    */
   inline void SetX(const unsigned int i, double x) {
-    auto position = std::bitset<kmaxharmonics>(bits_ & std::bitset<kmaxharmonics>((1UL << (i)) - 1)).count() - 1;
+    auto position = kHarmonicSlotTable[bits_.to_ulong()][i - 1];
     q_[position].x = x;
   }
 
@@ -279,7 +334,7 @@ class QVector {
    * @param y new y component.
    */
   inline void SetY(const unsigned int i, double y) {
-    auto position = std::bitset<kmaxharmonics>(bits_ & std::bitset<kmaxharmonics>((1UL << (i)) - 1)).count() - 1;
+    auto position = kHarmonicSlotTable[bits_.to_ulong()][i - 1];
     q_[position].y = y;
   }
 
@@ -357,10 +412,30 @@ class QVector {
    */
   friend QVector operator+(QVector a, QVector b);
 
+  /**
+   * Returns a copy of the Q-vector with the given normalization.
+   * @param norm normalization method
+   * @return normalized Q-vector
+   */
   QVector Normal(const Normalization norm) const;
 
+  /**
+   * Returns a copy of the Q-vector without normalization.
+   * @return unnormalized Q-vector
+   */
   QVector DeNormal() const;
 
+  /**
+   * Normalizes the Q-vector in place. Avoids the copy of Normal.
+   * @param norm normalization method
+   */
+  void Normalize(Normalization norm);
+
+  /**
+   * Removes the normalization of the Q-vector in place. Avoids the copy of DeNormal.
+   */
+  void Denormalize();
+
   /**
    * Adds a new data vector to the qvector.
    * @param phi angle of the particle or channel.
@@ -368,14 +443,7 @@ class QVector {
    */
   inline void Add(const double phi, const double weight) {
     if (weight < kminimumweight) return;
-    unsigned int pos = 0;
-    for (unsigned int h = 1; h <= maximum_harmonic_; ++h) {
-      if (bits_.test(h - 1)) {
-        q_[pos].x += (weight*std::cos(h*harmonic_multiplier_*phi));
-        q_[pos].y += (weight*std::sin(h*harmonic_multiplier_*phi));
-        ++pos;
-      }
-    }
+    AddHarmonics(phi, weight);
     sum_weights_ += weight;
     n_ += 1;
   }
@@ -388,18 +456,40 @@ class QVector {
  */
   inline void Add(const double phi, const double offset, const double weight) {
     if (weight < kminimumweight) return;
-    unsigned int pos = 0;
-    for (unsigned int h = 1; h <= maximum_harmonic_; ++h) {
-      if (bits_.test(h - 1)) {
-        q_[pos].x += (weight*std::cos(h*harmonic_multiplier_*phi)*offset);
-        q_[pos].y += (weight*std::sin(h*harmonic_multiplier_*phi)*offset);
-        ++pos;
-      }
-    }
+    AddHarmonics(phi, weight*offset);
     sum_weights_ += weight;
     n_ += 1;
   }
 
+  /**
+   * Adds a batch of data vectors to the qvector.
+   * The data vectors are processed in blocks in a structure of arrays layout, such that the evaluation of the
+   * harmonics is vectorized across the data vectors. Data vectors with a weight below the minimum weight are skipped.
+   * @param phi angles of the particles or channels.
+   * @param offset offsets of the phi channels. If nullptr, an offset of 1 is used for all data vectors.
+   * @param weight weights of the particles or channels.
+   * @param n number of data vectors.
+   * @param doubled optional Q-vector with twice the harmonic multiplier, which is filled in the same sweep.
+   */
+  void AddBatch(const float *phi, const float *offset, const float *weight, std::size_t n,
+                QVector *doubled = nullptr);
+
+  /**
+   * Adds the sums of a set of data vectors, whose harmonics have been evaluated outside of the Q-vector, e.g. taken
+   * from a table of precomputed harmonics.
+   * @param sums weighted sums of the cosine and the sine of each configured harmonic in increasing order.
+   * @param sum_weights sum of the weights of the data vectors.
+   * @param n number of data vectors.
+   */
+  void AddSums(const double *sums, const double sum_weights, const int n) {
+    for (std::size_t i = 0; i < bits_.count(); ++i) {
+      q_[i].x += sums[2*i];
+      q_[i].y += sums[2*i + 1];
+    }
+    sum_weights_ += sum_weights;
+    n_ += n;
+  }
+
   /**
    * Returns the highest harmonic configured in the Q-vector.
    * @return highest harmonic.
@@ -417,12 +507,40 @@ class QVector {
   }
 
  private:
+  /**
+   * Accumulates the weighted harmonic components of a single data vector.
+   * Only cos and sin of the lowest harmonic are evaluated. The higher harmonics are obtained with the
+   * angle-addition recurrence cos((h+1)x) = cos(hx)cos(x) - sin(hx)sin(x) and
+   * sin((h+1)x) = sin(hx)cos(x) + cos(hx)sin(x), which is evaluated in double precision to keep the
+   * deviation from the direct evaluation at the level of the float rounding of the components.
+   * @param phi angle of the particle or channel.
+   * @param weight weight multiplied to the components.
+   */
+  inline void AddHarmonics(const double phi, const double weight) {
+    double cos1;
+    double sin1;
+    SinCos(harmonic_multiplier_*phi, sin1, cos1);
+    double cosh = cos1;
+    double sinh = sin1;
+    unsigned int pos = 0;
+    for (unsigned int h = 1; h <= maximum_harmonic_; ++h) {
+      if (bits_.test(h - 1)) {
+        q_[pos].x += (weight*cosh);
+        q_[pos].y += (weight*sinh);
+        ++pos;
+      }
+      const double cosn = cosh*cos1 - sinh*sin1;
+      sinh = sinh*cos1 + cosh*sin1;
+      cosh = cosn;
+    }
+  }
+
   Normalization norm_ = Normalization::NONE; ///< normalization method
   CorrectionStep correction_step_ = CorrectionStep::RAW; ///< correction step defined by enumerator
   int n_ = 0;                                ///< number of data vectors contributing to the q vector
   float sum_weights_ = 0.0;                  ///< sum of weights
   std::bitset<kmaxharmonics> bits_{};        ///< Bitset for keeping track of the harmonics
-  std::vector<QVec> q_;                      ///< array of qvectors for the different harmonics
+  std::array<QVec, kmaxharmonics> q_{};      ///< array of qvectors for the different harmonics
   /**
    * Data members only used during the construction and correction of the Q-vectors.
    * They are not saved to the root file, as they are not used to read the data.
@@ -432,14 +550,95 @@ class QVector {
   unsigned char harmonic_multiplier_ = 1;    //!<! harmonic multiplier (used for some correction steps)
 
   /// \cond CLASSIMP
- ClassDef(QVector, 12);
+ ClassDefNV(QVector, 13);
   /// \endcond
 };
 
-inline double ScalarProduct(QVector a, QVector b, unsigned int harmonic) {
+static_assert(std::is_trivially_copyable<QVector>::value, "QVector needs to be trivially copyable.");
+
+inline double ScalarProduct(const QVector &a, const QVector &b, unsigned int harmonic) {
   return a.x(harmonic) * b.x(harmonic) + a.y(harmonic) * b.y(harmonic);
 }
 
+/**
+ * @class QVectorDeNormalView
+ * @brief Read-only view of a Q-vector, which removes the normalization on access.
+ * The components are identical to the ones of DeNormal, but no copy of the Q-vector is made and only the accessed
+ * harmonics are rescaled. The factor of the normalizations M and SQRT_M is calculated once by the view.
+ * auto v2_2 = [](const Qn::QVector &a) {
+ *   Qn::QVectorDeNormalView q(a);
+ *   auto M = q.sumweights();
+ *   return (Qn::ScalarProduct(q, q, 2) - M)/(M*(M - 1));
+ * };
+ */
+class QVectorDeNormalView {
+ public:
+  /**
+   * Constructor
+   * @param q viewed Q-vector, which needs to outlive the view.
+   */
+  QVectorDeNormalView(const QVector &q) : q_(&q), magnitude_(q.GetNorm()==QVector::Normalization::MAGNITUDE) {
+    switch (q.GetNorm()) {
+      case QVector::Normalization::M:factor_ = q.sumweights();
+        break;
+      case QVector::Normalization::SQRT_M:factor_ = std::sqrt(q.sumweights());
+        break;
+      default:break;
+    }
+  }
+
+  /**
+   * Returns the unnormalized Q-vector of the i-th harmonic.
+   * Throws exception, when the harmonic is out of the range.
+   * @param i harmonic i of the Q-vector
+   * @return Q-vector of a single harmonic
+   */
+  inline QVec Component(const unsigned int i) const { return Scale({q_->x(i), q_->y(i)}); }
+
+  /**
+   * Returns the unnormalized Q-vector stored at the given position without checking the activated harmonics.
+   * @param position storage position of the harmonic
+   * @return Q-vector of a single harmonic
+   */
+  inline QVec GetComponent(const std::size_t position) const { return Scale(q_->GetComponent(position)); }
+
+  /**
+   * Returns unnormalized x-component of Q-vector of the i-th harmonic.
+   * @param i harmonic i of the Q-vector
+   * @return x-component
+   */
+  inline float x(const unsigned int i) const { return Component(i).x; }
+
+  /**
+   * Returns unnormalized y-component of Q-vector of the i-th harmonic.
+   * @param i harmonic i of the Q-vector
+   * @return y-component
+   */
+  inline float y(const unsigned int i) const { return Component(i).y; }
+
+  inline float sumweights() const { return q_->sumweights(); }
+  inline float n() const { return q_->n(); }
+
+  /**
+   * Returns the viewed Q-vector.
+   * @return viewed Q-vector
+   */
+  const QVector &Get() const { return *q_; }
+
+ private:
+  inline QVec Scale(const QVec q) const { return magnitude_ ? q*Qn::norm(q) : q*factor_; }
+
+  const QVector *q_ = nullptr; ///< viewed Q-vector
+  bool magnitude_ = false; ///< the components are normalized to their magnitude
+  float factor_ = 1.; ///< factor of the normalizations M and SQRT_M
+};
+
+inline double ScalarProduct(const QVectorDeNormalView &a, const QVectorDeNormalView &b, unsigned int harmonic) {
+  const auto qa = a.Component(harmonic);
+  const auto qb = b.Component(harmonic);
+  return qa.x * qb.x + qa.y * qb.y;
+}
+
 static constexpr std::array<const char *, 6> kCorrectionStepNamesArray = {
     "RAW",
     "PLAIN",
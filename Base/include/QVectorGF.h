@@ -0,0 +1,130 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_QVECTORGF_H
+#define FLOW_QVECTORGF_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <vector>
+
+#include "Rtypes.h"
+
+#include "SinCos.h"
+
+namespace Qn {
+/**
+ * @class QVectorGF
+ * @brief Q-vector of the generic framework for multi-particle correlations.
+ * Keeps the weighted Q-vectors \f$ Q_{n,p} = \sum_i w_i^p e^{in\phi_i} \f$ for all harmonics n up to the maximum
+ * harmonic and all powers p of the weights up to the maximum power. A k-particle correlation of the harmonics
+ * h_1...h_k needs the harmonics up to \f$ \sum |h_i| \f$ and the powers up to k.
+ * Q-vectors of negative harmonics are obtained as complex conjugates.
+ */
+class QVectorGF {
+ public:
+  QVectorGF() = default;
+
+  /**
+   * Constructor
+   * @param max_harmonic maximum harmonic
+   * @param max_power maximum power of the weights
+   */
+  QVectorGF(unsigned int max_harmonic, unsigned int max_power) :
+      max_harmonic_(max_harmonic),
+      max_power_(max_power),
+      q_(2*(max_harmonic + 1)*(max_power + 1), 0.) {}
+
+  /**
+   * Reset the Q-vector. Is called before the Q-vector is filled in every event.
+   */
+  void Reset() {
+    n_ = 0;
+    std::fill(q_.begin(), q_.end(), 0.);
+  }
+
+  /**
+   * Adds a new data vector to the Q-vector.
+   * The harmonics are evaluated with the angle-addition recurrence, the powers of the weight by repeated
+   * multiplication.
+   * @param phi angle of the particle or channel.
+   * @param weight weight of the particle or channel.
+   */
+  void Add(const double phi, const double weight) {
+    double cos1;
+    double sin1;
+    SinCos(phi, sin1, cos1);
+    double cosn = 1.;
+    double sinn = 0.;
+    auto q = q_.begin();
+    for (unsigned int n = 0; n <= max_harmonic_; ++n) {
+      double weight_power = 1.;
+      for (unsigned int p = 0; p <= max_power_; ++p) {
+        *q++ += weight_power*cosn;
+        *q++ += weight_power*sinn;
+        weight_power *= weight;
+      }
+      const double cos_next = cosn*cos1 - sinn*sin1;
+      sinn = sinn*cos1 + cosn*sin1;
+      cosn = cos_next;
+    }
+    ++n_;
+  }
+
+  /**
+   * Returns the Q-vector of the harmonic n and the power p of the weights.
+   * Throws exception, when the harmonic or the power is out of the range.
+   * @param n harmonic. Negative harmonics return the complex conjugate.
+   * @param p power of the weights
+   * @return Q-vector
+   */
+  std::complex<double> Q(const int n, const unsigned int p) const {
+    const unsigned int harmonic = std::abs(n);
+    if (harmonic > max_harmonic_ || p > max_power_) throw std::out_of_range("harmonic or power not in range.");
+    const auto position = 2*(harmonic*(max_power_ + 1) + p);
+    return {q_[position], n < 0 ? -q_[position + 1] : q_[position + 1]};
+  }
+
+  /**
+   * Returns the sum of weights of the Q-Vector.
+   * @return Sum of weights of the Q-Vector.
+   */
+  float sumweights() const { return max_power_ > 0 ? q_[2] : n_; }
+
+  /**
+   * Returns the number of contributors of the Q-Vector.
+   * @return number of contributors of the Q-Vector.
+   */
+  float n() const { return n_; }
+
+  unsigned int GetMaxHarmonic() const { return max_harmonic_; }
+  unsigned int GetMaxPower() const { return max_power_; }
+
+ private:
+  int n_ = 0;                     ///< number of data vectors contributing to the Q-vector
+  unsigned int max_harmonic_ = 0; ///< maximum harmonic
+  unsigned int max_power_ = 0;    ///< maximum power of the weights
+  std::vector<double> q_;         ///< x and y components ordered by harmonic and power
+
+  /// \cond CLASSIMP
+ ClassDefNV(QVectorGF, 1);
+  /// \endcond
+};
+
+}
+#endif //FLOW_QVECTORGF_H
@@ -0,0 +1,193 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_BASE_INCLUDE_QUANTILESKETCH_H_
+#define FLOW_BASE_INCLUDE_QUANTILESKETCH_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "Rtypes.h"
+
+namespace Qn {
+/**
+ * @class QuantileSketch
+ * @brief Streaming and mergeable quantile sketch (KLL) of a variable, e.g. the multiplicity or the centrality
+ * estimator, used to calculate the bin edges of equal populated bins without keeping all values in memory.
+ * The values are stored in levels of compactors. A value in level h represents 2^h values. A full level is sorted
+ * and every second value is promoted to the next level, starting at a randomly chosen offset. The capacity of the
+ * levels decreases geometrically towards the lower levels, such that the memory grows only logarithmically with the
+ * number of values. The rank error is of the order of 1/k, about 1% for the default k of 200.
+ * Sketches filled in different slots or jobs are combined with Merge.
+ */
+class QuantileSketch {
+ public:
+  /**
+   * Constructor
+   * @param k capacity of the highest level, which determines the accuracy
+   * @param seed seed of the random offsets of the compactions
+   */
+  explicit QuantileSketch(unsigned int k = 200, std::uint64_t seed = 1) : k_(std::max(k, 8u)), state_(seed | 1u) {}
+
+  /**
+   * Adds a value to the sketch.
+   * @param value the value
+   */
+  void Fill(double value) {
+    if (levels_.empty()) levels_.emplace_back();
+    levels_[0].push_back(value);
+    ++n_;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    if (levels_[0].size() >= Capacity(0)) Compress();
+  }
+
+  /**
+   * Adds the values of another sketch to this sketch.
+   * @param other the other sketch
+   */
+  void Merge(const QuantileSketch &other) {
+    if (other.levels_.size() > levels_.size()) levels_.resize(other.levels_.size());
+    for (std::size_t h = 0; h < other.levels_.size(); ++h) {
+      levels_[h].insert(levels_[h].end(), other.levels_[h].begin(), other.levels_[h].end());
+    }
+    n_ += other.n_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    Compress();
+  }
+
+  /**
+   * Estimates a quantile.
+   * @param q probability between 0 and 1
+   * @return the value, below which a fraction q of the values lie. The minimum and the maximum are exact.
+   */
+  double Quantile(double q) const {
+    if (n_==0) return std::numeric_limits<double>::quiet_NaN();
+    if (q <= 0.) return min_;
+    if (q >= 1.) return max_;
+    const auto items = WeightedItems();
+    const auto target = q*static_cast<double>(n_);
+    std::uint64_t cumulative = 0;
+    for (const auto &item : items) {
+      cumulative += item.second;
+      if (static_cast<double>(cumulative) >= target) return item.first;
+    }
+    return max_;
+  }
+
+  /**
+   * Estimates the number of values, which are smaller than a value.
+   * @param value the value
+   * @return estimated rank of the value
+   */
+  double Rank(double value) const {
+    double rank = 0.;
+    for (std::size_t h = 0; h < levels_.size(); ++h) {
+      for (const auto item : levels_[h]) {
+        if (item < value) rank += static_cast<double>(std::uint64_t{1} << h);
+      }
+    }
+    return rank;
+  }
+
+  std::uint64_t N() const { return n_; }
+  double Min() const { return min_; }
+  double Max() const { return max_; }
+
+  /**
+   * Returns the number of values stored in the sketch, which determines its memory.
+   */
+  std::size_t Size() const {
+    std::size_t size = 0;
+    for (const auto &level : levels_) size += level.size();
+    return size;
+  }
+
+ private:
+  static constexpr double kLevelRatio = 2./3.; ///< ratio of the capacities of neighbouring levels
+
+  /**
+   * Capacity of a level. The highest level has the capacity k.
+   */
+  std::size_t Capacity(std::size_t h) const {
+    const auto depth = static_cast<double>(levels_.size() - 1 - h);
+    return std::max<std::size_t>(2, static_cast<std::size_t>(std::ceil(k_*std::pow(kLevelRatio, depth))));
+  }
+
+  /**
+   * Compacts all levels exceeding their capacity, starting with the lowest level.
+   */
+  void Compress() {
+    for (std::size_t h = 0; h < levels_.size(); ++h) {
+      if (levels_[h].size() < Capacity(h)) continue;
+      if (h + 1==levels_.size()) levels_.emplace_back();
+      auto &level = levels_[h];
+      std::sort(level.begin(), level.end());
+      // an odd value is kept in the level, such that the weight is conserved.
+      const bool odd = level.size()%2==1;
+      const auto end = odd ? level.size() - 1 : level.size();
+      for (std::size_t i = NextBit(); i < end; i += 2) levels_[h + 1].push_back(level[i]);
+      if (odd) {
+        level.front() = level.back();
+        level.resize(1);
+      } else {
+        level.clear();
+      }
+    }
+  }
+
+  /**
+   * Returns the values of all levels with their weights sorted by value.
+   */
+  std::vector<std::pair<double, std::uint64_t>> WeightedItems() const {
+    std::vector<std::pair<double, std::uint64_t>> items;
+    items.reserve(Size());
+    for (std::size_t h = 0; h < levels_.size(); ++h) {
+      for (const auto item : levels_[h]) items.emplace_back(item, std::uint64_t{1} << h);
+    }
+    std::sort(items.begin(), items.end());
+    return items;
+  }
+
+  /**
+   * Random bit of a xorshift generator choosing the offset of a compaction.
+   */
+  std::size_t NextBit() {
+    state_ ^= state_ << 13u;
+    state_ ^= state_ >> 7u;
+    state_ ^= state_ << 17u;
+    return state_ >> 63u;
+  }
+
+  unsigned int k_ = 200; ///< capacity of the highest level
+  std::uint64_t n_ = 0; ///< number of values
+  double min_ = std::numeric_limits<double>::infinity(); ///< smallest value
+  double max_ = -std::numeric_limits<double>::infinity(); ///< largest value
+  std::uint64_t state_ = 1; ///< state of the random generator of the compactions
+  std::vector<std::vector<double>> levels_; ///< values of the levels. Level h represents 2^h values each.
+
+  /// \cond CLASSIMP
+ ClassDef(QuantileSketch, 1);
+  /// \endcond
+};
+}
+
+#endif //FLOW_BASE_INCLUDE_QUANTILESKETCH_H_
@@ -18,6 +18,7 @@
 #ifndef FLOW_RESAMPLES_H
 #define FLOW_RESAMPLES_H
 
+#include <array>
 #include <utility>
 #include <vector>
 #include <algorithm>
@@ -30,6 +31,7 @@
 
 #include "CorrelationResult.h"
 #include "Statistic.h"
+#include "StatisticArray.h"
 
 namespace Qn {
 
@@ -41,14 +43,19 @@ struct ConfidenceInterval {
   }
 };
 
-ConfidenceInterval ConfidenceIntervalPercentile(std::vector<double>);
-ConfidenceInterval ConfidenceIntervalPivot(std::vector<double>, double);
-ConfidenceInterval ConfidenceIntervalNormal(std::vector<double>, double);
+/**
+ * Confidence intervals of the range [first, last) of sample means. The percentile and pivot intervals select the
+ * order statistics with std::nth_element and reorder the range.
+ */
+ConfidenceInterval ConfidenceIntervalPercentile(double *first, double *last);
+ConfidenceInterval ConfidenceIntervalPivot(double *first, double *last, double);
+ConfidenceInterval ConfidenceIntervalNormal(const double *first, const double *last, double);
 
 class ReSamples {
   using size_type = std::size_t;
  public:
   using ValueType = double;
+  using Storage = StatisticArray::Storage;
 
   enum class CIMethod {
     percentile,
@@ -56,10 +63,19 @@ class ReSamples {
     normal
   };
 
+  /**
+   * Resampling method
+   */
+  enum class Method {
+    kBootstrap,  ///< every event is filled into all samples with a Poisson multiplicity
+    kSubSamples  ///< every event is filled into one of the samples. The samples are disjoint sub-samples.
+  };
+
   ReSamples() = default;
   explicit ReSamples(unsigned int size) : statistics_(size), means_(size), weights_(size) {}
   virtual ~ReSamples() = default;
   ReSamples(const ReSamples &sample) {
+    method_ = sample.method_;
     statistics_ = sample.statistics_;
     means_ = sample.means_;
     weights_ = sample.weights_;
@@ -67,49 +83,145 @@ class ReSamples {
   ReSamples(ReSamples &&sample) = default;
   ReSamples &operator=(const ReSamples &sample) = default;
 
-  void SetNumberOfSamples(unsigned int i) {
+  /**
+   * Sets the number of samples.
+   * @param i number of samples
+   * @param storage storage of the statistics of the samples. The compact storages only keep the sums needed for the
+   * means of the samples.
+   */
+  void SetNumberOfSamples(unsigned int i, Storage storage = Storage::kFull) {
+    ResetCache();
+    statistics_.SetStorage(storage);
     statistics_.resize(i);
     means_.resize(i);
     weights_.resize(i);
   }
   size_type size() const { return means_.size(); }
 
+  /**
+   * Estimates the memory allocated for the samples.
+   * @param n_samples number of samples
+   * @param storage storage of the statistics of the samples
+   * @param accumulation accumulation mode
+   * @return allocated bytes
+   */
+  static std::size_t EstimateHeapBytes(size_type n_samples, Storage storage, Statistic::Accumulation accumulation) {
+    return 2*n_samples*sizeof(ValueType) + StatisticArray::EstimateHeapBytes(n_samples, storage, accumulation);
+  }
+
+  /**
+   * Keeps only the first n samples. As the samples are drawn from the same per event multiplicities, the first n
+   * samples of different ReSamples stay correlated.
+   * @param n number of samples
+   */
+  void Truncate(size_type n) {
+    if (n >= statistics_.size() && n >= means_.size()) return;
+    ResetCache();
+    statistics_.resize(std::min(n, statistics_.size()));
+    means_.resize(std::min(n, means_.size()));
+    weights_.resize(std::min(n, weights_.size()));
+  }
+
+  /**
+   * Returns the number of samples, for which the confidence interval of the means of the statistics has converged.
+   * Starting from n_min the number of samples n is doubled until the widths of the intervals of the first n, 2n,
+   * 4n, ... samples differ by less than the tolerance from the width of the interval of all samples.
+   * @param mean mean of the full sample
+   * @param tolerance relative tolerance of the width of the interval
+   * @param n_min minimum number of samples
+   * @param method method of the confidence interval
+   * @return converged number of samples or size() if the interval has not converged
+   */
+  size_type ConvergedNumberOfSamples(double mean, double tolerance, size_type n_min, CIMethod method) const;
+
+  /**
+   * Sets the accumulation mode of the statistics of the samples.
+   * @param accumulation accumulation mode
+   */
+  void SetAccumulation(Statistic::Accumulation accumulation) { statistics_.SetAccumulation(accumulation); }
+  Statistic::Accumulation GetAccumulation() const { return statistics_.GetAccumulation(); }
+
+  /**
+   * Sets the resampling method. For sub-samples the confidence intervals are scaled by 1/sqrt(n) of the number n
+   * of filled sub-samples, as the spread of the sub-sample means is the spread of the means of samples, which are
+   * n times smaller than the full sample.
+   * @param method resampling method
+   */
+  void SetMethod(Method method) {
+    ResetCache();
+    method_ = method;
+  }
+  Method GetMethod() const { return method_; }
+
   const ValueType &GetSampleMean(int i) const { return means_.at(i); }
 
   std::vector<double> GetMeans() const { return means_; }
 
+  /**
+   * Returns the confidence interval of the means of the samples. The interval is cached until the means change.
+   * @param mean mean of the full sample
+   * @param method method of the confidence interval
+   * @return confidence interval
+   */
   ConfidenceInterval GetConfidenceInterval(const double mean, CIMethod method) const {
-    return ConstructConfidenceInterval(means_, mean, method);
+    auto &cached = cache_[static_cast<std::size_t>(method)];
+    if (cached.valid && cached.mean==mean) return cached.interval;
+    cached.interval = ComputeConfidenceInterval(means_.size(),
+                                                [this](size_type i) { return means_[i]; },
+                                                [this](size_type i) { return weights_[i]; },
+                                                mean, method);
+    cached.mean = mean;
+    cached.valid = true;
+    return cached.interval;
+  }
+
+  /**
+   * Returns the confidence interval of the means of the statistics of the samples. Used before the means of the
+   * samples are calculated, without copying the samples.
+   * @param mean mean of the full sample
+   * @param method method of the confidence interval
+   * @return confidence interval
+   */
+  ConfidenceInterval GetConfidenceIntervalOfStatistics(const double mean, CIMethod method) const {
+    return ComputeConfidenceInterval(statistics_.size(),
+                                     [this](size_type i) { return statistics_.Mean(i); },
+                                     [this](size_type i) { return statistics_.SumWeights(i); },
+                                     mean, method);
   }
 
   void Fill(const CorrelationResult &result, const std::vector<size_type> &sample_ids) {
-    for (const auto &id : sample_ids) { statistics_[id].Fill(result); }
+    for (const auto &id : sample_ids) { statistics_.Fill(id, result.result, result.weight); }
   }
 
   template<typename SAMPLES>
   void FillPoisson(const CorrelationResult &result, SAMPLES &&sample_multiplicities_) {
-    for (unsigned int i = 0; i < sample_multiplicities_.size(); ++i) {
-      for (unsigned int j = 0; j < sample_multiplicities_[i]; ++j) {
-        statistics_[i].Fill(result);
-      }
-    }
+    FillPoisson(result.result, result.weight, std::forward<SAMPLES>(sample_multiplicities_));
+  }
+
+  template<typename SAMPLES>
+  void FillPoisson(const double value, const double weight, SAMPLES &&sample_multiplicities_) {
+    statistics_.FillMultiplicities(value, weight, sample_multiplicities_);
   }
 
   void FillSample(const CorrelationResult &result, unsigned int sample) {
-    statistics_[sample].Fill(result);
+    statistics_.Fill(sample, result.result, result.weight);
+  }
+
+  void FillSample(const double value, const double weight, unsigned int sample) {
+    statistics_.Fill(sample, value, weight);
   }
 
   void CalculateMeans() {
     if (!using_means_) {
-      unsigned int i = 0;
-      for (auto &statistic : statistics_) {
-        double mean = statistic.Mean();
-        double weight = statistic.SumWeights();
-        means_.at(i) = mean;
-        weights_.at(i) = weight;
-        ++i;
-        using_means_ = true;
+      ResetCache();
+      const auto n = statistics_.size();
+      means_.resize(n);
+      weights_.resize(n);
+      for (size_type i = 0; i < n; ++i) {
+        means_[i] = statistics_.Mean(i);
+        weights_[i] = statistics_.SumWeights(i);
       }
+      if (n > 0) using_means_ = true;
     }
   }
 
@@ -130,6 +242,15 @@ class ReSamples {
     }
   }
 
+  /**
+   * In-place arithmetic of the bootstrap means. The means of both operands need to be calculated.
+   */
+  ReSamples &operator+=(const ReSamples &);
+  ReSamples &operator-=(const ReSamples &);
+  ReSamples &operator*=(const ReSamples &);
+  ReSamples &operator/=(const ReSamples &);
+  ReSamples &operator*=(double);
+
   static ReSamples Addition(const ReSamples &, const ReSamples &);
 
   static ReSamples Subtraction(const ReSamples &, const ReSamples &);
@@ -150,38 +271,89 @@ class ReSamples {
 
   static ReSamples Concatenate(const ReSamples &, const ReSamples &);
 
+  /**
+   * In-place version of MergeStatistics. The result is stored in the first argument.
+   */
+  static void MergeStatisticsInto(ReSamples &, const ReSamples &);
+
+  /**
+   * In-place version of Concatenate. The result is stored in the first argument.
+   */
+  static void ConcatenateInto(ReSamples &, const ReSamples &);
+
+  friend class StatsColumnarFile;
+
  private:
 
+  /**
+   * Confidence interval cached per method
+   */
+  struct CachedConfidenceInterval {
+    bool valid = false;
+    double mean = 0.;
+    ConfidenceInterval interval{};
+  };
+
+  void ResetCache() { cache_ = {}; }
+
   ConfidenceInterval ConfidenceIntervalNSamplesMethod(const double mean,
                                                       const size_type nsamples,
                                                       CIMethod method = CIMethod::pivot) const {
-    std::vector<ValueType> bsmeans = means_;
-    bsmeans.resize(nsamples);
-    return ConstructConfidenceInterval(bsmeans, mean, method);
+    return ComputeConfidenceInterval(std::min(nsamples, means_.size()),
+                                     [this](size_type i) { return means_[i]; },
+                                     [this](size_type i) { return weights_[i]; },
+                                     mean, method);
   }
 
-  inline ConfidenceInterval ConstructConfidenceInterval(std::vector<ValueType> means,
-                                                        const double mean,
-                                                        CIMethod method) const {
+  /**
+   * Computes the confidence interval of the first nsamples samples. The sample means are collected in a buffer of
+   * the thread, which is reused, as the selection of the order statistics reorders them. For sub-samples only
+   * the filled samples are used and the interval is scaled by 1/sqrt(n) of the number of filled samples.
+   * @param nsamples number of samples
+   * @param sample_mean function returning the mean of a sample
+   * @param sample_weight function returning the sum of weights of a sample
+   * @param mean mean of the full sample
+   * @param method method of the confidence interval
+   * @return confidence interval
+   */
+  template<typename MEAN, typename WEIGHT>
+  ConfidenceInterval ComputeConfidenceInterval(const size_type nsamples, MEAN &&sample_mean, WEIGHT &&sample_weight,
+                                               const double mean, CIMethod method) const {
+    thread_local std::vector<ValueType> buffer;
+    buffer.clear();
+    const bool sub_samples = method_==Method::kSubSamples;
+    for (size_type i = 0; i < nsamples; ++i) {
+      if (sub_samples && sample_weight(i)==0.) continue;
+      buffer.push_back(sample_mean(i));
+    }
+    auto first = buffer.data();
+    auto last = first + buffer.size();
     ConfidenceInterval interval{};
     switch (method) {
-      case CIMethod::percentile :interval = ConfidenceIntervalPercentile(means);
+      case CIMethod::percentile :interval = ConfidenceIntervalPercentile(first, last);
         break;
-      case CIMethod::pivot :interval = ConfidenceIntervalPivot(means, mean);
+      case CIMethod::pivot :interval = ConfidenceIntervalPivot(first, last, mean);
         break;
-      case CIMethod::normal :interval = ConfidenceIntervalNormal(means, mean);
+      case CIMethod::normal :interval = ConfidenceIntervalNormal(first, last, mean);
         break;
     }
+    if (sub_samples) {
+      const double scale = 1./std::sqrt(static_cast<double>(buffer.size()));
+      interval.lower_limit = mean + (interval.lower_limit - mean)*scale;
+      interval.upper_limit = mean + (interval.upper_limit - mean)*scale;
+    }
     return interval;
   }
 
+  mutable std::array<CachedConfidenceInterval, 3> cache_; //!<! confidence intervals of the current means
   bool using_means_ = false;
-  std::vector<Statistic> statistics_;
+  Method method_ = Method::kBootstrap;
+  StatisticArray statistics_;
   std::vector<ValueType> means_;
   std::vector<ValueType> weights_;
 
   /// \cond CLASSIMP
- ClassDef(ReSamples, 2);
+ ClassDef(ReSamples, 4);
   /// \endcond
 
 };
@@ -0,0 +1,70 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLOW_BASE_INCLUDE_RESULTFILEMERGER_H_
+#define FLOW_BASE_INCLUDE_RESULTFILEMERGER_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "TObject.h"
+
+namespace Qn {
+/**
+ * @class ResultFileMerger
+ * @brief Merges the result files of many jobs in batches, such that only the merged result and one batch are kept
+ * in memory. The files of a batch are read in parallel and merged into the result in place. The bins of
+ * DataContainerStats and DataContainerStatistic are merged in a pairwise tree of the batch distributed over the
+ * implicit multithreading pool. The event shapes are accumulated in their histograms and fitted once when the result
+ * is written. The lists of the corrections and of the QA are merged recursively by name, all other objects with the
+ * merge function of their class. Objects, which are missing in the result, e.g. the corrections of a run, which was
+ * not processed by the first job, are moved to the result from the first file containing them.
+ *
+ * Qn::ResultFileMerger merger(8);
+ * merger.MergeBatch({"job_1.root", "job_2.root"});
+ * merger.Write("merged.root");
+ */
+class ResultFileMerger {
+ public:
+  /**
+   * Constructor
+   * @param n_threads number of threads reading the files of a batch
+   */
+  explicit ResultFileMerger(std::size_t n_threads = 1) : n_threads_(n_threads > 0 ? n_threads : 1) {}
+
+  /**
+   * Reads the files and merges them into the result.
+   * @param file_names names of the files of the batch
+   */
+  void MergeBatch(const std::vector<std::string> &file_names);
+
+  /**
+   * Fits the event shapes and writes the result. To be called once after all batches have been merged.
+   * @param file_name name of the merged file
+   */
+  void Write(const std::string &file_name);
+
+ private:
+  std::size_t n_threads_; ///< number of threads reading the files of a batch
+  std::vector<std::string> names_; ///< top level keys of the result in the order of their first appearance
+  std::map<std::string, std::unique_ptr<TObject>> objects_; ///< merged objects
+};
+}
+
+#endif //FLOW_BASE_INCLUDE_RESULTFILEMERGER_H_
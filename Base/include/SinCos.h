@@ -0,0 +1,132 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_BASE_INCLUDE_SINCOS_H_
+#define FLOW_BASE_INCLUDE_SINCOS_H_
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+
+namespace Qn {
+/**
+ * Evaluation of the sine and cosine of the angles of the data vectors, when the Q-vectors are built.
+ * EXACT uses std::sin and std::cos of the standard library. FAST uses a polynomial, which is inlined and vectorized
+ * by the compiler, with an absolute error below kFastSinCosMaxError for angles up to kFastSinCosMaxAngle.
+ * The default is FAST, if flow is built with the CMake option FLOW_FAST_SINCOS, and EXACT otherwise.
+ */
+enum class SinCosMode {
+  EXACT,
+  FAST
+};
+
+#ifdef FLOW_FAST_SINCOS
+constexpr SinCosMode kDefaultSinCosMode = SinCosMode::FAST;
+#else
+constexpr SinCosMode kDefaultSinCosMode = SinCosMode::EXACT;
+#endif
+
+/**
+ * Maximum absolute error of the sine and cosine of the FAST mode, for angles with an absolute value up to
+ * kFastSinCosMaxAngle, which covers the harmonics of the Q-vectors. It is measured against the long double functions
+ * of the standard library with and without -ffast-math, which allows the compiler to merge the parts of the range
+ * reduction. Without -ffast-math the error is below 2e-16 for angles up to 1e4. Both are below the rounding of the
+ * float components of the Q-vectors by orders of magnitude.
+ */
+constexpr double kFastSinCosMaxError = 5e-15;
+constexpr double kFastSinCosMaxAngle = 100.;
+
+namespace Impl {
+inline std::atomic<SinCosMode> &SinCosModeStorage() {
+  static std::atomic<SinCosMode> mode{kDefaultSinCosMode};
+  return mode;
+}
+
+/**
+ * Sine and cosine with the reduction of the angle to [-pi/4, pi/4] and the minimax polynomials of Cephes. The
+ * multiple of pi/2 is subtracted in the three parts of fdlibm, such that the first two products are exact. The
+ * quadrant selects and signs the polynomials without branches, such that loops over this function are vectorized.
+ */
+inline void FastSinCos(const double angle, double &sin, double &cos) {
+  constexpr double kTwoOverPi = 0.63661977236758134308;
+  constexpr double kPiOver2A = 1.57079632673412561417;
+  constexpr double kPiOver2B = 6.07710050630396597660e-11;
+  constexpr double kPiOver2C = 2.02226624879595063154e-21;
+  const double t = angle*kTwoOverPi;
+  const int quadrant = static_cast<int>(t + (t < 0. ? -0.5 : 0.5));
+  const double k = quadrant;
+  const double x = ((angle - k*kPiOver2A) - k*kPiOver2B) - k*kPiOver2C;
+  const double x2 = x*x;
+  const double sin_x = x + x*x2*(-1.66666666666666307295e-1 + x2*(8.33333333332211858878e-3
+      + x2*(-1.98412698295895385996e-4 + x2*(2.75573136213857245213e-6
+      + x2*(-2.50507477628578072866e-8 + x2*1.58962301576546568060e-10)))));
+  const double cos_x = 1. - 0.5*x2 + x2*x2*(4.16666666666665929218e-2 + x2*(-1.38888888888730564116e-3
+      + x2*(2.48015872888517045348e-5 + x2*(-2.75573141792967388112e-7
+      + x2*(2.08757008419747316778e-9 + x2*-1.13585365213876817300e-11)))));
+  const bool swap = quadrant & 1;
+  const double sign_sin = quadrant & 2 ? -1. : 1.;
+  const double sign_cos = (quadrant + 1) & 2 ? -1. : 1.;
+  sin = sign_sin*(swap ? cos_x : sin_x);
+  cos = sign_cos*(swap ? sin_x : cos_x);
+}
+}
+
+/**
+ * Returns the mode of the evaluation of the sine and cosine.
+ */
+inline SinCosMode GetSinCosMode() { return Impl::SinCosModeStorage().load(std::memory_order_relaxed); }
+
+/**
+ * Sets the mode of the evaluation of the sine and cosine for all threads. To be called before the event loop.
+ * @param mode EXACT for the standard library, FAST for the vectorized polynomial
+ */
+inline void SetSinCosMode(const SinCosMode mode) { Impl::SinCosModeStorage().store(mode, std::memory_order_relaxed); }
+
+/**
+ * Evaluates the sine and cosine of an angle in the current mode.
+ * @param angle the angle
+ * @param sin the sine
+ * @param cos the cosine
+ */
+inline void SinCos(const double angle, double &sin, double &cos) {
+  if (GetSinCosMode()==SinCosMode::FAST) {
+    Impl::FastSinCos(angle, sin, cos);
+  } else {
+    sin = std::sin(angle);
+    cos = std::cos(angle);
+  }
+}
+
+/**
+ * Evaluates the sine and cosine of a batch of angles in the current mode. The mode is read once for the batch.
+ * @param angles the angles
+ * @param n number of angles
+ * @param sin array of length n receiving the sines
+ * @param cos array of length n receiving the cosines
+ */
+inline void SinCos(const double *angles, const std::size_t n, double *sin, double *cos) {
+  if (GetSinCosMode()==SinCosMode::FAST) {
+    for (std::size_t i = 0; i < n; ++i) Impl::FastSinCos(angles[i], sin[i], cos[i]);
+  } else {
+    for (std::size_t i = 0; i < n; ++i) {
+      sin[i] = std::sin(angles[i]);
+      cos[i] = std::cos(angles[i]);
+    }
+  }
+}
+}
+
+#endif //FLOW_BASE_INCLUDE_SINCOS_H_
@@ -0,0 +1,398 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_SPARSEDATACONTAINER_H
+#define FLOW_SPARSEDATACONTAINER_H
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Rtypes.h"
+#include "TObject.h"
+#include "TCollection.h"
+
+#include "DataContainer.h"
+
+namespace Qn {
+
+/**
+ * @brief      Template container class with sparse storage of the bins.
+ * Only bins, which have been accessed for writing, are stored. They are kept as a list of linear indices sorted in
+ * increasing order and a list of the corresponding bin contents (sorted coordinate format). Memory therefore scales
+ * with the number of filled bins instead of the product of all axis sizes. Reading a bin which has not been filled
+ * returns a default constructed element. The indexing is identical to the DataContainer.
+ * @param T    Type of object inside of container
+ */
+template<typename T, typename AxisType=AxisD>
+class SparseDataContainer : public TObject {
+ public:
+  using QnAxes = std::vector<AxisType>;
+  using size_type = std::size_t;
+
+/**
+ * Default constructor
+ * Axes can be added later. If no axes are added the container is integrated with only one bin.
+ */
+  SparseDataContainer() : integrated_(true) {
+    axes_.push_back({"integrated", 1, 0, 1});
+    dimension_ = 1;
+    CalculateStride();
+  }
+
+/**
+ * Constructor
+ * @param axes vector of axes of the container.
+ */
+  explicit SparseDataContainer(const QnAxes &axes) {
+    AddAxes(axes);
+  }
+
+/**
+ * Constructor from a DataContainer. Only bins for which the predicate is true are stored.
+ * @tparam Predicate type of predicate
+ * @param container dense container
+ * @param isfilled predicate taking the bin content. Decides if a bin is stored.
+ */
+  template<typename Predicate>
+  SparseDataContainer(const DataContainer<T, AxisType> &container, Predicate &&isfilled) {
+    AddAxes(container.GetAxes());
+    for (size_type ibin = 0; ibin < container.size(); ++ibin) {
+      if (isfilled(container.At(ibin))) {
+        keys_.push_back(ibin);
+        values_.push_back(container.At(ibin));
+      }
+    }
+  }
+
+  virtual ~SparseDataContainer() = default;
+
+/**
+ * Number of bins of the corresponding dense container.
+ * @return number of bins
+ */
+  size_type size() const noexcept { return size_; }
+
+/**
+ * Number of bins, which are stored.
+ * @return number of filled bins
+ */
+  size_type GetNFilled() const noexcept { return keys_.size(); }
+
+/**
+ * Adds axes for storing data
+ * @param axes vector of axes
+ */
+  void AddAxes(const QnAxes &axes) {
+    for (const auto &axis : axes) {
+      AddAxis(axis);
+    }
+  }
+
+/**
+ * Adds an axis. Removes all stored bins, as their linear indices are not valid anymore.
+ * @param axis Axis to be added.
+ */
+  void AddAxis(const AxisType &axis) {
+    if (integrated_) {
+      integrated_ = false;
+      axes_.clear();
+      dimension_ = 0;
+    }
+    if (std::find_if(axes_.begin(), axes_.end(),
+                     [&axis](const AxisType &axisc) { return axisc.Name()==axis.Name(); })!=axes_.end())
+      throw std::logic_error("Axis already defined in vector.");
+    axes_.push_back(axis);
+    dimension_++;
+    keys_.clear();
+    values_.clear();
+    CalculateStride();
+  }
+
+/**
+ * Get element in the specified bin. The bin is created if it is not yet stored.
+ * @param index linear index of the bin
+ * @return element
+ */
+  T &At(size_type index) {
+    if (index >= size_) throw std::out_of_range("bin out of specified range");
+    auto position = std::lower_bound(keys_.begin(), keys_.end(), index);
+    const auto offset = std::distance(keys_.begin(), position);
+    if (position==keys_.end() || *position!=index) {
+      keys_.insert(position, index);
+      values_.insert(values_.begin() + offset, T());
+    }
+    return values_[offset];
+  }
+
+/**
+ * Get element in the specified bin. Returns a default constructed element, if the bin is not stored.
+ * @param index linear index of the bin
+ * @return element
+ */
+  const T &At(size_type index) const {
+    if (index >= size_) throw std::out_of_range("bin out of specified range");
+    auto position = std::lower_bound(keys_.begin(), keys_.end(), index);
+    if (position==keys_.end() || *position!=index) return empty_;
+    return values_[std::distance(keys_.begin(), position)];
+  }
+
+/**
+ * Get element in the specified bin. The bin is created if it is not yet stored.
+ * @param indices vector of bin indices of the desired element
+ * @return element
+ */
+  T &At(const std::vector<size_type> &indices) { return At(GetLinearIndex(indices)); }
+  const T &At(const std::vector<size_type> &indices) const { return At(GetLinearIndex(indices)); }
+
+/**
+ * Checks if the bin is stored.
+ * @param index linear index of the bin
+ * @return true if the bin is stored.
+ */
+  bool IsFilled(size_type index) const { return std::binary_search(keys_.begin(), keys_.end(), index); }
+
+/**
+ * Finds the linear index of the bin corresponding to the coordinates.
+ * @param coordinates coordinates in the order of the axes.
+ * @return linear index of the bin. Returns -1 if outside of the range.
+ */
+  template<typename TT>
+  long FindBin(const std::vector<TT> &coordinates) const {
+    return FindBin(coordinates.data());
+  }
+
+  template<typename TT>
+  long FindBin(const TT *coordinates) const noexcept {
+    long index = 0;
+    for (size_type i = 0; i < dimension_; ++i) {
+      const auto bin = axes_[i].FindBin(coordinates[i]);
+      if (bin==-1) return -1;
+      index += stride_[i + 1]*bin;
+    }
+    return index;
+  }
+
+  template<typename... Coordinates,
+      typename = std::enable_if_t<(sizeof...(Coordinates) > 0 && (std::is_arithmetic<Coordinates>::value && ...))>>
+  long FindBin(const Coordinates... coordinates) const noexcept {
+    const std::array<typename AxisType::ValueType, sizeof...(Coordinates)>
+        coordinate_array{{static_cast<typename AxisType::ValueType>(coordinates)...}};
+    return FindBin(coordinate_array.data());
+  }
+
+/**
+ * Calls function on the element at the coordinates. Coordinates outside of the range are ignored.
+ * @tparam Function type of function to be called on the object
+ * @param coordinates coordinates of element to be modified
+ * @param lambda function to be called on the element. Takes element of type T as an argument.
+ */
+  template<typename Function, typename TT>
+  void CallOnElement(const std::vector<TT> &coordinates, Function &&lambda) {
+    const auto index = FindBin(coordinates.data());
+    if (index > -1) lambda(At(static_cast<size_type>(index)));
+  }
+
+/**
+ * Calculates one dimensional index from a vector of indices.
+ * @param indices vector of indices in multiple dimensions
+ * @return index in one dimension
+ */
+  size_type GetLinearIndex(const std::vector<size_type> &indices) const {
+    size_type index = 0;
+    for (size_type i = 0; i < dimension_; ++i) {
+      index += stride_[i + 1]*indices[i];
+    }
+    return index;
+  }
+
+/**
+ * Calculates multidimensional index from the linear index.
+ * @param index linear index
+ * @return vector of indices in multiple dimensions
+ */
+  std::vector<size_type> GetIndex(size_type index) const {
+    std::vector<size_type> indices(dimension_);
+    for (size_type i = 0; i < dimension_; ++i) {
+      indices[i] = index/stride_[i + 1];
+      index %= stride_[i + 1];
+    }
+    return indices;
+  }
+
+/**
+ * Calls the function for all stored bins in increasing order of the linear index.
+ * @tparam Function type of function
+ * @param function called with the linear index and the element of the bin.
+ */
+  template<typename Function>
+  void ForEachFilled(Function &&function) {
+    for (size_type i = 0; i < keys_.size(); ++i) function(static_cast<size_type>(keys_[i]), values_[i]);
+  }
+
+  template<typename Function>
+  void ForEachFilled(Function &&function) const {
+    for (size_type i = 0; i < keys_.size(); ++i) function(static_cast<size_type>(keys_[i]), values_[i]);
+  }
+
+/**
+ * Projects the container on a subset of axes. Only stored bins are merged.
+ * @tparam Function typename of function.
+ * @param axis_names subset of axes used for the projection.
+ * @param lambda Function used to add two entries.
+ * @return projected container.
+ */
+  template<typename Function>
+  SparseDataContainer<T, AxisType> Projection(const std::vector<std::string> &axis_names, Function &&lambda) const {
+    SparseDataContainer<T, AxisType> projection;
+    std::vector<long> projected_stride(dimension_, 0);
+    for (size_type i = 0; i < dimension_; ++i) {
+      if (std::find(axis_names.begin(), axis_names.end(), axes_[i].Name())!=axis_names.end()) {
+        projection.AddAxis(axes_[i]);
+      }
+    }
+    size_type iprojaxis = 0;
+    for (size_type i = 0; i < dimension_; ++i) {
+      if (iprojaxis < projection.dimension_ && !projection.integrated_
+          && projection.axes_[iprojaxis].Name()==axes_[i].Name()) {
+        projected_stride[i] = projection.stride_[iprojaxis + 1];
+        ++iprojaxis;
+      }
+    }
+    for (size_type ibin = 0; ibin < keys_.size(); ++ibin) {
+      size_type index = keys_[ibin];
+      size_type target = 0;
+      for (size_type i = 0; i < dimension_; ++i) {
+        target += projected_stride[i]*(index/stride_[i + 1]);
+        index %= stride_[i + 1];
+      }
+      auto &bin = projection.At(target);
+      bin = lambda(bin, values_[ibin]);
+    }
+    return projection;
+  }
+
+/**
+ * Projects the container on a subset of axes. Uses MergeBins to add the entries.
+ * @param axis_names subset of axes used for the projection.
+ * @return projected container.
+ */
+  SparseDataContainer<T, AxisType> Projection(const std::vector<std::string> &axis_names = {}) const {
+    return Projection(axis_names, [](const T &a, const T &b) { return Qn::MergeBins(a, b); });
+  }
+
+/**
+ * Converts the container to a dense DataContainer.
+ * @return dense container with the same axes.
+ */
+  DataContainer<T, AxisType> ToDataContainer() const {
+    DataContainer<T, AxisType> dense;
+    if (!integrated_) dense.AddAxes(axes_);
+    for (size_type ibin = 0; ibin < keys_.size(); ++ibin) {
+      dense.At(keys_[ibin]) = values_[ibin];
+    }
+    return dense;
+  }
+
+/**
+ * Merges SparseDataContainer with SparseDataContainers in TCollection.
+ * Function used in "hadd". Bins stored in both containers are merged in place, bins stored only in the other
+ * container are copied.
+ * @param inputlist List of containers
+ * @return number of bins of the container.
+ */
+  Long64_t Merge(TCollection *inputlist) {
+    TIter next(inputlist);
+    while (auto data = (SparseDataContainer<T, AxisType> *) next()) {
+      if (data->size_!=size_) throw std::logic_error("Cannot merge containers with different binning.");
+      MergeStored(*data);
+    }
+    return this->size();
+  }
+
+  const QnAxes &GetAxes() const { return axes_; }
+  unsigned long GetDimension() const noexcept { return dimension_; }
+  inline bool IsIntegrated() const { return integrated_; }
+
+ private:
+  bool integrated_ = true;      ///< Flag to show if container is integrated (only one bin)
+  unsigned long dimension_ = 0; ///< dimensionality of data
+  size_type size_ = 1;          ///< number of bins of the corresponding dense container
+  QnAxes axes_;                 ///< Vector of axes
+  std::vector<long> stride_;    ///< Offset for conversion into one dimensional vector.
+  std::vector<ULong64_t> keys_; ///< sorted linear indices of the stored bins
+  std::vector<T> values_;       ///< contents of the stored bins
+  T empty_{};                   //!<! element returned for bins which are not stored.
+
+/**
+ * Calculates offset for transformation into one dimensional vector.
+ */
+  void CalculateStride() {
+    stride_.resize(dimension_ + 1);
+    stride_[dimension_] = 1;
+    for (unsigned long i = 0; i < dimension_; ++i) {
+      stride_[dimension_ - i - 1] = stride_[dimension_ - i]*axes_[dimension_ - i - 1].size();
+    }
+    size_ = stride_[0];
+  }
+
+/**
+ * Merges the stored bins of another container. Both lists of linear indices are sorted, such that they can be
+ * combined in a single pass.
+ * @param data other container
+ */
+  void MergeStored(const SparseDataContainer<T, AxisType> &data) {
+    std::vector<ULong64_t> keys;
+    std::vector<T> values;
+    keys.reserve(keys_.size() + data.keys_.size());
+    values.reserve(keys_.size() + data.keys_.size());
+    size_type i = 0, j = 0;
+    while (i < keys_.size() || j < data.keys_.size()) {
+      if (j==data.keys_.size() || (i < keys_.size() && keys_[i] < data.keys_[j])) {
+        keys.push_back(keys_[i]);
+        values.push_back(std::move(values_[i]));
+        ++i;
+      } else if (i==keys_.size() || data.keys_[j] < keys_[i]) {
+        keys.push_back(data.keys_[j]);
+        values.push_back(data.values_[j]);
+        ++j;
+      } else {
+        keys.push_back(keys_[i]);
+        values.push_back(std::move(values_[i]));
+        MergeInto(values.back(), data.values_[j]);
+        ++i;
+        ++j;
+      }
+    }
+    keys_ = std::move(keys);
+    values_ = std::move(values);
+  }
+
+  /// \cond CLASSIMP
+ ClassDef(SparseDataContainer, 1);
+  /// \endcond
+};
+
+using SparseDataContainerStats = SparseDataContainer<Qn::Stats, AxisD>;
+using SparseDataContainerStatistic = SparseDataContainer<Qn::Statistic, AxisD>;
+
+}
+
+#endif //FLOW_SPARSEDATACONTAINER_H
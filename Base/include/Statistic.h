@@ -26,6 +26,15 @@ namespace Qn {
 
 class Statistic {
  public:
+  /**
+   * Accumulation mode of the statistics filled in the bootstrap samples.
+   */
+  enum class Accumulation {
+    kIncremental,           ///< incremental update of the mean and the variance in every fill
+    kRawMoments,            ///< sums of w, w*x, w*x^2 and w^2. Converted to mean and variance when read.
+    kCompensatedRawMoments  ///< raw moments accumulated with compensated sums
+  };
+
   void Fill(double value, double weight) {
     if (weight==0) return;
     ++n_entries_;
@@ -51,7 +60,10 @@ class Statistic {
   double Min() const { return min_; }
   double Max() const { return max_; }
   friend Statistic Merge(const Statistic &lhs, const Statistic &rhs);
+  friend void MergeInto(Statistic &lhs, const Statistic &rhs);
   friend Statistic MergeBins(const Statistic &lhs, const Statistic &rhs);
+  friend class StatisticArray;
+  friend class StatsColumnarFile;
 
  private:
   double sum_values_ = 0;
@@ -63,19 +75,30 @@ class Statistic {
   double max_ = std::numeric_limits<double>::min();
 };
 
+/**
+ * Merges the rhs statistic into the lhs statistic in place.
+ * @param lhs statistic, which is updated.
+ * @param rhs statistic, which is merged.
+ */
+inline void MergeInto(Statistic &lhs, const Statistic &rhs) {
+  const Statistic other = rhs;
+  const double lhs_sum_weights = lhs.sum_weights_;
+  const double num = other.sum_weights_*lhs.sum_values_ - lhs.sum_weights_*other.sum_values_;
+  lhs.sum_weights_ += other.sum_weights_;
+  lhs.n_entries_ += other.n_entries_;
+  lhs.sum_weights2_ += other.sum_weights2_;
+  lhs.sum_values_ += other.sum_values_;
+  lhs.max_ = std::max(lhs.max_, other.max_);
+  lhs.min_ = std::min(lhs.min_, other.min_);
+  lhs.sum_sq_ = lhs.sum_sq_ + other.sum_sq_;
+  if (lhs_sum_weights!=0. && other.sum_weights_!=0. && lhs.sum_weights_!=0.) {
+    lhs.sum_sq_ += (num*num)/(lhs_sum_weights*other.sum_weights_*lhs.sum_weights_);
+  }
+}
+
 inline Statistic Merge(const Statistic &lhs, const Statistic &rhs) {
   Statistic result = lhs;
-  result.sum_weights_ += rhs.sum_weights_;
-  result.n_entries_ += rhs.n_entries_;
-  result.sum_weights2_ += rhs.sum_weights2_;
-  result.sum_values_ += rhs.sum_values_;
-  result.max_ = std::max(result.max_, rhs.max_);
-  result.min_ = std::min(result.min_, rhs.min_);
-  double num = rhs.sum_weights_*lhs.sum_values_ - lhs.sum_weights_*rhs.sum_values_;
-  result.sum_sq_ = lhs.sum_sq_ + rhs.sum_sq_;
-  if (lhs.sum_weights_!=0. && rhs.sum_weights_!=0. && result.sum_weights_!=0.) {
-    result.sum_sq_ += (num*num)/(lhs.sum_weights_*rhs.sum_weights_*result.sum_weights_);
-  }
+  MergeInto(result, rhs);
   return result;
 }
 
@@ -0,0 +1,607 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_STATISTICARRAY_H
+#define FLOW_STATISTICARRAY_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "Rtypes.h"
+
+#include "Statistic.h"
+
+namespace Qn {
+/**
+ * @class StatisticArray
+ * @brief Accumulators of a set of Statistic stored as structure of arrays.
+ * All fields of all statistics share one contiguous buffer. The field f of the statistic i is stored at
+ * position f*size + i, such that filling and merging are streaming loops over each field.
+ * The statistics are accessible as Statistic by value.
+ *
+ * In the raw moment modes the fields of the values and the squares hold the sums of w*x and w*x^2, which are
+ * converted to the mean and the variance when a statistic is read. Minimum and maximum are not tracked in these
+ * modes. The compensated mode keeps an additional compensation term of the sums of w, w*x and w*x^2.
+ *
+ * The compact storages keep only the sum of weights and the weighted sum of the values, in double or in float
+ * precision. They are sufficient for the means of the bootstrap samples. The statistics returned in these storages
+ * only have the mean and the sum of weights.
+ */
+class StatisticArray {
+ public:
+  using size_type = std::size_t;
+  using Accumulation = Statistic::Accumulation;
+  /**
+   * Storage of the statistics
+   */
+  enum class Storage {
+    kFull,      ///< all fields of the statistics
+    kSums,      ///< sum of weights and weighted sum of the values
+    kSumsFloat  ///< sum of weights and weighted sum of the values in float precision
+  };
+  /**
+   * Fields of the accumulators
+   */
+  enum Field : size_type {
+    kSumValues,
+    kSumSq,
+    kSumWeights,
+    kSumWeights2,
+    kEntries,
+    kMin,
+    kMax,
+    kNFields,
+    kCompensationValues = kNFields,
+    kCompensationSq,
+    kCompensationWeights,
+    kNCompensatedFields
+  };
+
+  StatisticArray() = default;
+  explicit StatisticArray(size_type size, Storage storage = Storage::kFull) : storage_(storage) { resize(size); }
+
+  size_type size() const { return size_; }
+
+  /**
+   * Resizes the array. The existing statistics are kept, new ones are empty.
+   * @param size new number of statistics
+   */
+  void resize(size_type size) {
+    if (size==size_) return;
+    if (storage_==Storage::kSumsFloat) {
+      std::vector<float> data(kNCompactFields*size, 0.f);
+      const auto n = std::min(size, size_);
+      for (size_type field = 0; field < kNCompactFields; ++field) {
+        std::copy_n(float_data_.begin() + field*size_, n, data.begin() + field*size);
+      }
+      float_data_ = std::move(data);
+      size_ = size;
+      return;
+    }
+    std::vector<double> data(NFields()*size);
+    const auto n = std::min(size, size_);
+    for (size_type field = 0; field < NFields(); ++field) {
+      const auto target = data.begin() + field*size;
+      std::copy_n(data_.begin() + field*size_, n, target);
+      std::fill(target + n, target + size, EmptyValue(field));
+    }
+    data_ = std::move(data);
+    size_ = size;
+  }
+
+  Storage GetStorage() const { return storage_; }
+
+  /**
+   * Estimates the memory allocated for the fields of an array.
+   * @param size number of statistics
+   * @param storage storage of the statistics
+   * @param accumulation accumulation mode
+   * @return allocated bytes
+   */
+  static std::size_t EstimateHeapBytes(size_type size, Storage storage, Accumulation accumulation) {
+    if (storage==Storage::kSumsFloat) return size*kNCompactFields*sizeof(float);
+    if (storage==Storage::kSums) return size*kNCompactFields*sizeof(double);
+    const auto n_fields = accumulation==Accumulation::kCompensatedRawMoments ? kNCompensatedFields : kNFields;
+    return size*n_fields*sizeof(double);
+  }
+
+  /**
+   * Sets the storage. Already filled statistics are converted to the new storage. Converting to a compact storage
+   * drops all fields except the sums needed for the mean.
+   * @param storage storage of the statistics
+   */
+  void SetStorage(Storage storage) {
+    if (storage==storage_) return;
+    StatisticArray converted;
+    converted.storage_ = storage;
+    converted.accumulation_ = accumulation_;
+    converted.resize(size_);
+    for (size_type i = 0; i < size_; ++i) {
+      converted.Set(i, Get(i));
+    }
+    *this = std::move(converted);
+  }
+
+  Accumulation GetAccumulation() const { return accumulation_; }
+
+  /**
+   * Sets the accumulation mode. Already filled statistics are converted to the new mode.
+   * @param accumulation accumulation mode
+   */
+  void SetAccumulation(Accumulation accumulation) {
+    if (accumulation==accumulation_) return;
+    StatisticArray converted;
+    converted.storage_ = storage_;
+    converted.accumulation_ = accumulation;
+    converted.resize(size_);
+    for (size_type i = 0; i < size_; ++i) {
+      converted.Set(i, Get(i));
+    }
+    *this = std::move(converted);
+  }
+
+  /**
+   * Fills a value into the statistic i. Equivalent to Statistic::Fill.
+   * @param i position of the statistic
+   * @param value value
+   * @param weight weight
+   */
+  void Fill(size_type i, double value, double weight) {
+    if (weight==0) return;
+    if (storage_==Storage::kSumsFloat) {
+      float_data_[i] += value*weight;
+      float_data_[size_ + i] += weight;
+      return;
+    }
+    if (storage_==Storage::kSums) {
+      data_[i] += value*weight;
+      data_[size_ + i] += weight;
+      return;
+    }
+    double *field = data_.data() + i;
+    field[kEntries*size_] += 1.;
+    const auto newvalue = value*weight;
+    if (accumulation_==Accumulation::kRawMoments) {
+      field[kSumWeights*size_] += weight;
+      field[kSumValues*size_] += newvalue;
+      field[kSumSq*size_] += newvalue*value;
+      field[kSumWeights2*size_] += weight*weight;
+      return;
+    }
+    if (accumulation_==Accumulation::kCompensatedRawMoments) {
+      CompensatedAdd(field[kSumWeights*size_], field[kCompensationWeights*size_], weight);
+      CompensatedAdd(field[kSumValues*size_], field[kCompensationValues*size_], newvalue);
+      CompensatedAdd(field[kSumSq*size_], field[kCompensationSq*size_], newvalue*value);
+      field[kSumWeights2*size_] += weight*weight;
+      return;
+    }
+    field[kMin*size_] = std::min(field[kMin*size_], value);
+    field[kMax*size_] = std::max(field[kMax*size_], value);
+    const auto old_weights = field[kSumWeights*size_];
+    const auto sum_weights = old_weights + weight;
+    field[kSumWeights*size_] = sum_weights;
+    const auto num = weight*field[kSumValues*size_] - old_weights*newvalue;
+    if (old_weights!=0) field[kSumSq*size_] += num*num/(sum_weights*weight*old_weights);
+    field[kSumWeights2*size_] += weight*weight;
+    field[kSumValues*size_] += newvalue;
+  }
+
+  /**
+   * Fills a value into all statistics, each with its own multiplicity. A multiplicity of k is a single weighted
+   * update, which is equal to k repeated fills of the value. Statistics with zero multiplicity are masked, such that
+   * the loop over the statistics is free of branches and can be vectorized.
+   * @tparam MULTIPLICITIES container of the multiplicities
+   * @param value value
+   * @param weight weight
+   * @param multiplicities multiplicity of the value for every statistic
+   */
+  template<typename MULTIPLICITIES>
+  void FillMultiplicities(const double value, const double weight, const MULTIPLICITIES &multiplicities) {
+    if (weight==0) return;
+    const auto n = std::min(size_, static_cast<size_type>(multiplicities.size()));
+    if (storage_==Storage::kSumsFloat) {
+      FillSums(n, value, weight, multiplicities.data(), float_data_.data(), float_data_.data() + size_);
+      return;
+    }
+    if (storage_==Storage::kSums) {
+      FillSums(n, value, weight, multiplicities.data(), data_.data(), data_.data() + size_);
+      return;
+    }
+    switch (accumulation_) {
+      case Accumulation::kIncremental :
+        FillMultiplicities(n, value, weight, multiplicities.data(),
+                           GetField(kSumValues), GetField(kSumSq), GetField(kSumWeights), GetField(kSumWeights2),
+                           GetField(kEntries), GetField(kMin), GetField(kMax));
+        break;
+      case Accumulation::kRawMoments :
+        FillRawMoments(n, value, weight, multiplicities.data(),
+                       GetField(kSumValues), GetField(kSumSq), GetField(kSumWeights), GetField(kSumWeights2),
+                       GetField(kEntries));
+        break;
+      case Accumulation::kCompensatedRawMoments :
+        FillCompensatedRawMoments(n, value, weight, multiplicities.data(),
+                                  GetField(kSumValues), GetField(kSumSq), GetField(kSumWeights),
+                                  GetField(kSumWeights2), GetField(kEntries), GetField(kCompensationValues),
+                                  GetField(kCompensationSq), GetField(kCompensationWeights));
+        break;
+    }
+  }
+
+  double SumWeights(size_type i) const { return Sum(kSumWeights, kCompensationWeights, i); }
+
+  double Mean(size_type i) const {
+    const auto sum_weights = SumWeights(i);
+    return sum_weights > 0 ? Sum(kSumValues, kCompensationValues, i)/sum_weights : 0.0;
+  }
+
+  /**
+   * Returns the statistic i. In the raw moment modes the sum of squares is converted to the sum of squared
+   * deviations from the mean.
+   * @param i position of the statistic
+   * @return statistic
+   */
+  Statistic Get(size_type i) const {
+    Statistic statistic;
+    if (storage_!=Storage::kFull) {
+      statistic.sum_values_ = Sum(kSumValues, kCompensationValues, i);
+      statistic.sum_weights_ = Sum(kSumWeights, kCompensationWeights, i);
+      return statistic;
+    }
+    statistic.sum_values_ = Sum(kSumValues, kCompensationValues, i);
+    statistic.sum_weights_ = Sum(kSumWeights, kCompensationWeights, i);
+    statistic.sum_weights2_ = data_[kSumWeights2*size_ + i];
+    statistic.n_entries_ = data_[kEntries*size_ + i];
+    statistic.min_ = data_[kMin*size_ + i];
+    statistic.max_ = data_[kMax*size_ + i];
+    statistic.sum_sq_ = Sum(kSumSq, kCompensationSq, i);
+    if (accumulation_!=Accumulation::kIncremental) {
+      statistic.sum_sq_ = statistic.sum_weights_!=0. ?
+                          std::max(0., statistic.sum_sq_
+                              - statistic.sum_values_*statistic.sum_values_/statistic.sum_weights_) : 0.;
+    }
+    return statistic;
+  }
+
+  /**
+   * Sets the statistic i.
+   * @param i position of the statistic
+   * @param statistic statistic
+   */
+  void Set(size_type i, const Statistic &statistic) {
+    if (storage_==Storage::kSumsFloat) {
+      float_data_[i] = static_cast<float>(statistic.sum_values_);
+      float_data_[size_ + i] = static_cast<float>(statistic.sum_weights_);
+      return;
+    }
+    if (storage_==Storage::kSums) {
+      data_[i] = statistic.sum_values_;
+      data_[size_ + i] = statistic.sum_weights_;
+      return;
+    }
+    data_[kSumValues*size_ + i] = statistic.sum_values_;
+    data_[kSumSq*size_ + i] = statistic.sum_sq_;
+    data_[kSumWeights*size_ + i] = statistic.sum_weights_;
+    data_[kSumWeights2*size_ + i] = statistic.sum_weights2_;
+    data_[kEntries*size_ + i] = statistic.n_entries_;
+    data_[kMin*size_ + i] = statistic.min_;
+    data_[kMax*size_ + i] = statistic.max_;
+    if (accumulation_!=Accumulation::kIncremental && statistic.sum_weights_!=0.) {
+      data_[kSumSq*size_ + i] += statistic.sum_values_*statistic.sum_values_/statistic.sum_weights_;
+    }
+    if (accumulation_==Accumulation::kCompensatedRawMoments) {
+      data_[kCompensationValues*size_ + i] = 0.;
+      data_[kCompensationSq*size_ + i] = 0.;
+      data_[kCompensationWeights*size_ + i] = 0.;
+    }
+  }
+
+  /**
+   * Merges the statistics of the other array into the statistics at the same positions. Equivalent to MergeInto
+   * of each Statistic. Needs to have at least the size of the other array. In the raw moment modes the merge is
+   * the sum of the fields.
+   * @param other merged array
+   */
+  void MergeInto(const StatisticArray &other) {
+    if (&other==this) {
+      const StatisticArray copy(other);
+      MergeInto(copy);
+      return;
+    }
+    const auto n = std::min(size_, other.size_);
+    if (other.storage_==storage_ && storage_!=Storage::kFull) {
+      if (storage_==Storage::kSumsFloat) {
+        AddSums(n, float_data_.data(), other.float_data_.data(), size_, other.size_);
+      } else {
+        AddSums(n, data_.data(), other.data_.data(), size_, other.size_);
+      }
+      return;
+    }
+    if (other.storage_!=storage_ || other.accumulation_!=accumulation_) {
+      for (size_type i = 0; i < n; ++i) {
+        auto statistic = Get(i);
+        Qn::MergeInto(statistic, other.Get(i));
+        Set(i, statistic);
+      }
+      return;
+    }
+    double *sum_values = GetField(kSumValues);
+    double *sum_sq = GetField(kSumSq);
+    double *sum_weights = GetField(kSumWeights);
+    double *sum_weights2 = GetField(kSumWeights2);
+    double *entries = GetField(kEntries);
+    double *min = GetField(kMin);
+    double *max = GetField(kMax);
+    const double *other_sum_values = other.GetField(kSumValues);
+    const double *other_sum_sq = other.GetField(kSumSq);
+    const double *other_sum_weights = other.GetField(kSumWeights);
+    const double *other_sum_weights2 = other.GetField(kSumWeights2);
+    const double *other_entries = other.GetField(kEntries);
+    const double *other_min = other.GetField(kMin);
+    const double *other_max = other.GetField(kMax);
+    if (accumulation_==Accumulation::kIncremental) {
+      for (size_type i = 0; i < n; ++i) {
+        const double lhs_sum_weights = sum_weights[i];
+        const double num = other_sum_weights[i]*sum_values[i] - sum_weights[i]*other_sum_values[i];
+        sum_weights[i] += other_sum_weights[i];
+        entries[i] += other_entries[i];
+        sum_weights2[i] += other_sum_weights2[i];
+        sum_values[i] += other_sum_values[i];
+        max[i] = std::max(max[i], other_max[i]);
+        min[i] = std::min(min[i], other_min[i]);
+        sum_sq[i] = sum_sq[i] + other_sum_sq[i];
+        if (lhs_sum_weights!=0. && other_sum_weights[i]!=0. && sum_weights[i]!=0.) {
+          sum_sq[i] += (num*num)/(lhs_sum_weights*other_sum_weights[i]*sum_weights[i]);
+        }
+      }
+      return;
+    }
+    for (size_type i = 0; i < n; ++i) {
+      sum_weights2[i] += other_sum_weights2[i];
+      entries[i] += other_entries[i];
+      max[i] = std::max(max[i], other_max[i]);
+      min[i] = std::min(min[i], other_min[i]);
+    }
+    if (accumulation_==Accumulation::kRawMoments) {
+      for (size_type i = 0; i < n; ++i) {
+        sum_weights[i] += other_sum_weights[i];
+        sum_values[i] += other_sum_values[i];
+        sum_sq[i] += other_sum_sq[i];
+      }
+      return;
+    }
+    for (auto field : {kSumValues, kSumSq, kSumWeights}) {
+      const auto compensation = static_cast<Field>(field + kCompensationValues);
+      double *sum = GetField(field);
+      double *sum_compensation = GetField(compensation);
+      const double *other_sum = other.GetField(field);
+      const double *other_compensation = other.GetField(compensation);
+      for (size_type i = 0; i < n; ++i) {
+        CompensatedAdd(sum[i], sum_compensation[i], other_sum[i]);
+        sum_compensation[i] += other_compensation[i];
+      }
+    }
+  }
+
+  /**
+   * Replaces the statistics by a vector of statistics, which is the layout of the files written before the
+   * structure of arrays. The storage and the accumulation mode are kept.
+   * @param statistics statistics
+   */
+  void Assign(const std::vector<Statistic> &statistics) {
+    StatisticArray converted;
+    converted.storage_ = storage_;
+    converted.accumulation_ = accumulation_;
+    converted.resize(statistics.size());
+    for (size_type i = 0; i < statistics.size(); ++i) {
+      converted.Set(i, statistics[i]);
+    }
+    *this = std::move(converted);
+  }
+
+  /**
+   * Appends the statistics of the other array.
+   * @param other appended array
+   */
+  void Append(const StatisticArray &other) {
+    StatisticArray copy(other);
+    copy.SetStorage(storage_);
+    copy.SetAccumulation(accumulation_);
+    const auto old_size = size_;
+    resize(size_ + copy.size_);
+    if (storage_==Storage::kSumsFloat) {
+      for (size_type field = 0; field < kNCompactFields; ++field) {
+        std::copy_n(copy.float_data_.begin() + field*copy.size_, copy.size_,
+                    float_data_.begin() + field*size_ + old_size);
+      }
+      return;
+    }
+    for (size_type field = 0; field < NFields(); ++field) {
+      std::copy_n(copy.data_.begin() + field*copy.size_, copy.size_, data_.begin() + field*size_ + old_size);
+    }
+  }
+
+ private:
+  static constexpr size_type kNCompactFields = 2; ///< number of fields of the compact storages
+
+  double *GetField(Field field) { return data_.data() + field*size_; }
+  const double *GetField(Field field) const { return data_.data() + field*size_; }
+
+  /**
+   * Kernel of the multiplicity weighted fill of the compact storages.
+   */
+  template<typename T, typename MULTIPLICITY>
+  static void FillSums(const size_type n, const double value, const double weight,
+                       const MULTIPLICITY *__restrict k, T *__restrict sum_values, T *__restrict sum_weights) {
+    const T newvalue = value*weight;
+    const T added_weight = weight;
+    for (size_type i = 0; i < n; ++i) {
+      const T multiplicity = static_cast<T>(k[i]);
+      sum_values[i] += multiplicity*newvalue;
+      sum_weights[i] += multiplicity*added_weight;
+    }
+  }
+
+  /**
+   * Merge of the compact storages.
+   */
+  template<typename T>
+  static void AddSums(const size_type n, T *__restrict sums, const T *__restrict other_sums,
+                      const size_type size, const size_type other_size) {
+    for (size_type field = 0; field < kNCompactFields; ++field) {
+      T *sum = sums + field*size;
+      const T *other_sum = other_sums + field*other_size;
+      for (size_type i = 0; i < n; ++i) {
+        sum[i] += other_sum[i];
+      }
+    }
+  }
+
+  /**
+   * Kernel of the multiplicity weighted fill. The fields do not overlap, which is stated with __restrict such that
+   * the compiler does not need to check for aliasing before vectorizing the loop.
+   */
+  template<typename MULTIPLICITY>
+  static void FillMultiplicities(const size_type n, const double value, const double weight,
+                                 const MULTIPLICITY *__restrict k,
+                                 double *__restrict sum_values, double *__restrict sum_sq,
+                                 double *__restrict sum_weights, double *__restrict sum_weights2,
+                                 double *__restrict entries, double *__restrict min, double *__restrict max) {
+    const double weight2 = weight*weight;
+    const double newvalue = value*weight;
+    for (size_type i = 0; i < n; ++i) {
+      const double multiplicity = static_cast<double>(k[i]);
+      const double added_weights = multiplicity*weight;
+      const double old_weights = sum_weights[i];
+      const double new_weights = old_weights + added_weights;
+      const double num = added_weights*(sum_values[i] - old_weights*value);
+      const double denominator = old_weights*added_weights*new_weights;
+      const double update = denominator!=0. ? 1. : 0.;
+      sum_sq[i] += update*(num*num/(denominator + (1. - update)));
+      sum_weights[i] = new_weights;
+      sum_weights2[i] += multiplicity*weight2;
+      sum_values[i] += multiplicity*newvalue;
+      entries[i] += multiplicity;
+      min[i] = std::min(min[i], multiplicity > 0. ? value : EmptyValue(kMin));
+      max[i] = std::max(max[i], multiplicity > 0. ? value : EmptyValue(kMax));
+    }
+  }
+
+  /**
+   * Kernel of the multiplicity weighted fill of the raw moments.
+   */
+  template<typename MULTIPLICITY>
+  static void FillRawMoments(const size_type n, const double value, const double weight,
+                             const MULTIPLICITY *__restrict k,
+                             double *__restrict sum_values, double *__restrict sum_sq,
+                             double *__restrict sum_weights, double *__restrict sum_weights2,
+                             double *__restrict entries) {
+    const double weight2 = weight*weight;
+    const double newvalue = value*weight;
+    const double newsq = newvalue*value;
+    for (size_type i = 0; i < n; ++i) {
+      const double multiplicity = static_cast<double>(k[i]);
+      sum_weights[i] += multiplicity*weight;
+      sum_values[i] += multiplicity*newvalue;
+      sum_sq[i] += multiplicity*newsq;
+      sum_weights2[i] += multiplicity*weight2;
+      entries[i] += multiplicity;
+    }
+  }
+
+  /**
+   * Kernel of the multiplicity weighted fill of the raw moments with compensated sums.
+   */
+  template<typename MULTIPLICITY>
+  static void FillCompensatedRawMoments(const size_type n, const double value, const double weight,
+                                        const MULTIPLICITY *__restrict k,
+                                        double *__restrict sum_values, double *__restrict sum_sq,
+                                        double *__restrict sum_weights, double *__restrict sum_weights2,
+                                        double *__restrict entries, double *__restrict compensation_values,
+                                        double *__restrict compensation_sq, double *__restrict compensation_weights) {
+    const double weight2 = weight*weight;
+    const double newvalue = value*weight;
+    const double newsq = newvalue*value;
+    for (size_type i = 0; i < n; ++i) {
+      const double multiplicity = static_cast<double>(k[i]);
+      CompensatedAdd(sum_weights[i], compensation_weights[i], multiplicity*weight);
+      CompensatedAdd(sum_values[i], compensation_values[i], multiplicity*newvalue);
+      CompensatedAdd(sum_sq[i], compensation_sq[i], multiplicity*newsq);
+      sum_weights2[i] += multiplicity*weight2;
+      entries[i] += multiplicity;
+    }
+  }
+
+  /**
+   * Compensated (Neumaier) summation. Adds the value to the sum and the rounding error to the compensation.
+   * @param sum sum
+   * @param compensation accumulated rounding error of the sum
+   * @param value added value
+   */
+  static void CompensatedAdd(double &sum, double &compensation, const double value) {
+    const double total = sum + value;
+    compensation += std::abs(sum) >= std::abs(value) ? (sum - total) + value : (value - total) + sum;
+    sum = total;
+  }
+
+  /**
+   * Returns the sum of a field including its compensation term.
+   * @param field field
+   * @param compensation compensation field
+   * @param i position of the statistic
+   * @return sum
+   */
+  double Sum(Field field, Field compensation, size_type i) const {
+    if (storage_!=Storage::kFull) {
+      const auto position = (field==kSumValues ? 0 : size_) + i;
+      return storage_==Storage::kSumsFloat ? float_data_[position] : data_[position];
+    }
+    if (accumulation_==Accumulation::kCompensatedRawMoments) {
+      return data_[field*size_ + i] + data_[compensation*size_ + i];
+    }
+    return data_[field*size_ + i];
+  }
+
+  size_type NFields() const {
+    if (storage_!=Storage::kFull) return kNCompactFields;
+    return accumulation_==Accumulation::kCompensatedRawMoments ? kNCompensatedFields : kNFields;
+  }
+
+  /**
+   * Value of a field of an empty statistic.
+   * @param field field
+   * @return value
+   */
+  static double EmptyValue(size_type field) {
+    if (field==kMin) return std::numeric_limits<double>::max();
+    if (field==kMax) return std::numeric_limits<double>::min();
+    return 0.;
+  }
+
+  Storage storage_ = Storage::kFull; ///< storage of the statistics
+  Accumulation accumulation_ = Accumulation::kIncremental; ///< accumulation mode
+  size_type size_ = 0;     ///< number of statistics
+  std::vector<double> data_; ///< fields of the statistics ordered by field and statistic
+  std::vector<float> float_data_; ///< fields of the statistics in the float storage
+
+  /// \cond CLASSIMP
+ ClassDefNV(StatisticArray, 3);
+  /// \endcond
+};
+}
+
+#endif //FLOW_STATISTICARRAY_H
@@ -18,6 +18,7 @@
 #ifndef FLOW_STATS_H
 #define FLOW_STATS_H
 
+#include <array>
 #include <vector>
 #include <iostream>
 #include <bitset>
@@ -99,10 +100,11 @@ class Stats {
   double LowerMeanError() const {
     double lower_error = 0;
     if (bits_ & Settings::ASYMMERRORS) {
-      double mean = mean_;
-      if (state_!=State::MEAN_ERROR) { mean = statistic_.Mean(); }
-      auto ci = resamples_.GetConfidenceInterval(mean, ReSamples::CIMethod::pivot);
-      lower_error = mean - ci.lower_limit;
+      if (state_!=State::MEAN_ERROR) {
+        lower_error = statistic_.Mean() - MomentsInterval(ReSamples::CIMethod::pivot).lower_limit;
+      } else {
+        lower_error = mean_ - resamples_.GetConfidenceInterval(mean_, ReSamples::CIMethod::pivot).lower_limit;
+      }
     } else {
       lower_error = MeanError();
     }
@@ -112,10 +114,11 @@ class Stats {
   double UpperMeanError() const {
     double upper_error = 0;
     if (bits_ & Settings::ASYMMERRORS) {
-      double mean = mean_;
-      if (state_!=State::MEAN_ERROR) { mean = statistic_.Mean(); }
-      auto ci = resamples_.GetConfidenceInterval(mean, ReSamples::CIMethod::pivot);
-      upper_error = ci.upper_limit - mean;
+      if (state_!=State::MEAN_ERROR) {
+        upper_error = MomentsInterval(ReSamples::CIMethod::pivot).upper_limit - statistic_.Mean();
+      } else {
+        upper_error = resamples_.GetConfidenceInterval(mean_, ReSamples::CIMethod::pivot).upper_limit - mean_;
+      }
     } else {
       upper_error = MeanError();
     }
@@ -148,11 +151,13 @@ class Stats {
     return error;
   }
 
+  /**
+   * Returns the bootstrap uncertainty of the mean. In the state MOMENTS it is calculated on the first access and
+   * kept until the Stats is filled or merged, such that reading a result does not need CalculateMeanAndError.
+   */
   double MeanErrorBoot() const {
     if (state_!=State::MEAN_ERROR) {
-      auto t_samples = resamples_;
-      t_samples.CalculateMeans();
-      return t_samples.GetConfidenceInterval(statistic_.Mean(), ReSamples::CIMethod::normal).Uncertainty();
+      return MomentsInterval(ReSamples::CIMethod::normal).Uncertainty();
     } else  {
       return resamples_.GetConfidenceInterval(mean_, ReSamples::CIMethod::normal).Uncertainty();
     }
@@ -168,7 +173,18 @@ class Stats {
     }
   }
 
+  /**
+   * In-place arithmetic. The Stats is converted to the state MEAN_ERROR.
+   * Identical to the corresponding binary operators, but avoids copying the bootstrap samples.
+   */
+  Stats &operator+=(const Stats &);
+  Stats &operator-=(const Stats &);
+  Stats &operator*=(const Stats &);
+  Stats &operator/=(const Stats &);
+  Stats &operator*=(double);
+
   friend Stats Merge(const Stats &, const Stats &);
+  friend void MergeInto(Stats &, const Stats &);
   friend Stats MergeBins(const Stats &, const Stats &);
   friend Stats operator+(const Stats &, const Stats &);
   friend Stats operator-(const Stats &, const Stats &);
@@ -196,10 +212,83 @@ class Stats {
     }
   }
 
-  void SetNumberOfReSamples(size_type nsamples) {
-    resamples_.SetNumberOfSamples(nsamples);
+  /**
+   * Fills a valid result of an event.
+   * @param value value of the correlation
+   * @param weight weight of the correlation
+   * @param samples multiplicities of the event in the bootstrap samples
+   */
+  template<typename SAMPLES>
+  inline void FillPoisson(const double value, const double weight, SAMPLES &&samples) {
+    resamples_.FillPoisson(value, weight, std::forward<SAMPLES>(samples));
+    statistic_.Fill(value, weight);
+  }
+
+  /**
+   * Fills the valid results of all bins of a correlation of an event into consecutive Stats.
+   * @param bins first of the consecutive Stats
+   * @param results results of the event
+   * @param samples multiplicities of the event in the bootstrap samples
+   */
+  template<typename SAMPLES>
+  static void FillPoisson(Stats *bins, const CorrelationResultBuffer &results, SAMPLES &&samples) {
+    results.ForEachValid([bins, &samples](std::size_t ibin, double value, double weight) {
+      bins[ibin].FillPoisson(value, weight, samples);
+    });
+  }
+
+  /**
+   * Fills a valid result of an event into a single sub-sample.
+   * @param value value of the correlation
+   * @param weight weight of the correlation
+   * @param sample sub-sample of the event
+   */
+  inline void FillSubSample(const double value, const double weight, const size_type sample) {
+    resamples_.FillSample(value, weight, sample);
+    statistic_.Fill(value, weight);
+  }
+
+  /**
+   * Fills the valid results of all bins of a correlation of an event into consecutive Stats. Only the sub-sample
+   * of the event is filled.
+   * @param bins first of the consecutive Stats
+   * @param results results of the event
+   * @param sample sub-sample of the event
+   */
+  static void FillSubSample(Stats *bins, const CorrelationResultBuffer &results, const size_type sample) {
+    results.ForEachValid([bins, sample](std::size_t ibin, double value, double weight) {
+      bins[ibin].FillSubSample(value, weight, sample);
+    });
+  }
+
+  /**
+   * Sets the resampling method of the samples.
+   * @param method resampling method
+   */
+  void SetReSamplingMethod(ReSamples::Method method) { resamples_.SetMethod(method); }
+
+  void SetNumberOfReSamples(size_type nsamples, ReSamples::Storage storage = ReSamples::Storage::kFull) {
+    resamples_.SetNumberOfSamples(nsamples, storage);
   }
 
+  /**
+   * Estimates the memory of a Stats including its resamples.
+   * @param nsamples number of resamples
+   * @param storage storage of the resamples
+   * @param accumulation accumulation mode of the resamples
+   * @return resident bytes
+   */
+  static std::size_t EstimateBytes(size_type nsamples, ReSamples::Storage storage,
+                                   Statistic::Accumulation accumulation) {
+    return sizeof(Stats) + ReSamples::EstimateHeapBytes(nsamples, storage, accumulation);
+  }
+
+  /**
+   * Sets the accumulation mode of the bootstrap samples.
+   * @param accumulation accumulation mode
+   */
+  void SetAccumulation(Statistic::Accumulation accumulation) { resamples_.SetAccumulation(accumulation); }
+
   void SetWeights(Weights weights) { weights_flag = weights; }
   State GetState() const { return state_; }
 
@@ -210,11 +299,67 @@ class Stats {
   const Statistic &GetStatistic() const { return statistic_; }
 
   size_type GetNSamples() const { return resamples_.size(); }
+
+  /**
+   * Returns the number of resamples, for which the bootstrap uncertainty has converged. The pivot interval is used
+   * for asymmetric errors, otherwise the normal interval. Only available in the state MOMENTS.
+   * @param tolerance relative tolerance of the width of the confidence interval
+   * @param n_min minimum number of resamples
+   * @return converged number of resamples or the number of resamples if not converged
+   */
+  size_type ConvergedNumberOfReSamples(double tolerance, size_type n_min) const {
+    if (state_!=State::MOMENTS) return resamples_.size();
+    const auto method = (bits_ & Settings::ASYMMERRORS) ? ReSamples::CIMethod::pivot : ReSamples::CIMethod::normal;
+    return resamples_.ConvergedNumberOfSamples(statistic_.Mean(), tolerance, n_min, method);
+  }
+
+  /**
+   * Keeps only the first n resamples. They are no longer filled.
+   * @param n number of resamples
+   */
+  void TruncateReSamples(size_type n) { resamples_.Truncate(n); }
   const ReSamples &GetReSamples() const { return resamples_; }
 
   TCanvas *CIvsNSamples(const int nsteps = 10) const;
 
+  friend class StatsColumnarFile;
+
  private:
+  /**
+   * Confidence intervals of the samples in the state MOMENTS. They are identified by the number of entries, the
+   * sum of weights and the number of samples, which change whenever the Stats is filled or merged.
+   */
+  struct MomentsCache {
+    double n = -1.;
+    double sum_weights = 0.;
+    size_type n_samples = 0;
+    std::array<bool, 3> valid{};
+    std::array<ConfidenceInterval, 3> intervals{};
+  };
+
+  /**
+   * Returns the confidence interval of the means of the samples in the state MOMENTS, as it is calculated by
+   * CalculateMeanAndError. Calculated on the first access and cached afterwards. Not thread safe for concurrent
+   * reads of the same Stats.
+   * @param method method of the confidence interval
+   * @return confidence interval
+   */
+  const ConfidenceInterval &MomentsInterval(ReSamples::CIMethod method) const {
+    auto &cache = moments_cache_;
+    if (cache.n!=statistic_.N() || cache.sum_weights!=statistic_.SumWeights() || cache.n_samples!=resamples_.size()) {
+      cache = MomentsCache();
+      cache.n = statistic_.N();
+      cache.sum_weights = statistic_.SumWeights();
+      cache.n_samples = resamples_.size();
+    }
+    const auto imethod = static_cast<std::size_t>(method);
+    if (!cache.valid[imethod]) {
+      cache.intervals[imethod] = resamples_.GetConfidenceIntervalOfStatistics(statistic_.Mean(), method);
+      cache.valid[imethod] = true;
+    }
+    return cache.intervals[imethod];
+  }
+
   ReSamples resamples_;     /// resamples used for error calculation
   Statistic statistic_;     /// Used in the state of MOMENTS
   unsigned int bits_ = 0 | Qn::Stats::CORRELATEDERRORS; // configuration bits
@@ -225,6 +370,7 @@ class Stats {
   double mean_ = 0.; /// mean
   double error_ = 0.; /// uncertainty
   double weight_ = 0.; /// relative weight for rebinning
+  mutable MomentsCache moments_cache_; //!<! lazily calculated confidence intervals in the state MOMENTS
 
   /// \cond CLASSIMP
  ClassDef(Stats, 4);
@@ -233,6 +379,7 @@ class Stats {
 
 Stats MergeBins(const Stats &, const Stats &);
 Stats Merge(const Stats &, const Stats &);
+void MergeInto(Stats &, const Stats &);
 Stats operator+(const Stats &, const Stats &);
 Stats operator-(const Stats &, const Stats &);
 Stats operator*(const Stats &, const Stats &);
@@ -0,0 +1,206 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_BASE_INCLUDE_STATSCOLUMNARFILE_H_
+#define FLOW_BASE_INCLUDE_STATSCOLUMNARFILE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Axis.h"
+#include "DataContainer.h"
+#include "Stats.h"
+
+namespace Qn {
+/**
+ * @brief Layout of the columnar Stats file.
+ * The file starts with a header, followed by the axes, the directory of the axes and the columns of the bins. All
+ * offsets are given relative to the start of the file and are aligned to 8 bytes, such that the columns are used
+ * in place. Each column holds one value per bin in the linear order of the DataContainer. The means and the sums
+ * of weights of the samples are stored as [bin][sample] arrays, in which the bins with less samples are padded with
+ * empty samples.
+ */
+namespace StatsFileFormat {
+constexpr char kMagic[8] = {'Q', 'N', 'S', 'T', 'A', 'T', 'S', '\0'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::size_t kAlignment = 8;
+/**
+ * Columns of doubles
+ */
+enum Column : std::size_t {
+  kMean,        ///< mean
+  kErrorStat,   ///< statistical uncertainty of the mean
+  kWeight,      ///< relative weight for rebinning
+  kEntries,     ///< number of entries
+  kNeff,        ///< effective number of entries
+  kNColumns
+};
+/**
+ * Flags of a bin
+ */
+enum Flag : std::uint8_t {
+  kObservable = 1u << 0u,  ///< the weights of the bin are the weights of the observable
+  kMergeable = 1u << 1u,   ///< the written bin could be merged
+  kSubSamples = 1u << 2u   ///< the samples are sub-samples
+};
+struct Header {
+  char magic[8]; ///< identifies the file
+  std::uint32_t version; ///< version of the layout
+  std::uint32_t n_axes; ///< number of axes
+  std::uint64_t n_bins; ///< number of bins
+  std::uint64_t n_samples; ///< number of samples of each bin in the sample arrays
+  std::uint64_t axes_offset; ///< offset of the directory of the axes
+  std::uint64_t columns_offset[kNColumns]; ///< offsets of the columns
+  std::uint64_t bits_offset; ///< offset of the configuration bits (uint32) of the bins
+  std::uint64_t flags_offset; ///< offset of the flags (uint8) of the bins
+  std::uint64_t n_samples_offset; ///< offset of the number of samples (uint32) of the bins
+  std::uint64_t sample_means_offset; ///< offset of the means of the samples
+  std::uint64_t sample_weights_offset; ///< offset of the sums of weights of the samples
+};
+struct AxisRecord {
+  std::uint64_t name_offset; ///< offset of the name of the axis
+  std::uint64_t name_size; ///< size of the name of the axis
+  std::uint64_t n_bins; ///< number of bins of the axis
+  std::uint64_t edges_offset; ///< offset of the bin edges (double)
+};
+}
+
+/**
+ * @class StatsColumnarFile
+ * @brief Memory-mapped columnar file of a DataContainerStats.
+ * Reading a DataContainerStats with many samples from a ROOT file streams all Stats, ReSamples and Statistic objects
+ * through the dictionary. The columnar file stores the moments and the means of the samples of all bins in
+ * contiguous arrays instead. Only the header and the axes are read when the file is opened. The columns are
+ * accessed in place, such that the operating system loads only the pages of the bins which are used, e.g. by a
+ * projection or a ratio of a few bins.
+ *
+ * Qn::StatsColumnarFile::Write("v2.qnstats", container);
+ * Qn::StatsColumnarFile file;
+ * file.Open("v2.qnstats");
+ * auto ratio = file.GetStats(1)/file.GetStats(0);
+ */
+class StatsColumnarFile {
+ public:
+  using size_type = std::size_t;
+
+  StatsColumnarFile() = default;
+  ~StatsColumnarFile();
+  StatsColumnarFile(const StatsColumnarFile &) = delete;
+  StatsColumnarFile &operator=(const StatsColumnarFile &) = delete;
+
+  /**
+   * Writes a DataContainerStats to a columnar file. Stats in the state MOMENTS are written with the means of their
+   * samples, as CalculateMeanAndError would calculate them. The container is not modified.
+   * @param file_name name of the file
+   * @param container the container
+   */
+  static void Write(const std::string &file_name, const DataContainerStats &container);
+
+  /**
+   * Maps the file and reads the axes. The file is not kept open, if it is not valid.
+   * @param file_name name of the file
+   */
+  void Open(const std::string &file_name);
+
+  bool IsOpen() const { return mapped_!=nullptr; }
+
+  const std::vector<AxisD> &GetAxes() const { return axes_; }
+
+  /**
+   * Returns the number of bins.
+   */
+  size_type size() const { return header_->n_bins; }
+
+  /**
+   * Returns the number of samples of the sample arrays.
+   */
+  size_type GetNSamples() const { return header_->n_samples; }
+
+  /**
+   * Calculates the linear index of a bin from the indices of the axes.
+   * @param indices index of the bin on each axis
+   * @return linear index
+   */
+  size_type GetLinearIndex(const std::vector<size_type> &indices) const;
+
+  double Mean(size_type bin) const { return GetColumn(StatsFileFormat::kMean)[bin]; }
+  double MeanErrorStat(size_type bin) const { return GetColumn(StatsFileFormat::kErrorStat)[bin]; }
+  double Weight(size_type bin) const { return GetColumn(StatsFileFormat::kWeight)[bin]; }
+  double N(size_type bin) const { return GetColumn(StatsFileFormat::kEntries)[bin]; }
+  double Neff(size_type bin) const { return GetColumn(StatsFileFormat::kNeff)[bin]; }
+
+  /**
+   * Returns the number of samples of a bin.
+   */
+  size_type GetNSamples(size_type bin) const { return n_samples_[bin]; }
+
+  /**
+   * Returns the means of the samples of a bin, which are followed by the means of the next bin.
+   */
+  const double *SampleMeans(size_type bin) const { return sample_means_ + bin*header_->n_samples; }
+
+  /**
+   * Returns the sums of weights of the samples of a bin.
+   */
+  const double *SampleWeights(size_type bin) const { return sample_weights_ + bin*header_->n_samples; }
+
+  /**
+   * Reads the Stats of a bin. The Stats is in the state MEAN_ERROR, such that the uncertainties and the
+   * arithmetic behave as for the written Stats after CalculateMeanAndError. The number of entries and the effective
+   * number of entries are restored from their columns. The moments of the samples are not stored, therefore the
+   * Stats is not mergeable.
+   * @param bin linear index of the bin
+   * @return the Stats
+   */
+  Stats GetStats(size_type bin) const;
+
+  /**
+   * Reads all bins into a DataContainerStats. The bins are not mergeable, see GetStats.
+   * @return the container
+   */
+  DataContainerStats ToDataContainer() const;
+
+ private:
+  const double *GetColumn(StatsFileFormat::Column column) const {
+    return reinterpret_cast<const double *>(mapped_ + header_->columns_offset[column]);
+  }
+
+  /**
+   * Validates the mapped file and reads the axes.
+   * @param file_name name of the file used in the messages
+   */
+  void ReadLayout(const std::string &file_name);
+
+  /**
+   * Unmaps the file and clears the axes.
+   */
+  void Unmap();
+
+  const char *mapped_ = nullptr; ///< the mapped file
+  std::size_t size_ = 0; ///< size of the mapping
+  const StatsFileFormat::Header *header_ = nullptr; ///< header of the file
+  const std::uint32_t *bits_ = nullptr; ///< configuration bits of the bins
+  const std::uint8_t *flags_ = nullptr; ///< flags of the bins
+  const std::uint32_t *n_samples_ = nullptr; ///< number of samples of the bins
+  const double *sample_means_ = nullptr; ///< means of the samples
+  const double *sample_weights_ = nullptr; ///< sums of weights of the samples
+  std::vector<AxisD> axes_; ///< axes of the container
+  std::vector<size_type> stride_; ///< strides of the axes in the linear index
+};
+}
+
+#endif //FLOW_BASE_INCLUDE_STATSCOLUMNARFILE_H_
@@ -0,0 +1,115 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_BASE_INCLUDE_STATSFILLBATCH_H_
+#define FLOW_BASE_INCLUDE_STATSFILLBATCH_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "CorrelationResult.h"
+#include "Stats.h"
+
+namespace Qn {
+/**
+ * @class StatsFillBatch
+ * @brief Buffers the bootstrap fills of a batch of events and applies them bin by bin.
+ * Filling an event updates the samples of all valid bins, such that for large correlations every event streams the
+ * samples of the whole result through the cache. The batch stores the valid results and the sample multiplicities
+ * of the events and fills them at Flush ordered by bin. The samples of a bin are loaded once per batch and stay in
+ * the cache for all events of the batch. The events are filled into each bin in their original order, such that the
+ * result is identical to filling every event directly. Only the bootstrap fill with multiplicities is buffered.
+ * Each slot uses its own batch, which is aligned to a cache line.
+ */
+class alignas(64) StatsFillBatch {
+ public:
+  using size_type = std::size_t;
+
+  /**
+   * Constructor
+   * @param capacity number of events of a batch
+   */
+  explicit StatsFillBatch(size_type capacity = 64) : capacity_(std::max<size_type>(capacity, 1)) {}
+
+  /**
+   * Adds the valid results of all bins of a correlation of an event. Fills the batch, if it is full.
+   * @param bins first of the consecutive Stats of the event, which need to stay valid until the next Flush
+   * @param results results of the event
+   * @param samples multiplicities of the event in the bootstrap samples
+   */
+  template<typename SAMPLES>
+  void Add(Stats *bins, const CorrelationResultBuffer &results, const SAMPLES &samples) {
+    const auto event = static_cast<std::uint32_t>(sample_offsets_.size());
+    sample_offsets_.push_back(multiplicities_.size());
+    multiplicities_.insert(multiplicities_.end(), samples.begin(), samples.end());
+    results.ForEachValid([this, bins, event](size_type ibin, double value, double weight) {
+      entries_.push_back({bins + ibin, value, weight, event});
+    });
+    if (sample_offsets_.size() >= capacity_) Flush();
+  }
+
+  /**
+   * Fills all buffered events into their bins. To be called before the bins are read or merged.
+   */
+  void Flush() {
+    std::stable_sort(entries_.begin(), entries_.end(), [](const Entry &a, const Entry &b) {
+      return std::less<const Stats *>()(a.bin, b.bin);
+    });
+    sample_offsets_.push_back(multiplicities_.size());
+    for (const auto &entry : entries_) {
+      const auto first = sample_offsets_[entry.event];
+      const Multiplicities samples{multiplicities_.data() + first, sample_offsets_[entry.event + 1] - first};
+      entry.bin->FillPoisson(entry.value, entry.weight, samples);
+    }
+    entries_.clear();
+    multiplicities_.clear();
+    sample_offsets_.clear();
+  }
+
+  size_type GetCapacity() const { return capacity_; }
+  size_type GetNumberOfEvents() const { return sample_offsets_.size(); }
+
+ private:
+  /**
+   * Valid result of a bin in an event.
+   */
+  struct Entry {
+    Stats *bin; ///< filled bin
+    double value; ///< value of the correlation
+    double weight; ///< weight of the correlation
+    std::uint32_t event; ///< event in the batch
+  };
+
+  /**
+   * Multiplicities of an event in the buffer as used by StatisticArray::FillMultiplicities.
+   */
+  struct Multiplicities {
+    const std::uint8_t *first;
+    size_type n;
+    const std::uint8_t *data() const { return first; }
+    size_type size() const { return n; }
+  };
+
+  size_type capacity_ = 64; ///< number of events of a batch
+  std::vector<Entry> entries_; ///< valid results of the buffered events
+  std::vector<std::uint8_t> multiplicities_; ///< sample multiplicities of the buffered events
+  std::vector<size_type> sample_offsets_; ///< offset of the multiplicities of each event
+};
+}
+
+#endif //FLOW_BASE_INCLUDE_STATSFILLBATCH_H_
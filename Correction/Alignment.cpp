@@ -65,13 +65,10 @@ void Alignment::CreateSupportQVectors() {
   } else {
     throw std::logic_error("Correctionstep not configured. Please add detector for alignment.");
   }
-  /* make sure the alignment harmonic processing is active */
-  fSubEvent->GetDetector()->ActivateHarmonic(fHarmonicForAlignment);
-  /* in both configurations */
-  fDetectorForAlignment->GetDetector()->ActivateHarmonic(fHarmonicForAlignment);
+  /* the alignment harmonic is provided by both configurations, see GetRequiredInputHarmonics */
   fInputQnVector = fSubEvent->GetPreviousCorrectedQnVector(this);
   /* and now create the corrected Qn vector */
-  fCorrectedQnVector = std::make_unique<QVector>(fSubEvent->GetHarmonics(), QVector::CorrectionStep::ALIGNED,
+  fCorrectedQnVector = std::make_unique<QVector>(GetHarmonics(), QVector::CorrectionStep::ALIGNED,
                                                  fInputQnVector->GetNorm());
 }
 
@@ -101,6 +98,50 @@ void Alignment::CreateCorrectionHistograms() {
 void Alignment::AttachInput(TList *list) {
   if (fInputHistograms->AttachHistograms(list)) {
     fState = State::APPLYCOLLECT;
+    FillParameterTable();
+  }
+}
+
+/// Attaches the final correction parameters read from a calibration file
+///
+/// The parameters are only taken if they match the configured event
+/// classes and harmonics.
+/// \param parameters the table of the correction parameters
+void Alignment::AttachParameters(CorrectionParameterTable &&parameters) {
+  const auto harmonics = GetCorrectedHarmonicMap();
+  if (parameters.Matches(fSubEvent->GetEventClassVariablesSet().GetNumberOfBins(), harmonics, 3)) {
+    fParameters = std::move(parameters);
+    fState = State::APPLYCOLLECT;
+  }
+}
+
+/// Fills the correction parameters of each event class
+///
+/// The alignment angle is extracted from the attached correlation
+/// histograms. For each harmonic it is stored whether the correction is
+/// significant and the cosine and sine of the rotation.
+void Alignment::FillParameterTable() {
+  const auto harmonics = GetCorrectedHarmonicMap();
+  const Long64_t nBins = fSubEvent->GetEventClassVariablesSet().GetNumberOfBins();
+  fParameters.Initialize(nBins, harmonics, 3);
+  for (Long64_t bin = 0; bin < nBins; bin++) {
+    if (!fInputHistograms->BinContentValidated(bin)) continue;
+    Double_t XX = fInputHistograms->GetXXBinContent(bin);
+    Double_t YY = fInputHistograms->GetYYBinContent(bin);
+    Double_t XY = fInputHistograms->GetXYBinContent(bin);
+    Double_t YX = fInputHistograms->GetYXBinContent(bin);
+    Double_t eXY = fInputHistograms->GetXYBinError(bin);
+    Double_t eYX = fInputHistograms->GetYXBinError(bin);
+    Double_t deltaPhi = -TMath::ATan2((XY - YX), (XX + YY))*(1.0/fHarmonicForAlignment);
+    /* significant correction? */
+    const Bool_t significant = !(TMath::Sqrt((XY - YX)*(XY - YX)/(eXY*eXY + eYX*eYX)) < 2.0);
+    for (auto harmonic : harmonics) {
+      fParameters.SetValidated(bin, harmonic, kTRUE);
+      auto parameters = fParameters.EditParameters(bin, harmonic);
+      parameters[0] = significant ? 1.0 : 0.0;
+      parameters[1] = TMath::Cos(((Double_t) harmonic)*deltaPhi);
+      parameters[2] = TMath::Sin(((Double_t) harmonic)*deltaPhi);
+    }
   }
 }
 
@@ -113,10 +154,10 @@ void Alignment::AttachQAHistograms(TList *list) {
   auto hname = std::string(szQAQnAverageHistogramName) + "_" + fSubEvent->GetName();
   fQAQnAverageHistogram =
       std::make_unique<CorrectionProfileComponents>(hname, fSubEvent->GetEventClassVariablesSet());
-  /* get information about the configured harmonics to pass it for histogram creation */
-  Int_t nNoOfHarmonics = fSubEvent->GetNoOfHarmonics();
+  /* get information about the provided harmonics to pass it for histogram creation */
+  Int_t nNoOfHarmonics = fCorrectedQnVector->GetNoOfHarmonics();
   auto harmonicsMap = new Int_t[nNoOfHarmonics];
-  fSubEvent->GetHarmonicMap(harmonicsMap);
+  fCorrectedQnVector->GetHarmonicsMap(harmonicsMap);
   fQAQnAverageHistogram->CreateComponentsProfileHistograms(list, nNoOfHarmonics, harmonicsMap);
   delete[] harmonicsMap;
 }
@@ -156,37 +197,28 @@ bool Alignment::ProcessCorrections() {
       if (fSubEvent->GetCurrentQnVector()->IsGoodQuality()) {
         /* we get the properties of the current Qn vector but its name */
         fCorrectedQnVector->CopyNumberOfContributors(*fSubEvent->GetCurrentQnVector());
-        /* let's check the correction histograms */
+        /* let's check the correction parameters */
         Long64_t bin = fInputHistograms->GetBin();
-        if (fInputHistograms->BinContentValidated(bin)) {
-          /* the bin content is validated so, apply the correction */
-          Double_t XX = fInputHistograms->GetXXBinContent(bin);
-          Double_t YY = fInputHistograms->GetYYBinContent(bin);
-          Double_t XY = fInputHistograms->GetXYBinContent(bin);
-          Double_t YX = fInputHistograms->GetYXBinContent(bin);
-          Double_t eXY = fInputHistograms->GetXYBinError(bin);
-          Double_t eYX = fInputHistograms->GetYXBinError(bin);
-          Double_t deltaPhi = -TMath::ATan2((XY - YX), (XX + YY))*(1.0/fHarmonicForAlignment);
-          /* significant correction? */
-          if (!(TMath::Sqrt((XY - YX)*(XY - YX)/(eXY*eXY + eYX*eYX)) < 2.0)) {
-            Int_t harmonic = fSubEvent->GetCurrentQnVector()->GetFirstHarmonic();
+        Int_t harmonic = fCorrectedQnVector->GetFirstHarmonic();
+        if (harmonic!=-1 && fParameters.IsValidated(bin, harmonic)) {
+          /* the bin content is validated so, apply the correction if significant */
+          if (fParameters.GetParameters(bin, harmonic)[0]!=0.0) {
             while (harmonic!=-1) {
+              const auto parameters = fParameters.GetParameters(bin, harmonic);
+              const Double_t cosine = parameters[1];
+              const Double_t sine = parameters[2];
               fCorrectedQnVector->SetX(harmonic,
-                                       fSubEvent->GetCurrentQnVector()->x(harmonic)
-                                           *TMath::Cos(((Double_t) harmonic)*deltaPhi)
-                                           + fSubEvent->GetCurrentQnVector()->y(harmonic)
-                                               *TMath::Sin(((Double_t) harmonic)*deltaPhi));
+                                       fSubEvent->GetCurrentQnVector()->x(harmonic)*cosine
+                                           + fSubEvent->GetCurrentQnVector()->y(harmonic)*sine);
               fCorrectedQnVector->SetY(harmonic,
-                                       fSubEvent->GetCurrentQnVector()->y(harmonic)
-                                           *TMath::Cos(((Double_t) harmonic)*deltaPhi)
-                                           - fSubEvent->GetCurrentQnVector()->x(harmonic)
-                                               *TMath::Sin(((Double_t) harmonic)*deltaPhi));
-              harmonic = fSubEvent->GetCurrentQnVector()->GetNextHarmonic(harmonic);
+                                       fSubEvent->GetCurrentQnVector()->y(harmonic)*cosine
+                                           - fSubEvent->GetCurrentQnVector()->x(harmonic)*sine);
+              harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
             }
           } /* if the correction is not significant we leave the Q vector untouched */
         } /* if the correction bin is not validated we leave the Q vector untouched */
         else {
-          if (fQANotValidatedBin) fQANotValidatedBin->Fill(1.0);
+          if (fQANotValidatedBin && fSubEvent->IsValidationQAFilled()) fQANotValidatedBin->Fill(1.0);
         }
       } else {
         /* not done! input Q vector with bad quality */
@@ -250,13 +282,8 @@ Bool_t Alignment::ProcessDataCollection() {
       /* FALLTHRU */
     case State::APPLY: /* apply the correction if the current Qn vector is good enough */
       /* provide QA info if required */
-      if (fQAQnAverageHistogram) {
-        Int_t harmonic = fCorrectedQnVector->GetFirstHarmonic();
-        while (harmonic!=-1) {
-          fQAQnAverageHistogram->FillX(harmonic, fCorrectedQnVector->x(harmonic));
-          fQAQnAverageHistogram->FillY(harmonic, fCorrectedQnVector->y(harmonic));
-          harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-        }
+      if (fQAQnAverageHistogram && fSubEvent->IsCalibrationQAFilled()) {
+        fQAQnAverageHistogram->Fill(*fCorrectedQnVector);
       }
       applied = true;
       break;
@@ -272,4 +299,10 @@ void Alignment::ClearCorrectionStep() {
   fCorrectedQnVector->Reset();
 }
 
+/// Copies the filled profiles into their histograms
+void Alignment::UpdateHistograms() {
+  if (fQAQnAverageHistogram) fQAQnAverageHistogram->UpdateHistograms();
+  if (fQANotValidatedBin) fQANotValidatedBin->UpdateHistograms();
+}
+
 }
@@ -0,0 +1,126 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CorrectionCalibrationCache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "TFile.h"
+#include "TH1.h"
+#include "TROOT.h"
+#include "THashList.h"
+#include "TSystem.h"
+
+namespace Qn {
+namespace {
+/**
+ * Detaches the histograms of a list read from a file, such that they are kept when the file is closed.
+ */
+void Detach(TList *list) {
+  list->SetOwner(true);
+  for (auto object : *list) {
+    if (auto histogram = dynamic_cast<TH1 *>(object)) histogram->SetDirectory(nullptr);
+    if (auto nested = dynamic_cast<TList *>(object)) Detach(nested);
+  }
+}
+}
+
+TList *MakeHashedList(TList *list) {
+  auto hashed = new THashList(list->GetSize(), 2);
+  hashed->SetName(list->GetName());
+  hashed->SetOwner(true);
+  for (auto object : *list) {
+    auto nested = dynamic_cast<TList *>(object);
+    hashed->Add(nested ? MakeHashedList(nested) : object);
+  }
+  list->SetOwner(false);
+  list->Clear();
+  delete list;
+  return hashed;
+}
+
+CorrectionCalibrationCache::CorrectionCalibrationCache(const std::string &directory, std::string configuration) :
+    key_(Hash(configuration)),
+    configuration_(std::move(configuration)) {
+  directory_ = directory + "/" + key_;
+  // AccessPathName returns true if the path does not exist.
+  if (gSystem->AccessPathName(directory_.data()) && gSystem->mkdir(directory_.data(), true)!=0) {
+    throw std::runtime_error("Cannot create the calibration cache " + directory_ + ".");
+  }
+}
+
+std::string CorrectionCalibrationCache::Hash(const std::string &configuration) {
+  std::uint64_t hash = 14695981039346656037ull;
+  for (const auto c : configuration) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ull;
+  }
+  std::ostringstream key;
+  key << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return key.str();
+}
+
+TList *CorrectionCalibrationCache::Find(const std::string &run) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto found = runs_.find(run);
+  if (found!=runs_.end()) return found->second.get();
+  const auto file_name = FileName(run);
+  if (gSystem->AccessPathName(file_name.data())) return nullptr;
+  TDirectory::TContext context;
+  std::unique_ptr<TFile> file(TFile::Open(file_name.data(), "READ"));
+  if (!file || file->IsZombie()) return nullptr;
+  auto list = dynamic_cast<TList *>(file->Get(run.data()));
+  if (!list) return nullptr;
+  Detach(list);
+  file->Close();
+  return runs_.emplace(run, std::unique_ptr<TList>(MakeHashedList(list))).first->second.get();
+}
+
+void CorrectionCalibrationCache::Prefetch(const std::string &run) {
+  std::lock_guard<std::mutex> lock(prefetch_mutex_);
+  if (run==prefetch_run_) return;
+  if (prefetch_.valid()) prefetch_.wait();
+  ROOT::EnableThreadSafety();
+  prefetch_run_ = run;
+  prefetch_ = std::async(std::launch::async, [this, run]() { Find(run); });
+}
+
+void CorrectionCalibrationCache::Store(const std::string &run, const TList &list) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto file_name = FileName(run);
+  {
+    TDirectory::TContext context;
+    TFile file((file_name + ".tmp").data(), "RECREATE");
+    if (file.IsZombie()) throw std::runtime_error("Cannot write the calibration cache " + file_name + ".");
+    file.WriteTObject(&list, run.data(), "SingleKey");
+    file.Close();
+  }
+  if (std::rename((file_name + ".tmp").data(), file_name.data())!=0) {
+    throw std::runtime_error("Cannot rename the calibration cache " + file_name + ".tmp to " + file_name + ".");
+  }
+  // the description of the configuration identifies the key, if the directory is inspected.
+  if (!configuration_written_) {
+    std::ofstream(directory_ + "/configuration.txt") << configuration_;
+    configuration_written_ = true;
+  }
+}
+}
@@ -0,0 +1,165 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CorrectionCalibrationFile.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Qn {
+
+using namespace CalibrationFileFormat;
+
+CorrectionCalibrationWriter::CorrectionCalibrationWriter(std::string file_name) : file_name_(std::move(file_name)) {
+  file_ = std::fopen(file_name_.data(), "wb");
+  if (!file_) throw std::runtime_error("Cannot open the calibration file " + file_name_ + ".");
+  Header header{};
+  Append(&header, sizeof(Header));
+}
+
+CorrectionCalibrationWriter::~CorrectionCalibrationWriter() {
+  if (file_) std::fclose(file_);
+}
+
+std::uint64_t CorrectionCalibrationWriter::Append(const void *data, std::size_t size) {
+  static constexpr char padding[kAlignment] = {};
+  const auto n_padding = (kAlignment - position_%kAlignment)%kAlignment;
+  if (std::fwrite(padding, 1, n_padding, file_)!=n_padding || std::fwrite(data, 1, size, file_)!=size) {
+    throw std::runtime_error("Cannot write to the calibration file " + file_name_ + ".");
+  }
+  const auto offset = position_ + n_padding;
+  position_ = offset + size;
+  return offset;
+}
+
+void CorrectionCalibrationWriter::Add(const std::string &run, const std::string &sub_event, const std::string &step,
+                                      const CorrectionParameterTable &table) {
+  if (!file_) throw std::logic_error("The calibration file " + file_name_ + " is already closed.");
+  if (!table.IsInitialized()) return;
+  const auto &keys = table.GetKeys();
+  const auto n_entries = static_cast<std::size_t>(table.GetNumberOfBins())*keys.size();
+  Record record{};
+  record.n_bins = table.GetNumberOfBins();
+  record.n_keys = static_cast<std::int32_t>(keys.size());
+  record.n_parameters = table.GetNumberOfParameters();
+  record.keys_offset = Append(keys.data(), keys.size()*sizeof(int));
+  record.validated_offset = Append(table.GetValidatedData(), n_entries);
+  record.parameters_offset = Append(table.GetParameterData(), n_entries*table.GetNumberOfParameters()*sizeof(double));
+  records_.push_back(record);
+  names_.push_back(TableName(run, sub_event, step));
+}
+
+void CorrectionCalibrationWriter::Close() {
+  if (!file_) return;
+  for (std::size_t i = 0; i < records_.size(); ++i) {
+    records_[i].name_offset = Append(names_[i].data(), names_[i].size());
+    records_[i].name_size = names_[i].size();
+  }
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.n_tables = static_cast<std::uint32_t>(records_.size());
+  header.directory_offset = Append(records_.data(), records_.size()*sizeof(Record));
+  if (std::fseek(file_, 0, SEEK_SET)!=0 || std::fwrite(&header, sizeof(Header), 1, file_)!=1) {
+    throw std::runtime_error("Cannot write to the calibration file " + file_name_ + ".");
+  }
+  std::fclose(file_);
+  file_ = nullptr;
+}
+
+CorrectionCalibrationFile::~CorrectionCalibrationFile() {
+  Unmap();
+}
+
+void CorrectionCalibrationFile::Unmap() {
+  if (mapped_) munmap(const_cast<char *>(mapped_), size_);
+  mapped_ = nullptr;
+  size_ = 0;
+  tables_.clear();
+  runs_.clear();
+  sub_events_.clear();
+}
+
+void CorrectionCalibrationFile::Open(const std::string &file_name) {
+  if (mapped_) throw std::logic_error("The calibration file is already open.");
+  const auto descriptor = open(file_name.data(), O_RDONLY);
+  if (descriptor < 0) throw std::runtime_error("Cannot open the calibration file " + file_name + ".");
+  struct stat status{};
+  if (fstat(descriptor, &status)!=0 || static_cast<std::size_t>(status.st_size) < sizeof(Header)) {
+    close(descriptor);
+    throw std::runtime_error("The calibration file " + file_name + " is not valid.");
+  }
+  const std::size_t size = status.st_size;
+  auto mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+  close(descriptor);
+  if (mapped==MAP_FAILED) throw std::runtime_error("Cannot map the calibration file " + file_name + ".");
+  mapped_ = static_cast<const char *>(mapped);
+  size_ = size;
+  // an invalid file is unmapped, such that the file can be opened again.
+  try {
+    ReadDirectory(file_name);
+  } catch (...) {
+    Unmap();
+    throw;
+  }
+}
+
+void CorrectionCalibrationFile::ReadDirectory(const std::string &file_name) {
+  const auto header = reinterpret_cast<const Header *>(mapped_);
+  if (std::memcmp(header->magic, kMagic, sizeof(kMagic))!=0 || header->version!=kVersion
+      || header->directory_offset + header->n_tables*sizeof(Record) > size_) {
+    throw std::runtime_error("The calibration file " + file_name + " is not valid.");
+  }
+  const auto records = reinterpret_cast<const Record *>(mapped_ + header->directory_offset);
+  for (std::uint32_t i = 0; i < header->n_tables; ++i) {
+    const auto &record = records[i];
+    if (record.n_bins < 0 || record.n_keys < 0 || record.n_parameters < 0) {
+      throw std::runtime_error("The calibration file " + file_name + " is not valid.");
+    }
+    const auto size = static_cast<std::uint64_t>(record.n_bins)*record.n_keys;
+    if (record.name_offset + record.name_size > size_ || record.keys_offset + record.n_keys*sizeof(int) > size_
+        || record.validated_offset + size > size_
+        || record.parameters_offset + size*record.n_parameters*sizeof(double) > size_) {
+      throw std::runtime_error("The calibration file " + file_name + " is not valid.");
+    }
+    std::string name(mapped_ + record.name_offset, record.name_size);
+    runs_.emplace(name.substr(0, name.find('\0')));
+    sub_events_.emplace(name.substr(0, name.rfind('\0')));
+    tables_.emplace(std::move(name), &record);
+  }
+}
+
+CorrectionParameterTable CorrectionCalibrationFile::Find(const std::string &run,
+                                                         const std::string &sub_event,
+                                                         const std::string &step) const {
+  CorrectionParameterTable table;
+  const auto found = tables_.find(TableName(run, sub_event, step));
+  if (found==tables_.end()) return table;
+  const auto &record = *found->second;
+  const auto keys = reinterpret_cast<const int *>(mapped_ + record.keys_offset);
+  table.Map(record.n_bins, std::vector<int>(keys, keys + record.n_keys), record.n_parameters,
+            reinterpret_cast<const unsigned char *>(mapped_ + record.validated_offset),
+            reinterpret_cast<const double *>(mapped_ + record.parameters_offset));
+  return table;
+}
+
+}
@@ -0,0 +1,80 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CorrectionEventRecorder.h"
+
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace Qn {
+
+CorrectionEventRecorder::~CorrectionEventRecorder() {
+  if (mapped_) munmap(const_cast<DataVector *>(mapped_), n_spilled_*sizeof(DataVector));
+  if (spill_file_) std::fclose(spill_file_);
+  if (!spill_file_name_.empty()) std::remove(spill_file_name_.data());
+}
+
+void CorrectionEventRecorder::AddDataVectors(const CorrectionDataBank &bank) {
+  if (finished_) throw std::logic_error("The recording of the events is already finished.");
+  sizes_.push_back(static_cast<std::uint32_t>(bank.Size()));
+  for (std::size_t i = 0; i < bank.Size(); ++i) {
+    data_.push_back({bank.Ids()[i], bank.Phi()[i], bank.Weights()[i], bank.RadialOffsets()[i]});
+  }
+  if (!spill_file_name_.empty() && data_.size() >= kSpillBufferSize) Spill();
+}
+
+void CorrectionEventRecorder::EndEvent() {
+  if (n_events_==0) {
+    n_variables_ = variables_.size();
+    n_sizes_ = sizes_.size();
+  } else if (variables_.size()!=(n_events_ + 1)*n_variables_ || sizes_.size()!=(n_events_ + 1)*n_sizes_) {
+    throw std::logic_error("The recorded event does not match the layout of the previous events.");
+  }
+  ++n_events_;
+}
+
+void CorrectionEventRecorder::Spill() {
+  if (!spill_file_) {
+    spill_file_ = std::fopen(spill_file_name_.data(), "wb");
+    if (!spill_file_) throw std::runtime_error("Cannot open the spill file " + spill_file_name_ + ".");
+  }
+  if (std::fwrite(data_.data(), sizeof(DataVector), data_.size(), spill_file_)!=data_.size()) {
+    throw std::runtime_error("Cannot write to the spill file " + spill_file_name_ + ".");
+  }
+  n_spilled_ += data_.size();
+  data_.clear();
+}
+
+void CorrectionEventRecorder::Finish() {
+  if (finished_) return;
+  finished_ = true;
+  if (spill_file_name_.empty()) return;
+  Spill();
+  std::fclose(spill_file_);
+  spill_file_ = nullptr;
+  if (n_spilled_==0) return;
+  const auto descriptor = open(spill_file_name_.data(), O_RDONLY);
+  if (descriptor < 0) throw std::runtime_error("Cannot open the spill file " + spill_file_name_ + ".");
+  auto mapped = mmap(nullptr, n_spilled_*sizeof(DataVector), PROT_READ, MAP_PRIVATE, descriptor, 0);
+  close(descriptor);
+  if (mapped==MAP_FAILED) throw std::runtime_error("Cannot map the spill file " + spill_file_name_ + ".");
+  mapped_ = static_cast<const DataVector *>(mapped);
+}
+
+}
@@ -1,6 +1,7 @@
 /// file QnCorrectionsHistogramBase.cxx
 /// \brief Implementation of the multidimensional profile base class
 #include <utility>
+#include <vector>
 #include "TList.h"
 #include "CorrectionHistogramBase.h"
 
@@ -9,6 +10,7 @@ const char *CorrectionHistogramBase::szChannelAxisTitle = "Channel number";
 const char *CorrectionHistogramBase::szGroupAxisTitle = "Channels group";
 const char *CorrectionHistogramBase::szGroupHistoPrefix = "Group";
 const char *CorrectionHistogramBase::szEntriesHistoSuffix = "_entries";
+const char *CorrectionHistogramBase::szDerivedListSuffix = "_Derived";
 const char *CorrectionHistogramBase::szXComponentSuffix = "X";
 const char *CorrectionHistogramBase::szYComponentSuffix = "Y";
 const char *CorrectionHistogramBase::szXXCorrelationComponentSuffix = "XX";
@@ -155,4 +157,33 @@ void CorrectionHistogramBase::CopyTHnFDimension(THnF *hDest, THnF *hSource, Int_
     hDest->SetBinError(binsArray, error);
   }
 }
+
+/// Copies the content of a sparse accumulator into a sparse histogram
+///
+/// The linear bins of the accumulator follow the convention of the event
+/// class bins, i.e. each axis of the histogram contributes its number of
+/// bins plus under and overflow with the last axis running fastest.
+/// The content of the histogram is replaced by the one of the accumulator.
+///
+/// \param hDest the destination sparse histogram
+/// \param values the accumulated values
+/// \param entries the number of entries
+void CorrectionHistogramBase::CopyToTHnSparse(THnSparse *hDest,
+                                              const CorrectionSparseAccumulator &values,
+                                              Double_t entries) const {
+  const Int_t nDimensions = hDest->GetNdimensions();
+  std::vector<Int_t> coordinates(nDimensions);
+  values.ForEach([&](const CorrectionSparseAccumulator::Entry &entry) {
+    auto linear = entry.bin;
+    for (Int_t dimension = nDimensions - 1; dimension >= 0; --dimension) {
+      const Int_t nBins = hDest->GetAxis(dimension)->GetNbins() + 2;
+      coordinates[dimension] = linear%nBins;
+      linear /= nBins;
+    }
+    const Long64_t bin = hDest->GetBin(coordinates.data());
+    hDest->SetBinContent(bin, entry.sumw);
+    hDest->SetBinError2(bin, entry.sumw2);
+  });
+  hDest->SetEntries(entries);
+}
 }
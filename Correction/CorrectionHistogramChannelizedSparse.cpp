@@ -1,6 +1,8 @@
 /// \file QnCorrectionsHistogramChannelizedSparse.cxx
 /// \brief Implementation of the single multidimensional sparse histograms with channel support
 
+#include <cmath>
+
 #include "TList.h"
 
 #include "CorrectionAxisSet.h"
@@ -111,6 +113,9 @@ Bool_t CorrectionHistogramChannelizedSparse::CreateChannelizedHistogram(TList *h
   }
   fValues->Sumw2();
   histogramList->Add(fValues);
+  fAccumulator.Clear();
+  fEntries = 0.;
+  fModified = kFALSE;
   delete[] minvals;
   delete[] maxvals;
   delete[] nbins;
@@ -122,13 +127,11 @@ Bool_t CorrectionHistogramChannelizedSparse::CreateChannelizedHistogram(TList *h
 /// The bin number identifies the event class the current
 /// variable content points to under the passed channel.
 ///
-/// \param variableContainer the current variables content addressed by var Id
 /// \param nChannel the interested external channel number
 /// \return the associated bin to the current variables content
 Long64_t CorrectionHistogramChannelizedSparse::GetBin(Int_t nChannel) {
-  FillBinAxesValues(fChannelMap[nChannel]);
-  /* store the channel number */
-  return fValues->GetBin(fBinAxesValues);
+  /* the channel axis has one bin per actual channel starting at bin 1 */
+  return GetEventClassBin()*(fActualNoOfChannels + 2) + fChannelMap[nChannel] + 1;
 }
 
 /// Check the validity of the content of the passed bin
@@ -148,7 +151,8 @@ Bool_t CorrectionHistogramChannelizedSparse::BinContentValidated(Long64_t) {
 /// \param bin the interested bin number
 /// \return the bin number content
 Float_t CorrectionHistogramChannelizedSparse::GetBinContent(Long64_t bin) {
-  return fValues->GetBinContent(bin);
+  const auto entry = fAccumulator.Find(bin);
+  return entry ? entry->sumw : 0.;
 }
 
 /// Get the bin content error for the passed bin number
@@ -159,25 +163,28 @@ Float_t CorrectionHistogramChannelizedSparse::GetBinContent(Long64_t bin) {
 /// \param bin the interested bin number
 /// \return the bin number content error
 Float_t CorrectionHistogramChannelizedSparse::GetBinError(Long64_t bin) {
-  return fValues->GetBinError(bin);
+  const auto entry = fAccumulator.Find(bin);
+  return entry ? std::sqrt(entry->sumw2) : 0.;
 }
 
 /// Fills the histogram
 ///
-/// The involved bin is computed according to the current variables
-/// content and the passed external channel number. The bin is then
+/// The involved bin is computed according to the current event class
+/// and the passed external channel number. The bin is then
 /// increased by the given weight.
 ///
-/// \param variableContainer the current variables content addressed by var Id
 /// \param nChannel the interested external channel number
 /// \param weight the increment in the bin content
 void CorrectionHistogramChannelizedSparse::Fill(Int_t nChannel, Float_t weight) {
-  /* keep the total entries in fValues updated */
-  Double_t nEntries = fValues->GetEntries();
-  FillBinAxesValues(fChannelMap[nChannel]);
-  /* and now update the bin */
-  fValues->Fill(fBinAxesValues, weight);
-  fValues->SetEntries(nEntries + 1);
-}
+  fAccumulator.Fill(GetBin(nChannel), weight);
+  fEntries += 1.;
+  fModified = kTRUE;
 }
 
+/// Copies the accumulated values into the sparse histogram
+void CorrectionHistogramChannelizedSparse::UpdateHistograms() {
+  if (!fModified || !fValues) return;
+  CopyToTHnSparse(fValues, fAccumulator, fEntries);
+  fModified = kFALSE;
+}
+}
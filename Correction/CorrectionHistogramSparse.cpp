@@ -1,6 +1,8 @@
 /// \file QnCorrectionsHistogramSparse.cxx
 /// \brief Implementation of the single multidimensional sparse histograms
 
+#include <cmath>
+
 #include "TList.h"
 
 #include "CorrectionAxisSet.h"
@@ -59,6 +61,9 @@ Bool_t CorrectionHistogramSparse::CreateHistogram(TList *histogramList) {
   }
   fValues->Sumw2();
   histogramList->Add(fValues);
+  fAccumulator.Clear();
+  fEntries = 0.;
+  fModified = kFALSE;
   delete[] minvals;
   delete[] maxvals;
   delete[] nbins;
@@ -68,14 +73,11 @@ Bool_t CorrectionHistogramSparse::CreateHistogram(TList *histogramList) {
 /// Get the bin number for the current variable content
 ///
 /// The bin number identifies the event class the current
-/// variable content points to under the passed channel.
+/// variable content points to.
 ///
-/// \param variableContainer the current variables content addressed by var Id
 /// \return the associated bin to the current variables content
 Long64_t CorrectionHistogramSparse::GetBin() {
-  FillBinAxesValues();
-  /* store the channel number */
-  return fValues->GetBin(fBinAxesValues);
+  return GetEventClassBin();
 }
 
 /// Check the validity of the content of the passed bin
@@ -95,7 +97,8 @@ Bool_t CorrectionHistogramSparse::BinContentValidated(Long64_t) {
 /// \param bin the interested bin number
 /// \return the bin number content
 Float_t CorrectionHistogramSparse::GetBinContent(Long64_t bin) {
-  return fValues->GetBinContent(bin);
+  const auto entry = fAccumulator.Find(bin);
+  return entry ? entry->sumw : 0.;
 }
 
 /// Get the bin content error for the passed bin number
@@ -106,24 +109,26 @@ Float_t CorrectionHistogramSparse::GetBinContent(Long64_t bin) {
 /// \param bin the interested bin number
 /// \return the bin number content error
 Float_t CorrectionHistogramSparse::GetBinError(Long64_t bin) {
-  return fValues->GetBinError(bin);
+  const auto entry = fAccumulator.Find(bin);
+  return entry ? std::sqrt(entry->sumw2) : 0.;
 }
 
 /// Fills the histogram
 ///
-/// The involved bin is computed according to the current variables
-/// content and the passed external channel number. The bin is then
-/// increased by the given weight.
+/// The involved bin is the bin of the current event class.
+/// The bin is then increased by the given weight.
 ///
-/// \param variableContainer the current variables content addressed by var Id
 /// \param weight the increment in the bin content
 void CorrectionHistogramSparse::Fill(Float_t weight) {
-  /* keep the total entries in fValues updated */
-  Double_t nEntries = fValues->GetEntries();
-  FillBinAxesValues();
-  /* and now update the bin */
-  fValues->Fill(fBinAxesValues, weight);
-  fValues->SetEntries(nEntries + 1);
-}
+  fAccumulator.Fill(GetEventClassBin(), weight);
+  fEntries += 1.;
+  fModified = kTRUE;
 }
 
+/// Copies the accumulated values into the sparse histogram
+void CorrectionHistogramSparse::UpdateHistograms() {
+  if (!fModified || !fValues) return;
+  CopyToTHnSparse(fValues, fAccumulator, fEntries);
+  fModified = kFALSE;
+}
+}
@@ -0,0 +1,86 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CorrectionInstrumentation.h"
+
+#include <iomanip>
+
+#include "TH1.h"
+#include "TList.h"
+
+namespace Qn {
+
+std::size_t CorrectionInstrumentation::AddCounter(const std::string &name) {
+  const auto found = ids_.find(name);
+  if (found!=ids_.end()) return found->second;
+  ids_.emplace(name, counters_.size());
+  counters_.push_back(Counter{name});
+  if (trace_) trace_ids_.push_back(trace_->AddName(name));
+  return counters_.size() - 1;
+}
+
+void CorrectionInstrumentation::SetTrace(std::shared_ptr<EventTrace> trace) {
+  trace_ = std::move(trace);
+  trace_ids_.clear();
+  traced_ = false;
+  if (!trace_) return;
+  for (const auto &counter : counters_) trace_ids_.push_back(trace_->AddName(counter.name));
+}
+
+void CorrectionInstrumentation::Merge(const CorrectionInstrumentation &other) {
+  for (const auto &counter : other.counters_) {
+    auto &merged = counters_[AddCounter(counter.name)];
+    merged.time += counter.time;
+    merged.calls += counter.calls;
+    merged.entries += counter.entries;
+  }
+}
+
+void CorrectionInstrumentation::Report(std::ostream &stream) const {
+  stream << "instrumentation" << std::endl;
+  for (const auto &counter : counters_) {
+    const auto seconds = std::chrono::duration<double>(counter.time).count();
+    stream << std::left << std::setw(40) << counter.name << std::right
+           << std::setw(12) << std::setprecision(4) << seconds << " s"
+           << std::setw(12) << counter.calls << " calls"
+           << std::setw(14) << counter.entries << " entries" << std::endl;
+  }
+}
+
+TList *CorrectionInstrumentation::CreateHistogramList() const {
+  auto list = new TList();
+  list->SetName("Instrumentation");
+  list->SetOwner(true);
+  const int n = counters_.size();
+  auto time = new TH1D("time", "time;;time (s)", n, 0., n);
+  auto calls = new TH1D("calls", "calls;;calls", n, 0., n);
+  auto entries = new TH1D("entries", "entries;;entries", n, 0., n);
+  for (auto histogram : {time, calls, entries}) histogram->SetDirectory(nullptr);
+  for (int i = 0; i < n; ++i) {
+    const auto &counter = counters_[i];
+    for (auto histogram : {time, calls, entries}) histogram->GetXaxis()->SetBinLabel(i + 1, counter.name.data());
+    time->SetBinContent(i + 1, std::chrono::duration<double>(counter.time).count());
+    calls->SetBinContent(i + 1, counter.calls);
+    entries->SetBinContent(i + 1, counter.entries);
+  }
+  list->Add(time);
+  list->Add(calls);
+  list->Add(entries);
+  return list;
+}
+
+}
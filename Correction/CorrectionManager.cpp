@@ -16,19 +16,212 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "CorrectionManager.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
 #include "TList.h"
+#include "THashList.h"
+#include "TH1.h"
+#include "TROOT.h"
 
 namespace Qn {
 
+namespace {
+/**
+ * Merges the histograms of a list into the histograms with the same names in the target list. Sub lists are
+ * merged recursively.
+ * @param target list the histograms are merged into
+ * @param source list of the merged histograms
+ */
+void MergeHistogramLists(TList *target, TList *source) {
+  for (auto object : *source) {
+    auto target_object = target->FindObject(object->GetName());
+    if (!target_object) continue;
+    if (auto source_list = dynamic_cast<TList *>(object)) {
+      if (auto target_list = dynamic_cast<TList *>(target_object)) MergeHistogramLists(target_list, source_list);
+      continue;
+    }
+    TList merged;
+    merged.Add(object);
+    if (auto histogram = dynamic_cast<TH1 *>(target_object)) {
+      histogram->Merge(&merged);
+    } else if (auto histogram_n = dynamic_cast<THnBase *>(target_object)) {
+      histogram_n->Merge(&merged);
+    }
+  }
+}
+
+/**
+ * Merges the histograms restored from a checkpoint into a list. The lists of the runs, which are not processed by
+ * this job, are moved to the target.
+ * @param target list of this job
+ * @param restored list of the previous jobs
+ */
+void MergeRestoredList(TList *target, TObject *restored) {
+  auto source = dynamic_cast<TList *>(restored);
+  if (!target || !source) return;
+  MergeHistogramLists(target, source);
+  std::vector<TObject *> missing;
+  for (auto object : *source) {
+    if (!target->FindObject(object->GetName())) missing.push_back(object);
+  }
+  for (auto object : missing) {
+    source->Remove(object);
+    target->Add(object);
+  }
+}
+
+/**
+ * Merges the histograms of a source list into the histograms with the same names in the target list. Sub lists are
+ * merged recursively. Objects of the source, which are missing in the target, are moved to the target. The merges
+ * of the histograms are collected, such that all sources of a histogram are merged at once.
+ * @param target list the histograms are merged into
+ * @param source list of the merged histograms, which keeps the merged histograms
+ * @param merges the histograms of the target with their sources
+ */
+void CollectMerges(TList *target, TList *source, std::map<TObject *, std::vector<TObject *>> &merges) {
+  std::vector<TObject *> missing;
+  for (auto object : *source) {
+    auto target_object = target->FindObject(object->GetName());
+    if (!target_object) {
+      missing.push_back(object);
+    } else if (auto source_list = dynamic_cast<TList *>(object)) {
+      if (auto target_list = dynamic_cast<TList *>(target_object)) CollectMerges(target_list, source_list, merges);
+    } else {
+      merges[target_object].push_back(object);
+    }
+  }
+  for (auto object : missing) {
+    source->Remove(object);
+    target->Add(object);
+  }
+}
+
+/**
+ * Calls the function for the indices [0, n) distributed over the threads. Rethrows the first exception.
+ * @param n number of indices
+ * @param n_threads number of threads
+ * @param function function with the signature void(unsigned int thread, std::size_t index)
+ */
+void ParallelFor(std::size_t n, unsigned int n_threads,
+                 const std::function<void(unsigned int, std::size_t)> &function) {
+  n_threads = std::max(1u, std::min<unsigned int>(n_threads, n));
+  std::atomic<std::size_t> next{0};
+  std::vector<std::exception_ptr> errors(n_threads);
+  auto work = [&](unsigned int thread) {
+    try {
+      for (auto i = next++; i < n; i = next++) function(thread, i);
+    } catch (...) {
+      errors[thread] = std::current_exception();
+      next = n;
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned int thread = 1; thread < n_threads; ++thread) threads.emplace_back(work, thread);
+  work(0);
+  for (auto &thread : threads) thread.join();
+  for (const auto &error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+}
+
+/**
+ * Merges the histograms of the sources into the target histograms. The histograms are merged in parallel.
+ * @param merges the histograms of the target with their sources
+ * @param n_threads number of threads
+ */
+void RunMerges(const std::map<TObject *, std::vector<TObject *>> &merges, unsigned int n_threads) {
+  std::vector<std::pair<TObject *, const std::vector<TObject *> *>> tasks;
+  for (const auto &merge : merges) tasks.emplace_back(merge.first, &merge.second);
+  ParallelFor(tasks.size(), n_threads, [&tasks](unsigned int, std::size_t i) {
+    TList merged;
+    for (auto object : *tasks[i].second) merged.Add(object);
+    if (auto histogram = dynamic_cast<TH1 *>(tasks[i].first)) {
+      histogram->Merge(&merged);
+    } else if (auto histogram_n = dynamic_cast<THnBase *>(tasks[i].first)) {
+      histogram_n->Merge(&merged);
+    }
+  });
+}
+
+/**
+ * Reads a list of histograms from a file. The histograms are detached from the file.
+ * @param file the file
+ * @param name name of the list
+ * @return the list owning its histograms, or nullptr if the file does not contain the list
+ */
+std::unique_ptr<TList> ReadHistogramList(TFile &file, const char *name) {
+  std::unique_ptr<TList> list(dynamic_cast<TList *>(file.FindObjectAny(name)));
+  if (!list) return nullptr;
+  std::function<void(TList *)> detach = [&detach](TList *detached) {
+    detached->SetOwner(true);
+    for (auto object : *detached) {
+      if (auto histogram = dynamic_cast<TH1 *>(object)) histogram->SetDirectory(nullptr);
+      if (auto nested = dynamic_cast<TList *>(object)) detach(nested);
+    }
+  };
+  detach(list.get());
+  return list;
+}
+
+/**
+ * Merges a list into the accumulated list of a thread. The first list is taken over.
+ * @param accumulated the accumulated list
+ * @param list the merged list
+ */
+void AccumulateList(std::unique_ptr<TList> &accumulated, std::unique_ptr<TList> list) {
+  if (!list) return;
+  if (!accumulated) {
+    accumulated = std::move(list);
+    return;
+  }
+  std::map<TObject *, std::vector<TObject *>> merges;
+  CollectMerges(accumulated.get(), list.get(), merges);
+  RunMerges(merges, 1);
+}
+
+/**
+ * Merges the accumulated lists of the threads into the first of them. The histograms are merged in parallel.
+ * @param lists accumulated lists of the threads
+ * @param n_threads number of threads
+ * @return the merged list, or nullptr if none of the threads read the list
+ */
+std::unique_ptr<TList> MergeAccumulatedLists(std::vector<std::unique_ptr<TList>> &lists, unsigned int n_threads) {
+  std::unique_ptr<TList> merged;
+  std::map<TObject *, std::vector<TObject *>> merges;
+  for (auto &list : lists) {
+    if (!list) continue;
+    if (!merged) {
+      merged = std::move(list);
+    } else {
+      CollectMerges(merged.get(), list.get(), merges);
+    }
+  }
+  RunMerges(merges, n_threads);
+  return merged;
+}
+}
+
 void CorrectionManager::InitializeCorrections() {
-  // Connects the correction histogram list
-  if (!correction_input_file_) {
+  // Maps the binary calibration file. The managers of the other slots share the mapping of the first slot.
+  if (!calibration_file_ && !calibration_file_name_.empty()) {
+    calibration_file_ = std::make_shared<CorrectionCalibrationFile>();
+    calibration_file_->Open(calibration_file_name_);
+  }
+  // Connects the correction histogram list. The managers of the other slots share the input of the first slot.
+  if (!correction_input_ && !correction_input_file_ && !correction_input_file_name_.empty()) {
     correction_input_file_ = std::make_unique<TFile>(correction_input_file_name_.data(), "READ");
   }
-  if (correction_input_file_ && !correction_input_file_->IsZombie()) {
+  if (!correction_input_ && correction_input_file_ && !correction_input_file_->IsZombie()) {
     auto input = dynamic_cast<TList *>(correction_input_file_->FindObjectAny(kCorrectionListName));
-    correction_input_.reset(input);
-    if (input) correction_input_->SetOwner(true);
+    if (input) {
+      input->SetOwner(true);
+      correction_input_.reset(MakeHashedList(input));
+    }
   }
   // Prepares the correctionsteps
   detectors_.CreateSupportQVectors();
@@ -38,28 +231,97 @@ void CorrectionManager::InitializeCorrections() {
 }
 
 void CorrectionManager::SetCurrentRunName(const std::string &name) {
+  if (instrumentation_) instrumentation_->TraceStages();
+  CorrectionInstrumentation::ScopedTimer timer(instrumentation_.get(), kRunSwitch);
+  // the profiles of the previous run are replaced by the ones of the new run.
+  detectors_.UpdateHistograms();
   runs_.SetCurrentRun(name);
   TList *current_output = nullptr;
   if (!runs_.empty()) {
-    current_output = new TList();
+    current_output = new THashList();
     current_output->SetName(runs_.GetCurrent().data());
     current_output->SetOwner(true);
     correction_output->Add(current_output);
     detectors_.CreateCorrectionHistograms();
   }
-  if (correction_input_) {
-    auto current_run = (TList *) correction_input_->FindObject(runs_.GetCurrent().data());
+  // the replayed passes use the calibration histograms of the previous pass.
+  if (calibration_file_ && !replaying_ && calibration_file_->HasRun(runs_.GetCurrent())) {
+    detectors_.AttachCorrectionInput(*calibration_file_, runs_.GetCurrent());
+  } else {
+    TList *current_run = nullptr;
+    if (correction_input_) current_run = (TList *) correction_input_->FindObject(runs_.GetCurrent().data());
+    // the runs without calibration input are looked up in the cache of the previous productions.
+    if (!current_run && calibration_cache_ && !replaying_ && !runs_.empty()) {
+      current_run = calibration_cache_->Find(runs_.GetCurrent());
+    }
     if (current_run) {
       detectors_.AttachCorrectionInput(current_run);
     }
   }
+  // the calibration of the next run is read while the current run is processed.
+  if (calibration_cache_ && !replaying_ && !runs_.GetNext().empty()) calibration_cache_->Prefetch(runs_.GetNext());
+  // the histograms of the runs, in which all corrections are applied from the start, are not stored again.
+  if (calibration_cache_ && detectors_.IsCalibrated()) calibrated_runs_.insert(runs_.GetCurrent());
   detectors_.CopyToOutputList(current_output);
   detectors_.IncludeQnVectors();
-  if (fill_output_tree_ && out_tree_) {
-    detectors_.SetOutputTree(out_tree_);
-    variable_manager_.SetOutputTree(out_tree_);
+  // when recording, the output tree is only filled in the pass applying all corrections.
+  if (fill_output_tree_ && output_tree_.IsConnected() && (!recorder_ || detectors_.IsCalibrated())) {
+    detectors_.SetOutputTree(output_tree_);
+    variable_manager_.SetOutputTree(output_tree_);
+    output_tree_attached_ = true;
   }
+  if (recorder_ && !replaying_) recorder_->AddRun(name);
   detectors_.CreateReport();
+  for (auto &slot : slots_) slot->SetCurrentRunName(name);
+}
+
+void CorrectionManager::WriteCalibrationFile(const std::string &file_name) {
+  if (!correction_input_) throw std::logic_error("No calibration input to write to " + file_name + ".");
+  CorrectionCalibrationWriter writer(file_name);
+  for (auto object : *correction_input_) {
+    auto run = dynamic_cast<TList *>(object);
+    if (!run) continue;
+    // the calibration histograms of the conversion are not needed.
+    detectors_.CreateCorrectionHistograms();
+    THashList discarded;
+    discarded.SetOwner(true);
+    detectors_.CopyToOutputList(&discarded);
+    detectors_.AttachCorrectionInput(run);
+    detectors_.WriteCorrectionParameters(writer, run->GetName());
+  }
+  writer.Close();
+}
+
+void CorrectionManager::MergeCalibrationInputs(const std::vector<std::string> &file_names,
+                                               unsigned int n_threads,
+                                               const std::string &merged_file_name) {
+  if (correction_output) throw std::logic_error("MergeCalibrationInputs is called after InitializeOnNode.");
+  if (file_names.empty()) throw std::invalid_argument("No calibration inputs to merge.");
+  ROOT::EnableThreadSafety();
+  n_threads = std::max(1u, std::min<unsigned int>(n_threads, file_names.size()));
+  std::vector<std::unique_ptr<TList>> corrections(n_threads);
+  std::vector<std::unique_ptr<TList>> qa(n_threads);
+  ParallelFor(file_names.size(), n_threads, [&](unsigned int thread, std::size_t i) {
+    TDirectory::TContext context;
+    std::unique_ptr<TFile> file(TFile::Open(file_names[i].data(), "READ"));
+    if (!file || file->IsZombie()) throw std::runtime_error("Cannot open the calibration input " + file_names[i] + ".");
+    AccumulateList(corrections[thread], ReadHistogramList(*file, kCorrectionListName));
+    AccumulateList(qa[thread], ReadHistogramList(*file, "QA_histograms"));
+  });
+  auto merged_corrections = MergeAccumulatedLists(corrections, n_threads);
+  auto merged_qa = MergeAccumulatedLists(qa, n_threads);
+  if (!merged_corrections) {
+    throw std::runtime_error(std::string("None of the calibration inputs contains ") + kCorrectionListName + ".");
+  }
+  if (!merged_file_name.empty()) {
+    TDirectory::TContext context;
+    TFile merged_file(merged_file_name.data(), "RECREATE");
+    if (merged_file.IsZombie()) throw std::runtime_error("Cannot open the merged file " + merged_file_name + ".");
+    merged_corrections->Write(kCorrectionListName, TObject::kSingleKey);
+    if (merged_qa) merged_qa->Write("QA_histograms", TObject::kSingleKey);
+    merged_file.Close();
+  }
+  correction_input_.reset(MakeHashedList(merged_corrections.release()));
 }
 
 void CorrectionManager::AttachQAHistograms() {
@@ -78,32 +340,375 @@ void CorrectionManager::AttachQAHistograms() {
   correction_qa_histos_->Add(event_qa_list);
 }
 
+void CorrectionManager::ReattachQAHistograms() {
+  // the event and detector QA histograms are only filled in the recording pass and are kept.
+  auto previous = std::move(correction_qa_histos_);
+  correction_qa_histos_ = std::make_unique<TList>();
+  correction_qa_histos_->SetName("QA_histograms");
+  correction_qa_histos_->SetOwner(true);
+  detectors_.AttachQAHistograms(correction_qa_histos_.get(),
+                                fill_qa_histos_,
+                                fill_validation_qa_histos_);
+  for (auto object : *correction_qa_histos_) {
+    auto detector_list = dynamic_cast<TList *>(object);
+    auto previous_list = dynamic_cast<TList *>(previous->FindObject(detector_list->GetName()));
+    if (!previous_list) continue;
+    auto previous_qa = previous_list->FindObject("detector_QA");
+    if (!previous_qa) continue;
+    previous_list->Remove(previous_qa);
+    auto new_qa = detector_list->FindObject("detector_QA");
+    detector_list->Remove(new_qa);
+    delete new_qa;
+    detector_list->AddFirst(previous_qa);
+  }
+  auto event_qa_list = previous->FindObject("event_QA");
+  if (event_qa_list) {
+    previous->Remove(event_qa_list);
+    correction_qa_histos_->Add(event_qa_list);
+  }
+}
+
 void CorrectionManager::InitializeOnNode() {
   variable_manager_.Initialize();
   correction_axes_.Initialize(variable_manager_);
   event_histograms_.Initialize(variable_manager_);
+  if (recorder_) {
+    detector_configuration_ = std::make_unique<DetectorList>(detectors_);
+    recorded_output_ids_ = variable_manager_.GetOutputVariableIds();
+    recorded_axis_ids_.clear();
+    for (const auto &axis : correction_axes_) recorded_axis_ids_.push_back(axis.GetId());
+  }
   detectors_.Initialize(detectors_,variable_manager_, correction_axes_);
+  if (instrumentation_) detectors_.SetInstrumentation(instrumentation_.get());
   event_cuts_.Initialize(variable_manager_);
+  // The key of the cache is computed once from the configuration of the first slot.
+  if (!calibration_cache_ && !calibration_cache_directory_.empty()) {
+    std::ostringstream configuration;
+    WriteConfiguration(configuration);
+    calibration_cache_ = std::make_shared<CorrectionCalibrationCache>(calibration_cache_directory_,
+                                                                      configuration.str());
+  }
   InitializeCorrections();
   AttachQAHistograms();
+  for (auto &slot : slots_) {
+    ShareInstrumentation(*slot);
+    slot->correction_input_ = correction_input_;
+    slot->calibration_file_ = calibration_file_;
+    slot->calibration_cache_ = calibration_cache_;
+    slot->InitializeOnNode();
+  }
 }
 
-bool CorrectionManager::ProcessEvent() {
+void CorrectionManager::WriteConfiguration(std::ostream &stream) const {
+  stream << "variables\n";
+  variable_manager_.WriteConfiguration(stream);
+  stream << "correction_axes\n" << std::hexfloat;
+  for (const auto &axis : correction_axes_) {
+    stream << axis.GetLabel();
+    for (Int_t i = 0; i <= axis.GetNBins(); ++i) stream << ' ' << axis.GetBins()[i];
+    stream << '\n';
+  }
+  stream << std::defaultfloat << "event_cuts\n";
+  event_cuts_.WriteConfiguration(stream);
+  detectors_.WriteConfiguration(stream);
+  stream << "datasets\n";
+  for (const auto &id : calibration_cache_datasets_) stream << id << '\n';
+}
+
+void CorrectionManager::SetNumberOfSlots(const unsigned int n_slots,
+                                         const std::function<void(CorrectionManager &)> &configuration) {
+  if (n_slots==0) throw std::logic_error("At least one slot is needed.");
+  if (recorder_) throw std::logic_error("The recording of the events is not available with multiple slots.");
+  slots_.clear();
+  for (unsigned int i = 1; i < n_slots; ++i) {
+    slots_.emplace_back(std::make_unique<CorrectionManager>());
+    configuration(*slots_.back());
+  }
+}
+
+void CorrectionManager::ProcessRuns(const std::vector<RunInput> &runs,
+                                    unsigned int n_threads,
+                                    const std::function<void(CorrectionManager &)> &configuration,
+                                    const std::function<void(CorrectionManager &, const RunInput &)> &processing) {
+  if (!slots_.empty()) throw std::logic_error("The runs cannot be processed concurrently with multiple slots.");
+  if (recorder_) throw std::logic_error("The runs cannot be processed concurrently with the recording of the events.");
+  if (!correction_output) throw std::logic_error("ProcessRuns is called before InitializeOnNode.");
+  std::set<std::string> names;
+  for (const auto &run : runs) {
+    if (!names.insert(run.name).second) throw std::invalid_argument("The run " + run.name + " is listed twice.");
+  }
+  ROOT::EnableThreadSafety();
+  n_threads = std::max(1u, std::min<unsigned int>(n_threads, runs.size()));
+  std::atomic<std::size_t> next_run{0};
+  std::mutex merge_mutex;
+  std::vector<std::unique_ptr<TList>> run_lists(runs.size());
+  std::vector<std::exception_ptr> errors(n_threads);
+  auto process = [&](unsigned int thread) {
+    try {
+      for (auto i = next_run++; i < runs.size(); i = next_run++) {
+        // the manager of the run shares the calibration input of this manager like the manager of a slot.
+        auto manager = std::make_unique<CorrectionManager>();
+        configuration(*manager);
+        ShareInstrumentation(*manager);
+        manager->correction_input_ = correction_input_;
+        manager->calibration_file_ = calibration_file_;
+        manager->calibration_cache_ = calibration_cache_;
+        manager->InitializeOnNode();
+        manager->SetCurrentRunName(runs[i].name);
+        processing(*manager, runs[i]);
+        manager->Finalize();
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        run_lists[i].reset(MergeProcessedRun(*manager, runs[i].name));
+      }
+    } catch (...) {
+      errors[thread] = std::current_exception();
+      next_run = runs.size();
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned int thread = 1; thread < n_threads; ++thread) threads.emplace_back(process, thread);
+  process(0);
+  for (auto &thread : threads) thread.join();
+  for (const auto &error : errors) {
+    if (error) std::rethrow_exception(error);
+  }
+  TList *last = nullptr;
+  for (std::size_t i = 0; i < runs.size(); ++i) {
+    runs_.SetCurrentRun(runs[i].name);
+    if (!run_lists[i]) continue;
+    last = run_lists[i].release();
+    correction_output->Add(last);
+  }
+  if (instrumentation_) instrumentation_list_.reset(instrumentation_->CreateHistogramList());
+  if (last) correction_output->Add(last->Clone("all"));
+}
+
+/**
+ * Merges the QA histograms and the instrumentation of a finalized run manager into this manager.
+ * @param run_manager the manager of the run
+ * @param name name of the run
+ * @return the list of the calibration histograms of the run, which is removed from the run manager
+ */
+TList *CorrectionManager::MergeProcessedRun(CorrectionManager &run_manager, const std::string &name) {
+  MergeHistogramLists(correction_qa_histos_.get(), run_manager.correction_qa_histos_.get());
+  if (instrumentation_ && run_manager.instrumentation_) instrumentation_->Merge(*run_manager.instrumentation_);
+  auto run_list = dynamic_cast<TList *>(run_manager.correction_output->FindObject(name.data()));
+  if (run_list) run_manager.correction_output->Remove(run_list);
+  return run_list;
+}
+
+void CorrectionManager::SetCheckpoint(std::shared_ptr<EventLoopCheckpoint> checkpoint) {
+  if (recorder_) throw std::logic_error("The checkpoint is not available with the recording of the events.");
+  if (checkpoint->GetNumberOfSlots() < GetNumberOfSlots()) {
+    throw std::logic_error("The checkpoint has less slots than the correction manager.");
+  }
+  checkpoint_ = std::move(checkpoint);
+  // the histograms of the dense accumulators and the cut reports are updated by the thread processing the slot before
+  // they are written.
+  checkpoint_->Register(kCorrectionListName, [this](unsigned int slot) -> TObject * {
+    if (slot >= GetNumberOfSlots()) return nullptr;
+    auto &manager = GetSlot(slot);
+    manager.detectors_.UpdateHistograms();
+    return manager.correction_output.get();
+  });
+  checkpoint_->Register("QA_histograms", [this](unsigned int slot) -> TObject * {
+    if (slot >= GetNumberOfSlots()) return nullptr;
+    auto &manager = GetSlot(slot);
+    manager.event_cuts_.UpdateReport();
+    manager.detectors_.UpdateReports();
+    return manager.correction_qa_histos_.get();
+  });
+}
+
+void CorrectionManager::MergeSlots() {
+  for (auto &slot : slots_) {
+    slot->detectors_.UpdateHistograms();
+    slot->event_cuts_.UpdateReport();
+    slot->detectors_.UpdateReports();
+    MergeHistogramLists(correction_output.get(), slot->correction_output.get());
+    MergeHistogramLists(correction_qa_histos_.get(), slot->correction_qa_histos_.get());
+  }
+}
+
+/**
+ * Enables the instrumentation of a manager of a slot or a run, if this manager is instrumented. The manager records
+ * to the trace of this manager.
+ * @param manager the manager of the slot or run
+ */
+void CorrectionManager::ShareInstrumentation(CorrectionManager &manager) const {
+  if (!instrumentation_) return;
+  if (!manager.instrumentation_) manager.SetInstrumentation(true);
+  if (instrumentation_->GetTrace() && !manager.instrumentation_->GetTrace()) {
+    manager.instrumentation_->SetTrace(instrumentation_->GetTrace());
+  }
+}
+
+bool CorrectionManager::ProcessEvent() { return PassEvent(nullptr); }
+
+/// the event class bin is computed from the variable container, if it is not given.
+bool CorrectionManager::PassEvent(const Long64_t *bin) {
+  if (instrumentation_) instrumentation_->BeginEvent();
+  CorrectionInstrumentation::ScopedTimer timer(instrumentation_.get(), kEventCuts);
   event_passed_cuts_ = event_cuts_.CheckCuts(0);
   if (event_passed_cuts_) {
+    if (instrumentation_) instrumentation_->AddEntries(kEventCuts, 1);
     event_cuts_.FillReport();
     variable_manager_.UpdateOutVariables();
-    event_histograms_.Fill();
+    if (bin) {
+      correction_axes_.SetBin(*bin);
+    } else {
+      correction_axes_.UpdateBin();
+    }
+    auto &qa_sampling = detectors_.GetQASampling();
+    qa_sampling.NextEvent();
+    if (qa_sampling.IsFilled(CorrectionQASampling::Category::kEvent)) event_histograms_.Fill();
+    if (recorder_) {
+      auto values = variable_manager_.GetVariableContainer();
+      recorder_->BeginEvent();
+      for (auto id : recorded_output_ids_) recorder_->AddVariable(values[id]);
+    }
   }
   return event_passed_cuts_;
 }
 
+void CorrectionManager::FillTracks(const std::size_t n,
+                                   const std::vector<std::pair<std::string, const double *>> &columns) {
+  if (!event_passed_cuts_) return;
+  CorrectionInstrumentation::ScopedTimer timer(instrumentation_.get(), kFillTracking);
+  track_columns_.clear();
+  for (const auto &column : columns) track_columns_.emplace_back(FindColumnVariable(column.first), column.second);
+  detectors_.FillTracks(n, track_columns_);
+}
+
+double *CorrectionManager::FindColumnVariable(const std::string &name) const {
+  auto variable = variable_manager_.FindVariable(name);
+  if (variable.size()!=1) {
+    throw std::logic_error("The variable " + name + " of a column needs to have a length of one.");
+  }
+  return variable.begin();
+}
+
+void CorrectionManager::ProcessEvents(const EventBatch &batch, const std::function<void(std::size_t)> &processed) {
+  const auto n = batch.n_events;
+  if (n==0) return;
+  if (!batch.track_columns.empty() && !batch.track_offsets) {
+    throw std::logic_error("The tracks of a batch need the offsets of the events.");
+  }
+  Detector::TrackColumns event_columns;
+  for (const auto &column : batch.event_columns) {
+    event_columns.emplace_back(FindColumnVariable(column.first), column.second);
+  }
+  Detector::TrackColumns track_columns;
+  for (const auto &column : batch.track_columns) {
+    track_columns.emplace_back(FindColumnVariable(column.first), column.second);
+  }
+  // the event class bins of all events are computed with one pass over each axis.
+  std::vector<const double *> axis_values;
+  batch_values_.resize(correction_axes_.GetSize()*n);
+  for (unsigned int iaxis = 0; iaxis < correction_axes_.GetSize(); ++iaxis) {
+    const auto variable = GetVariableContainer() + correction_axes_[iaxis].GetId();
+    auto column = std::find_if(event_columns.begin(), event_columns.end(),
+                               [variable](const std::pair<double *, const double *> &c) { return c.first==variable; });
+    if (column!=event_columns.end()) {
+      axis_values.push_back(column->second);
+    } else {
+      auto values = batch_values_.data() + iaxis*n;
+      std::fill(values, values + n, *variable);
+      axis_values.push_back(values);
+    }
+  }
+  batch_bins_.resize(n);
+  correction_axes_.FindBins(axis_values.data(), n, batch_bins_.data());
+  for (std::size_t event = 0; event < n; ++event) {
+    Reset();
+    for (const auto &column : event_columns) *column.first = column.second[event];
+    if (PassEvent(&batch_bins_[event]) && !track_columns.empty()) {
+      CorrectionInstrumentation::ScopedTimer timer(instrumentation_.get(), kFillTracking);
+      const auto first = batch.track_offsets[event];
+      track_columns_.clear();
+      for (const auto &column : track_columns) track_columns_.emplace_back(column.first, column.second + first);
+      detectors_.FillTracks(batch.track_offsets[event + 1] - first, track_columns_);
+    }
+    ProcessCorrections();
+    if (processed) processed(event);
+  }
+}
+
 void CorrectionManager::ProcessCorrections() {
   if (event_passed_cuts_) {
-    detectors_.ProcessCorrections();
-    detectors_.FillReport();
-    if (fill_output_tree_) out_tree_->Fill();
+    if (recorder_ && !replaying_) RecordEvent();
+    {
+      CorrectionInstrumentation::ScopedTimer timer(instrumentation_.get(), kCorrections);
+      detectors_.ProcessCorrections();
+    }
+    // the detector cuts are not evaluated for replayed events.
+    if (!replaying_) {
+      CorrectionInstrumentation::ScopedTimer timer(instrumentation_.get(), kReport);
+      detectors_.FillReport();
+    }
+    if (fill_output_tree_ && output_tree_attached_) {
+      CorrectionInstrumentation::ScopedTimer timer(instrumentation_.get(), kOutput);
+      output_tree_.Fill();
+    }
+  }
+  if (instrumentation_) instrumentation_->EndEvent(kEvent);
+}
+
+void CorrectionManager::RecordEvent() {
+  auto values = variable_manager_.GetVariableContainer();
+  for (auto id : recorded_axis_ids_) recorder_->AddVariable(values[id]);
+  detectors_.RecordData(*recorder_);
+  recorder_->EndEvent();
+}
+
+void CorrectionManager::ReplayEvent(const double *variables,
+                                    const std::uint32_t *sizes,
+                                    const CorrectionEventRecorder::DataVector *data) {
+  Reset();
+  if (instrumentation_) instrumentation_->BeginEvent();
+  auto values = variable_manager_.GetVariableContainer();
+  for (auto id : recorded_output_ids_) values[id] = *variables++;
+  variable_manager_.UpdateOutVariables();
+  for (auto id : recorded_axis_ids_) values[id] = *variables++;
+  correction_axes_.UpdateBin();
+  event_passed_cuts_ = true;
+  detectors_.GetQASampling().NextEvent();
+  detectors_.ReplayData(sizes, data);
+  ProcessCorrections();
+}
+
+unsigned int CorrectionManager::ReplayRecordedEvents(const unsigned int max_passes) {
+  if (!recorder_ || !detector_configuration_) {
+    throw std::logic_error("The recording of the events needs to be enabled before InitializeOnNode.");
+  }
+  recorder_->Finish();
+  unsigned int n_passes = 0;
+  while (!detectors_.IsCalibrated() && n_passes < max_passes) {
+    // the calibration histograms of the previous pass are the input of this pass.
+    detectors_.UpdateHistograms();
+    detectors_.UpdateReports();
+    correction_input_ = std::move(correction_output);
+    detectors_.Reconfigure(*detector_configuration_);
+    detectors_.Initialize(detectors_, variable_manager_, correction_axes_);
+    if (instrumentation_) detectors_.SetInstrumentation(instrumentation_.get());
+    detectors_.CreateSupportQVectors();
+    correction_output = std::make_unique<TList>();
+    correction_output->SetName(kCorrectionListName);
+    correction_output->SetOwner(true);
+    ReattachQAHistograms();
+    replaying_ = true;
+    recorder_->ForEachEvent([this](const std::string &run) { SetCurrentRunName(run); },
+                            [this](const double *variables,
+                                   const std::uint32_t *sizes,
+                                   const CorrectionEventRecorder::DataVector *data) {
+                              ReplayEvent(variables, sizes, data);
+                            });
+    replaying_ = false;
+    Reset();
+    Finalize();
+    ++n_passes;
   }
+  return n_passes;
 }
 
 void CorrectionManager::Reset() {
@@ -112,6 +717,32 @@ void CorrectionManager::Reset() {
 }
 
 void CorrectionManager::Finalize() {
+  if (instrumentation_) instrumentation_->TraceStages();
+  {
+    CorrectionInstrumentation::ScopedTimer timer(instrumentation_.get(), kFinalize);
+    output_tree_.Finish();
+    for (auto &slot : slots_) slot->output_tree_.Finish();
+    detectors_.UpdateHistograms();
+    event_cuts_.UpdateReport();
+    detectors_.UpdateReports();
+    MergeSlots();
+    if (checkpoint_) {
+      MergeRestoredList(correction_output.get(), checkpoint_->GetRestored(kCorrectionListName));
+      MergeRestoredList(correction_qa_histos_.get(), checkpoint_->GetRestored("QA_histograms"));
+    }
+    if (calibration_cache_) {
+      for (auto object : *correction_output) {
+        auto run = dynamic_cast<TList *>(object);
+        if (run && calibrated_runs_.count(run->GetName())==0) calibration_cache_->Store(run->GetName(), *run);
+      }
+    }
+  }
+  if (instrumentation_) {
+    for (auto &slot : slots_) {
+      if (slot->instrumentation_) instrumentation_->Merge(*slot->instrumentation_);
+    }
+    instrumentation_list_.reset(instrumentation_->CreateHistogramList());
+  }
   auto calibration_list = (TList *) correction_output->FindObject(runs_.GetCurrent().data());
   if (calibration_list) {
     correction_output->Add(calibration_list->Clone("all"));
@@ -278,6 +278,12 @@ Bool_t CorrectionProfile3DCorrelations::CreateCorrelationComponentsProfileHistog
   delete[] minvals;
   delete[] maxvals;
   delete[] nbins;
+  /* the harmonics of all combinations are stored in the dense array */
+  UInt_t harmonicMask = 0x0000;
+  for (Int_t i = 0; i < nNoOfHarmonics; i++) {
+    harmonicMask |= harmonicNumberMask[harmonicMap!=nullptr ? harmonicMap[i] : i + 1];
+  }
+  AllocateData(harmonicMask);
   return kTRUE;
 }
 
@@ -336,6 +342,7 @@ Bool_t CorrectionProfile3DCorrelations::AttachHistograms(TList *histogramList) {
   entriesHistoName += szYYCorrelationComponentSuffix;
   entriesHistoName += szEntriesHistoSuffix;
   UInt_t harmonicFilledMask = 0x0000;
+  UInt_t harmonicAllCombinationsMask = 0xffffffff;
   fEntries = (THnI *) histogramList->FindObject((const char *) entriesHistoName);
   if (fEntries && fEntries->GetEntries()!=0) {
     /* allocate enough space for the supported harmonic numbers */
@@ -353,6 +360,7 @@ Bool_t CorrectionProfile3DCorrelations::AttachHistograms(TList *histogramList) {
     const char *combNames[CORRELATIONSNOOFQNVECTORS] = {fNameA.data(), fNameB.data(), fNameC.data()};
     for (Int_t ixComb = 0; ixComb < CORRELATIONSNOOFQNVECTORS; ixComb++) {
       Int_t currentHarmonic = 0;
+      UInt_t harmonicCombinationMask = 0x0000;
       /* let's build the histograms names */
       TString
           BaseName = GetName() + " " + combNames[ixComb] + "x" + combNames[(ixComb + 1)%CORRELATIONSNOOFQNVECTORS];
@@ -388,17 +396,97 @@ Bool_t CorrectionProfile3DCorrelations::AttachHistograms(TList *histogramList) {
         /* update the correcto condition */
         if ((fXXValues[ixComb][currentHarmonic]!=nullptr) && (fXYValues[ixComb][currentHarmonic]!=nullptr)
             && (fYXValues[ixComb][currentHarmonic]!=nullptr) && (fYYValues[ixComb][currentHarmonic]!=nullptr))
-          harmonicFilledMask |= harmonicNumberMask[currentHarmonic];
+          harmonicCombinationMask |= harmonicNumberMask[currentHarmonic];
       }
+      harmonicFilledMask |= harmonicCombinationMask;
+      harmonicAllCombinationsMask &= harmonicCombinationMask;
     }
   } else {
     return kFALSE;
   }
+  /* convert the histograms of the harmonics available for all combinations into the dense array */
+  AllocateData(harmonicAllCombinationsMask);
+  ReadHistograms();
 
   /* check that we actually got something */
   return harmonicFilledMask!=0x0000;
 }
 
+/// Allocates the dense array for the passed harmonics
+///
+/// The harmonics are stored in increasing order of their external number.
+/// The array is indexed by the bin numbers of the entries histogram.
+///
+/// \param harmonicMask mask of the harmonics to store
+void CorrectionProfile3DCorrelations::AllocateData(UInt_t harmonicMask) {
+  fHarmonicIndex.assign(nMaxHarmonicNumberSupported + 1, -1);
+  fNHarmonics = 0;
+  for (Int_t harmonic = 1; harmonic <= nMaxHarmonicNumberSupported; harmonic++) {
+    if (harmonicMask & harmonicNumberMask[harmonic]) fHarmonicIndex[harmonic] = fNHarmonics++;
+  }
+  const auto nBins = static_cast<std::size_t>(fEntries->GetNbins());
+  fData.assign(nBins*CORRELATIONSNOOFQNVECTORS*fNHarmonics*8, 0.);
+  fEntriesData.assign(nBins, 0.);
+  fFills.assign(CORRELATIONSNOOFQNVECTORS*fNHarmonics, 0.);
+  fModified = kFALSE;
+}
+
+/// Copies the content of the attached histograms into the dense array
+void CorrectionProfile3DCorrelations::ReadHistograms() {
+  const Long64_t nBins = fEntries->GetNbins();
+  for (Long64_t bin = 0; bin < nBins; bin++) {
+    fEntriesData[bin] = fEntries->GetBinContent(bin);
+  }
+  for (Int_t ixComb = 0; ixComb < CORRELATIONSNOOFQNVECTORS; ixComb++) {
+    for (Int_t harmonic = 1; harmonic <= nMaxHarmonicNumberSupported; harmonic++) {
+      const Int_t index = fHarmonicIndex[harmonic];
+      if (index < 0) continue;
+      THnF *values[4] = {fXXValues[ixComb][harmonic], fXYValues[ixComb][harmonic],
+                         fYXValues[ixComb][harmonic], fYYValues[ixComb][harmonic]};
+      for (Long64_t bin = 0; bin < nBins; bin++) {
+        auto data = fData.data() + DataIndex(ixComb, index, bin);
+        for (Int_t component = 0; component < 4; component++) {
+          data[component] = values[component]->GetBinContent(bin);
+          data[4 + component] = values[component]->GetBinError2(bin);
+        }
+      }
+      fFills[ixComb*fNHarmonics + index] = values[0]->GetEntries();
+    }
+  }
+}
+
+/// Copies the dense array into the histograms
+///
+/// Needs to be called before the histograms are stored or merged.
+/// Nothing is done if the profile has not been filled since the last update.
+void CorrectionProfile3DCorrelations::UpdateHistograms() {
+  if (!fModified) return;
+  const Long64_t nBins = fEntries->GetNbins();
+  Double_t nEntries = 0.;
+  for (Long64_t bin = 0; bin < nBins; bin++) {
+    fEntries->SetBinContent(bin, fEntriesData[bin]);
+    nEntries += fEntriesData[bin];
+  }
+  fEntries->SetEntries(nEntries);
+  for (Int_t ixComb = 0; ixComb < CORRELATIONSNOOFQNVECTORS; ixComb++) {
+    for (Int_t harmonic = 1; harmonic <= nMaxHarmonicNumberSupported; harmonic++) {
+      const Int_t index = fHarmonicIndex[harmonic];
+      if (index < 0) continue;
+      THnF *values[4] = {fXXValues[ixComb][harmonic], fXYValues[ixComb][harmonic],
+                         fYXValues[ixComb][harmonic], fYYValues[ixComb][harmonic]};
+      for (Long64_t bin = 0; bin < nBins; bin++) {
+        const auto data = fData.data() + DataIndex(ixComb, index, bin);
+        for (Int_t component = 0; component < 4; component++) {
+          values[component]->SetBinContent(bin, data[component]);
+          values[component]->SetBinError2(bin, data[4 + component]);
+        }
+      }
+      for (auto value : values) value->SetEntries(fFills[ixComb*fNHarmonics + index]);
+    }
+  }
+  fModified = kFALSE;
+}
+
 /// Get the bin number for the current variable content
 ///
 /// The bin number identifies the event class the current
@@ -407,8 +495,7 @@ Bool_t CorrectionProfile3DCorrelations::AttachHistograms(TList *histogramList) {
 /// \param variableContainer the current variables content addressed by var Id
 /// \return the associated bin to the current variables content
 Long64_t CorrectionProfile3DCorrelations::GetBin() {
-  FillBinAxesValues();
-  return fEntries->GetBin(fBinAxesValues);
+  return GetEventClassBin();
 }
 
 /// Check the validity of the content of the passed bin
@@ -419,7 +506,7 @@ Long64_t CorrectionProfile3DCorrelations::GetBin() {
 /// \param bin the bin to check its content validity
 /// \return kTRUE if the content is valid kFALSE otherwise
 Bool_t CorrectionProfile3DCorrelations::BinContentValidated(Long64_t bin) {
-  auto nEntries = Int_t(fEntries->GetBinContent(bin));
+  auto nEntries = Int_t(fEntriesData[bin]);
 
   return nEntries >= fMinNoOfEntriesToValidate;
 }
@@ -446,15 +533,15 @@ Float_t CorrectionProfile3DCorrelations::GetXXBinContent(const char *comb, Int_t
   else
     return 0.0;
   /* sanity check */
-  if (fXXValues[ixComb][harmonic]==nullptr) {
+  if (fHarmonicIndex[harmonic] < 0) {
     return 0.0;
   }
 
   if (!BinContentValidated(bin)) {
     return 0.0;
   } else {
-    auto nEntries = Int_t(fEntries->GetBinContent(bin));
-    return fXXValues[ixComb][harmonic]->GetBinContent(bin)/Float_t(nEntries);
+    auto nEntries = Int_t(fEntriesData[bin]);
+    return fData[DataIndex(ixComb, fHarmonicIndex[harmonic], bin) + 0]/Float_t(nEntries);
   }
 }
 
@@ -480,14 +567,14 @@ Float_t CorrectionProfile3DCorrelations::GetXYBinContent(const char *comb, Int_t
   else
     return 0.0;
   /* sanity check */
-  if (!fXYValues[ixComb][harmonic]) {
+  if (fHarmonicIndex[harmonic] < 0) {
     return 0.0;
   }
   if (!BinContentValidated(bin)) {
     return 0.0;
   } else {
-    auto nEntries = Int_t(fEntries->GetBinContent(bin));
-    return fXYValues[ixComb][harmonic]->GetBinContent(bin)/Float_t(nEntries);
+    auto nEntries = Int_t(fEntriesData[bin]);
+    return fData[DataIndex(ixComb, fHarmonicIndex[harmonic], bin) + 1]/Float_t(nEntries);
   }
 }
 
@@ -513,14 +600,14 @@ Float_t CorrectionProfile3DCorrelations::GetYXBinContent(const char *comb, Int_t
   else
     return 0.0;
   /* sanity check */
-  if (!fYXValues[ixComb][harmonic]) {
+  if (fHarmonicIndex[harmonic] < 0) {
     return 0.0;
   }
   if (!BinContentValidated(bin)) {
     return 0.0;
   } else {
-    auto nEntries = Int_t(fEntries->GetBinContent(bin));
-    return fYXValues[ixComb][harmonic]->GetBinContent(bin)/Float_t(nEntries);
+    auto nEntries = Int_t(fEntriesData[bin]);
+    return fData[DataIndex(ixComb, fHarmonicIndex[harmonic], bin) + 2]/Float_t(nEntries);
   }
 }
 
@@ -546,14 +633,14 @@ Float_t CorrectionProfile3DCorrelations::GetYYBinContent(const char *comb, Int_t
   else
     return 0.0;
   /* sanity check */
-  if (fYYValues[ixComb][harmonic]==nullptr) {
+  if (fHarmonicIndex[harmonic] < 0) {
     return 0.0;
   }
   if (!BinContentValidated(bin)) {
     return 0.0;
   } else {
-    auto nEntries = Int_t(fEntries->GetBinContent(bin));
-    return fYYValues[ixComb][harmonic]->GetBinContent(bin)/Float_t(nEntries);
+    auto nEntries = Int_t(fEntriesData[bin]);
+    return fData[DataIndex(ixComb, fHarmonicIndex[harmonic], bin) + 3]/Float_t(nEntries);
   }
 }
 
@@ -579,15 +666,15 @@ Float_t CorrectionProfile3DCorrelations::GetXXBinError(const char *comb, Int_t h
   else
     return 0.0;
   /* sanity check */
-  if (fXXValues[ixComb][harmonic]==nullptr) {
+  if (fHarmonicIndex[harmonic] < 0) {
     return 0.0;
   }
   if (!BinContentValidated(bin)) {
     return 0.0;
   } else {
-    auto nEntries = Int_t(fEntries->GetBinContent(bin));
-    Float_t values = fXXValues[ixComb][harmonic]->GetBinContent(bin);
-    Float_t error2 = fXXValues[ixComb][harmonic]->GetBinError2(bin);
+    auto nEntries = Int_t(fEntriesData[bin]);
+    Float_t values = fData[DataIndex(ixComb, fHarmonicIndex[harmonic], bin) + 0];
+    Float_t error2 = fData[DataIndex(ixComb, fHarmonicIndex[harmonic], bin) + 4];
 
     Double_t average = values/nEntries;
     Double_t serror = TMath::Sqrt(TMath::Abs(error2/nEntries - average*average));
@@ -621,15 +708,15 @@ Float_t CorrectionProfile3DCorrelations::GetXYBinError(const char *comb, Int_t h
   else
     return 0.0;
   /* sanity check */
-  if (fXYValues[ixComb][harmonic]==nullptr) {
+  if (fHarmonicIndex[harmonic] < 0) {
     return 0.0;
   }
   if (!BinContentValidated(bin)) {
     return 0.0;
   } else {
-    Int_t nEntries = Int_t(fEntries->GetBinContent(bin));
-    Float_t values = fXYValues[ixComb][harmonic]->GetBinContent(bin);
-    Float_t error2 = fXYValues[ixComb][harmonic]->GetBinError2(bin);
+    Int_t nEntries = Int_t(fEntriesData[bin]);
+    Float_t values = fData[DataIndex(ixComb, fHarmonicIndex[harmonic], bin) + 1];
+    Float_t error2 = fData[DataIndex(ixComb, fHarmonicIndex[harmonic], bin) + 5];
 
     Double_t average = values/nEntries;
     Double_t serror = TMath::Sqrt(TMath::Abs(error2/nEntries - average*average));
@@ -664,16 +751,16 @@ Float_t CorrectionProfile3DCorrelations::GetYXBinError(const char *comb, Int_t h
     return 0.0;
 
   /* sanity check */
-  if (fYXValues[ixComb][harmonic]==nullptr) {
+  if (fHarmonicIndex[harmonic] < 0) {
     return 0.0;
   }
 
   if (!BinContentValidated(bin)) {
     return 0.0;
   } else {
-    auto nEntries = Int_t(fEntries->GetBinContent(bin));
-    Float_t values = fYXValues[ixComb][harmonic]->GetBinContent(bin);
-    Float_t error2 = fYXValues[ixComb][harmonic]->GetBinError2(bin);
+    auto nEntries = Int_t(fEntriesData[bin]);
+    Float_t values = fData[DataIndex(ixComb, fHarmonicIndex[harmonic], bin) + 2];
+    Float_t error2 = fData[DataIndex(ixComb, fHarmonicIndex[harmonic], bin) + 6];
 
     Double_t average = values/nEntries;
     Double_t serror = TMath::Sqrt(TMath::Abs(error2/nEntries - average*average));
@@ -707,15 +794,15 @@ Float_t CorrectionProfile3DCorrelations::GetYYBinError(const char *comb, Int_t h
   else
     return 0.0;
   /* sanity check */
-  if (fYYValues[ixComb][harmonic]==nullptr) {
+  if (fHarmonicIndex[harmonic] < 0) {
     return 0.0;
   }
   if (!BinContentValidated(bin)) {
     return 0.0;
   } else {
-    auto nEntries = Int_t(fEntries->GetBinContent(bin));
-    Float_t values = fYYValues[ixComb][harmonic]->GetBinContent(bin);
-    Float_t error2 = fYYValues[ixComb][harmonic]->GetBinError2(bin);
+    auto nEntries = Int_t(fEntriesData[bin]);
+    Float_t values = fData[DataIndex(ixComb, fHarmonicIndex[harmonic], bin) + 3];
+    Float_t error2 = fData[DataIndex(ixComb, fHarmonicIndex[harmonic], bin) + 7];
     Double_t average = values/nEntries;
     Double_t serror = TMath::Sqrt(TMath::Abs(error2/nEntries - average*average));
     switch (fErrorMode) {
@@ -749,43 +836,36 @@ void CorrectionProfile3DCorrelations::Fill(const QVector *QnA,
       || (QnA->GetHarmonicMultiplier()!=QnC->GetHarmonicMultiplier())) {
     return;
   }
-  /* let's get the axis information */
-  FillBinAxesValues();
+  /* let's get the event class bin */
+  const Long64_t bin = GetEventClassBin();
   /* consider all combinations */
   const QVector *combQn[CORRELATIONSNOOFQNVECTORS] = {QnA, QnB, QnC};
   for (Int_t ixComb = 0; ixComb < CORRELATIONSNOOFQNVECTORS; ixComb++) {
+    const QVector *first = combQn[ixComb];
+    const QVector *second = combQn[(ixComb + 1)%CORRELATIONSNOOFQNVECTORS];
     /* and all harmonics */
     Int_t nCurrentHarmonic = QnA->GetFirstHarmonic();
     while (nCurrentHarmonic!=-1) {
       /* first the sanity checks */
-      if (fXXValues[ixComb][nCurrentHarmonic]==nullptr) {
+      const Int_t index = fHarmonicIndex[nCurrentHarmonic];
+      if (index < 0) {
         return;
       }
-      /* keep total entries in fValues updated */
-      Double_t nXXEntries = fXXValues[ixComb][nCurrentHarmonic]->GetEntries();
-      Double_t nXYEntries = fXYValues[ixComb][nCurrentHarmonic]->GetEntries();
-      Double_t nYXEntries = fYXValues[ixComb][nCurrentHarmonic]->GetEntries();
-      Double_t nYYEntries = fYYValues[ixComb][nCurrentHarmonic]->GetEntries();
-      fXXValues[ixComb][nCurrentHarmonic]->Fill(fBinAxesValues,
-                                                combQn[ixComb]->x(nCurrentHarmonic)*combQn[(ixComb + 1)
-                                                    %CORRELATIONSNOOFQNVECTORS]->x(nCurrentHarmonic));
-      fXYValues[ixComb][nCurrentHarmonic]->Fill(fBinAxesValues,
-                                                combQn[ixComb]->x(nCurrentHarmonic)*combQn[(ixComb + 1)
-                                                    %CORRELATIONSNOOFQNVECTORS]->y(nCurrentHarmonic));
-      fYXValues[ixComb][nCurrentHarmonic]->Fill(fBinAxesValues,
-                                                combQn[ixComb]->y(nCurrentHarmonic)*combQn[(ixComb + 1)
-                                                    %CORRELATIONSNOOFQNVECTORS]->x(nCurrentHarmonic));
-      fYYValues[ixComb][nCurrentHarmonic]->Fill(fBinAxesValues,
-                                                combQn[ixComb]->y(nCurrentHarmonic)*combQn[(ixComb + 1)
-                                                    %CORRELATIONSNOOFQNVECTORS]->y(nCurrentHarmonic));
-      fXXValues[ixComb][nCurrentHarmonic]->SetEntries(nXXEntries + 1);
-      fXYValues[ixComb][nCurrentHarmonic]->SetEntries(nXYEntries + 1);
-      fYXValues[ixComb][nCurrentHarmonic]->SetEntries(nYXEntries + 1);
-      fYYValues[ixComb][nCurrentHarmonic]->SetEntries(nYYEntries + 1);
+      const Double_t components[4] = {first->x(nCurrentHarmonic)*second->x(nCurrentHarmonic),
+                                      first->x(nCurrentHarmonic)*second->y(nCurrentHarmonic),
+                                      first->y(nCurrentHarmonic)*second->x(nCurrentHarmonic),
+                                      first->y(nCurrentHarmonic)*second->y(nCurrentHarmonic)};
+      auto data = fData.data() + DataIndex(ixComb, index, bin);
+      for (Int_t component = 0; component < 4; component++) {
+        data[component] += components[component];
+        data[4 + component] += components[component]*components[component];
+      }
+      fFills[ixComb*fNHarmonics + index] += 1;
+      fModified = kTRUE;
       nCurrentHarmonic = QnA->GetNextHarmonic(nCurrentHarmonic);
     }
   }
   /* update the profile entries */
-  fEntries->Fill(fBinAxesValues, 1.0);
+  fEntriesData[bin] += 1;
+}
 }
-}
\ No newline at end of file
@@ -142,6 +142,9 @@ Bool_t CorrectionProfileChannelized::CreateProfileHistograms(TList *histogramLis
     }
   }
   fValues->Sumw2();
+  fData.assign(fEventClassVariables.GetNumberOfBins()*fActualNoOfChannels*3, 0.);
+  fFills = 0.;
+  fModified = kFALSE;
   histogramList->Add(fValues);
   histogramList->Add(fEntries);
   delete[] minvals;
@@ -159,9 +162,7 @@ Bool_t CorrectionProfileChannelized::CreateProfileHistograms(TList *histogramLis
 /// \param nChannel the interested external channel number
 /// \return the associated bin to the current variables content
 Long64_t CorrectionProfileChannelized::GetBin(Int_t nChannel) {
-  FillBinAxesValues(fChannelMap[nChannel]);
-  /* store the channel number */
-  return fEntries->GetBin(fBinAxesValues);
+  return GetEventClassBin(fEntries, fChannelMap[nChannel]);
 }
 
 /// Check the validity of the content of the passed bin
@@ -219,20 +220,62 @@ Float_t CorrectionProfileChannelized::GetBinError(Long64_t bin) {
   }
 }
 
-/// Fills the histogram
+/// Fills the profile
 ///
-/// The involved bin is computed according to the current variables
-/// content and the passed external channel number. The bin is then
-/// increased by the given weight and the entries also increased properly.
+/// The involved event class is computed according to the current variables
+/// content. The entry of the passed external channel number is then
+/// increased by the given weight.
 ///
-/// \param variableContainer the current variables content addressed by var Id
 /// \param nChannel the interested external channel number
 /// \param weight the increment in the bin content
 void CorrectionProfileChannelized::Fill(Int_t nChannel, Float_t weight) {
-  Double_t nEntries = fValues->GetEntries();
-  FillBinAxesValues(fChannelMap[nChannel]);
-  fValues->Fill(fBinAxesValues, weight);
-  fValues->SetEntries(nEntries + 1);
-  fEntries->Fill(fBinAxesValues, 1.0);
+  auto data = fData.data() + DataIndex(nChannel, GetEventClassBin());
+  data[0] += weight;
+  data[1] += weight*weight;
+  data[2] += 1.;
+  fFills += 1.;
+  fModified = kTRUE;
+}
+
+/// Fills the profile with the equalized weights of a data vector bank
+///
+/// The event class is computed once for the whole bank.
+///
+/// \param bank the data vectors, whose ids are the external channel numbers
+void CorrectionProfileChannelized::Fill(const CorrectionDataBank &bank) {
+  const auto eventClassBin = GetEventClassBin();
+  const auto ids = bank.Ids();
+  const auto weights = bank.EqualizedWeights();
+  for (std::size_t i = 0; i < bank.Size(); ++i) {
+    auto data = fData.data() + DataIndex(ids[i], eventClassBin);
+    const Double_t weight = weights[i];
+    data[0] += weight;
+    data[1] += weight*weight;
+    data[2] += 1.;
+  }
+  fFills += bank.Size();
+  fModified = fModified || !bank.Empty();
+}
+
+/// Copies the dense array into the histograms
+///
+/// Needs to be called before the histograms are stored or merged.
+/// Nothing is done if the profile has not been filled since the last update.
+void CorrectionProfileChannelized::UpdateHistograms() {
+  if (!fModified) return;
+  const Long64_t nEventClassBins = fEventClassVariables.GetNumberOfBins();
+  for (Long64_t eventClassBin = 0; eventClassBin < nEventClassBins; eventClassBin++) {
+    for (Int_t channel = 0; channel < fActualNoOfChannels; channel++) {
+      const auto data = fData.data() + (eventClassBin*fActualNoOfChannels + channel)*3;
+      if (data[2]==0.) continue;
+      const Long64_t bin = GetEventClassBin(fEntries, channel, eventClassBin);
+      fValues->SetBinContent(bin, data[0]);
+      fValues->SetBinError2(bin, data[1]);
+      fEntries->SetBinContent(bin, data[2]);
+    }
+  }
+  fValues->SetEntries(fFills);
+  fEntries->SetEntries(fFills);
+  fModified = kFALSE;
 }
 }
@@ -52,9 +52,6 @@ CorrectionProfileChannelizedIngress::~CorrectionProfileChannelizedIngress() {
   delete[] fUsedChannel;
   delete[] fChannelGroup;
   delete[] fChannelMap;
-  delete fValues;
-  delete fGroupValues;
-  delete fValidated;
   delete[] fUsedGroup;
   delete[] fGroupMap;
 }
@@ -87,10 +84,10 @@ Bool_t CorrectionProfileChannelizedIngress::AttachHistograms(TList *histogramLis
   TString histoName = GetName();
   TString entriesHistoName = GetName();
   entriesHistoName += szEntriesHistoSuffix;
-  /* initialize. Remember we own the histograms */
-  delete fValues;
-  delete fGroupValues;
-  delete fValidated;
+  /* initialize. Remember we don't own the histograms */
+  fValues = nullptr;
+  fGroupValues = nullptr;
+  fValidated = nullptr;
   delete[] fUsedChannel;
   delete[] fChannelGroup;
   delete[] fChannelMap;
@@ -172,6 +169,26 @@ Bool_t CorrectionProfileChannelizedIngress::AttachHistograms(TList *histogramLis
       return kFALSE;
 
     /* so we got the original histograms */
+    /* the definitive histograms are built once and shared by all profiles */
+    /* attached to the same input list e.g. the ones of the other slots */
+    TString derivedListName = histoName;
+    derivedListName += szDerivedListSuffix;
+    auto derivedList = (TList *) histogramList->FindObject((const char *) derivedListName);
+    if (derivedList) {
+      fValues = (THnF *) derivedList->FindObject((const char *) histoName);
+      fValidated = (THnC *) derivedList->FindObject(Form("%s_Validated", (const char *) histoName));
+      if (fUseGroups) {
+        TString histoGroupName = szGroupHistoPrefix;
+        histoGroupName += GetName();
+        fGroupValues = (THnF *) derivedList->FindObject((const char *) histoGroupName);
+      }
+      return (fValues!=nullptr) && (fValidated!=nullptr) && (!fUseGroups || fGroupValues!=nullptr);
+    }
+    derivedList = new TList();
+    derivedList->SetName((const char *) derivedListName);
+    derivedList->SetOwner(kTRUE);
+    histogramList->Add(derivedList);
+
     /* now we should build the definitive histogram value / error */
     /* and the group value / error histogram if applicable */
 
@@ -195,6 +212,8 @@ Bool_t CorrectionProfileChannelizedIngress::AttachHistograms(TList *histogramLis
                           maxvals);
     /* and now the definitive histogram value /error getting validation information */
     fValues = DivideTHnF(origValues, origEntries, fValidated);
+    derivedList->Add(fValues);
+    derivedList->Add(fValidated);
     if (fUseGroups) {
       /* let's then build the groups histogram */
       TString histoGroupName = szGroupHistoPrefix;
@@ -235,6 +254,7 @@ Bool_t CorrectionProfileChannelizedIngress::AttachHistograms(TList *histogramLis
       }
 
       fGroupValues->Sumw2();
+      derivedList->Add(fGroupValues);
 
       /* now let's build its content */
       /* the procedure is as follows: we will project and add together the values histogram */
@@ -302,17 +322,15 @@ Bool_t CorrectionProfileChannelizedIngress::AttachHistograms(TList *histogramLis
   return kTRUE;
 }
 
-/// Get the bin number for the current variable content and passed channel
+/// Get the bin number for the passed event class and channel
 ///
-/// The bin number identifies the event class the current
-/// variable content points to under the passed channel.
+/// The bin number identifies the event class under the passed channel.
 ///
-/// \param variableContainer the current variables content addressed by var Id
 /// \param nChannel the interested external channel number
-/// \return the associated bin to the current variables content
-Long64_t CorrectionProfileChannelizedIngress::GetBin(Int_t nChannel) {
-  FillBinAxesValues(fChannelMap[nChannel]);
-  return fValues->GetBin(fBinAxesValues);
+/// \param eventClassBin the event class bin
+/// \return the associated bin to the event class and channel
+Long64_t CorrectionProfileChannelizedIngress::GetBin(Int_t nChannel, Long64_t eventClassBin) {
+  return GetEventClassBin(fValues, fChannelMap[nChannel], eventClassBin);
 }
 
 /// Check the validity of the content of the passed bin
@@ -346,19 +364,16 @@ Float_t CorrectionProfileChannelizedIngress::GetBinError(Long64_t bin) {
   return fValues->GetBinError(bin);
 }
 
-/// Get the bin number for the current variable content and passed channel group number
+/// Get the bin number for the passed event class and channel group number
 ///
-/// The bin number identifies the event class the current
-/// variable content points to under the passed channel group number.
+/// The bin number identifies the event class under the passed channel group number.
 ///
-/// \param variableContainer the current variables content addressed by var Id
 /// \param nChannel the interested external channel number which group number is asked
-/// \return the associated bin to the current variables content
-Long64_t CorrectionProfileChannelizedIngress::GetGrpBin(Int_t nChannel) {
+/// \param eventClassBin the event class bin
+/// \return the associated bin to the event class and channel group
+Long64_t CorrectionProfileChannelizedIngress::GetGrpBin(Int_t nChannel, Long64_t eventClassBin) {
   if (fUseGroups) {
-    /* store also the group number */
-    FillBinAxesValues(fGroupMap[fChannelGroup[nChannel]]);
-    return fGroupValues->GetBin(fBinAxesValues);
+    return GetEventClassBin(fGroupValues, fGroupMap[fChannelGroup[nChannel]], eventClassBin);
   }
   return -1;
 }
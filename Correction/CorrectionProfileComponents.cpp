@@ -172,6 +172,7 @@ Bool_t CorrectionProfileComponents::CreateComponentsProfileHistograms(TList *his
   delete[] minvals;
   delete[] maxvals;
   delete[] nbins;
+  AllocateData(nNumberOfSlots);
   return kTRUE;
 }
 
@@ -229,10 +230,82 @@ Bool_t CorrectionProfileComponents::AttachHistograms(TList *histogramList) {
   } else {
     return kFALSE;
   }
+  /* convert the histograms into the dense array */
+  AllocateData(nMaxHarmonicNumberSupported + 1);
+  ReadHistograms();
   /* check that we actually got something */
   return fFullFilled!=0x0000;
 }
 
+/// Allocates the dense array for the harmonics of the fully filled condition
+///
+/// The harmonics are stored in increasing order of their external number.
+/// The array is indexed by the bin numbers of the entries histogram.
+///
+/// \param nNumberOfSlots the number of slots of the harmonic histograms arrays
+void CorrectionProfileComponents::AllocateData(Int_t nNumberOfSlots) {
+  fHarmonicIndex.assign(nMaxHarmonicNumberSupported + 1, -1);
+  fNHarmonics = 0;
+  for (Int_t harmonic = 1; harmonic < nNumberOfSlots; harmonic++) {
+    if (fFullFilled & harmonicNumberMask[harmonic]) fHarmonicIndex[harmonic] = fNHarmonics++;
+  }
+  const auto nBins = static_cast<std::size_t>(fEntries->GetNbins());
+  fData.assign(nBins*fNHarmonics*4, 0.);
+  fEntriesData.assign(nBins, 0.);
+  fFills.assign(2*fNHarmonics, 0.);
+  fModified = kFALSE;
+}
+
+/// Copies the content of the attached histograms into the dense array
+void CorrectionProfileComponents::ReadHistograms() {
+  const Long64_t nBins = fEntries->GetNbins();
+  for (Long64_t bin = 0; bin < nBins; bin++) {
+    fEntriesData[bin] = fEntries->GetBinContent(bin);
+  }
+  for (Int_t harmonic = 1; harmonic <= nMaxHarmonicNumberSupported; harmonic++) {
+    const Int_t index = fHarmonicIndex[harmonic];
+    if (index < 0) continue;
+    for (Long64_t bin = 0; bin < nBins; bin++) {
+      auto data = fData.data() + DataIndex(index, bin);
+      data[0] = fXValues[harmonic]->GetBinContent(bin);
+      data[1] = fYValues[harmonic]->GetBinContent(bin);
+      data[2] = fXValues[harmonic]->GetBinError2(bin);
+      data[3] = fYValues[harmonic]->GetBinError2(bin);
+    }
+    fFills[2*index] = fXValues[harmonic]->GetEntries();
+    fFills[2*index + 1] = fYValues[harmonic]->GetEntries();
+  }
+}
+
+/// Copies the dense array into the histograms
+///
+/// Needs to be called before the histograms are stored or merged.
+/// Nothing is done if the profile has not been filled since the last update.
+void CorrectionProfileComponents::UpdateHistograms() {
+  if (!fModified) return;
+  const Long64_t nBins = fEntries->GetNbins();
+  Double_t nEntries = 0.;
+  for (Long64_t bin = 0; bin < nBins; bin++) {
+    fEntries->SetBinContent(bin, fEntriesData[bin]);
+    nEntries += fEntriesData[bin];
+  }
+  fEntries->SetEntries(nEntries);
+  for (Int_t harmonic = 1; harmonic <= nMaxHarmonicNumberSupported; harmonic++) {
+    const Int_t index = fHarmonicIndex[harmonic];
+    if (index < 0) continue;
+    for (Long64_t bin = 0; bin < nBins; bin++) {
+      const auto data = fData.data() + DataIndex(index, bin);
+      fXValues[harmonic]->SetBinContent(bin, data[0]);
+      fYValues[harmonic]->SetBinContent(bin, data[1]);
+      fXValues[harmonic]->SetBinError2(bin, data[2]);
+      fYValues[harmonic]->SetBinError2(bin, data[3]);
+    }
+    fXValues[harmonic]->SetEntries(fFills[2*index]);
+    fYValues[harmonic]->SetEntries(fFills[2*index + 1]);
+  }
+  fModified = kFALSE;
+}
+
 /// Get the bin number for the current variable content
 ///
 /// The bin number identifies the event class the current
@@ -241,8 +314,7 @@ Bool_t CorrectionProfileComponents::AttachHistograms(TList *histogramList) {
 /// \param variableContainer the current variables content addressed by var Id
 /// \return the associated bin to the current variables content
 Long64_t CorrectionProfileComponents::GetBin() {
-  FillBinAxesValues();
-  return fEntries->GetBin(fBinAxesValues);
+  return GetEventClassBin();
 }
 
 /// Check the validity of the content of the passed bin
@@ -253,7 +325,62 @@ Long64_t CorrectionProfileComponents::GetBin() {
 /// \param bin the bin to check its content validity
 /// \return kTRUE if the content is valid kFALSE otherwise
 Bool_t CorrectionProfileComponents::BinContentValidated(Long64_t bin) {
-  return Int_t(fEntries->GetBinContent(bin)) >= fMinNoOfEntriesToValidate;
+  return Int_t(fEntriesData[bin]) >= fMinNoOfEntriesToValidate;
+}
+
+/// Get the averages of the components of all event classes with entries
+///
+/// Used as estimate of the correction parameters while the data are being
+/// collected. The spreads of the components are returned as their widths.
+/// Event classes without entries, e.g. the under- and overflow bins, are
+/// skipped.
+///
+/// \param means the averages of the X and Y components of each harmonic for each event class with entries
+/// \param widths the spreads of the components
+/// \return kFALSE if no event class has entries or the content of one is not validated
+Bool_t CorrectionProfileComponents::GetMeans(std::vector<Double_t> &means, std::vector<Double_t> &widths) const {
+  means.clear();
+  widths.clear();
+  for (std::size_t bin = 0; bin < fEntriesData.size(); bin++) {
+    const Double_t nEntries = fEntriesData[bin];
+    if (nEntries==0) continue;
+    if (Int_t(nEntries) < fMinNoOfEntriesToValidate) return kFALSE;
+    for (Int_t index = 0; index < fNHarmonics; index++) {
+      auto data = fData.data() + DataIndex(index, bin);
+      for (Int_t component = 0; component < 2; component++) {
+        const Double_t average = data[component]/nEntries;
+        means.push_back(average);
+        widths.push_back(TMath::Sqrt(TMath::Abs(data[component + 2]/nEntries - average*average)));
+      }
+    }
+  }
+  return !means.empty();
+}
+
+/// Get the averages and spreads of the components of one event class
+///
+/// Used by the online recentering, which applies the averages of the
+/// previously filled events while the data are being collected.
+///
+/// \param harmonic the interested external harmonic number
+/// \param bin the interested bin number
+/// \param nMinEntries the minimum number of entries of the event class
+/// \param parameters the averages of the X and Y components followed by their spreads
+/// \return kFALSE if the event class has less entries or the harmonic is not present
+Bool_t CorrectionProfileComponents::GetRunningMeans(Int_t harmonic,
+                                                    Long64_t bin,
+                                                    Int_t nMinEntries,
+                                                    Double_t *parameters) const {
+  const Int_t index = fHarmonicIndex[harmonic];
+  const Double_t nEntries = fEntriesData[bin];
+  if (index < 0 || nEntries==0 || Int_t(nEntries) < nMinEntries) return kFALSE;
+  auto data = fData.data() + DataIndex(index, bin);
+  for (Int_t component = 0; component < 2; component++) {
+    const Double_t average = data[component]/nEntries;
+    parameters[component] = average;
+    parameters[component + 2] = TMath::Sqrt(TMath::Abs(data[component + 2]/nEntries - average*average));
+  }
+  return kTRUE;
 }
 
 /// Get the X component bin content for the passed bin number
@@ -267,13 +394,14 @@ Bool_t CorrectionProfileComponents::BinContentValidated(Long64_t bin) {
 /// \return the bin number content
 Float_t CorrectionProfileComponents::GetXBinContent(Int_t harmonic, Long64_t bin) {
   /* sanity check */
-  if (!fXValues[harmonic]) {
+  const Int_t index = fHarmonicIndex[harmonic];
+  if (index < 0) {
     return 0.0;
   }
   if (!BinContentValidated(bin)) {
     return 0.0;
   } else {
-    return fXValues[harmonic]->GetBinContent(bin)/fEntries->GetBinContent(bin);
+    return fData[DataIndex(index, bin) + 0]/fEntriesData[bin];
   }
 }
 
@@ -288,13 +416,14 @@ Float_t CorrectionProfileComponents::GetXBinContent(Int_t harmonic, Long64_t bin
 /// \return the bin number content
 Float_t CorrectionProfileComponents::GetYBinContent(Int_t harmonic, Long64_t bin) {
   /* sanity check */
-  if (!fYValues[harmonic]) {
+  const Int_t index = fHarmonicIndex[harmonic];
+  if (index < 0) {
     return 0.0;
   }
   if (!BinContentValidated(bin)) {
     return 0.0;
   } else {
-    return fYValues[harmonic]->GetBinContent(bin)/fEntries->GetBinContent(bin);
+    return fData[DataIndex(index, bin) + 1]/fEntriesData[bin];
   }
 }
 
@@ -309,15 +438,16 @@ Float_t CorrectionProfileComponents::GetYBinContent(Int_t harmonic, Long64_t bin
 /// \return the bin content error
 Float_t CorrectionProfileComponents::GetXBinError(Int_t harmonic, Long64_t bin) {
   /* sanity check */
-  if (!fXValues[harmonic]) {
+  const Int_t index = fHarmonicIndex[harmonic];
+  if (index < 0) {
     return 0.0;
   }
   if (!BinContentValidated(bin)) {
     return 0.0;
   } else {
-    auto nEntries = Int_t(fEntries->GetBinContent(bin));
-    Float_t values = fXValues[harmonic]->GetBinContent(bin);
-    Float_t error2 = fXValues[harmonic]->GetBinError2(bin);
+    auto nEntries = Int_t(fEntriesData[bin]);
+    Double_t values = fData[DataIndex(index, bin) + 0];
+    Double_t error2 = fData[DataIndex(index, bin) + 2];
     Double_t average = values/nEntries;
     Double_t serror = TMath::Sqrt(TMath::Abs(error2/nEntries - average*average));
     switch (fErrorMode) {
@@ -344,15 +474,16 @@ Float_t CorrectionProfileComponents::GetXBinError(Int_t harmonic, Long64_t bin)
 /// \return the bin content error
 Float_t CorrectionProfileComponents::GetYBinError(Int_t harmonic, Long64_t bin) {
   /* sanity check */
-  if (fYValues[harmonic]==nullptr) {
+  const Int_t index = fHarmonicIndex[harmonic];
+  if (index < 0) {
     return 0.0;
   }
   if (!BinContentValidated(bin)) {
     return 0.0;
   } else {
-    auto nEntries = Int_t(fEntries->GetBinContent(bin));
-    Float_t values = fYValues[harmonic]->GetBinContent(bin);
-    Float_t error2 = fYValues[harmonic]->GetBinError2(bin);
+    auto nEntries = Int_t(fEntriesData[bin]);
+    Double_t values = fData[DataIndex(index, bin) + 1];
+    Double_t error2 = fData[DataIndex(index, bin) + 3];
     Double_t average = values/nEntries;
     Double_t serror = TMath::Sqrt(TMath::Abs(error2/nEntries - average*average));
     switch (fErrorMode) {
@@ -381,24 +512,26 @@ Float_t CorrectionProfileComponents::GetYBinError(Int_t harmonic, Long64_t bin)
 /// \param weight the increment in the bin content
 void CorrectionProfileComponents::FillX(Int_t harmonic, Float_t weight) {
   /* first the sanity checks */
-  if (fXValues[harmonic]==nullptr) {
+  const Int_t index = fHarmonicIndex[harmonic];
+  if (index < 0) {
     return;
   }
   if (fXharmonicFillMask & harmonicNumberMask[harmonic]) {
   }
   /* now it's safe to continue */
-  /* keep total entries in fValues updated */
-  Double_t nEntries = fXValues[harmonic]->GetEntries();
-  FillBinAxesValues();
-  fXValues[harmonic]->Fill(fBinAxesValues, weight);
-  fXValues[harmonic]->SetEntries(nEntries + 1);
+  const Long64_t bin = GetBin();
+  auto data = fData.data() + DataIndex(index, bin);
+  data[0] += weight;
+  data[2] += weight*weight;
+  fFills[2*index] += 1;
+  fModified = kTRUE;
   /* update harmonic fill mask */
   fXharmonicFillMask |= harmonicNumberMask[harmonic];
   /* now check if time for updating entries histogram */
   if (fXharmonicFillMask!=fFullFilled) return;
   if (fYharmonicFillMask!=fFullFilled) return;
   /* update entries and reset the masks */
-  fEntries->Fill(fBinAxesValues, 1.0);
+  fEntriesData[bin] += 1;
   fXharmonicFillMask = 0x0000;
   fYharmonicFillMask = 0x0000;
 }
@@ -416,27 +549,65 @@ void CorrectionProfileComponents::FillX(Int_t harmonic, Float_t weight) {
 /// \param weight the increment in the bin content
 void CorrectionProfileComponents::FillY(Int_t harmonic, Float_t weight) {
   /* first the sanity checks */
-  if (fYValues[harmonic]==nullptr) {
+  const Int_t index = fHarmonicIndex[harmonic];
+  if (index < 0) {
     return;
   }
   if (fYharmonicFillMask & harmonicNumberMask[harmonic]) {
     return;
   }
   /* now it's safe to continue */
-  /* keep total entries in fValues updated */
-  Double_t nEntries = fYValues[harmonic]->GetEntries();
-  FillBinAxesValues();
-  fYValues[harmonic]->Fill(fBinAxesValues, weight);
-  fYValues[harmonic]->SetEntries(nEntries + 1);
+  const Long64_t bin = GetBin();
+  auto data = fData.data() + DataIndex(index, bin);
+  data[1] += weight;
+  data[3] += weight*weight;
+  fFills[2*index + 1] += 1;
+  fModified = kTRUE;
   /* update harmonic fill mask */
   fYharmonicFillMask |= harmonicNumberMask[harmonic];
   /* now check if time for updating entries histogram */
   if (fYharmonicFillMask!=fFullFilled) return;
   if (fXharmonicFillMask!=fFullFilled) return;
   /* update entries and reset the masks */
-  fEntries->Fill(fBinAxesValues, 1.0);
+  fEntriesData[bin] += 1;
   fXharmonicFillMask = 0x0000;
   fYharmonicFillMask = 0x0000;
 }
-}
 
+/// Fills the X and Y components of all harmonics of the Q vector
+///
+/// Equivalent to calling FillX and FillY for each harmonic of the
+/// Q vector, but the bin is only computed once and the components of
+/// the harmonics are updated in the contiguous slice of the event class.
+///
+/// \param qvector the Q vector providing the components
+void CorrectionProfileComponents::Fill(const QVector &qvector) {
+  const Long64_t bin = GetBin();
+  auto data = fData.data() + DataIndex(0, bin);
+  for (auto harmonic = qvector.GetFirstHarmonic(); harmonic!=-1; harmonic = qvector.GetNextHarmonic(harmonic)) {
+    const Int_t index = fHarmonicIndex[harmonic];
+    if (index < 0) continue;
+    const Double_t x = qvector.x(harmonic);
+    const Double_t y = qvector.y(harmonic);
+    auto components = data + 4*index;
+    components[0] += x;
+    components[2] += x*x;
+    fFills[2*index] += 1;
+    fXharmonicFillMask |= harmonicNumberMask[harmonic];
+    if (!(fYharmonicFillMask & harmonicNumberMask[harmonic])) {
+      components[1] += y;
+      components[3] += y*y;
+      fFills[2*index + 1] += 1;
+      fYharmonicFillMask |= harmonicNumberMask[harmonic];
+    }
+  }
+  fModified = kTRUE;
+  /* now check if time for updating entries histogram */
+  if (fXharmonicFillMask!=fFullFilled) return;
+  if (fYharmonicFillMask!=fFullFilled) return;
+  /* update entries and reset the masks */
+  fEntriesData[bin] += 1;
+  fXharmonicFillMask = 0x0000;
+  fYharmonicFillMask = 0x0000;
+}
+}
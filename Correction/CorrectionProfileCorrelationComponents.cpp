@@ -205,8 +205,7 @@ Bool_t CorrectionProfileCorrelationComponents::AttachHistograms(TList *histogram
 /// \param variableContainer the current variables content addressed by var Id
 /// \return the associated bin to the current variables content
 Long64_t CorrectionProfileCorrelationComponents::GetBin() {
-  FillBinAxesValues();
-  return fEntries->GetBin(fBinAxesValues);
+  return GetEventClassBin();
 }
 
 /// Check the validity of the content of the passed bin
@@ -422,15 +421,15 @@ void CorrectionProfileCorrelationComponents::FillXX(Float_t weight) {
     /* now it's safe to continue */
     /* keep total entries in fValues updated */
     Double_t nEntries = fXXValues->GetEntries();
-    FillBinAxesValues();
-    fXXValues->Fill(fBinAxesValues, weight);
+    const Long64_t bin = GetEventClassBin();
+    fXXValues->FillBin(bin, weight);
     fXXValues->SetEntries(nEntries + 1);
     /* update fill mask */
     fXXXYYXYYFillMask |= correlationXXmask;
     /* now check if time for updating entries histogram */
     if (fXXXYYXYYFillMask!=fFullFilled) return;
     /* update entries and reset the masks */
-    fEntries->Fill(fBinAxesValues, 1.0);
+    fEntries->FillBin(bin, 1.0);
     fXXXYYXYYFillMask = 0x0000;
   }
 }
@@ -451,15 +450,15 @@ void CorrectionProfileCorrelationComponents::FillXY(Float_t weight) {
     /* now it's safe to continue */
     /* keep total entries in fValues updated */
     Double_t nEntries = fXYValues->GetEntries();
-    FillBinAxesValues();
-    fXYValues->Fill(fBinAxesValues, weight);
+    const Long64_t bin = GetEventClassBin();
+    fXYValues->FillBin(bin, weight);
     fXYValues->SetEntries(nEntries + 1);
     /* update fill mask */
     fXXXYYXYYFillMask |= correlationXYmask;
     /* now check if time for updating entries histogram */
     if (fXXXYYXYYFillMask!=fFullFilled) return;
     /* update entries and reset the masks */
-    fEntries->Fill(fBinAxesValues, 1.0);
+    fEntries->FillBin(bin, 1.0);
     fXXXYYXYYFillMask = 0x0000;
   }
 }
@@ -481,8 +480,8 @@ void CorrectionProfileCorrelationComponents::FillYX(Float_t weight) {
     /* keep total entries in fValues updated */
     Double_t nEntries = fYXValues->GetEntries();
 
-    FillBinAxesValues();
-    fYXValues->Fill(fBinAxesValues, weight);
+    const Long64_t bin = GetEventClassBin();
+    fYXValues->FillBin(bin, weight);
     fYXValues->SetEntries(nEntries + 1);
 
     /* update fill mask */
@@ -491,7 +490,7 @@ void CorrectionProfileCorrelationComponents::FillYX(Float_t weight) {
     /* now check if time for updating entries histogram */
     if (fXXXYYXYYFillMask!=fFullFilled) return;
     /* update entries and reset the masks */
-    fEntries->Fill(fBinAxesValues, 1.0);
+    fEntries->FillBin(bin, 1.0);
     fXXXYYXYYFillMask = 0x0000;
   }
 }
@@ -512,15 +511,15 @@ void CorrectionProfileCorrelationComponents::FillYY(Float_t weight) {
     /* now it's safe to continue */
     /* keep total entries in fValues updated */
     Double_t nEntries = fYYValues->GetEntries();
-    FillBinAxesValues();
-    fYYValues->Fill(fBinAxesValues, weight);
+    const Long64_t bin = GetEventClassBin();
+    fYYValues->FillBin(bin, weight);
     fYYValues->SetEntries(nEntries + 1);
     /* update harmonic fill mask */
     fXXXYYXYYFillMask |= correlationYYmask;
     /* now check if time for updating entries histogram */
     if (fXXXYYXYYFillMask!=fFullFilled) return;
     /* update entries and reset the masks */
-    fEntries->Fill(fBinAxesValues, 1.0);
+    fEntries->FillBin(bin, 1.0);
     fXXXYYXYYFillMask = 0x0000;
   }
 }
@@ -0,0 +1,276 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "CorrectionTreeWriter.h"
+
+#include <functional>
+#include <set>
+#include <stdexcept>
+
+#ifdef FLOW_USE_RNTUPLE
+#include "ROOT/RNTuple.hxx"
+#include "ROOT/RNTupleModel.hxx"
+#include "ROOT/RNTupleOptions.hxx"
+#endif
+
+namespace Qn {
+
+/**
+ * State of the RNTuple output. The fields are added to the model until the writer is created at the first Fill.
+ */
+struct CorrectionTreeWriter::NTupleOutput {
+  TFile *file = nullptr; ///< output file. Lifetime is managed by the user.
+  std::string name; ///< name of the RNTuple
+  std::set<std::string> names; ///< names of the added outputs
+  TList layouts; ///< layouts of the flat Q-vectors
+  std::vector<std::function<void()>> commits; ///< copy the written objects into the values of the fields
+#ifdef FLOW_USE_RNTUPLE
+  std::unique_ptr<ROOT::Experimental::RNTupleModel> model; ///< model of the RNTuple until the writer is created
+  std::unique_ptr<ROOT::Experimental::RNTupleWriter> writer; ///< writer of the RNTuple
+#endif
+  bool filled = false; ///< the first event is filled, such that the fields are fixed
+  bool finished = false; ///< the RNTuple is written to the file
+};
+
+CorrectionTreeWriter::CorrectionTreeWriter() = default;
+
+CorrectionTreeWriter::~CorrectionTreeWriter() {
+  // the remaining events are written, but errors cannot be reported anymore.
+  try {
+    Finish();
+  } catch (const std::runtime_error &) {}
+}
+
+void CorrectionTreeWriter::Configure(TBranch *branch) const {
+  if (branch && compression_settings_ >= 0) branch->SetCompressionSettings(compression_settings_);
+}
+
+void CorrectionTreeWriter::ConnectNTuple(TFile *file, const std::string &name) {
+#ifdef FLOW_USE_RNTUPLE
+  if (!branches_.empty() || tree_) throw std::logic_error("The RNTuple needs to be connected before the branches.");
+  ntuple_ = std::make_unique<NTupleOutput>();
+  ntuple_->file = file;
+  ntuple_->name = name;
+  ntuple_->layouts.SetOwner(true);
+  ntuple_->model = ROOT::Experimental::RNTupleModel::Create();
+#else
+  (void) file;
+  throw std::logic_error("The RNTuple " + name + " is not available. Flow is built without FLOW_RNTUPLE.");
+#endif
+}
+
+bool CorrectionTreeWriter::AddNTupleName(const std::string &name) {
+  if (ntuple_->names.count(name)) return false;
+  if (ntuple_->filled) throw std::logic_error("The output " + name + " cannot be added after the first event.");
+  ntuple_->names.insert(name);
+  return true;
+}
+
+void CorrectionTreeWriter::MakeNTupleField(const std::string &name, const double *value) {
+#ifdef FLOW_USE_RNTUPLE
+  auto field = ntuple_->model->MakeField<double>(name);
+  ntuple_->commits.emplace_back([field, value]() { *field = *value; });
+#else
+  (void) name;
+  (void) value;
+#endif
+}
+
+void CorrectionTreeWriter::MakeNTupleField(const std::string &name, const Long64_t *value) {
+#ifdef FLOW_USE_RNTUPLE
+  auto field = ntuple_->model->MakeField<std::int64_t>(name);
+  ntuple_->commits.emplace_back([field, value]() { *field = *value; });
+#else
+  (void) name;
+  (void) value;
+#endif
+}
+
+void CorrectionTreeWriter::MakeNTupleFields(const std::string &name, const FlatQVectors *q_vectors) {
+#ifdef FLOW_USE_RNTUPLE
+  auto &model = *ntuple_->model;
+  auto n = model.MakeField<std::vector<std::int32_t>>(name + "_n");
+  auto sumw = model.MakeField<std::vector<float>>(name + "_sumw");
+  ntuple_->commits.emplace_back([=]() {
+    n->assign(q_vectors->GetN().begin(), q_vectors->GetN().end());
+    sumw->assign(q_vectors->GetSumW().begin(), q_vectors->GetSumW().end());
+  });
+  const auto &encoding = q_vectors->GetEncoding();
+  if (encoding.method==FlatQVectors::Encoding::Method::kFixedPoint) {
+    auto x = model.MakeField<std::vector<std::int16_t>>(name + "_xfix");
+    auto y = model.MakeField<std::vector<std::int16_t>>(name + "_yfix");
+    ntuple_->commits.emplace_back([=]() {
+      x->assign(q_vectors->GetXFixed().begin(), q_vectors->GetXFixed().end());
+      y->assign(q_vectors->GetYFixed().begin(), q_vectors->GetYFixed().end());
+    });
+  } else {
+    auto x = model.MakeField<std::vector<float>>(name + "_x");
+    auto y = model.MakeField<std::vector<float>>(name + "_y");
+    ntuple_->commits.emplace_back([=]() {
+      x->assign(q_vectors->GetX().begin(), q_vectors->GetX().end());
+      y->assign(q_vectors->GetY().begin(), q_vectors->GetY().end());
+    });
+  }
+  if (encoding.IsCompact()) {
+    auto quality = model.MakeField<std::vector<std::uint8_t>>(name + "_qualitybits");
+    ntuple_->commits.emplace_back([=]() {
+      quality->assign(q_vectors->GetQualityBits().begin(), q_vectors->GetQualityBits().end());
+    });
+  } else {
+    auto quality = model.MakeField<std::vector<std::uint8_t>>(name + "_quality");
+    ntuple_->commits.emplace_back([=]() {
+      quality->assign(q_vectors->GetQuality().begin(), q_vectors->GetQuality().end());
+    });
+  }
+#else
+  (void) name;
+  (void) q_vectors;
+#endif
+}
+
+bool CorrectionTreeWriter::FillOutput() {
+  if (tree_) return tree_->Fill() >= 0;
+#ifdef FLOW_USE_RNTUPLE
+  if (ntuple_->finished) return false;
+  if (!ntuple_->writer) {
+    ROOT::Experimental::RNTupleWriteOptions options;
+    if (compression_settings_ >= 0) options.SetCompression(compression_settings_);
+    options.SetApproxUnzippedPageSize(basket_size_);
+    ntuple_->writer = ROOT::Experimental::RNTupleWriter::Append(std::move(ntuple_->model), ntuple_->name,
+                                                                *ntuple_->file, options);
+  }
+  for (auto &commit : ntuple_->commits) commit();
+  ntuple_->writer->Fill();
+  return true;
+#else
+  return false;
+#endif
+}
+
+void CorrectionTreeWriter::FinishNTuple() {
+  if (!ntuple_ || ntuple_->finished) return;
+#ifdef FLOW_USE_RNTUPLE
+  // the RNTuple is committed to the file when the writer is destroyed.
+  if (!ntuple_->writer && ntuple_->model) {
+    ntuple_->writer = ROOT::Experimental::RNTupleWriter::Append(std::move(ntuple_->model), ntuple_->name,
+                                                                *ntuple_->file);
+  }
+  ntuple_->writer.reset();
+#endif
+  ntuple_->file->cd();
+  ntuple_->layouts.Write(OutputLayoutsName(ntuple_->name).data(), TObject::kSingleKey);
+  ntuple_->finished = true;
+}
+
+void CorrectionTreeWriter::BranchQVectors(const std::string &name, DataContainerQVector *source) {
+  if (ntuple_) {
+    if (!AddNTupleName(name)) return;
+    auto branch = std::make_unique<BufferedBranch<DataContainerQVector, FlatQVectors>>(
+        source, n_buffers_, FlatQVectors(*source, encoding_));
+    MakeNTupleFields(name, &branch->written);
+    WriteOutputLayout(&ntuple_->layouts, name, *source);
+    if (encoding_.IsCompact()) WriteOutputEncoding(&ntuple_->layouts, name, encoding_.ToString());
+    branches_.push_back(std::move(branch));
+    return;
+  }
+  if (!flat_q_vectors_) {
+    Branch(name, source);
+    return;
+  }
+  if (!tree_ || tree_->GetBranch((name + "_x").data())) return;
+  Flush();
+  auto branch = std::make_unique<BufferedBranch<DataContainerQVector, FlatQVectors>>(
+      source, n_buffers_, FlatQVectors(*source, encoding_));
+  for (auto created : branch->written.Branch(tree_, name, basket_size_)) Configure(created);
+  WriteLayout(name, *source);
+  if (encoding_.IsCompact()) WriteOutputEncoding(tree_->GetUserInfo(), name, encoding_.ToString());
+  branches_.push_back(std::move(branch));
+}
+
+void CorrectionTreeWriter::Fill() {
+  if (!IsConnected()) return;
+  if (ntuple_) ntuple_->filled = true;
+  if (n_buffers_==0) {
+    // only the flat Q-vectors are converted, the other branches refer to the output objects.
+    for (auto &branch : branches_) branch->Copy(0);
+    if (!FillOutput()) throw std::runtime_error("Cannot fill the output tree.");
+    return;
+  }
+  if (!writer_.joinable()) {
+    stop_ = false;
+    writer_ = std::thread(&CorrectionTreeWriter::Write, this);
+  }
+  std::size_t buffer;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this]() { return n_filled_ < n_buffers_ || failed_; });
+    if (failed_) throw std::runtime_error("Cannot fill the output tree.");
+    buffer = (first_buffer_ + n_filled_)%n_buffers_;
+  }
+  // the free buffer is not accessed by the writer thread.
+  for (auto &branch : branches_) branch->Copy(buffer);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++n_filled_;
+  }
+  condition_.notify_all();
+}
+
+void CorrectionTreeWriter::Write() {
+  while (true) {
+    std::size_t buffer;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this]() { return n_filled_ > 0 || stop_; });
+      if (n_filled_==0) return;
+      buffer = first_buffer_;
+    }
+    for (auto &branch : branches_) branch->Restore(buffer);
+    const auto failed = !FillOutput();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      first_buffer_ = (first_buffer_ + 1)%n_buffers_;
+      --n_filled_;
+      failed_ = failed_ || failed;
+    }
+    condition_.notify_all();
+  }
+}
+
+void CorrectionTreeWriter::Flush() {
+  if (!writer_.joinable()) return;
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait(lock, [this]() { return n_filled_==0; });
+}
+
+void CorrectionTreeWriter::Finish() {
+  if (writer_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    condition_.notify_all();
+    writer_.join();
+  }
+  FinishNTuple();
+  if (failed_) {
+    failed_ = false;
+    throw std::runtime_error("Cannot fill the output tree.");
+  }
+}
+
+}
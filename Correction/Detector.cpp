@@ -35,12 +35,17 @@ Detector::Detector(const Detector &other) :
     harmonics_bits_(other.harmonics_bits_),
     q_vector_normalization_method_(other.q_vector_normalization_method_),
     output_tree_q_vectors_(other.output_tree_q_vectors_),
+    gf_max_harmonic_(other.gf_max_harmonic_),
+    gf_max_power_(other.gf_max_power_),
     cuts_(other.cuts_),
     int_cuts_(other.int_cuts_),
     histograms_(other.histograms_),
     axes_(other.axes_),
     correction_on_q_vector(other.correction_on_q_vector),
-    correction_on_input_data(other.correction_on_input_data) {
+    correction_on_input_data(other.correction_on_input_data),
+    channel_groups_(other.channel_groups_),
+    sparse_input_(other.sparse_input_),
+    correction_chain_(other.correction_chain_) {
 }
 
 /**
@@ -52,13 +57,15 @@ Detector::Detector(const Detector &other) :
 void Detector::Initialize(DetectorList &detectors, InputVariableManager &var, CorrectionAxisSet &correction_axis) {
   sub_events_.AddAxes(axes_);
   detectors_ = &detectors;
+  selection_ = nullptr;
+  qa_sampling_ = &detectors.GetQASampling();
   var.InitVariable(phi_);
   var.InitVariable(weight_);
   var.InitVariable(radial_offset_);
   int ibin = 0;
   for (auto &event : sub_events_) {
     if (type_==DetectorType::CHANNEL) {
-      event = std::make_unique<SubEventChannels>(ibin, &correction_axis, nchannels_, harmonics_bits_);
+      event = std::make_unique<SubEventChannels>(ibin, &correction_axis, nchannels_, input_harmonics_);
       if (channel_groups_.empty()) {
         for (int i = 0; i < nchannels_; ++i) {
           channel_groups_.push_back(0);
@@ -66,9 +73,10 @@ void Detector::Initialize(DetectorList &detectors, InputVariableManager &var, Co
       }
       event->SetChannelsScheme(channel_groups_);
     } else if (type_==DetectorType::TRACK) {
-      event = std::make_unique<SubEventTracks>(ibin, &correction_axis, harmonics_bits_);
+      event = std::make_unique<SubEventTracks>(ibin, &correction_axis, input_harmonics_);
     }
     event->SetDetector(this);
+    event->SetQASampling(&detectors.GetQASampling());
     for (int i = 0; i < correction_on_input_data.GetEntriesFast(); ++i) {
       event->AddCorrectionOnInputData(dynamic_cast<CorrectionOnInputData *>(correction_on_input_data.At(i))->MakeCopy());
     }
@@ -77,18 +85,81 @@ void Detector::Initialize(DetectorList &detectors, InputVariableManager &var, Co
     }
     ++ibin;
   }
+  batch_ = SubEvent::Batch();
+  for (auto &event : sub_events_) event->AddToBatch(batch_);
+  if (correction_chain_) {
+    if (!correction_chain_->Matches(batch_.qn_steps)) {
+      throw std::logic_error("The correction chain of " + name_ + " does not match its correction steps.");
+    }
+    batch_.qn_chain = correction_chain_.get();
+  }
+  // the output Q-vectors of the last event are invalidated, because the new sub events start cleared.
+  for (unsigned int ibin = 0; ibin < sub_events_.size(); ++ibin) ResetOutputQVectors(ibin);
+  touched_bins_.clear();
+  ResetTouchedBins();
   if (!sub_events_.IsIntegrated()) {
     for (const auto &axis : sub_events_.GetAxes()) {
       input_variables_.push_back(var.FindVariable(axis.Name()));
     }
     coordinates_.resize(input_variables_.size());
   }
+  bin_offsets_.resize(sub_events_.size() + 1);
   // Initialize the cuts
   cuts_.Initialize(var);
   int_cuts_.Initialize(var);
   histograms_.Initialize(var);
 }
 
+bool Detector::PropagateHarmonics(DetectorList &detectors) {
+  // the correction steps are walked from the last to the first one.
+  std::vector<CorrectionOnQnVector *> steps;
+  for (int i = 0; i < correction_on_q_vector.GetEntriesFast(); ++i) {
+    steps.push_back(dynamic_cast<CorrectionOnQnVector *>(correction_on_q_vector.At(i)));
+  }
+  std::sort(steps.begin(), steps.end(), [](const CorrectionOnQnVector *a, const CorrectionOnQnVector *b) {
+    return *a < *b;
+  });
+  auto harmonics = harmonics_bits_ | referenced_harmonics_;
+  bool changed = false;
+  for (auto step = steps.rbegin(); step!=steps.rend(); ++step) {
+    (*step)->SetHarmonics(harmonics);
+    const auto referenced = (*step)->GetRequiredReferenceHarmonics();
+    for (const auto &name : (*step)->GetReferencedDetectors()) {
+      if (!name.empty() && detectors.FindDetector(name).AddReferencedHarmonics(referenced)) changed = true;
+    }
+    harmonics |= (*step)->GetRequiredInputHarmonics();
+  }
+  input_harmonics_ = harmonics;
+  return changed;
+}
+
+void Detector::WriteConfiguration(std::ostream &stream) const {
+  stream << "detector " << name_ << ' ' << static_cast<int>(type_) << ' ' << nchannels_ << ' ' << phi_.GetName()
+         << ' ' << weight_.GetName() << ' ' << radial_offset_.GetName() << ' ' << harmonics_bits_.to_string() << ' '
+         << static_cast<int>(q_vector_normalization_method_) << '\n';
+  for (const auto &axis : axes_) {
+    stream << "axis " << axis.Name() << std::hexfloat;
+    for (std::size_t i = 0; i <= axis.GetNBins(); ++i) stream << ' ' << axis.GetPtr()[i];
+    stream << std::defaultfloat << '\n';
+  }
+  stream << "channel_groups";
+  for (const auto group : channel_groups_) stream << ' ' << group;
+  stream << "\ncuts\n";
+  cuts_.WriteConfiguration(stream);
+  stream << "integrated_cuts\n";
+  int_cuts_.WriteConfiguration(stream);
+  for (int i = 0; i < correction_on_input_data.GetEntriesFast(); ++i) {
+    stream << "input_correction ";
+    dynamic_cast<const CorrectionBase *>(correction_on_input_data.At(i))->WriteSettings(stream);
+    stream << '\n';
+  }
+  for (int i = 0; i < correction_on_q_vector.GetEntriesFast(); ++i) {
+    stream << "q_vector_correction ";
+    dynamic_cast<const CorrectionBase *>(correction_on_q_vector.At(i))->WriteSettings(stream);
+    stream << '\n';
+  }
+}
+
 TList *Detector::CreateQAHistogramList(bool fill_qa, bool fill_validation) {
   auto list = new TList();
   list->SetName(name_.data());
@@ -122,11 +193,49 @@ TList *Detector::CreateQAHistogramList(bool fill_qa, bool fill_validation) {
 }
 
 void Detector::ProcessCorrections() {
-  for (auto &ev : sub_events_) { ev->ProcessCorrections(); }
-  for (auto &ev : sub_events_) { ev->ProcessDataCollection(); }
-  // passes the corrected Q-vectors to the output container.
+  CorrectionInstrumentation::ScopedTimer timer(instrumentation_, corrections_counter_);
+  if (instrumentation_) {
+    long long n_entries = 0;
+    for (auto ibin : touched_bins_) n_entries += sub_events_[ibin]->GetInputDataBank().Size();
+    instrumentation_->AddEntries(corrections_counter_, n_entries);
+    instrumentation_->AddEntries(sub_events_counter_, touched_bins_.size());
+  }
+  // each correction step is processed for all sub events at once.
+  if (type_==DetectorType::CHANNEL) {
+    SubEventChannels::ProcessCorrections(batch_);
+    SubEventChannels::ProcessDataCollection(batch_);
+  } else {
+    SubEventTracks::ProcessCorrections(batch_);
+    SubEventTracks::ProcessDataCollection(batch_);
+  }
+  FillOutputQVectors();
+}
+
+void Detector::SetInstrumentation(CorrectionInstrumentation *instrumentation) {
+  instrumentation_ = instrumentation;
+  batch_.instrumentation = instrumentation;
+  batch_.input_step_counters.clear();
+  batch_.qn_step_counters.clear();
+  if (!instrumentation) return;
+  corrections_counter_ = instrumentation->AddCounter(name_ + "/corrections");
+  sub_events_counter_ = instrumentation->AddCounter(name_ + "/touched_sub_events");
+  // each step has a counter for the corrections followed by one for the data collection.
+  auto add_steps = [this, instrumentation](const std::vector<std::vector<CorrectionBase *>> &steps,
+                                           std::vector<std::size_t> &counters) {
+    for (const auto &step : steps) {
+      const auto name = name_ + "/" + step.front()->GetName();
+      counters.push_back(instrumentation->AddCounter(name));
+      counters.push_back(instrumentation->AddCounter(name + "/collection"));
+    }
+  };
+  add_steps(batch_.input_steps, batch_.input_step_counters);
+  add_steps(batch_.qn_steps, batch_.qn_step_counters);
+}
+
+void Detector::FillOutputQVectors() {
+  // passes the corrected Q-vectors to the output container. The Q-vectors of the other sub events are invalid.
   for (auto &pair_step_qvector : q_vectors_) {
-    for (unsigned int i = 0; i < sub_events_.size(); ++i) {
+    for (auto i : touched_bins_) {
       try {
         (*pair_step_qvector.second)[i] = *sub_events_[i]->GetQVector(pair_step_qvector.first);
       } catch (std::out_of_range &) {
@@ -137,48 +246,284 @@ void Detector::ProcessCorrections() {
   }
 }
 
-void Detector::AttachToTree(TTree *tree) {
+void Detector::ResetTouchedBins() {
+  for (auto ibin : touched_bins_) batch_.touched[ibin] = 0;
+  touched_bins_.clear();
+  // the sub event of an integrated detector is processed in each event, also if it did not receive data.
+  if (sub_events_.IsIntegrated()) Touch(0);
+}
+
+void Detector::ResetOutputQVectors(unsigned int ibin) {
+  for (auto &pair_step_qvector : q_vectors_) (*pair_step_qvector.second)[ibin].Reset();
+  if (gf_q_vectors_) (*gf_q_vectors_)[ibin].Reset();
+}
+
+std::vector<std::string> Detector::GetReferencedDetectors() const {
+  std::vector<std::string> names;
+  for (int i = 0; i < correction_on_q_vector.GetEntriesFast(); ++i) {
+    auto correction = dynamic_cast<CorrectionOnQnVector *>(correction_on_q_vector.At(i));
+    for (auto &name : correction->GetReferencedDetectors()) {
+      if (!name.empty()) names.push_back(name);
+    }
+  }
+  return names;
+}
+
+void Detector::AttachToTree(CorrectionTreeWriter &tree) {
+  // the output Q-vectors are kept when switching runs, such that only the branches of new steps are added.
   for (const auto &qvec : q_vectors_) {
     auto is_output_variable = std::find(output_tree_q_vectors_.begin(), output_tree_q_vectors_.end(), qvec.first);
     if (is_output_variable!=output_tree_q_vectors_.end()) {
       auto suffix = kCorrectionStepNamesArray[qvec.first];
       auto name = name_ + "_" + suffix;
-      tree->Branch(name.data(), qvec.second.get());
+      tree.BranchQVectors(name, qvec.second.get());
     }
   }
+  if (gf_q_vectors_) {
+    auto name = name_ + "_GF";
+    tree.Branch(name, gf_q_vectors_.get());
+  }
 }
 
 void Detector::IncludeQnVectors() {
   for (auto &ev : sub_events_) { ev->IncludeQnVectors(); }
-  // Adds DataContainerQVector for each of the active correction steps.
-  auto correction_steps = sub_events_[0]->GetCorrectionSteps();
-  for (auto correction_step : correction_steps) {
+  // Adds DataContainerQVector for the active correction steps written to the output tree.
+  // The ones of the other steps are only added when they are requested by a consumer.
+  included_steps_ = sub_events_[0]->GetCorrectionSteps();
+  for (auto correction_step : included_steps_) {
+    if (std::find(output_tree_q_vectors_.begin(), output_tree_q_vectors_.end(), correction_step)
+        !=output_tree_q_vectors_.end()) {
+      RequestQVector(correction_step);
+    }
+  }
+  // Adds the Q-vectors of the generic framework if configured. They are kept for all runs.
+  if (gf_max_power_ > 0 && !gf_q_vectors_) {
     if (sub_events_.IsIntegrated()) {
-      q_vectors_.emplace(correction_step, std::make_unique<DataContainerQVector>());
+      gf_q_vectors_ = std::make_unique<DataContainerQVectorGF>();
     } else {
-      q_vectors_.emplace(correction_step, std::make_unique<DataContainerQVector>(sub_events_.GetAxes()));
+      gf_q_vectors_ = std::make_unique<DataContainerQVectorGF>(sub_events_.GetAxes());
+    }
+    for (auto &q : *gf_q_vectors_) q = QVectorGF(gf_max_harmonic_, gf_max_power_);
+  }
+}
+
+DataContainerQVector *Detector::RequestQVector(QVector::CorrectionStep step) {
+  auto found = q_vectors_.find(step);
+  if (found!=q_vectors_.end()) return found->second.get();
+  auto qvectors = sub_events_.IsIntegrated() ? std::make_unique<DataContainerQVector>()
+                                             : std::make_unique<DataContainerQVector>(sub_events_.GetAxes());
+  // sub events without data keep the cleared Q-vectors in the output.
+  for (unsigned int i = 0; i < sub_events_.size(); ++i) (*qvectors)[i] = *sub_events_[i]->GetQVector(step);
+  return q_vectors_.emplace(step, std::move(qvectors)).first->second.get();
+}
+
+void Detector::ReplayData(const std::uint32_t *&sizes, const CorrectionEventRecorder::DataVector *&data) {
+  for (unsigned int ibin = 0; ibin < sub_events_.size(); ++ibin) {
+    const auto n = *sizes++;
+    if (n > 0) Touch(ibin);
+    for (std::uint32_t i = 0; i < n; ++i, ++data) {
+      sub_events_[ibin]->AddDataVector(data->id, data->phi, data->weight, data->radial_offset);
+      if (gf_q_vectors_) (*gf_q_vectors_)[ibin].Add(data->phi, data->weight);
+    }
+  }
+}
+
+bool Detector::HasSameSelection(const Detector &other) const {
+  if (type_!=other.type_ || sparse_input_ || other.sparse_input_ || phi_.size()!=other.phi_.size()) return false;
+  if (axes_.size()!=other.axes_.size()) return false;
+  for (std::size_t i = 0; i < axes_.size(); ++i) {
+    const auto &axis = axes_[i];
+    const auto &other_axis = other.axes_[i];
+    if (axis.Name()!=other_axis.Name() || !std::equal(axis.begin(), axis.end(), other_axis.begin(), other_axis.end())) {
+      return false;
     }
   }
+  return int_cuts_.IsEquivalent(other.int_cuts_) && cuts_.IsEquivalent(other.cuts_);
 }
 
 void Detector::FillData() {
+  if (selection_) {
+    FillSharedData();
+    return;
+  }
+  passed_int_cuts_ = false;
+  if (sparse_input_ || !int_cuts_.CheckCuts(0)) return;
+  passed_int_cuts_ = true;
+  if (qa_sampling_->IsFilled(CorrectionQASampling::Category::kEvent)) histograms_.Fill();
+  const std::size_t n = phi_.size();
+  /// Integrated case (detector only has one bin)
+  cuts_.CheckCuts(n, passed_cuts_);
+  if (input_variables_.empty()) {
+    for (std::size_t channel = 0; channel < n; ++channel) {
+      if (!passed_cuts_[channel]) continue;
+      sub_events_[0]->AddDataVector(channel, phi_[channel], weight_[channel], radial_offset_[channel]);
+      if (gf_q_vectors_) (*gf_q_vectors_)[0].Add(phi_[channel], weight_[channel]);
+    }
+    return;
+  }
+  /// differential case (detector has more than one bin)
+  /// the sub event bins of all entries are found in one pass over each binning variable.
+  for (std::size_t coordinate = 0; coordinate < input_variables_.size(); ++coordinate) {
+    coordinates_[coordinate] = input_variables_[coordinate].Get();
+  }
+  entry_bins_.resize(n);
+  sub_events_.FindBins(coordinates_.data(), n, entry_bins_.data());
+  for (std::size_t channel = 0; channel < n; ++channel) {
+    if (!passed_cuts_[channel]) entry_bins_[channel] = -1;
+  }
+  AddEntries(phi_.Get(), weight_.Get(), radial_offset_.Get());
+}
+
+/// the entries selected by the shared selection are added with the angles and weights of this detector.
+void Detector::FillSharedData() {
+  const auto &selection = *selection_;
+  if (!selection.passed_int_cuts_) return;
+  if (qa_sampling_->IsFilled(CorrectionQASampling::Category::kEvent)) histograms_.Fill();
+  if (input_variables_.empty()) {
+    for (std::size_t channel = 0; channel < phi_.size(); ++channel) {
+      if (!selection.passed_cuts_[channel]) continue;
+      sub_events_[0]->AddDataVector(channel, phi_[channel], weight_[channel], radial_offset_[channel]);
+      if (gf_q_vectors_) (*gf_q_vectors_)[0].Add(phi_[channel], weight_[channel]);
+    }
+    return;
+  }
+  AddSortedEntries(selection, phi_.Get(), weight_.Get(), radial_offset_.Get());
+}
+
+void Detector::FillTracks(const std::size_t n, const TrackColumns &columns) {
+  if (selection_) {
+    FillSharedTracks(n, columns);
+    return;
+  }
+  track_values_.resize((input_variables_.size() + 3)*n);
+  const auto phi = GetTrackColumn(phi_, columns, n, 0);
+  const auto weight = GetTrackColumn(weight_, columns, n, 1);
+  const auto radial_offset = GetTrackColumn(radial_offset_, columns, n, 2);
+  entry_bins_.resize(n);
+  if (input_variables_.empty()) {
+    std::fill(entry_bins_.begin(), entry_bins_.end(), 0);
+  } else {
+    for (std::size_t coordinate = 0; coordinate < input_variables_.size(); ++coordinate) {
+      coordinates_[coordinate] = GetTrackColumn(input_variables_[coordinate], columns, n, coordinate + 3);
+    }
+    sub_events_.FindBins(coordinates_.data(), n, entry_bins_.data());
+  }
+  /// the cuts and the QA histograms read the values of the current track from the variable container.
+  /// the tracks passing the integrated cuts are flagged for the QA histograms of the detectors sharing the selection.
+  const bool fill_qa = qa_sampling_->IsFilled(CorrectionQASampling::Category::kEvent);
+  passed_cuts_.assign(n, 0);
+  for (std::size_t track = 0; track < n; ++track) {
+    for (const auto &column : columns) *column.first = column.second[track];
+    if (!int_cuts_.CheckCuts(0)) {
+      entry_bins_[track] = -1;
+      continue;
+    }
+    passed_cuts_[track] = 1;
+    if (fill_qa) histograms_.Fill();
+    if (!cuts_.CheckCuts(0)) entry_bins_[track] = -1;
+  }
+  AddEntries(phi, weight, radial_offset);
+}
+
+void Detector::FillSharedTracks(const std::size_t n, const TrackColumns &columns) {
+  const auto &selection = *selection_;
+  track_values_.resize(3*n);
+  const auto phi = GetTrackColumn(phi_, columns, n, 0);
+  const auto weight = GetTrackColumn(weight_, columns, n, 1);
+  const auto radial_offset = GetTrackColumn(radial_offset_, columns, n, 2);
+  if (qa_sampling_->IsFilled(CorrectionQASampling::Category::kEvent)) {
+    for (std::size_t track = 0; track < n; ++track) {
+      if (!selection.passed_cuts_[track]) continue;
+      for (const auto &column : columns) *column.first = column.second[track];
+      histograms_.Fill();
+    }
+  }
+  AddSortedEntries(selection, phi, weight, radial_offset);
+}
+
+const double *Detector::GetTrackColumn(const InputVariable &variable,
+                                       const TrackColumns &columns,
+                                       const std::size_t n,
+                                       const std::size_t slot) {
+  for (const auto &column : columns) {
+    if (column.first==variable.Get()) return column.second;
+  }
+  /// variables without a column keep their value for all tracks of the event.
+  auto values = track_values_.data() + slot*n;
+  std::fill(values, values + n, variable[0]);
+  return values;
+}
+
+void Detector::FillChannels(const std::size_t n, const int *channels, const double *amplitudes) {
+  if (type_!=DetectorType::CHANNEL) throw std::logic_error(name_ + " is not a channel detector.");
   if (!int_cuts_.CheckCuts(0)) return;
-  histograms_.Fill();
-  for (std::size_t channel = 0; channel < phi_.size(); ++channel) {
-    if (!cuts_.CheckCuts(channel)) continue;
-    /// Integrated case (detector only has one bin)
-    if (input_variables_.empty()) {
-      sub_events_.At(0)->AddDataVector(channel, phi_[channel], weight_[channel], radial_offset_[channel]);
-      /// differential case (detector has more than one bin)
-    } else {
-      for (std::size_t coordinate = 0; coordinate < input_variables_.size(); ++coordinate) {
-        coordinates_.at(coordinate) = input_variables_[coordinate][channel];
-      }
-      const auto ibin = sub_events_.FindBin(coordinates_);
-      if (ibin > -1) {
-        sub_events_.At(ibin)->AddDataVector(channel, phi_[channel], weight_[channel], radial_offset_[channel]);
-      }
+  if (qa_sampling_->IsFilled(CorrectionQASampling::Category::kEvent)) histograms_.Fill();
+  /// the cuts read the amplitude of the channel from the weight in the variable container.
+  fired_channels_.clear();
+  for (std::size_t i = 0; i < n; ++i) {
+    const auto channel = channels[i];
+    if (channel < 0 || static_cast<unsigned int>(channel) >= phi_.size()) {
+      throw std::out_of_range("Channel " + std::to_string(channel) + " of " + name_ + " does not exist.");
+    }
+    *weight_.at(channel) = amplitudes[i];
+    if (amplitudes[i] < QVector::kminimumweight || !cuts_.CheckCuts(channel)) continue;
+    fired_channels_.push_back(channel);
+  }
+  if (input_variables_.empty()) {
+    for (auto channel : fired_channels_) {
+      sub_events_[0]->AddDataVector(channel, phi_[channel], weight_[channel], radial_offset_[channel]);
+      if (gf_q_vectors_) (*gf_q_vectors_)[0].Add(phi_[channel], weight_[channel]);
+    }
+    return;
+  }
+  /// the coordinates of the fired channels are gathered to find their sub event bins in one pass.
+  const std::size_t n_fired = fired_channels_.size();
+  track_values_.resize(input_variables_.size()*n_fired);
+  for (std::size_t coordinate = 0; coordinate < input_variables_.size(); ++coordinate) {
+    auto values = track_values_.data() + coordinate*n_fired;
+    for (std::size_t i = 0; i < n_fired; ++i) values[i] = input_variables_[coordinate][fired_channels_[i]];
+    coordinates_[coordinate] = values;
+  }
+  entry_bins_.resize(n_fired);
+  sub_events_.FindBins(coordinates_.data(), n_fired, entry_bins_.data());
+  AddEntries(phi_.Get(), weight_.Get(), radial_offset_.Get(), fired_channels_.data());
+}
+
+/// the entries are the tracks or channels, or the fired channels if their ids are given.
+void Detector::AddEntries(const double *phi, const double *weight, const double *radial_offset,
+                          const std::size_t *channels) {
+  const std::size_t n = entry_bins_.size();
+  /// the selected entries are sorted by sub event with a counting sort, keeping their order within a sub event.
+  std::fill(bin_offsets_.begin(), bin_offsets_.end(), 0);
+  for (std::size_t entry = 0; entry < n; ++entry) {
+    if (entry_bins_[entry] > -1) ++bin_offsets_[entry_bins_[entry] + 1];
+  }
+  for (std::size_t ibin = 1; ibin < bin_offsets_.size(); ++ibin) bin_offsets_[ibin] += bin_offsets_[ibin - 1];
+  sorted_entries_.resize(bin_offsets_.back());
+  for (std::size_t entry = 0; entry < n; ++entry) {
+    if (entry_bins_[entry] > -1) sorted_entries_[bin_offsets_[entry_bins_[entry]]++] = entry;
+  }
+  AddSortedEntries(*this, phi, weight, radial_offset, channels);
+}
+
+/// the offsets of the selection mark the end of the entries of each sub event in its sorted entries.
+void Detector::AddSortedEntries(const Detector &selection, const double *phi, const double *weight,
+                                const double *radial_offset, const std::size_t *channels) {
+  const auto &bin_offsets = selection.bin_offsets_;
+  const auto &sorted_entries = selection.sorted_entries_;
+  std::size_t begin = 0;
+  for (std::size_t ibin = 0; ibin < sub_events_.size(); ++ibin) {
+    const std::size_t end = bin_offsets[ibin];
+    if (begin==end) continue;
+    auto &sub_event = sub_events_[ibin];
+    Touch(ibin);
+    sub_event->ReserveDataVectors(end - begin);
+    for (std::size_t i = begin; i < end; ++i) {
+      const auto entry = channels ? channels[sorted_entries[i]] : sorted_entries[i];
+      sub_event->AddDataVector(entry, phi[entry], weight[entry], radial_offset[entry]);
+      if (gf_q_vectors_) (*gf_q_vectors_)[ibin].Add(phi[entry], weight[entry]);
     }
+    begin = end;
   }
 }
 
@@ -31,6 +31,8 @@
 
 /// \file QnCorrectionsInputGainEqualization.cxx
 /// \brief Implementation of procedures for gain equalization on input data.
+#include <numeric>
+
 #include "CorrectionAxisSet.h"
 #include "CorrectionProfileChannelizedIngress.h"
 #include "CorrectionProfileChannelized.h"
@@ -60,6 +62,56 @@ void GainEqualization::AttachInput(TList *list) {
                                          ownerConfiguration->GetChannelsGroups())) {
     fState = State::APPLYCOLLECT;
     fHardCodedWeights = ownerConfiguration->GetHardCodedGroupWeights();
+    FillParameterTable();
+    FillCoefficients();
+  }
+}
+
+/// Attaches the final equalization parameters read from a calibration file
+///
+/// The parameters are only taken if they match the configured event
+/// classes and channels.
+/// \param parameters the table of the equalization parameters
+void GainEqualization::AttachParameters(CorrectionParameterTable &&parameters) {
+  auto ownerConfiguration = dynamic_cast<SubEventChannels *>(fSubEvent);
+  std::vector<int> channels(ownerConfiguration->GetNoOfChannels());
+  std::iota(channels.begin(), channels.end(), 0);
+  if (parameters.Matches(fSubEvent->GetEventClassVariablesSet().GetNumberOfBins(), channels, 3)) {
+    fParameters = std::move(parameters);
+    fState = State::APPLYCOLLECT;
+    FillCoefficients();
+  }
+}
+
+/// Fills the equalization parameters of each event class and channel
+///
+/// The average and width of the channel multiplicities are taken from the
+/// attached input histograms together with the weight of the channel group.
+void GainEqualization::FillParameterTable() {
+  auto ownerConfiguration = dynamic_cast<SubEventChannels *>(fSubEvent);
+  std::vector<int> channels(ownerConfiguration->GetNoOfChannels());
+  std::iota(channels.begin(), channels.end(), 0);
+  const Long64_t nBins = fSubEvent->GetEventClassVariablesSet().GetNumberOfBins();
+  fParameters.Initialize(nBins, channels, 3);
+  for (Long64_t eventClassBin = 0; eventClassBin < nBins; eventClassBin++) {
+    for (auto channel : channels) {
+      Long64_t bin = fInputHistograms->GetBin(channel, eventClassBin);
+      if (!fInputHistograms->BinContentValidated(bin)) continue;
+      fParameters.SetValidated(eventClassBin, channel, kTRUE);
+      auto parameters = fParameters.EditParameters(eventClassBin, channel);
+      parameters[0] = fInputHistograms->GetBinContent(bin);
+      parameters[1] = fInputHistograms->GetBinError(bin);
+      /* let's handle the potential group weights usage */
+      Float_t groupweight = 1.0;
+      if (fUseChannelGroupsWeights) {
+        groupweight = fInputHistograms->GetGrpBinContent(fInputHistograms->GetGrpBin(channel, eventClassBin));
+      } else {
+        if (fHardCodedWeights) {
+          groupweight = fHardCodedWeights[channel];
+        }
+      }
+      parameters[2] = groupweight;
+    }
   }
 }
 
@@ -70,6 +122,45 @@ void GainEqualization::CreateSupportQVectors() {
 
 }
 
+/// Fills the gain and offset of the equalized weight of each event class and channel
+///
+/// The equalization of a channel reduces to the linear transformation
+/// \f$ \mbox{M}' = g \mbox{M} + o \f$, such that the whole data vector bank is
+/// equalized in one pass without branching on the method. Channels which are
+/// not validated are left untouched, channels with a non significant
+/// average are suppressed.
+void GainEqualization::FillCoefficients() {
+  const Long64_t nBins = fSubEvent->GetEventClassVariablesSet().GetNumberOfBins();
+  fNoOfChannels = dynamic_cast<SubEventChannels *>(fSubEvent)->GetNoOfChannels();
+  fCoefficients.assign(2*nBins*fNoOfChannels, 0.);
+  for (Long64_t bin = 0; bin < nBins; bin++) {
+    for (Int_t channel = 0; channel < fNoOfChannels; channel++) {
+      auto coefficients = fCoefficients.data() + 2*(bin*fNoOfChannels + channel);
+      if (!fParameters.IsValidated(bin, channel)) {
+        coefficients[0] = 1.0;
+        continue;
+      }
+      const auto parameters = fParameters.GetParameters(bin, channel);
+      const Float_t average = parameters[0];
+      const Float_t width = parameters[1];
+      const Float_t groupweight = parameters[2];
+      if (!(fMinimumSignificantValue < average)) continue;
+      switch (fEqualizationMethod) {
+        case Method::NONE:
+          coefficients[0] = 1.0;
+          break;
+        case Method::AVERAGE:
+          coefficients[0] = groupweight/average;
+          break;
+        case Method::WIDTH:
+          coefficients[0] = fScale*groupweight/width;
+          coefficients[1] = (fShift - fScale*average/width)*groupweight;
+          break;
+      }
+    }
+  }
+}
+
 /// Asks for support histograms creation
 ///
 /// Allocates the histogram objects and creates the calibration histograms.
@@ -150,87 +241,39 @@ bool GainEqualization::ProcessCorrections() {
   switch (fState) {
     case State::CALIBRATION:
       /* collect the data needed to further produce equalization parameters */
-      for (const auto &dataVector : fSubEvent->GetInputDataBank()) {
-        fCalibrationHistograms->Fill(dataVector.GetId(), dataVector.EqualizedWeight());
-      }
+      fCalibrationHistograms->Fill(fSubEvent->GetInputDataBank());
       break;
     case State::APPLYCOLLECT:
       /* collect the data needed to further produce equalization parameters */
-      for (const auto &dataVector : fSubEvent->GetInputDataBank()) {
-        fCalibrationHistograms->Fill(dataVector.GetId(), dataVector.EqualizedWeight());
-      }
+      fCalibrationHistograms->Fill(fSubEvent->GetInputDataBank());
       /* and proceed to ... */
       /* FALLTHRU */
     case State::APPLY: /* apply the equalization */
       /* collect QA data if asked */
-      if (fQAMultiplicityBefore) {
-        for (const auto &dataVector : fSubEvent->GetInputDataBank()) {
-          fQAMultiplicityBefore->Fill(dataVector.GetId(), dataVector.EqualizedWeight());
-        }
+      if (fQAMultiplicityBefore && fSubEvent->IsCalibrationQAFilled()) {
+        fQAMultiplicityBefore->Fill(fSubEvent->GetInputDataBank());
       }
       /* store the equalized weights in the data vector bank according to equalization method */
-      switch (fEqualizationMethod) {
-        case Method::NONE:
-          for (auto &dataVector : fSubEvent->GetInputDataBank()) {
-            dataVector.SetEqualizedWeight(dataVector.EqualizedWeight());
-          }
-          break;
-        case Method::AVERAGE:
-          for (auto &dataVector : fSubEvent->GetInputDataBank()) {
-            Long64_t bin = fInputHistograms->GetBin(dataVector.GetId());
-            if (fInputHistograms->BinContentValidated(bin)) {
-              Float_t average = fInputHistograms->GetBinContent(bin);
-              /* let's handle the potential group weights usage */
-              Float_t groupweight = 1.0;
-              if (fUseChannelGroupsWeights) {
-                groupweight = fInputHistograms->GetGrpBinContent(fInputHistograms->GetGrpBin(dataVector.GetId()));
-              } else {
-                if (fHardCodedWeights) {
-                  groupweight = fHardCodedWeights[dataVector.GetId()];
-                }
-              }
-              if (fMinimumSignificantValue < average)
-                dataVector.SetEqualizedWeight((dataVector.EqualizedWeight()/average)*groupweight);
-              else
-                dataVector.SetEqualizedWeight(0.0);
-            } else {
-              if (fQANotValidatedBin) fQANotValidatedBin->Fill(dataVector.GetId(), 1.0);
-            }
-          }
-          break;
-        case Method::WIDTH:
-          for (auto &dataVector : fSubEvent->GetInputDataBank()) {
-            Long64_t bin = fInputHistograms->GetBin(dataVector.GetId());
-            if (fInputHistograms->BinContentValidated(bin)) {
-              Float_t average =
-                  fInputHistograms->GetBinContent(fInputHistograms->GetBin(dataVector.GetId()));
-              Float_t width =
-                  fInputHistograms->GetBinError(fInputHistograms->GetBin(dataVector.GetId()));
-              /* let's handle the potential group weights usage */
-              Float_t groupweight = 1.0;
-              if (fUseChannelGroupsWeights) {
-                groupweight = fInputHistograms->GetGrpBinContent(fInputHistograms->GetGrpBin(dataVector.GetId()));
-              } else {
-                if (fHardCodedWeights) {
-                  groupweight = fHardCodedWeights[dataVector.GetId()];
-                }
-              }
-              if (fMinimumSignificantValue < average)
-                dataVector.SetEqualizedWeight(
-                    (fShift + fScale*(dataVector.EqualizedWeight() - average)/width)*groupweight);
-              else
-                dataVector.SetEqualizedWeight(0.0);
-            } else {
-              if (fQANotValidatedBin) fQANotValidatedBin->Fill(dataVector.GetId(), 1.0);
-            }
+      if (fEqualizationMethod!=Method::NONE) {
+        const Long64_t bin = fSubEvent->GetEventClassVariablesSet().GetBin();
+        auto &bank = fSubEvent->GetInputDataBank();
+        /* the gain and offset of all channels of the event class are contiguous */
+        const Float_t *coefficients = fCoefficients.data() + 2*bin*fNoOfChannels;
+        const int *ids = bank.Ids();
+        float *weights = bank.EqualizedWeights();
+        for (std::size_t i = 0; i < bank.Size(); ++i) {
+          const auto channel = coefficients + 2*ids[i];
+          weights[i] = weights[i]*channel[0] + channel[1];
+        }
+        if (fQANotValidatedBin && fSubEvent->IsValidationQAFilled()) {
+          for (std::size_t i = 0; i < bank.Size(); ++i) {
+            if (!fParameters.IsValidated(bin, ids[i])) fQANotValidatedBin->Fill(ids[i], 1.0);
           }
-          break;
+        }
       }
       /* collect QA data if asked */
-      if (fQAMultiplicityAfter) {
-        for (const auto &dataVector : fSubEvent->GetInputDataBank()) {
-          fQAMultiplicityAfter->Fill(dataVector.GetId(), dataVector.EqualizedWeight());
-        }
+      if (fQAMultiplicityAfter && fSubEvent->IsCalibrationQAFilled()) {
+        fQAMultiplicityAfter->Fill(fSubEvent->GetInputDataBank());
       }
       applied = true;
       break;
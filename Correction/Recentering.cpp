@@ -64,7 +64,7 @@ Recentering::Recentering() :
 /// Creates the recentered Qn vector
 void Recentering::CreateSupportQVectors() {
   fInputQnVector = fSubEvent->GetPreviousCorrectedQnVector(this);
-  fCorrectedQnVector = std::make_unique<QVector>(fSubEvent->GetHarmonics(),
+  fCorrectedQnVector = std::make_unique<QVector>(GetHarmonics(),
                                                  QVector::CorrectionStep::RECENTERED,
                                                  fInputQnVector->GetNorm());
 }
@@ -87,10 +87,10 @@ void Recentering::CreateCorrectionHistograms() {
   fInputHistograms->SetNoOfEntriesThreshold(fMinNoOfEntriesToValidate);
   fCalibrationHistograms = std::make_unique<CorrectionProfileComponents>(hname, fSubEvent->GetEventClassVariablesSet(),
                                                                          CorrectionHistogramBase::ErrorMode::SPREAD);
-  /* get information about the configured harmonics to pass it for histogram creation */
-  Int_t nNoOfHarmonics = fSubEvent->GetNoOfHarmonics();
+  /* get information about the provided harmonics to pass it for histogram creation */
+  Int_t nNoOfHarmonics = fCorrectedQnVector->GetNoOfHarmonics();
   auto harmonicsMap = new Int_t[nNoOfHarmonics];
-  fSubEvent->GetHarmonicMap(harmonicsMap);
+  fCorrectedQnVector->GetHarmonicsMap(harmonicsMap);
   fCalibrationHistograms->CreateComponentsProfileHistograms(&output_histograms, nNoOfHarmonics, harmonicsMap);
   delete[] harmonicsMap;
 }
@@ -101,6 +101,41 @@ void Recentering::CreateCorrectionHistograms() {
 void Recentering::AttachInput(TList *list) {
   if (fInputHistograms->AttachHistograms(list)) {
     fState = State::APPLYCOLLECT;
+    FillParameterTable();
+  }
+}
+
+/// Attaches the final correction parameters read from a calibration file
+///
+/// The parameters are only taken if they match the configured event
+/// classes and harmonics.
+/// \param parameters the table of the correction parameters
+void Recentering::AttachParameters(CorrectionParameterTable &&parameters) {
+  const auto harmonics = GetCorrectedHarmonicMap();
+  if (parameters.Matches(fSubEvent->GetEventClassVariablesSet().GetNumberOfBins(), harmonics, 4)) {
+    fParameters = std::move(parameters);
+    fState = State::APPLYCOLLECT;
+  }
+}
+
+/// Fills the correction parameters of each event class
+///
+/// The means and, if width equalization is applied, the widths of the
+/// Qn components are taken from the attached input histograms.
+void Recentering::FillParameterTable() {
+  const auto harmonics = GetCorrectedHarmonicMap();
+  const Long64_t nBins = fSubEvent->GetEventClassVariablesSet().GetNumberOfBins();
+  fParameters.Initialize(nBins, harmonics, 4);
+  for (Long64_t bin = 0; bin < nBins; bin++) {
+    const Bool_t validated = fInputHistograms->BinContentValidated(bin);
+    for (auto harmonic : harmonics) {
+      fParameters.SetValidated(bin, harmonic, validated);
+      auto parameters = fParameters.EditParameters(bin, harmonic);
+      parameters[0] = fInputHistograms->GetXBinContent(harmonic, bin);
+      parameters[1] = fInputHistograms->GetYBinContent(harmonic, bin);
+      parameters[2] = fApplyWidthEqualization ? fInputHistograms->GetXBinError(harmonic, bin) : 1.0;
+      parameters[3] = fApplyWidthEqualization ? fInputHistograms->GetYBinError(harmonic, bin) : 1.0;
+    }
   }
 }
 
@@ -112,10 +147,10 @@ void Recentering::AttachInput(TList *list) {
 void Recentering::AttachQAHistograms(TList *list) {
   auto hname = std::string(szQAQnAverageHistogramName) + "_" + fSubEvent->GetName();
   fQAQnAverageHistogram = std::make_unique<CorrectionProfileComponents>(hname, fSubEvent->GetEventClassVariablesSet());
-  /* get information about the configured harmonics to pass it for histogram creation */
-  auto nNoOfHarmonics = fSubEvent->GetNoOfHarmonics();
+  /* get information about the provided harmonics to pass it for histogram creation */
+  auto nNoOfHarmonics = fCorrectedQnVector->GetNoOfHarmonics();
   auto harmonicsMap = new Int_t[nNoOfHarmonics];
-  fSubEvent->GetHarmonicMap(harmonicsMap);
+  fCorrectedQnVector->GetHarmonicsMap(harmonicsMap);
   fQAQnAverageHistogram->CreateComponentsProfileHistograms(list, nNoOfHarmonics, harmonicsMap);
   delete[] harmonicsMap;
 }
@@ -141,7 +176,8 @@ bool Recentering::ProcessCorrections() {
   switch (fState) {
     case State::CALIBRATION:
       /* collect the data needed to further produce correction parameters if the current Qn vector is good enough */
-      /* we have not perform any correction yet */
+      /* in the online mode the running averages are applied */
+      if (fOnlineWarmUpEntries > 0) applied = ApplyRunningAverages();
       break;
     case State::APPLYCOLLECT:
       /* collect the data needed to further produce correction parameters if the current Qn vector is good enough */
@@ -150,29 +186,24 @@ bool Recentering::ProcessCorrections() {
       if (fSubEvent->GetCurrentQnVector()->IsGoodQuality()) {
         /* we get the properties of the current Qn vector but its name */
         fCorrectedQnVector->CopyNumberOfContributors(*fSubEvent->GetCurrentQnVector());
-        harmonic = fSubEvent->GetCurrentQnVector()->GetFirstHarmonic();
-        /* let's check the correction histograms */
+        harmonic = fCorrectedQnVector->GetFirstHarmonic();
+        /* let's check the correction parameters */
         Long64_t bin = fInputHistograms->GetBin();
-        if (fInputHistograms->BinContentValidated(bin)) {
+        if (harmonic!=-1 && fParameters.IsValidated(bin, harmonic)) {
           /* correction information validated */
           while (harmonic!=-1) {
-            Float_t widthX = 1.0;
-            Float_t widthY = 1.0;
-            if (fApplyWidthEqualization) {
-              widthX = fInputHistograms->GetXBinError(harmonic, bin);
-              widthY = fInputHistograms->GetYBinError(harmonic, bin);
-            }
-            fCorrectedQnVector->SetX(harmonic, (fSubEvent->GetCurrentQnVector()->x(harmonic)
-                - fInputHistograms->GetXBinContent(harmonic, bin))
-                /widthX);
-            fCorrectedQnVector->SetY(harmonic, (fSubEvent->GetCurrentQnVector()->y(harmonic)
-                - fInputHistograms->GetYBinContent(harmonic, bin))
-                /widthY);
-            harmonic = fSubEvent->GetCurrentQnVector()->GetNextHarmonic(harmonic);
+            const auto parameters = fParameters.GetParameters(bin, harmonic);
+            const Float_t meanX = parameters[0];
+            const Float_t meanY = parameters[1];
+            const Float_t widthX = parameters[2];
+            const Float_t widthY = parameters[3];
+            fCorrectedQnVector->SetX(harmonic, (fSubEvent->GetCurrentQnVector()->x(harmonic) - meanX)/widthX);
+            fCorrectedQnVector->SetY(harmonic, (fSubEvent->GetCurrentQnVector()->y(harmonic) - meanY)/widthY);
+            harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
           }
         } /* correction information not validated, we leave the Q vector untouched */
         else {
-          if (fQANotValidatedBin) fQANotValidatedBin->Fill(1.0);
+          if (fQANotValidatedBin && fSubEvent->IsValidationQAFilled()) fQANotValidatedBin->Fill(1.0);
         }
       } else {
         /* not done! input vector with bad quality */
@@ -189,48 +220,68 @@ bool Recentering::ProcessCorrections() {
   return applied;
 }
 
+/// Applies the running averages of the previous events in the online mode
+///
+/// The averages of the event class of the current event are only applied
+/// once it has collected the warm-up number of entries. The current event
+/// is collected after its correction, such that it does not enter its own
+/// averages.
+/// \return kTRUE if the correction step was applied
+bool Recentering::ApplyRunningAverages() {
+  fOnlineApplied = kFALSE;
+  const auto input = fSubEvent->GetCurrentQnVector();
+  int harmonic = fCorrectedQnVector->GetFirstHarmonic();
+  if (harmonic==-1 || !input->IsGoodQuality()) return false;
+  const Long64_t bin = fCalibrationHistograms->GetBin();
+  Double_t parameters[4];
+  /* all harmonics of an event class are filled together, the first one validates all */
+  if (!fCalibrationHistograms->GetRunningMeans(harmonic, bin, fOnlineWarmUpEntries, parameters)) return false;
+  fCorrectedQnVector->CopyNumberOfContributors(*input);
+  while (harmonic!=-1) {
+    fCalibrationHistograms->GetRunningMeans(harmonic, bin, fOnlineWarmUpEntries, parameters);
+    /* a vanishing spread of the first events is not equalized */
+    const Double_t widthX = fApplyWidthEqualization && parameters[2] > 0. ? parameters[2] : 1.0;
+    const Double_t widthY = fApplyWidthEqualization && parameters[3] > 0. ? parameters[3] : 1.0;
+    fCorrectedQnVector->SetX(harmonic, (input->x(harmonic) - parameters[0])/widthX);
+    fCorrectedQnVector->SetY(harmonic, (input->y(harmonic) - parameters[1])/widthY);
+    harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
+  }
+  fSubEvent->UpdateCurrentQnVector(*fCorrectedQnVector);
+  fOnlineApplied = kTRUE;
+  return true;
+}
+
 /// Processes the correction step data collection
 ///
 /// Pure virtual function
 /// \return kTRUE if the correction step was applied
 bool Recentering::ProcessDataCollection() {
-  int harmonic;
   bool applied = false;
   switch (fState) {
     case State::CALIBRATION:
       /* collect the data needed to further produce correction parameters if the current Qn vector is good enough */
-      if (fInputQnVector->IsGoodQuality()) {
-
-        harmonic = fInputQnVector->GetFirstHarmonic();
-        while (harmonic!=-1) {
-          fCalibrationHistograms->FillX(harmonic, fInputQnVector->x(harmonic));
-          fCalibrationHistograms->FillY(harmonic, fInputQnVector->y(harmonic));
-          harmonic = fInputQnVector->GetNextHarmonic(harmonic);
+      if (fInputQnVector->IsGoodQuality() && CollectData()) {
+        fCalibrationHistograms->Fill(*fInputQnVector);
+      }
+      /* we have not perform any correction yet, unless the online averages were applied */
+      if (fOnlineApplied) {
+        if (fQAQnAverageHistogram && fSubEvent->IsCalibrationQAFilled()) {
+          fQAQnAverageHistogram->Fill(*fCorrectedQnVector);
         }
+        applied = true;
       }
-      /* we have not perform any correction yet */
       break;
     case State::APPLYCOLLECT:
       /* collect the data needed to further produce correction parameters if the current Qn vector is good enough */
-      if (fInputQnVector->IsGoodQuality()) {
-        harmonic = fInputQnVector->GetFirstHarmonic();
-        while (harmonic!=-1) {
-          fCalibrationHistograms->FillX(harmonic, fInputQnVector->x(harmonic));
-          fCalibrationHistograms->FillY(harmonic, fInputQnVector->y(harmonic));
-          harmonic = fInputQnVector->GetNextHarmonic(harmonic);
-        }
+      if (fInputQnVector->IsGoodQuality() && CollectData()) {
+        fCalibrationHistograms->Fill(*fInputQnVector);
       }
       /* and proceed to ... */
       /* FALLTHRU */
     case State::APPLY: /* apply the correction if the current Qn vector is good enough */
       /* provide QA info if required */
-      if (fQAQnAverageHistogram) {
-        harmonic = fCorrectedQnVector->GetFirstHarmonic();
-        while (harmonic!=-1) {
-          fQAQnAverageHistogram->FillX(harmonic, fCorrectedQnVector->x(harmonic));
-          fQAQnAverageHistogram->FillY(harmonic, fCorrectedQnVector->y(harmonic));
-          harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-        }
+      if (fQAQnAverageHistogram && fSubEvent->IsCalibrationQAFilled()) {
+        fQAQnAverageHistogram->Fill(*fCorrectedQnVector);
       }
       applied = true;
       break;
@@ -241,9 +292,25 @@ bool Recentering::ProcessDataCollection() {
   return applied;
 }
 
+/// Gets the averages of the collected Qn vector components as estimate of the correction parameters
+/// \param parameters the averages of the components
+/// \param scales their widths
+/// \return false if the collected data do not validate all event classes yet
+bool Recentering::GetConvergenceParameters(std::vector<double> &parameters, std::vector<double> &scales) const {
+  return fCalibrationHistograms && fCalibrationHistograms->GetMeans(parameters, scales);
+}
+
 /// Clean the correction to accept a new event
 void Recentering::ClearCorrectionStep() {
   fCorrectedQnVector->Reset();
+  fOnlineApplied = kFALSE;
+}
+
+/// Copies the filled profiles into their histograms
+void Recentering::UpdateHistograms() {
+  if (fCalibrationHistograms) fCalibrationHistograms->UpdateHistograms();
+  if (fQAQnAverageHistogram) fQAQnAverageHistogram->UpdateHistograms();
+  if (fQANotValidatedBin) fQANotValidatedBin->UpdateHistograms();
 }
 
 }
\ No newline at end of file
@@ -105,17 +105,26 @@ std::string SubEvent::GetName() const {
 void SubEvent::BuildQnVector() {
   fPlainQnVector.SetNormalization(QVector::Normalization::NONE);
   fPlainQ2nVector.SetNormalization(QVector::Normalization::NONE);
-  for (const auto &dataVector : fDataVectorBank) {
-    fPlainQnVector.Add(dataVector.Phi(), dataVector.RadialOffset(), dataVector.EqualizedWeight());
-    fPlainQ2nVector.Add(dataVector.Phi(), dataVector.RadialOffset(), dataVector.EqualizedWeight());
-  }
+  FillPlainQnVectors();
   /* check the quality of the Qn vector */
   fPlainQnVector.CheckQuality();
-  fPlainQ2nVector.CheckQuality();
-  fPlainQnVector = fPlainQnVector.Normal(fDetector->GetNormalizationMethod());
-  fPlainQ2nVector = fPlainQ2nVector.Normal(fDetector->GetNormalizationMethod());
+  fPlainQnVector.Normalize(fDetector->GetNormalizationMethod());
   fCorrectedQnVector = fPlainQnVector;
-  fCorrectedQ2nVector = fPlainQ2nVector;
+  if (fQ2nVectorRequired) {
+    fPlainQ2nVector.CheckQuality();
+    fPlainQ2nVector.Normalize(fDetector->GetNormalizationMethod());
+    fCorrectedQ2nVector = fPlainQ2nVector;
+  }
+}
+
+/// Fills the plain Qn vectors from the data vector bank
+///
+/// The fields of the data vectors are stored as separate arrays,
+/// such that they are added in a single batched sweep.
+void SubEvent::FillPlainQnVectors() {
+  /* the Q2n vector is filled in the same sweep only if a correction step requires it */
+  fPlainQnVector.AddBatch(fDataVectorBank.Phi(), fDataVectorBank.RadialOffsets(), fDataVectorBank.EqualizedWeights(),
+                          fDataVectorBank.Size(), fQ2nVectorRequired ? &fPlainQ2nVector : nullptr);
 }
 
 }
@@ -34,6 +34,10 @@
 /// \file QnCorrectionsDetectorConfigurationChannels.cxx
 /// \brief Implementation of the channel detector configuration class 
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include "CorrectionProfileComponents.h"
 #include "SubEventChannels.h"
 
@@ -98,11 +102,12 @@ void SubEventChannels::SetChannelsScheme(std::vector<int> channel_groups) {
 
 /// Asks for support data structures creation
 ///
-/// The input data vector bank is allocated and the request is
+/// The input data vector bank is allocated for all channels, such that
+/// it is not reallocated during the event loop, and the request is
 /// transmitted to the input data corrections and then to the Q vector corrections.
 void SubEventChannels::CreateSupportQVectors() {
   /* this is executed in the remote node so, allocate the data bank */
-  fDataVectorBank.reserve(Qn::SubEvent::INITIALSIZE);
+  fDataVectorBank.Reserve(std::max<std::size_t>(Qn::SubEvent::INITIALSIZE, fNoOfChannels));
   for (auto &correction : fInputDataCorrections) {
     correction->CreateSupportQVectors();
   }
@@ -303,6 +308,27 @@ void SubEventChannels::AttachCorrectionInput(TList *list) {
   }
 }
 
+/// Asks for attaching the final correction parameters of a calibration file
+///
+/// The parameters are attached in the same sequence as the input
+/// histograms: first to the input data corrections and, once they are
+/// being applied, to the Q vector corrections.
+/// \param file the calibration file
+/// \param run the name of the current run
+void SubEventChannels::AttachCorrectionInput(const CorrectionCalibrationFile &file, const std::string &run) {
+  const auto name = GetName();
+  if (file.HasSubEvent(run, name)) {
+    if (!fInputDataCorrections.Empty()) {
+      fInputDataCorrections.EnableFirstCorrection();
+      fInputDataCorrections.AttachInputs(file, run, name);
+    }
+    if (fInputDataCorrections.Empty() || fInputDataCorrections.IsLastStepApplied()) {
+      fQnVectorCorrections.EnableFirstCorrection();
+      fQnVectorCorrections.AttachInputs(file, run, name);
+    }
+  }
+}
+
 /// Perform after calibration histograms attach actions
 /// It is used to inform the different correction step that
 /// all conditions for running the network are in place so
@@ -330,23 +356,22 @@ void SubEventChannels::AddCorrectionOnInputData(CorrectionOnInputData *correctio
 /// and the plain Qn vector average components histogram
 /// \param variableContainer pointer to the variable content bank
 void SubEventChannels::FillQAHistograms() {
+  if (!IsCalibrationQAFilled()) return;
   if (fQAMultiplicityBefore3D && fQAMultiplicityAfter3D) {
-    for (const auto &dataVector : fDataVectorBank) {
+    const auto ids = fDataVectorBank.Ids();
+    const auto weights = fDataVectorBank.Weights();
+    const auto equalizedWeights = fDataVectorBank.EqualizedWeights();
+    for (std::size_t i = 0; i < fDataVectorBank.Size(); ++i) {
       fQAMultiplicityBefore3D->Fill(fEventClassVariables->At(fQACentralityVarId).GetValue(),
-                                    fChannelMap[dataVector.GetId()],
-                                    dataVector.Weight());
+                                    fChannelMap[ids[i]],
+                                    weights[i]);
       fQAMultiplicityAfter3D->Fill(fEventClassVariables->At(fQACentralityVarId).GetValue(),
-                                   fChannelMap[dataVector.GetId()],
-                                   dataVector.EqualizedWeight());
+                                   fChannelMap[ids[i]],
+                                   equalizedWeights[i]);
     }
   }
   if (fQAQnAverageHistogram) {
-    Int_t harmonic = fPlainQnVector.GetFirstHarmonic();
-    while (harmonic!=-1) {
-      fQAQnAverageHistogram->FillX(harmonic, fPlainQnVector.x(harmonic));
-      fQAQnAverageHistogram->FillY(harmonic, fPlainQnVector.y(harmonic));
-      harmonic = fPlainQnVector.GetNextHarmonic(harmonic);
-    }
+    fQAQnAverageHistogram->Fill(fPlainQnVector);
   }
 }
 
@@ -397,13 +422,106 @@ void SubEventChannels::FillOverallQnVectorCorrectionStepList(std::set<Correction
 /// the one to be used for subsequent Q vector corrections.
 void SubEventChannels::BuildRawQnVector() {
   fRawQnVector.SetNormalization(QVector::Normalization::NONE);
-  for (const auto &dataVector : fDataVectorBank) {
-    fRawQnVector.Add(dataVector.Phi(), dataVector.RadialOffset(), dataVector.Weight());
+  UpdateHarmonicTable();
+  if (fRawQnVector.GetHarmonics()==fPlainQnVector.GetHarmonics()
+      && fRawQnVector.GetHarmonicMultiplier()==fPlainQnVector.GetHarmonicMultiplier()) {
+    AddFromHarmonicTable(fRawQnVector, nullptr, kFALSE);
+  } else {
+    fRawQnVector.AddBatch(fDataVectorBank.Phi(), fDataVectorBank.RadialOffsets(), fDataVectorBank.Weights(),
+                          fDataVectorBank.Size(), nullptr);
   }
   fRawQnVector.CheckQuality();
   fRawQnVector.Normal(fDetector->GetNormalizationMethod());
 }
 
+/// Fills the plain Qn vectors from the data vector bank
+///
+/// The azimuth of a channel is given by the detector geometry, such that
+/// the harmonics of each channel are taken from a table and the Qn vectors
+/// are built as weighted sums of the columns of the table.
+void SubEventChannels::FillPlainQnVectors() {
+  UpdateHarmonicTable();
+  AddFromHarmonicTable(fPlainQnVector, fQ2nVectorRequired ? &fPlainQ2nVector : nullptr, kTRUE);
+}
+
+/// Updates the table of the harmonics of the channels
+///
+/// The table holds one column per harmonic component of the plain Qn vector
+/// followed by the ones of the Q2n vector if it is required, each column
+/// with one entry per channel. The table is reset if the harmonics change, and
+/// the entries of a channel are recomputed whenever its azimuth differs from
+/// the one the entries were computed for.
+void SubEventChannels::UpdateHarmonicTable() {
+  const unsigned long layout = fPlainQnVector.GetHarmonics().to_ulong()
+      | (fQ2nVectorRequired ? 1UL << QVector::kmaxharmonics : 0UL)
+      | (static_cast<unsigned long>(fPlainQnVector.GetHarmonicMultiplier()) << (QVector::kmaxharmonics + 1));
+  const std::size_t nColumns = 2*fPlainQnVector.GetNoOfHarmonics()
+      + (fQ2nVectorRequired ? 2*fPlainQ2nVector.GetNoOfHarmonics() : 0);
+  if (layout!=fHarmonicTableLayout) {
+    fHarmonicTableLayout = layout;
+    fHarmonicTable.assign(nColumns*fNoOfChannels, 0.);
+    fHarmonicTablePhi.assign(fNoOfChannels, std::numeric_limits<Float_t>::quiet_NaN());
+    fHarmonicTableSums.assign(nColumns, 0.);
+  }
+  const auto ids = fDataVectorBank.Ids();
+  const auto phis = fDataVectorBank.Phi();
+  for (std::size_t i = 0; i < fDataVectorBank.Size(); ++i) {
+    const Int_t channel = ids[i];
+    const Float_t phi = phis[i];
+    if (fHarmonicTablePhi[channel]==phi) continue;
+    fHarmonicTablePhi[channel] = phi;
+    std::size_t column = 0;
+    auto fill = [&](const QVector &qvector) {
+      for (auto h = qvector.GetFirstHarmonic(); h!=-1; h = qvector.GetNextHarmonic(h)) {
+        double cos;
+        double sin;
+        SinCos(qvector.GetHarmonicMultiplier()*h*static_cast<double>(phi), sin, cos);
+        fHarmonicTable[column++*fNoOfChannels + channel] = cos;
+        fHarmonicTable[column++*fNoOfChannels + channel] = sin;
+      }
+    };
+    fill(fPlainQnVector);
+    if (fQ2nVectorRequired) fill(fPlainQ2nVector);
+  }
+}
+
+/// Adds the data vector bank to the Qn vectors using the table of harmonics
+///
+/// The weights are scattered into a per channel array, such that each
+/// component is the dot product of the weights with a column of the table.
+/// Data vectors with a weight below the minimum weight are skipped.
+/// \param qvector the Qn vector with the harmonics of the plain Qn vector
+/// \param doubled the Q2n vector, filled in the same sweep if not nullptr
+/// \param equalized use the equalized weights instead of the raw weights
+void SubEventChannels::AddFromHarmonicTable(QVector &qvector, QVector *doubled, Bool_t equalized) {
+  fHarmonicTableWeights.assign(fNoOfChannels, 0.);
+  double sumWeights = 0.;
+  int n = 0;
+  const auto ids = fDataVectorBank.Ids();
+  const auto offsets = fDataVectorBank.RadialOffsets();
+  const auto inputWeights = equalized ? fDataVectorBank.EqualizedWeights() : fDataVectorBank.Weights();
+  for (std::size_t i = 0; i < fDataVectorBank.Size(); ++i) {
+    const Float_t weight = inputWeights[i];
+    if (weight < QVector::kminimumweight) continue;
+    fHarmonicTableWeights[ids[i]] += weight*offsets[i];
+    sumWeights += weight;
+    ++n;
+  }
+  const std::size_t nPlain = 2*qvector.GetNoOfHarmonics();
+  const std::size_t nColumns = nPlain + (doubled ? 2*doubled->GetNoOfHarmonics() : 0);
+  const Double_t *weights = fHarmonicTableWeights.data();
+  for (std::size_t column = 0; column < nColumns; ++column) {
+    const Double_t *harmonics = fHarmonicTable.data() + column*fNoOfChannels;
+    double sum = 0.;
+    for (Int_t channel = 0; channel < fNoOfChannels; ++channel) {
+      sum += weights[channel]*harmonics[channel];
+    }
+    fHarmonicTableSums[column] = sum;
+  }
+  qvector.AddSums(fHarmonicTableSums.data(), sumWeights, n);
+  if (doubled) doubled->AddSums(fHarmonicTableSums.data() + nPlain, sumWeights, n);
+}
+
 /// Ask for processing corrections for the involved detector configuration
 ///
 /// The request is transmitted to the incoming data correction steps
@@ -462,6 +580,36 @@ Bool_t SubEventChannels::ProcessDataCollection() {
   return kTRUE;
 }
 
+/// Processes the corrections of all sub events of a detector
+///
+/// Same as ProcessCorrections for each sub event, but each correction step
+/// is processed for all sub events before the next one. Only the sub events
+/// which received data in the current event are processed.
+/// \param batch the sub events of the detector
+void SubEventChannels::ProcessCorrections(Batch &batch) {
+  for (std::size_t i = 0; i < batch.events.size(); ++i) {
+    if (batch.touched[i]) static_cast<SubEventChannels *>(batch.events[i])->BuildRawQnVector();
+  }
+  std::copy(batch.touched.begin(), batch.touched.end(), batch.active.begin());
+  ProcessBatchCorrections(batch.input_steps, batch.active, batch.instrumentation, batch.input_step_counters);
+  /* the Q vectors are built for the sub events whose input corrections were applied */
+  for (std::size_t i = 0; i < batch.events.size(); ++i) {
+    if (batch.active[i]) static_cast<SubEventChannels *>(batch.events[i])->BuildQnVector();
+  }
+  ProcessBatchQnCorrections(batch);
+}
+
+/// Processes the corrections data collection of all sub events of a detector
+/// \param batch the sub events of the detector
+void SubEventChannels::ProcessDataCollection(Batch &batch) {
+  std::copy(batch.touched.begin(), batch.touched.end(), batch.active.begin());
+  ProcessBatchDataCollection(batch.input_steps, batch.active, batch.instrumentation, batch.input_step_counters);
+  for (std::size_t i = 0; i < batch.events.size(); ++i) {
+    if (batch.active[i]) static_cast<SubEventChannels *>(batch.events[i])->FillQAHistograms();
+  }
+  ProcessBatchQnDataCollection(batch);
+}
+
 /// Clean the configuration to accept a new event
 ///
 /// Transfers the order to the Q vector correction steps then
@@ -483,7 +631,7 @@ void SubEventChannels::Clear() {
   fCorrectedQnVector.Reset();
   fCorrectedQ2nVector.Reset();
   /* and now clear the the input data bank */
-  fDataVectorBank.clear();
+  fDataVectorBank.Clear();
 }
 
 }
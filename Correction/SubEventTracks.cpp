@@ -62,7 +62,7 @@ SubEventTracks::SubEventTracks(unsigned int bin_id,
 void SubEventTracks::CreateSupportQVectors() {
 
   /* this is executed in the remote node so, allocate the data bank */
-  fDataVectorBank.reserve(Qn::SubEvent::INITIALSIZE);
+  fDataVectorBank.Reserve(Qn::SubEvent::INITIALSIZE);
   for (auto &correction : fQnVectorCorrections) {
     correction->CreateSupportQVectors();
   }
@@ -168,6 +168,19 @@ void SubEventTracks::AttachCorrectionInput(TList *list) {
   }
 }
 
+/// Asks for attaching the final correction parameters of a calibration file
+///
+/// The request is transmitted to the Q vector corrections
+/// \param file the calibration file
+/// \param run the name of the current run
+void SubEventTracks::AttachCorrectionInput(const CorrectionCalibrationFile &file, const std::string &run) {
+  const auto name = GetName();
+  if (file.HasSubEvent(run, name)) {
+    fQnVectorCorrections.EnableFirstCorrection();
+    fQnVectorCorrections.AttachInputs(file, run, name);
+  }
+}
+
 /// Perform after calibration histograms attach actions
 /// It is used to inform the different correction step that
 /// all conditions for running the network are in place so
@@ -184,13 +197,8 @@ void SubEventTracks::AfterInputAttachAction() {
 /// Fills the QA plain Qn vector average components histogram
 /// \param variableContainer pointer to the variable content bank
 void SubEventTracks::FillQAHistograms() {
-  if (fQAQnAverageHistogram) {
-    Int_t harmonic = fPlainQnVector.GetFirstHarmonic();
-    while (harmonic!=-1) {
-      fQAQnAverageHistogram->FillX(harmonic, fPlainQnVector.x(harmonic));
-      fQAQnAverageHistogram->FillY(harmonic, fPlainQnVector.y(harmonic));
-      harmonic = fPlainQnVector.GetNextHarmonic(harmonic);
-    }
+  if (fQAQnAverageHistogram && IsCalibrationQAFilled()) {
+    fQAQnAverageHistogram->Fill(fPlainQnVector);
   }
 }
 
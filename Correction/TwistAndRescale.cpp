@@ -87,7 +87,7 @@ void TwistAndRescale::SetReferenceConfigurationsForTwistAndRescale(const char *n
 void TwistAndRescale::CreateSupportQVectors() {
   /* get the input vectors we need */
   fInputQnVector = fSubEvent->GetPreviousCorrectedQnVector(this);
-  auto harmonics = fSubEvent->GetHarmonics();
+  auto harmonics = GetHarmonics();
   /* now create the corrected Qn vectors */
   fCorrectedQnVector = std::make_unique<QVector>(harmonics, QVector::CorrectionStep::TWIST, fInputQnVector->GetNorm());
   fTwistCorrectedQnVector =
@@ -96,7 +96,9 @@ void TwistAndRescale::CreateSupportQVectors() {
       std::make_unique<QVector>(harmonics, QVector::CorrectionStep::RESCALED, fInputQnVector->GetNorm());
   /* now, definitely, we should have the reference detector configurations */
   switch (fTwistAndRescaleMethod) {
-    case Method::DOUBLE_HARMONIC: break;
+    case Method::DOUBLE_HARMONIC:
+      fSubEvent->RequireQ2nVector();
+      break;
     case Method::CORRELATIONS:
       if (!fBDetectorConfigurationName.empty()) {
         fSubEventB =
@@ -188,16 +190,88 @@ void TwistAndRescale::AttachInput(TList *list) {
       /* TODO: basically we are re producing half of the information already produce for recentering correction. Re use it! */
       if (fDoubleHarmonicInputHistograms->AttachHistograms(list)) {
         fState = State::APPLYCOLLECT;
+        FillParameterTable();
       }
       break;
     case Method::CORRELATIONS:
       if (fCorrelationsInputHistograms->AttachHistograms(list)) {
         fState = State::APPLYCOLLECT;
+        FillParameterTable();
       }
       break;
   }
 }
 
+/// Attaches the final correction parameters read from a calibration file
+///
+/// The parameters are only taken if they match the configured event
+/// classes and harmonics.
+/// \param parameters the table of the correction parameters
+void TwistAndRescale::AttachParameters(CorrectionParameterTable &&parameters) {
+  const auto harmonics = GetCorrectedHarmonicMap();
+  if (parameters.Matches(fSubEvent->GetEventClassVariablesSet().GetNumberOfBins(), harmonics, 5)) {
+    fParameters = std::move(parameters);
+    fState = State::APPLYCOLLECT;
+  }
+}
+
+/// Fills the correction parameters of each event class
+///
+/// The twist and rescale parameters are extracted from the attached input
+/// histograms of the chosen method. For each harmonic it is stored whether
+/// the parameters are within the meaningful threshold, the twist parameters
+/// \f$ \Lambda^{+} \f$ and \f$ \Lambda^{-} \f$ and the rescale parameters
+/// \f$ A^{+} \f$ and \f$ A^{-} \f$.
+void TwistAndRescale::FillParameterTable() {
+  const auto harmonics = GetCorrectedHarmonicMap();
+  const Long64_t nBins = fSubEvent->GetEventClassVariablesSet().GetNumberOfBins();
+  fParameters.Initialize(nBins, harmonics, 5);
+  for (Long64_t bin = 0; bin < nBins; bin++) {
+    for (auto harmonic : harmonics) {
+      Double_t Aplus = 0.0;
+      Double_t Aminus = 0.0;
+      Double_t LambdaPlus = 0.0;
+      Double_t LambdaMinus = 0.0;
+      switch (fTwistAndRescaleMethod) {
+        case Method::DOUBLE_HARMONIC: {
+          if (!fDoubleHarmonicInputHistograms->BinContentValidated(bin)) continue;
+          /* remember we store the profile information on a twice the harmonic number base */
+          Double_t X2n = fDoubleHarmonicInputHistograms->GetXBinContent(harmonic*2, bin);
+          Double_t Y2n = fDoubleHarmonicInputHistograms->GetYBinContent(harmonic*2, bin);
+          Aplus = 1 + X2n;
+          Aminus = 1 - X2n;
+          LambdaPlus = Y2n/Aplus;
+          LambdaMinus = Y2n/Aminus;
+        }
+          break;
+        case Method::CORRELATIONS: {
+          if (!fCorrelationsInputHistograms->BinContentValidated(bin)) continue;
+          Double_t XAXC = fCorrelationsInputHistograms->GetXXBinContent("AC", harmonic, bin);
+          Double_t YAYB = fCorrelationsInputHistograms->GetYYBinContent("AB", harmonic, bin);
+          Double_t XAXB = fCorrelationsInputHistograms->GetXXBinContent("AB", harmonic, bin);
+          Double_t XBXC = fCorrelationsInputHistograms->GetXXBinContent("BC", harmonic, bin);
+          Double_t XAYB = fCorrelationsInputHistograms->GetXYBinContent("AB", harmonic, bin);
+          Double_t XBYC = fCorrelationsInputHistograms->GetXYBinContent("BC", harmonic, bin);
+          Aplus = TMath::Sqrt(TMath::Abs(2.0*XAXC))*XAXB/TMath::Sqrt(TMath::Abs(XAXB*XBXC + XAYB*XBYC));
+          Aminus = TMath::Sqrt(TMath::Abs(2.0*XAXC))*YAYB/TMath::Sqrt(TMath::Abs(XAXB*XBXC + XAYB*XBYC));
+          LambdaPlus = XAYB/XAXB;
+          LambdaMinus = XAYB/YAYB;
+        }
+          break;
+      }
+      fParameters.SetValidated(bin, harmonic, kTRUE);
+      auto parameters = fParameters.EditParameters(bin, harmonic);
+      const Bool_t meaningful = !(TMath::Abs(Aplus) > fMaxThreshold) && !(TMath::Abs(Aminus) > fMaxThreshold)
+          && !(TMath::Abs(LambdaPlus) > fMaxThreshold) && !(TMath::Abs(LambdaMinus) > fMaxThreshold);
+      parameters[0] = meaningful ? 1.0 : 0.0;
+      parameters[1] = LambdaPlus;
+      parameters[2] = LambdaMinus;
+      parameters[3] = Aplus;
+      parameters[4] = Aminus;
+    }
+  }
+}
+
 /// Perform after calibration histograms attach actions
 /// It is used to inform the different correction step that
 /// all conditions for running the network are in place so
@@ -239,10 +313,10 @@ void TwistAndRescale::AttachQAHistograms(TList *list) {
         std::make_unique<CorrectionProfileComponents>(name, fSubEvent->GetEventClassVariablesSet());
   }
   if (fApplyTwist || fApplyRescale) {
-    /* get information about the configured harmonics to pass it for histogram creation */
-    Int_t nNoOfHarmonics = fSubEvent->GetNoOfHarmonics();
+    /* get information about the provided harmonics to pass it for histogram creation */
+    Int_t nNoOfHarmonics = fCorrectedQnVector->GetNoOfHarmonics();
     auto harmonicsMap = new Int_t[nNoOfHarmonics];
-    fSubEvent->GetHarmonicMap(harmonicsMap);
+    fCorrectedQnVector->GetHarmonicsMap(harmonicsMap);
     if (fApplyTwist)
       fQATwistQnAverageHistogram->CreateComponentsProfileHistograms(list, nNoOfHarmonics, harmonicsMap);
     if (fApplyRescale)
@@ -291,159 +365,64 @@ bool TwistAndRescale::ProcessCorrections() {
       /* FALLTHRU */
     case State::APPLY: { /* apply the correction if the current Qn vector is good enough */
       /* logging */
-      switch (fTwistAndRescaleMethod) {
-        case Method::DOUBLE_HARMONIC: {
-          /* TODO: basically we are re producing half of the information already produce for recentering correction. Re use it! */
-          if (fSubEvent->GetCurrentQnVector()->IsGoodQuality()) {
-            fCorrectedQnVector->CopyNumberOfContributors(*fSubEvent->GetCurrentQnVector());
-            fTwistCorrectedQnVector->CopyNumberOfContributors(*fCorrectedQnVector);
-            fRescaleCorrectedQnVector->CopyNumberOfContributors(*fCorrectedQnVector);
-            /* let's check the correction histograms */
-            Long64_t bin = fDoubleHarmonicInputHistograms->GetBin();
-            if (fDoubleHarmonicInputHistograms->BinContentValidated(bin)) {
-              /* remember we store the profile information on a twice the harmonic number base */
-              harmonic = fCorrectedQnVector->GetFirstHarmonic();
-              while (harmonic!=-1) {
-                Double_t X2n = fDoubleHarmonicInputHistograms->GetXBinContent(harmonic*2, bin);
-                Double_t Y2n = fDoubleHarmonicInputHistograms->GetYBinContent(harmonic*2, bin);
-
-                Double_t Aplus = 1 + X2n;
-                Double_t Aminus = 1 - X2n;
-                Double_t LambdaPlus = Y2n/Aplus;
-                Double_t LambdaMinus = Y2n/Aminus;
-
-                if (TMath::Abs(Aplus) > fMaxThreshold) {
-                  harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-                  continue;
-                }
-                if (TMath::Abs(Aminus) > fMaxThreshold) {
-                  harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-                  continue;
-                }
-                if (TMath::Abs(LambdaPlus) > fMaxThreshold) {
-                  harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-                  continue;
-                }
-                if (TMath::Abs(LambdaMinus) > fMaxThreshold) {
-                  harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-                  continue;
-                }
-                Double_t Qx = fSubEvent->GetCurrentQnVector()->x(harmonic);
-                Double_t Qy = fSubEvent->GetCurrentQnVector()->y(harmonic);
-                Double_t newQx = (Qx - LambdaMinus*Qy)/(1 - LambdaMinus*LambdaPlus);
-                Double_t newQy = (Qy - LambdaPlus*Qx)/(1 - LambdaMinus*LambdaPlus);
-                if (fApplyTwist) {
-                  fCorrectedQnVector->SetX(harmonic, newQx);
-                  fCorrectedQnVector->SetY(harmonic, newQy);
-                  fTwistCorrectedQnVector->SetX(harmonic, newQx);
-                  fTwistCorrectedQnVector->SetY(harmonic, newQy);
-                  fRescaleCorrectedQnVector->SetX(harmonic, newQx);
-                  fRescaleCorrectedQnVector->SetY(harmonic, newQy);
-                }
-                newQx = newQx/Aplus;
-                newQy = newQy/Aminus;
-                if (Aplus==0.0) {
-                  harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-                  continue;
-                }
-                if (Aminus==0.0) {
-                  harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-                  continue;
-                }
-                if (fApplyRescale) {
-                  fCorrectedQnVector->SetX(harmonic, newQx);
-                  fCorrectedQnVector->SetY(harmonic, newQy);
-                  fRescaleCorrectedQnVector->SetX(harmonic, newQx);
-                  fRescaleCorrectedQnVector->SetY(harmonic, newQy);
-                }
-                harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-              }
-            } else {
-              if (fQANotValidatedBin) fQANotValidatedBin->Fill(1.0);
+      /* TODO: basically we are re producing half of the information already produce for recentering correction. Re use it! */
+      if (fSubEvent->GetCurrentQnVector()->IsGoodQuality()) {
+        fCorrectedQnVector->CopyNumberOfContributors(*fSubEvent->GetCurrentQnVector());
+        fTwistCorrectedQnVector->CopyNumberOfContributors(*fCorrectedQnVector);
+        fRescaleCorrectedQnVector->CopyNumberOfContributors(*fCorrectedQnVector);
+        /* the double harmonic method corrects the current Qn vector, the correlations method the twisted one */
+        const QVector *inputQnVector = fTwistCorrectedQnVector.get();
+        if (fTwistAndRescaleMethod==Method::DOUBLE_HARMONIC) inputQnVector = fSubEvent->GetCurrentQnVector();
+        /* let's check the correction parameters */
+        Long64_t bin = fSubEvent->GetEventClassVariablesSet().GetBin();
+        harmonic = fCorrectedQnVector->GetFirstHarmonic();
+        if (harmonic!=-1 && fParameters.IsValidated(bin, harmonic)) {
+          while (harmonic!=-1) {
+            const auto parameters = fParameters.GetParameters(bin, harmonic);
+            if (parameters[0]==0.0) {
+              harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
+              continue;
             }
-          } else {
-            /* not done! input Q vector with bad quality */
-            fCorrectedQnVector->SetGood(kFALSE);
-          }
-        }
-          break;
-        case Method::CORRELATIONS: {
-          if (fSubEvent->GetCurrentQnVector()->IsGoodQuality()) {
-            fCorrectedQnVector->CopyNumberOfContributors(*fSubEvent->GetCurrentQnVector());
-            fTwistCorrectedQnVector->CopyNumberOfContributors(*fCorrectedQnVector);
-            fRescaleCorrectedQnVector->CopyNumberOfContributors(*fCorrectedQnVector);
-            /* let's check the correction histograms */
-            Long64_t bin = fCorrelationsInputHistograms->GetBin();
-            if (fCorrelationsInputHistograms->BinContentValidated(bin)) {
-              harmonic = fCorrectedQnVector->GetFirstHarmonic();
-              while (harmonic!=-1) {
-                Double_t XAXC = fCorrelationsInputHistograms->GetXXBinContent("AC", harmonic, bin);
-                Double_t YAYB = fCorrelationsInputHistograms->GetYYBinContent("AB", harmonic, bin);
-                Double_t XAXB = fCorrelationsInputHistograms->GetXXBinContent("AB", harmonic, bin);
-                Double_t XBXC = fCorrelationsInputHistograms->GetXXBinContent("BC", harmonic, bin);
-                Double_t XAYB = fCorrelationsInputHistograms->GetXYBinContent("AB", harmonic, bin);
-                Double_t XBYC = fCorrelationsInputHistograms->GetXYBinContent("BC", harmonic, bin);
-                Double_t
-                    Aplus = TMath::Sqrt(TMath::Abs(2.0*XAXC))*XAXB/TMath::Sqrt(TMath::Abs(XAXB*XBXC + XAYB*XBYC));
-                Double_t
-                    Aminus = TMath::Sqrt(TMath::Abs(2.0*XAXC))*YAYB/TMath::Sqrt(TMath::Abs(XAXB*XBXC + XAYB*XBYC));
-                Double_t LambdaPlus = XAYB/XAXB;
-                Double_t LambdaMinus = XAYB/YAYB;
-                if (TMath::Abs(Aplus) > fMaxThreshold) {
-                  harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-                  continue;
-                }
-                if (TMath::Abs(Aminus) > fMaxThreshold) {
-                  harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-                  continue;
-                }
-                if (TMath::Abs(LambdaPlus) > fMaxThreshold) {
-                  harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-                  continue;
-                }
-                if (TMath::Abs(LambdaMinus) > fMaxThreshold) {
-                  harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-                  continue;
-                }
-                Double_t Qx = fTwistCorrectedQnVector->x(harmonic);
-                Double_t Qy = fTwistCorrectedQnVector->y(harmonic);
-                Double_t newQx = (Qx - LambdaMinus*Qy)/(1 - LambdaMinus*LambdaPlus);
-                Double_t newQy = (Qy - LambdaPlus*Qx)/(1 - LambdaMinus*LambdaPlus);
-                if (fApplyTwist) {
-                  fCorrectedQnVector->SetX(harmonic, newQx);
-                  fCorrectedQnVector->SetY(harmonic, newQy);
-                  fTwistCorrectedQnVector->SetX(harmonic, newQx);
-                  fTwistCorrectedQnVector->SetY(harmonic, newQy);
-                  fRescaleCorrectedQnVector->SetX(harmonic, newQx);
-                  fRescaleCorrectedQnVector->SetY(harmonic, newQy);
-                }
-                newQx = newQx/Aplus;
-                newQy = newQy/Aminus;
-                if (Aplus==0.0) {
-                  harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-                  continue;
-                }
-                if (Aminus==0.0) {
-                  harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-                  continue;
-                }
-                if (fApplyRescale) {
-                  fCorrectedQnVector->SetX(harmonic, newQx);
-                  fCorrectedQnVector->SetY(harmonic, newQy);
-                  fRescaleCorrectedQnVector->SetX(harmonic, newQx);
-                  fRescaleCorrectedQnVector->SetY(harmonic, newQy);
-                }
-                harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
-              }
-            } else {
-              if (fQANotValidatedBin) fQANotValidatedBin->Fill(1.0);
+            const Double_t LambdaPlus = parameters[1];
+            const Double_t LambdaMinus = parameters[2];
+            const Double_t Aplus = parameters[3];
+            const Double_t Aminus = parameters[4];
+            Double_t Qx = inputQnVector->x(harmonic);
+            Double_t Qy = inputQnVector->y(harmonic);
+            Double_t newQx = (Qx - LambdaMinus*Qy)/(1 - LambdaMinus*LambdaPlus);
+            Double_t newQy = (Qy - LambdaPlus*Qx)/(1 - LambdaMinus*LambdaPlus);
+            if (fApplyTwist) {
+              fCorrectedQnVector->SetX(harmonic, newQx);
+              fCorrectedQnVector->SetY(harmonic, newQy);
+              fTwistCorrectedQnVector->SetX(harmonic, newQx);
+              fTwistCorrectedQnVector->SetY(harmonic, newQy);
+              fRescaleCorrectedQnVector->SetX(harmonic, newQx);
+              fRescaleCorrectedQnVector->SetY(harmonic, newQy);
+            }
+            newQx = newQx/Aplus;
+            newQy = newQy/Aminus;
+            if (Aplus==0.0) {
+              harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
+              continue;
             }
-          } else {
-            /* not done! input Q vector with bad quality */
-            fCorrectedQnVector->SetGood(kFALSE);
+            if (Aminus==0.0) {
+              harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
+              continue;
+            }
+            if (fApplyRescale) {
+              fCorrectedQnVector->SetX(harmonic, newQx);
+              fCorrectedQnVector->SetY(harmonic, newQy);
+              fRescaleCorrectedQnVector->SetX(harmonic, newQx);
+              fRescaleCorrectedQnVector->SetY(harmonic, newQy);
+            }
+            harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
           }
+        } else {
+          if (fQANotValidatedBin && fSubEvent->IsValidationQAFilled()) fQANotValidatedBin->Fill(1.0);
         }
-          break;
+      } else {
+        /* not done! input Q vector with bad quality */
+        fCorrectedQnVector->SetGood(kFALSE);
       }
       /* and update the current Qn vector */
       if (fApplyTwist) {
@@ -476,7 +455,7 @@ Bool_t TwistAndRescale::ProcessDataCollection() {
           /* remember, we store in the profiles the double harmonic while the Q2n vector stores them single */
           auto plainQ2nVector = fSubEvent->GetPlainQ2nVector();
           Int_t harmonic = fCorrectedQnVector->GetFirstHarmonic();
-          if (plainQ2nVector.IsGoodQuality()) {
+          if (plainQ2nVector.IsGoodQuality() && CollectData()) {
             while (harmonic!=-1) {
               fDoubleHarmonicCalibrationHistograms->FillX(harmonic*2, plainQ2nVector.x(harmonic));
               fDoubleHarmonicCalibrationHistograms->FillY(harmonic*2, plainQ2nVector.y(harmonic));
@@ -507,7 +486,7 @@ Bool_t TwistAndRescale::ProcessDataCollection() {
           /* remember, we store in the profiles the double harmonic while the Q2n vector stores them single */
           QVector plainQ2nVector = fSubEvent->GetPlainQ2nVector();
           Int_t harmonic = fCorrectedQnVector->GetFirstHarmonic();
-          if (plainQ2nVector.IsGoodQuality()) {
+          if (plainQ2nVector.IsGoodQuality() && CollectData()) {
             while (harmonic!=-1) {
               fDoubleHarmonicCalibrationHistograms->FillX(harmonic*2, plainQ2nVector.x(harmonic));
               fDoubleHarmonicCalibrationHistograms->FillY(harmonic*2, plainQ2nVector.y(harmonic));
@@ -532,7 +511,7 @@ Bool_t TwistAndRescale::ProcessDataCollection() {
       /* FALLTHRU */
     case State::APPLY: { /* apply the correction if the current Qn vector is good enough */
       /* provide QA info if required */
-      if (fQATwistQnAverageHistogram) {
+      if (fQATwistQnAverageHistogram && fSubEvent->IsCalibrationQAFilled()) {
         Int_t harmonic = fCorrectedQnVector->GetFirstHarmonic();
         while (harmonic!=-1) {
           fQATwistQnAverageHistogram->FillX(harmonic, fTwistCorrectedQnVector->x(harmonic));
@@ -540,7 +519,7 @@ Bool_t TwistAndRescale::ProcessDataCollection() {
           harmonic = fCorrectedQnVector->GetNextHarmonic(harmonic);
         }
       }
-      if (fQARescaleQnAverageHistogram) {
+      if (fQARescaleQnAverageHistogram && fSubEvent->IsCalibrationQAFilled()) {
         Int_t harmonic = fCorrectedQnVector->GetFirstHarmonic();
         while (harmonic!=-1) {
           fQARescaleQnAverageHistogram->FillX(harmonic, fRescaleCorrectedQnVector->x(harmonic));
@@ -558,6 +537,17 @@ Bool_t TwistAndRescale::ProcessDataCollection() {
   return applied;
 }
 
+/// Gets the averages of the collected double harmonic components as estimate of the correction parameters
+///
+/// Only the double harmonic method supports the convergence check.
+/// \param parameters the averages of the components
+/// \param scales their widths
+/// \return false if the collected data do not validate all event classes yet
+bool TwistAndRescale::GetConvergenceParameters(std::vector<double> &parameters, std::vector<double> &scales) const {
+  return fTwistAndRescaleMethod==Method::DOUBLE_HARMONIC && fDoubleHarmonicCalibrationHistograms &&
+      fDoubleHarmonicCalibrationHistograms->GetMeans(parameters, scales);
+}
+
 /// Clean the correction to accept a new event
 void TwistAndRescale::ClearCorrectionStep() {
   fTwistCorrectedQnVector->Reset();
@@ -565,6 +555,15 @@ void TwistAndRescale::ClearCorrectionStep() {
   fCorrectedQnVector->Reset();
 }
 
+/// Copies the filled profiles into their histograms
+void TwistAndRescale::UpdateHistograms() {
+  if (fDoubleHarmonicCalibrationHistograms) fDoubleHarmonicCalibrationHistograms->UpdateHistograms();
+  if (fCorrelationsCalibrationHistograms) fCorrelationsCalibrationHistograms->UpdateHistograms();
+  if (fQATwistQnAverageHistogram) fQATwistQnAverageHistogram->UpdateHistograms();
+  if (fQARescaleQnAverageHistogram) fQARescaleQnAverageHistogram->UpdateHistograms();
+  if (fQANotValidatedBin) fQANotValidatedBin->UpdateHistograms();
+}
+
 /// Include the corrected Qn vectors into the passed list
 ///
 /// Adds the Qn vector to the passed list
@@ -48,6 +48,7 @@
 /// defined within the involved detector configuration
 
 #include "CorrectionOnQnVector.h"
+#include "CorrectionParameterTable.h"
 #include "CorrectionHistogramSparse.h"
 #include "CorrectionProfileCorrelationComponents.h"
 #include "CorrectionProfileComponents.h"
@@ -114,7 +115,19 @@ class Alignment : public CorrectionOnQnVector {
   /// Set the minimum number of entries for calibration histogram bin content validation
   /// \param nNoOfEntries the number of entries threshold
   void SetNoOfEntriesThreshold(Int_t nNoOfEntries) { fMinNoOfEntriesToValidate = nNoOfEntries; }
+  virtual std::vector<std::string> GetReferencedDetectors() const { return {fDetectorForAlignmentName}; }
+  virtual void WriteSettings(std::ostream &stream) const {
+    CorrectionOnQnVector::WriteSettings(stream);
+    stream << ' ' << fHarmonicForAlignment << ' ' << fDetectorForAlignmentName << ' ' << fMinNoOfEntriesToValidate;
+  }
+  /// The alignment harmonic is read from the input Qn vector and the one of the reference detector
+  virtual std::bitset<QVector::kmaxharmonics> GetRequiredInputHarmonics() const { return GetAlignmentHarmonic(); }
+  virtual std::bitset<QVector::kmaxharmonics> GetRequiredReferenceHarmonics() const { return GetAlignmentHarmonic(); }
   virtual void AttachInput(TList *list);
+  virtual void AttachParameters(CorrectionParameterTable &&parameters);
+  virtual const CorrectionParameterTable *GetParameterTable() const {
+    return fParameters.IsInitialized() ? &fParameters : nullptr;
+  }
   virtual void AfterInputAttachAction() {}
   virtual void CreateSupportQVectors();
   virtual void CreateCorrectionHistograms();
@@ -123,10 +136,23 @@ class Alignment : public CorrectionOnQnVector {
 
   virtual Bool_t ProcessCorrections();
   virtual Bool_t ProcessDataCollection();
+  virtual void ProcessCorrectionsBatch(CorrectionBase *const *steps, unsigned char *active, std::size_t n) {
+    BatchProcessCorrections<Alignment>(steps, active, n);
+  }
+  virtual void ProcessDataCollectionBatch(CorrectionBase *const *steps, unsigned char *active, std::size_t n) {
+    BatchProcessDataCollection<Alignment>(steps, active, n);
+  }
   virtual void ClearCorrectionStep();
+  virtual void UpdateHistograms();
 
  private:
   using State = Qn::CorrectionBase::State;
+  void FillParameterTable();
+  std::bitset<QVector::kmaxharmonics> GetAlignmentHarmonic() const {
+    std::bitset<QVector::kmaxharmonics> harmonics;
+    if (fHarmonicForAlignment > 0) harmonics.set(fHarmonicForAlignment - 1);
+    return harmonics;
+  }
   static constexpr const unsigned int
       szPriority = CorrectionOnQnVector::Step::kAlignment; ///< the key of the correction step for ordering purpose
   static constexpr const char *szCorrectionName = "Alignment"; ///< the name of the correction step
@@ -145,6 +171,7 @@ class Alignment : public CorrectionOnQnVector {
       fQANotValidatedBin;    //!<! the histogram with non validated bin information
   std::unique_ptr<CorrectionProfileComponents>
       fQAQnAverageHistogram; //!<! the after correction step average Qn components QA histogram
+  CorrectionParameterTable fParameters; //!<! the rotation of each event class and harmonic
 
   Int_t fHarmonicForAlignment = -1;              ///< the harmonic number to be used for Qn vector alignment correction
   std::string
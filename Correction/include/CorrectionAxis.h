@@ -60,6 +60,20 @@ class CorrectionAxis {
   double GetLowerEdge() const { return axis_.GetFirstBinEdge(); }
   /// Gets the highest variabel value considered
   double GetUpperEdge() const { return axis_.GetLastBinEdge(); }
+  /// Gets the bin of the current value of the variable
+  /// Follows the numbering of the histogram axes: zero for the underflow
+  /// and the number of bins plus one for the overflow
+  /// \return bin number starting from one
+  Int_t GetCurrentBin() const { return FindBin(GetValue()); }
+  /// Gets the bin of a value of the variable
+  /// Follows the numbering of the histogram axes as GetCurrentBin
+  /// \param value value of the variable
+  /// \return bin number starting from one
+  Int_t FindBin(const double value) const {
+    if (value < GetLowerEdge()) return 0;
+    if (!(value < GetUpperEdge())) return GetNBins() + 1;
+    return static_cast<Int_t>(axis_.FindBin(value)) + 1;
+  }
  private:
   InputVariable variable_;
   AxisD axis_;
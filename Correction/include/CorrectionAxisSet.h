@@ -13,6 +13,9 @@
 /// \file QnCorrectionsEventClassVariablesSet.h
 /// \brief Class that models the set of variables that define an event class for the Q vector correction framework
 
+#include <algorithm>
+#include <memory>
+
 #include "CorrectionAxis.h"
 #include "InputVariableManager.h"
 namespace Qn {
@@ -38,6 +41,49 @@ class CorrectionAxisSet {
     }
   }
   std::vector<CorrectionAxis>::size_type GetSize() const { return axes_.size(); }
+  /// Computes the event class bin of the current values of the variables
+  /// As the variables are the same for all the profiles the bin is computed
+  /// once per event, after the event variables are final. The bin is shared
+  /// between all the copies of the set.
+  void UpdateBin() {
+    Long64_t bin = 0;
+    for (const auto &axis : axes_) {
+      bin = bin*(axis.GetNBins() + 2) + axis.GetCurrentBin();
+    }
+    *bin_ = bin;
+  }
+  /// Computes the event class bins of several events at once
+  /// Each axis is processed in one pass over the values of all events.
+  /// The bins are the ones UpdateBin computes for the values of each event.
+  /// \param values values of the variable of each axis for all events, in the order of the axes
+  /// \param n number of events
+  /// \param bins the linear event class bin of each event
+  void FindBins(const double *const *values, std::size_t n, Long64_t *bins) const {
+    std::fill(bins, bins + n, 0);
+    for (size_type iaxis = 0; iaxis < axes_.size(); ++iaxis) {
+      const auto &axis = axes_[iaxis];
+      const Long64_t nbins = axis.GetNBins() + 2;
+      const auto axis_values = values[iaxis];
+      for (std::size_t i = 0; i < n; ++i) bins[i] = bins[i]*nbins + axis.FindBin(axis_values[i]);
+    }
+  }
+  /// Sets the event class bin of the current event, e.g. computed by FindBins
+  /// \param bin the linear event class bin
+  void SetBin(const Long64_t bin) { *bin_ = bin; }
+  /// Gets the event class bin of the current event
+  /// The bin follows the linear bin numbering, including under- and overflow
+  /// bins, of the THn histograms with the axes of the set.
+  /// \return the linear event class bin
+  Long64_t GetBin() const { return *bin_; }
+  /// Gets the number of event class bins, including under- and overflow bins
+  /// \return the number of linear event class bins
+  Long64_t GetNumberOfBins() const {
+    Long64_t nbins = 1;
+    for (const auto &axis : axes_) {
+      nbins *= axis.GetNBins() + 2;
+    }
+    return nbins;
+  }
   void GetMultidimensionalConfiguration(int *nbins, double *minvals, double *maxvals) const {
     unsigned int i = 0;
     for (auto &axis : axes_) {
@@ -49,6 +95,7 @@ class CorrectionAxisSet {
   }
  private:
   std::vector<CorrectionAxis> axes_;
+  std::shared_ptr<Long64_t> bin_ = std::make_shared<Long64_t>(0); //!<! event class bin of the current event
 /// \cond CLASSIMP
  ClassDef(CorrectionAxisSet, 1);
 /// \endcond
@@ -15,8 +15,14 @@
 /// \brief Base class for the support of the different correction steps within Q vector correction framework
 ///
 
+#include <cmath>
+#include <ios>
+#include <ostream>
+#include <vector>
+
 #include "TObject.h"
 #include "TList.h"
+#include "CorrectionParameterTable.h"
 
 namespace Qn {
 class SubEvent;
@@ -66,6 +72,8 @@ class CorrectionBase : public TObject {
     fName = other.fName;
     fState = other.fState;
     fSubEvent = other.fSubEvent;
+    fConvergenceInterval = other.fConvergenceInterval;
+    fConvergenceTolerance = other.fConvergenceTolerance;
   }
 
   /// Attaches the needed input information to the correction step
@@ -74,6 +82,15 @@ class CorrectionBase : public TObject {
   /// \param list list where the inputs should be found
   /// \return kTRUE if everything went OK
   virtual void AttachInput(TList *list) { (void) list; }
+  /// Attaches the final correction parameters read from a calibration file
+  ///
+  /// Alternative to the input histograms for the correction steps which
+  /// keep their parameters in a table.
+  /// \param parameters the table of the correction parameters
+  virtual void AttachParameters(CorrectionParameterTable &&parameters) { (void) parameters; }
+  /// Gets the final correction parameters for the export to a calibration file
+  /// \return the table of the correction parameters, nullptr if not available
+  virtual const CorrectionParameterTable *GetParameterTable() const { return nullptr; }
   /// Perform after calibration histograms attach actions
   /// It is used to inform the different correction step that
   /// all conditions for running the network are in place so
@@ -114,9 +131,35 @@ class CorrectionBase : public TObject {
   /// Pure virtual function
   /// \return kTRUE if everything went OK
   virtual bool ProcessDataCollection() { return false; }
+  /// Processes this correction step for all sub events of a detector
+  ///
+  /// The passed steps are the instances of this step in the sub events of
+  /// the detector, which all share the type of this instance. The correction
+  /// steps with a batched implementation dispatch once for all sub events.
+  /// \param steps the correction steps of the sub events
+  /// \param active flags of the sub events whose previous steps were applied.
+  /// Cleared for the sub events in which this step is not applied.
+  /// \param n the number of sub events
+  virtual void ProcessCorrectionsBatch(CorrectionBase *const *steps, unsigned char *active, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      if (active[i]) active[i] = steps[i]->ProcessCorrections();
+    }
+  }
+  /// Processes the data collection of this correction step for all sub events of a detector
+  /// \param steps the correction steps of the sub events
+  /// \param active flags of the sub events whose previous steps were applied
+  /// \param n the number of sub events
+  virtual void ProcessDataCollectionBatch(CorrectionBase *const *steps, unsigned char *active, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      if (active[i]) active[i] = steps[i]->ProcessDataCollection();
+    }
+  }
   /// Clean the correction to accept a new event
   /// Pure virtual function
   virtual void ClearCorrectionStep() {}
+  /// Copies the accumulated content of the profiles into their histograms
+  /// To be called before the histograms are merged or stored
+  virtual void UpdateHistograms() {}
   /// Reports if the correction step is being applied
   /// Pure virutal function
   /// \return TRUE if the correction step is being applied
@@ -149,6 +192,39 @@ class CorrectionBase : public TObject {
   }
   State GetState() { return fState; }
   void Enable() {fState = State::CALIBRATION;}
+  /// Enables the convergence based termination of the data collection
+  ///
+  /// Every check_interval collected events the correction parameters
+  /// estimated from the collected data are compared with the ones of the
+  /// previous check. Once all event classes with entries are validated and
+  /// no parameter changed by more than the tolerance relative to its scale,
+  /// the step stops collecting data for the ongoing run. The correction
+  /// steps which do not provide their parameters never converge.
+  /// \param check_interval number of collected events between two checks. Disabled if zero.
+  /// \param tolerance maximum relative change of the parameters between two checks
+  void SetConvergenceCheck(unsigned int check_interval, double tolerance) {
+    fConvergenceInterval = check_interval;
+    fConvergenceTolerance = tolerance;
+  }
+  /// Reports if the data collection was stopped because the parameters converged
+  /// \return true if the correction step stopped collecting data
+  bool IsCollectionConverged() const { return fCollectionConverged; }
+  /// Restarts the convergence check, e.g. with the calibration histograms of a new run
+  void ResetConvergence() {
+    fCollectionConverged = false;
+    fCollectedEvents = 0;
+    fConvergenceParameters.clear();
+  }
+
+  /// Writes the settings which determine the calibration output of the correction step
+  ///
+  /// Used for the key of the calibration cache. Correction steps with
+  /// further settings extend the written settings.
+  /// \param stream the output stream
+  virtual void WriteSettings(std::ostream &stream) const {
+    stream << fName << ' ' << fPriority << ' ' << fConvergenceInterval << ' '
+           << std::hexfloat << fConvergenceTolerance << std::defaultfloat;
+  }
 
   void CopyToOutputList(TList *list) {
     if (fState == State::PASSIVE) return;
@@ -160,11 +236,73 @@ class CorrectionBase : public TObject {
 /// Stores the detector configuration owner
 /// \param subevent the detector configuration owner
   void SetOwner(SubEvent *subevent) { fSubEvent = subevent; }
+  /// Processes the correction step of type STEP for all sub events of a detector
+  /// The calls are bound statically to the implementation of STEP.
+  /// \param steps the correction steps of the sub events
+  /// \param active flags of the sub events whose previous steps were applied
+  /// \param n the number of sub events
+  template<typename STEP>
+  static void BatchProcessCorrections(CorrectionBase *const *steps, unsigned char *active, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      if (active[i]) active[i] = static_cast<STEP *>(steps[i])->STEP::ProcessCorrections();
+    }
+  }
+  /// Processes the data collection of the correction step of type STEP for all sub events of a detector
+  /// \param steps the correction steps of the sub events
+  /// \param active flags of the sub events whose previous steps were applied
+  /// \param n the number of sub events
+  template<typename STEP>
+  static void BatchProcessDataCollection(CorrectionBase *const *steps, unsigned char *active, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      if (active[i]) active[i] = static_cast<STEP *>(steps[i])->STEP::ProcessDataCollection();
+    }
+  }
+  /// Gets the current estimate of the correction parameters for the convergence check
+  ///
+  /// The correction steps supporting the convergence check provide the
+  /// parameters from their collected data together with a scale of each
+  /// parameter, e.g. the width of the averaged component.
+  /// \param parameters the current values of the parameters
+  /// \param scales the scales of the parameters
+  /// \return false if the collected data do not validate all event classes yet
+  virtual bool GetConvergenceParameters(std::vector<double> &parameters, std::vector<double> &scales) const {
+    (void) parameters;
+    (void) scales;
+    return false;
+  }
+  /// Counts a collected event and checks the convergence every check interval
+  ///
+  /// To be called by the correction steps before they fill their calibration
+  /// histograms.
+  /// \return false if the correction step stopped collecting data
+  bool CollectData() {
+    if (fCollectionConverged) return false;
+    if (fConvergenceInterval==0 || ++fCollectedEvents < fConvergenceInterval) return true;
+    fCollectedEvents = 0;
+    std::vector<double> parameters;
+    std::vector<double> scales;
+    if (!GetConvergenceParameters(parameters, scales)) {
+      fConvergenceParameters.clear();
+      return true;
+    }
+    bool converged = fConvergenceParameters.size()==parameters.size();
+    for (std::size_t i = 0; converged && i < parameters.size(); ++i) {
+      converged = std::abs(parameters[i] - fConvergenceParameters[i]) <= fConvergenceTolerance*std::abs(scales[i]);
+    }
+    fConvergenceParameters = std::move(parameters);
+    fCollectionConverged = converged;
+    return !converged;
+  }
   unsigned int fPriority = 0; ///< the correction key that codifies order information
   std::string fName;
   State fState = State::PASSIVE; ///< the state in which the correction step is
   SubEvent *fSubEvent = nullptr; ///< pointer to the detector configuration owner
   TList output_histograms;
+  unsigned int fConvergenceInterval = 0; //!<! collected events between two convergence checks, disabled if zero
+  double fConvergenceTolerance = 0.; //!<! maximum relative change of the parameters between two checks
+  unsigned int fCollectedEvents = 0; //!<! collected events since the last convergence check
+  bool fCollectionConverged = false; //!<! the data collection stopped because the parameters converged
+  std::vector<double> fConvergenceParameters; //!<! parameters of the last convergence check
   friend bool operator<(const CorrectionBase &lh, const CorrectionBase &rh);
 
 /// \cond CLASSIMP
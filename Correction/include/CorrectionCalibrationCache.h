@@ -0,0 +1,104 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLOW_CORRECTIONCALIBRATIONCACHE_H
+#define FLOW_CORRECTIONCALIBRATIONCACHE_H
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "TList.h"
+
+namespace Qn {
+/**
+ * @class CorrectionCalibrationCache
+ * @brief Directory of the calibration histograms of previous productions, which are keyed by a hash of the
+ * effective configuration. The histograms of a run are kept in the file <directory>/<key>/<run>.root, such that
+ * productions with the same configuration and input data reuse them as calibration input instead of repeating the
+ * calibration passes. The configuration, from which the key is computed, is written next to the runs.
+ */
+class CorrectionCalibrationCache {
+ public:
+  /**
+   * Constructor. Creates the directory of the key if it does not exist.
+   * @param directory directory of the cache
+   * @param configuration description of the effective configuration
+   */
+  CorrectionCalibrationCache(const std::string &directory, std::string configuration);
+  CorrectionCalibrationCache(const CorrectionCalibrationCache &) = delete;
+  CorrectionCalibrationCache &operator=(const CorrectionCalibrationCache &) = delete;
+
+  /**
+   * Computes the key of a configuration. The key is the 64 bit FNV-1a hash of the description in hexadecimal
+   * digits, which does not depend on the platform.
+   * @param configuration description of the configuration
+   * @return the key
+   */
+  static std::string Hash(const std::string &configuration);
+
+  const std::string &GetKey() const { return key_; }
+
+  /**
+   * Finds the calibration histograms of a run. The histograms are read once and kept by the cache. Thread safe.
+   * @param run name of the run
+   * @return hashed list of the histograms of the run owned by the cache, nullptr if the run is not cached.
+   */
+  TList *Find(const std::string &run);
+
+  /**
+   * Stores the calibration histograms of a run, replacing the previous ones. The file is written under a temporary
+   * name and renamed, such that concurrent productions never read a partially written file. Thread safe.
+   * @param run name of the run
+   * @param list calibration histograms of the run
+   */
+  void Store(const std::string &run, const TList &list);
+
+  /**
+   * Reads the calibration histograms of a run in the background, such that they are decompressed while the current
+   * run is processed. A later Find of the run waits for the read. Thread safe.
+   * @param run name of the run
+   */
+  void Prefetch(const std::string &run);
+
+ private:
+  std::string FileName(const std::string &run) const { return directory_ + "/" + run + ".root"; }
+
+  std::string directory_; ///< directory of the key
+  std::string key_; ///< hash of the configuration
+  std::string configuration_; ///< description of the configuration
+  bool configuration_written_ = false; ///< the description was written to the directory
+  std::mutex mutex_; ///< guards the files and the loaded runs
+  std::map<std::string, std::unique_ptr<TList>> runs_; ///< loaded runs
+  std::mutex prefetch_mutex_; ///< guards the prefetch
+  std::string prefetch_run_; ///< run of the last prefetch
+  std::future<void> prefetch_; ///< read of the last prefetch, which is waited for at destruction
+};
+
+/**
+ * Moves the objects of a list into a hashed list. Nested lists are replaced by hashed lists recursively. The
+ * calibration input of a run holds one list per sub event of all detectors, which are looked up by name when the
+ * input is attached, such that hashing avoids scanning the lists for every sub event and histogram.
+ * @param list list, which is deleted after its objects have been moved.
+ * @return hashed list with the same name owning the objects
+ */
+TList *MakeHashedList(TList *list);
+}
+
+#endif //FLOW_CORRECTIONCALIBRATIONCACHE_H
@@ -0,0 +1,178 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLOW_CORRECTIONCALIBRATIONFILE_H
+#define FLOW_CORRECTIONCALIBRATIONFILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "CorrectionParameterTable.h"
+
+namespace Qn {
+/**
+ * @brief Layout of the binary calibration file.
+ * The file starts with a header, followed by the data of the tables and the directory of the tables. All offsets
+ * are given relative to the start of the file and are aligned to 8 bytes, such that the tables are used in place.
+ * A table consists of its keys (int32), the validation flags (uint8) and the parameters (double) of its entries.
+ * The directory holds one record per table followed by the names of the tables.
+ */
+namespace CalibrationFileFormat {
+constexpr char kMagic[8] = {'Q', 'N', 'C', 'A', 'L', 'I', 'B', '\0'};
+constexpr std::uint32_t kVersion = 1;
+constexpr std::size_t kAlignment = 8;
+struct Header {
+  char magic[8]; ///< identifies the file
+  std::uint32_t version; ///< version of the layout
+  std::uint32_t n_tables; ///< number of tables
+  std::uint64_t directory_offset; ///< offset of the directory
+};
+struct Record {
+  std::uint64_t name_offset; ///< offset of the name of the table
+  std::uint64_t name_size; ///< size of the name of the table
+  std::int64_t n_bins; ///< number of event class bins
+  std::int32_t n_keys; ///< number of keys of each bin
+  std::int32_t n_parameters; ///< number of parameters of each entry
+  std::uint64_t keys_offset; ///< offset of the keys
+  std::uint64_t validated_offset; ///< offset of the validation flags
+  std::uint64_t parameters_offset; ///< offset of the parameters
+};
+/**
+ * Name of a table in the directory.
+ * @param run name of the run
+ * @param sub_event name of the sub event
+ * @param step name of the correction step
+ * @return the name. The parts are separated by a null character.
+ */
+inline std::string TableName(const std::string &run, const std::string &sub_event, const std::string &step) {
+  std::string name(run);
+  name.push_back('\0');
+  name += sub_event;
+  name.push_back('\0');
+  name += step;
+  return name;
+}
+}
+
+/**
+ * @class CorrectionCalibrationWriter
+ * @brief Writes the final correction parameters to a binary calibration file.
+ * The tables are written when they are added, such that only the directory is kept in memory.
+ */
+class CorrectionCalibrationWriter {
+ public:
+  /**
+   * Constructor
+   * @param file_name name of the calibration file
+   */
+  explicit CorrectionCalibrationWriter(std::string file_name);
+  ~CorrectionCalibrationWriter();
+  CorrectionCalibrationWriter(const CorrectionCalibrationWriter &) = delete;
+  CorrectionCalibrationWriter &operator=(const CorrectionCalibrationWriter &) = delete;
+
+  /**
+   * Writes the parameters of a correction step.
+   * @param run name of the run
+   * @param sub_event name of the sub event
+   * @param step name of the correction step
+   * @param table the parameters
+   */
+  void Add(const std::string &run, const std::string &sub_event, const std::string &step,
+           const CorrectionParameterTable &table);
+
+  /**
+   * Writes the directory and closes the file.
+   */
+  void Close();
+
+ private:
+  std::uint64_t Append(const void *data, std::size_t size);
+
+  std::string file_name_; ///< name of the calibration file
+  std::FILE *file_ = nullptr; ///< the calibration file
+  std::uint64_t position_ = 0; ///< current size of the file
+  std::vector<CalibrationFileFormat::Record> records_; ///< records of the written tables
+  std::vector<std::string> names_; ///< names of the written tables
+};
+
+/**
+ * @class CorrectionCalibrationFile
+ * @brief Memory-mapped binary calibration file.
+ * Only the directory is read when the file is opened. The parameter tables refer to the mapping without copying
+ * them, such that the operating system loads the pages of a run only when the run is processed.
+ */
+class CorrectionCalibrationFile {
+ public:
+  CorrectionCalibrationFile() = default;
+  ~CorrectionCalibrationFile();
+  CorrectionCalibrationFile(const CorrectionCalibrationFile &) = delete;
+  CorrectionCalibrationFile &operator=(const CorrectionCalibrationFile &) = delete;
+
+  /**
+   * Maps the calibration file and reads its directory. The file is not kept open, if it is not valid.
+   * @param file_name name of the calibration file
+   */
+  void Open(const std::string &file_name);
+
+  bool IsOpen() const { return mapped_!=nullptr; }
+
+  bool HasRun(const std::string &run) const { return runs_.find(run)!=runs_.end(); }
+
+  /**
+   * Checks if the file contains parameters of a sub event in a run.
+   * @param run name of the run
+   * @param sub_event name of the sub event
+   * @return true if there is at least one table of the sub event
+   */
+  bool HasSubEvent(const std::string &run, const std::string &sub_event) const {
+    return sub_events_.find(run + '\0' + sub_event)!=sub_events_.end();
+  }
+
+  /**
+   * Finds the parameters of a correction step.
+   * @param run name of the run
+   * @param sub_event name of the sub event
+   * @param step name of the correction step
+   * @return table referring to the mapped parameters. Not initialized if the file has no parameters of the step.
+   */
+  CorrectionParameterTable Find(const std::string &run, const std::string &sub_event, const std::string &step) const;
+
+ private:
+  /**
+   * Validates the mapped file and reads its directory.
+   * @param file_name name of the calibration file used in the messages
+   */
+  void ReadDirectory(const std::string &file_name);
+
+  /**
+   * Unmaps the file and clears the directory.
+   */
+  void Unmap();
+
+  const char *mapped_ = nullptr; ///< the mapped file
+  std::size_t size_ = 0; ///< size of the mapping
+  std::unordered_map<std::string, const CalibrationFileFormat::Record *> tables_; ///< directory of the tables
+  std::unordered_set<std::string> runs_; ///< names of the runs in the file
+  std::unordered_set<std::string> sub_events_; ///< names of the runs and sub events in the file
+};
+}
+
+#endif //FLOW_CORRECTIONCALIBRATIONFILE_H
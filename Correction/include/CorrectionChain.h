@@ -0,0 +1,129 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLOW_CORRECTIONCHAIN_H
+#define FLOW_CORRECTIONCHAIN_H
+
+#include <cstddef>
+#include <memory>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include "CorrectionBase.h"
+
+namespace Qn {
+/**
+ * @class CorrectionChain
+ * @brief Processes the Q vector correction steps of the sub events of a detector as one fixed chain. The chain is
+ * composed at compile time with MakeCorrectionChain, such that all steps of a sub event are processed in one
+ * function with statically bound calls, before the next sub event is processed. The list of correction steps of the
+ * sub events is used, if no chain is set.
+ */
+class CorrectionChain {
+ public:
+  using Steps = std::vector<std::vector<CorrectionBase *>>;
+  virtual ~CorrectionChain() = default;
+
+  /**
+   * Checks if the correction steps of a detector are of the types of the chain in the same order.
+   * @param steps the correction steps of the sub events [step][sub event]
+   */
+  virtual bool Matches(const Steps &steps) const = 0;
+
+  /**
+   * Processes the correction steps of the sub events.
+   * @param steps the correction steps of the sub events [step][sub event]
+   * @param active flags of the sub events to be processed. Cleared for the sub events, in which a step is not applied.
+   * @param n number of sub events
+   */
+  virtual void ProcessCorrections(const Steps &steps, unsigned char *active, std::size_t n) const = 0;
+
+  /**
+   * Processes the data collection of the correction steps of the sub events.
+   * @param steps the correction steps of the sub events [step][sub event]
+   * @param active flags of the sub events to be processed. Cleared for the sub events, in which a step is not applied.
+   * @param n number of sub events
+   */
+  virtual void ProcessDataCollection(const Steps &steps, unsigned char *active, std::size_t n) const = 0;
+};
+
+/**
+ * @class StaticCorrectionChain
+ * @brief Correction chain of the correction steps STEPS in the order of their application.
+ * @tparam STEPS types of the Q vector correction steps, e.g. Recentering and TwistAndRescale.
+ */
+template<typename... STEPS>
+class StaticCorrectionChain : public CorrectionChain {
+ public:
+  bool Matches(const Steps &steps) const override {
+    if (steps.size()!=sizeof...(STEPS)) return false;
+    return MatchesSteps(steps, std::index_sequence_for<STEPS...>());
+  }
+
+  void ProcessCorrections(const Steps &steps, unsigned char *active, std::size_t n) const override {
+    for (std::size_t i = 0; i < n; ++i) {
+      if (active[i]) active[i] = Corrections(steps, i, std::index_sequence_for<STEPS...>());
+    }
+  }
+
+  void ProcessDataCollection(const Steps &steps, unsigned char *active, std::size_t n) const override {
+    for (std::size_t i = 0; i < n; ++i) {
+      if (active[i]) active[i] = DataCollection(steps, i, std::index_sequence_for<STEPS...>());
+    }
+  }
+
+ private:
+  template<std::size_t... I>
+  static bool MatchesSteps(const Steps &steps, std::index_sequence<I...>) {
+    auto matches = [](const std::vector<CorrectionBase *> &step, const std::type_info &type) {
+      for (const auto correction : step) {
+        if (typeid(*correction)!=type) return false;
+      }
+      return true;
+    };
+    return (matches(steps[I], typeid(STEPS)) && ...);
+  }
+
+  /**
+   * Processes the steps of a sub event until the first step, which is not applied.
+   */
+  template<std::size_t... I>
+  static bool Corrections(const Steps &steps, std::size_t i, std::index_sequence<I...>) {
+    return (static_cast<STEPS *>(steps[I][i])->STEPS::ProcessCorrections() && ...);
+  }
+
+  template<std::size_t... I>
+  static bool DataCollection(const Steps &steps, std::size_t i, std::index_sequence<I...>) {
+    return (static_cast<STEPS *>(steps[I][i])->STEPS::ProcessDataCollection() && ...);
+  }
+};
+
+/**
+ * Composes a correction chain, which is set to a detector with CorrectionManager::SetCorrectionChain.
+ * Qn::MakeCorrectionChain<Qn::Recentering, Qn::TwistAndRescale>()
+ * @tparam STEPS types of the Q vector correction steps in the order of their application.
+ * @return the correction chain
+ */
+template<typename... STEPS>
+std::shared_ptr<const CorrectionChain> MakeCorrectionChain() {
+  static_assert(sizeof...(STEPS) > 0, "A correction chain needs at least one correction step.");
+  return std::make_shared<StaticCorrectionChain<STEPS...>>();
+}
+}
+
+#endif //FLOW_CORRECTIONCHAIN_H
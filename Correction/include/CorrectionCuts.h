@@ -21,8 +21,14 @@
 #define FLOW_CORRECTIONCUTS_H
 
 #include <array>
+#include <cstdint>
 #include <vector>
 #include <functional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
 
 #include "ROOT/RMakeUnique.hxx"
 #include "ROOT/RIntegerSequence.hxx"
@@ -36,7 +42,13 @@ namespace Qn {
 class CorrectionCut {
  public:
   using CallBack = std::function<std::unique_ptr<Qn::CutBase>(const Qn::InputVariableManager &)>;
-  explicit CorrectionCut(CallBack callback) : callback_(std::move(callback)) {}
+  /**
+   * Constructor
+   * @param callback creates the cut from the variables
+   * @param signature identifies cuts, which select the same entries. Empty if the cut cannot be identified.
+   */
+  explicit CorrectionCut(CallBack callback, std::string signature = {}) :
+      callback_(std::move(callback)), signature_(std::move(signature)) {}
   ~CorrectionCut() = default;
   CorrectionCut(CorrectionCut &&) = default;
   void Initialize(const Qn::InputVariableManager &var) {
@@ -51,14 +63,22 @@ class CorrectionCut {
   bool Check() const {
     return cut_->Check();
   }
+  std::size_t Select(unsigned int *entries, std::size_t n) const {
+    return cut_->Select(entries, n);
+  }
   CorrectionCut::CallBack GetCallBack() const { return callback_; }
+  const std::string &GetSignature() const { return signature_; }
  private:
   std::unique_ptr<CutBase> cut_;
   CorrectionCut::CallBack callback_;
+  std::string signature_; ///< identifies cuts selecting the same entries. Empty if unknown.
 };
 
 /**
- * Manages cuts class and allows checking if the current variables passes the cut
+ * Manages cuts class and allows checking if the current variables passes the cut.
+ * The entries of every channel passing each cut are counted in integer counters. Only the counters touched in an event
+ * are accumulated at FillReport, and the accumulated counts are written to the report histogram by UpdateReport, e.g.
+ * at the end of the event loop. The report has the contents of filling the counts of every event into the histogram.
  */
 class CorrectionCuts {
  public:
@@ -66,45 +86,73 @@ class CorrectionCuts {
 
   CorrectionCuts(const CorrectionCuts &cuts) {
     n_channels_ = cuts.n_channels_;
-    var_values_ = cuts.var_values_;
-    cut_number = cuts.cut_number;
-    cut_weight_ = cuts.cut_weight_;
-    cut_channel_ = cuts.cut_channel_;
+    event_counts_ = cuts.event_counts_;
+    touched_ = cuts.touched_;
+    counts_ = cuts.counts_;
+    squared_counts_ = cuts.squared_counts_;
+    report_events_ = cuts.report_events_;
     for (auto &cut : cuts.cuts_) {
-      cuts_.emplace_back(cut.GetCallBack());
+      cuts_.emplace_back(cut.GetCallBack(), cut.GetSignature());
     }
     if (cuts.report_) {
-      CreateCutReport(cuts.report_->GetName(), n_channels_);
+      CreateCutReport(cuts.report_name_, n_channels_);
     }
   }
 
-  CorrectionCuts(CorrectionCuts &&cuts) {
-    n_channels_ = cuts.n_channels_;
-    var_values_ = cuts.var_values_;
-    cut_number = cuts.cut_number;
-    cut_weight_ = cuts.cut_weight_;
-    cut_channel_ = cuts.cut_channel_;
-    cuts_ = std::move(cuts.cuts_);
-    report_ = std::move(cuts.report_);
+  CorrectionCuts(CorrectionCuts &&cuts) noexcept {
+    *this = std::move(cuts);
   }
   CorrectionCuts &operator=(CorrectionCuts &&cuts)  noexcept {
     n_channels_ = cuts.n_channels_;
-    var_values_ = cuts.var_values_;
-    cut_number = cuts.cut_number;
-    cut_weight_ = cuts.cut_weight_;
-    cut_channel_ = cuts.cut_channel_;
+    event_counts_ = std::move(cuts.event_counts_);
+    touched_ = std::move(cuts.touched_);
+    counts_ = std::move(cuts.counts_);
+    squared_counts_ = std::move(cuts.squared_counts_);
+    report_events_ = cuts.report_events_;
     cuts_ = std::move(cuts.cuts_);
-    report_ = std::move(cuts.report_);
+    report_name_ = std::move(cuts.report_name_);
+    report_ = cuts.report_;
+    cuts.report_ = nullptr;
     return *this;
   };
-  
-  virtual ~CorrectionCuts() { delete[] var_values_; }
+
+  virtual ~CorrectionCuts() = default;
 //  /**
 //   * @brief Adds a cut to the manager.
 //   * @param cut pointer to the cut.
 //   */
-  void AddCut(const CorrectionCut::CallBack &callback) {
-    cuts_.emplace_back(callback);
+  void AddCut(const CorrectionCut::CallBack &callback, const std::string &signature = {}) {
+    cuts_.emplace_back(callback, signature);
+  }
+
+  /**
+   * Checks if the cuts select the same entries as other cuts. This is the case if both have the same identified cuts
+   * in the same order. Cuts without signature are never equivalent.
+   * @param other other cuts
+   * @return true if equivalent
+   */
+  bool IsEquivalent(const CorrectionCuts &other) const {
+    if (cuts_.size()!=other.cuts_.size()) return false;
+    for (std::size_t i = 0; i < cuts_.size(); ++i) {
+      const auto &signature = cuts_[i].GetSignature();
+      if (signature.empty() || signature!=other.cuts_[i].GetSignature()) return false;
+    }
+    return true;
+  }
+
+  /**
+   * Writes the cuts for the key of the calibration cache. A cut is written as its signature or, if it has none, as
+   * the description of the cut. To be called after Initialize.
+   * @param stream the output stream
+   */
+  void WriteConfiguration(std::ostream &stream) const {
+    for (const auto &cut : cuts_) {
+      if (cut.GetSignature().empty()) {
+        stream << "cut:" << cut.Name() << '\n';
+      } else {
+        stream << cut.GetSignature() << '\n';
+      }
+    }
   }
 
   void Initialize(const Qn::InputVariableManager &var) {
@@ -116,39 +164,119 @@ class CorrectionCuts {
   /**
    * Checks if the current variables pass the cuts
    * Creates entries in the cut report
+   * The cuts are evaluated in the order they were added until the first failing cut.
    * @param i offset of the variable in case it has a length longer than 1
    * @return Returns true if the cut was passed.
    */
   inline bool CheckCuts(std::size_t i) {
-    int icut = 1;
     if (cuts_.empty()) return true;
-    ++*((cut_weight_).begin() + i);
-    bool passed = true;
+    Count(i);
+    std::size_t icut = 1;
     for (auto &cut : cuts_) {
-      bool ipass = cut.Check(i) && passed;
-      if (ipass) {
-        ++*cut_weight_.at(i + n_channels_*icut);
-      }
-      passed = ipass;
+      if (!cut.Check(i)) return false;
+      Count(i + n_channels_*icut);
+      ++icut;
+    }
+    return true;
+  }
+
+  /**
+   * Checks the cuts for all entries of the variables at once.
+   * Creates entries in the cut report
+   * The cuts are evaluated one after the other over the entries which passed the previous cuts.
+   * @param n number of entries
+   * @param passed set to one for the entries passing all cuts and to zero otherwise. Resized to n.
+   * @return number of entries passing the cuts
+   */
+  std::size_t CheckCuts(std::size_t n, std::vector<unsigned char> &passed) {
+    if (cuts_.empty()) {
+      passed.assign(n, 1);
+      return n;
+    }
+    selected_.resize(n);
+    for (std::size_t i = 0; i < n; ++i) selected_[i] = i;
+    for (std::size_t i = 0; i < n; ++i) Count(i);
+    std::size_t n_selected = n;
+    std::size_t icut = 1;
+    for (auto &cut : cuts_) {
+      n_selected = cut.Select(selected_.data(), n_selected);
+      const auto offset = n_channels_*icut;
+      for (std::size_t k = 0; k < n_selected; ++k) Count(offset + selected_[k]);
       ++icut;
     }
-    return passed;
+    passed.assign(n, 0);
+    for (std::size_t k = 0; k < n_selected; ++k) passed[selected_[k]] = 1;
+    return n_selected;
   }
 
   /**
-   * @brief Fills the cut report.
+   * @brief Accumulates the counts of the current event for the cut report.
+   * Only the counters touched in the event are visited.
    */
   void FillReport() {
-    if (report_) {
-      report_->Fill();
-      // reset binvalues container before filling next event.
-      auto offset = n_channels_*(cuts_.size() + 1);
-      for (std::size_t i = 0; i < n_channels_; ++i) {
-        for (std::size_t j = 0; j < (cuts_.size() + 1); ++j) {
-          var_values_[2*offset + i + n_channels_*j] = 0;
+    if (!report_) return;
+    for (const auto cell : touched_) {
+      const std::uint64_t count = event_counts_[cell];
+      counts_[cell] += count;
+      squared_counts_[cell] += count*count;
+      event_counts_[cell] = 0;
+    }
+    touched_.clear();
+    ++report_events_;
+  }
+
+  /**
+   * @brief Accumulates the counts of the current event of equivalent cuts for the cut report.
+   * Used if the cuts were only evaluated by the equivalent cuts. Their counts are kept, such that they need to be
+   * reported after this.
+   * @param evaluated the equivalent cuts, which were evaluated in the current event
+   */
+  void FillReport(const CorrectionCuts &evaluated) {
+    if (!report_ || evaluated.event_counts_.size()!=event_counts_.size()) return;
+    for (const auto cell : evaluated.touched_) {
+      const std::uint64_t count = evaluated.event_counts_[cell];
+      counts_[cell] += count;
+      squared_counts_[cell] += count*count;
+    }
+    ++report_events_;
+  }
+
+  /**
+   * @brief Writes the accumulated counts to the report histogram.
+   * The bin contents, the errors, the statistics and the number of entries are the ones of filling the counts of
+   * every event into the histogram. Needs to be called before the report is read or merged.
+   */
+  void UpdateReport() {
+    if (!report_ || report_events_==0) return;
+    if (report_->GetSumw2N()==0) report_->Sumw2();
+    const auto entries = report_->GetEntries();
+    const auto n_cuts = cuts_.size() + 1;
+    double squared_sum_correction = 0.;
+    for (std::size_t channel = 0; channel < n_channels_; ++channel) {
+      for (std::size_t cut = 0; cut < n_cuts; ++cut) {
+        const auto cell = channel + n_channels_*cut;
+        if (counts_[cell]==0) continue;
+        const auto count = static_cast<double>(counts_[cell]);
+        int bin;
+        if (n_channels_==1) {
+          bin = report_->Fill(cut, count);
+        } else {
+          bin = static_cast<TH2 *>(report_)->Fill(cut, channel, count);
         }
+        // the squared weights are the sums of the squared counts of the events.
+        const auto correction = static_cast<double>(squared_counts_[cell]) - count*count;
+        report_->GetSumw2()->AddAt(report_->GetSumw2()->At(bin) + correction, bin);
+        squared_sum_correction += correction;
+        counts_[cell] = 0;
+        squared_counts_[cell] = 0;
       }
     }
+    std::array<double, kNReportStats> stats{};
+    report_->GetStats(stats.data());
+    stats[1] += squared_sum_correction;
+    report_->PutStats(stats.data());
+    report_->SetEntries(entries + static_cast<double>(report_events_*n_cuts*n_channels_));
+    report_events_ = 0;
   }
 
   /**
@@ -159,21 +287,14 @@ class CorrectionCuts {
   void CreateCutReport(const std::string &report_name, std::size_t n_channels = 1) {
     if (!cuts_.empty()) {
       n_channels_ = n_channels;
-      auto offset = n_channels_*(cuts_.size() + 1);
-      cut_number = InputVariable(0, offset);
-      cut_channel_ = InputVariable(offset, offset);
-      cut_weight_ = InputVariable(2*offset, offset);
-      var_values_ = new double[3*offset];
-      cut_weight_.values_container_ = var_values_;
-      cut_number.values_container_ = var_values_;
-      cut_channel_.values_container_ = var_values_;
-      for (std::size_t i = 0; i < n_channels_; ++i) {
-        for (std::size_t j = 0; j < (cuts_.size() + 1); ++j) {
-          var_values_[i + n_channels_*j] = j;
-          var_values_[offset + i + n_channels_*j] = i;
-          var_values_[2*offset + i + n_channels_*j] = 0;
-        }
-      }
+      report_name_ = report_name;
+      const auto offset = n_channels_*(cuts_.size() + 1);
+      event_counts_.assign(offset, 0);
+      counts_.assign(offset, 0);
+      squared_counts_.assign(offset, 0);
+      touched_.clear();
+      touched_.reserve(offset);
+      report_events_ = 0;
       if (n_channels_==1) {
         std::string name = report_name + "Cut_Report";
         std::string title(";cuts;entries");
@@ -187,8 +308,7 @@ class CorrectionCuts {
           histo->GetXaxis()->SetBinLabel(icut, cut.Name().data());
           ++icut;
         }
-        std::array<InputVariable, 2> arr = {{cut_number, cut_weight_}};
-        report_ = std::make_unique<QAHisto1DPtr>(arr, histo);
+        report_ = histo;
       } else {
         std::string name = report_name + "Cut_Report";
         std::string title(";cuts;channels");
@@ -204,8 +324,7 @@ class CorrectionCuts {
           histo->GetXaxis()->SetBinLabel(icut, cut.Name().data());
           ++icut;
         }
-        std::array<InputVariable, 3> arr = {{cut_number, cut_channel_, cut_weight_}};
-        report_ = std::make_unique<QAHisto2DPtr>(arr, histo);
+        report_ = histo;
       }
     }
   }
@@ -216,17 +335,30 @@ class CorrectionCuts {
    * @param list list containing output histograms.
    */
   void AddToList(TList *list) {
-    if (report_) report_->AddToList(list);
+    if (report_) list->Add(report_);
   }
 
  private:
+  /**
+   * Counts an entry of a channel passing a cut in the current event.
+   * @param cell index of the counter of the channel and the cut
+   */
+  inline void Count(const std::size_t cell) {
+    if (event_counts_[cell]++==0) touched_.push_back(static_cast<std::uint32_t>(cell));
+  }
+
+  static constexpr std::size_t kNReportStats = 13; ///< size of the statistics of a histogram, see TH1::GetStats
+
   std::size_t n_channels_ = 0; /// number of channels is zero in case of no report
-  double *var_values_ = nullptr; /// pointer to the values which are filled to the histogram.
-  InputVariable cut_number; /// Variable of saving cut number
-  InputVariable cut_weight_; /// Variable saving a weight used for filling the cut histogram
-  InputVariable cut_channel_; /// Variable saving the channel number
+  std::vector<std::uint32_t> event_counts_; //!<! entries of each channel passing each cut in the current event
+  std::vector<std::uint32_t> touched_; //!<! counters of the current event, which are not zero
+  std::vector<std::uint64_t> counts_; //!<! accumulated entries, which are not yet written to the report
+  std::vector<std::uint64_t> squared_counts_; //!<! accumulated squares of the entries of the events
+  std::uint64_t report_events_ = 0; //!<! events, which are not yet written to the report
   std::vector<CorrectionCut> cuts_; /// vector of cuts which are applied
-  std::unique_ptr<Impl::QAHistoBase> report_; //!<! histogram of the cut report.
+  std::vector<unsigned int> selected_; //!<! entries passing the cuts evaluated so far
+  std::string report_name_; /// name of the cut report
+  TH1 *report_ = nullptr; //!<! histogram of the cut report, owned by the list it is added to.
 };
 
 namespace CallBacks {
@@ -247,6 +379,41 @@ CorrectionCut::CallBack MakeCut(const char *const (&names)[N], FUNCTION lambda,
     return MakeUniqueCut<const double>(arr, lambda, cut_description);
   }};
 }
+
+inline CorrectionCut::CallBack MakeRangeCut(const std::string &name,
+                                            double low,
+                                            double high,
+                                            const std::string &cut_description) {
+  return CorrectionCut::CallBack{[name, low, high, cut_description](const Qn::InputVariableManager &var) {
+    return std::make_unique<RangeCut<InputVariable>>(var.FindVariable(name), low, high, cut_description);
+  }};
+}
+
+/**
+ * Returns the signature of a cut created by MakeCut. Cut functions without state of the same type are the same
+ * function, such that their cuts select the same entries. Cut functions with state, e.g. lambdas with captures, are
+ * not identified.
+ * @return the signature. Empty if the cut function has a state.
+ */
+template<std::size_t N, typename FUNCTION>
+std::string CutSignature(const char *const (&names)[N], const FUNCTION &, const std::string &cut_description) {
+  if (!std::is_empty<FUNCTION>::value) return {};
+  std::string signature = std::string("function:") + typeid(FUNCTION).name();
+  for (auto i = 0u; i < N; ++i) signature += std::string("\n") + names[i];
+  return signature + "\n" + cut_description;
+}
+
+/**
+ * Returns the signature of a cut created by MakeRangeCut.
+ */
+inline std::string RangeCutSignature(const std::string &name,
+                                     double low,
+                                     double high,
+                                     const std::string &cut_description) {
+  std::ostringstream signature;
+  signature << "range:" << name << "\n" << std::hexfloat << low << "\n" << high << "\n" << cut_description;
+  return signature.str();
+}
 }
 
 }
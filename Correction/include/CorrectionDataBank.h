@@ -0,0 +1,125 @@
+#ifndef QN_DATABANK_H
+#define QN_DATABANK_H
+
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2018  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstddef>
+#include <vector>
+
+namespace Qn {
+/**
+ * @class CorrectionDataBank
+ * @brief Bank of the data vectors of a sub event.
+ * It allows to model data vectors of different detector types. Each field of the data vectors is stored in its own
+ * array, such that the Q vector building and the channel equalization only read the fields they need.
+ * The arrays are not released when the bank is cleared. They only grow when the multiplicity of an event exceeds
+ * the largest multiplicity seen so far, such that the bank does not allocate memory once it has reached it.
+ */
+class CorrectionDataBank {
+ public:
+  using size_type = std::size_t;
+
+  /**
+   * Adds a data vector to the bank.
+   * @param id id of the channel
+   * @param phi azimuthal angle of the channel or track
+   * @param weight weight applied to the channel or track
+   * @param radial_offset radial offset of the channel is only used for certain detector geometries.
+   */
+  void Add(int id, float phi, float weight, float radial_offset) {
+    if (size_==ids_.size()) Allocate(size_ < kInitialCapacity ? kInitialCapacity : 2*size_);
+    ids_[size_] = id;
+    phi_[size_] = phi;
+    radial_offsets_[size_] = radial_offset;
+    weights_[size_] = weight;
+    equalized_weights_[size_] = weight;
+    ++size_;
+  }
+
+  /**
+   * Reserves space for additional data vectors.
+   * @param n the number of data vectors to be added
+   */
+  void Reserve(size_type n) {
+    if (size_ + n > ids_.size()) Allocate(size_ + n);
+  }
+
+  /**
+   * Removes the data vectors. The memory is kept for the next event.
+   */
+  void Clear() { size_ = 0; }
+
+  size_type Size() const { return size_; }
+  bool Empty() const { return size_==0; }
+  /**
+   * Gets the number of data vectors the bank holds without allocating memory.
+   * @return the capacity
+   */
+  size_type Capacity() const { return ids_.size(); }
+
+  /**
+   * Gets the channel ids of the data vectors
+   * @return pointer to the first id
+   */
+  const int *Ids() const { return ids_.data(); }
+  /**
+   * Gets the azimuthal angles of the data vectors
+   * @return pointer to the first angle
+   */
+  const float *Phi() const { return phi_.data(); }
+  /**
+   * Gets the radial offsets of the data vectors
+   * @return pointer to the first radial offset
+   */
+  const float *RadialOffsets() const { return radial_offsets_.data(); }
+  /**
+   * Gets the raw weights of the data vectors
+   * @return pointer to the first weight
+   */
+  const float *Weights() const { return weights_.data(); }
+  /**
+   * Gets the equalized weights of the data vectors
+   * @return pointer to the first weight. Defaults to the raw weights.
+   */
+  const float *EqualizedWeights() const { return equalized_weights_.data(); }
+  /**
+   * Gets the equalized weights of the data vectors to be set by the channel equalization.
+   * @return pointer to the first weight
+   */
+  float *EqualizedWeights() { return equalized_weights_.data(); }
+
+ private:
+  static constexpr size_type kInitialCapacity = 4; ///< capacity of the first allocation
+
+  void Allocate(size_type capacity) {
+    ids_.resize(capacity);
+    phi_.resize(capacity);
+    radial_offsets_.resize(capacity);
+    weights_.resize(capacity);
+    equalized_weights_.resize(capacity);
+  }
+
+  size_type size_ = 0; ///< number of data vectors of the current event
+  std::vector<int> ids_; ///< the ids associated with the data vectors
+  std::vector<float> phi_; ///< the azimuthal angles of the data vectors
+  std::vector<float> radial_offsets_; ///< radial offsets of the channels represented by the data vectors
+  std::vector<float> weights_; ///< raw weights assigned to the data vectors
+  std::vector<float> equalized_weights_; ///< equalized weights assigned to the data vectors
+};
+}
+#endif /* QN_DATABANK_H */
@@ -0,0 +1,137 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLOW_CORRECTIONEVENTRECORDER_H
+#define FLOW_CORRECTIONEVENTRECORDER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CorrectionDataBank.h"
+
+namespace Qn {
+/**
+ * @class CorrectionEventRecorder
+ * @brief Records the input of the events, which passed the event cuts, for the replay in the following passes of
+ * the calibration.
+ * For every event the event variables and the data vectors of all sub events are recorded. The data vectors are
+ * kept in memory or spilled to a file, which is memory-mapped for the replay.
+ */
+class CorrectionEventRecorder {
+ public:
+  using size_type = std::size_t;
+  /**
+   * Recorded data vector with the raw weight.
+   */
+  struct DataVector {
+    int id;
+    float phi;
+    float weight;
+    float radial_offset;
+  };
+
+  /**
+   * Constructor
+   * @param spill_file_name name of the file to which the data vectors are spilled. Empty to keep them in memory.
+   */
+  explicit CorrectionEventRecorder(std::string spill_file_name = "") : spill_file_name_(std::move(spill_file_name)) {}
+  ~CorrectionEventRecorder();
+  CorrectionEventRecorder(const CorrectionEventRecorder &) = delete;
+  CorrectionEventRecorder &operator=(const CorrectionEventRecorder &) = delete;
+
+  /**
+   * Marks the start of a run at the current event.
+   * @param name name of the run
+   */
+  void AddRun(const std::string &name) { runs_.emplace_back(n_events_, name); }
+
+  /**
+   * Starts a new event. Discards the variables of an event, which has not been finished.
+   */
+  void BeginEvent() {
+    variables_.resize(n_events_*n_variables_);
+    sizes_.resize(n_events_*n_sizes_);
+  }
+
+  void AddVariable(const double value) { variables_.push_back(value); }
+
+  /**
+   * Records the data vectors of a sub event.
+   * @param bank data vector bank of the sub event
+   */
+  void AddDataVectors(const CorrectionDataBank &bank);
+
+  /**
+   * Finishes the event. All events need the same number of variables and sub events.
+   */
+  void EndEvent();
+
+  /**
+   * Finishes the recording. The remaining data vectors are spilled and the spill file is memory-mapped.
+   */
+  void Finish();
+
+  size_type GetNEvents() const { return n_events_; }
+
+  /**
+   * Replays the recorded events.
+   * @tparam RUN callable taking the name of a run, called at the start of each run.
+   * @tparam EVENT callable taking the variables, the number of data vectors of each sub event and the data vectors
+   * of an event.
+   * @param run_function function called at the start of each run
+   * @param event_function function called for each event
+   */
+  template<typename RUN, typename EVENT>
+  void ForEachEvent(RUN &&run_function, EVENT &&event_function) {
+    Finish();
+    auto run = runs_.begin();
+    const DataVector *data = GetData();
+    for (size_type ievent = 0; ievent < n_events_; ++ievent) {
+      while (run!=runs_.end() && run->first==ievent) {
+        run_function(run->second);
+        ++run;
+      }
+      const auto sizes = sizes_.data() + ievent*n_sizes_;
+      event_function(variables_.data() + ievent*n_variables_, sizes, data);
+      for (size_type i = 0; i < n_sizes_; ++i) data += sizes[i];
+    }
+  }
+
+ private:
+  static constexpr size_type kSpillBufferSize = 1 << 16; ///< number of data vectors written to the file at once
+  void Spill();
+  const DataVector *GetData() const { return mapped_ ? mapped_ : data_.data(); }
+
+  std::string spill_file_name_; ///< name of the spill file
+  std::FILE *spill_file_ = nullptr; ///< spill file during the recording
+  size_type n_spilled_ = 0; ///< number of data vectors in the spill file
+  const DataVector *mapped_ = nullptr; ///< memory-mapped data vectors of the spill file
+  bool finished_ = false; ///< recording is finished
+  size_type n_events_ = 0; ///< number of recorded events
+  size_type n_variables_ = 0; ///< number of variables per event
+  size_type n_sizes_ = 0; ///< number of sub events per event
+  std::vector<double> variables_; ///< variables of the events
+  std::vector<std::uint32_t> sizes_; ///< number of data vectors of each sub event of the events
+  std::vector<DataVector> data_; ///< data vectors, which are not spilled
+  std::vector<std::pair<size_type, std::string>> runs_; ///< first event and name of the runs
+};
+}
+
+#endif //FLOW_CORRECTIONEVENTRECORDER_H
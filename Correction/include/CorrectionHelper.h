@@ -0,0 +1,102 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_CORRECTION_INCLUDE_CORRECTIONHELPER_H_
+#define FLOW_CORRECTION_INCLUDE_CORRECTIONHELPER_H_
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ROOT/RDF/ActionHelpers.hxx"
+
+#include "CorrectionManager.h"
+
+namespace Qn {
+/**
+ * @class CorrectionHelper
+ * @brief RDataFrame action running the correction manager. Each slot of the data frame is processed by the
+ * correction manager of the slot. The histograms of the slots are merged at the end of the event loop.
+ * @tparam FUNCTION function filling an event into the correction manager of a slot. It is called with the manager
+ * and the columns. It sets the variables, calls ProcessEvent and fills the detectors.
+ * @tparam COLUMNS types of the columns
+ */
+template<typename FUNCTION, typename... COLUMNS>
+class CorrectionHelper : public ROOT::Detail::RDF::RActionImpl<CorrectionHelper<FUNCTION, COLUMNS...>> {
+ public:
+  using Result_t = Qn::CorrectionManager;
+ private:
+  std::shared_ptr<Result_t> manager_; //!<! initialized correction manager with one slot per thread
+  FUNCTION function_; //!<! function filling an event
+ public:
+  /**
+   * Constructor
+   * @param manager correction manager. Needs to be initialized with one slot per thread of the data frame.
+   * @param function function filling an event
+   */
+  CorrectionHelper(std::shared_ptr<Result_t> manager, FUNCTION function) :
+      manager_(std::move(manager)),
+      function_(std::move(function)) {
+    const auto n_slots = ROOT::IsImplicitMTEnabled() ? ROOT::GetImplicitMTPoolSize() : 1;
+    if (manager_->GetNumberOfSlots() < n_slots) {
+      throw std::logic_error("The correction manager needs one slot per thread of the data frame.");
+    }
+  }
+  CorrectionHelper(CorrectionHelper &&) = default;
+  CorrectionHelper(const CorrectionHelper &) = delete;
+
+  template<typename DATAFRAME>
+  ROOT::RDF::RResultPtr<Result_t> BookMe(DATAFRAME &df, const std::vector<std::string> &columns) {
+    return df.template Book<COLUMNS...>(std::move(*this), columns);
+  }
+
+  void InitTask(TTreeReader *, unsigned int) { /* noop */}
+
+  void Exec(unsigned int slot, const COLUMNS &... columns) {
+    auto &manager = manager_->GetSlot(slot);
+    manager.Reset();
+    function_(manager, columns...);
+    manager.ProcessCorrections();
+  }
+
+  void Initialize() { /* noop */}
+
+  void Finalize() { manager_->Finalize(); }
+
+  Result_t &PartialUpdate(unsigned int slot) { return manager_->GetSlot(slot); }
+
+  std::string GetActionName() { return "CorrectionManager"; }
+
+  std::shared_ptr<Result_t> GetResultPtr() const { return manager_; }
+};
+
+/**
+ * Creates the RDataFrame action running the correction manager.
+ * @tparam COLUMNS types of the columns
+ * @tparam FUNCTION function filling an event into the correction manager of a slot.
+ * @param manager initialized correction manager with one slot per thread of the data frame
+ * @param function function filling an event
+ * @return the action
+ */
+template<typename... COLUMNS, typename FUNCTION>
+CorrectionHelper<FUNCTION, COLUMNS...> MakeCorrectionHelper(std::shared_ptr<CorrectionManager> manager,
+                                                            FUNCTION function) {
+  return CorrectionHelper<FUNCTION, COLUMNS...>(std::move(manager), std::move(function));
+}
+}
+
+#endif //FLOW_CORRECTION_INCLUDE_CORRECTIONHELPER_H_
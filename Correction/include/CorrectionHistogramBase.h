@@ -5,7 +5,9 @@
 /// \brief Multidimensional profile histograms base class for the Q vector correction framework
 
 #include <THn.h>
+#include <THnSparse.h>
 #include "CorrectionAxisSet.h"
+#include "CorrectionSparseAccumulator.h"
 namespace Qn {
 /// \class QnCorrectionsHistogramBase
 /// \brief Base class for the Q vector correction histograms
@@ -56,9 +58,21 @@ class CorrectionHistogramBase {
 
  protected:
   void FillBinAxesValues(Int_t chgrpId = -1);
+  /// Gets the bin of the current event class
+  /// \return the linear bin number of the histograms with the event classes variables axes
+  Long64_t GetEventClassBin() const { return fEventClassVariables.GetBin(); }
+  Long64_t GetEventClassBin(const THnBase *histogram, Int_t chgrpId, Long64_t eventClassBin) const;
+  /// Gets the bin of the current event class and the passed channel or group
+  /// \param histogram histogram with the event classes variables axes and the channel or group axis
+  /// \param chgrpId the channel or group Id
+  /// \return the linear bin number
+  Long64_t GetEventClassBin(const THnBase *histogram, Int_t chgrpId) const {
+    return GetEventClassBin(histogram, chgrpId, GetEventClassBin());
+  }
   THnF *DivideTHnF(THnF *values, THnI *entries, THnC *valid = nullptr);
   void CopyTHnF(THnF *hDest, THnF *hSource, Int_t *binsArray);
   void CopyTHnFDimension(THnF *hDest, THnF *hSource, Int_t *binsArray, Int_t dimension);
+  void CopyToTHnSparse(THnSparse *hDest, const CorrectionSparseAccumulator &values, Double_t entries) const;
 
   std::string fName;
   std::string fTitle;
@@ -73,6 +87,7 @@ class CorrectionHistogramBase {
   static const char *szGroupAxisTitle;                   ///< The title for the channel group extra axis
   static const char *szGroupHistoPrefix;                 ///< The prefix for the name of the group histograms
   static const char *szEntriesHistoSuffix;               ///< The suffix for the name of the entries histograms
+  static const char *szDerivedListSuffix;                ///< The suffix for the name of the lists of the shared input histograms
   static const char *szXComponentSuffix;                 ///< The suffix for the name of X component histograms
   static const char *szYComponentSuffix;                 ///< The suffix for the name of Y component histograms
   static const char *szXXCorrelationComponentSuffix;     ///< The suffix for the name of XX correlation component histograms
@@ -105,5 +120,23 @@ inline void CorrectionHistogramBase::FillBinAxesValues(Int_t chgrpId) {
   fBinAxesValues[fEventClassVariables.GetSize()] = chgrpId;
 }
 
+/// Gets the bin of the passed event class and the passed channel or group
+///
+/// The channel or group axis is the last axis of the histogram, such that
+/// the bin of the event class is expanded by the bins of this axis.
+/// The histogram is not modified, such that histograms, which are shared
+/// between threads, can be looked up concurrently.
+///
+/// \param histogram histogram with the event classes variables axes and the channel or group axis
+/// \param chgrpId the channel or group Id
+/// \param eventClassBin the linear event class bin
+/// \return the linear bin number
+inline Long64_t CorrectionHistogramBase::GetEventClassBin(const THnBase *histogram,
+                                                          Int_t chgrpId,
+                                                          Long64_t eventClassBin) const {
+  const auto axis = histogram->GetAxis(fEventClassVariables.GetSize());
+  return eventClassBin*(axis->GetNbins() + 2) + axis->FindFixBin(chgrpId);
+}
+
 }
 #endif
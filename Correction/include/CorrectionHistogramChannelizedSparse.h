@@ -28,6 +28,10 @@ namespace Qn {
 /// by the detector configuration that is associated to the histogram
 /// and as such by the own histogram (this is a ROOT bug).
 ///
+/// The values are accumulated in a hash table keyed by the linear event
+/// class and channel bin and copied into the sparse histogram by
+/// UpdateHistograms.
+///
 /// \author Jaap Onderwaater <jacobus.onderwaater@cern.ch>, GSI
 /// \author Ilya Selyuzhenkov <ilya.selyuzhenkov@gmail.com>, GSI
 /// \author Víctor González <victor.gonzalez@cern.ch>, UCM
@@ -49,8 +53,12 @@ class CorrectionHistogramChannelizedSparse : public CorrectionHistogramBase {
   Float_t GetBinContent(Long64_t bin);
   Float_t GetBinError(Long64_t bin);
   void Fill(Int_t nChannel, Float_t weight);
+  void UpdateHistograms();
  private:
   THnSparseF *fValues = nullptr;              //!<! Cumulates values for each of the event classes
+  CorrectionSparseAccumulator fAccumulator; //!<! Accumulated values of the filled event classes and channels
+  Double_t fEntries = 0.; //!<! Number of entries
+  Bool_t fModified = kFALSE; //!<! The accumulated values are not yet copied into the histogram
   Bool_t *fUsedChannel = nullptr;       //!<! array, which of the detector channels is used for this configuration
   Int_t fNoOfChannels = 0;        //!<! The number of channels associated to the whole detector
   Int_t fActualNoOfChannels = 0;  //!<! The actual number of channels handled by the histogram
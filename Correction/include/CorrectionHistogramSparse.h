@@ -19,6 +19,9 @@ namespace Qn {
 /// and included in a provided list. They are not destroyed because
 /// the are not own by the class but by the involved list.
 ///
+/// The values are accumulated in a hash table keyed by the linear event
+/// class bin and copied into the sparse histogram by UpdateHistograms.
+///
 /// \author Jaap Onderwaater <jacobus.onderwaater@cern.ch>, GSI
 /// \author Ilya Selyuzhenkov <ilya.selyuzhenkov@gmail.com>, GSI
 /// \author Víctor González <victor.gonzalez@cern.ch>, UCM
@@ -35,8 +38,12 @@ class CorrectionHistogramSparse : public CorrectionHistogramBase {
   Float_t GetBinContent(Long64_t bin);
   Float_t GetBinError(Long64_t bin);
   virtual void Fill(Float_t weight);
+  void UpdateHistograms();
  private:
   THnSparseF *fValues = nullptr; //!<! Cumulates values for each of the event classes
+  CorrectionSparseAccumulator fAccumulator; //!<! Accumulated values of the filled event classes
+  Double_t fEntries = 0.; //!<! Number of entries
+  Bool_t fModified = kFALSE; //!<! The accumulated values are not yet copied into the histogram
   /// \cond CLASSIMP
  ClassDef(CorrectionHistogramSparse, 1);
   /// \endcond
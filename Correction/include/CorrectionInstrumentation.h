@@ -0,0 +1,176 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLOW_CORRECTIONINSTRUMENTATION_H
+#define FLOW_CORRECTIONINSTRUMENTATION_H
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "EventTrace.h"
+
+class TList;
+
+namespace Qn {
+/**
+ * @class CorrectionInstrumentation
+ * @brief Accumulates the processing time and the counts of the stages of the event processing.
+ * Each counter holds the time spent in a stage, the number of times the stage was timed and a number of processed
+ * entries, e.g. events passing the cuts, data vectors or touched bins. The counters are added before the event loop,
+ * such that different counters are updated concurrently by the detectors processed in parallel.
+ * With a trace the timed stages of the sampled events are also recorded in the timeline of the trace.
+ */
+class CorrectionInstrumentation {
+ public:
+  /**
+   * @class ScopedTimer
+   * @brief Adds the time until the end of the scope to a counter. Does nothing without an instrumentation, such
+   * that the timers cost a single branch when the instrumentation is disabled.
+   */
+  class ScopedTimer {
+   public:
+    /**
+     * Constructor. Starts the timer.
+     * @param instrumentation non-owning pointer to the instrumentation. The timer is disabled if nullptr.
+     * @param counter id of the counter
+     */
+    ScopedTimer(CorrectionInstrumentation *instrumentation, std::size_t counter) :
+        instrumentation_(instrumentation), counter_(counter) {
+      if (instrumentation_) start_ = std::chrono::steady_clock::now();
+    }
+    ~ScopedTimer() {
+      if (!instrumentation_) return;
+      const auto end = std::chrono::steady_clock::now();
+      instrumentation_->AddTime(counter_, end - start_);
+      if (instrumentation_->traced_) instrumentation_->Trace(counter_, start_, end);
+    }
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+   private:
+    CorrectionInstrumentation *instrumentation_; ///< instrumentation. nullptr if disabled.
+    std::size_t counter_; ///< id of the counter
+    std::chrono::steady_clock::time_point start_; ///< start of the timer
+  };
+
+  /**
+   * Adds a counter. Counters with the same name are only added once.
+   * @param name name of the counter
+   * @return id of the counter
+   */
+  std::size_t AddCounter(const std::string &name);
+
+  /**
+   * Adds a measured time to a counter.
+   * @param counter id of the counter
+   * @param time measured time
+   */
+  void AddTime(std::size_t counter, std::chrono::steady_clock::duration time) {
+    counters_[counter].time += time;
+    ++counters_[counter].calls;
+  }
+
+  /**
+   * Adds processed entries to a counter.
+   * @param counter id of the counter
+   * @param n number of entries
+   */
+  void AddEntries(std::size_t counter, long long n) { counters_[counter].entries += n; }
+
+  /**
+   * Records the timed stages in a trace. The names of the stages are the names of the counters.
+   * @param trace the trace shared with other instrumentations, e.g. of the other slots. Disabled if nullptr.
+   */
+  void SetTrace(std::shared_ptr<EventTrace> trace);
+
+  /**
+   * Returns the trace. nullptr if the stages are not traced.
+   */
+  const std::shared_ptr<EventTrace> &GetTrace() const { return trace_; }
+
+  /**
+   * Starts the timing of an event. The stages of the event are traced, if the event is sampled by the trace.
+   */
+  void BeginEvent() {
+    traced_ = trace_ && trace_->IsSampled(events_++);
+    event_start_ = std::chrono::steady_clock::now();
+    in_event_ = true;
+  }
+
+  /**
+   * Adds the time since BeginEvent to a counter. Does nothing if no event was started.
+   * @param counter id of the counter
+   */
+  void EndEvent(std::size_t counter) {
+    if (!in_event_) return;
+    in_event_ = false;
+    const auto end = std::chrono::steady_clock::now();
+    AddTime(counter, end - event_start_);
+    if (traced_) Trace(counter, event_start_, end);
+  }
+
+  /**
+   * Traces the following stages independent of the sampling until the next event, e.g. the run switch.
+   */
+  void TraceStages() { traced_ = trace_!=nullptr; }
+
+  /**
+   * Adds the counters of another instrumentation, e.g. of another slot, to the counters with the same names.
+   * @param other the other instrumentation
+   */
+  void Merge(const CorrectionInstrumentation &other);
+
+  /**
+   * Prints the counters.
+   * @param stream the output stream
+   */
+  void Report(std::ostream &stream) const;
+
+  /**
+   * Creates the histograms of the time in seconds, the calls and the entries of the counters. The bins are labeled
+   * with the names of the counters.
+   * @return the list "Instrumentation" owning the histograms.
+   */
+  TList *CreateHistogramList() const;
+
+ private:
+  struct Counter {
+    std::string name; ///< name of the counter
+    std::chrono::steady_clock::duration time{}; ///< accumulated time
+    long long calls = 0; ///< number of timed calls
+    long long entries = 0; ///< number of processed entries
+  };
+  void Trace(std::size_t counter, std::chrono::steady_clock::time_point begin,
+             std::chrono::steady_clock::time_point end) {
+    trace_->Record(trace_ids_[counter], begin, end);
+  }
+  std::vector<Counter> counters_; ///< the counters
+  std::map<std::string, std::size_t> ids_; ///< ids of the counters by name
+  std::shared_ptr<EventTrace> trace_; ///< timeline of the stages. nullptr if disabled.
+  std::vector<std::size_t> trace_ids_; ///< ids of the names of the counters in the trace
+  bool traced_ = false; ///< the stages of the current event are traced
+  bool in_event_ = false; ///< an event is being timed
+  unsigned long long events_ = 0; ///< number of started events
+  std::chrono::steady_clock::time_point event_start_; ///< start of the current event
+};
+}
+
+#endif //FLOW_CORRECTIONINSTRUMENTATION_H
@@ -18,13 +18,19 @@
 #ifndef FLOW_CORRECTIONMANAGER_H
 #define FLOW_CORRECTIONMANAGER_H
 
+#include <array>
+#include <ostream>
+#include <set>
 #include <string>
 #include <map>
+#include <functional>
+#include <stdexcept>
 
 #include "ROOT/RMakeUnique.hxx"
 #include "ROOT/RIntegerSequence.hxx"
 
 #include <utility>
+#include <vector>
 #include "Detector.h"
 #include "InputVariableManager.h"
 #include "Cuts.h"
@@ -41,6 +47,12 @@
 #include "DataContainer.h"
 #include "RunList.h"
 #include "DetectorList.h"
+#include "CorrectionEventRecorder.h"
+#include "CorrectionCalibrationFile.h"
+#include "CorrectionCalibrationCache.h"
+#include "CorrectionTreeWriter.h"
+#include "CorrectionInstrumentation.h"
+#include "EventLoopCheckpoint.h"
 
 namespace Qn {
 class CorrectionManager {
@@ -79,6 +91,25 @@ class CorrectionManager {
     detectors_.FindDetector(name).SetChannelScheme(channel_groups);
   }
 
+  /**
+   * @brief Configures a channel detector to receive only its fired channels with FillChannels.
+   * @param name name of the channel detector
+   */
+  void SetSparseChannelInput(const std::string &name) { detectors_.FindDetector(name).SetSparseInput(true); }
+
+  /**
+   * @brief Processes the Q vector correction steps of a detector with a chain composed at compile time instead of
+   * the list of correction steps. The steps of each sub event are processed in one function with statically bound
+   * calls. The chain needs to consist of the correction steps added to the detector in the order of their
+   * application, otherwise InitializeOnNode throws. The steps are processed one by one with the instrumentation.
+   * SetCorrectionChain("TPC", Qn::MakeCorrectionChain<Qn::Recentering, Qn::TwistAndRescale>());
+   * @param name name of the detector
+   * @param chain the correction chain
+   */
+  void SetCorrectionChain(const std::string &name, std::shared_ptr<const CorrectionChain> chain) {
+    detectors_.FindDetector(name).SetCorrectionChain(std::move(chain));
+  }
+
   /**
    * Adds a correction step based on the input data to the specified detector
    * @tparam CORRECTION
@@ -139,7 +170,29 @@ class CorrectionManager {
     bool is_channel_wise = variable_manager_.FindVariable(variable_names[0]).size() > 1;
     detectors_.AddCut(detector_name,
                       CallBacks::MakeCut(variable_names, cut_function, cut_description),
-                      is_channel_wise);
+                      is_channel_wise,
+                      CallBacks::CutSignature(variable_names, cut_function, cut_description));
+  }
+
+  /**
+   * @brief Adds a cut requiring a variable to be in the closed interval [low, high] to a detector.
+   * An equality cut is given by equal bounds. The cut is evaluated without calling a cut function.
+   * @param detector_name name of the detector
+   * @param variable_name name of the variable
+   * @param low lower bound
+   * @param high upper bound
+   * @param cut_description description of the cut in the cut report
+   */
+  void AddRangeCutOnDetector(const std::string &detector_name,
+                             const std::string &variable_name,
+                             double low,
+                             double high,
+                             const std::string &cut_description) {
+    bool is_channel_wise = variable_manager_.FindVariable(variable_name).size() > 1;
+    detectors_.AddCut(detector_name,
+                      CallBacks::MakeRangeCut(variable_name, low, high, cut_description),
+                      is_channel_wise,
+                      CallBacks::RangeCutSignature(variable_name, low, high, cut_description));
   }
 
   template<std::size_t N, typename FUNCTION>
@@ -201,19 +254,295 @@ class CorrectionManager {
       detector.SetOutputQVector(step);
     }
   }
+  /**
+   * Configures the output of the Q-vectors of the generic framework of a detector. They are filled with the
+   * uncorrected input data, see Detector::SetOutputQVectorGF.
+   * @param name name of the detector
+   * @param max_harmonic maximum harmonic
+   * @param max_power maximum power of the weights. Needs to be at least the number of particles of the correlations.
+   */
+  void SetOutputQVectorGF(const std::string &name, unsigned int max_harmonic, unsigned int max_power) {
+    detectors_.FindDetector(name).SetOutputQVectorGF(max_harmonic, max_power);
+  }
   void SetFillOutputTree(bool tree) { fill_output_tree_ = tree; }
+  /**
+   * @brief Processes the corrections of independent detectors of an event in parallel using ROOT's
+   * implicit multi-threading pool. Detectors referencing other detectors e.g. for the alignment are processed
+   * after them.
+   * @param parallel true to enable
+   */
+  void SetParallelCorrections(bool parallel) { detectors_.SetParallelCorrections(parallel); }
   void SetFillCalibrationQA(bool calibration) { fill_qa_histos_ = calibration; }
   void SetFillValidationQA(bool validation) { fill_validation_qa_histos_ = validation; }
+  /**
+   * @brief Fills the calibration QA histograms of the correction steps and Q vectors only in every Nth event.
+   * @param n_events sampling of the events passing the event cuts. Standard is every event (1).
+   */
+  void SetCalibrationQASampling(unsigned int n_events) {
+    detectors_.GetQASampling().SetSampling(CorrectionQASampling::Category::kCalibration, n_events);
+  }
+  /**
+   * @brief Fills the bin validation QA histograms only in every Nth event.
+   * @param n_events sampling of the events passing the event cuts. Standard is every event (1).
+   */
+  void SetValidationQASampling(unsigned int n_events) {
+    detectors_.GetQASampling().SetSampling(CorrectionQASampling::Category::kValidation, n_events);
+  }
+  /**
+   * @brief Fills the event QA histograms and the QA histograms of the detector input only in every Nth event.
+   * @param n_events sampling of the events passing the event cuts. Standard is every event (1).
+   */
+  void SetEventQASampling(unsigned int n_events) {
+    detectors_.GetQASampling().SetSampling(CorrectionQASampling::Category::kEvent, n_events);
+  }
   void SetCurrentRunName(const std::string &name);
   void SetCalibrationInputFileName(const std::string &file_name) { correction_input_file_name_ = file_name; }
   void SetCalibrationInputFile(TFile *file) { correction_input_file_.reset(file); }
+  /**
+   * @brief Reads the correction parameters from a binary calibration file written by WriteCalibrationFile instead
+   * of the calibration input histograms. The file is memory-mapped, such that only the parameters of the processed
+   * runs are loaded. Runs, which are not in the file, use the calibration input histograms if available.
+   * @param file_name name of the binary calibration file
+   */
+  void SetCalibrationFileName(const std::string &file_name) { calibration_file_name_ = file_name; }
+  /**
+   * @brief Exports the final correction parameters of all runs of the calibration input histograms to a binary
+   * calibration file. To be called after InitializeOnNode in a job dedicated to the conversion, as the correction
+   * steps are left in the state of the last run of the input.
+   * @param file_name name of the binary calibration file
+   */
+  void WriteCalibrationFile(const std::string &file_name);
+  /**
+   * @brief Reuses the calibration histograms of previous productions with the same configuration. The key of the
+   * cache is the hash of the effective configuration, i.e. the variables, the correction axes, the event cuts, the
+   * detectors with their cuts and correction steps, and the identifiers of the input data. The runs without
+   * calibration input take the histograms of the cache, such that a production, which was already calibrated with
+   * the same configuration, applies all corrections in the first pass. The calibration histograms of the runs, which
+   * are not yet fully calibrated, are stored in the cache at Finalize. To be called before InitializeOnNode.
+   * @param directory directory of the cache, which is shared by the productions
+   * @param dataset_ids identifiers of the input data, e.g. the names or checksums of the input files
+   */
+  void SetCalibrationCache(const std::string &directory, const std::vector<std::string> &dataset_ids = {}) {
+    calibration_cache_directory_ = directory;
+    calibration_cache_datasets_ = dataset_ids;
+  }
+  /**
+   * @brief Sets the runs in the order, in which they are processed. When switching to a run, the calibration
+   * histograms of the next run are read from the calibration cache in the background.
+   * @param runs names of the runs
+   */
+  void SetRunList(std::vector<std::string> runs) { runs_ = RunList(std::move(runs)); }
+  /**
+   * @brief Writes the effective configuration, from which the key of the calibration cache is computed.
+   * To be called after InitializeOnNode.
+   * @param stream the output stream
+   */
+  void WriteConfiguration(std::ostream &stream) const;
+  /**
+   * @brief Merges the calibration histograms of many jobs and uses them as the calibration input, replacing hadd
+   * between the passes. The input files are distributed over the threads. Each thread reads one file at a time and
+   * merges it into its own lists, such that only one input file per thread is kept in memory. The lists of the
+   * threads are merged at the end by run, sub event and correction step, with the histograms merged in parallel.
+   * Runs, which are only found in some of the files, are taken over. Followed by InitializeOnNode and
+   * WriteCalibrationFile, the merged parameters are written directly to the binary calibration file of the next pass.
+   * To be called before InitializeOnNode.
+   * @param file_names output files of the jobs containing the CorrectionHistograms and QA_histograms lists
+   * @param n_threads number of threads reading and merging the files
+   * @param merged_file_name if not empty, the merged calibration and QA histograms are also written to this file.
+   */
+  void MergeCalibrationInputs(const std::vector<std::string> &file_names,
+                              unsigned int n_threads,
+                              const std::string &merged_file_name = "");
+
+  /**
+   * @brief Records the input of the events passing the event cuts. The following passes of the calibration are
+   * replayed from the recording with ReplayRecordedEvents instead of reading the input data again.
+   * To be called before InitializeOnNode. The output tree is only filled in the pass, in which all corrections
+   * are applied.
+   * @param spill_file_name file to which the recorded data vectors are spilled and which is memory-mapped for the
+   * replay. The recording is kept in memory if empty. The file is removed with the correction manager.
+   */
+  void SetRecordEvents(const std::string &spill_file_name = "") {
+    if (!slots_.empty()) throw std::logic_error("The recording of the events is not available with multiple slots.");
+    recorder_ = std::make_unique<CorrectionEventRecorder>(spill_file_name);
+  }
+
+  /**
+   * @brief Replays the recorded events until all corrections are applied. Each pass uses the calibration
+   * histograms of the previous pass as input. To be called after Finalize of the recording pass.
+   * The lists of the calibration and QA histograms are replaced by the ones of the last pass.
+   * @param max_passes maximum number of replayed passes
+   * @return number of replayed passes
+   */
+  unsigned int ReplayRecordedEvents(unsigned int max_passes = 10);
+
+  /**
+   * @brief Enables the multithreaded processing of the events. Each slot is processed by its own correction
+   * manager, which fills its own calibration and QA histograms. The calibration input is read once and shared by
+   * all slots. The histograms of all slots are merged into the lists of this manager at Finalize.
+   * The first slot is processed by this manager. The managers of the other slots are configured with the passed
+   * function, which has to configure them in the same way as this manager.
+   * To be called before InitializeOnNode. Not available together with SetRecordEvents.
+   * @param n_slots number of slots
+   * @param configuration function configuring the correction manager of a slot
+   */
+  void SetNumberOfSlots(unsigned int n_slots, const std::function<void(CorrectionManager &)> &configuration);
+
+  /**
+   * @brief Input of a run processed with ProcessRuns.
+   */
+  struct RunInput {
+    std::string name; ///< name of the run
+    std::vector<std::string> files; ///< input files of the run
+  };
+
+  /**
+   * @brief Calibrates independent runs concurrently. Each run is processed by its own correction manager, which is
+   * configured with the passed function in the same way as this manager and shares its calibration input. The
+   * processing function runs the event loop over the files of the run after SetCurrentRunName, the manager is
+   * finalized afterwards. The calibration histograms of the runs are collected in the list of this manager in the
+   * order of the runs and the QA histograms of all runs are merged.
+   * Replaces SetCurrentRunName, the event loop and Finalize of this manager. To be called after InitializeOnNode.
+   * The output tree of this manager is not filled. Not available together with SetNumberOfSlots and SetRecordEvents.
+   * The configuration and processing functions are called concurrently by the threads.
+   * @param runs the runs with their input files. The names need to be unique.
+   * @param n_threads number of runs processed at the same time
+   * @param configuration function configuring the correction manager of a run
+   * @param processing function processing the events of a run
+   */
+  void ProcessRuns(const std::vector<RunInput> &runs,
+                   unsigned int n_threads,
+                   const std::function<void(CorrectionManager &)> &configuration,
+                   const std::function<void(CorrectionManager &, const RunInput &)> &processing);
+
+  /**
+   * @brief Returns the number of slots. One if the multithreaded processing is not enabled.
+   */
+  unsigned int GetNumberOfSlots() const { return slots_.size() + 1; }
+
+  /**
+   * @brief Returns the correction manager processing the events of a slot.
+   * @param slot slot
+   * @return this manager for the first slot
+   */
+  CorrectionManager &GetSlot(unsigned int slot) { return slot==0 ? *this : *slots_.at(slot - 1); }
+
+  /**
+   * @brief Writes the calibration and QA histograms of the slots to a checkpoint, from which a preempted job is
+   * resumed. The event loop announces each entry with checkpoint->Next(slot, entry) before it is processed and skips
+   * the entry, if Next returns false. The histograms of the previous jobs are merged at Finalize. To be called after
+   * SetNumberOfSlots and before the checkpoint is restored. Not available together with SetRecordEvents.
+   * @param checkpoint the checkpoint with at least as many slots as this manager
+   */
+  void SetCheckpoint(std::shared_ptr<EventLoopCheckpoint> checkpoint);
+
+  /**
+   * @brief Returns true if all correction steps are applied in the current pass.
+   */
+  bool IsCalibrated() { return detectors_.IsCalibrated(); }
+
+  /**
+   * @brief Returns true if the pass can end early, because all correction steps collecting data stopped with
+   * converged parameters. The convergence check is enabled for each correction step with SetConvergenceCheck. Passes
+   * filling the output tree need all events and never end early. The event loop may stop, if only the calibration
+   * histograms of the pass are needed. Checks the slots as well.
+   */
+  bool IsCollectionConverged() const {
+    if (output_tree_attached_ || !detectors_.IsCollectionConverged()) return false;
+    for (const auto &slot : slots_) {
+      if (!slot->IsCollectionConverged()) return false;
+    }
+    return true;
+  }
 
   /**
    * @brief Set output tree.
    * Lifetime of the tree is managed by the user.
    * @param tree non-owning pointer to the tree
    */
-  void ConnectOutputTree(TTree *tree) { if (fill_output_tree_) out_tree_ = tree; }
+  void ConnectOutputTree(TTree *tree) { if (fill_output_tree_) output_tree_.Connect(tree); }
+
+  /**
+   * @brief Writes the Q-vectors and the event variables to a RNTuple instead of a tree. The Q-vectors are written in
+   * the flat layout. All Q-vectors need to be available in the first run, as the fields cannot be extended after the
+   * first event. The RNTuple is written to the file at Finalize. Needs flow built with the CMake option FLOW_RNTUPLE.
+   * @param file non-owning pointer to the output file. Lifetime is managed by the user.
+   * @param name name of the RNTuple
+   */
+  void ConnectOutputNTuple(TFile *file, const std::string &name) {
+    if (fill_output_tree_) output_tree_.ConnectNTuple(file, name);
+  }
+
+  /**
+   * @brief Fills the output tree from a background thread. The output values of each event are copied into one of
+   * the buffers, which are written by the writer thread, while the event loop continues with the next event.
+   * The event loop waits when all buffers are in use. The tree must not be used until Finalize is called.
+   * To be called before InitializeOnNode.
+   * @param n_buffers number of buffered events. Two for double buffering. Synchronous filling if zero.
+   */
+  void SetAsynchronousOutput(unsigned int n_buffers = 2) { output_tree_.SetAsynchronous(n_buffers); }
+
+  /**
+   * @brief Writes the Q-vectors to the output tree as fixed size flat arrays instead of DataContainerQVector objects.
+   * Each Q-vector "<detector>_<STEP>" is written to the branches "<detector>_<STEP>_<field>" for the fields x, y, n,
+   * sumw and quality. The axes and harmonics are written once to the user info of the tree. They are read with a
+   * Correlation::FlatQVectorReader. To be called before InitializeOnNode.
+   * @param flat true to enable
+   */
+  void SetFlatOutputQVectors(bool flat) { output_tree_.SetFlatQVectors(flat); }
+
+  /**
+   * @brief Writes the flat Q-vectors with reduced precision, e.g. for intermediate files of the correlations.
+   * The components are either floats with a truncated mantissa or fixed-point numbers, and the quality bitmasks are
+   * packed. The encoding and its error bound are given by FlatQVectors::Encoding and written to the user info of the
+   * tree. Enables the flat layout. To be called before InitializeOnNode.
+   * Qn::FlatQVectors::Encoding::Truncated(10) or Qn::FlatQVectors::Encoding::FixedPoint(1.)
+   * @param encoding encoding of the components
+   */
+  void SetCompactOutputQVectors(const FlatQVectors::Encoding &encoding) { output_tree_.SetQVectorEncoding(encoding); }
+
+  /**
+   * @brief Configures the branches of the output tree. To be called before InitializeOnNode.
+   * @param basket_size size of the baskets in bytes
+   * @param compression_settings compression settings as in ROOT, e.g. 101 for zlib level 1. The settings of the file
+   * are used if negative.
+   */
+  void SetOutputBranchSettings(int basket_size, int compression_settings = -1) {
+    output_tree_.SetBasketSize(basket_size);
+    output_tree_.SetCompressionSettings(compression_settings);
+  }
+
+  /**
+   * @brief Measures the processing time and counts the entries of the stages of the event processing: the event
+   * cuts, the filling of the detectors, the corrections, the cut reports and the output at the manager level, the
+   * corrections, data vectors and touched sub events of each detector and the time of each correction step, as
+   * well as the whole events, the run switches and Finalize. The timers are not evaluated if disabled. The counters are printed by CreateReport and written as histograms to
+   * the list returned by GetInstrumentationList at Finalize. To be called before InitializeOnNode.
+   * @param enable true to enable
+   */
+  void SetInstrumentation(bool enable) {
+    instrumentation_ = enable ? std::make_unique<CorrectionInstrumentation>() : nullptr;
+    if (!instrumentation_) return;
+    for (auto name : kStageNames) instrumentation_->AddCounter(name);
+  }
+
+  /**
+   * @brief Get the list containing the histograms of the instrumentation. Available after Finalize.
+   * @return A pointer of the list. nullptr if the instrumentation is disabled.
+   */
+  TList *GetInstrumentationList() { return instrumentation_list_.get(); }
+
+  /**
+   * @brief Records the stages timed by the instrumentation in the timeline of a trace, which is written in the JSON
+   * trace event format after the event loop. The stages of one event in N are recorded as given by the sampling of
+   * the trace, the run switches and Finalize always. The slots share the trace and record to their own buffers.
+   * Enables the instrumentation. To be called before InitializeOnNode.
+   * @param trace the trace, which can be shared with a CorrelationHelper
+   */
+  void SetTrace(std::shared_ptr<EventTrace> trace) {
+    if (!instrumentation_) SetInstrumentation(true);
+    instrumentation_->SetTrace(std::move(trace));
+  }
 
   /**
    * @brief Initializes the correction framework
@@ -226,8 +555,73 @@ class CorrectionManager {
 
   double *GetVariableContainer() { return variable_manager_.GetVariableContainer(); }
 
-  inline void FillTrackingDetectors() { if (event_passed_cuts_) detectors_.FillTracking(); }
-  inline void FillChannelDetectors() { if (event_passed_cuts_) detectors_.FillChannel(); }
+  /**
+   * @brief Returns the Q-vectors of a correction step of a detector, which are updated with each processed event.
+   * Used to calculate correlations in the same event loop without the output tree, e.g. by a CorrelationStream.
+   * Available after the first call of SetCurrentRunName.
+   * @param name name of the Q-vectors as in the output tree, i.e. "<detector>_<STEP>"
+   * @return non-owning pointer to the Q-vectors
+   */
+  const DataContainerQVector *GetQVector(const std::string &name) const { return detectors_.FindQVector(name); }
+
+  inline void FillTrackingDetectors() {
+    if (!event_passed_cuts_) return;
+    CorrectionInstrumentation::ScopedTimer timer(instrumentation_.get(), kFillTracking);
+    detectors_.FillTracking();
+  }
+  /**
+   * @brief Fills all tracks of an event to the tracking detectors in one pass, instead of filling the variable
+   * container and calling FillTrackingDetectors for each track. The arrays are not copied and need to be valid
+   * during the call, e.g. the data of the columns of a RDataFrame:
+   * FillTracks(n, {{"phi", phi.data()}, {"pT", pt.data()}});
+   * Track variables without a column keep their value in the variable container for all tracks.
+   * @param n number of tracks
+   * @param columns name of a variable and the array of its values for all tracks
+   */
+  void FillTracks(std::size_t n, const std::vector<std::pair<std::string, const double *>> &columns);
+
+  /**
+   * @brief Events processed at once with ProcessEvents. The event and track variables are given as columns.
+   * The arrays are not copied and need to be valid during the call.
+   */
+  struct EventBatch {
+    std::size_t n_events = 0; ///< number of events
+    std::vector<std::pair<std::string, const double *>> event_columns; ///< values of event variables of all events
+    const std::size_t *track_offsets = nullptr; ///< first track of each event, followed by the number of all tracks
+    std::vector<std::pair<std::string, const double *>> track_columns; ///< values of track variables of all tracks
+  };
+
+  /**
+   * @brief Processes a batch of events, replacing Reset, ProcessEvent, FillTracks and ProcessCorrections for each
+   * event. The columns are looked up and the event class bins of all events are computed once for the batch, the
+   * events are then processed in their order, such that the results are the ones of the sequential processing.
+   * Variables without a column keep their value in the variable container for all events. Channel detectors are not
+   * filled.
+   * @param batch the events
+   * @param processed called with the position of each event in the batch after its corrections, e.g. to read the
+   * Q-vectors. Not called if empty.
+   */
+  void ProcessEvents(const EventBatch &batch, const std::function<void(std::size_t)> &processed = {});
+  inline void FillChannelDetectors() {
+    if (!event_passed_cuts_) return;
+    CorrectionInstrumentation::ScopedTimer timer(instrumentation_.get(), kFillChannel);
+    detectors_.FillChannel();
+  }
+  /**
+   * @brief Fills the fired channels of a channel detector with large channel count and low occupancy. Only the
+   * fired channels are evaluated by the cuts, the gain equalization and the Q-vector building, while the
+   * calibration histograms still cover all channels. The detector needs to be configured with
+   * SetSparseChannelInput, such that it is skipped by FillChannelDetectors.
+   * @param name name of the channel detector
+   * @param n number of fired channels
+   * @param channels ids of the fired channels
+   * @param amplitudes amplitudes of the fired channels used as weights
+   */
+  void FillChannels(const std::string &name, std::size_t n, const int *channels, const double *amplitudes) {
+    if (!event_passed_cuts_) return;
+    CorrectionInstrumentation::ScopedTimer timer(instrumentation_.get(), kFillChannel);
+    detectors_.FillChannels(name, n, channels, amplitudes);
+  }
 
   void ProcessCorrections();
   /**
@@ -242,6 +636,7 @@ class CorrectionManager {
 
   void CreateReport() {
     detectors_.CreateReport();
+    if (instrumentation_) instrumentation_->Report(std::cout);
   }
 
   /**
@@ -257,25 +652,69 @@ class CorrectionManager {
   TList *GetCorrectionQAList() { return correction_qa_histos_.get(); }
 
  private:
+  /**
+   * Stages of the event processing timed by the instrumentation. The position is the id of the counter.
+   */
+  enum Stage : std::size_t {
+    kEventCuts = 0, ///< event cuts and event QA. The entries are the events passing the cuts.
+    kFillTracking, ///< filling of the tracking detectors
+    kFillChannel, ///< filling of the channel detectors
+    kCorrections, ///< corrections of all detectors
+    kReport, ///< cut reports of the detectors
+    kOutput, ///< filling of the output tree
+    kEvent, ///< the whole event from ProcessEvent to ProcessCorrections
+    kRunSwitch, ///< switch to a new run
+    kFinalize, ///< Finalize
+  };
+  static constexpr std::array<const char *, 9> kStageNames =
+      {{"event_cuts", "fill_tracking", "fill_channel", "corrections", "report", "output", "event", "run_switch",
+        "finalize"}};
+  void ShareInstrumentation(CorrectionManager &manager) const;
+  bool PassEvent(const Long64_t *bin);
+  double *FindColumnVariable(const std::string &name) const;
   void InitializeCorrections();
   void AttachQAHistograms();
+  void ReattachQAHistograms();
+  void MergeSlots();
+  TList *MergeProcessedRun(CorrectionManager &run_manager, const std::string &name);
+  void RecordEvent();
+  void ReplayEvent(const double *variables, const std::uint32_t *sizes, const CorrectionEventRecorder::DataVector *data);
   static constexpr auto kCorrectionListName = "CorrectionHistograms";
   bool fill_qa_histos_ = true; ///< Flag for filling QA histograms
   bool fill_validation_qa_histos_ = true; ///< Flag for filling calibration bin validation histograms
   bool fill_output_tree_ = false; ///< Flag for filling the output tree
   bool event_passed_cuts_ = false; ///< variable holding status if an event passed the cuts.
+  bool output_tree_attached_ = false; //!<! the output tree is attached
+  bool replaying_ = false; //!<! recorded events are replayed
   RunList runs_; ///< list of processed runs
   DetectorList detectors_; ///< list of detectors
   InputVariableManager variable_manager_; ///< manager of the variables
   std::string correction_input_file_name_; ///< name of the calibration input file
-  std::unique_ptr<TList> correction_input_;      //!<! the list of the input calibration histograms
+  std::shared_ptr<TList> correction_input_;      //!<! the list of the input calibration histograms
   std::unique_ptr<TList> correction_output;      //!<! the list of the support histograms
   std::unique_ptr<TList> correction_qa_histos_;  //!<! the list of QA histograms
   std::unique_ptr<TFile> correction_input_file_; //!<! input calibration file
+  std::string calibration_file_name_; ///< name of the binary calibration file
+  std::shared_ptr<CorrectionCalibrationFile> calibration_file_; //!<! memory-mapped binary calibration file
+  std::string calibration_cache_directory_; ///< directory of the calibration cache
+  std::vector<std::string> calibration_cache_datasets_; ///< identifiers of the input data of the calibration cache
+  std::shared_ptr<CorrectionCalibrationCache> calibration_cache_; //!<! calibration cache shared by the slots
+  std::set<std::string> calibrated_runs_; //!<! runs, in which all corrections are applied from the start
   CorrectionAxisSet correction_axes_; /// CorrectionCalculator correction axes
   CorrectionCuts event_cuts_; ///< Pointer to the event cuts
   QAHistograms event_histograms_; ///< event QA histograms
-  TTree *out_tree_ = nullptr;  //!<! Tree of Qn Vectors and event variables. Lifetime is managed by the user.
+  CorrectionTreeWriter output_tree_;  //!<! writer of the tree of Qn Vectors and event variables.
+  std::unique_ptr<CorrectionEventRecorder> recorder_; //!<! recorder of the events for the replay
+  std::unique_ptr<DetectorList> detector_configuration_; //!<! copy of the configured detectors for the replay
+  std::vector<unsigned int> recorded_output_ids_; //!<! positions of the recorded output variables
+  std::vector<unsigned int> recorded_axis_ids_; //!<! positions of the recorded correction axis variables
+  std::vector<std::unique_ptr<CorrectionManager>> slots_; //!<! correction managers of the other slots
+  Detector::TrackColumns track_columns_; //!<! columns of the track variables of the current event
+  std::vector<Long64_t> batch_bins_; //!<! event class bins of the events of a batch
+  std::vector<double> batch_values_; //!<! values of the event class variables without a column in a batch
+  std::unique_ptr<CorrectionInstrumentation> instrumentation_; //!<! times the stages if not nullptr
+  std::unique_ptr<TList> instrumentation_list_; //!<! histograms of the instrumentation
+  std::shared_ptr<EventLoopCheckpoint> checkpoint_; //!<! checkpoint of the histograms of the slots
  /// \cond CLASSIMP
  ClassDef(CorrectionManager, 1);
  /// \endcond
@@ -15,6 +15,8 @@
 /// \brief Correction steps on Qn vectors support within Q vector correction framework
 ///
 #include <map>
+#include <string>
+#include <vector>
 #include "TList.h"
 #include "TObject.h"
 #include "QVector.h"
@@ -42,10 +44,27 @@ class CorrectionOnQnVector : public CorrectionBase {
   CorrectionOnQnVector(const CorrectionOnQnVector &other) :
       CorrectionBase(other),
       fCorrectedQnVector(),
-      fInputQnVector(nullptr) {
+      fInputQnVector(nullptr),
+      fHarmonics(other.fHarmonics) {
   }
   virtual CorrectionOnQnVector *MakeCopy() const { return new CorrectionOnQnVector(*this); }
 
+  /// Gets the names of the detectors, whose current Qn vectors are used by the correction step
+  /// \return the names of the referenced detectors
+  virtual std::vector<std::string> GetReferencedDetectors() const { return {}; }
+  /// Gets the harmonics the correction step reads from its input Qn vector
+  /// in addition to the ones it provides
+  /// \return the additional harmonics
+  virtual std::bitset<QVector::kmaxharmonics> GetRequiredInputHarmonics() const { return {}; }
+  /// Gets the harmonics the correction step reads from the current Qn vectors of the referenced detectors
+  /// \return the harmonics needed from the referenced detectors
+  virtual std::bitset<QVector::kmaxharmonics> GetRequiredReferenceHarmonics() const { return {}; }
+  /// Sets the harmonics the correction step provides to the following correction steps and to the output
+  ///
+  /// The other harmonics of the input Qn vector are not corrected.
+  /// \param harmonics the provided harmonics
+  void SetHarmonics(std::bitset<QVector::kmaxharmonics> harmonics) { fHarmonics = harmonics; }
+
   /// Gets the corrected Qn vector
   /// \return the corrected Qn vector
   const QVector *GetCorrectedQnVector() const { return fCorrectedQnVector.get(); }
@@ -89,8 +108,21 @@ class CorrectionOnQnVector : public CorrectionBase {
     steps.push_back(fCorrectedQnVector->GetCorrectionStep());
   }
  protected:
+  /// Gets the harmonics provided by the correction step
+  /// \return the set harmonics or, if they are not set, the harmonics of the input Qn vector
+  std::bitset<QVector::kmaxharmonics> GetHarmonics() const {
+    return fHarmonics.any() ? fHarmonics : fInputQnVector->GetHarmonics();
+  }
+  /// Gets the harmonic numbers of the corrected Qn vector
+  /// \return the harmonic numbers
+  std::vector<int> GetCorrectedHarmonicMap() const {
+    std::vector<int> harmonics(fCorrectedQnVector->GetNoOfHarmonics());
+    fCorrectedQnVector->GetHarmonicsMap(harmonics.data());
+    return harmonics;
+  }
   std::unique_ptr<QVector> fCorrectedQnVector; //!<! the step corrected Qn vector
   const QVector *fInputQnVector = nullptr; //!<! the previous step corrected Qn vector
+  std::bitset<QVector::kmaxharmonics> fHarmonics; //!<! the harmonics provided by the correction step
 /// \cond CLASSIMP
  ClassDef(CorrectionOnQnVector, 2);
 /// \endcond
@@ -0,0 +1,171 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLOW_CORRECTIONPARAMETERTABLE_H
+#define FLOW_CORRECTIONPARAMETERTABLE_H
+
+#include <algorithm>
+#include <vector>
+
+namespace Qn {
+/**
+ * @class CorrectionParameterTable
+ * @brief Final parameters of a correction step for each event class bin.
+ * The table is filled from the input profiles when they are attached, such that applying the correction only needs
+ * the lookup of the parameters. The parameters are stored for a set of keys, e.g. harmonics or channels. The
+ * parameters of all keys of a bin are contiguous. Each key of a bin carries a validation flag.
+ * Alternatively the table refers to the parameters of a memory-mapped calibration file, which are read only.
+ */
+class CorrectionParameterTable {
+ public:
+  CorrectionParameterTable() = default;
+  CorrectionParameterTable(const CorrectionParameterTable &other) { *this = other; }
+  CorrectionParameterTable(CorrectionParameterTable &&) = default;
+  CorrectionParameterTable &operator=(CorrectionParameterTable &&) = default;
+  CorrectionParameterTable &operator=(const CorrectionParameterTable &other) {
+    if (this==&other) return *this;
+    n_bins_ = other.n_bins_;
+    n_entries_ = other.n_entries_;
+    n_parameters_ = other.n_parameters_;
+    keys_ = other.keys_;
+    index_ = other.index_;
+    validated_ = other.validated_;
+    parameters_ = other.parameters_;
+    const bool owned = other.validated_data_==other.validated_.data();
+    validated_data_ = owned ? validated_.data() : other.validated_data_;
+    parameters_data_ = owned ? parameters_.data() : other.parameters_data_;
+    return *this;
+  }
+
+  /**
+   * Allocates the table. All entries are not validated and their parameters are zero.
+   * @param n_bins number of event class bins
+   * @param keys keys of the entries of a bin, e.g. the harmonics
+   * @param n_parameters number of parameters of each entry
+   */
+  void Initialize(long long n_bins, const std::vector<int> &keys, int n_parameters) {
+    SetLayout(n_bins, keys, n_parameters);
+    validated_.assign(n_bins*n_entries_, 0);
+    parameters_.assign(n_bins*n_entries_*n_parameters_, 0.);
+    validated_data_ = validated_.data();
+    parameters_data_ = parameters_.data();
+  }
+
+  /**
+   * Refers the table to parameters stored elsewhere, e.g. in a memory-mapped file. The parameters are not copied
+   * and need to outlive the table.
+   * @param n_bins number of event class bins
+   * @param keys keys of the entries of a bin
+   * @param n_parameters number of parameters of each entry
+   * @param validated n_bins*keys.size() validation flags
+   * @param parameters n_bins*keys.size()*n_parameters parameters
+   */
+  void Map(long long n_bins, const std::vector<int> &keys, int n_parameters,
+           const unsigned char *validated, const double *parameters) {
+    SetLayout(n_bins, keys, n_parameters);
+    validated_.clear();
+    parameters_.clear();
+    validated_data_ = validated;
+    parameters_data_ = parameters;
+  }
+
+  /**
+   * Releases the table.
+   */
+  void Clear() {
+    n_bins_ = 0;
+    keys_.clear();
+    index_.clear();
+    validated_.clear();
+    parameters_.clear();
+    validated_data_ = nullptr;
+    parameters_data_ = nullptr;
+  }
+
+  bool IsInitialized() const { return validated_data_!=nullptr; }
+
+  /**
+   * Checks if the table has the layout expected by a correction step.
+   * @param n_bins number of event class bins
+   * @param keys keys of the entries of a bin
+   * @param n_parameters number of parameters of each entry
+   * @return true if the table has parameters of all keys for all bins
+   */
+  bool Matches(long long n_bins, const std::vector<int> &keys, int n_parameters) const {
+    return IsInitialized() && n_bins==n_bins_ && n_parameters==n_parameters_
+        && std::all_of(keys.begin(), keys.end(), [this](int key) { return HasKey(key); });
+  }
+
+  /**
+   * Checks if the table contains parameters for a key.
+   * @param key the key
+   * @return true if the key is in the table
+   */
+  bool HasKey(int key) const { return key >= 0 && key < static_cast<int>(index_.size()) && index_[key] >= 0; }
+
+  bool IsValidated(long long bin, int key) const { return validated_data_[Index(bin, key)]!=0; }
+  void SetValidated(long long bin, int key, bool validated) { validated_[Index(bin, key)] = validated; }
+
+  /**
+   * Returns the parameters of an entry.
+   * @param bin event class bin
+   * @param key the key of the entry
+   * @return pointer to the n_parameters parameters of the entry
+   */
+  const double *GetParameters(long long bin, int key) const {
+    return parameters_data_ + Index(bin, key)*n_parameters_;
+  }
+
+  /**
+   * Returns the parameters of an entry for filling the table. Only available for tables, which are initialized.
+   * @param bin event class bin
+   * @param key the key of the entry
+   * @return pointer to the n_parameters parameters of the entry
+   */
+  double *EditParameters(long long bin, int key) { return parameters_.data() + Index(bin, key)*n_parameters_; }
+
+  long long GetNumberOfBins() const { return n_bins_; }
+  int GetNumberOfParameters() const { return n_parameters_; }
+  const std::vector<int> &GetKeys() const { return keys_; }
+  const unsigned char *GetValidatedData() const { return validated_data_; }
+  const double *GetParameterData() const { return parameters_data_; }
+
+ private:
+  std::size_t Index(long long bin, int key) const { return bin*n_entries_ + index_[key]; }
+
+  void SetLayout(long long n_bins, const std::vector<int> &keys, int n_parameters) {
+    n_bins_ = n_bins;
+    n_parameters_ = n_parameters;
+    n_entries_ = static_cast<int>(keys.size());
+    keys_ = keys;
+    index_.assign(keys.empty() ? 0 : *std::max_element(keys.begin(), keys.end()) + 1, -1);
+    for (std::size_t i = 0; i < keys.size(); ++i) index_[keys[i]] = static_cast<int>(i);
+  }
+
+  long long n_bins_ = 0; ///< number of event class bins
+  int n_entries_ = 0; ///< number of entries of each bin
+  int n_parameters_ = 0; ///< number of parameters of each entry
+  std::vector<int> keys_; ///< keys of the entries of a bin
+  std::vector<int> index_; ///< index of the entry of each key. -1 if the key is not in the table
+  std::vector<unsigned char> validated_; ///< validation flag of each entry, if the table owns its parameters
+  std::vector<double> parameters_; ///< parameters of the entries, if the table owns its parameters
+  const unsigned char *validated_data_ = nullptr; ///< validation flags in use, owned or mapped
+  const double *parameters_data_ = nullptr; ///< parameters in use, owned or mapped
+};
+}
+
+#endif //FLOW_CORRECTIONPARAMETERTABLE_H
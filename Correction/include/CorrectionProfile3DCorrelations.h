@@ -4,6 +4,8 @@
 /// \file QnCorrectionsProfile3DCorrelations.h
 /// \brief Three detector correlation components based set of profiles with harmonic support for the Q vector correction framework
 
+#include <vector>
+
 #include "CorrectionHistogramBase.h"
 namespace Qn {
 class QVector;
@@ -39,6 +41,13 @@ class QVector;
 /// Only in the histograms name it appears the proper mxn harmonic to
 /// not confuse the external user which browse the histograms.
 ///
+/// The profiles are accumulated in a dense array ordered by
+/// [event class bin][combination][harmonic][XX, XY, YX, YY and their squares],
+/// such that one event updates a single contiguous slice of the array.
+/// The histograms are only used for the persistence: the attached
+/// histograms are converted into the array and the array is copied
+/// into the histograms by UpdateHistograms.
+///
 /// \author Jaap Onderwaater <jacobus.onderwaater@cern.ch>, GSI
 /// \author Ilya Selyuzhenkov <ilya.selyuzhenkov@gmail.com>, GSI
 /// \author Víctor González <victor.gonzalez@cern.ch>, UCM
@@ -79,12 +88,29 @@ class CorrectionProfile3DCorrelations : public CorrectionHistogramBase {
   virtual Float_t GetYYBinError(const char *comb, Int_t harmonic, Long64_t bin);
   void Fill(const QVector *QnA, const QVector *QnB,
             const QVector *QnC);
+  void UpdateHistograms();
  private:
+  /// Position of the XX component of a combination and harmonic in an event class bin within the dense array
+  /// \param ixComb the Qn vector combination
+  /// \param index the compact index of the harmonic
+  /// \param bin the event class bin number
+  /// \return the position within the array
+  std::size_t DataIndex(Int_t ixComb, Int_t index, Long64_t bin) const {
+    return ((bin*3 + ixComb)*fNHarmonics + index)*8;
+  }
+  void AllocateData(UInt_t harmonicMask);
+  void ReadHistograms();
   THnF ***fXXValues = nullptr;            //!<! XX component histogram for each requested harmonic
   THnF ***fXYValues = nullptr;            //!<! XY component histogram for each requested harmonic
   THnF ***fYXValues = nullptr;            //!<! YX component histogram for each requested harmonic
   THnF ***fYYValues = nullptr;            //!<! YY component histogram for each requested harmonic
   THnI *fEntries = nullptr;             //!<! Cumulates the number on each of the event classes
+  Int_t fNHarmonics = 0;                //!<! number of harmonics stored in the dense array
+  std::vector<Int_t> fHarmonicIndex;    //!<! compact index of each external harmonic number, -1 if not present
+  std::vector<Double_t> fData;          //!<! correlation components and their squares of each event class
+  std::vector<Double_t> fEntriesData;   //!<! number of entries of each event class
+  std::vector<Double_t> fFills;         //!<! number of fills of each combination and harmonic. The histogram entries
+  Bool_t fModified = kFALSE;            //!<! the dense array changed since the last update of the histograms
   std::string fNameA;               ///< the name of the A detector
   std::string fNameB;               ///< the name of the B detector
   std::string fNameC;               ///< the name of the C detector
@@ -4,7 +4,10 @@
 /// \file QnCorrectionsProfileChannelized.h
 /// \brief Channelized profile class for the Q vector correction framework
 
+#include <vector>
+
 #include "CorrectionHistogramBase.h"
+#include "CorrectionDataBank.h"
 namespace Qn {
 /// \class QnCorrectionsProfileChannelized
 /// \brief Channelized profile class for the Q vector correction histograms
@@ -47,6 +50,12 @@ namespace Qn {
 ///          - \left(\frac{\Sigma \mbox{fValues(bin)}}{\mbox{fEntries(bin)}}\right)^2}
 /// \f]
 ///
+/// The profile is accumulated in a dense array ordered by
+/// [event class bin][channel][sum, sum of squares, entries], such that
+/// all channels of one event class are contiguous in memory. The
+/// histograms are only used for the persistence and are updated from
+/// the array by UpdateHistograms.
+///
 /// \author Jaap Onderwaater <jacobus.onderwaater@cern.ch>, GSI
 /// \author Ilya Selyuzhenkov <ilya.selyuzhenkov@gmail.com>, GSI
 /// \author Víctor González <victor.gonzalez@cern.ch>, UCM
@@ -71,7 +80,16 @@ class CorrectionProfileChannelized : public CorrectionHistogramBase {
   Float_t GetBinContent(Long64_t bin);
   Float_t GetBinError(Long64_t bin);
   void Fill(Int_t nChannel, Float_t weight);
+  void Fill(const CorrectionDataBank &bank);
+  void UpdateHistograms();
  private:
+  /// Position of a channel in an event class bin within the dense array
+  /// \param nChannel the external channel number
+  /// \param eventClassBin the event class bin number
+  /// \return the position within the array
+  std::size_t DataIndex(Int_t nChannel, Long64_t eventClassBin) const {
+    return (eventClassBin*fActualNoOfChannels + fChannelMap[nChannel])*3;
+  }
   THnF *fValues = nullptr;              //!<! Cumulates values for each of the event classes
   THnI *fEntries = nullptr;             //!<! Cumulates the number on each of the event classes
   Bool_t *fUsedChannel = nullptr;       //!<! array, which of the detector channels is used for this configuration
@@ -79,6 +97,9 @@ class CorrectionProfileChannelized : public CorrectionHistogramBase {
   Int_t fNoOfChannels = 0;        //!<! The number of channels associated to the whole detector
   Int_t fActualNoOfChannels = 0;  //!<! The actual number of channels handled by the histogram
   Int_t *fChannelMap = nullptr;         //!<! array, the map from histo to detector channel number
+  std::vector<Double_t> fData;          //!<! sum, sum of squares and entries of each channel in each event class
+  Double_t fFills = 0.;                 //!<! number of fills. The histogram entries
+  Bool_t fModified = kFALSE;            //!<! the dense array changed since the last update of the histograms
 
   /// \cond CLASSIMP
  ClassDef(CorrectionProfileChannelized, 1);
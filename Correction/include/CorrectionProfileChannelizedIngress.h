@@ -51,17 +51,19 @@ class CorrectionProfileChannelizedIngress : public CorrectionHistogramBase {
                                       ErrorMode mode);
   virtual ~CorrectionProfileChannelizedIngress();
   Bool_t AttachHistograms(TList *histogramList, const Bool_t *bUsedChannel, const Int_t *nChannelGroup);
-  Long64_t GetBin(Int_t nChannel);
-  Long64_t GetGrpBin(Int_t nChannel);
+  Long64_t GetBin(Int_t nChannel) { return GetBin(nChannel, GetEventClassBin()); }
+  Long64_t GetBin(Int_t nChannel, Long64_t eventClassBin);
+  Long64_t GetGrpBin(Int_t nChannel) { return GetGrpBin(nChannel, GetEventClassBin()); }
+  Long64_t GetGrpBin(Int_t nChannel, Long64_t eventClassBin);
   Bool_t BinContentValidated(Long64_t bin);
   Float_t GetBinContent(Long64_t bin);
   Float_t GetGrpBinContent(Long64_t bin);
   Float_t GetBinError(Long64_t bin);
   Float_t GetGrpBinError(Long64_t bin);
  private:
-  THnF *fValues = nullptr;              //!<! the values and errors on each event class and channel
-  THnF *fGroupValues = nullptr;         //!<! the values and errors on each event class and group
-  THnC *fValidated = nullptr;            //!<! bin content validated flag
+  THnF *fValues = nullptr;              //!<! the values and errors on each event class and channel. Owned by the input list.
+  THnF *fGroupValues = nullptr;         //!<! the values and errors on each event class and group. Owned by the input list.
+  THnC *fValidated = nullptr;            //!<! bin content validated flag. Owned by the input list.
   Bool_t *fUsedChannel = nullptr;       //!<! array, which of the detector channels are used for this configuration
   Int_t *fChannelGroup = nullptr;        //!<! array, the group to which the channel pertains
   Int_t fNoOfChannels = 0;        //!<! The number of channels associated to the whole detector
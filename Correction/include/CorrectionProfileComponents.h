@@ -4,7 +4,10 @@
 /// \file QnCorrectionsProfileComponents.h
 /// \brief Component based set of profiles for the Q vector correction framework
 
+#include <vector>
+
 #include "CorrectionHistogramBase.h"
+#include "QVector.h"
 namespace Qn {
 /// \class QnCorrectionsProfileComponents
 /// \brief Base class for the components based set of profiles
@@ -35,6 +38,13 @@ namespace Qn {
 /// component before the whole set is filled you will get an execution
 /// error because you are doing something that shall be corrected
 ///
+/// The profiles are accumulated in a dense array ordered by
+/// [event class bin][harmonic][X, Y, X^2, Y^2], such that the components
+/// of all harmonics of one event class are contiguous in memory.
+/// The histograms are only used for the persistence: the attached
+/// histograms are converted into the array and the array is copied
+/// into the histograms by UpdateHistograms.
+///
 /// \author Jaap Onderwaater <jacobus.onderwaater@cern.ch>, GSI
 /// \author Ilya Selyuzhenkov <ilya.selyuzhenkov@gmail.com>, GSI
 /// \author Víctor González <victor.gonzalez@cern.ch>, UCM
@@ -56,15 +66,32 @@ class CorrectionProfileComponents : public CorrectionHistogramBase {
   Float_t GetYBinContent(Int_t harmonic, Long64_t bin);
   Float_t GetXBinError(Int_t harmonic, Long64_t bin);
   Float_t GetYBinError(Int_t harmonic, Long64_t bin);
+  Bool_t GetMeans(std::vector<Double_t> &means, std::vector<Double_t> &widths) const;
+  Bool_t GetRunningMeans(Int_t harmonic, Long64_t bin, Int_t nMinEntries, Double_t *parameters) const;
   void FillX(Int_t harmonic, Float_t weight);
   void FillY(Int_t harmonic, Float_t weight);
+  void Fill(const QVector &qvector);
+  void UpdateHistograms();
  private:
+  /// Position of the X component of a harmonic in an event class bin within the dense array
+  /// \param index the compact index of the harmonic
+  /// \param bin the event class bin number
+  /// \return the position within the array
+  std::size_t DataIndex(Int_t index, Long64_t bin) const { return (bin*fNHarmonics + index)*4; }
+  void AllocateData(Int_t nNumberOfSlots);
+  void ReadHistograms();
   THnF **fXValues = nullptr;            //!<! X component histogram for each requested harmonic
   THnF **fYValues = nullptr;            //!<! Y component histogram for each requested harmonic
   UInt_t fXharmonicFillMask = 0x0000;  //!<! keeps track of harmonic X component filled values
   UInt_t fYharmonicFillMask = 0x0000;  //!<! keeps track of harmonic Y component filled values
   UInt_t fFullFilled = 0x0000;         //!<! mask for the fully filled condition
   THnI *fEntries = nullptr;            //!<! Cumulates the number on each of the event classes
+  Int_t fNHarmonics = 0;               //!<! number of harmonics stored in the dense array
+  std::vector<Int_t> fHarmonicIndex;   //!<! compact index of each external harmonic number, -1 if not present
+  std::vector<Double_t> fData;         //!<! X, Y, X^2 and Y^2 sums of each harmonic in each event class
+  std::vector<Double_t> fEntriesData;  //!<! number of entries of each event class
+  std::vector<Double_t> fFills;        //!<! number of X and Y fills of each harmonic. The histogram entries
+  Bool_t fModified = kFALSE;           //!<! the dense array changed since the last update of the histograms
   /// \cond CLASSIMP
  ClassDef(CorrectionProfileComponents, 1);
   /// \endcond
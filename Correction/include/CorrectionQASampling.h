@@ -0,0 +1,73 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLOW_CORRECTIONQASAMPLING_H
+#define FLOW_CORRECTIONQASAMPLING_H
+
+#include <array>
+#include <stdexcept>
+
+namespace Qn {
+/**
+ * @class CorrectionQASampling
+ * @brief Decides in which events the QA histograms are filled. The QA histograms of a category are filled only in
+ * every Nth event passing the event cuts, such that the cost of filling large QA histograms is reduced. The
+ * categories are sampled independently of each other.
+ */
+class CorrectionQASampling {
+ public:
+  enum class Category {
+    kCalibration = 0, ///< QA histograms of the correction steps and the Q vectors
+    kValidation, ///< QA histograms of the bins not validated by the correction steps
+    kEvent, ///< event QA histograms and QA histograms of the detector input
+    kNCategories
+  };
+
+  /**
+   * Sets the sampling of a category.
+   * @param category category of the QA histograms
+   * @param n_events the QA histograms are filled in every n_events-th event. Needs to be at least one.
+   */
+  void SetSampling(Category category, unsigned int n_events) {
+    if (n_events==0) throw std::logic_error("The QA histograms need to be sampled at least every event.");
+    n_events_[static_cast<int>(category)] = n_events;
+  }
+
+  /**
+   * Advances to the next event and decides, which QA histograms are filled in this event.
+   */
+  void NextEvent() {
+    for (int i = 0; i < static_cast<int>(Category::kNCategories); ++i) filled_[i] = event_%n_events_[i]==0;
+    ++event_;
+  }
+
+  /**
+   * Checks if the QA histograms of a category are filled in the current event.
+   * @param category category of the QA histograms
+   * @return true if they are filled
+   */
+  bool IsFilled(Category category) const { return filled_[static_cast<int>(category)]; }
+
+ private:
+  static constexpr auto kNCategories = static_cast<std::size_t>(Category::kNCategories);
+  std::array<unsigned int, kNCategories> n_events_{{1, 1, 1}}; ///< sampling of each category
+  std::array<bool, kNCategories> filled_{{true, true, true}}; ///< the category is filled in the current event
+  unsigned long long event_ = 0; ///< number of events
+};
+}
+
+#endif //FLOW_CORRECTIONQASAMPLING_H
@@ -0,0 +1,109 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLOW_CORRECTIONSPARSEACCUMULATOR_H
+#define FLOW_CORRECTIONSPARSEACCUMULATOR_H
+
+#include <cstdint>
+#include <vector>
+
+namespace Qn {
+/**
+ * @class CorrectionSparseAccumulator
+ * @brief Sparse accumulator of the sum of weights and the sum of squared weights keyed by a linear bin.
+ * Open addressing hash table with linear probing. The payload of a bin is stored inline with its key, such that a
+ * fill touches a single slot. Only bins which have been filled occupy memory.
+ */
+class CorrectionSparseAccumulator {
+ public:
+  struct Entry {
+    long long bin; ///< linear bin. kEmpty if the slot is not used
+    double sumw; ///< sum of the weights
+    double sumw2; ///< sum of the squared weights
+  };
+
+  /**
+   * Adds a weight to a bin.
+   * @param bin linear bin. Needs to be positive.
+   * @param weight the weight
+   */
+  void Fill(long long bin, double weight) {
+    if (2*(size_ + 1) > table_.size()) Grow();
+    auto &entry = table_[Probe(bin)];
+    if (entry.bin==kEmpty) {
+      entry.bin = bin;
+      ++size_;
+    }
+    entry.sumw += weight;
+    entry.sumw2 += weight*weight;
+  }
+
+  /**
+   * Finds a bin.
+   * @param bin linear bin
+   * @return pointer to the entry of the bin. nullptr if the bin has not been filled.
+   */
+  const Entry *Find(long long bin) const {
+    if (table_.empty()) return nullptr;
+    const auto &entry = table_[Probe(bin)];
+    return entry.bin==kEmpty ? nullptr : &entry;
+  }
+
+  /**
+   * Calls a function for each filled bin.
+   * @tparam Function callable with the signature void(const Entry &)
+   * @param function the function
+   */
+  template<typename Function>
+  void ForEach(Function &&function) const {
+    for (const auto &entry : table_) {
+      if (entry.bin!=kEmpty) function(entry);
+    }
+  }
+
+  std::size_t Size() const { return size_; }
+
+  void Clear() {
+    table_.clear();
+    size_ = 0;
+  }
+
+ private:
+  static constexpr long long kEmpty = -1;
+  static constexpr std::size_t kInitialCapacity = 64;
+
+  std::size_t Probe(long long bin) const {
+    const std::size_t mask = table_.size() - 1;
+    auto slot = static_cast<std::size_t>((static_cast<std::uint64_t>(bin)*0x9E3779B97F4A7C15ULL) >> 32u) & mask;
+    while (table_[slot].bin!=kEmpty && table_[slot].bin!=bin) slot = (slot + 1) & mask;
+    return slot;
+  }
+
+  void Grow() {
+    std::vector<Entry> old(table_.empty() ? kInitialCapacity : 2*table_.size(), Entry{kEmpty, 0., 0.});
+    old.swap(table_);
+    for (const auto &entry : old) {
+      if (entry.bin!=kEmpty) table_[Probe(entry.bin)] = entry;
+    }
+  }
+
+  std::vector<Entry> table_; ///< slots of the hash table. The size is a power of two.
+  std::size_t size_ = 0; ///< number of filled bins
+};
+}
+
+#endif //FLOW_CORRECTIONSPARSEACCUMULATOR_H
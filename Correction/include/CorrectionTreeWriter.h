@@ -0,0 +1,252 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLOW_CORRECTIONTREEWRITER_H
+#define FLOW_CORRECTIONTREEWRITER_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+
+#include "DataContainer.h"
+#include "FlatQVectors.h"
+#include "OutputLayout.h"
+
+namespace Qn {
+/**
+ * @class CorrectionTreeWriter
+ * @brief Fills the output tree either synchronously or from a background thread.
+ * In the synchronous mode the branches refer to the output values and the tree is filled in the event loop.
+ * In the asynchronous mode the output values of an event are copied into one of the buffers of a ring and the
+ * tree is filled by a writer thread from the buffered copies, such that the serialization and compression of the
+ * branches overlap with the corrections of the next events. The event loop waits when all buffers are in use.
+ * Q-vectors are either written as DataContainerQVector objects or in the flat layout of FlatQVectors.
+ * The layouts of all data containers are written once to the user info of the tree.
+ * Instead of a tree the output can be written to a RNTuple, if flow is built with the CMake option FLOW_RNTUPLE.
+ * The tree and its file must not be used by the user until Finish is called. ROOT::EnableThreadSafety needs to be
+ * called before the first event if ROOT is used in other threads at the same time.
+ */
+class CorrectionTreeWriter {
+ public:
+  CorrectionTreeWriter();
+  ~CorrectionTreeWriter();
+  CorrectionTreeWriter(const CorrectionTreeWriter &) = delete;
+  CorrectionTreeWriter &operator=(const CorrectionTreeWriter &) = delete;
+
+  /**
+   * Sets the output tree.
+   * @param tree non-owning pointer to the tree. Lifetime is managed by the user.
+   */
+  void Connect(TTree *tree) { tree_ = tree; }
+
+  /**
+   * Sets the output RNTuple instead of a tree. The Q-vectors are always written in the flat layout and their
+   * layouts are written to the file as list OutputLayoutsName(name) at Finish. The fields are created
+   * before the first event is filled, such that no fields can be added afterwards. The basket size is used as the
+   * approximate size of the pages. Objects, which are not Q-vectors or event variables, cannot be written.
+   * @param file non-owning pointer to the output file. Lifetime is managed by the user.
+   * @param name name of the RNTuple
+   */
+  void ConnectNTuple(TFile *file, const std::string &name);
+
+  bool IsConnected() const { return tree_!=nullptr || ntuple_!=nullptr; }
+
+  /**
+   * Enables the asynchronous filling of the tree. To be called before the first branch is added to the tree, as the
+   * branches added before refer to the output objects, which would be read by the writer thread while the next
+   * event is corrected.
+   * @param n_buffers number of events, which are buffered for the writer thread. Two for double buffering.
+   * The tree is filled synchronously if zero.
+   */
+  void SetAsynchronous(unsigned int n_buffers) {
+    if (!branches_.empty() || (tree_ && tree_->GetListOfBranches()->GetEntries() > 0)) {
+      throw std::logic_error("The output buffers need to be configured before the branches.");
+    }
+    n_buffers_ = n_buffers;
+  }
+
+  /**
+   * Sets the size of the baskets of the branches, which are added afterwards.
+   * @param basket_size size in bytes
+   */
+  void SetBasketSize(int basket_size) { basket_size_ = basket_size; }
+
+  /**
+   * Sets the compression of the branches, which are added afterwards.
+   * @param settings compression settings as in ROOT, e.g. 101 for zlib level 1. The settings of the file are used
+   * if negative.
+   */
+  void SetCompressionSettings(int settings) { compression_settings_ = settings; }
+
+  /**
+   * Writes the Q-vectors, which are added afterwards, in the flat layout of FlatQVectors instead of streaming the
+   * DataContainerQVector objects.
+   * @param flat true to enable
+   */
+  void SetFlatQVectors(bool flat) { flat_q_vectors_ = flat; }
+
+  /**
+   * Sets the encoding of the components of the flat Q-vectors, which are added afterwards. The encoding is written
+   * to their layouts. Enables the flat layout if the encoding is compact.
+   * @param encoding the encoding
+   */
+  void SetQVectorEncoding(const FlatQVectors::Encoding &encoding) {
+    encoding_ = encoding;
+    if (encoding_.IsCompact()) flat_q_vectors_ = true;
+  }
+
+  /**
+   * Adds a branch to the tree if there is no branch with the same name.
+   * The branch is filled with the value of the passed object at the time of Fill.
+   * @tparam T type of the written object
+   * @param name name of the branch
+   * @param source pointer to the written object. Needs to be valid until Finish is called.
+   */
+  template<typename T>
+  void Branch(const std::string &name, T *source) {
+    if (ntuple_) {
+      AddNTupleField(name, source);
+      return;
+    }
+    if (!tree_ || tree_->GetBranch(name.data())) return;
+    // new branches are only added while the writer thread is idle.
+    Flush();
+    if (n_buffers_==0) {
+      Configure(tree_->Branch(name.data(), source, basket_size_));
+    } else {
+      auto branch = std::make_unique<BufferedBranch<T, T>>(source, n_buffers_);
+      Configure(tree_->Branch(name.data(), &branch->written, basket_size_));
+      branches_.push_back(std::move(branch));
+    }
+    WriteLayout(name, *source);
+  }
+
+  /**
+   * Adds the branches of Q-vectors to the tree. The Q-vectors are written either as object or in the flat layout.
+   * @param name name of the Q-vectors
+   * @param source pointer to the written Q-vectors. Needs to be valid until Finish is called.
+   */
+  void BranchQVectors(const std::string &name, DataContainerQVector *source);
+
+  /**
+   * Fills the current values of the branches into the tree. In the asynchronous mode the values are copied to a
+   * free buffer, which is written by the writer thread. Waits until a buffer is free if all buffers are in use.
+   */
+  void Fill();
+
+  /**
+   * Waits until the buffered events are written to the tree.
+   */
+  void Flush();
+
+  /**
+   * Writes the buffered events and stops the writer thread. Afterwards the tree can be used by the user.
+   */
+  void Finish();
+
+ private:
+  struct BufferedBranchBase {
+    virtual ~BufferedBranchBase() = default;
+    virtual void Copy(std::size_t buffer) = 0;
+    virtual void Restore(std::size_t buffer) = 0;
+  };
+
+  /**
+   * Output object, which is copied into buffers of the type of the written object. Without buffers it is copied
+   * directly into the written object.
+   * @tparam Source type of the output object
+   * @tparam Written type of the object the branch refers to
+   */
+  template<typename Source, typename Written>
+  struct BufferedBranch : public BufferedBranchBase {
+    BufferedBranch(Source *source_object, std::size_t n_buffers) :
+        source(source_object), written(*source_object), buffers(n_buffers, written) {}
+    BufferedBranch(Source *source_object, std::size_t n_buffers, Written initial) :
+        source(source_object), written(std::move(initial)), buffers(n_buffers, written) {}
+    void Copy(std::size_t buffer) override { Store(buffers.empty() ? written : buffers[buffer], *source); }
+    void Restore(std::size_t buffer) override { Store(written, buffers[buffer]); }
+    Source *source; ///< the output object of the event loop
+    Written written; ///< object the branch refers to
+    std::vector<Written> buffers; ///< copies of the buffered events
+  };
+
+  template<typename T>
+  static void Store(T &target, T &source) { target = source; }
+  static void Store(FlatQVectors &target, const DataContainerQVector &source) { target.Set(source); }
+  static void Store(FlatQVectors &target, FlatQVectors &source) { target.Set(source); }
+
+  struct NTupleOutput;
+
+  /**
+   * Writes the layout of data containers to the user info of the tree. Other outputs have no layout.
+   */
+  template<typename T>
+  void WriteLayout(const std::string &, const T &) {}
+
+  template<typename T, typename AxisType>
+  void WriteLayout(const std::string &name, const DataContainer<T, AxisType> &container) {
+    WriteOutputLayout(tree_->GetUserInfo(), name, container);
+  }
+
+  template<typename T>
+  void AddNTupleField(const std::string &name, T *source) {
+    if constexpr (std::is_same<T, double>::value || std::is_same<T, Long64_t>::value) {
+      if (!AddNTupleName(name)) return;
+      auto branch = std::make_unique<BufferedBranch<T, T>>(source, n_buffers_);
+      MakeNTupleField(name, &branch->written);
+      branches_.push_back(std::move(branch));
+    } else {
+      throw std::logic_error("The output " + name + " cannot be written to the RNTuple.");
+    }
+  }
+
+  bool AddNTupleName(const std::string &name);
+  void MakeNTupleField(const std::string &name, const double *value);
+  void MakeNTupleField(const std::string &name, const Long64_t *value);
+  void MakeNTupleFields(const std::string &name, const FlatQVectors *q_vectors);
+  bool FillOutput();
+  void FinishNTuple();
+  void Configure(TBranch *branch) const;
+  void Write();
+
+  TTree *tree_ = nullptr; ///< output tree. Lifetime is managed by the user.
+  std::unique_ptr<NTupleOutput> ntuple_; ///< output RNTuple instead of the tree
+  unsigned int n_buffers_ = 0; ///< number of buffered events. Synchronous if zero.
+  int basket_size_ = 32000; ///< size of the baskets of the branches
+  int compression_settings_ = -1; ///< compression settings of the branches
+  bool flat_q_vectors_ = false; ///< Q-vectors are written in the flat layout
+  FlatQVectors::Encoding encoding_; ///< encoding of the components of the flat Q-vectors
+  std::vector<std::unique_ptr<BufferedBranchBase>> branches_; ///< buffered branches and branches of flat Q-vectors
+  std::thread writer_; ///< writer thread
+  std::mutex mutex_; ///< guards the state of the ring
+  std::condition_variable condition_; ///< signals a filled or a written buffer
+  std::size_t first_buffer_ = 0; ///< oldest buffer, which is not written
+  std::size_t n_filled_ = 0; ///< number of buffers, which are not written
+  bool stop_ = false; ///< stops the writer thread
+  bool failed_ = false; ///< the writer thread failed to fill the tree
+};
+}
+
+#endif //FLOW_CORRECTIONTREEWRITER_H
@@ -19,6 +19,7 @@
 #include <set>
 
 #include "CorrectionBase.h"
+#include "CorrectionCalibrationFile.h"
 #include "CorrectionOnQnVector.h"
 #include "CorrectionOnInputData.h"
 
@@ -117,8 +118,18 @@ class CorrectionsSet {
     return report;
   }
 
+  /// Reports if all correction steps collecting data stopped because their parameters converged
+  /// \return false if a correction step is still collecting data
+  bool IsCollectionConverged() const {
+    for (const auto &correction : list_) {
+      if (correction->ReportUsage().first && !correction->IsCollectionConverged()) return false;
+    }
+    return true;
+  }
+
   void CreateCorrectionHistograms() {
     for (auto &correction : list_) {
+      correction->ResetConvergence();
       correction->CreateCorrectionHistograms();
     }
   }
@@ -138,12 +149,52 @@ class CorrectionsSet {
     }
   }
 
+  /// Attaches the correction parameters of a calibration file
+  /// The correction steps are enabled in the same sequence as for the input histograms.
+  /// \param file the calibration file
+  /// \param run the name of the current run
+  /// \param sub_event the name of the owning sub event
+  void AttachInputs(const CorrectionCalibrationFile &file, const std::string &run, const std::string &sub_event) {
+    T *previous_correction = nullptr;
+    for (auto &correction : list_) {
+      if (previous_correction) {
+        if (previous_correction->GetState()==CorrectionBase::State::APPLYCOLLECT) {
+          correction->Enable();
+        }
+      }
+      if (correction->GetState()==CorrectionBase::State::CALIBRATION) {
+        correction->AttachParameters(file.Find(run, sub_event, correction->GetName()));
+      }
+      previous_correction = correction.get();
+    }
+  }
+
+  /// Writes the correction parameters of the steps being applied to a calibration file
+  /// Only the leading steps being applied are written, as the following ones
+  /// depend on them.
+  /// \param writer the calibration file writer
+  /// \param run the name of the current run
+  /// \param sub_event the name of the owning sub event
+  void WriteParameters(CorrectionCalibrationWriter &writer, const std::string &run,
+                       const std::string &sub_event) const {
+    for (const auto &correction : list_) {
+      if (!correction->IsBeingApplied()) break;
+      if (auto table = correction->GetParameterTable()) writer.Add(run, sub_event, correction->GetName(), *table);
+    }
+  }
+
   void CopyToOutputList(TList *output_list) {
     for (auto &correction : list_) {
       correction->CopyToOutputList(output_list);
     }
   }
 
+  void UpdateHistograms() {
+    for (auto &correction : list_) {
+      correction->UpdateHistograms();
+    }
+  }
+
   void EnableFirstCorrection() {
     if (!list_.empty()) (*list_.begin())->Enable();
   }
@@ -20,6 +20,7 @@
 
 #include <utility>
 #include <memory>
+#include <ostream>
 #include <utility>
 
 #include "ROOT/RMakeUnique.hxx"
@@ -32,6 +33,8 @@
 #include "QVector.h"
 #include "QAHistogram.h"
 #include "CorrectionCuts.h"
+#include "CorrectionEventRecorder.h"
+#include "CorrectionTreeWriter.h"
 
 namespace Qn {
 class DetectorList;
@@ -61,21 +64,25 @@ class Detector {
   Detector(const Detector &other);
   /**
    * @brief Clears data before filling new event.
+   * Only the sub events, which were processed in the last event, are cleared. The others are still in the cleared
+   * state and their output Q-vectors are still invalid.
    */
   void ClearData() {
-    for (auto &bin : sub_events_) {
-      bin->Clear();
+    for (auto ibin : touched_bins_) {
+      sub_events_[ibin]->Clear();
+      ResetOutputQVectors(ibin);
     }
+    ResetTouchedBins();
   }
   /**
    * @brief Adds a cut to the detector
    * @param cut unique pointer to the cut.
    */
-  void AddCut(const CorrectionCut::CallBack &callback, bool is_channel_wise) {
+  void AddCut(const CorrectionCut::CallBack &callback, bool is_channel_wise, const std::string &signature = {}) {
     if (is_channel_wise) {
-      cuts_.AddCut(callback);
+      cuts_.AddCut(callback, signature);
     } else {
-      int_cuts_.AddCut(callback);
+      int_cuts_.AddCut(callback, signature);
     }
   }
   /**
@@ -113,12 +120,78 @@ class Detector {
  */
   void SetOutputQVector(QVector::CorrectionStep step) { output_tree_q_vectors_.emplace_back(step); }
 
+  /**
+   * Configures the output of the Q-vectors of the generic framework for multi-particle correlations.
+   * They are filled with the uncorrected input data and written to the branch <detector name>_GF. Neither the
+   * corrections of the input data, e.g. the gain equalization, nor the corrections of the Q-vectors are applied.
+   * Non-uniform acceptance needs to be corrected by the weights of the input data.
+   * @param max_harmonic maximum harmonic
+   * @param max_power maximum power of the weights
+   */
+  void SetOutputQVectorGF(unsigned int max_harmonic, unsigned int max_power) {
+    gf_max_harmonic_ = max_harmonic;
+    gf_max_power_ = max_power;
+  }
+
+  /**
+   * Columns of the track variables of a whole event. Associates the position of a variable in the variable
+   * container with the array holding its values for all tracks.
+   */
+  using TrackColumns = std::vector<std::pair<double *, const double *>>;
+
   void Initialize(DetectorList &detectors, InputVariableManager &var, CorrectionAxisSet &correction_axis);
   void FillData();
+  /**
+   * Fills all tracks of an event in one pass. The sub event bins are found from the columns of the binning
+   * variables. Variables without a column keep the value in the variable container for all tracks.
+   * The cuts and the QA histograms are evaluated for each track.
+   * @param n number of tracks
+   * @param columns columns of the track variables
+   */
+  void FillTracks(std::size_t n, const TrackColumns &columns);
+  /**
+   * Fills the fired channels of a channel detector. Only the fired channels are evaluated by the cuts and enter the
+   * sub events. Their amplitudes are written to the weights of the channels in the variable container, the weights
+   * of the other channels are not updated.
+   * @param n number of fired channels
+   * @param channels ids of the fired channels
+   * @param amplitudes amplitudes of the fired channels used as weights
+   */
+  void FillChannels(std::size_t n, const int *channels, const double *amplitudes);
+  /**
+   * Records the data vectors of all sub events of the current event.
+   * @param recorder event recorder
+   */
+  void RecordData(CorrectionEventRecorder &recorder) const {
+    for (const auto &ev : sub_events_) recorder.AddDataVectors(ev->GetInputDataBank());
+  }
+  /**
+   * Fills the sub events with the data vectors of a recorded event. The detector cuts and QA histograms are not
+   * evaluated, as the data vectors were recorded after the cuts.
+   * @param sizes number of data vectors of each sub event. Advanced to the next detector.
+   * @param data data vectors. Advanced to the next detector.
+   */
+  void ReplayData(const std::uint32_t *&sizes, const CorrectionEventRecorder::DataVector *&data);
+  /**
+   * Accumulates the counts of the cuts of the current event. A detector sharing the selection of another detector
+   * reports the counts of the other detector, which need to be reported after it.
+   */
   void FillReport() {
+    if (selection_) {
+      int_cuts_.FillReport(selection_->int_cuts_);
+      cuts_.FillReport(selection_->cuts_);
+      return;
+    }
     int_cuts_.FillReport();
     cuts_.FillReport();
   }
+  /**
+   * Writes the accumulated counts of the cuts to the cut reports.
+   */
+  void UpdateReport() {
+    int_cuts_.UpdateReport();
+    cuts_.UpdateReport();
+  }
   void CreateSupportQVectors() { for (auto &ev : sub_events_) { ev->CreateSupportQVectors(); }}
 
   void AttachCorrectionInputs(TList *list) {
@@ -127,6 +200,18 @@ class Detector {
     }
   }
 
+  void AttachCorrectionInputs(const CorrectionCalibrationFile &file, const std::string &run) {
+    for (auto &ev : sub_events_) {
+      ev->AttachCorrectionInput(file, run);
+    }
+  }
+
+  void WriteCorrectionParameters(CorrectionCalibrationWriter &writer, const std::string &run) const {
+    for (const auto &ev : sub_events_) {
+      ev->WriteCorrectionParameters(writer, run);
+    }
+  }
+
   void AfterInputAttachAction() {
     for (auto &ev : sub_events_) {
       ev->AfterInputAttachAction();
@@ -144,17 +229,85 @@ class Detector {
     }
   }
 
+  void UpdateHistograms() {
+    for (auto &ev : sub_events_) {
+      ev->UpdateHistograms();
+    }
+  }
+
+  bool IsCollectionConverged() const {
+    for (const auto &ev : sub_events_) {
+      if (!ev->IsCollectionConverged()) return false;
+    }
+    return true;
+  }
+
 
   bool IsIntegrated() const { return sub_events_.IsIntegrated(); }
   void ProcessCorrections();
+  /**
+   * Returns the names of the detectors, whose current Q-vectors are used by the correction steps of this detector.
+   * These detectors need to be processed first.
+   */
+  std::vector<std::string> GetReferencedDetectors() const;
+  unsigned int GetNumberOfSubEvents() const { return sub_events_.size(); }
   void IncludeQnVectors();
-  void AttachToTree(TTree *tree);
-  void ActivateHarmonic(unsigned int i) {
-    harmonics_bits_.set(i - 1);
-    for (auto &ev : sub_events_) {
-      ev->ActivateHarmonic(i);
-    }
+  void AttachToTree(CorrectionTreeWriter &tree);
+  /**
+   * Propagates the harmonics needed by the output and by the correction steps of other detectors back through the
+   * correction steps of this detector. Each step provides only the harmonics, which are read after it.
+   * @param detectors list of all detectors
+   * @return true if the harmonics needed from one of the referenced detectors changed.
+   */
+  bool PropagateHarmonics(DetectorList &detectors);
+  /**
+   * Adds harmonics, which are read from this detector by the correction steps of other detectors.
+   * @param harmonics the harmonics
+   * @return true if harmonics were added.
+   */
+  bool AddReferencedHarmonics(std::bitset<Qn::QVector::kmaxharmonics> harmonics) {
+    const auto previous = referenced_harmonics_;
+    referenced_harmonics_ |= harmonics;
+    return referenced_harmonics_!=previous;
   }
+  void ResetReferencedHarmonics() { referenced_harmonics_.reset(); }
+
+  /**
+   * Configures the detector to receive only the fired channels with FillChannels. FillData is skipped.
+   * @param sparse true to enable
+   */
+  void SetSparseInput(bool sparse) { sparse_input_ = sparse; }
+
+  /**
+   * Checks if the detector selects the same entries and sorts them into the same sub events as another detector.
+   * This is the case for detectors of the same type and size with the same binning and equivalent cuts. Detectors
+   * receiving only the fired channels are not compared, as the cuts may read their amplitudes.
+   * @param other the other detector
+   * @return true if the selection can be shared
+   */
+  bool HasSameSelection(const Detector &other) const;
+
+  /**
+   * Reuses the selection of the entries of another detector, which is filled before this detector. The cuts and the
+   * sub event bins are not evaluated by this detector anymore. To be called after the initialization.
+   * @param selection the detector evaluating the selection. nullptr evaluates the own selection.
+   */
+  void ShareSelection(const Detector *selection) { selection_ = selection; }
+  const Detector *GetSharedSelection() const { return selection_; }
+
+  /**
+   * Processes the Q vector correction steps of the sub events with a chain composed at compile time.
+   * @param chain the correction chain, which needs to match the correction steps of the detector
+   */
+  void SetCorrectionChain(std::shared_ptr<const CorrectionChain> chain) { correction_chain_ = std::move(chain); }
+
+  /**
+   * Times the corrections of the detector and each of its correction steps and counts the data vectors and the
+   * touched sub events. Only the sequential processing of the corrections times the correction steps.
+   * To be called after the initialization.
+   * @param instrumentation non-owning pointer to the instrumentation. Disabled if nullptr.
+   */
+  void SetInstrumentation(CorrectionInstrumentation *instrumentation);
 
   void SetChannelScheme(std::vector<int> channel_groups) {
     channel_groups_ = channel_groups;
@@ -166,32 +319,97 @@ class Detector {
   std::string GetBinName(unsigned int id) const { return sub_events_.GetBinDescription(id); }
   SubEvent *GetSubEvent(unsigned int ibin) { return sub_events_.At(ibin).get(); }
   TList *CreateQAHistogramList(bool fill_qa, bool fill_validation);
+  /**
+   * Writes the configuration of the detector, which determines its calibration histograms, for the key of the
+   * calibration cache. To be called after Initialize.
+   * @param stream the output stream
+   */
+  void WriteConfiguration(std::ostream &stream) const;
 
-  DataContainerQVector *GetQVector(QVector::CorrectionStep step) { return q_vectors_.at(step).get(); }
+  DataContainerQVector *GetQVector(QVector::CorrectionStep step) { return RequestQVector(step); }
+  /**
+   * Returns the Q-vectors of a correction step. The output Q-vectors of the step are filled from now on.
+   * @param name name of the Q-vectors as in the output tree, i.e. "<detector>_<STEP>"
+   * @return the Q-vectors. nullptr if the name does not refer to an included correction step of this detector.
+   */
+  DataContainerQVector *FindQVector(const std::string &name) {
+    if (name.size() <= name_.size() || name.compare(0, name_.size(), name_)!=0 || name[name_.size()]!='_') {
+      return nullptr;
+    }
+    const auto suffix = name.substr(name_.size() + 1);
+    for (auto step : included_steps_) {
+      if (suffix==kCorrectionStepNamesArray[step]) return RequestQVector(step);
+    }
+    return nullptr;
+  }
 
  private:
+  void FillOutputQVectors();
+  const double *GetTrackColumn(const InputVariable &variable, const TrackColumns &columns, std::size_t n,
+                               std::size_t slot);
+  void AddEntries(const double *phi, const double *weight, const double *radial_offset,
+                  const std::size_t *channels = nullptr);
+  void AddSortedEntries(const Detector &selection, const double *phi, const double *weight,
+                        const double *radial_offset, const std::size_t *channels = nullptr);
+  void FillSharedData();
+  void FillSharedTracks(std::size_t n, const TrackColumns &columns);
+  /**
+   * Marks a sub event as receiving data in the current event, such that it is processed and reset.
+   * @param ibin bin of the sub event
+   */
+  void Touch(unsigned int ibin) {
+    if (batch_.touched[ibin]) return;
+    batch_.touched[ibin] = 1;
+    touched_bins_.push_back(ibin);
+  }
+  void ResetTouchedBins();
+  DataContainerQVector *RequestQVector(QVector::CorrectionStep step);
+  void ResetOutputQVectors(unsigned int ibin);
+
   InputVariable phi_; /// variable holding the azimuthal angle
   InputVariable weight_; /// variable holding the weight which is used for the calculation of the Q vector.
   InputVariable radial_offset_; /// variable holding the radial offset
   std::string name_; /// name of  the detector
   DetectorType type_; /// type of detector
   int nchannels_ = 0; /// number of channels in case of channel detector
-  std::bitset<Qn::QVector::kmaxharmonics> harmonics_bits_; /// bitset of all activated harmonics
+  std::bitset<Qn::QVector::kmaxharmonics> harmonics_bits_; /// bitset of the harmonics requested for the output
+  std::bitset<Qn::QVector::kmaxharmonics> referenced_harmonics_; //!<! harmonics read by other detectors
+  std::bitset<Qn::QVector::kmaxharmonics> input_harmonics_; //!<! harmonics of the Q vectors built from the input
   Qn::QVector::Normalization q_vector_normalization_method_ = Qn::QVector::Normalization::NONE;
   std::vector<InputVariable> input_variables_; //!<! variables used for the binning of the Q vector.
-  std::vector<float> coordinates_;  //!<!  vector holding the temporary coordinates of one track or channel.
+  std::vector<const double *> coordinates_; //!<! coordinates of all tracks or channels for each binning variable.
+  std::vector<unsigned char> passed_cuts_; //!<! flags the tracks or channels of the current event passing the cuts.
+  bool passed_int_cuts_ = false; //!<! the current entries passed the integrated cuts.
+  std::vector<long> entry_bins_; //!<! sub event bin of each track or channel of the current event.
+  std::vector<std::size_t> bin_offsets_; //!<! offset of the entries of each sub event in the sorted entries.
+  std::vector<std::size_t> sorted_entries_; //!<! selected tracks or channels of the current event sorted by sub event.
+  std::vector<double> track_values_; //!<! values of the variables without a column for all tracks of the event.
+  std::vector<std::size_t> fired_channels_; //!<! fired channels of the current event passing the cuts.
   std::map<QVector::CorrectionStep, std::unique_ptr<DataContainerQVector>> q_vectors_; //!<! output qvectors
+  std::vector<QVector::CorrectionStep> included_steps_; //!<! correction steps applied in the current run
   std::vector<QVector::CorrectionStep> output_tree_q_vectors_; /// Holds correction steps used for the output
+  unsigned int gf_max_harmonic_ = 0; //!<! maximum harmonic of the Q-vectors of the generic framework
+  unsigned int gf_max_power_ = 0; //!<! maximum power of the weights of the Q-vectors of the generic framework
+  std::unique_ptr<DataContainerQVectorGF> gf_q_vectors_; //!<! output Q-vectors of the generic framework
   CorrectionCuts cuts_; /// per channel selection  cuts
   CorrectionCuts int_cuts_; /// integrated selection cuts
   QAHistograms histograms_; /// QA histograms of the detector
   std::vector<Qn::AxisD> axes_; /// Holds axes till they are used to configure the subevents
   Qn::DataContainer<std::unique_ptr<SubEvent>, AxisD> sub_events_; //!<! SubEvents of the detector
+  SubEvent::Batch batch_; //!<! SubEvents of the detector with their correction steps ordered by step
+  std::vector<unsigned int> touched_bins_; //!<! sub events, which received data in the current event.
   Qn::DetectorList *detectors_ = nullptr; /// Pointer to the list of detectors
+  const CorrectionQASampling *qa_sampling_ = nullptr; //!<! sampling of the QA histograms
+  const Detector *selection_ = nullptr; //!<! detector evaluating the selection of the entries if not nullptr
   TObjArray correction_on_q_vector; /// Holds the correction steps till they are used to configure the sub events
   TObjArray correction_on_input_data; /// Holds the correction steps till they are used to configure the sub events
 
   std::vector<int> channel_groups_; /// for gain equalization
+  bool sparse_input_ = false; /// only the fired channels are filled with FillChannels.
+  std::shared_ptr<const CorrectionChain> correction_chain_; //!<! processes the Q vector corrections if not nullptr
+  CorrectionInstrumentation *instrumentation_ = nullptr; //!<! times the corrections if not nullptr
+  std::size_t corrections_counter_ = 0; //!<! counter of the corrections and the data vectors
+  std::size_t sub_events_counter_ = 0; //!<! counter of the touched sub events
 
 
   /// \cond CLASSIMP
@@ -18,7 +18,13 @@
 #ifndef FLOW_DETECTORLIST_H
 #define FLOW_DETECTORLIST_H
 
+#include <map>
+#include <stdexcept>
+
 #include "Detector.h"
+#ifdef R__USE_IMT
+#include "ROOT/TThreadExecutor.hxx"
+#endif
 namespace Qn {
 class DetectorList {
  public:
@@ -45,9 +51,10 @@ class DetectorList {
     }
   }
 
-  void AddCut(const std::string &name, const CorrectionCut::CallBack& cut, bool is_channel_wise) {
+  void AddCut(const std::string &name, const CorrectionCut::CallBack& cut, bool is_channel_wise,
+              const std::string &signature = {}) {
     auto &det = FindDetector(name);
-    det.AddCut(cut, is_channel_wise);
+    det.AddCut(cut, is_channel_wise, signature);
   }
 
   Detector &FindDetector(const std::string name) {
@@ -63,18 +70,29 @@ class DetectorList {
     }
   }
 
-  void SetOutputTree(TTree *output_tree) {
-    if (output_tree) {
-      for (auto &detector : tracking_detectors_) {
-        detector.AttachToTree(output_tree);
-      }
-      for (auto &detector : channel_detectors_) {
-        detector.AttachToTree(output_tree);
-      }
+  /**
+   * Finds the Q-vectors of a correction step of a detector.
+   * @param name name of the Q-vectors as in the output tree, i.e. "<detector>_<STEP>"
+   * @return the Q-vectors
+   */
+  const DataContainerQVector *FindQVector(const std::string &name) const {
+    for (auto &detector : all_detectors_) {
+      if (auto qvectors = detector->FindQVector(name)) return qvectors;
+    }
+    throw std::out_of_range("The Q-vectors " + name + " are not found.");
+  }
+
+  void SetOutputTree(CorrectionTreeWriter &output_tree) {
+    for (auto &detector : tracking_detectors_) {
+      detector.AttachToTree(output_tree);
+    }
+    for (auto &detector : channel_detectors_) {
+      detector.AttachToTree(output_tree);
     }
   }
 
   void Initialize(DetectorList &detectors, InputVariableManager &var, CorrectionAxisSet &axes) {
+    PropagateHarmonics();
     for (auto &detector : channel_detectors_) {
       all_detectors_.push_back(&detector);
       detector.Initialize(detectors, var, axes);
@@ -83,6 +101,80 @@ class DetectorList {
       all_detectors_.push_back(&detector);
       detector.Initialize(detectors, var, axes);
     }
+    ShareSelections(channel_detectors_);
+    ShareSelections(tracking_detectors_);
+    BuildCorrectionLevels();
+  }
+
+  /**
+   * Computes the harmonics of the Q vectors of all correction steps. Starting from the harmonics requested for the
+   * output, the harmonics read by the following steps and by the steps of other detectors are propagated back to
+   * the input, until the harmonics needed from the referenced detectors do not change anymore.
+   */
+  void PropagateHarmonics() {
+    for (auto &detector : channel_detectors_) detector.ResetReferencedHarmonics();
+    for (auto &detector : tracking_detectors_) detector.ResetReferencedHarmonics();
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (auto &detector : channel_detectors_) changed = detector.PropagateHarmonics(*this) || changed;
+      for (auto &detector : tracking_detectors_) changed = detector.PropagateHarmonics(*this) || changed;
+    }
+  }
+
+  /**
+   * Enables the processing of the corrections of independent detectors in parallel using ROOT's implicit
+   * multi-threading pool. Detectors, which use the Q-vectors of other detectors, are processed after them.
+   * @param parallel true to enable
+   */
+  void SetParallelCorrections(bool parallel) { parallel_corrections_ = parallel; }
+
+  /**
+   * Returns the sampling of the QA histograms, which is shared by all detectors and their sub events.
+   */
+  CorrectionQASampling &GetQASampling() { return qa_sampling_; }
+
+  /**
+   * Replaces the detectors by copies of the configured detectors of another list, which has not been initialized.
+   * The detectors need to be initialized again.
+   * @param configuration list of configured detectors
+   */
+  void Reconfigure(const DetectorList &configuration) {
+    all_detectors_.clear();
+    correction_levels_.clear();
+    tracking_detectors_.clear();
+    channel_detectors_.clear();
+    for (const auto &detector : configuration.tracking_detectors_) tracking_detectors_.emplace_back(detector);
+    for (const auto &detector : configuration.channel_detectors_) channel_detectors_.emplace_back(detector);
+  }
+
+  /**
+   * Writes the configuration of all detectors for the key of the calibration cache.
+   * @param stream the output stream
+   */
+  void WriteConfiguration(std::ostream &stream) const {
+    for (const auto &detector : tracking_detectors_) detector.WriteConfiguration(stream);
+    for (const auto &detector : channel_detectors_) detector.WriteConfiguration(stream);
+  }
+
+  void RecordData(CorrectionEventRecorder &recorder) const {
+    for (const auto &d : all_detectors_) {
+      d->RecordData(recorder);
+    }
+  }
+
+  void ReplayData(const std::uint32_t *sizes, const CorrectionEventRecorder::DataVector *data) {
+    for (auto &d : all_detectors_) {
+      d->ReplayData(sizes, data);
+    }
+  }
+
+  /**
+   * Returns true if all correction steps of all detectors are applied.
+   */
+  bool IsCalibrated() {
+    auto iteration = CalculateProgress(all_detectors_);
+    return iteration.first==iteration.second;
   }
 
   void FillTracking() {
@@ -91,15 +183,63 @@ class DetectorList {
     }
   }
 
+  /**
+   * Fills all tracks of an event to the tracking detectors.
+   * @param n number of tracks
+   * @param columns columns of the track variables
+   */
+  void FillTracks(std::size_t n, const Detector::TrackColumns &columns) {
+    for (auto &dp : tracking_detectors_) {
+      dp.FillTracks(n, columns);
+    }
+  }
+
+  void FillChannels(const std::string &name, std::size_t n, const int *channels, const double *amplitudes) {
+    FindDetector(name).FillChannels(n, channels, amplitudes);
+  }
+
   void FillChannel() {
     for (auto &dp : channel_detectors_) {
       dp.FillData();
     }
   }
 
+  /**
+   * Processes the corrections of all detectors. The detectors are processed level by level, such that
+   * detectors are processed after the detectors they reference. With parallel corrections the detectors of a level
+   * are processed concurrently. The thread pool is created at the first event and kept for all following events and
+   * runs.
+   */
   void ProcessCorrections() {
+    for (auto &level : correction_levels_) {
+#ifdef R__USE_IMT
+      if (parallel_corrections_ && level.size() > 1 && ROOT::IsImplicitMTEnabled()) {
+        if (!pool_) pool_ = std::make_shared<ROOT::TThreadExecutor>();
+        pool_->Foreach([&level](const unsigned int idetector) {
+          level[idetector]->ProcessCorrections();
+        }, ROOT::TSeqU(level.size()));
+        continue;
+      }
+#endif
+      for (auto &d : level) {
+        d->ProcessCorrections();
+      }
+    }
+  }
+
+  /**
+   * Returns the detectors sorted into levels by their references. The detectors of a level only reference detectors
+   * of previous levels. Available after the initialization.
+   */
+  const std::vector<std::vector<Detector *>> &GetCorrectionLevels() const { return correction_levels_; }
+
+  /**
+   * Times the corrections of all detectors. To be called after the initialization of the detectors.
+   * @param instrumentation non-owning pointer to the instrumentation. Disabled if nullptr.
+   */
+  void SetInstrumentation(CorrectionInstrumentation *instrumentation) {
     for (auto &d : all_detectors_) {
-      d->ProcessCorrections();
+      d->SetInstrumentation(instrumentation);
     }
   }
 
@@ -109,9 +249,22 @@ class DetectorList {
     }
   }
 
+  /**
+   * Accumulates the counts of the cuts of the current event. The detectors sharing the selection of another detector
+   * report its counts before they are reset by it.
+   */
   void FillReport() {
     for (auto &d : all_detectors_) {
-      d->FillReport();
+      if (d->GetSharedSelection()) d->FillReport();
+    }
+    for (auto &d : all_detectors_) {
+      if (!d->GetSharedSelection()) d->FillReport();
+    }
+  }
+
+  void UpdateReports() {
+    for (auto &d : all_detectors_) {
+      d->UpdateReport();
     }
   }
 
@@ -127,6 +280,19 @@ class DetectorList {
     }
   }
 
+  void UpdateHistograms() {
+    for (auto &d : all_detectors_) {
+      d->UpdateHistograms();
+    }
+  }
+
+  bool IsCollectionConverged() const {
+    for (const auto &d : all_detectors_) {
+      if (!d->IsCollectionConverged()) return false;
+    }
+    return true;
+  }
+
   void AttachCorrectionInput(TList *list) {
     for (auto &d : all_detectors_) {
       d->AttachCorrectionInputs(list);
@@ -136,6 +302,21 @@ class DetectorList {
     }
   }
 
+  void AttachCorrectionInput(const CorrectionCalibrationFile &file, const std::string &run) {
+    for (auto &d : all_detectors_) {
+      d->AttachCorrectionInputs(file, run);
+    }
+    for (auto &d : all_detectors_) {
+      d->AfterInputAttachAction();
+    }
+  }
+
+  void WriteCorrectionParameters(CorrectionCalibrationWriter &writer, const std::string &run) const {
+    for (const auto &d : all_detectors_) {
+      d->WriteCorrectionParameters(writer, run);
+    }
+  }
+
   void AttachQAHistograms(TList *list, bool fill_qa, bool fill_validation) {
     for (auto &detector: all_detectors_) {
       auto detector_list = detector->CreateQAHistogramList(fill_qa, fill_validation);
@@ -179,6 +360,62 @@ class DetectorList {
 
  private:
 
+  /**
+   * Groups the detectors, which select the same entries and sort them into the same sub events, e.g. tracking
+   * detectors differing only in the weights. The selection is evaluated once by the first detector of a group and
+   * reused by the others, which are filled after it.
+   * @param detectors detectors of one type in the order they are filled
+   */
+  static void ShareSelections(std::vector<Detector> &detectors) {
+    for (auto it = detectors.begin(); it!=detectors.end(); ++it) {
+      for (auto selection = detectors.begin(); selection!=it; ++selection) {
+        if (!selection->GetSharedSelection() && it->HasSameSelection(*selection)) {
+          it->ShareSelection(&*selection);
+          break;
+        }
+      }
+    }
+  }
+
+  /**
+   * Sorts the detectors into levels using the references between detectors. The detectors of a level only
+   * reference detectors of previous levels. Independent detectors are kept in their order.
+   */
+  void BuildCorrectionLevels() {
+    correction_levels_.clear();
+    std::map<const Detector *, std::vector<Detector *>> dependents;
+    std::map<const Detector *, unsigned int> n_references;
+    for (auto &d : all_detectors_) {
+      n_references[d] = 0;
+    }
+    for (auto &d : all_detectors_) {
+      for (const auto &name : d->GetReferencedDetectors()) {
+        auto &reference = FindDetector(name);
+        dependents[&reference].push_back(d);
+        ++n_references[d];
+      }
+    }
+    std::vector<Detector *> level;
+    for (auto &d : all_detectors_) {
+      if (n_references[d]==0) level.push_back(d);
+    }
+    std::size_t n_sorted = 0;
+    while (!level.empty()) {
+      n_sorted += level.size();
+      std::vector<Detector *> next_level;
+      for (auto &d : level) {
+        for (auto &dependent : dependents[d]) {
+          if (--n_references[dependent]==0) next_level.push_back(dependent);
+        }
+      }
+      correction_levels_.push_back(std::move(level));
+      level = std::move(next_level);
+    }
+    if (n_sorted!=all_detectors_.size()) {
+      throw std::logic_error("The detectors reference each other in a cycle.");
+    }
+  }
+
   std::pair<int, int> CalculateProgress(const std::vector<Detector *> &detectors) {
     int remaining_iterations_global = 0;
     int total_iterations_global = 0;
@@ -198,6 +435,12 @@ class DetectorList {
   std::vector<Detector> tracking_detectors_; ///< vector of tracking detectors
   std::vector<Detector> channel_detectors_; ///< vector of channel detectors
   std::vector<Detector *> all_detectors_; ///!<! storing pointers to all detectors
+  std::vector<std::vector<Detector *>> correction_levels_; //!<! detectors sorted by their references
+  bool parallel_corrections_ = false; //!<! process independent detectors in parallel
+#ifdef R__USE_IMT
+  std::shared_ptr<ROOT::TThreadExecutor> pool_; //!<! thread pool of the parallel corrections
+#endif
+  CorrectionQASampling qa_sampling_; //!<! sampling of the QA histograms
 
   /// \cond CLASSIMP
  ClassDef(DetectorList, 1);
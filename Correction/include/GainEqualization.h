@@ -51,6 +51,7 @@
 /// further phase, the calibration histograms.
 
 #include "CorrectionOnInputData.h"
+#include "CorrectionParameterTable.h"
 #include "CorrectionProfileChannelizedIngress.h"
 #include "CorrectionProfileChannelized.h"
 #include "CorrectionHistogramChannelizedSparse.h"
@@ -144,12 +145,21 @@ class GainEqualization : public CorrectionOnInputData {
   /// Set the minimum number of entries for calibration histogram bin content validation
   /// \param nNoOfEntries the number of entries threshold
   void SetNoOfEntriesThreshold(Int_t nNoOfEntries) { fMinNoOfEntriesToValidate = nNoOfEntries; }
+  virtual void WriteSettings(std::ostream &stream) const {
+    CorrectionOnInputData::WriteSettings(stream);
+    stream << ' ' << static_cast<int>(fEqualizationMethod) << ' ' << std::hexfloat << fShift << ' ' << fScale
+           << std::defaultfloat << ' ' << fUseChannelGroupsWeights << ' ' << fMinNoOfEntriesToValidate;
+  }
 
   /// Informs when the detector configuration has been attached to the framework manager
   /// Basically this allows interaction between the different framework sections at configuration time
   /// No action for input gain equalization
   virtual void AttachedToFrameworkManager() {}
   virtual void AttachInput(TList *list);
+  virtual void AttachParameters(CorrectionParameterTable &&parameters);
+  virtual const CorrectionParameterTable *GetParameterTable() const {
+    return fParameters.IsInitialized() ? &fParameters : nullptr;
+  }
   virtual void CreateSupportQVectors();
   virtual void CreateCorrectionHistograms();
   virtual void AttachQAHistograms(TList *list);
@@ -157,12 +167,27 @@ class GainEqualization : public CorrectionOnInputData {
 
   virtual Bool_t ProcessCorrections();
   virtual Bool_t ProcessDataCollection();
+  virtual void ProcessCorrectionsBatch(CorrectionBase *const *steps, unsigned char *active, std::size_t n) {
+    BatchProcessCorrections<GainEqualization>(steps, active, n);
+  }
+  virtual void ProcessDataCollectionBatch(CorrectionBase *const *steps, unsigned char *active, std::size_t n) {
+    BatchProcessDataCollection<GainEqualization>(steps, active, n);
+  }
   /// Clean the correction to accept a new event
   /// Does nothing for the time being
   virtual void ClearCorrectionStep() {}
+  /// Copies the accumulated profiles and non validated entries into their histograms
+  virtual void UpdateHistograms() {
+    if (fCalibrationHistograms) fCalibrationHistograms->UpdateHistograms();
+    if (fQAMultiplicityBefore) fQAMultiplicityBefore->UpdateHistograms();
+    if (fQAMultiplicityAfter) fQAMultiplicityAfter->UpdateHistograms();
+    if (fQANotValidatedBin) fQANotValidatedBin->UpdateHistograms();
+  }
 
  private:
   using State = Qn::CorrectionBase::State;
+  void FillParameterTable();
+  void FillCoefficients();
   static constexpr const unsigned int szPriority =
       CorrectionOnInputData::Priority::kGainEqualization; ///< the key of the correction step for ordering purpose
   static constexpr const Float_t
@@ -189,6 +214,9 @@ class GainEqualization : public CorrectionOnInputData {
   const Float_t
       *fHardCodedWeights = nullptr;             //!<! group hard coded weights stored in the detector configuration
   Int_t fMinNoOfEntriesToValidate = 2;              ///< number of entries for bin content validation threshold
+  CorrectionParameterTable fParameters; //!<! the average, width and group weight of each event class and channel
+  std::vector<Float_t> fCoefficients; //!<! the gain and offset of the equalized weight of each event class and channel
+  Int_t fNoOfChannels = 0; //!<! the number of channels of the detector configuration
 
 /// \cond CLASSIMP
  ClassDef(GainEqualization, 2);
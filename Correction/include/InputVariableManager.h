@@ -20,11 +20,16 @@
 
 #include <string>
 #include <map>
+#include <ostream>
 #include <utility>
 #include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
 #include "TTree.h"
 
 #include "InputVariable.h"
+#include "CorrectionTreeWriter.h"
 
 /**
  * @brief Attaches a variable to a chosen tree.
@@ -43,9 +48,11 @@ class OutputValue {
    * @brief Creates a new branch in the tree.
    * @param tree output tree
    */
-  void SetToTree(TTree *tree) {
-    tree->Branch(var_->GetName().data(), &value_);
-  }
+  void SetToTree(Qn::CorrectionTreeWriter &tree) { tree.Branch(var_->GetName(), &value_); }
+  /**
+   * @brief Returns the position of the variable in the values container.
+   */
+  unsigned int GetId() const { return var_->GetID(); }
  private:
   T value_; /// value which is written
   Qn::InputVariable *var_; /// Variable to be written to the tree
@@ -73,21 +80,28 @@ class InputVariableManager {
     }
   }
 
+  /**
+   * @brief Allocates the values container. The container is only as large as needed by the registered variables,
+   * such that the values of an event are packed into as few cache lines as possible.
+   */
   void Initialize() {
-    variable_values_float_ = new f_type[kMaxSize]; /// non-owning pointer to variables
-    variable_values_ones_ = new f_type[kMaxSize]; /// values container of ones.
-
+    std::size_t size = 1;
+    for (const auto &var : variable_map_) {
+      if (var.first=="Ones" || var.second.values_container_) continue;
+      size = std::max(size, static_cast<std::size_t>(var.second.id_ + var.second.size_));
+    }
+    variable_values_.assign(size, NAN);
+    variable_values_ones_.assign(kMaxSize, 1.0);
+    variable_values_float_ = variable_values_.data();
     for (auto &var : variable_map_) {
-      var.second.values_container_ = variable_values_float_;
+      if (!var.second.values_container_) var.second.values_container_ = variable_values_float_;
     }
-    variable_map_["Ones"].values_container_ = variable_values_ones_;
-    for (int i = 0; i < kMaxSize; ++i) { variable_values_float_[i] = NAN; }
-    for (unsigned int i = 0; i < kMaxSize; ++i) { variable_values_ones_[i] = 1.0; }
+    variable_map_["Ones"].values_container_ = variable_values_ones_.data();
   }
 
   void InitVariable(InputVariable &var) {
     if (var.name_=="Ones") {
-      var.values_container_ = variable_values_ones_;
+      var.values_container_ = variable_values_ones_.data();
     } else {
       var.values_container_ = variable_values_float_;
     }
@@ -148,7 +162,7 @@ class InputVariableManager {
    */
   int FindNum(const std::string &name) const { return variable_map_.at(name).id_; }
   /**
-   * @brief Get the values container.
+   * @brief Get the values container. It holds the values of all registered variables at their positions.
    * @return a pointer to the values container.
    */
   f_type *GetVariableContainer() { return variable_values_float_; }
@@ -176,11 +190,31 @@ class InputVariableManager {
    * @brief Creates Branches in tree for saving the event information.
    * @param tree output tree to contain the event information
    */
-  void SetOutputTree(TTree *tree) {
+  void SetOutputTree(CorrectionTreeWriter &tree) {
     for (auto &element : variable_output_float_) { element.SetToTree(tree); }
     for (auto &element : variable_output_integer_) { element.SetToTree(tree); }
   }
 
+  /**
+   * Writes the names, positions and lengths of the variables for the key of the calibration cache.
+   * @param stream the output stream
+   */
+  void WriteConfiguration(std::ostream &stream) const {
+    for (const auto &var : variable_map_) {
+      stream << var.first << ' ' << var.second.id_ << ' ' << var.second.size_ << '\n';
+    }
+  }
+
+  /**
+   * @brief Returns the positions of the output variables in the values container.
+   */
+  std::vector<unsigned int> GetOutputVariableIds() const {
+    std::vector<unsigned int> ids;
+    for (const auto &element : variable_output_float_) { ids.push_back(element.GetId()); }
+    for (const auto &element : variable_output_integer_) { ids.push_back(element.GetId()); }
+    return ids;
+  }
+
   /**
    * @brief Updates the output variables.
    */
@@ -190,9 +224,10 @@ class InputVariableManager {
   }
 
  private:
-  static constexpr int kMaxSize = 11000; /// Maximum number of variables.
-  f_type *variable_values_float_ = nullptr; //!<! non-owning pointer to variables
-  f_type *variable_values_ones_ = nullptr; //!<! values container of ones.
+  static constexpr int kMaxSize = 11000; /// Maximum length of a variable.
+  std::vector<f_type> variable_values_; //!<! values of the registered variables
+  std::vector<f_type> variable_values_ones_; //!<! values container of ones.
+  f_type *variable_values_float_ = nullptr; //!<! pointer to the values of the registered variables
   std::vector<double *> channel_variables_; //!<!
   std::map<std::string, InputVariable> variable_map_; /// name to variable map
   std::vector<OutputValue<f_type>> variable_output_float_; //!<! variables registered for output as float
@@ -52,6 +52,7 @@
 /// defined within the involved detector configuration
 
 #include "CorrectionOnQnVector.h"
+#include "CorrectionParameterTable.h"
 namespace Qn {
 /// \class QnCorrectionsQnVectorRecentering
 /// \brief Encapsulates recentering and width equalization on Q vector
@@ -97,6 +98,12 @@ namespace Qn {
 ///
 /// Correction and data collecting during calibration is performed for all harmonics
 /// defined within the involved detector configuration
+///
+/// In the online mode the recentering is applied already in the calibration
+/// status, with the running averages of the events of the same event class
+/// processed before, once the event class has collected a warm-up number of
+/// entries. The calibration histograms collected in the same pass are the
+/// final calibration for a later exact pass.
 
 class CorrectionHistogramSparse;
 
@@ -106,7 +113,8 @@ class Recentering : public CorrectionOnQnVector {
   virtual ~Recentering() = default;
   Recentering(const Recentering &other) : CorrectionOnQnVector(other),
                                           fApplyWidthEqualization(other.fApplyWidthEqualization),
-                                          fMinNoOfEntriesToValidate(other.fMinNoOfEntriesToValidate) {
+                                          fMinNoOfEntriesToValidate(other.fMinNoOfEntriesToValidate),
+                                          fOnlineWarmUpEntries(other.fOnlineWarmUpEntries) {
   }
 
   virtual CorrectionOnQnVector *MakeCopy() const { return dynamic_cast<CorrectionOnQnVector *>(new Recentering(*this)); }
@@ -117,10 +125,23 @@ class Recentering : public CorrectionOnQnVector {
   /// Set the minimum number of entries for calibration histogram bin content validation
   /// \param nNoOfEntries the number of entries threshold
   void SetNoOfEntriesThreshold(Int_t nNoOfEntries) { fMinNoOfEntriesToValidate = nNoOfEntries; }
+  /// Enables the online mode, which applies the running averages of the previous events
+  /// of an event class without calibration input. The running averages are collected by
+  /// each instance of the correction manager, e.g. by each slot of the event loop.
+  /// \param nWarmUpEntries the number of entries of an event class before its averages are applied. 0 disables.
+  void SetOnlineMode(Int_t nWarmUpEntries) { fOnlineWarmUpEntries = nWarmUpEntries; }
+  virtual void WriteSettings(std::ostream &stream) const {
+    CorrectionOnQnVector::WriteSettings(stream);
+    stream << ' ' << fApplyWidthEqualization << ' ' << fMinNoOfEntriesToValidate << ' ' << fOnlineWarmUpEntries;
+  }
   /// Informs when the detector configuration has been attached to the framework manager
   /// Basically this allows interaction between the different framework sections at configuration time
   /// No action for Qn vector recentering
   virtual void AttachInput(TList *list);
+  virtual void AttachParameters(CorrectionParameterTable &&parameters);
+  virtual const CorrectionParameterTable *GetParameterTable() const {
+    return fParameters.IsInitialized() ? &fParameters : nullptr;
+  }
   /// Perform after calibration histograms attach actions
   /// It is used to inform the different correction step that
   /// all conditions for running the network are in place so
@@ -133,10 +154,22 @@ class Recentering : public CorrectionOnQnVector {
   virtual void AttachNveQAHistograms(TList *list);
   virtual Bool_t ProcessCorrections();
   virtual Bool_t ProcessDataCollection();
+  virtual void ProcessCorrectionsBatch(CorrectionBase *const *steps, unsigned char *active, std::size_t n) {
+    BatchProcessCorrections<Recentering>(steps, active, n);
+  }
+  virtual void ProcessDataCollectionBatch(CorrectionBase *const *steps, unsigned char *active, std::size_t n) {
+    BatchProcessDataCollection<Recentering>(steps, active, n);
+  }
   virtual void ClearCorrectionStep();
+  virtual void UpdateHistograms();
+
+ protected:
+  virtual bool GetConvergenceParameters(std::vector<double> &parameters, std::vector<double> &scales) const;
 
  private:
   using State = Qn::CorrectionBase::State;
+  void FillParameterTable();
+  bool ApplyRunningAverages();
   static constexpr const unsigned int
       szPriority = CorrectionOnQnVector::Step::kRecentering; ///< the key of the correction step for ordering purpose
   static const Int_t fDefaultMinNoOfEntries;         ///< the minimum number of entries for bin content validation
@@ -152,11 +185,14 @@ class Recentering : public CorrectionOnQnVector {
       fQANotValidatedBin;     //!<! the histogram with non validated bin information
   std::unique_ptr<CorrectionProfileComponents>
       fQAQnAverageHistogram;  //!<! the after correction step average Qn components QA histogram
+  CorrectionParameterTable fParameters; //!<! the means and widths of each event class and harmonic
   Bool_t fApplyWidthEqualization;               ///< apply the width equalization step
   Int_t fMinNoOfEntriesToValidate;              ///< number of entries for bin content validation threshold
+  Int_t fOnlineWarmUpEntries = 0;               ///< entries of an event class before the online averages are applied
+  Bool_t fOnlineApplied = kFALSE;               //!<! the online averages were applied to the current event
 
 /// \cond CLASSIMP
- ClassDef(Recentering, 3);
+ ClassDef(Recentering, 4);
 /// \endcond
 };
 }
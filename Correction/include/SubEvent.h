@@ -16,6 +16,7 @@
 ///
 
 #include <map>
+#include <vector>
 
 #include "TObject.h"
 #include "TList.h"
@@ -25,10 +26,13 @@
 #include "TObjString.h"
 
 #include "CorrectionsSet.h"
+#include "CorrectionChain.h"
 #include "CorrectionAxisSet.h"
 #include "QVector.h"
-#include "CorrectionDataVector.h"
+#include "CorrectionDataBank.h"
 #include "CorrectionProfileComponents.h"
+#include "CorrectionQASampling.h"
+#include "CorrectionInstrumentation.h"
 
 namespace Qn {
 class Detector;
@@ -56,6 +60,10 @@ class Detector;
 ///
 /// The class is a base class for further refined detector configurations.
 ///
+/// Each sub event of a differential detector owns its calibration histograms, which are written to a list named
+/// after the sub event. The layout is kept, such that the calibration files of earlier productions can be read.
+/// The lists are hashed when they are read, such that they are found without scanning (see MakeHashedList).
+///
 /// \author Jaap Onderwaater <jacobus.onderwaater@cern.ch>, GSI
 /// \author Ilya Selyuzhenkov <ilya.selyuzhenkov@gmail.com>, GSI
 /// \author Víctor González <victor.gonzalez@cern.ch>, UCM
@@ -89,7 +97,7 @@ class SubEvent {
   /// Get the input data bank.
   /// Makes it available for input corrections steps.
   /// \return pointer to the input data bank
-  std::vector<Qn::CorrectionDataVector> &GetInputDataBank() { return fDataVectorBank; }
+  CorrectionDataBank &GetInputDataBank() { return fDataVectorBank; }
   /// Get the event class variables set
   /// Makes it available for corrections steps
   /// \return pointer to the event class variables set
@@ -114,6 +122,13 @@ class SubEvent {
   /// Makes it available for correction steps which need it.
   /// \return pointer to the plain Qn vector instance
   const QVector &GetPlainQ2nVector() const { return fPlainQ2nVector; }
+  /// Request the construction of the Q2n vectors
+  /// Has to be called by correction steps which use the Q2n vectors, otherwise
+  /// they are not built to save the processing time.
+  void RequireQ2nVector() { fQ2nVectorRequired = true; }
+  /// Get if the Q2n vectors are built
+  /// \return TRUE if a correction step requested the Q2n vectors
+  bool IsQ2nVectorRequired() const { return fQ2nVectorRequired; }
   /// Update the current Qn vector
   /// Update towards what is the latest values of the Qn vector after executing a
   /// correction step to make it available to further steps.
@@ -135,6 +150,17 @@ class SubEvent {
   /// \return the stored pointer to the corrections framework
   Detector *GetDetector() const { return fDetector; }
   void SetDetector(Detector *det) { fDetector = det; }
+  /// Set the sampling of the QA histograms
+  /// \param sampling the sampling shared by all sub events. Lifetime is managed by the detector list.
+  void SetQASampling(const CorrectionQASampling *sampling) { fQASampling = sampling; }
+  /// Checks if the calibration QA histograms are filled in the current event
+  Bool_t IsCalibrationQAFilled() const {
+    return !fQASampling || fQASampling->IsFilled(CorrectionQASampling::Category::kCalibration);
+  }
+  /// Checks if the bin validation QA histograms are filled in the current event
+  Bool_t IsValidationQAFilled() const {
+    return !fQASampling || fQASampling->IsFilled(CorrectionQASampling::Category::kValidation);
+  }
   /// Get if the detector configuration is own by a tracking detector
   /// Pure virtual function
   /// \return TRUE if it is a tracking detector configuration
@@ -155,6 +181,19 @@ class SubEvent {
 
   virtual void CopyToOutputList(TList* list) = 0;
 
+  /// Copies the accumulated content of the profiles into their histograms
+  ///
+  /// The request is transmitted to the different corrections.
+  /// To be called before the histograms are merged or stored.
+  virtual void UpdateHistograms() {
+    if (fQAQnAverageHistogram) fQAQnAverageHistogram->UpdateHistograms();
+    fQnVectorCorrections.UpdateHistograms();
+  }
+
+  /// Reports if all correction steps collecting data stopped because their parameters converged
+  /// \return false if a correction step is still collecting data
+  virtual bool IsCollectionConverged() const { return fQnVectorCorrections.IsCollectionConverged(); }
+
   /// Asks for QA histograms creation
   ///
   /// The request is transmitted to the different corrections.
@@ -178,6 +217,18 @@ class SubEvent {
   /// \param list list where the input information should be found
   /// \return kTRUE if everything went OK
   virtual void AttachCorrectionInput(TList *list) = 0;
+  /// Asks for attaching the final correction parameters of a calibration file to the correction steps
+  ///
+  /// Pure virtual function
+  /// \param file the calibration file
+  /// \param run the name of the current run
+  virtual void AttachCorrectionInput(const CorrectionCalibrationFile &file, const std::string &run) = 0;
+  /// Writes the final parameters of the correction steps being applied to a calibration file
+  /// \param writer the calibration file writer
+  /// \param run the name of the current run
+  virtual void WriteCorrectionParameters(CorrectionCalibrationWriter &writer, const std::string &run) const {
+    fQnVectorCorrections.WriteParameters(writer, run, GetName());
+  }
   /// Perform after calibration histograms attach actions
   /// It is used to inform the different correction step that
   /// all conditions for running the network are in place so
@@ -197,6 +248,32 @@ class SubEvent {
   /// The request is transmitted to the correction steps
   /// \return kTRUE if everything went OK
   virtual Bool_t ProcessDataCollection() = 0;
+
+  /// \struct Batch
+  /// \brief The sub events of a detector with their correction steps ordered by step
+  ///
+  /// All sub events of a detector are of the same type and own copies of
+  /// the same correction steps, such that each step is processed for all
+  /// sub events at once instead of walking the chain of each sub event.
+  struct Batch {
+    std::vector<SubEvent *> events; ///< the sub events
+    std::vector<std::vector<CorrectionBase *>> input_steps; ///< the input data correction steps [step][sub event]
+    std::vector<std::vector<CorrectionBase *>> qn_steps; ///< the Q vector correction steps [step][sub event]
+    std::vector<unsigned char> active; ///< the previous correction steps of the sub event were applied
+    std::vector<unsigned char> touched; ///< the sub event received data in the current event and is processed
+    CorrectionInstrumentation *instrumentation = nullptr; ///< times the correction steps if not nullptr
+    std::vector<std::size_t> input_step_counters; ///< counters of the input data correction steps [2*step + collection]
+    std::vector<std::size_t> qn_step_counters; ///< counters of the Q vector correction steps [2*step + collection]
+    const CorrectionChain *qn_chain = nullptr; ///< processes the Q vector correction steps if not nullptr
+  };
+  /// Adds the sub event and its correction steps to a batch
+  /// \param batch the batch of the sub events of the detector
+  virtual void AddToBatch(Batch &batch) {
+    batch.events.push_back(this);
+    batch.active.push_back(0);
+    batch.touched.push_back(0);
+    AddToBatch(fQnVectorCorrections, batch.qn_steps);
+  }
   virtual void ActivateHarmonic(Int_t harmonic);
   virtual void AddCorrectionOnQnVector(CorrectionOnQnVector *correctionOnQn);
   virtual void AddCorrectionOnInputData(CorrectionOnInputData *correctionOnInputData);
@@ -207,6 +284,9 @@ class SubEvent {
   /// approach so, the built Q vectors are the ones to be used for
   /// subsequent corrections.
   void BuildQnVector();
+  /// Fills the plain Qn vector, and the Q2n vector if required, from the data vector bank
+  /// using the equalized weights
+  virtual void FillPlainQnVectors();
 //  /// Include the list of associated Qn vectors into the passed list
 //  ///
 //  /// Pure virtual function
@@ -232,13 +312,17 @@ class SubEvent {
 
   /**
    * Adds a data vector to the sub event.
-   * @tparam Args type of the arguments of the CorrectionDataVector constructor.
-   * @param args arguments of the CorrectionDataVector constructor.
+   * @param id id of the channel
+   * @param phi azimuthal angle of the channel or track
+   * @param weight weight applied to the channel or track
+   * @param radial_offset radial offset of the channel
    */
-  template<typename... Args>
-  void AddDataVector(Args &&... args) {
-    fDataVectorBank.emplace_back(std::forward<Args>(args)...);
+  void AddDataVector(int id, float phi, float weight, float radial_offset) {
+    fDataVectorBank.Add(id, phi, weight, radial_offset);
   }
+  /// Reserves space in the data vector bank for additional data vectors
+  /// \param n the number of data vectors to be added
+  void ReserveDataVectors(std::size_t n) { fDataVectorBank.Reserve(n); }
   /// Clean the configuration to accept a new event
   /// Pure virtual function
   virtual void Clear() = 0;
@@ -272,15 +356,79 @@ class SubEvent {
   }
 
  protected:
+  /// Adds correction steps to the steps of a batch
+  /// \param corrections the correction steps of the sub event
+  /// \param steps the correction steps of the batch [step][sub event]
+  template<typename SET>
+  static void AddToBatch(const SET &corrections, std::vector<std::vector<CorrectionBase *>> &steps) {
+    std::size_t istep = 0;
+    for (const auto &correction : corrections) {
+      if (steps.size()==istep) steps.emplace_back();
+      steps[istep++].push_back(correction.get());
+    }
+  }
+  /// Processes the correction steps of a batch step by step
+  /// \param steps the correction steps of the batch [step][sub event]
+  /// \param active flags of the sub events whose previous steps were applied
+  /// \param instrumentation times the steps if not nullptr
+  /// \param counters counters of the steps in the instrumentation [2*step + collection]
+  static void ProcessBatchCorrections(std::vector<std::vector<CorrectionBase *>> &steps,
+                                      std::vector<unsigned char> &active,
+                                      CorrectionInstrumentation *instrumentation,
+                                      const std::vector<std::size_t> &counters) {
+    for (std::size_t istep = 0; istep < steps.size(); ++istep) {
+      CorrectionInstrumentation::ScopedTimer timer(instrumentation, instrumentation ? counters[2*istep] : 0);
+      auto &step = steps[istep];
+      step.front()->ProcessCorrectionsBatch(step.data(), active.data(), step.size());
+    }
+  }
+  /// Processes the data collection of the correction steps of a batch step by step
+  /// \param steps the correction steps of the batch [step][sub event]
+  /// \param active flags of the sub events whose previous steps were applied
+  /// \param instrumentation times the steps if not nullptr
+  /// \param counters counters of the steps in the instrumentation [2*step + collection]
+  static void ProcessBatchDataCollection(std::vector<std::vector<CorrectionBase *>> &steps,
+                                         std::vector<unsigned char> &active,
+                                         CorrectionInstrumentation *instrumentation,
+                                         const std::vector<std::size_t> &counters) {
+    for (std::size_t istep = 0; istep < steps.size(); ++istep) {
+      CorrectionInstrumentation::ScopedTimer timer(instrumentation, instrumentation ? counters[2*istep + 1] : 0);
+      auto &step = steps[istep];
+      step.front()->ProcessDataCollectionBatch(step.data(), active.data(), step.size());
+    }
+  }
+  /// Processes the Q vector correction steps of a batch
+  ///
+  /// The correction chain of the batch is used if available. The steps are
+  /// processed one by one if they are timed by the instrumentation.
+  /// \param batch the sub events of the detector
+  static void ProcessBatchQnCorrections(Batch &batch) {
+    if (batch.qn_chain && !batch.instrumentation) {
+      batch.qn_chain->ProcessCorrections(batch.qn_steps, batch.active.data(), batch.active.size());
+    } else {
+      ProcessBatchCorrections(batch.qn_steps, batch.active, batch.instrumentation, batch.qn_step_counters);
+    }
+  }
+  /// Processes the data collection of the Q vector correction steps of a batch
+  /// \param batch the sub events of the detector
+  static void ProcessBatchQnDataCollection(Batch &batch) {
+    if (batch.qn_chain && !batch.instrumentation) {
+      batch.qn_chain->ProcessDataCollection(batch.qn_steps, batch.active.data(), batch.active.size());
+    } else {
+      ProcessBatchDataCollection(batch.qn_steps, batch.active, batch.instrumentation, batch.qn_step_counters);
+    }
+  }
   unsigned int binid_;
   Detector *fDetector = nullptr;
-  std::vector<Qn::CorrectionDataVector> fDataVectorBank; //!<! input data for the current process / event
+  const CorrectionQASampling *fQASampling = nullptr; //!<! sampling of the QA histograms
+  CorrectionDataBank fDataVectorBank; //!<! input data for the current process / event
   QVector fPlainQnVector;      ///< Qn vector from the post processed input data
   QVector fPlainQ2nVector;     ///< Q2n vector from the post processed input data
   QVector fCorrectedQnVector;  ///< Qn vector after subsequent correction steps
   QVector fCorrectedQ2nVector; ///< Q2n vector after subsequent correction steps
   QVector fTempQnVector;  ///< temporary Qn vector for efficient Q vector building
   QVector fTempQ2nVector; ///< temporary Qn vector for efficient Q vector building
+  bool fQ2nVectorRequired = false; //!<! build the Q2n vectors, because a correction step uses them
   std::map<QVector::CorrectionStep, QVector *> qvectors_;
   CorrectionsSetOnQvector fQnVectorCorrections; ///< set of corrections to apply on Q vectors
   const CorrectionAxisSet *fEventClassVariables = nullptr; //-> /// set of variables that define event classes
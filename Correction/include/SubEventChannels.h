@@ -17,7 +17,7 @@
 
 #include "CorrectionsSet.h"
 #include "SubEvent.h"
-#include "CorrectionDataVector.h"
+#include "CorrectionDataBank.h"
 
 namespace Qn {
 class CorrectionProfileComponents;
@@ -82,10 +82,18 @@ class SubEventChannels : public SubEvent {
   }
 
   void BuildRawQnVector();
+  virtual void FillPlainQnVectors();
 
   virtual void CreateSupportQVectors();
   virtual void CreateCorrectionHistograms();
   virtual void CopyToOutputList(TList* list);
+  virtual void UpdateHistograms() {
+    SubEvent::UpdateHistograms();
+    fInputDataCorrections.UpdateHistograms();
+  }
+  virtual bool IsCollectionConverged() const {
+    return fInputDataCorrections.IsCollectionConverged() && SubEvent::IsCollectionConverged();
+  }
   virtual void AttachQAHistograms(TList *list);
   virtual void AttachNveQAHistograms(TList *list);
 
@@ -96,9 +104,20 @@ class SubEventChannels : public SubEvent {
     fRawQnVector.ActivateHarmonic(harmonic);
   }
   virtual void AttachCorrectionInput(TList *list);
+  virtual void AttachCorrectionInput(const CorrectionCalibrationFile &file, const std::string &run);
+  virtual void WriteCorrectionParameters(CorrectionCalibrationWriter &writer, const std::string &run) const {
+    fInputDataCorrections.WriteParameters(writer, run, GetName());
+    SubEvent::WriteCorrectionParameters(writer, run);
+  }
   virtual void AfterInputAttachAction();
   virtual Bool_t ProcessCorrections();
   virtual Bool_t ProcessDataCollection();
+  static void ProcessCorrections(Batch &batch);
+  static void ProcessDataCollection(Batch &batch);
+  virtual void AddToBatch(Batch &batch) {
+    SubEvent::AddToBatch(batch);
+    SubEvent::AddToBatch(fInputDataCorrections, batch.input_steps);
+  }
   virtual void AddCorrectionOnInputData(CorrectionOnInputData *correctionOnInputData);
   virtual void IncludeQnVectors();
   virtual void FillOverallInputCorrectionStepList(std::set<CorrectionBase *> &set) const;
@@ -126,6 +145,14 @@ class SubEventChannels : public SubEvent {
   Float_t *fHardCodedGroupWeights = nullptr;         //[fNoOfChannels]  /// array, group hard coded weight
   CorrectionsSetOnInputData fInputDataCorrections; ///< set of corrections to apply on input data vectors
 
+  void UpdateHarmonicTable();
+  void AddFromHarmonicTable(QVector &qvector, QVector *doubled, Bool_t equalized);
+  std::vector<Double_t> fHarmonicTable; //!<! cos and sin of the harmonics for each channel, one column per component
+  std::vector<Float_t> fHarmonicTablePhi; //!<! the azimuth of each channel at the time its harmonics were computed
+  std::vector<Double_t> fHarmonicTableWeights; //!<! the weight of each channel in the current event
+  std::vector<Double_t> fHarmonicTableSums; //!<! the weighted sums of each column of the table
+  unsigned long fHarmonicTableLayout = ~0UL; //!<! the harmonics the table has been computed for
+
   /* QA section */
   void FillQAHistograms();
   static const char *szQAMultiplicityHistoName; ///< QA multiplicity histograms name
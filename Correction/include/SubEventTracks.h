@@ -15,9 +15,10 @@
 /// \brief Track detector configuration class for Q vector correction framework
 ///
 
+#include <algorithm>
 #include <iostream>
 
-#include "CorrectionDataVector.h"
+#include "CorrectionDataBank.h"
 #include "SubEvent.h"
 namespace Qn {
 class CorrectionProfileComponents;
@@ -54,10 +55,13 @@ class SubEventTracks : public SubEvent {
   virtual void AttachQAHistograms(TList *list);
   virtual void AttachNveQAHistograms(TList *list);
   virtual void AttachCorrectionInput(TList *list);
+  virtual void AttachCorrectionInput(const CorrectionCalibrationFile &file, const std::string &run);
   virtual void AfterInputAttachAction();
 
   virtual Bool_t ProcessCorrections();
   virtual Bool_t ProcessDataCollection();
+  static void ProcessCorrections(Batch &batch);
+  static void ProcessDataCollection(Batch &batch);
 
   virtual void IncludeQnVectors();
   virtual void FillOverallInputCorrectionStepList(std::set<CorrectionBase *> &set) const;
@@ -92,7 +96,7 @@ inline void SubEventTracks::Clear() {
   fCorrectedQnVector.Reset();
   fCorrectedQ2nVector.Reset();
   /* and now clear the the input data bank */
-  fDataVectorBank.clear();
+  fDataVectorBank.Clear();
 }
 
 /// Ask for processing corrections for the involved detector configuration
@@ -115,6 +119,20 @@ inline Bool_t SubEventTracks::ProcessCorrections() {
   return kTRUE;
 }
 
+/// Processes the corrections of all sub events of a detector
+///
+/// Same as ProcessCorrections for each sub event, but each correction step
+/// is processed for all sub events before the next one. Only the sub events
+/// which received data in the current event are processed.
+/// \param batch the sub events of the detector
+inline void SubEventTracks::ProcessCorrections(Batch &batch) {
+  for (std::size_t i = 0; i < batch.events.size(); ++i) {
+    if (batch.touched[i]) static_cast<SubEventTracks *>(batch.events[i])->BuildQnVector();
+  }
+  std::copy(batch.touched.begin(), batch.touched.end(), batch.active.begin());
+  ProcessBatchQnCorrections(batch);
+}
+
 /// Ask for processing corrections data collection for the involved detector configuration
 /// Fill own QA histogram information and then
 /// the request is transmitted to the Q vector correction steps.
@@ -133,5 +151,15 @@ inline Bool_t SubEventTracks::ProcessDataCollection() {
   /* all correction steps were applied */
   return kTRUE;
 }
+
+/// Processes the corrections data collection of all sub events of a detector
+/// \param batch the sub events of the detector
+inline void SubEventTracks::ProcessDataCollection(Batch &batch) {
+  for (std::size_t i = 0; i < batch.events.size(); ++i) {
+    if (batch.touched[i]) static_cast<SubEventTracks *>(batch.events[i])->FillQAHistograms();
+  }
+  std::copy(batch.touched.begin(), batch.touched.end(), batch.active.begin());
+  ProcessBatchQnDataCollection(batch);
+}
 }
 #endif // QNCORRECTIONS_DETECTORCONFTRACKS_H
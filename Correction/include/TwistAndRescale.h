@@ -83,6 +83,7 @@
 /* harmonic multiplier */
 
 #include "CorrectionOnQnVector.h"
+#include "CorrectionParameterTable.h"
 namespace Qn {
 /// \class QnCorrectionsQnVectorTwistAndRescale
 /// \brief Encapsulates twist and rescale on Q vector
@@ -177,7 +178,25 @@ class TwistAndRescale : public CorrectionOnQnVector {
   /// Set the minimum number of entries for calibration histogram bin content validation
   /// \param nNoOfEntries the number of entries threshold
   void SetNoOfEntriesThreshold(Int_t nNoOfEntries) { fMinNoOfEntriesToValidate = nNoOfEntries; }
+  virtual std::vector<std::string> GetReferencedDetectors() const {
+    if (fTwistAndRescaleMethod!=Method::CORRELATIONS) return {};
+    return {fBDetectorConfigurationName, fCDetectorConfigurationName};
+  }
+  virtual void WriteSettings(std::ostream &stream) const {
+    CorrectionOnQnVector::WriteSettings(stream);
+    stream << ' ' << static_cast<int>(fTwistAndRescaleMethod) << ' ' << fApplyTwist << ' ' << fApplyRescale << ' '
+           << fBDetectorConfigurationName << ' ' << fCDetectorConfigurationName << ' ' << fMinNoOfEntriesToValidate;
+  }
+  /// The correlations method reads the provided harmonics from the reference detectors
+  virtual std::bitset<QVector::kmaxharmonics> GetRequiredReferenceHarmonics() const {
+    if (fTwistAndRescaleMethod!=Method::CORRELATIONS) return {};
+    return fHarmonics;
+  }
   virtual void AttachInput(TList *list);
+  virtual void AttachParameters(CorrectionParameterTable &&parameters);
+  virtual const CorrectionParameterTable *GetParameterTable() const {
+    return fParameters.IsInitialized() ? &fParameters : nullptr;
+  }
   virtual void AfterInputAttachAction();
   virtual void CreateSupportQVectors();
   virtual void CreateCorrectionHistograms();
@@ -185,7 +204,14 @@ class TwistAndRescale : public CorrectionOnQnVector {
   virtual void AttachNveQAHistograms(TList *list);
   virtual Bool_t ProcessCorrections();
   virtual Bool_t ProcessDataCollection();
+  virtual void ProcessCorrectionsBatch(CorrectionBase *const *steps, unsigned char *active, std::size_t n) {
+    BatchProcessCorrections<TwistAndRescale>(steps, active, n);
+  }
+  virtual void ProcessDataCollectionBatch(CorrectionBase *const *steps, unsigned char *active, std::size_t n) {
+    BatchProcessDataCollection<TwistAndRescale>(steps, active, n);
+  }
   virtual void ClearCorrectionStep();
+  virtual void UpdateHistograms();
   virtual void IncludeCorrectedQnVector(std::map<QVector::CorrectionStep, QVector *> &qvectors) const;
   virtual void IncludeCorrectionStep(std::vector<QVector::CorrectionStep> &steps) {
     if (fApplyRescale) {
@@ -196,8 +222,12 @@ class TwistAndRescale : public CorrectionOnQnVector {
     }
   }
 
+ protected:
+  virtual bool GetConvergenceParameters(std::vector<double> &parameters, std::vector<double> &scales) const;
+
  private:
   using State = Qn::CorrectionBase::State;
+  void FillParameterTable();
   static constexpr const unsigned int szPriority =
       CorrectionOnQnVector::Step::kTwistAndRescale; ///< the key of the correction step for ordering purpose
   static const Int_t fDefaultMinNoOfEntries;         ///< the minimum number of entries for bin content validation
@@ -231,6 +261,7 @@ class TwistAndRescale : public CorrectionOnQnVector {
       fQATwistQnAverageHistogram; //!<! the after twist correction step average Qn components QA histogram
   std::unique_ptr<CorrectionProfileComponents>
       fQARescaleQnAverageHistogram; //!<! the after rescale correction step average Qn components QA histogram
+  CorrectionParameterTable fParameters; //!<! the twist and rescale parameters of each event class and harmonic
 
   Method fTwistAndRescaleMethod;  ///< the chosen method for extracting twist and rescale correction parameters
   Bool_t fApplyTwist;              ///< apply the twist step
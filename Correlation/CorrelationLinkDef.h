@@ -21,6 +21,10 @@
 #pragma link C++ nestedclass;
 #pragma link C++ nestedtypedef;
 
+#pragma link C++ class Qn::Correlation::CorrelationBooking+;
+#pragma link C++ function Qn::Correlation::BookPrecompiled;
+#pragma link C++ function Qn::Correlation::RegisterPrecompiled;
+
 
 
 #endif
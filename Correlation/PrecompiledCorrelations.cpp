@@ -0,0 +1,118 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PrecompiledCorrelations.h"
+
+#include <stdexcept>
+
+namespace Qn {
+namespace Correlation {
+
+FLOW_PRECOMPILED_CORRELATIONS()
+
+namespace {
+template<std::size_t NInputs, std::size_t NAxes>
+ROOT::RDF::RResultPtr<Qn::DataContainerStats> Book(ROOT::RDF::RNode &df,
+                                                   TTreeReader &reader,
+                                                   const CorrelationBooking &booking,
+                                                   QVectorFunction<NInputs> function) {
+  return Impl::BookCorrelation(df, reader, booking, std::move(function),
+                               std::make_index_sequence<NAxes>(), std::make_index_sequence<NInputs>());
+}
+
+/**
+ * Books the precompiled correlation with the number of event axes of the booking.
+ */
+template<std::size_t NInputs>
+ROOT::RDF::RResultPtr<Qn::DataContainerStats> BookAxes(ROOT::RDF::RNode &df,
+                                                       TTreeReader &reader,
+                                                       const CorrelationBooking &booking,
+                                                       QVectorFunction<NInputs> function) {
+  if (!function) {
+    throw std::invalid_argument("The correlation " + std::string(booking.GetName()) + " has no function.");
+  }
+  if (booking.GetInputNames().size()!=NInputs) {
+    throw std::invalid_argument("The correlation " + std::string(booking.GetName()) + " has "
+                                    + std::to_string(booking.GetInputNames().size()) + " inputs, but the function "
+                                    + std::to_string(NInputs) + ".");
+  }
+  switch (booking.GetEventAxes().size()) {
+    case 1: return Book<NInputs, 1>(df, reader, booking, std::move(function));
+    case 2: return Book<NInputs, 2>(df, reader, booking, std::move(function));
+    case 3: return Book<NInputs, 3>(df, reader, booking, std::move(function));
+    default:
+      throw std::invalid_argument("The correlation " + std::string(booking.GetName()) + " needs between 1 and "
+                                      + std::to_string(kMaxPrecompiledAxes) + " event axes to be precompiled.");
+  }
+}
+
+template<std::size_t NInputs>
+void Register(const std::string &key, QVectorFunction<NInputs> function) {
+  CorrelationRegistry::Instance().RegisterBooker(key, [function](ROOT::RDF::RNode &df,
+                                                                 TTreeReader &reader,
+                                                                 const CorrelationBooking &booking) {
+    return BookAxes<NInputs>(df, reader, booking, function);
+  });
+}
+}
+
+ROOT::RDF::RResultPtr<Qn::DataContainerStats> BookPrecompiled(ROOT::RDF::RNode df,
+                                                              TTreeReader &reader,
+                                                              const CorrelationBooking &booking,
+                                                              QVectorFunction<1> function) {
+  return BookAxes<1>(df, reader, booking, std::move(function));
+}
+
+ROOT::RDF::RResultPtr<Qn::DataContainerStats> BookPrecompiled(ROOT::RDF::RNode df,
+                                                              TTreeReader &reader,
+                                                              const CorrelationBooking &booking,
+                                                              QVectorFunction<2> function) {
+  return BookAxes<2>(df, reader, booking, std::move(function));
+}
+
+ROOT::RDF::RResultPtr<Qn::DataContainerStats> BookPrecompiled(ROOT::RDF::RNode df,
+                                                              TTreeReader &reader,
+                                                              const CorrelationBooking &booking,
+                                                              QVectorFunction<3> function) {
+  return BookAxes<3>(df, reader, booking, std::move(function));
+}
+
+ROOT::RDF::RResultPtr<Qn::DataContainerStats> BookPrecompiled(ROOT::RDF::RNode df,
+                                                              TTreeReader &reader,
+                                                              const CorrelationBooking &booking,
+                                                              QVectorFunction<4> function) {
+  return BookAxes<4>(df, reader, booking, std::move(function));
+}
+
+void RegisterPrecompiled(const std::string &key, QVectorFunction<1> function) {
+  Register<1>(key, std::move(function));
+}
+
+void RegisterPrecompiled(const std::string &key, QVectorFunction<2> function) {
+  Register<2>(key, std::move(function));
+}
+
+void RegisterPrecompiled(const std::string &key, QVectorFunction<3> function) {
+  Register<3>(key, std::move(function));
+}
+
+void RegisterPrecompiled(const std::string &key, QVectorFunction<4> function) {
+  Register<4>(key, std::move(function));
+}
+
+}
+}
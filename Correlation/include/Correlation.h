@@ -17,21 +17,82 @@
 #ifndef FLOW_DATAFRAMECORRELATION_H
 #define FLOW_DATAFRAMECORRELATION_H
 
+#include <algorithm>
+#include <array>
 #include <functional>
 #include <cstring>
 #include <type_traits>
+#include <vector>
 
 #include "ROOT/RIntegerSequence.hxx"
 #include "ROOT/RDataFrame.hxx"
+#ifdef R__USE_IMT
+#include "ROOT/TThreadExecutor.hxx"
+#endif
 
 #include "Stats.h"
 #include "TTreeReader.h"
 #include "DataContainer.h"
 #include "TemplateHelpers.h"
+#include "QVectorView.h"
+#include "CorrelationKernels.h"
+#include "FlatQVectorReader.h"
 
 namespace Qn {
 namespace Correlation {
 
+namespace Impl {
+/**
+ * Number of components of the result of a correlation function.
+ * Functions returning a std::array calculate several observables at once.
+ * @tparam Result result type of the correlation function
+ */
+template<typename Result>
+struct ResultComponents : std::integral_constant<std::size_t, 1> {};
+
+template<typename Element, std::size_t K>
+struct ResultComponents<std::array<Element, K>> : std::integral_constant<std::size_t, K> {};
+
+/**
+ * Type of the data container holding the inputs of an argument of a correlation function.
+ * Functions of QVectorGF arguments are calculated from the Q-vectors of the generic framework, all others from
+ * the Q-vectors of the type QVector.
+ * @tparam Argument argument type of the correlation function
+ */
+template<typename Argument>
+struct InputDataContainer { using type = Qn::DataContainerQVector; };
+
+template<>
+struct InputDataContainer<Qn::QVectorGF> { using type = Qn::DataContainerQVectorGF; };
+
+template<typename ArgumentTuple>
+struct InputDataContainers;
+
+template<typename... Arguments>
+struct InputDataContainers<std::tuple<Arguments...>> {
+  using type = std::tuple<typename InputDataContainer<Arguments>::type...>;
+};
+
+/**
+ * Reads the layout of an input from the user info of the tree, which is written by the correction manager.
+ * @tparam Container type of the input of the correlation
+ * @param reader reader of the tree
+ * @param name name of the input
+ * @param layout is set to the layout of the input, if it is found
+ * @return false if the tree has no layout of the input, e.g. if it was written by an older version.
+ */
+template<typename Container>
+bool ReadLayout(TTreeReader &reader, const std::string &name, Container &layout) {
+  auto tree = reader.GetTree();
+  if (!tree) return false;
+  tree->LoadTree(0);
+  auto found = FindOutputLayout<Container>(tree->GetTree()->GetUserInfo(), name);
+  if (!found) return false;
+  layout = Container(*found);
+  return true;
+}
+}
+
 template<typename Function, typename Qvectors, typename InputDataContainers>
 class Correlation;
 
@@ -40,30 +101,94 @@ class Correlation<Function, std::tuple<Qvectors...>, std::tuple<InputDataContain
  public:
   constexpr static std::size_t NInputs = sizeof...(Qvectors);
   using DataContainerTypeTuple = typename std::tuple<InputDataContainers...>;
+  using InputDataContainer = std::tuple_element_t<0, DataContainerTypeTuple>;
+  using InputQVector = typename InputDataContainer::value_type;
+  static_assert((std::is_same<InputDataContainer, InputDataContainers>::value && ...),
+                "All inputs of the correlation need to be of the same type.");
   using FunctionType = Function;
-  using CollelationHolder = std::vector<CorrelationResult>;
+  using CollelationHolder = CorrelationResultBuffer;
+  using ResultType = std::decay_t<typename TemplateHelpers::FunctionTraits<Function>::result_type>;
+  /**
+   * Number of observables calculated by the correlation function. Functions returning a std::array of K
+   * observables fill an additional component axis with K bins, which is the last axis of the correlation.
+   */
+  constexpr static std::size_t NComponents = Impl::ResultComponents<ResultType>::value;
+  /**
+   * Built-in kernels of Q-vectors are evaluated in batches over the bins of the first input.
+   */
+  constexpr static bool kBatched = Impl::IsBatchKernel<Function>::value && std::is_same<InputQVector, QVector>::value;
 
   explicit Correlation(Function function) : function_(function) {}
 
   void Initialize(TTreeReader &reader) {
-    std::vector<TTreeReaderValue<DataContainerQVector>> input_data;
-    for (auto name : input_names_) {
-      input_data.emplace_back(reader, name.data());
+    // the binning and the harmonics are read from the layouts in the user info of the tree without reading events.
+    // Only inputs of trees without layouts are read from the first entry.
+    std::vector<TTreeReaderValue<InputDataContainer>> input_data;
+    std::vector<InputDataContainer> layouts(NInputs);
+    std::array<bool, NInputs> has_layout{};
+    for (std::size_t i = 0; i < NInputs; ++i) {
+      has_layout[i] = Impl::ReadLayout(reader, input_names_[i], layouts[i]);
+      if (!has_layout[i]) input_data.emplace_back(reader, input_names_[i].data());
     }
-    reader.SetLocalEntry(1);
-    for (std::size_t i = 0; i < input_data.size(); ++i) {
-      auto &i_data = input_data[i];
+    if (!input_data.empty()) reader.SetLocalEntry(1);
+    std::array<const InputDataContainer *, NInputs> inputs;
+    auto value = input_data.begin();
+    for (std::size_t i = 0; i < NInputs; ++i) {
+      if (has_layout[i]) {
+        inputs[i] = &layouts[i];
+        continue;
+      }
+      auto &i_data = *value++;
       if (i_data.GetSetupStatus() < 0) {
         auto message = std::string("The Q-Vector entry") +
             i_data.GetBranchName() + "in the tree is not valid. Cannot setup the correlation";
         throw std::runtime_error(message);
       }
-      if (!i_data->IsIntegrated()) {
-        AddAxes(input_data, i);
+      inputs[i] = i_data.Get();
+    }
+    Initialize(inputs);
+    if (!input_data.empty()) reader.Restart();
+  }
+
+  /**
+   * Initializes the correlation from the input data containers, e.g. the Q-vectors of the correction manager in the
+   * same event loop. Only the binning and the harmonics of the inputs are used.
+   * @param inputs input data containers in the order of the input names
+   */
+  void Initialize(const std::array<const InputDataContainer *, NInputs> &inputs) {
+    const std::array<bool (*)(const InputQVector &), NInputs>
+        harmonics_compatible = {&IsCompatible<Qvectors>...};
+    for (std::size_t i = 0; i < NInputs; ++i) {
+      if (inputs[i]->size() > 0 && !harmonics_compatible[i](inputs[i]->At(0))) {
+        auto message = std::string("The harmonics of the Q-Vector entry ") +
+            input_names_[i] + " do not match the Q-vector view of the correlation function.";
+        throw std::runtime_error(message);
+      }
+      if (!inputs[i]->IsIntegrated()) {
+        AddAxes(inputs, i);
       }
     }
-    correlation_result_.resize(data_container_correlation_.size());
-    reader.Restart();
+    BuildBinTables(inputs);
+    BuildMirrorBins(inputs);
+    if constexpr (kBatched) {
+      static_assert(NInputs > 1, "The batched kernels need a reference input.");
+      static_assert(Function::kNComponents==NComponents, "The components of the kernel do not match its result.");
+      for (std::size_t i = 0; i < NInputs; ++i) {
+        if (inputs[i]->size() > 0 && !inputs[i]->At(0).GetHarmonics().test(Function::kHarmonic - 1)) {
+          throw std::runtime_error("The Q-Vector entry " + input_names_[i] + " does not have the harmonic " +
+              std::to_string(Function::kHarmonic) + " of the correlation kernel.");
+        }
+      }
+      // the bins of the later inputs need to be independent of the bin of the first input.
+      // the symmetric inputs restrict the bins of the first input, if it is one of them.
+      batch_ = std::all_of(matched_position_.begin(), matched_position_.end(),
+                           [](const std::vector<std::size_t> &positions) { return positions.empty(); })
+          && !(symmetric_ && symmetric_first_==0);
+    }
+    if (NComponents > 1) {
+      data_container_correlation_.AddAxis({component_axis_name_, NComponents, 0., static_cast<double>(NComponents)});
+    }
+    correlation_result_.Resize(data_container_correlation_.size());
   }
 
   template<typename ...Names>
@@ -83,16 +208,122 @@ class Correlation<Function, std::tuple<Qvectors...>, std::tuple<InputDataContain
     }
   }
 
+  /**
+   * Declares axes as matched. Identical axes with one of these names, which are present in several inputs, are added
+   * only once to the correlation. Only the combinations of bins, in which the inputs are in the same bin of the
+   * matched axes, are evaluated. Needs to be called before the initialization.
+   * @param axis_names names of the matched axes
+   */
+  void SetMatchedAxes(std::vector<std::string> axis_names) {
+    matched_axes_ = std::move(axis_names);
+  }
+
+  /**
+   * Declares the correlation function symmetric under the exchange of two inputs with the same name. Only the
+   * combinations, in which the bin of the second input is not below the bin of the first input, are evaluated. The
+   * results of the other combinations are the ones of the combination with the bins of the inputs exchanged, see
+   * GetMirrorBin. Needs to be called before the initialization.
+   * @param first position of the first symmetric input
+   * @param second position of the second symmetric input
+   * @param diagonal evaluate the combinations, in which both inputs are in the same bin
+   */
+  void SetSymmetricInputs(const std::size_t first, const std::size_t second, const bool diagonal = true) {
+    if (!(first < second && second < NInputs)) {
+      throw std::out_of_range("The symmetric inputs need to be two different inputs of the correlation.");
+    }
+    symmetric_ = true;
+    symmetric_first_ = first;
+    symmetric_second_ = second;
+    symmetric_diagonal_ = diagonal;
+  }
+
+  /**
+   * Checks if a bin of the correlation is evaluated. The bins below the diagonal of symmetric inputs are not
+   * evaluated, nor is the diagonal itself if it is excluded.
+   * @param bin linear index in the correlation container
+   * @return true if the bin is filled by Correlate
+   */
+  bool IsEvaluated(const std::size_t bin) const { return evaluated_.empty() || evaluated_[bin/NComponents]; }
+
+  /**
+   * Returns the bin with the same result as a bin below the diagonal of symmetric inputs, in which the bins of the
+   * symmetric inputs are exchanged. Other bins are returned unchanged.
+   * @param bin linear index in the correlation container
+   * @return linear index of the evaluated bin
+   */
+  std::size_t GetMirrorBin(const std::size_t bin) const {
+    if (mirror_bin_.empty()) return bin;
+    return mirror_bin_[bin/NComponents]*NComponents + bin%NComponents;
+  }
+
+  /**
+   * Sets the name of the component axis of correlation functions returning several observables.
+   * Needs to be called before the initialization.
+   * @param name name of the component axis
+   */
+  void SetComponentAxisName(std::string name) {
+    component_axis_name_ = std::move(name);
+  }
+
   bool IsObservable() const {
     return std::any_of(std::begin(use_weights_), std::end(use_weights_),[](bool a){return a;});
   }
 
-  const CollelationHolder &Correlate(InputDataContainers... input) {
-    for (auto &bin : correlation_result_) { bin.validity = false; }
-    std::size_t output_bin = 0;
-    std::array<const Qn::QVector *, NInputs> q_vectors;
-    std::array<DataContainerQVector, NInputs> input_array = {input...};
-    IterateOverBins(output_bin, q_vectors, input_array, 0);
+  /**
+   * Splits the non-empty bins of the first input of an event into blocks, which are evaluated in parallel by the
+   * implicit multi-threading pool. The blocks fill disjoint bins of the result, such that no locking is needed.
+   * Only used if ROOT's implicit multi-threading is enabled and the first input is differential.
+   * @param n_blocks number of blocks. Disabled if below 2.
+   */
+  void SetParallelBlocks(const std::size_t n_blocks) {
+    parallel_blocks_ = n_blocks;
+#ifdef R__USE_IMT
+    // the pool is created once and shared by the copies of the correlation in the slots.
+    if (n_blocks > 1 && !pool_) pool_ = std::make_shared<ROOT::TThreadExecutor>();
+#endif
+  }
+
+  /**
+   * Calculates the correlation of the input Q-vectors of one event.
+   * The inputs are only referenced and not copied. In a first pass the non-empty bins of each input are collected.
+   * Only combinations of non-empty bins are evaluated. Batched kernels are evaluated for all non-empty bins of the
+   * first input at once. With parallel blocks the non-empty bins of the first input are split between the tasks.
+   * @param input input data containers of the Q-vectors
+   * @return correlation results of all bins of the correlation.
+   */
+  const CollelationHolder &Correlate(const InputDataContainers &... input) {
+    correlation_result_.Invalidate();
+    if (cursors_.empty()) cursors_.resize(1);
+    const std::array<const InputDataContainer *, NInputs> input_array = {{&input...}};
+    for (std::size_t i = 0; i < NInputs; ++i) {
+      const auto &container = *input_array[i];
+      if (container.size()!=output_offset_[i].size()) {
+        throw std::logic_error("The binning of the input Q-vectors does not match the correlation.");
+      }
+      // inputs with matched axes use the bins grouped by the matched axes instead.
+      if (!matched_position_[i].empty()) continue;
+      auto &bins = non_empty_bins_[i];
+      bins.clear();
+      for (std::size_t ibin = 0; ibin < container.size(); ++ibin) {
+        if (container[ibin].n() >= 1) bins.push_back(ibin);
+      }
+    }
+    bool batched = false;
+    if constexpr (kBatched) {
+      if (batch_ && !Pack(*input_array[0])) return correlation_result_;
+      batched = batch_;
+    }
+#ifdef R__USE_IMT
+    if (parallel_blocks_ > 1 && non_empty_bins_[0].size() > 1 && ROOT::IsImplicitMTEnabled()) {
+      CorrelateBlocks(input_array, batched);
+      return correlation_result_;
+    }
+#endif
+    auto &cursor = cursors_.front();
+    cursor.first = 0;
+    cursor.last = non_empty_bins_[0].size();
+    cursor.concurrent = false;
+    Visit(cursor, input_array, batched);
     return correlation_result_;
   }
 
@@ -107,7 +338,58 @@ class Correlation<Function, std::tuple<Qvectors...>, std::tuple<InputDataContain
 
  private:
 
-  double CalculateWeights(const std::array<const Qn::QVector *, NInputs> &q_array) const {
+  /**
+   * State of the iteration over the combinations of bins of one task.
+   */
+  struct Cursor {
+    std::array<const InputQVector *, NInputs> q_vectors{}; ///< Q-vectors of the current combination of bins
+    std::array<std::size_t, NInputs> bins{}; ///< bins of the inputs in the current combination
+    std::size_t first = 0; ///< first visited non-empty bin of the first input
+    std::size_t last = 0; ///< end of the visited non-empty bins of the first input
+    std::vector<double> packed_result; ///< results of the kernel for the visited packed bins
+    bool concurrent = false; ///< other tasks store results at the same time
+  };
+
+  /**
+   * Visits the combinations of bins with the visited bins of the first input of a cursor.
+   * @param cursor cursor of the task
+   * @param input_array pointers to the input data containers
+   * @param batched the bins of the first input are packed and evaluated by the batched kernel
+   */
+  void Visit(Cursor &cursor, const std::array<const InputDataContainer *, NInputs> &input_array, const bool batched) {
+    if constexpr (kBatched) {
+      if (batched) {
+        cursor.packed_result.resize((cursor.last - cursor.first)*NComponents);
+        IterateOverBins<1, true>(cursor, input_array, 0);
+        return;
+      }
+    }
+    (void) batched;
+    IterateOverBins<0, false>(cursor, input_array, 0);
+  }
+
+#ifdef R__USE_IMT
+  /**
+   * Evaluates blocks of the non-empty bins of the first input in parallel. The bins of the first input own their
+   * axes in the correlation, such that the blocks store their results into disjoint bins.
+   * @param input_array pointers to the input data containers
+   * @param batched the bins of the first input are packed and evaluated by the batched kernel
+   */
+  void CorrelateBlocks(const std::array<const InputDataContainer *, NInputs> &input_array, const bool batched) {
+    const auto n = non_empty_bins_[0].size();
+    const auto n_blocks = std::min(n, parallel_blocks_);
+    if (cursors_.size() < n_blocks) cursors_.resize(n_blocks);
+    pool_->Foreach([this, &input_array, batched, n, n_blocks](const unsigned int iblock) {
+      auto &cursor = cursors_[iblock];
+      cursor.first = iblock*n/n_blocks;
+      cursor.last = (iblock + 1)*n/n_blocks;
+      cursor.concurrent = true;
+      Visit(cursor, input_array, batched);
+    }, ROOT::TSeqU(n_blocks));
+  }
+#endif
+
+  double CalculateWeights(const std::array<const InputQVector *, NInputs> &q_array) const {
     int i = 0;
     double weight = 1.0;
     for (const auto &q : q_array) {
@@ -117,43 +399,215 @@ class Correlation<Function, std::tuple<Qvectors...>, std::tuple<InputDataContain
     return weight;
   }
 
-  void IterateOverBins(std::size_t &output_bin,
-                       std::array<const Qn::QVector *, NInputs> &q_array,
-                       const std::array<DataContainerQVector, NInputs> &input_array,
-                       std::size_t iteration) {
-    // ends recursive iteration over the data inputs
-    if (iteration + 1==NInputs) {
-      // iterates over all bins of the input data
-      for (const auto &bin : input_array[iteration]) {
-        // skips empty bins
-        if (bin.n() < 1) continue;
-        // save pointer to Q vector in an array
-        q_array[iteration] = &bin;
+  /**
+   * Packs the components of the harmonic of the kernel and the weights of the non-empty bins of the first input into
+   * contiguous arrays. All bins share the same harmonics, such that the storage position is resolved once.
+   * A template, such that it is only instantiated for kernels, e.g. not by the explicit instantiations.
+   * @tparam Kernel the batched kernel
+   * @param input first input
+   * @return false if the first input has no non-empty bins.
+   */
+  template<typename Kernel = Function>
+  bool Pack(const InputDataContainer &input) {
+    const auto &bins = non_empty_bins_[0];
+    const auto n = bins.size();
+    if (n==0) return false;
+    const auto position =
+        QVector::kHarmonicSlotTable[input[bins.front()].GetHarmonics().to_ulong()][Kernel::kHarmonic - 1];
+    packed_x_.resize(n);
+    packed_y_.resize(n);
+    packed_weight_.resize(n);
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto &q = input[bins[i]];
+      const auto component = Kernels::ScaleComponent(q.GetComponent(position), q, Kernel::kScale);
+      packed_x_[i] = component.x;
+      packed_y_[i] = component.y;
+      packed_weight_[i] = use_weights_[0] ? q.sumweights() : 1.;
+    }
+    return true;
+  }
+
+  /**
+   * Evaluates the kernel for the visited packed bins of the first input and the current combination of the bins of
+   * the other inputs.
+   * @param cursor cursor with the Q-vectors of the current combination of bins of the other inputs.
+   * @tparam Kernel the batched kernel
+   * @param offset linear index in the correlation container of the bins of the other inputs.
+   */
+  template<typename Kernel = Function>
+  void EvaluateBatch(Cursor &cursor, const std::size_t offset) {
+    const auto &q_array = cursor.q_vectors;
+    std::array<QVec, NInputs - 1> references;
+    double weight = 1.0;
+    for (std::size_t i = 1; i < NInputs; ++i) {
+      references[i - 1] = Kernels::Component(*q_array[i], Kernel::kHarmonic, Kernel::kScale);
+      if (use_weights_[i]) weight *= q_array[i]->sumweights();
+    }
+    const auto &bins = non_empty_bins_[0];
+    const auto first = cursor.first;
+    const auto n = cursor.last - first;
+    auto &result = cursor.packed_result;
+    function_.Evaluate(references, packed_x_.data() + first, packed_y_.data() + first, n, result.data());
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto output_bin = offset + output_offset_[0][bins[first + i]];
+      for (std::size_t icomponent = 0; icomponent < NComponents; ++icomponent) {
+        Store(cursor, output_bin*NComponents + icomponent, result[icomponent*n + i], packed_weight_[first + i]*weight);
+      }
+    }
+  }
+
+  /**
+   * Iterates over the non-empty bins of the input I and recursively over the following inputs.
+   * The recursion is resolved at compile time. The output bin is calculated from the bins of the inputs
+   * using the offsets of the bins in the correlation container. If the input has axes matched to the axes of a
+   * previous input, only the bins in the same bin of the matched axes are visited. Of the first input only the
+   * visited bins of the cursor are iterated.
+   * @tparam I position of the input
+   * @tparam Batch the bins of the first input are evaluated at once by the kernel after the last input.
+   * @param cursor cursor of the task holding the current combination of bins.
+   * @param input_array pointers to the input data containers
+   * @param offset linear index in the correlation container of the bins of the previous inputs.
+   */
+  template<std::size_t I, bool Batch>
+  void IterateOverBins(Cursor &cursor,
+                       const std::array<const InputDataContainer *, NInputs> &input_array,
+                       const std::size_t offset) {
+    auto &q_array = cursor.q_vectors;
+    auto visit = [&](const std::size_t ibin) {
+      // save pointer to Q vector in an array
+      q_array[I] = &(*input_array[I])[ibin];
+      cursor.bins[I] = ibin;
+      const auto output_bin = offset + output_offset_[I][ibin];
+      if constexpr (I + 1==NInputs && Batch) {
+        EvaluateBatch(cursor, output_bin);
+      } else if constexpr (I + 1==NInputs) {
         // calculate the output weight
         auto weight = CalculateWeights(q_array);
         // Apply the correlation function on the inputs saved in the array.
         // Save together with the weight and the validity in the output container in the  output bin.
-        correlation_result_[output_bin] = {TemplateHelpers::Call(function_, q_array), true, weight};
-        // increment output bin.
-        ++output_bin;
-      }
-      // ends the recursion
-      return;
-    }
-    // starts the recursion over the input data.
-    // iterates over all bins of the input data.
-    for (const auto &bin : input_array[iteration]) {
-      // skips empty bins
-      if (bin.n() < 1) continue;
-      // save pointer to Q vector in an array
-      q_array[iteration] = &bin;
-      // next step of recursion
-      IterateOverBins(output_bin, q_array, input_array, iteration + 1);
+        // Functions returning a CorrelationResult provide their own validity and event weight.
+        // Functions returning a std::array fill the bins of the component axis.
+        const auto result = TemplateHelpers::Call(function_, q_array);
+        if constexpr (NComponents > 1) {
+          for (std::size_t icomponent = 0; icomponent < NComponents; ++icomponent) {
+            Store(cursor, output_bin*NComponents + icomponent, result[icomponent], weight);
+          }
+        } else {
+          Store(cursor, output_bin, result, weight);
+        }
+      } else {
+        // next step of recursion
+        IterateOverBins<I + 1, Batch>(cursor, input_array, output_bin);
+      }
+    };
+    if (matched_position_[I].empty()) {
+      const auto &bins = non_empty_bins_[I];
+      auto first = bins.begin();
+      auto last = bins.end();
+      if (I==0) {
+        first = bins.begin() + cursor.first;
+        last = bins.begin() + cursor.last;
+      }
+      if (symmetric_ && I==symmetric_second_) {
+        // only the bins not below the bin of the first symmetric input are visited.
+        const auto lowest = cursor.bins[symmetric_first_] + (symmetric_diagonal_ ? 0 : 1);
+        first = std::lower_bound(bins.begin(), bins.end(), lowest);
+      }
+      for (auto ibin = first; ibin!=last; ++ibin) visit(*ibin);
+    } else {
+      // the bins of the matched axes are given by the previous inputs.
+      std::size_t group = 0;
+      for (const auto position : matched_position_[I]) {
+        group = group*axis_size_[position] + (offset/axis_stride_[position])%axis_size_[position];
+      }
+      const auto &bins = matched_bins_[I];
+      for (auto ibin = bins.first[group]; ibin < bins.first[group + 1]; ++ibin) {
+        if ((*input_array[I])[bins.bins[ibin]].n() >= 1) visit(bins.bins[ibin]);
+      }
+    }
+  }
+
+  /**
+   * Saves the result of the correlation function in the output bin.
+   * @param cursor cursor of the task
+   * @param output_bin linear index in the correlation container
+   * @param result value or correlation result returned by the correlation function
+   * @param weight weight of the inputs. Not used, if the function returns a CorrelationResult.
+   */
+  template<typename Result>
+  void Store(const Cursor &cursor, const std::size_t output_bin, const Result &result, const double weight) {
+    double value = 0.;
+    bool valid = true;
+    double event_weight = weight;
+    if constexpr (std::is_same<Result, CorrelationResult>::value) {
+      // the function provides the event weight, e.g. the number of weighted combinations, instead of the inputs.
+      value = result.result;
+      valid = result.validity;
+      event_weight = result.weight;
+    } else {
+      value = static_cast<double>(result);
+    }
+    if (cursor.concurrent) {
+      correlation_result_.SetConcurrent(output_bin, value, valid, event_weight);
+    } else {
+      correlation_result_.Set(output_bin, value, valid, event_weight);
+    }
+  }
+
+  /**
+   * Checks the compatibility of an input Q-vector with the argument of the correlation function.
+   * Only Q-vectors of the type QVector have a set of harmonics, which needs to be checked.
+   * @tparam Argument argument type of the correlation function
+   * @param q input Q-vector
+   * @return true if compatible.
+   */
+  template<typename Argument>
+  static bool IsCompatible(const InputQVector &q) {
+    if constexpr (std::is_same<InputQVector, Qn::QVector>::value) {
+      return Impl::QVectorArgument<Argument>::IsCompatible(q);
+    } else {
+      return true;
     }
   }
 
-  void AddAxes(std::vector<TTreeReaderValue<DataContainerQVector>> &data_containers, std::size_t i) {
+  /**
+   * Checks if an axis is declared as matched.
+   * @param name name of the axis
+   * @return true if the axis is matched.
+   */
+  bool IsMatched(const std::string &name) const {
+    return std::find(matched_axes_.begin(), matched_axes_.end(), name)!=matched_axes_.end();
+  }
+
+  void AddAxes(const std::array<const InputDataContainer *, NInputs> &data_containers, std::size_t i) {
     for (auto axis :data_containers[i]->GetAxes()) {
+      // A matched axis is only added by the first input containing it. The other inputs refer to it.
+      if (IsMatched(axis.Name())) {
+        bool found = false;
+        for (std::size_t j = 0; j < i && !found; ++j) {
+          if (data_containers[j]->IsIntegrated()) continue;
+          const auto &other_axes = data_containers[j]->GetAxes();
+          for (std::size_t k = 0; k < other_axes.size(); ++k) {
+            if (axis==other_axes[k]) {
+              if (!std::equal(axis.begin(), axis.end(), other_axes[k].begin(), other_axes[k].end())) {
+                throw std::logic_error("The matched axis " + axis.Name() + " of the inputs " + input_names_[j] +
+                    " and " + input_names_[i] + " has different bin edges.");
+              }
+              axis_position_[i].push_back(axis_position_[j][k]);
+              axis_owned_[i].push_back(false);
+              found = true;
+              break;
+            }
+          }
+        }
+        if (!found) {
+          axis_position_[i].push_back(axis_size_.size());
+          axis_owned_[i].push_back(true);
+          axis_size_.push_back(axis.size());
+          data_container_correlation_.AddAxis(axis);
+        }
+        continue;
+      }
       // default name of the axis.
       std::string name = axis.Name();
       // check all other inputs for an axis with the same name, or for another input with the same name.
@@ -164,8 +618,8 @@ class Correlation<Function, std::tuple<Qvectors...>, std::tuple<InputDataContain
           if (!other->IsIntegrated()) {
             for (const auto &other_axis :other->GetAxes()) {
               if (axis==other_axis) {
-                auto input_name = data_containers[i].GetBranchName();
-                if (std::strcmp(input_name, other.GetBranchName())==0) {
+                const auto &input_name = input_names_[i];
+                if (input_name==input_names_[j]) {
                   // Prepends the input position and name to the axis name if another identical input is present.
                   name = std::to_string(i) + "_" + input_name + "_" + axis.Name();
                 } else {
@@ -178,16 +632,145 @@ class Correlation<Function, std::tuple<Qvectors...>, std::tuple<InputDataContain
         }
       }
       // Renames the axis and adds it to the correlation container.
+      axis_position_[i].push_back(axis_size_.size());
+      axis_owned_[i].push_back(true);
+      axis_size_.push_back(axis.size());
       axis.SetName(name);
       data_container_correlation_.AddAxis(axis);
     }
   }
 
+  /**
+   * Calculates for each bin of the inputs the offset in the correlation container. For inputs with matched axes the
+   * bins are grouped by the bin of the matched axes.
+   * @param data_containers input data containers
+   */
+  void BuildBinTables(const std::array<const InputDataContainer *, NInputs> &data_containers) {
+    axis_stride_.assign(axis_size_.size(), 1);
+    for (auto iaxis = axis_size_.size(); iaxis > 1; --iaxis) {
+      axis_stride_[iaxis - 2] = axis_stride_[iaxis - 1]*axis_size_[iaxis - 1];
+    }
+    for (std::size_t i = 0; i < NInputs; ++i) {
+      const auto &positions = axis_position_[i];
+      const auto &owned = axis_owned_[i];
+      const std::size_t size = data_containers[i]->IsIntegrated() ? 1 : data_containers[i]->size();
+      std::size_t n_groups = 1;
+      matched_position_[i].clear();
+      for (std::size_t iaxis = 0; iaxis < positions.size(); ++iaxis) {
+        if (!owned[iaxis]) {
+          matched_position_[i].push_back(positions[iaxis]);
+          n_groups *= axis_size_[positions[iaxis]];
+        }
+      }
+      output_offset_[i].assign(size, 0);
+      std::vector<std::size_t> group(size, 0);
+      std::vector<std::size_t> index(positions.size(), 0);
+      for (std::size_t ibin = 0; ibin < size; ++ibin) {
+        for (std::size_t iaxis = 0; iaxis < positions.size(); ++iaxis) {
+          const auto position = positions[iaxis];
+          if (owned[iaxis]) {
+            output_offset_[i][ibin] += index[iaxis]*axis_stride_[position];
+          } else {
+            group[ibin] = group[ibin]*axis_size_[position] + index[iaxis];
+          }
+        }
+        for (auto iaxis = positions.size(); iaxis > 0; --iaxis) {
+          if (++index[iaxis - 1] < axis_size_[positions[iaxis - 1]]) break;
+          index[iaxis - 1] = 0;
+        }
+      }
+      auto &bins = matched_bins_[i];
+      bins.first.assign(n_groups + 1, 0);
+      bins.bins.clear();
+      if (matched_position_[i].empty()) continue;
+      for (const auto igroup : group) ++bins.first[igroup + 1];
+      for (std::size_t igroup = 0; igroup < n_groups; ++igroup) bins.first[igroup + 1] += bins.first[igroup];
+      bins.bins.resize(size);
+      auto fill = bins.first;
+      for (std::size_t ibin = 0; ibin < size; ++ibin) bins.bins[fill[group[ibin]]++] = ibin;
+    }
+  }
+
+  /**
+   * Calculates for each bin of the correlation without the component axis, if it is evaluated, and the bin with the
+   * bins of the symmetric inputs exchanged.
+   * @param data_containers input data containers
+   */
+  void BuildMirrorBins(const std::array<const InputDataContainer *, NInputs> &data_containers) {
+    mirror_bin_.clear();
+    evaluated_.clear();
+    if (!symmetric_) return;
+    const auto first = symmetric_first_;
+    const auto second = symmetric_second_;
+    if (input_names_[first]!=input_names_[second] || data_containers[first]->IsIntegrated()
+        || data_containers[first]->size()!=data_containers[second]->size()
+        || !matched_position_[first].empty() || !matched_position_[second].empty()) {
+      throw std::runtime_error("The symmetric inputs " + input_names_[first] + " and " + input_names_[second] +
+          " need to be the same differential input without matched axes.");
+    }
+    const auto &positions_a = axis_position_[first];
+    const auto &positions_b = axis_position_[second];
+    std::size_t n_bins = 1;
+    for (const auto size : axis_size_) n_bins *= size;
+    mirror_bin_.resize(n_bins);
+    evaluated_.resize(n_bins);
+    for (std::size_t bin = 0; bin < n_bins; ++bin) {
+      std::size_t bin_a = 0;
+      std::size_t bin_b = 0;
+      std::size_t mirror = bin;
+      for (std::size_t iaxis = 0; iaxis < positions_a.size(); ++iaxis) {
+        const auto pa = positions_a[iaxis];
+        const auto pb = positions_b[iaxis];
+        const auto index_a = (bin/axis_stride_[pa])%axis_size_[pa];
+        const auto index_b = (bin/axis_stride_[pb])%axis_size_[pb];
+        bin_a = bin_a*axis_size_[pa] + index_a;
+        bin_b = bin_b*axis_size_[pb] + index_b;
+        mirror = mirror - index_a*axis_stride_[pa] - index_b*axis_stride_[pb]
+            + index_b*axis_stride_[pa] + index_a*axis_stride_[pb];
+      }
+      mirror_bin_[bin] = bin_b < bin_a ? mirror : bin;
+      evaluated_[bin] = bin_b > bin_a || (bin_b==bin_a && symmetric_diagonal_);
+    }
+  }
+
+  /**
+   * Bins of an input grouped by the bin of the matched axes.
+   */
+  struct MatchedBins {
+    std::vector<std::size_t> first; ///< position of the first bin of each group
+    std::vector<std::size_t> bins;  ///< bins ordered by group
+  };
+
   Qn::DataContainerCorrelation data_container_correlation_;
-  std::vector<CorrelationResult> correlation_result_;
+  CorrelationResultBuffer correlation_result_; ///< per event results of the bins of the correlation
   Function function_;
   std::array<std::string, NInputs> input_names_;
   std::array<bool, NInputs> use_weights_;
+  std::vector<std::string> matched_axes_; ///< names of the matched axes
+  std::string component_axis_name_ = "Component"; ///< name of the component axis
+  std::array<std::vector<std::size_t>, NInputs> non_empty_bins_; ///< indices of the non-empty bins of each input
+  std::array<std::vector<std::size_t>, NInputs> output_offset_; ///< offsets of the input bins in the correlation
+  std::array<std::vector<std::size_t>, NInputs> axis_position_; ///< positions of the input axes in the correlation
+  std::array<std::vector<bool>, NInputs> axis_owned_; ///< axis is not matched to an axis of a previous input
+  std::array<std::vector<std::size_t>, NInputs> matched_position_; ///< positions of the matched axes of each input
+  std::array<MatchedBins, NInputs> matched_bins_; ///< bins of each input grouped by the bins of the matched axes
+  std::vector<std::size_t> axis_size_; ///< sizes of the axes of the correlation
+  std::vector<std::size_t> axis_stride_; ///< strides of the axes of the correlation
+  bool batch_ = false; ///< the kernel is evaluated in batches over the bins of the first input
+  std::vector<float> packed_x_; ///< packed x-components of the non-empty bins of the first input
+  std::vector<float> packed_y_; ///< packed y-components of the non-empty bins of the first input
+  std::vector<double> packed_weight_; ///< weights of the non-empty bins of the first input
+  bool symmetric_ = false; ///< the correlation function is symmetric in two inputs
+  std::size_t symmetric_first_ = 0; ///< position of the first symmetric input
+  std::size_t symmetric_second_ = 0; ///< position of the second symmetric input
+  bool symmetric_diagonal_ = true; ///< the combinations of identical bins of the symmetric inputs are evaluated
+  std::vector<std::size_t> mirror_bin_; ///< bin with the symmetric inputs exchanged, for the bins below the diagonal
+  std::vector<bool> evaluated_; ///< the bin is evaluated with symmetric inputs
+  std::vector<Cursor> cursors_; ///< cursors of the tasks. The first one is used by the serial evaluation.
+  std::size_t parallel_blocks_ = 0; ///< number of blocks of the bins of the first input evaluated in parallel
+#ifdef R__USE_IMT
+  std::shared_ptr<ROOT::TThreadExecutor> pool_; ///< thread pool of the parallel blocks
+#endif
 };
 
 }
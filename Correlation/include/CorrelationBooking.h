@@ -0,0 +1,244 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_CORRELATIONBOOKING_H
+#define FLOW_CORRELATIONBOOKING_H
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ROOT/RDataFrame.hxx"
+#include "TObject.h"
+#include "TTreeReader.h"
+
+#include "Axis.h"
+#include "CorrelationHelper.h"
+#include "DataContainer.h"
+
+namespace Qn {
+namespace Correlation {
+/**
+ * @class CorrelationBooking
+ * @brief Serializable description of a booked correlation, used with the distributed RDataFrame.
+ * The correlation functions are compiled code and cannot be sent to the workers. The description refers to them by
+ * the key, under which they are registered in the CorrelationRegistry of each worker, and holds everything else
+ * needed to book the correlation: the input names, the weights, the event axes, the number of samples and the
+ * resampling configuration. The description is streamed with its dictionary, e.g. pickled with the task of the
+ * workers. Each worker rebuilds the CorrelationHelper with BookMe, which sizes the slots from its own thread pool.
+ * The results of the workers are merged at the driver with DataContainer::Merge or MergeTree.
+ */
+class CorrelationBooking : public TObject {
+ public:
+  CorrelationBooking() = default;
+
+  /**
+   * Constructor
+   * @param name name of the correlation and of its result
+   * @param function key of the correlation function in the CorrelationRegistry
+   * @param input_names names of the input Q-vector columns
+   * @param weights weights of the inputs
+   * @param event_axes event axes of the result
+   * @param n_samples number of resamples
+   */
+  CorrelationBooking(std::string name,
+                     std::string function,
+                     std::vector<std::string> input_names,
+                     std::vector<Qn::Stats::Weights> weights,
+                     std::vector<Qn::AxisD> event_axes,
+                     std::size_t n_samples) :
+      name_(std::move(name)),
+      function_(std::move(function)),
+      input_names_(std::move(input_names)),
+      weights_(std::move(weights)),
+      event_axes_(std::move(event_axes)),
+      n_samples_(n_samples) {
+    if (input_names_.size()!=weights_.size()) {
+      throw std::invalid_argument("The correlation " + name_ + " needs one weight for each input.");
+    }
+  }
+
+  CorrelationBooking &MatchAxes(std::vector<std::string> axis_names) {
+    matched_axes_ = std::move(axis_names);
+    return *this;
+  }
+  CorrelationBooking &SetAccumulation(Qn::Statistic::Accumulation accumulation) {
+    accumulation_ = accumulation;
+    return *this;
+  }
+  CorrelationBooking &SetSampleStorage(Qn::ReSamples::Storage storage) {
+    sample_storage_ = storage;
+    return *this;
+  }
+  CorrelationBooking &SetReSamplingMethod(Qn::ReSamples::Method method) {
+    resampling_method_ = method;
+    return *this;
+  }
+
+  const char *GetName() const override { return name_.data(); }
+  const std::string &GetFunction() const { return function_; }
+  const std::vector<std::string> &GetInputNames() const { return input_names_; }
+  const std::vector<Qn::Stats::Weights> &GetWeights() const { return weights_; }
+  const std::vector<Qn::AxisD> &GetEventAxes() const { return event_axes_; }
+  const std::vector<std::string> &GetMatchedAxes() const { return matched_axes_; }
+  std::size_t GetNSamples() const { return n_samples_; }
+  Qn::Statistic::Accumulation GetAccumulation() const { return accumulation_; }
+  Qn::ReSamples::Storage GetSampleStorage() const { return sample_storage_; }
+  Qn::ReSamples::Method GetReSamplingMethod() const { return resampling_method_; }
+
+  /**
+   * Books the correlation with the function registered in the CorrelationRegistry of this process.
+   * @param df data frame with the column "Samples" defined by the ReSampler or SubSampler
+   * @param reader reader of the input tree defining the binning of the inputs
+   * @return result pointer of the correlation
+   */
+  ROOT::RDF::RResultPtr<Qn::DataContainerStats> BookMe(ROOT::RDF::RNode df, TTreeReader &reader) const;
+
+ private:
+  std::string name_; ///< name of the correlation
+  std::string function_; ///< key of the correlation function in the registry
+  std::vector<std::string> input_names_; ///< names of the input columns
+  std::vector<Qn::Stats::Weights> weights_; ///< weights of the inputs
+  std::vector<Qn::AxisD> event_axes_; ///< event axes of the result
+  std::vector<std::string> matched_axes_; ///< names of the matched axes
+  std::size_t n_samples_ = 0; ///< number of resamples
+  Qn::Statistic::Accumulation accumulation_ = Qn::Statistic::Accumulation::kIncremental; ///< accumulation mode
+  Qn::ReSamples::Storage sample_storage_ = Qn::ReSamples::Storage::kFull; ///< storage of the samples
+  Qn::ReSamples::Method resampling_method_ = Qn::ReSamples::Method::kBootstrap; ///< resampling method
+
+  /// \cond CLASSIMP
+ ClassDef(CorrelationBooking, 1);
+  /// \endcond
+};
+
+namespace Impl {
+template<typename F, std::size_t... IAxes, std::size_t... IInputs>
+ROOT::RDF::RResultPtr<Qn::DataContainerStats> BookCorrelation(ROOT::RDF::RNode &df,
+                                                              TTreeReader &reader,
+                                                              const CorrelationBooking &booking,
+                                                              F function,
+                                                              std::index_sequence<IAxes...>,
+                                                              std::index_sequence<IInputs...>) {
+  const auto &axes = booking.GetEventAxes();
+  const auto &names = booking.GetInputNames();
+  const auto &weights = booking.GetWeights();
+  auto helper = MakeCorrelation(booking.GetName(), function, MakeAxes(axes[IAxes]...))
+      .SetInputNames(names[IInputs]...)
+      .SetWeights(weights[IInputs]...)
+      .MatchAxes(booking.GetMatchedAxes())
+      .SetAccumulation(booking.GetAccumulation())
+      .SetSampleStorage(booking.GetSampleStorage())
+      .SetReSamplingMethod(booking.GetReSamplingMethod());
+  return helper.BookMe(df, reader, booking.GetNSamples());
+}
+}
+
+/**
+ * @class CorrelationRegistry
+ * @brief Correlation functions of a process by key. The number of event axes and of inputs are part of the type of
+ * the CorrelationHelper. They are fixed when a function is registered, such that a CorrelationBooking is booked
+ * without compiling code on the workers. The functions are registered on the driver and on each worker, e.g. by a
+ * shared library distributed to the workers.
+ */
+class CorrelationRegistry {
+ public:
+  using Booker = std::function<ROOT::RDF::RResultPtr<Qn::DataContainerStats>(ROOT::RDF::RNode &,
+                                                                             TTreeReader &,
+                                                                             const CorrelationBooking &)>;
+
+  static CorrelationRegistry &Instance() {
+    static CorrelationRegistry registry;
+    return registry;
+  }
+
+  /**
+   * Registers a correlation function.
+   * @tparam NAxes number of event axes of the bookings using the function
+   * @tparam F type of the correlation function
+   * @param key key of the function
+   * @param function the correlation function
+   */
+  template<std::size_t NAxes, typename F>
+  void Register(const std::string &key, F function) {
+    static_assert(NAxes > 0, "The correlations need at least one event axis");
+    constexpr std::size_t kNInputs = TemplateHelpers::FunctionTraits<F>::Arity;
+    std::lock_guard<std::mutex> lock(mutex_);
+    bookers_[key] = [function, key](ROOT::RDF::RNode &df, TTreeReader &reader, const CorrelationBooking &booking) {
+      if (booking.GetEventAxes().size()!=NAxes || booking.GetInputNames().size()!=kNInputs) {
+        throw std::invalid_argument("The correlation " + std::string(booking.GetName()) + " does not match the number of event "
+                                    "axes and inputs of the function " + key + ".");
+      }
+      return Impl::BookCorrelation(df, reader, booking, function,
+                                   std::make_index_sequence<NAxes>(), std::make_index_sequence<kNInputs>());
+    };
+  }
+
+  /**
+   * Registers the booker of a correlation function, e.g. of a precompiled function, which checks the event axes and
+   * the inputs of the booking itself.
+   * @param key key of the function
+   * @param booker books the correlation of a booking
+   */
+  void RegisterBooker(const std::string &key, Booker booker) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bookers_[key] = std::move(booker);
+  }
+
+  bool Contains(const std::string &key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bookers_.find(key)!=bookers_.end();
+  }
+
+  /**
+   * Books a correlation.
+   * @param df data frame
+   * @param reader reader of the input tree
+   * @param booking description of the correlation
+   * @return result pointer of the correlation
+   */
+  ROOT::RDF::RResultPtr<Qn::DataContainerStats> Book(ROOT::RDF::RNode &df,
+                                                     TTreeReader &reader,
+                                                     const CorrelationBooking &booking) const {
+    Booker booker;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const auto found = bookers_.find(booking.GetFunction());
+      if (found==bookers_.end()) {
+        throw std::out_of_range("The correlation function " + booking.GetFunction() + " is not registered.");
+      }
+      booker = found->second;
+    }
+    return booker(df, reader, booking);
+  }
+
+ private:
+  CorrelationRegistry() = default;
+
+  mutable std::mutex mutex_; ///< protects the bookers
+  std::map<std::string, Booker> bookers_; ///< bookers of the registered functions
+};
+
+inline ROOT::RDF::RResultPtr<Qn::DataContainerStats> CorrelationBooking::BookMe(ROOT::RDF::RNode df,
+                                                                                TTreeReader &reader) const {
+  return CorrelationRegistry::Instance().Book(df, reader, *this);
+}
+}
+}
+#endif //FLOW_CORRELATIONBOOKING_H
@@ -17,13 +17,25 @@
 #ifndef FLOW_DATAFRAMESTATISTICS_H
 #define FLOW_DATAFRAMESTATISTICS_H
 
+#include <algorithm>
+#include <mutex>
+
 #include "ROOT/RDF/ActionHelpers.hxx"
 #include "ROOT/RStringView.hxx"
 #include "ROOT/TypeTraits.hxx"
 #include "ROOT/RVec.hxx"
+#ifdef R__USE_IMT
+#include "ROOT/TThreadExecutor.hxx"
+#endif
 
 #include "Correlation.h"
 #include "AxesConfiguration.h"
+#include "ReSampler.h"
+#include "CorrelationStatistics.h"
+#include "CorrelationMemoryBudget.h"
+#include "EventLoopCheckpoint.h"
+#include "EventTrace.h"
+#include "StatsFillBatch.h"
 
 #include "DataContainer.h"
 
@@ -39,6 +51,100 @@ enum ConfigurationState {
   Weight
 };
 
+/**
+ * Sharing of the result of a correlation between the slots of the event loop.
+ */
+enum class ResultSharing {
+  kPerSlot, ///< each slot fills its own copy of the result, which are merged at the end
+  kShared, ///< all slots fill one result, whose bins are protected by lock stripes
+  kAutomatic ///< the result is shared, if the copies of all slots are larger than a threshold or exceed the budget
+};
+
+namespace Impl {
+/**
+ * Lock of a stripe of consecutive bins of a shared result. Aligned to a cache line, such that the locks of
+ * different stripes do not share cache lines.
+ */
+struct alignas(64) StripeLock {
+  std::mutex mutex;
+};
+
+/**
+ * Returns the number of bins of the result of a correlation without the event axes.
+ * @param correlation the initialized correlation
+ */
+template<typename Correlation>
+std::size_t CorrelationSize(const Correlation &correlation) {
+  Qn::DataContainerStats temp_correlation;
+  temp_correlation.AddAxes(correlation.GetCorrelationAxes());
+  return temp_correlation.size();
+}
+
+/**
+ * Adds the event axes and the axes of a correlation to a result data container and configures its bins. Only the
+ * evaluated bins of the correlation get resamples. Used by CorrelationHelper and CorrelationSet.
+ * @param data the result
+ * @param event_axes the event axes
+ * @param correlation the initialized correlation
+ * @param stride number of bins of the correlation without the event axes
+ * @param n_resamples number of resamples
+ * @param sample_storage storage of the bootstrap samples
+ * @param accumulation accumulation mode
+ * @param resampling_method resampling method
+ */
+template<typename Correlation>
+void ConfigureResult(Qn::DataContainerStats &data,
+                     const std::vector<Qn::AxisD> &event_axes,
+                     const Correlation &correlation,
+                     const std::size_t stride,
+                     const std::size_t n_resamples,
+                     const Qn::ReSamples::Storage sample_storage,
+                     const Qn::Statistic::Accumulation accumulation,
+                     const Qn::ReSamples::Method resampling_method) {
+  data.AddAxes(event_axes);
+  data.AddAxes(correlation.GetCorrelationAxes());
+  const auto weights = correlation.IsObservable() ? Qn::Stats::Weights::OBSERVABLE : Qn::Stats::Weights::REFERENCE;
+  for (std::size_t ibin = 0; ibin < data.size(); ++ibin) {
+    auto &bin = data[ibin];
+    if (correlation.IsEvaluated(ibin%stride)) bin.SetNumberOfReSamples(n_resamples, sample_storage);
+    bin.SetAccumulation(accumulation);
+    bin.SetReSamplingMethod(resampling_method);
+    bin.SetWeights(weights);
+  }
+}
+
+/**
+ * Books an action filling correlations in the event loop. The columns are the resampling column "Samples", the
+ * Q-vector inputs and the event axes. "Samples" holds the sub-sample of the event with sub-samples and the bootstrap
+ * multiplicities otherwise. Used by CorrelationHelper and CorrelationSet.
+ * @tparam Columns types of the Q-vector inputs and of the event axes
+ * @param df RDataFrame
+ * @param action the action, which is moved into the booked action
+ * @param input_names names of the Q-vector inputs
+ * @param event_axes_config the event axes
+ * @param resampling_method resampling method of the action
+ */
+template<typename... Columns, typename DATAFRAME, typename Action, typename Names, typename AxisConfig>
+auto BookAction(DATAFRAME &df,
+                Action &&action,
+                const Names &input_names,
+                const AxisConfig &event_axes_config,
+                const Qn::ReSamples::Method resampling_method) {
+  std::vector<std::string> columns;
+  columns.emplace_back("Samples");
+  for (const auto &name : input_names) {
+    columns.emplace_back(name);
+  }
+  for (const auto &axis : event_axes_config.GetVector()) {
+    columns.emplace_back(axis.Name());
+  }
+  if (resampling_method==Qn::ReSamples::Method::kSubSamples) {
+    return df.template Book<ULong64_t, Columns...>(std::forward<Action>(action), columns);
+  }
+  return df.template Book<SampleMultiplicities, Columns...>(std::forward<Action>(action), columns);
+}
+}
+
 template<ConfigurationState State, typename AxisConfig, typename Correlation, typename EventParameters, typename DataContainers>
 class CorrelationHelper;
 
@@ -63,10 +169,55 @@ class CorrelationHelper<State,
  private:
   std::string name_; //!<! Name of the Correlation
   std::size_t stride_ = 0; //!<! size of the correlation data container without event axes
+  std::size_t evaluated_bins_ = 0; //!<! bins of the correlation, which are evaluated
   std::vector<std::shared_ptr<Result_t>> data_containers_; //!<! vector of result data containers
   AxisConfig event_axes_config_; //!<! Axis configuration of the event axes
   Correlation correlation_; //!<! object calculating the event by event correlation
+  std::size_t n_resamples_ = 0; //!<! number of resamples
+  Qn::Statistic::Accumulation accumulation_ = Qn::Statistic::Accumulation::kIncremental; //!<! accumulation mode
+  Qn::ReSamples::Storage sample_storage_ = Qn::ReSamples::Storage::kFull; //!<! storage of the bootstrap samples
+  Qn::ReSamples::Method resampling_method_ = Qn::ReSamples::Method::kBootstrap; //!<! resampling method
+  double adaptive_tolerance_ = 0.; //!<! tolerance of the adaptive number of resamples. Disabled if 0.
+  std::size_t adaptive_min_resamples_ = 0; //!<! minimum number of resamples in the adaptive mode
+  std::size_t adaptive_min_entries_ = 0; //!<! minimum number of entries of a bin before its resamples are adapted
+  std::vector<std::unique_ptr<Correlation>> slot_correlations_; //!<! copy of the correlation of each slot
+  std::vector<CorrelationStatistics> slot_statistics_; //!<! statistics of each slot
+  std::shared_ptr<CorrelationStatistics> statistics_; //!<! statistics merged from all slots
+  bool collect_statistics_ = false; //!<! the statistics are collected in the event loop
+  std::shared_ptr<CorrelationMemoryBudget> memory_budget_; //!<! budget accounting the memory of the result
+  std::shared_ptr<EventLoopCheckpoint> checkpoint_; //!<! checkpoint of the partial results of the slots
+  std::shared_ptr<std::vector<Result_t *>> checkpoint_slots_; //!<! configured result of each slot in the checkpoint
+  std::size_t fill_batch_events_ = 0; //!<! number of events of the batched bootstrap fill. Disabled if 0.
+  std::shared_ptr<std::vector<StatsFillBatch>> fill_batches_; //!<! batched bootstrap fill of each slot
+  ResultSharing result_sharing_ = ResultSharing::kAutomatic; //!<! sharing of the result between the slots
+  std::size_t shared_threshold_ = kSharedResultThreshold; //!<! size of the copies above which the result is shared
+  bool shared_ = false; //!<! all slots fill the result of the first slot
+  std::size_t stripe_bins_ = 1; //!<! number of consecutive bins protected by one lock
+  std::shared_ptr<std::vector<Impl::StripeLock>> stripes_; //!<! locks of the bins of the shared result
+  std::shared_ptr<EventTrace> trace_; //!<! timeline of the correlation and filling of the events
+  std::size_t trace_correlate_ = 0; //!<! id of the name of the correlation of an event in the trace
+  std::size_t trace_fill_ = 0; //!<! id of the name of the filling of an event in the trace
+  std::size_t trace_finalize_ = 0; //!<! id of the name of Finalize in the trace
+  std::size_t parallel_min_bins_ = 0; //!<! number of bins, above which the bins of an event are split. Disabled if 0.
+  std::size_t parallel_blocks_ = 0; //!<! requested number of blocks of the bins of an event
+  std::size_t bin_blocks_ = 0; //!<! number of blocks of the bins of an event evaluated in parallel. Disabled if 0.
+#ifdef R__USE_IMT
+  std::shared_ptr<ROOT::TThreadExecutor> pool_; //!<! thread pool of the parallel filling of the blocks
+#endif
  public:
+  /**
+   * Size of the copies of the result of all slots, above which the result is shared in the automatic mode.
+   */
+  static constexpr std::size_t kSharedResultThreshold = std::size_t{1} << 30;
+  /**
+   * Number of lock stripes of a shared result per slot.
+   */
+  static constexpr std::size_t kStripesPerSlot = 16;
+  /**
+   * Number of bins of the correlation, above which the bins of an event are split in parallel blocks by default.
+   */
+  static constexpr std::size_t kParallelBinsThreshold = 4096;
+
   CorrelationHelper(std::string name, Correlation correlation, AxisConfig event_axes_config) :
       name_(std::move(name)),
       event_axes_config_(std::move(event_axes_config)),
@@ -75,6 +226,8 @@ class CorrelationHelper<State,
     for (std::size_t i = 0; i < n_slots; ++i) {
       data_containers_.emplace_back(std::make_shared<Qn::DataContainerStats>());
     }
+    slot_statistics_.resize(n_slots);
+    statistics_ = std::make_shared<CorrelationStatistics>();
   }
 
   CorrelationHelper(CorrelationHelper &&other) = default;
@@ -85,7 +238,11 @@ class CorrelationHelper<State,
       stride_(std::move(other.stride_)),
       data_containers_(std::move(other.data_containers_)),
       event_axes_config_(std::move(other.event_axes_config_)),
-      correlation_(std::move(other.correlation_)) {}
+      correlation_(std::move(other.correlation_)),
+      slot_statistics_(std::move(other.slot_statistics_)),
+      statistics_(std::move(other.statistics_)),
+      memory_budget_(std::move(other.memory_budget_)),
+      checkpoint_(std::move(other.checkpoint_)) {}
 
   friend CorrelationHelperOtherState<ConfigurationState::Start>;
   friend CorrelationHelperOtherState<ConfigurationState::Input>;
@@ -104,82 +261,610 @@ class CorrelationHelper<State,
     return {std::move(*this)};
   }
 
-  void Configure(TTreeReader &reader, const std::size_t n_resamples) {
-    correlation_.Initialize(reader);
-    auto correlation_axes = correlation_.GetCorrelationAxes();
-    auto event_axes = event_axes_config_.GetVector();
-    // Initialize output data containers
-    for (auto &data : data_containers_) {
-      data->AddAxes(event_axes);
-      data->AddAxes(correlation_axes);
-      for (auto &bin : *data) {
-        bin.SetNumberOfReSamples(n_resamples);
-        if (correlation_.IsObservable()) {
-          bin.SetWeights(Qn::Stats::Weights::OBSERVABLE);
-        } else {
-          bin.SetWeights(Qn::Stats::Weights::REFERENCE);
-        }
+  /**
+   * Declares axes as matched. Only the bins, in which the inputs share the same bin of the matched axes, are
+   * correlated instead of the full product of the bins of the inputs.
+   * @param axis_names names of the matched axes
+   */
+  CorrelationHelper MatchAxes(std::vector<std::string> axis_names) &&{
+    static_assert(State==ConfigurationState::Weight, "Configure weights first");
+    correlation_.SetMatchedAxes(std::move(axis_names));
+    return std::move(*this);
+  }
+
+  /**
+   * Declares the correlation function symmetric under the exchange of two inputs with the same name, e.g. Q_a Q_b
+   * of two bins of the same Q-vector. Only the combinations, in which the bin of the second input is not below the
+   * bin of the first input, are filled and hold resamples. The results of the other combinations are copied from
+   * the combination with the bins exchanged, when the result is finalized. The partial results are not mirrored.
+   * @param first position of the first symmetric input
+   * @param second position of the second symmetric input
+   * @param diagonal fill the combinations, in which both inputs are in the same bin
+   */
+  CorrelationHelper SymmetricInputs(std::size_t first, std::size_t second, bool diagonal = true) &&{
+    static_assert(State==ConfigurationState::Weight, "Configure weights first");
+    correlation_.SetSymmetricInputs(first, second, diagonal);
+    return std::move(*this);
+  }
+
+  /**
+   * Sets the accumulation mode of the bootstrap samples of the result.
+   * @param accumulation accumulation mode
+   */
+  CorrelationHelper SetAccumulation(Qn::Statistic::Accumulation accumulation) &&{
+    static_assert(State==ConfigurationState::Weight, "Configure weights first");
+    accumulation_ = accumulation;
+    return std::move(*this);
+  }
+
+  /**
+   * Sets the storage of the bootstrap samples of the result. The compact storages reduce the memory of the result,
+   * when only the means of the samples are needed.
+   * @param storage storage of the samples
+   */
+  CorrelationHelper SetSampleStorage(Qn::ReSamples::Storage storage) &&{
+    static_assert(State==ConfigurationState::Weight, "Configure weights first");
+    sample_storage_ = storage;
+    return std::move(*this);
+  }
+
+  /**
+   * Sets the resampling method. With sub-samples the column "Samples" is the sub-sample of the event as given by the
+   * SubSampler and only this sample is filled.
+   * @param method resampling method
+   */
+  CorrelationHelper SetReSamplingMethod(Qn::ReSamples::Method method) &&{
+    static_assert(State==ConfigurationState::Weight, "Configure weights first");
+    resampling_method_ = method;
+    return std::move(*this);
+  }
+
+  /**
+   * Enables the adaptive number of bootstrap samples. The number of resamples given to BookMe is the maximum.
+   * At every partial update of a slot, for each bin the number of resamples is doubled starting from
+   * min_resamples until the width of the confidence interval has converged to the relative tolerance. The
+   * resamples above the converged number are removed and no longer filled. Register a callback with
+   * RResultPtr::OnPartialResultSlot to run the checks. Not used with sub-samples.
+   * @param tolerance relative tolerance of the width of the confidence interval
+   * @param min_resamples minimum number of resamples
+   * @param min_entries minimum number of entries of a bin before it is checked
+   */
+  CorrelationHelper SetAdaptiveReSampling(double tolerance,
+                                          std::size_t min_resamples = 50,
+                                          std::size_t min_entries = 1000) &&{
+    static_assert(State==ConfigurationState::Weight, "Configure weights first");
+    adaptive_tolerance_ = tolerance;
+    adaptive_min_resamples_ = min_resamples;
+    adaptive_min_entries_ = min_entries;
+    return std::move(*this);
+  }
+
+  /**
+   * Fills the bootstrap samples in batches of events. The results of the events are buffered and filled bin by bin,
+   * such that the samples of a bin stay in the cache for all events of the batch. Useful for large correlations, in
+   * which the samples of all bins do not fit into the cache. The result is identical to the direct fill.
+   * Not used with sub-samples.
+   * @param n_events number of events of a batch
+   */
+  CorrelationHelper SetFillBatch(std::size_t n_events = 64) &&{
+    static_assert(State==ConfigurationState::Weight, "Configure weights first");
+    fill_batch_events_ = n_events;
+    return std::move(*this);
+  }
+
+  /**
+   * Sets whether the slots fill their own copy of the result or one shared result. The copies are filled without
+   * synchronization, but need the memory of the result times the number of slots. The shared result needs the
+   * memory of one result. Its bins are partitioned into stripes of consecutive bins, each protected by a lock,
+   * which a slot holds while it fills the bins of the stripe. The automatic mode shares the result, if the estimated
+   * memory of the copies exceeds the threshold or the memory budget. The shared result is not available with
+   * checkpoints and the adaptive resampling, which use the results of the slots, and does not use the batched fill.
+   * @param sharing sharing of the result
+   * @param threshold estimated bytes of the copies of all slots, above which the automatic mode shares the result
+   */
+  CorrelationHelper SetResultSharing(ResultSharing sharing, std::size_t threshold = kSharedResultThreshold) &&{
+    static_assert(State==ConfigurationState::Weight, "Configure weights first");
+    result_sharing_ = sharing;
+    shared_threshold_ = threshold;
+    return std::move(*this);
+  }
+
+  /**
+   * Splits the bins of one event into blocks, which are evaluated and filled in parallel by the implicit
+   * multi-threading pool, as nested tasks of the slot processing the event. Useful for jobs with few events and
+   * correlations with many bins, which do not scale with the slots of the event loop. The correlation is split
+   * into blocks of the non-empty bins of its first input and the filling into blocks of consecutive bins of the
+   * result of the slot. The blocks write disjoint bins, such that no locking is needed. Only used with ROOT's
+   * implicit multi-threading. The filling is not split for the shared result and the batched fill.
+   * @param min_bins number of bins of the correlation, above which the bins are split
+   * @param n_blocks number of blocks. If 0, four blocks per thread of the pool are used.
+   */
+  CorrelationHelper SetParallelBins(std::size_t min_bins = kParallelBinsThreshold, std::size_t n_blocks = 0) &&{
+    static_assert(State==ConfigurationState::Weight, "Configure weights first");
+    parallel_min_bins_ = std::max<std::size_t>(min_bins, 1);
+    parallel_blocks_ = n_blocks;
+    return std::move(*this);
+  }
+
+  /**
+   * Accounts the estimated memory of the result of all slots in a budget, which is shared by the booked
+   * correlations. The memory is estimated when the correlation is booked, before the event loop starts. Depending
+   * on the policy of the budget, exceeding it fails the booking or switches the samples to the compact float
+   * storage and reduces the number of resamples to fit. The number of sub-samples is not reduced.
+   * @param budget the memory budget
+   */
+  CorrelationHelper SetMemoryBudget(std::shared_ptr<CorrelationMemoryBudget> budget) &&{
+    static_assert(State==ConfigurationState::Weight, "Configure weights first");
+    memory_budget_ = std::move(budget);
+    return std::move(*this);
+  }
+
+  /**
+   * Writes the partial results of the slots to a checkpoint, from which a preempted job is resumed. The result of
+   * the previous jobs is added to the result at Finalize. The checkpoint is restored after the correlation is
+   * booked and before the event loop starts.
+   * @param checkpoint the checkpoint
+   */
+  CorrelationHelper SetCheckpoint(std::shared_ptr<EventLoopCheckpoint> checkpoint) &&{
+    static_assert(State==ConfigurationState::Weight, "Configure weights first");
+    checkpoint_ = std::move(checkpoint);
+    return std::move(*this);
+  }
+
+  /**
+   * Records the correlation and the filling of the sampled events and Finalize in the timeline of a trace, e.g. the
+   * trace of the CorrectionManager of the same event loop. The stages are named after the correlation.
+   * @param trace the trace
+   */
+  CorrelationHelper SetTrace(std::shared_ptr<EventTrace> trace) &&{
+    static_assert(State==ConfigurationState::Weight, "Configure weights first");
+    trace_ = std::move(trace);
+    return std::move(*this);
+  }
+
+  /**
+   * Collects the throughput and fill statistics returned by GetStatistics. Disabled by default, as the statistics
+   * take the time of the correlation and the filling and count the filled samples of every event.
+   * @param collect true to enable
+   */
+  CorrelationHelper SetCollectStatistics(bool collect = true) &&{
+    static_assert(State==ConfigurationState::Weight, "Configure weights first");
+    collect_statistics_ = collect;
+    return std::move(*this);
+  }
+
+  /**
+   * Estimates the resident memory of the result of all slots, or of the shared result. Available after the
+   * configuration.
+   * @return estimated bytes
+   */
+  std::size_t EstimateMemory() const { return EstimateMemory(n_resamples_, sample_storage_); }
+
+  /**
+   * Estimates the resident memory of the result of all slots, or of the shared result, for a number of resamples and
+   * a storage.
+   * @param n_resamples number of resamples
+   * @param storage storage of the resamples
+   * @return estimated bytes
+   */
+  std::size_t EstimateMemory(std::size_t n_resamples, Qn::ReSamples::Storage storage) const {
+    std::size_t n_event_bins = 1;
+    for (const auto &axis : event_axes_config_.GetVector()) n_event_bins *= axis.size();
+    const std::size_t copies = shared_ ? 1 : data_containers_.size();
+    // bins, which are not evaluated for symmetric inputs, do not hold resamples.
+    const auto bytes = evaluated_bins_*Qn::Stats::EstimateBytes(n_resamples, storage, accumulation_)
+        + (stride_ - evaluated_bins_)*Qn::Stats::EstimateBytes(0, storage, accumulation_);
+    return copies*n_event_bins*bytes;
+  }
+
+  /**
+   * Initializes the correlation. The result data containers of the slots are configured later by the thread
+   * processing the slot.
+   * @tparam Input TTreeReader or array of pointers to the input data containers
+   * @param input TTreeReader of the input tree or the input data containers defining the binning, e.g. the layouts
+   * of the flat Q-vectors of a RNTuple.
+   * @param n_resamples number of resamples
+   */
+  template<typename Input>
+  void Configure(Input &input, const std::size_t n_resamples) {
+    correlation_.Initialize(input);
+    n_resamples_ = n_resamples;
+    slot_correlations_.clear();
+    slot_correlations_.resize(data_containers_.size());
+    stride_ = Impl::CorrelationSize(correlation_);
+    evaluated_bins_ = 0;
+    for (std::size_t ibin = 0; ibin < stride_; ++ibin) evaluated_bins_ += correlation_.IsEvaluated(ibin);
+    ChooseResultSharing();
+    if (memory_budget_) ApplyMemoryBudget();
+    if (shared_) ConfigureSharedResult();
+    fill_batches_.reset();
+    if (!shared_ && fill_batch_events_ > 0 && resampling_method_!=Qn::ReSamples::Method::kSubSamples) {
+      fill_batches_ = std::make_shared<std::vector<StatsFillBatch>>(data_containers_.size(),
+                                                                    StatsFillBatch(fill_batch_events_));
+    }
+    ConfigureBinBlocks();
+    if (checkpoint_) RegisterCheckpoint();
+    if (trace_) {
+      trace_correlate_ = trace_->AddName(name_ + "/correlate");
+      trace_fill_ = trace_->AddName(name_ + "/fill");
+      trace_finalize_ = trace_->AddName(name_ + "/finalize");
+    }
+  }
+
+  /**
+   * Decides the number of parallel blocks of the bins of an event and passes it to the correlation, which is copied
+   * to the slots later.
+   */
+  void ConfigureBinBlocks() {
+    bin_blocks_ = 0;
+#ifdef R__USE_IMT
+    if (parallel_min_bins_ > 0 && stride_ >= parallel_min_bins_ && ROOT::IsImplicitMTEnabled()) {
+      bin_blocks_ = parallel_blocks_ > 0 ? parallel_blocks_ : 4*ROOT::GetImplicitMTPoolSize();
+      // the pool is created once and used by the filling of all events of all slots.
+      if (!pool_) pool_ = std::make_shared<ROOT::TThreadExecutor>();
+    }
+#endif
+    correlation_.SetParallelBlocks(bin_blocks_);
+  }
+
+  /**
+   * Fills the valid results of an event into the result of a slot in parallel blocks of consecutive bins. The
+   * blocks are aligned to the words of the validity of the results and fill disjoint bins.
+   * @tparam Fill type of the fill function
+   * @param bins first bin of the event in the result
+   * @param results results of the event
+   * @param fill function with the signature void(Qn::Stats &bin, double value, double weight)
+   */
+  template<typename Fill>
+  void FillBlocks(Qn::Stats *bins, const CorrelationResultBuffer &results, Fill &&fill) const {
+    auto fill_range = [bins, &results, &fill](const std::size_t first, const std::size_t last) {
+      results.ForEachValid(first, last, [bins, &fill](std::size_t ibin, double value, double weight) {
+        fill(bins[ibin], value, weight);
+      });
+    };
+    constexpr auto kWord = CorrelationResultBuffer::kBitsPerWord;
+    const auto n = results.size();
+    const auto n_words = (n + kWord - 1)/kWord;
+    const auto n_blocks = std::min(bin_blocks_, n_words);
+#ifdef R__USE_IMT
+    if (n_blocks > 1) {
+      pool_->Foreach([n_words, n_blocks, &fill_range](const unsigned int iblock) {
+        fill_range(iblock*n_words/n_blocks*kWord, (iblock + 1)*n_words/n_blocks*kWord);
+      }, ROOT::TSeqU(n_blocks));
+      return;
+    }
+#endif
+    fill_range(0, n);
+  }
+
+  /**
+   * Decides whether the slots share the result.
+   */
+  void ChooseResultSharing() {
+    shared_ = false;
+    if (result_sharing_==ResultSharing::kPerSlot || data_containers_.size() < 2) return;
+    const bool uses_slot_results = checkpoint_ || adaptive_tolerance_ > 0.;
+    if (result_sharing_==ResultSharing::kShared) {
+      if (uses_slot_results) {
+        throw std::logic_error("The shared result of the correlation " + name_ +
+            " is not available with checkpoints and the adaptive resampling.");
       }
+      shared_ = true;
+      return;
     }
-    // calculate stride of the resulting container
-    Qn::DataContainerStats temp_correlation;
-    temp_correlation.AddAxes(correlation_axes);
-    stride_ = temp_correlation.size();
+    if (uses_slot_results) return;
+    const auto replicated = EstimateMemory();
+    shared_ = replicated > shared_threshold_ || (memory_budget_ && !memory_budget_->Fits(replicated));
+  }
+
+  /**
+   * Configures the result of the first slot, which is filled by all slots, and the locks of its stripes.
+   */
+  void ConfigureSharedResult() {
+    auto &shared = data_containers_.front();
+    ConfigureResult(*shared);
+    for (auto &container : data_containers_) container = shared;
+    const auto n_stripes = std::max<std::size_t>(1, std::min(shared->size(), kStripesPerSlot*data_containers_.size()));
+    stripe_bins_ = (shared->size() + n_stripes - 1)/n_stripes;
+    stripes_ = std::make_shared<std::vector<Impl::StripeLock>>(n_stripes);
   }
 
-  template<typename DATAFRAME>
-  ROOT::RDF::RResultPtr<Result_t> BookMe(DATAFRAME &df, TTreeReader &reader, const std::size_t n_resamples) {
+  /**
+   * Fills the valid results of an event into the shared result. The bins are filled in increasing order and the
+   * lock of a stripe is held while its bins are filled. A slot holds at most one lock at a time.
+   * @tparam Fill type of the fill function
+   * @param first linear index of the first bin of the event
+   * @param results results of the event
+   * @param fill function with the signature void(Qn::Stats &bin, double value, double weight)
+   */
+  template<typename Fill>
+  void FillShared(const std::size_t first, const CorrelationResultBuffer &results, Fill &&fill) {
+    auto bins = &data_containers_.front()->At(first);
+    auto &stripes = *stripes_;
+    std::unique_lock<std::mutex> lock;
+    auto locked = stripes.size();
+    results.ForEachValid([&](std::size_t ibin, double value, double weight) {
+      const auto stripe = (first + ibin)/stripe_bins_;
+      if (stripe!=locked) {
+        if (lock.owns_lock()) lock.unlock();
+        lock = std::unique_lock<std::mutex>(stripes[stripe].mutex);
+        locked = stripe;
+      }
+      fill(bins[ibin], value, weight);
+    });
+  }
+
+  /**
+   * Copies the results of the evaluated bins of symmetric inputs to the bins with the inputs exchanged.
+   * @param result the merged result
+   */
+  void MirrorSymmetricBins(Result_t &result) const {
+    if (evaluated_bins_==stride_) return;
+    for (std::size_t first = 0; first < result.size(); first += stride_) {
+      for (std::size_t ibin = 0; ibin < stride_; ++ibin) {
+        const auto mirror = correlation_.GetMirrorBin(ibin);
+        if (mirror!=ibin) result[first + ibin] = result[first + mirror];
+      }
+    }
+  }
+
+  /**
+   * Registers the results of the slots in the checkpoint. The result of a slot is only written after it has been
+   * configured by the thread processing the slot.
+   */
+  void RegisterCheckpoint() {
+    checkpoint_slots_ = std::make_shared<std::vector<Result_t *>>(data_containers_.size(), nullptr);
+    checkpoint_->Register(name_, [slots = checkpoint_slots_, batches = fill_batches_](unsigned int slot) -> TObject * {
+      if (batches) (*batches)[slot].Flush();
+      return slots->at(slot);
+    });
+  }
+
+  /**
+   * Accounts the estimated memory in the budget. With the compact policy the samples are stored in the compact
+   * float storage and the number of resamples is reduced, if the result does not fit otherwise.
+   */
+  void ApplyMemoryBudget() {
+    auto bytes = EstimateMemory();
+    if (!memory_budget_->Fits(bytes) && memory_budget_->GetPolicy()==CorrelationMemoryBudget::Policy::kCompact) {
+      sample_storage_ = Qn::ReSamples::Storage::kSumsFloat;
+      const auto fixed = EstimateMemory(0, sample_storage_);
+      const auto per_sample = EstimateMemory(1, sample_storage_) - fixed;
+      const auto available = memory_budget_->Available();
+      if (resampling_method_!=Qn::ReSamples::Method::kSubSamples && available > fixed + per_sample) {
+        n_resamples_ = std::min(n_resamples_, (available - fixed)/per_sample);
+      }
+      bytes = EstimateMemory();
+    }
+    memory_budget_->Add(name_, bytes);
+  }
+
+  /**
+   * Configures the result data container and the correlation of a slot. Called by the thread processing the slot,
+   * such that the memory of the slot is allocated and first touched by this thread and does not share cache lines
+   * with the other slots.
+   * @param slot slot
+   */
+  void ConfigureSlot(const unsigned int slot) {
+    auto &data = *data_containers_[slot];
+    if (!shared_) ConfigureResult(data);
+    // each slot uses its own copy of the correlation, because the per event results are stored in it.
+    slot_correlations_[slot] = std::make_unique<Correlation>(correlation_);
+    if (checkpoint_slots_) (*checkpoint_slots_)[slot] = &data;
+  }
+
+  /**
+   * Adds the axes to a result data container and configures its bins.
+   * @param data the result
+   */
+  void ConfigureResult(Result_t &data) {
+    Impl::ConfigureResult(data, event_axes_config_.GetVector(), correlation_, stride_, n_resamples_, sample_storage_,
+                          accumulation_, resampling_method_);
+  }
+
+  template<typename DATAFRAME, typename Input>
+  ROOT::RDF::RResultPtr<Result_t> BookMe(DATAFRAME &df, Input &input, const std::size_t n_resamples) {
     static_assert(State==ConfigurationState::Weight, "Configure weights first");
-    Configure(reader, n_resamples);
-    std::vector<std::string> columns;
-    columns.emplace_back("Samples");
-    auto input_names = correlation_.GetInputNames();
-    for (const auto &name : input_names) {
-      columns.emplace_back(name);
+    Configure(input, n_resamples);
+    const auto input_names = correlation_.GetInputNames();
+    const auto event_axes_config = event_axes_config_;
+    const auto resampling_method = resampling_method_;
+    return Impl::BookAction<DataContainers..., EventParameters...>(df, std::move(*this), input_names,
+                                                                   event_axes_config, resampling_method);
+  }
+
+  /**
+   * Fills the correlation of one event. The columns are received by reference from RDataFrame, such that the
+   * input data containers are not copied.
+   */
+  void Exec(unsigned int slot,
+            const SampleMultiplicities &sample_ids,
+            const DataContainers &... data_containers,
+            const EventParameters &... coordinates) {
+    const auto event_bin = event_axes_config_.GetLinearIndexFromCoordinates(coordinates...);
+    if (!collect_statistics_ && !trace_) {
+      if (event_bin < 0) return;
+      FillEvent(slot, event_bin, slot_correlations_[slot]->Correlate(data_containers...), sample_ids);
+      return;
     }
-    auto event_axes = event_axes_config_.GetVector();
-    for (const auto &axis : event_axes) {
-      columns.emplace_back(axis.Name());
+    auto &statistics = slot_statistics_[slot];
+    ++statistics.events;
+    if (event_bin < 0) return;
+    const auto start = std::chrono::steady_clock::now();
+    const auto &per_event_correlation = slot_correlations_[slot]->Correlate(data_containers...);
+    const auto correlated = std::chrono::steady_clock::now();
+    FillEvent(slot, event_bin, per_event_correlation, sample_ids);
+    if (collect_statistics_) {
+      const auto n_samples = std::count_if(sample_ids.begin(), sample_ids.end(), [](UChar_t k) { return k > 0; });
+      CountEvent(statistics, per_event_correlation, n_samples, start, correlated);
+    }
+    TraceEvent(statistics, start, correlated);
+  }
+
+  /**
+   * Fills the correlation of one event into the bootstrap samples.
+   */
+  void FillEvent(unsigned int slot, const long event_bin, const CorrelationResultBuffer &per_event_correlation,
+                 const SampleMultiplicities &sample_ids) {
+    if (shared_) {
+      FillShared(event_bin*stride_, per_event_correlation, [&sample_ids](Qn::Stats &bin, double value, double weight) {
+        bin.FillPoisson(value, weight, sample_ids);
+      });
+    } else if (fill_batches_) {
+      auto bins = &data_containers_[slot]->At(event_bin*stride_);
+      (*fill_batches_)[slot].Add(bins, per_event_correlation, sample_ids);
+    } else if (bin_blocks_ > 0) {
+      FillBlocks(&data_containers_[slot]->At(event_bin*stride_), per_event_correlation,
+                 [&sample_ids](Qn::Stats &bin, double value, double weight) {
+                   bin.FillPoisson(value, weight, sample_ids);
+                 });
+    } else {
+      Qn::Stats::FillPoisson(&data_containers_[slot]->At(event_bin*stride_), per_event_correlation, sample_ids);
     }
-    return df.template Book<ROOT::RVec<ULong64_t>, DataContainers..., EventParameters...>(std::move(*this), columns);
   }
 
+  /**
+   * Fills the correlation of one event into its sub-sample.
+   */
   void Exec(unsigned int slot,
-            const ROOT::RVec<ULong64_t> sample_ids,
-            DataContainers... data_containers,
-            EventParameters... coordinates) {
-    const auto &per_event_correlation = correlation_.Correlate(data_containers...);
-    auto event_bin = event_axes_config_.GetLinearIndexFromCoordinates(coordinates...);
+            const ULong64_t sample,
+            const DataContainers &... data_containers,
+            const EventParameters &... coordinates) {
+    const auto event_bin = event_axes_config_.GetLinearIndexFromCoordinates(coordinates...);
+    if (!collect_statistics_ && !trace_) {
+      if (event_bin < 0) return;
+      FillEvent(slot, event_bin, slot_correlations_[slot]->Correlate(data_containers...), sample);
+      return;
+    }
+    auto &statistics = slot_statistics_[slot];
+    ++statistics.events;
     if (event_bin < 0) return;
-    for (std::size_t ibin = 0; ibin < per_event_correlation.size(); ++ibin) {
-      data_containers_[slot]->At(event_bin*stride_ + ibin).FillPoisson(per_event_correlation[ibin], sample_ids);
+    const auto start = std::chrono::steady_clock::now();
+    const auto &per_event_correlation = slot_correlations_[slot]->Correlate(data_containers...);
+    const auto correlated = std::chrono::steady_clock::now();
+    FillEvent(slot, event_bin, per_event_correlation, sample);
+    if (collect_statistics_) CountEvent(statistics, per_event_correlation, 1, start, correlated);
+    TraceEvent(statistics, start, correlated);
+  }
+
+  /**
+   * Fills the correlation of one event into its sub-sample.
+   */
+  void FillEvent(unsigned int slot, const long event_bin, const CorrelationResultBuffer &per_event_correlation,
+                 const ULong64_t sample) {
+    if (shared_) {
+      FillShared(event_bin*stride_, per_event_correlation, [sample](Qn::Stats &bin, double value, double weight) {
+        bin.FillSubSample(value, weight, sample);
+      });
+    } else if (bin_blocks_ > 0) {
+      FillBlocks(&data_containers_[slot]->At(event_bin*stride_), per_event_correlation,
+                 [sample](Qn::Stats &bin, double value, double weight) {
+                   bin.FillSubSample(value, weight, sample);
+                 });
+    } else {
+      Qn::Stats::FillSubSample(&data_containers_[slot]->At(event_bin*stride_), per_event_correlation, sample);
     }
   }
 
-  void InitTask(TTreeReader *, unsigned int) {
+  /**
+   * Adds an event with a valid bin of the event axes to the statistics of a slot.
+   * @param statistics statistics of the slot
+   * @param results results of the event
+   * @param n_samples number of samples filled for each valid bin
+   * @param start start of the correlation
+   * @param correlated end of the correlation and start of the filling
+   */
+  static void CountEvent(CorrelationStatistics &statistics, const CorrelationResultBuffer &results,
+                         const std::size_t n_samples,
+                         const std::chrono::steady_clock::time_point start,
+                         const std::chrono::steady_clock::time_point correlated) {
+    const auto n_bins = results.CountValid();
+    ++statistics.events_in_range;
+    statistics.filled_bins += n_bins;
+    statistics.sample_fills += n_bins*n_samples;
+    statistics.correlate_time += correlated - start;
+    statistics.fill_time += std::chrono::steady_clock::now() - correlated;
+  }
+
+  /**
+   * Records the correlation and the filling of an event in the trace, if the event of the slot is sampled.
+   * @param statistics statistics of the slot counting its events
+   * @param start start of the correlation
+   * @param correlated end of the correlation and start of the filling
+   */
+  void TraceEvent(const CorrelationStatistics &statistics,
+                  const std::chrono::steady_clock::time_point start,
+                  const std::chrono::steady_clock::time_point correlated) {
+    if (!trace_ || !trace_->IsSampled(statistics.events - 1)) return;
+    trace_->Record(trace_correlate_, start, correlated);
+    trace_->Record(trace_fill_, correlated, std::chrono::steady_clock::now());
+  }
 
+  void InitTask(TTreeReader *, unsigned int slot) {
+    if (!slot_correlations_[slot]) ConfigureSlot(slot);
   }
 
   void Initialize() { /* no-op */}
 
   void Finalize() {
-    auto result = data_containers_.at(0);
-    const auto number_of_slots = data_containers_.size();
-    TList l;
-    for (std::size_t slot = 1; slot < number_of_slots; ++slot) {
-      l.Add(data_containers_.at(slot).get());
+    EventTrace::Scope scope(trace_.get(), trace_finalize_);
+    // the result is returned in the first slot. Slots, which did not process any task, are skipped. The shared
+    // result is already complete.
+    if (!slot_correlations_[0]) ConfigureSlot(0);
+    if (fill_batches_) {
+      for (auto &batch : *fill_batches_) batch.Flush();
     }
-    result->Merge(&l);
+    std::vector<Result_t *> others;
+    for (std::size_t slot = 1; slot < data_containers_.size() && !shared_; ++slot) {
+      if (slot_correlations_[slot]) others.push_back(data_containers_[slot].get());
+    }
+    if (checkpoint_) {
+      if (auto restored = dynamic_cast<Result_t *>(checkpoint_->GetRestored(name_))) others.push_back(restored);
+    }
+    data_containers_.at(0)->MergeTree(others, Qn::Execution::kParallel);
+    MirrorSymmetricBins(*data_containers_.at(0));
+    *statistics_ = CorrelationStatistics();
+    for (const auto &statistics : slot_statistics_) statistics_->Merge(statistics);
   }
 
+  /**
+   * Returns the partial result of a slot. Called by the thread processing the slot. In the adaptive mode the
+   * resamples of the converged bins of the slot are truncated. The shared result is returned for all slots, which
+   * is filled by the other slots at the same time.
+   * @param slot slot
+   */
   Result_t &PartialUpdate(unsigned int slot) {
+    if (fill_batches_) fill_batches_->at(slot).Flush();
+    if (adaptive_tolerance_ > 0. && slot_correlations_.at(slot)) AdaptReSamples(slot);
     return *data_containers_.at(slot);
   }
 
+  /**
+   * Truncates the resamples of all bins of a slot, for which the confidence interval has converged. Bins, which
+   * have already been truncated, are not checked again.
+   * @param slot slot
+   */
+  void AdaptReSamples(const unsigned int slot) {
+    if (resampling_method_==Qn::ReSamples::Method::kSubSamples) return;
+    for (auto &bin : *data_containers_[slot]) {
+      if (bin.GetNSamples() < n_resamples_ || bin.N() < adaptive_min_entries_) continue;
+      bin.TruncateReSamples(bin.ConvergedNumberOfReSamples(adaptive_tolerance_, adaptive_min_resamples_));
+    }
+  }
+
   std::shared_ptr<Result_t> GetResultPtr() const {
     return data_containers_.at(0);
   }
 
+  /**
+   * Returns the throughput and fill statistics of the correlation: the events, the events in the range of the event
+   * axes, the filled bins and samples and the time spent in Correlate and in filling the results. The statistics
+   * of the slots are merged at Finalize. They are only collected if enabled with SetCollectStatistics. To be called
+   * before BookMe, as the helper is moved into the booked action.
+   * @return shared pointer to the statistics, which are valid after the event loop.
+   */
+  std::shared_ptr<const CorrelationStatistics> GetStatistics() const { return statistics_; }
+
   std::string GetActionName() const {
     return name_;
   }
@@ -188,15 +873,15 @@ class CorrelationHelper<State,
 template<typename F, typename AxisConfig>
 CorrelationHelper<ConfigurationState::Start,
                   AxisConfig,
-                  Correlation<F, TemplateHelpers::TupleOf<TemplateHelpers::FunctionTraits<F>::Arity, Qn::QVector>,
-                              TemplateHelpers::TupleOf<TemplateHelpers::FunctionTraits<F>::Arity,
-                                                       Qn::DataContainerQVector>>,
+                  Correlation<F, typename TemplateHelpers::FunctionTraits<F>::DecayedArgumentTuple,
+                              typename Impl::InputDataContainers<
+                                  typename TemplateHelpers::FunctionTraits<F>::DecayedArgumentTuple>::type>,
                   typename AxisConfig::AxisValueTypeTuple,
-                  TemplateHelpers::TupleOf<TemplateHelpers::FunctionTraits<F>::Arity, Qn::DataContainerQVector>>
+                  typename Impl::InputDataContainers<
+                      typename TemplateHelpers::FunctionTraits<F>::DecayedArgumentTuple>::type>
 MakeCorrelation(const std::string &name, F function, AxisConfig event_axes) {
-  auto constexpr n_parameters = TemplateHelpers::FunctionTraits<decltype(function)>::Arity;
-  using QVectorTuple = TemplateHelpers::TupleOf<n_parameters, Qn::QVector>;
-  using DataContainerTuple = TemplateHelpers::TupleOf<n_parameters, Qn::DataContainerQVector>;
+  using QVectorTuple = typename TemplateHelpers::FunctionTraits<F>::DecayedArgumentTuple;
+  using DataContainerTuple = typename Impl::InputDataContainers<QVectorTuple>::type;
   auto correlation = Correlation<F, QVectorTuple, DataContainerTuple>(function);
   using EventParameterTuple = typename AxisConfig::AxisValueTypeTuple;
   using CorrelationType = decltype(correlation);
@@ -0,0 +1,180 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_CORRELATION_INCLUDE_CORRELATIONKERNELS_H_
+#define FLOW_CORRELATION_INCLUDE_CORRELATIONKERNELS_H_
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+
+#include "QVector.h"
+
+namespace Qn {
+namespace Correlation {
+/**
+ * Built-in correlation functions of the standard observables.
+ * The kernels are passed to MakeCorrelation like any other correlation function. The Correlation recognizes them
+ * and evaluates all non-empty bins of the first input, e.g. the u-vectors of the particles in bins of pt, against
+ * one combination of the bins of the other inputs in a single pass. The components of the first input are packed
+ * into contiguous x and y arrays once per event, with the storage position of the harmonic resolved once for the
+ * whole input, such that the loops of the kernels are vectorized by the compiler. Correlations with matched axes
+ * call the kernels bin by bin.
+ * Qn::Correlation::MakeCorrelation("v2", Qn::Correlation::Kernels::ScalarProduct<2>(), event_axes)
+ *     .SetInputNames("tracks", "psi")
+ *     .SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE);
+ */
+namespace Kernels {
+/**
+ * Scale of the Q-vector components used by a kernel.
+ */
+enum class Scale {
+  kStored,  ///< components as stored, i.e. with the normalization of the Q-vectors
+  kDeNormal ///< normalization removed as in QVector::DeNormal
+};
+
+/**
+ * Base of the batched kernels. Kernels define the harmonic kHarmonic, the scale kScale, the scalar evaluation
+ * operator() and Evaluate, which calculates the results of n bins of the first input from the packed components and
+ * the components of the other inputs.
+ */
+struct BatchKernel {};
+
+/**
+ * Returns the component of a harmonic of a Q-vector in the scale of a kernel.
+ * @param component component as stored in the Q-vector
+ * @param q the Q-vector
+ * @param scale scale of the kernel
+ * @return scaled component
+ */
+inline QVec ScaleComponent(const QVec component, const QVector &q, const Scale scale) {
+  if (scale==Scale::kStored) return component;
+  switch (q.GetNorm()) {
+    case QVector::Normalization::NONE:return component;
+    case QVector::Normalization::M:return component*q.sumweights();
+    case QVector::Normalization::SQRT_M:return component*std::sqrt(q.sumweights());
+    case QVector::Normalization::MAGNITUDE:return component*Qn::norm(component);
+  }
+  return component;
+}
+
+/**
+ * Returns the component of the harmonic h of a Q-vector in the given scale.
+ * @param q the Q-vector, which needs to have the harmonic h.
+ * @param h harmonic
+ * @param scale scale of the kernel
+ * @return scaled component
+ */
+inline QVec Component(const QVector &q, const unsigned int h, const Scale scale) {
+  return ScaleComponent({q.x(h), q.y(h)}, q, scale);
+}
+
+/**
+ * Scalar product u_h Q_h of the harmonic h of two Q-vectors.
+ * @tparam h harmonic
+ * @tparam S scale of the components
+ */
+template<unsigned int h, Scale S = Scale::kStored>
+struct ScalarProduct : BatchKernel {
+  static constexpr unsigned int kHarmonic = h;
+  static constexpr Scale kScale = S;
+  static constexpr std::size_t kNComponents = 1;
+
+  double operator()(const QVector &u, const QVector &q) const {
+    const auto a = Component(u, h, S);
+    const auto b = Component(q, h, S);
+    return static_cast<double>(a.x)*b.x + static_cast<double>(a.y)*b.y;
+  }
+
+  /**
+   * Evaluates n bins of the first input.
+   * @param references components of the other inputs
+   * @param x packed x-components of the first input
+   * @param y packed y-components of the first input
+   * @param n number of packed bins
+   * @param result results of the bins
+   */
+  void Evaluate(const std::array<QVec, 1> &references, const float *x, const float *y, const std::size_t n,
+                double *result) const {
+    const double qx = references[0].x;
+    const double qy = references[0].y;
+    for (std::size_t i = 0; i < n; ++i) result[i] = x[i]*qx + y[i]*qy;
+  }
+};
+
+/**
+ * Correlation Q_a Q_b of two subevents used in the two-subevent resolution. The same product as ScalarProduct.
+ * @tparam h harmonic
+ * @tparam S scale of the components
+ */
+template<unsigned int h, Scale S = Scale::kStored>
+using TwoSubEvent = ScalarProduct<h, S>;
+
+/**
+ * The three correlations Q_a Q_b, Q_a Q_c and Q_b Q_c of three subevents used in the three-subevent resolution
+ * R_a = sqrt(<Q_a Q_b><Q_a Q_c>/<Q_b Q_c>). The correlations are filled into the component axis.
+ * @tparam h harmonic
+ * @tparam S scale of the components
+ */
+template<unsigned int h, Scale S = Scale::kStored>
+struct ThreeSubEvent : BatchKernel {
+  static constexpr unsigned int kHarmonic = h;
+  static constexpr Scale kScale = S;
+  static constexpr std::size_t kNComponents = 3;
+
+  std::array<double, 3> operator()(const QVector &qa, const QVector &qb, const QVector &qc) const {
+    const auto a = Component(qa, h, S);
+    const auto b = Component(qb, h, S);
+    const auto c = Component(qc, h, S);
+    return {static_cast<double>(a.x)*b.x + static_cast<double>(a.y)*b.y,
+            static_cast<double>(a.x)*c.x + static_cast<double>(a.y)*c.y,
+            static_cast<double>(b.x)*c.x + static_cast<double>(b.y)*c.y};
+  }
+
+  /**
+   * Evaluates n bins of the first input. The results of the component k are stored at result[k*n + i].
+   * @param references components of the second and third input
+   * @param x packed x-components of the first input
+   * @param y packed y-components of the first input
+   * @param n number of packed bins
+   * @param result results of the bins
+   */
+  void Evaluate(const std::array<QVec, 2> &references, const float *x, const float *y, const std::size_t n,
+                double *result) const {
+    const double bx = references[0].x;
+    const double by = references[0].y;
+    const double cx = references[1].x;
+    const double cy = references[1].y;
+    const double bc = bx*cx + by*cy;
+    for (std::size_t i = 0; i < n; ++i) result[i] = x[i]*bx + y[i]*by;
+    for (std::size_t i = 0; i < n; ++i) result[n + i] = x[i]*cx + y[i]*cy;
+    for (std::size_t i = 0; i < n; ++i) result[2*n + i] = bc;
+  }
+};
+}
+
+namespace Impl {
+/**
+ * Checks if a correlation function is a batched kernel.
+ * @tparam Function type of the correlation function
+ */
+template<typename Function>
+struct IsBatchKernel : std::is_base_of<Kernels::BatchKernel, Function> {};
+}
+}
+}
+#endif //FLOW_CORRELATION_INCLUDE_CORRELATIONKERNELS_H_
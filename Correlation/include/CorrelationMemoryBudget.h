@@ -0,0 +1,105 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_CORRELATIONMEMORYBUDGET_H
+#define FLOW_CORRELATIONMEMORYBUDGET_H
+
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Qn {
+namespace Correlation {
+/**
+ * @class CorrelationMemoryBudget
+ * @brief Accounts the estimated memory of the results of the booked correlations. The results are allocated for
+ * all slots during the event loop. Their memory is estimated when the correlations are booked, such that jobs
+ * exceeding the budget fail before the event loop starts. Shared by all correlations of a RDataFrame.
+ */
+class CorrelationMemoryBudget {
+ public:
+  /**
+   * Action taken when a correlation exceeds the budget.
+   */
+  enum class Policy {
+    kReport, ///< the estimate is only accounted
+    kFail, ///< the booking fails with a std::runtime_error
+    kCompact ///< the correlation uses the compact storage and fewer resamples to fit. Fails if it still exceeds.
+  };
+
+  /**
+   * Constructor
+   * @param budget budget in bytes. Unlimited if zero.
+   * @param policy action taken when a correlation exceeds the budget
+   */
+  explicit CorrelationMemoryBudget(std::size_t budget = 0, Policy policy = Policy::kFail) :
+      budget_(budget), policy_(policy) {}
+
+  Policy GetPolicy() const { return policy_; }
+
+  /**
+   * Returns the bytes left in the budget.
+   */
+  std::size_t Available() const {
+    if (budget_==0) return static_cast<std::size_t>(-1);
+    return total_ < budget_ ? budget_ - total_ : 0;
+  }
+
+  bool Fits(std::size_t bytes) const { return bytes <= Available(); }
+
+  /**
+   * Accounts the estimated memory of a correlation.
+   * @param name name of the correlation
+   * @param bytes estimated bytes
+   */
+  void Add(const std::string &name, std::size_t bytes) {
+    if (!Fits(bytes) && policy_!=Policy::kReport) {
+      throw std::runtime_error("The correlation " + name + " needs an estimated " + std::to_string(bytes) +
+          " bytes, which exceeds the memory budget. " + std::to_string(Available()) + " bytes are left.");
+    }
+    entries_.emplace_back(name, bytes);
+    total_ += bytes;
+  }
+
+  std::size_t GetTotal() const { return total_; }
+
+  /**
+   * Returns the names and the estimated bytes of the booked correlations.
+   */
+  const std::vector<std::pair<std::string, std::size_t>> &GetEntries() const { return entries_; }
+
+  /**
+   * Prints the estimated memory of each correlation and the total.
+   * @param stream the output stream
+   */
+  void Print(std::ostream &stream) const {
+    for (const auto &entry : entries_) stream << entry.first << ": " << entry.second << " bytes" << std::endl;
+    stream << "total: " << total_ << " bytes";
+    if (budget_ > 0) stream << " of " << budget_ << " bytes";
+    stream << std::endl;
+  }
+
+ private:
+  std::size_t budget_; ///< budget in bytes. Unlimited if zero.
+  Policy policy_; ///< action taken when a correlation exceeds the budget
+  std::size_t total_ = 0; ///< estimated bytes of the booked correlations
+  std::vector<std::pair<std::string, std::size_t>> entries_; ///< estimated bytes of each correlation
+};
+}
+}
+#endif //FLOW_CORRELATIONMEMORYBUDGET_H
@@ -0,0 +1,423 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_CORRELATION_INCLUDE_CORRELATIONSET_H_
+#define FLOW_CORRELATION_INCLUDE_CORRELATIONSET_H_
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "ROOT/RDF/ActionHelpers.hxx"
+#include "ROOT/RVec.hxx"
+
+#include "Correlation.h"
+#include "CorrelationHelper.h"
+#include "AxesConfiguration.h"
+
+#include "DataContainer.h"
+
+namespace Qn {
+namespace Correlation {
+
+namespace Impl {
+/**
+ * @brief Type-erased correlation of a CorrelationSet.
+ * @tparam NColumns number of Q-vector columns of the set.
+ */
+template<std::size_t NColumns>
+class CorrelationSetEntryBase {
+ public:
+  using Inputs = std::array<const DataContainerQVector *, NColumns>;
+  virtual ~CorrelationSetEntryBase() = default;
+  virtual std::unique_ptr<CorrelationSetEntryBase> Clone() const = 0;
+  virtual void Initialize(TTreeReader &reader) = 0;
+  virtual void Initialize(const Inputs &inputs) = 0;
+  virtual std::vector<Qn::AxisD> GetCorrelationAxes() const = 0;
+  virtual bool IsObservable() const = 0;
+  virtual bool IsEvaluated(std::size_t bin) const = 0;
+  virtual const CorrelationResultBuffer &Correlate(const Inputs &inputs) = 0;
+};
+
+/**
+ * @brief Correlation of a CorrelationSet using a subset of the Q-vector columns of the set.
+ * @tparam NColumns number of Q-vector columns of the set.
+ * @tparam CorrelationType type of the correlation
+ */
+template<std::size_t NColumns, typename CorrelationType>
+class CorrelationSetEntry : public CorrelationSetEntryBase<NColumns> {
+ public:
+  static constexpr std::size_t NInputs = CorrelationType::NInputs;
+  using Inputs = typename CorrelationSetEntryBase<NColumns>::Inputs;
+
+  /**
+   * Constructor
+   * @param correlation correlation
+   * @param input_names names of the inputs of the correlation
+   * @param columns positions of the inputs in the Q-vector columns of the set
+   * @param weights weights of the inputs
+   * @param matched_axes names of the matched axes.
+   */
+  CorrelationSetEntry(CorrelationType correlation,
+                      const std::array<std::string, NInputs> &input_names,
+                      const std::array<std::size_t, NInputs> &columns,
+                      const std::array<Qn::Stats::Weights, NInputs> &weights,
+                      std::vector<std::string> matched_axes) :
+      correlation_(std::move(correlation)),
+      columns_(columns) {
+    Configure(input_names, weights, std::make_index_sequence<NInputs>{});
+    correlation_.SetMatchedAxes(std::move(matched_axes));
+  }
+
+  std::unique_ptr<CorrelationSetEntryBase<NColumns>> Clone() const override {
+    return std::make_unique<CorrelationSetEntry>(*this);
+  }
+
+  void Initialize(TTreeReader &reader) override { correlation_.Initialize(reader); }
+
+  void Initialize(const Inputs &inputs) override { Initialize(inputs, std::make_index_sequence<NInputs>{}); }
+
+  std::vector<Qn::AxisD> GetCorrelationAxes() const override { return correlation_.GetCorrelationAxes(); }
+
+  bool IsObservable() const override { return correlation_.IsObservable(); }
+
+  bool IsEvaluated(const std::size_t bin) const override { return correlation_.IsEvaluated(bin); }
+
+  const CorrelationResultBuffer &Correlate(const Inputs &inputs) override {
+    return Correlate(inputs, std::make_index_sequence<NInputs>{});
+  }
+
+ private:
+  template<std::size_t... I>
+  void Configure(const std::array<std::string, NInputs> &input_names,
+                 const std::array<Qn::Stats::Weights, NInputs> &weights,
+                 std::index_sequence<I...>) {
+    correlation_.SetInputNames(input_names[I]...);
+    correlation_.SetWeights(weights[I]...);
+  }
+
+  template<std::size_t... I>
+  void Initialize(const Inputs &inputs, std::index_sequence<I...>) {
+    correlation_.Initialize({{inputs[columns_[I]]...}});
+  }
+
+  template<std::size_t... I>
+  const CorrelationResultBuffer &Correlate(const Inputs &inputs, std::index_sequence<I...>) {
+    return correlation_.Correlate(*inputs[columns_[I]]...);
+  }
+
+  CorrelationType correlation_; ///< correlation
+  std::array<std::size_t, NInputs> columns_; ///< positions of the inputs in the Q-vector columns of the set
+};
+}
+
+template<typename AxisConfig, typename EventParameters, typename DataContainers>
+class CorrelationSet;
+
+/**
+ * @class CorrelationSet
+ * @brief RDataFrame action calculating many correlations of a shared set of Q-vector columns.
+ * Each input, the resampling column and the bin of the event axes are read once per event and are shared by all
+ * correlations of the set, which are filled in a single Exec.
+ */
+template<typename AxisConfig, typename... EventParameters, typename... DataContainers>
+class CorrelationSet<AxisConfig, std::tuple<EventParameters...>, std::tuple<DataContainers...>> :
+    public RActionImpl<CorrelationSet<AxisConfig, std::tuple<EventParameters...>, std::tuple<DataContainers...>>> {
+ public:
+  static constexpr std::size_t NColumns = sizeof...(DataContainers);
+  using Result_t = std::map<std::string, Qn::DataContainerStats>;
+  using EntryBase = Impl::CorrelationSetEntryBase<NColumns>;
+
+ private:
+  std::string name_; //!<! Name of the set
+  std::array<std::string, NColumns> input_names_; //!<! Names of the Q-vector columns
+  AxisConfig event_axes_config_; //!<! Axis configuration of the event axes
+  std::vector<std::string> names_; //!<! Names of the correlations
+  std::vector<std::unique_ptr<EntryBase>> correlations_; //!<! correlations as configured by the user
+  std::vector<std::vector<std::unique_ptr<EntryBase>>> slot_correlations_; //!<! correlations of each slot
+  std::vector<std::shared_ptr<Result_t>> results_; //!<! result data containers of each slot
+  std::vector<std::vector<Qn::DataContainerStats *>> slot_results_; //!<! result data containers ordered as names_
+  std::vector<std::size_t> strides_; //!<! sizes of the correlations without event axes
+  std::size_t n_resamples_ = 0; //!<! number of resamples
+  Qn::Statistic::Accumulation accumulation_ = Qn::Statistic::Accumulation::kIncremental; //!<! accumulation mode
+  Qn::ReSamples::Storage sample_storage_ = Qn::ReSamples::Storage::kFull; //!<! storage of the bootstrap samples
+  Qn::ReSamples::Method resampling_method_ = Qn::ReSamples::Method::kBootstrap; //!<! resampling method
+  std::vector<char> slot_configured_; //!<! slot has been configured. Not vector<bool>, as slots set it concurrently
+
+ public:
+  CorrelationSet(std::string name, AxisConfig event_axes_config, std::array<std::string, NColumns> input_names) :
+      name_(std::move(name)),
+      input_names_(std::move(input_names)),
+      event_axes_config_(std::move(event_axes_config)) {
+    const auto n_slots = ROOT::IsImplicitMTEnabled() ? ROOT::GetImplicitMTPoolSize() : 1;
+    for (std::size_t i = 0; i < n_slots; ++i) {
+      results_.emplace_back(std::make_shared<Result_t>());
+    }
+  }
+
+  CorrelationSet(CorrelationSet &&other) = default;
+
+  /**
+   * Adds a correlation to the set.
+   * @tparam F type of the correlation function
+   * @param name name of the correlation. Used as key of the result.
+   * @param function correlation function
+   * @param input_names names of the Q-vector columns used as input of the function
+   * @param weights weights of the inputs
+   * @param matched_axes names of the matched axes. See Correlation::SetMatchedAxes.
+   * @return the set
+   */
+  template<typename F>
+  CorrelationSet &AddCorrelation(std::string name, F function,
+                                 const std::array<std::string, TemplateHelpers::FunctionTraits<F>::Arity> &input_names,
+                                 const std::array<Qn::Stats::Weights,
+                                                  TemplateHelpers::FunctionTraits<F>::Arity> &weights,
+                                 std::vector<std::string> matched_axes = {}) {
+    constexpr auto n_parameters = TemplateHelpers::FunctionTraits<F>::Arity;
+    using QVectorTuple = typename TemplateHelpers::FunctionTraits<F>::DecayedArgumentTuple;
+    using DataContainerTuple = TemplateHelpers::TupleOf<n_parameters, Qn::DataContainerQVector>;
+    using CorrelationType = Correlation<F, QVectorTuple, DataContainerTuple>;
+    if (std::find(names_.begin(), names_.end(), name)!=names_.end()) {
+      throw std::logic_error("The correlation " + name + " is already part of the set " + name_ + ".");
+    }
+    std::array<std::size_t, n_parameters> columns;
+    for (std::size_t i = 0; i < n_parameters; ++i) {
+      auto column = std::find(input_names_.begin(), input_names_.end(), input_names[i]);
+      if (column==input_names_.end()) {
+        throw std::logic_error("The input " + input_names[i] + " is not a column of the set " + name_ + ".");
+      }
+      columns[i] = std::distance(input_names_.begin(), column);
+    }
+    names_.push_back(std::move(name));
+    correlations_.emplace_back(std::make_unique<Impl::CorrelationSetEntry<NColumns, CorrelationType>>(
+        CorrelationType(function), input_names, columns, weights, std::move(matched_axes)));
+    return *this;
+  }
+
+  /**
+   * Sets the accumulation mode of the bootstrap samples of all correlations of the set.
+   * @param accumulation accumulation mode
+   * @return the set
+   */
+  CorrelationSet &SetAccumulation(Qn::Statistic::Accumulation accumulation) {
+    accumulation_ = accumulation;
+    return *this;
+  }
+
+  /**
+   * Sets the storage of the bootstrap samples of all correlations of the set. The compact storages reduce the
+   * memory of the results, when only the means of the samples are needed.
+   * @param storage storage of the samples
+   * @return the set
+   */
+  CorrelationSet &SetSampleStorage(Qn::ReSamples::Storage storage) {
+    sample_storage_ = storage;
+    return *this;
+  }
+
+  /**
+   * Sets the resampling method of all correlations of the set. With sub-samples the column "Samples" is the
+   * sub-sample of the event as given by the SubSampler and only this sample is filled.
+   * @param method resampling method
+   * @return the set
+   */
+  CorrelationSet &SetReSamplingMethod(Qn::ReSamples::Method method) {
+    resampling_method_ = method;
+    return *this;
+  }
+
+  template<typename DATAFRAME>
+  ROOT::RDF::RResultPtr<Result_t> BookMe(DATAFRAME &df, TTreeReader &reader, const std::size_t n_resamples) {
+    Configure(reader, n_resamples);
+    return Book(df);
+  }
+
+  /**
+   * Books the set with the binning of the inputs given by data containers instead of a tree, e.g. the layouts of
+   * the flat Q-vectors of a RNTuple.
+   * @param df RDataFrame
+   * @param inputs input data containers ordered as the Q-vector columns of the set
+   * @param n_resamples number of resamples
+   */
+  template<typename DATAFRAME>
+  ROOT::RDF::RResultPtr<Result_t> BookMe(DATAFRAME &df,
+                                         const typename EntryBase::Inputs &inputs,
+                                         const std::size_t n_resamples) {
+    Configure(inputs, n_resamples);
+    return Book(df);
+  }
+
+  /**
+   * Fills all correlations of the set for one event. The event bin is only looked up once.
+   */
+  void Exec(unsigned int slot,
+            const SampleMultiplicities &sample_ids,
+            const DataContainers &... data_containers,
+            const EventParameters &... coordinates) {
+    auto event_bin = event_axes_config_.GetLinearIndexFromCoordinates(coordinates...);
+    if (event_bin < 0) return;
+    const typename EntryBase::Inputs inputs = {{&data_containers...}};
+    auto &correlations = slot_correlations_[slot];
+    auto &results = slot_results_[slot];
+    for (std::size_t i = 0; i < correlations.size(); ++i) {
+      const auto &per_event_correlation = correlations[i]->Correlate(inputs);
+      Qn::Stats::FillPoisson(&results[i]->At(event_bin*strides_[i]), per_event_correlation, sample_ids);
+    }
+  }
+
+  /**
+   * Fills all correlations of the set for one event into its sub-sample.
+   */
+  void Exec(unsigned int slot,
+            const ULong64_t sample,
+            const DataContainers &... data_containers,
+            const EventParameters &... coordinates) {
+    auto event_bin = event_axes_config_.GetLinearIndexFromCoordinates(coordinates...);
+    if (event_bin < 0) return;
+    const typename EntryBase::Inputs inputs = {{&data_containers...}};
+    auto &correlations = slot_correlations_[slot];
+    auto &results = slot_results_[slot];
+    for (std::size_t i = 0; i < correlations.size(); ++i) {
+      const auto &per_event_correlation = correlations[i]->Correlate(inputs);
+      Qn::Stats::FillSubSample(&results[i]->At(event_bin*strides_[i]), per_event_correlation, sample);
+    }
+  }
+
+  void InitTask(TTreeReader *, unsigned int slot) {
+    if (!slot_configured_[slot]) ConfigureSlot(slot);
+  }
+
+  void Initialize() { /* no-op */}
+
+  void Finalize() {
+    // the result is returned in the first slot. Slots, which did not process any task, are skipped.
+    if (!slot_configured_[0]) ConfigureSlot(0);
+    auto &result = *results_.at(0);
+    for (const auto &name : names_) {
+      std::vector<Qn::DataContainerStats *> others;
+      for (std::size_t slot = 1; slot < results_.size(); ++slot) {
+        if (slot_configured_[slot]) others.push_back(&results_[slot]->at(name));
+      }
+      result.at(name).MergeTree(others, Qn::Execution::kParallel);
+    }
+  }
+
+  Result_t &PartialUpdate(unsigned int slot) {
+    return *results_.at(slot);
+  }
+
+  std::shared_ptr<Result_t> GetResultPtr() const {
+    return results_.at(0);
+  }
+
+  std::string GetActionName() const {
+    return name_;
+  }
+
+  const std::array<std::string, NColumns> &GetInputNames() const { return input_names_; }
+  Qn::ReSamples::Method GetReSamplingMethod() const { return resampling_method_; }
+
+  /**
+   * Initializes the correlations from the Q-vectors in memory instead of a tree. Used when the set is filled in the
+   * event loop of the correction. The slots are configured later.
+   * @param inputs input data containers ordered as the Q-vector columns of the set.
+   * @param n_resamples number of resamples
+   */
+  void Configure(const typename EntryBase::Inputs &inputs, const std::size_t n_resamples) {
+    ConfigureCorrelations([&inputs](EntryBase &correlation) { correlation.Initialize(inputs); }, n_resamples);
+  }
+
+ private:
+  template<typename DATAFRAME>
+  ROOT::RDF::RResultPtr<Result_t> Book(DATAFRAME &df) {
+    const auto input_names = input_names_;
+    const auto event_axes_config = event_axes_config_;
+    const auto resampling_method = resampling_method_;
+    return Impl::BookAction<DataContainers..., EventParameters...>(df, std::move(*this), input_names,
+                                                                   event_axes_config, resampling_method);
+  }
+
+  /**
+   * Initializes the correlations. The slots are configured later by the thread processing the slot.
+   * @param reader TTreeReader of the input tree.
+   * @param n_resamples number of resamples
+   */
+  void Configure(TTreeReader &reader, const std::size_t n_resamples) {
+    ConfigureCorrelations([&reader](EntryBase &correlation) { correlation.Initialize(reader); }, n_resamples);
+  }
+
+  template<typename Initialization>
+  void ConfigureCorrelations(Initialization &&initialize, const std::size_t n_resamples) {
+    n_resamples_ = n_resamples;
+    strides_.clear();
+    for (auto &correlation : correlations_) {
+      initialize(*correlation);
+      strides_.push_back(Impl::CorrelationSize(*correlation));
+    }
+    slot_correlations_.clear();
+    slot_correlations_.resize(results_.size());
+    slot_results_.clear();
+    slot_results_.resize(results_.size());
+    slot_configured_.assign(results_.size(), false);
+  }
+
+  /**
+   * Configures the result data containers and the correlations of a slot. Called by the thread processing the
+   * slot, such that the memory of the slot is allocated and first touched by this thread.
+   * @param slot slot
+   */
+  void ConfigureSlot(const unsigned int slot) {
+    auto event_axes = event_axes_config_.GetVector();
+    auto &result = *results_[slot];
+    for (std::size_t i = 0; i < correlations_.size(); ++i) {
+      auto &data = result[names_[i]];
+      Impl::ConfigureResult(data, event_axes, *correlations_[i], strides_[i], n_resamples_, sample_storage_,
+                            accumulation_, resampling_method_);
+      // each slot uses its own copy of the correlation, because the per event results are stored in it.
+      slot_correlations_[slot].emplace_back(correlations_[i]->Clone());
+      slot_results_[slot].push_back(&data);
+    }
+    slot_configured_[slot] = true;
+  }
+};
+
+/**
+ * Creates a set of correlations sharing the Q-vector columns and the event axes.
+ * @tparam AxisConfig type of the event axes configuration
+ * @tparam Names types of the names of the Q-vector columns
+ * @param name name of the set
+ * @param event_axes event axes
+ * @param input_names names of the Q-vector columns
+ * @return the correlation set
+ */
+template<typename AxisConfig, typename... Names>
+CorrelationSet<AxisConfig,
+               typename AxisConfig::AxisValueTypeTuple,
+               TemplateHelpers::TupleOf<sizeof...(Names), Qn::DataContainerQVector>>
+MakeCorrelationSet(const std::string &name, AxisConfig event_axes, Names... input_names) {
+  using EventParameterTuple = typename AxisConfig::AxisValueTypeTuple;
+  using DataContainerTuple = TemplateHelpers::TupleOf<sizeof...(Names), Qn::DataContainerQVector>;
+  return CorrelationSet<AxisConfig, EventParameterTuple, DataContainerTuple>(
+      name, std::move(event_axes), {{std::string(input_names)...}});
+}
+
+}
+}
+#endif //FLOW_CORRELATION_INCLUDE_CORRELATIONSET_H_
@@ -0,0 +1,67 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_CORRELATIONSTATISTICS_H
+#define FLOW_CORRELATIONSTATISTICS_H
+
+#include <chrono>
+#include <ostream>
+#include <string>
+
+namespace Qn {
+namespace Correlation {
+/**
+ * @brief Throughput and fill statistics of a booked correlation. Each slot accumulates its own statistics, which
+ * are merged at the end of the event loop.
+ */
+struct alignas(64) CorrelationStatistics {
+  unsigned long long events = 0; ///< events seen
+  unsigned long long events_in_range = 0; ///< events with a valid bin of the event axes
+  unsigned long long filled_bins = 0; ///< output bins filled
+  unsigned long long sample_fills = 0; ///< fills of bootstrap samples or sub-samples
+  std::chrono::steady_clock::duration correlate_time{}; ///< time spent in Correlate
+  std::chrono::steady_clock::duration fill_time{}; ///< time spent filling the results and their samples
+
+  double CorrelateSeconds() const { return std::chrono::duration<double>(correlate_time).count(); }
+  double FillSeconds() const { return std::chrono::duration<double>(fill_time).count(); }
+
+  /**
+   * Adds the statistics of another slot.
+   * @param other statistics of the other slot
+   */
+  void Merge(const CorrelationStatistics &other) {
+    events += other.events;
+    events_in_range += other.events_in_range;
+    filled_bins += other.filled_bins;
+    sample_fills += other.sample_fills;
+    correlate_time += other.correlate_time;
+    fill_time += other.fill_time;
+  }
+
+  /**
+   * Prints the statistics in a single line.
+   * @param stream the output stream
+   * @param name name of the correlation
+   */
+  void Print(std::ostream &stream, const std::string &name) const {
+    stream << name << ": " << events << " events, " << events_in_range << " in range, "
+           << filled_bins << " filled bins, " << sample_fills << " sample fills, "
+           << CorrelateSeconds() << " s correlate, " << FillSeconds() << " s fill" << std::endl;
+  }
+};
+}
+}
+#endif //FLOW_CORRELATIONSTATISTICS_H
@@ -0,0 +1,160 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_CORRELATION_INCLUDE_CORRELATIONSTREAM_H_
+#define FLOW_CORRELATION_INCLUDE_CORRELATIONSTREAM_H_
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "CorrelationSet.h"
+#include "ReSampler.h"
+
+#include "DataContainer.h"
+
+namespace Qn {
+namespace Correlation {
+
+template<typename Set>
+class CorrelationStream;
+
+/**
+ * @class CorrelationStream
+ * @brief Fills a CorrelationSet in the event loop of the correction, instead of writing the corrected Q-vectors to
+ * a tree and reading them again. The Q-vectors are looked up once by the names of the columns of the set, e.g.
+ * "<detector>_RECENTERED" for the Q-vectors of a detector after the recentering, and are read in place in each
+ * event. The values of the event axes are read from the variable container.
+ * The resamples of an event are generated from the number of filled events, such that the bootstrap samples are
+ * reproducible with the same seed.
+ */
+template<typename AxisConfig, typename... EventParameters, typename... DataContainers>
+class CorrelationStream<CorrelationSet<AxisConfig, std::tuple<EventParameters...>, std::tuple<DataContainers...>>> {
+ public:
+  using Set = CorrelationSet<AxisConfig, std::tuple<EventParameters...>, std::tuple<DataContainers...>>;
+  using Inputs = typename Set::EntryBase::Inputs;
+  using Result_t = typename Set::Result_t;
+  using InputSource = std::function<const Qn::DataContainerQVector *(const std::string &)>;
+
+  /**
+   * Constructor
+   * @param set configured correlation set
+   * @param n_resamples number of resamples
+   * @param seed seed of the resamples
+   */
+  CorrelationStream(Set set, std::size_t n_resamples, ULong64_t seed = 0) :
+      set_(std::move(set)),
+      n_resamples_(n_resamples),
+      re_sampler_(n_resamples, seed),
+      sub_sampler_(n_resamples, seed) {}
+
+  /**
+   * Sets the source of the Q-vectors.
+   * @tparam Source type of the source providing GetQVector(name), e.g. the CorrectionManager.
+   * @param source the source. Lifetime needs to exceed the one of the stream.
+   */
+  template<typename Source>
+  void SetInputSource(Source &source) {
+    source_ = [&source](const std::string &name) -> const Qn::DataContainerQVector * { return source.GetQVector(name); };
+  }
+
+  /**
+   * Sets the values of the event axes.
+   * @param coordinates pointers to the values of the event axes, e.g. in the variable container.
+   */
+  void SetEventParameters(const EventParameters *... coordinates) {
+    coordinates_ = std::make_tuple(coordinates...);
+    coordinates_set_ = true;
+  }
+
+  /**
+   * Fills the correlations of the current event. To be called after the corrections of an event passing the
+   * event cuts have been processed.
+   */
+  void Fill() {
+    if (!configured_) Configure();
+    const auto entry = n_events_++;
+    if (set_.GetReSamplingMethod()==Qn::ReSamples::Method::kSubSamples) {
+      Exec(sub_sampler_(entry), std::make_index_sequence<sizeof...(DataContainers)>{},
+           std::index_sequence_for<EventParameters...>{});
+    } else {
+      samples_.resize(n_resamples_);
+      re_sampler_.Generate(entry, samples_.data());
+      Exec(SampleMultiplicities(samples_.data(), samples_.size()),
+           std::make_index_sequence<sizeof...(DataContainers)>{},
+           std::index_sequence_for<EventParameters...>{});
+    }
+  }
+
+  /**
+   * Finalizes the correlations after the last event.
+   * @return results of the correlations of the set
+   */
+  std::shared_ptr<Result_t> Finalize() {
+    set_.Finalize();
+    return set_.GetResultPtr();
+  }
+
+ private:
+  void Configure() {
+    if (!source_) throw std::logic_error("The source of the Q-vectors of the correlations is not set.");
+    if (!coordinates_set_) {
+      throw std::logic_error("The event parameters of the correlations are not set.");
+    }
+    const auto &names = set_.GetInputNames();
+    for (std::size_t i = 0; i < names.size(); ++i) inputs_[i] = source_(names[i]);
+    set_.Configure(inputs_, n_resamples_);
+    set_.InitTask(nullptr, 0);
+    configured_ = true;
+  }
+
+  template<typename Samples, std::size_t... I, std::size_t... J>
+  void Exec(const Samples &samples, std::index_sequence<I...>, std::index_sequence<J...>) {
+    set_.Exec(0, samples, *inputs_[I]..., *std::get<J>(coordinates_)...);
+  }
+
+  Set set_; ///< correlations
+  std::size_t n_resamples_; ///< number of resamples
+  ReSampler re_sampler_; ///< generator of the bootstrap samples
+  SubSampler sub_sampler_; ///< generator of the sub-samples
+  std::vector<UChar_t> samples_; ///< multiplicities of the current event in the bootstrap samples
+  InputSource source_; ///< source of the Q-vectors
+  Inputs inputs_{}; ///< Q-vectors of the columns of the set
+  std::tuple<const EventParameters *...> coordinates_; ///< values of the event axes
+  bool coordinates_set_ = false; ///< the values of the event axes are set
+  ULong64_t n_events_ = 0; ///< number of filled events
+  bool configured_ = false; ///< the correlations are initialized from the Q-vectors
+};
+
+/**
+ * Creates a stream filling a correlation set in the event loop of the correction.
+ * @param set configured correlation set
+ * @param n_resamples number of resamples
+ * @param seed seed of the resamples
+ * @return the stream
+ */
+template<typename Set>
+CorrelationStream<Set> MakeCorrelationStream(Set set, std::size_t n_resamples, ULong64_t seed = 0) {
+  return CorrelationStream<Set>(std::move(set), n_resamples, seed);
+}
+
+}
+}
+#endif //FLOW_CORRELATION_INCLUDE_CORRELATIONSTREAM_H_
@@ -0,0 +1,270 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_CORRELATION_INCLUDE_FLATQVECTORREADER_H_
+#define FLOW_CORRELATION_INCLUDE_FLATQVECTORREADER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ROOT/RDataFrame.hxx"
+#include "ROOT/RVec.hxx"
+#ifdef FLOW_USE_RNTUPLE
+#include "ROOT/RNTupleDS.hxx"
+#endif
+#include "TTreeReader.h"
+#include "TTreeReaderArray.h"
+
+#include "DataContainer.h"
+#include "FlatQVectors.h"
+#include "OutputLayout.h"
+
+namespace Qn {
+namespace Correlation {
+
+/**
+ * @class FlatQVectorReader
+ * @brief Reads Q-vectors, which are written in the flat layout of FlatQVectors, without deserializing objects.
+ * The arrays of the event are read by TTreeReaderArrays. The views of the bins refer to their buffers.
+ * Q-vectors with a compact encoding are decoded once per event into buffers of full floats, to which the views refer.
+ */
+class FlatQVectorReader {
+ public:
+  /**
+   * Constructor
+   * @param reader reader of the tree
+   * @param name name of the Q-vectors, i.e. "<detector>_<STEP>"
+   */
+  FlatQVectorReader(TTreeReader &reader, const std::string &name) :
+      name_(name),
+      reader_(&reader),
+      n_(reader, (name + "_n").data()),
+      sumw_(reader, (name + "_sumw").data()) {
+    auto tree = reader.GetTree();
+    // the layout is stored in the user info of the trees of the files, not of the chain.
+    tree->LoadTree(0);
+    q_vectors_ = ReadOutputLayout<DataContainerQVector>(tree->GetTree(), name_);
+    encoding_ = FlatQVectors::Encoding::FromString(ReadOutputEncoding(tree->GetTree()->GetUserInfo(), name_));
+    if (q_vectors_.size() > 0) {
+      harmonics_ = q_vectors_.At(0).GetHarmonics();
+      n_harmonics_ = harmonics_.count();
+    }
+    if (encoding_.method==FlatQVectors::Encoding::Method::kFixedPoint) {
+      x_fixed_ = std::make_unique<TTreeReaderArray<short>>(reader, (name + "_xfix").data());
+      y_fixed_ = std::make_unique<TTreeReaderArray<short>>(reader, (name + "_yfix").data());
+      x_decoded_.resize(q_vectors_.size()*n_harmonics_);
+      y_decoded_.resize(q_vectors_.size()*n_harmonics_);
+    } else {
+      x_ = std::make_unique<TTreeReaderArray<float>>(reader, (name + "_x").data());
+      y_ = std::make_unique<TTreeReaderArray<float>>(reader, (name + "_y").data());
+    }
+    if (encoding_.IsCompact()) {
+      quality_bits_ = std::make_unique<TTreeReaderArray<unsigned char>>(reader, (name + "_qualitybits").data());
+      quality_decoded_.resize(q_vectors_.size());
+    } else {
+      quality_ = std::make_unique<TTreeReaderArray<unsigned char>>(reader, (name + "_quality").data());
+    }
+  }
+
+  std::size_t size() const { return q_vectors_.size(); }
+
+  /**
+   * Returns the layout of the Q-vectors. Its axes and harmonics are identical to the ones of the written Q-vectors.
+   */
+  const DataContainerQVector &GetLayout() const { return q_vectors_; }
+
+  /**
+   * Returns the encoding of the components of the written Q-vectors.
+   */
+  const FlatQVectors::Encoding &GetEncoding() const { return encoding_; }
+
+  /**
+   * Returns a view of the Q-vector of a bin in the current event referring to the read buffers.
+   * @param ibin linear bin
+   * @return view of the Q-vector
+   */
+  FlatQVectorView View(const std::size_t ibin) {
+    Decode();
+    const auto offset = ibin*n_harmonics_;
+    return {x_data_ + offset, y_data_ + offset, n_[ibin], sumw_[ibin], quality_data_[ibin], harmonics_};
+  }
+
+  /**
+   * Restores the Q-vectors of the current event, e.g. to pass them to a Correlation.
+   * The container is allocated once and overwritten in each event.
+   * @return the Q-vectors
+   */
+  const DataContainerQVector &Get() {
+    Decode();
+    FlatQVectors::Unpack(x_data_, y_data_, &n_[0], &sumw_[0], quality_data_, q_vectors_);
+    return q_vectors_;
+  }
+
+ private:
+  /**
+   * Decodes the compact arrays of the current event once. The other arrays are used directly.
+   */
+  void Decode() {
+    const auto entry = reader_->GetCurrentEntry();
+    if (entry==decoded_entry_) return;
+    decoded_entry_ = entry;
+    if (x_fixed_) {
+      const auto step = encoding_.GetStep();
+      FlatQVectors::Decode(&(*x_fixed_)[0], x_decoded_.size(), step, x_decoded_.data());
+      FlatQVectors::Decode(&(*y_fixed_)[0], y_decoded_.size(), step, y_decoded_.data());
+      x_data_ = x_decoded_.data();
+      y_data_ = y_decoded_.data();
+    } else {
+      x_data_ = &(*x_)[0];
+      y_data_ = &(*y_)[0];
+    }
+    if (quality_bits_) {
+      FlatQVectors::UnpackQuality(&(*quality_bits_)[0], quality_decoded_.size(), quality_decoded_.data());
+      quality_data_ = quality_decoded_.data();
+    } else {
+      quality_data_ = &(*quality_)[0];
+    }
+  }
+
+  std::string name_; ///< name of the Q-vectors
+  TTreeReader *reader_ = nullptr; ///< reader of the tree
+  FlatQVectors::Encoding encoding_; ///< encoding of the components
+  std::unique_ptr<TTreeReaderArray<float>> x_; ///< x-components of all bins and harmonics
+  std::unique_ptr<TTreeReaderArray<float>> y_; ///< y-components of all bins and harmonics
+  std::unique_ptr<TTreeReaderArray<short>> x_fixed_; ///< fixed-point x-components of all bins and harmonics
+  std::unique_ptr<TTreeReaderArray<short>> y_fixed_; ///< fixed-point y-components of all bins and harmonics
+  TTreeReaderArray<int> n_; ///< number of contributors of all bins
+  TTreeReaderArray<float> sumw_; ///< sum of weights of all bins
+  std::unique_ptr<TTreeReaderArray<unsigned char>> quality_; ///< quality bitmask of all bins
+  std::unique_ptr<TTreeReaderArray<unsigned char>> quality_bits_; ///< packed quality bitmasks of all bins
+  std::vector<float> x_decoded_; ///< decoded fixed-point x-components of the current event
+  std::vector<float> y_decoded_; ///< decoded fixed-point y-components of the current event
+  std::vector<unsigned char> quality_decoded_; ///< unpacked quality bitmasks of the current event
+  const float *x_data_ = nullptr; ///< x-components of the current event
+  const float *y_data_ = nullptr; ///< y-components of the current event
+  const unsigned char *quality_data_ = nullptr; ///< quality bitmasks of the current event
+  Long64_t decoded_entry_ = -1; ///< entry of the decoded arrays
+  DataContainerQVector q_vectors_; ///< layout and restored Q-vectors of the current event
+  std::bitset<QVector::kmaxharmonics> harmonics_; ///< harmonics of the layout
+  std::size_t n_harmonics_ = 0; ///< number of harmonics of the layout
+};
+
+/**
+ * Defines a column of the type DataContainerQVector restoring the Q-vectors written in the flat layout, such that
+ * they are used as input of the correlations. The flat arrays are read as RVecs referring to the read buffers.
+ * The Q-vectors are restored into a container of each slot, which is allocated once.
+ * @tparam DataFrame type of the RDataFrame
+ * Q-vectors with a compact encoding are decoded into buffers of each slot.
+ * @param df RDataFrame of the tree or the RNTuple
+ * @param layout layout of the Q-vectors as read by ReadOutputLayout
+ * @param name name of the Q-vectors, i.e. "<detector>_<STEP>". Used as name of the column.
+ * @param encoding encoding of the components as read by ReadOutputEncoding
+ * @return RDataFrame with the defined column
+ */
+template<typename DataFrame>
+auto DefineFlatQVectors(DataFrame df, const DataContainerQVector &layout, const std::string &name,
+                        const FlatQVectors::Encoding &encoding = {}) {
+  const auto n_slots = ROOT::IsImplicitMTEnabled() ? ROOT::GetImplicitMTPoolSize() : 1;
+  auto q_vectors = std::make_shared<std::vector<DataContainerQVector>>(n_slots, layout);
+  if (encoding.IsCompact()) {
+    struct Buffers {
+      std::vector<float> x; ///< decoded x-components
+      std::vector<float> y; ///< decoded y-components
+      std::vector<unsigned char> quality; ///< unpacked quality bitmasks
+    };
+    auto buffers = std::make_shared<std::vector<Buffers>>(n_slots);
+    const bool fixed = encoding.method==FlatQVectors::Encoding::Method::kFixedPoint;
+    const auto step = encoding.GetStep();
+    auto unpack = [q_vectors, buffers](unsigned int slot, const float *x, const float *y,
+                                       const ROOT::RVec<int> &n, const ROOT::RVec<float> &sumw,
+                                       const ROOT::RVec<unsigned char> &quality_bits) -> const DataContainerQVector & {
+      auto &slot_q_vectors = (*q_vectors)[slot];
+      auto &quality = (*buffers)[slot].quality;
+      quality.resize(slot_q_vectors.size());
+      FlatQVectors::UnpackQuality(quality_bits.data(), quality.size(), quality.data());
+      FlatQVectors::Unpack(x, y, n.data(), sumw.data(), quality.data(), slot_q_vectors);
+      return slot_q_vectors;
+    };
+    if (fixed) {
+      return df.DefineSlot(name, [buffers, step, unpack](unsigned int slot,
+                                                         const ROOT::RVec<short> &x,
+                                                         const ROOT::RVec<short> &y,
+                                                         const ROOT::RVec<int> &n,
+                                                         const ROOT::RVec<float> &sumw,
+                                                         const ROOT::RVec<unsigned char> &quality_bits) {
+        auto &slot_buffers = (*buffers)[slot];
+        slot_buffers.x.resize(x.size());
+        slot_buffers.y.resize(y.size());
+        FlatQVectors::Decode(x.data(), x.size(), step, slot_buffers.x.data());
+        FlatQVectors::Decode(y.data(), y.size(), step, slot_buffers.y.data());
+        return unpack(slot, slot_buffers.x.data(), slot_buffers.y.data(), n, sumw, quality_bits);
+      }, {name + "_xfix", name + "_yfix", name + "_n", name + "_sumw", name + "_qualitybits"});
+    }
+    return df.DefineSlot(name, [unpack](unsigned int slot,
+                                        const ROOT::RVec<float> &x,
+                                        const ROOT::RVec<float> &y,
+                                        const ROOT::RVec<int> &n,
+                                        const ROOT::RVec<float> &sumw,
+                                        const ROOT::RVec<unsigned char> &quality_bits) {
+      return unpack(slot, x.data(), y.data(), n, sumw, quality_bits);
+    }, {name + "_x", name + "_y", name + "_n", name + "_sumw", name + "_qualitybits"});
+  }
+  return df.DefineSlot(name, [q_vectors](unsigned int slot,
+                                         const ROOT::RVec<float> &x,
+                                         const ROOT::RVec<float> &y,
+                                         const ROOT::RVec<int> &n,
+                                         const ROOT::RVec<float> &sumw,
+                                         const ROOT::RVec<unsigned char> &quality) {
+    auto &slot_q_vectors = (*q_vectors)[slot];
+    FlatQVectors::Unpack(x.data(), y.data(), n.data(), sumw.data(), quality.data(), slot_q_vectors);
+    return slot_q_vectors;
+  }, {name + "_x", name + "_y", name + "_n", name + "_sumw", name + "_quality"});
+}
+
+/**
+ * Defines a column of the type DataContainerQVector restoring the Q-vectors written in the flat layout to a tree.
+ * @tparam DataFrame type of the RDataFrame
+ * @param df RDataFrame of the tree
+ * @param tree the tree
+ * @param name name of the Q-vectors, i.e. "<detector>_<STEP>". Used as name of the column.
+ * @return RDataFrame with the defined column
+ */
+template<typename DataFrame>
+auto DefineFlatQVectors(DataFrame df, TTree *tree, const std::string &name) {
+  tree->LoadTree(0);
+  const auto layouts = tree->GetTree()->GetUserInfo();
+  return DefineFlatQVectors(df, ReadOutputLayout<DataContainerQVector>(layouts, name), name,
+                            FlatQVectors::Encoding::FromString(ReadOutputEncoding(layouts, name)));
+}
+
+#ifdef FLOW_USE_RNTUPLE
+/**
+ * Opens a RNTuple written by the correction manager as RDataFrame. The Q-vectors are defined as columns with
+ * DefineFlatQVectors from their layouts and encodings read by ReadOutputLayout and ReadOutputEncoding from the file. The correlations are booked
+ * with these layouts instead of a TTreeReader.
+ * @param ntuple_name name of the RNTuple
+ * @param file_name name of the file
+ * @return RDataFrame reading the RNTuple
+ */
+inline ROOT::RDataFrame MakeNTupleDataFrame(const std::string &ntuple_name, const std::string &file_name) {
+  return ROOT::RDF::Experimental::FromRNTuple(ntuple_name, file_name);
+}
+#endif
+
+}
+}
+#endif //FLOW_CORRELATION_INCLUDE_FLATQVECTORREADER_H_
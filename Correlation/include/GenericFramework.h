@@ -0,0 +1,201 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_CORRELATION_INCLUDE_GENERICFRAMEWORK_H_
+#define FLOW_CORRELATION_INCLUDE_GENERICFRAMEWORK_H_
+
+#include <array>
+#include <complex>
+#include <initializer_list>
+#include <stdexcept>
+
+#include "QVectorGF.h"
+#include "CorrelationResult.h"
+#include "DataContainer.h"
+
+namespace Qn {
+namespace Correlation {
+namespace Impl {
+/**
+ * Recursive calculation of the weighted k-particle correlation of the generic framework
+ * (A. Bilandzic et al., Phys. Rev. C 89, 064904 (2014)). The self-correlations are removed exactly. The harmonics
+ * are modified during the recursion and restored afterwards.
+ * @param q Q-vector of the generic framework
+ * @param n number of particles
+ * @param harmonic harmonics of the particles
+ * @param mult power of the weights of the current term
+ * @param skip first particle, which is not combined further
+ * @return k-particle correlation without normalization.
+ */
+inline std::complex<double> Recursion(const QVectorGF &q, int n, int *harmonic, unsigned int mult = 1, int skip = 0) {
+  const int nm1 = n - 1;
+  std::complex<double> c(q.Q(harmonic[nm1], mult));
+  if (nm1==0) return c;
+  c *= Recursion(q, nm1, harmonic);
+  if (nm1==skip) return c;
+  const unsigned int multp1 = mult + 1;
+  const int nm2 = n - 2;
+  int counter1 = 0;
+  int hhold = harmonic[counter1];
+  harmonic[counter1] = harmonic[nm2];
+  harmonic[nm2] = hhold + harmonic[nm1];
+  std::complex<double> c2(Recursion(q, nm1, harmonic, multp1, nm2));
+  int counter2 = n - 3;
+  while (counter2 >= skip) {
+    harmonic[nm2] = harmonic[counter1];
+    harmonic[counter1] = hhold;
+    ++counter1;
+    hhold = harmonic[counter1];
+    harmonic[counter1] = harmonic[nm2];
+    harmonic[nm2] = hhold + harmonic[nm1];
+    c2 += Recursion(q, nm1, harmonic, multp1, counter2);
+    --counter2;
+  }
+  harmonic[nm2] = harmonic[counter1];
+  harmonic[counter1] = hhold;
+  if (mult==1) return c - c2;
+  return c - static_cast<double>(mult)*c2;
+}
+
+/**
+ * Checks that the correlations of a cumulant have the same binning and number of resamples in all bins.
+ * @param correlations event averaged correlations
+ */
+inline void CheckCumulantInputs(std::initializer_list<const DataContainerStats *> correlations) {
+  const auto &first = **correlations.begin();
+  for (const auto correlation : correlations) {
+    if (correlation->size()!=first.size()) {
+      throw std::logic_error("The correlations of the cumulant have a different binning.");
+    }
+    for (std::size_t ibin = 0; ibin < first.size(); ++ibin) {
+      if ((*correlation)[ibin].GetNSamples()!=first[ibin].GetNSamples()) {
+        throw std::logic_error("The correlations of the cumulant have a different number of resamples.");
+      }
+    }
+  }
+}
+}
+
+/**
+ * Calculates the weighted k-particle correlation of the given harmonics of one event with the generic framework.
+ * The event weight is the number of weighted combinations of k distinct particles.
+ * The QVectorGF needs to hold the harmonics up to the sum of the absolute harmonics and the powers up to k.
+ * @tparam K number of particles
+ * @param q Q-vector of the generic framework
+ * @param harmonics harmonics of the particles
+ * @return correlation result. It is only valid if at least K particles contribute.
+ */
+template<std::size_t K>
+CorrelationResult MultiParticleCorrelation(const QVectorGF &q, std::array<int, K> harmonics) {
+  std::array<int, K> zeros{};
+  const auto numerator = Impl::Recursion(q, K, harmonics.data());
+  const auto denominator = Impl::Recursion(q, K, zeros.data()).real();
+  const bool valid = q.n() >= K && denominator > 0.;
+  return {valid ? numerator.real()/denominator : 0., valid, denominator};
+}
+
+/**
+ * Two-particle correlation <2> of the harmonic n
+ * @param q Q-vector of the generic framework
+ * @param n harmonic
+ * @return correlation result
+ */
+inline CorrelationResult TwoParticleCorrelation(const QVectorGF &q, int n) {
+  return MultiParticleCorrelation<2>(q, {{n, -n}});
+}
+
+/**
+ * Four-particle correlation <4> of the harmonic n
+ * @param q Q-vector of the generic framework
+ * @param n harmonic
+ * @return correlation result
+ */
+inline CorrelationResult FourParticleCorrelation(const QVectorGF &q, int n) {
+  return MultiParticleCorrelation<4>(q, {{n, n, -n, -n}});
+}
+
+/**
+ * Six-particle correlation <6> of the harmonic n
+ * @param q Q-vector of the generic framework
+ * @param n harmonic
+ * @return correlation result
+ */
+inline CorrelationResult SixParticleCorrelation(const QVectorGF &q, int n) {
+  return MultiParticleCorrelation<6>(q, {{n, n, n, -n, -n, -n}});
+}
+
+/**
+ * Eight-particle correlation <8> of the harmonic n
+ * @param q Q-vector of the generic framework
+ * @param n harmonic
+ * @return correlation result
+ */
+inline CorrelationResult EightParticleCorrelation(const QVectorGF &q, int n) {
+  return MultiParticleCorrelation<8>(q, {{n, n, n, n, -n, -n, -n, -n}});
+}
+
+// The cumulants are combined from the event averaged correlations resample by resample, such that the bootstrap
+// uncertainty (Stats::CORRELATEDERRORS, the default) accounts for the correlation between the correlations of
+// different orders. This requires, that all correlations are filled in the same events with the same multiplicities
+// of the resamples, e.g. by correlations of the same detector booked with the same sampler. The statistical
+// uncertainty of Stats::MeanErrorStat is propagated as if the correlations were independent, which they are not,
+// and is not a valid uncertainty of the cumulants.
+
+/**
+ * Four-particle cumulant c{4} = <<4>> - 2 <<2>>^2 of the event averaged correlations.
+ * @param c2 two-particle correlation
+ * @param c4 four-particle correlation
+ * @return cumulant
+ */
+inline DataContainerStats FourParticleCumulant(const DataContainerStats &c2, const DataContainerStats &c4) {
+  Impl::CheckCumulantInputs({&c2, &c4});
+  return Lazy(c4) - Lazy(c2)*c2*2.;
+}
+
+/**
+ * Six-particle cumulant c{6} = <<6>> - 9 <<4>><<2>> + 12 <<2>>^3 of the event averaged correlations.
+ * @param c2 two-particle correlation
+ * @param c4 four-particle correlation
+ * @param c6 six-particle correlation
+ * @return cumulant
+ */
+inline DataContainerStats SixParticleCumulant(const DataContainerStats &c2,
+                                              const DataContainerStats &c4,
+                                              const DataContainerStats &c6) {
+  Impl::CheckCumulantInputs({&c2, &c4, &c6});
+  return Lazy(c6) - Lazy(c4)*c2*9. + Lazy(c2)*c2*c2*12.;
+}
+
+/**
+ * Eight-particle cumulant c{8} = <<8>> - 16 <<6>><<2>> - 18 <<4>>^2 + 144 <<4>><<2>>^2 - 144 <<2>>^4
+ * of the event averaged correlations.
+ * @param c2 two-particle correlation
+ * @param c4 four-particle correlation
+ * @param c6 six-particle correlation
+ * @param c8 eight-particle correlation
+ * @return cumulant
+ */
+inline DataContainerStats EightParticleCumulant(const DataContainerStats &c2,
+                                                const DataContainerStats &c4,
+                                                const DataContainerStats &c6,
+                                                const DataContainerStats &c8) {
+  Impl::CheckCumulantInputs({&c2, &c4, &c6, &c8});
+  return Lazy(c8) - Lazy(c6)*c2*16. - Lazy(c4)*c4*18. + Lazy(c4)*c2*c2*144. - Lazy(c2)*c2*c2*c2*144.;
+}
+
+}
+}
+#endif //FLOW_CORRELATION_INCLUDE_GENERICFRAMEWORK_H_
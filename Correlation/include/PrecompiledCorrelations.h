@@ -0,0 +1,174 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_CORRELATION_INCLUDE_PRECOMPILEDCORRELATIONS_H_
+#define FLOW_CORRELATION_INCLUDE_PRECOMPILEDCORRELATIONS_H_
+
+#include <functional>
+#include <string>
+#include <utility>
+
+#include "ROOT/RDataFrame.hxx"
+#include "TTreeReader.h"
+
+#include "Axis.h"
+#include "QVector.h"
+#include "DataContainer.h"
+#include "AxesConfiguration.h"
+#include "CorrelationHelper.h"
+#include "CorrelationBooking.h"
+
+namespace Qn {
+namespace Correlation {
+/**
+ * Maximum number of inputs and of event axes of the precompiled correlations.
+ */
+constexpr std::size_t kMaxPrecompiledInputs = 4;
+constexpr std::size_t kMaxPrecompiledAxes = 3;
+
+namespace Impl {
+template<typename Indices>
+struct QVectorFunctionOf;
+
+template<std::size_t... I>
+struct QVectorFunctionOf<std::index_sequence<I...>> {
+  template<std::size_t>
+  using Argument = const Qn::QVector &;
+  using type = std::function<double(Argument<I>...)>;
+};
+
+template<typename Indices>
+struct PrecompiledAxesOf;
+
+template<std::size_t... I>
+struct PrecompiledAxesOf<std::index_sequence<I...>> {
+  template<std::size_t>
+  using Axis = Qn::AxisD;
+  using type = AxesConfiguration<Axis<I>...>;
+};
+}
+
+/**
+ * Type-erased correlation function of N Q-vectors returning the value of the correlation, e.g.
+ * Qn::Correlation::QVectorFunction<2> v2 = [](const Qn::QVector &u, const Qn::QVector &q) {
+ *   return Qn::ScalarProduct(u, q, 2);
+ * };
+ * The correlations of these functions with up to kMaxPrecompiledInputs inputs and up to kMaxPrecompiledAxes event
+ * axes are compiled into the library, such that booking them from a macro does not compile the templates of the
+ * CorrelationHelper and of the action booked in the RDataFrame.
+ */
+template<std::size_t N>
+using QVectorFunction = typename Impl::QVectorFunctionOf<std::make_index_sequence<N>>::type;
+
+/**
+ * Configuration of N event axes of a precompiled correlation.
+ */
+template<std::size_t N>
+using PrecompiledAxes = typename Impl::PrecompiledAxesOf<std::make_index_sequence<N>>::type;
+
+/**
+ * Correlation of a type-erased function of N Q-vectors.
+ */
+template<std::size_t NInputs>
+using PrecompiledCorrelation = Correlation<QVectorFunction<NInputs>,
+                                           TemplateHelpers::TupleOf<NInputs, Qn::QVector>,
+                                           TemplateHelpers::TupleOf<NInputs, Qn::DataContainerQVector>>;
+
+/**
+ * Configured helper of a precompiled correlation, as it is booked.
+ */
+template<std::size_t NInputs, std::size_t NAxes>
+using PrecompiledCorrelationHelper = CorrelationHelper<ConfigurationState::Weight,
+                                                       PrecompiledAxes<NAxes>,
+                                                       PrecompiledCorrelation<NInputs>,
+                                                       TemplateHelpers::TupleOf<NAxes, double>,
+                                                       TemplateHelpers::TupleOf<NInputs, Qn::DataContainerQVector>>;
+
+/**
+ * Books a correlation of a type-erased function with the configuration of a booking. The number of event axes of
+ * the booking needs to be between 1 and kMaxPrecompiledAxes and the number of its inputs needs to match the function.
+ * Compiled into the library, such that macros booking correlations skip the compilation of the templates.
+ * @param df data frame with the column "Samples" defined by the ReSampler or SubSampler
+ * @param reader reader of the input tree defining the binning of the inputs
+ * @param booking description of the correlation
+ * @param function the correlation function
+ * @return result pointer of the correlation
+ */
+ROOT::RDF::RResultPtr<Qn::DataContainerStats> BookPrecompiled(ROOT::RDF::RNode df,
+                                                              TTreeReader &reader,
+                                                              const CorrelationBooking &booking,
+                                                              QVectorFunction<1> function);
+ROOT::RDF::RResultPtr<Qn::DataContainerStats> BookPrecompiled(ROOT::RDF::RNode df,
+                                                              TTreeReader &reader,
+                                                              const CorrelationBooking &booking,
+                                                              QVectorFunction<2> function);
+ROOT::RDF::RResultPtr<Qn::DataContainerStats> BookPrecompiled(ROOT::RDF::RNode df,
+                                                              TTreeReader &reader,
+                                                              const CorrelationBooking &booking,
+                                                              QVectorFunction<3> function);
+ROOT::RDF::RResultPtr<Qn::DataContainerStats> BookPrecompiled(ROOT::RDF::RNode df,
+                                                              TTreeReader &reader,
+                                                              const CorrelationBooking &booking,
+                                                              QVectorFunction<4> function);
+
+/**
+ * Registers a type-erased function in the CorrelationRegistry. The bookings with any number of event axes up to
+ * kMaxPrecompiledAxes are booked with BookPrecompiled.
+ * @param key key of the function
+ * @param function the correlation function
+ */
+void RegisterPrecompiled(const std::string &key, QVectorFunction<1> function);
+void RegisterPrecompiled(const std::string &key, QVectorFunction<2> function);
+void RegisterPrecompiled(const std::string &key, QVectorFunction<3> function);
+void RegisterPrecompiled(const std::string &key, QVectorFunction<4> function);
+
+/**
+ * Explicit instantiations of the precompiled correlations, which are defined in the library.
+ */
+#define FLOW_PRECOMPILED_CORRELATION(PREFIX, INPUTS, AXES) \
+  PREFIX template class CorrelationHelper<ConfigurationState::Weight, \
+                                          PrecompiledAxes<AXES>, \
+                                          PrecompiledCorrelation<INPUTS>, \
+                                          TemplateHelpers::TupleOf<AXES, double>, \
+                                          TemplateHelpers::TupleOf<INPUTS, Qn::DataContainerQVector>>;
+
+#define FLOW_PRECOMPILED_CORRELATIONS(PREFIX) \
+  PREFIX template class Correlation<QVectorFunction<1>, TemplateHelpers::TupleOf<1, Qn::QVector>, \
+                                    TemplateHelpers::TupleOf<1, Qn::DataContainerQVector>>; \
+  PREFIX template class Correlation<QVectorFunction<2>, TemplateHelpers::TupleOf<2, Qn::QVector>, \
+                                    TemplateHelpers::TupleOf<2, Qn::DataContainerQVector>>; \
+  PREFIX template class Correlation<QVectorFunction<3>, TemplateHelpers::TupleOf<3, Qn::QVector>, \
+                                    TemplateHelpers::TupleOf<3, Qn::DataContainerQVector>>; \
+  PREFIX template class Correlation<QVectorFunction<4>, TemplateHelpers::TupleOf<4, Qn::QVector>, \
+                                    TemplateHelpers::TupleOf<4, Qn::DataContainerQVector>>; \
+  FLOW_PRECOMPILED_CORRELATION(PREFIX, 1, 1) \
+  FLOW_PRECOMPILED_CORRELATION(PREFIX, 1, 2) \
+  FLOW_PRECOMPILED_CORRELATION(PREFIX, 1, 3) \
+  FLOW_PRECOMPILED_CORRELATION(PREFIX, 2, 1) \
+  FLOW_PRECOMPILED_CORRELATION(PREFIX, 2, 2) \
+  FLOW_PRECOMPILED_CORRELATION(PREFIX, 2, 3) \
+  FLOW_PRECOMPILED_CORRELATION(PREFIX, 3, 1) \
+  FLOW_PRECOMPILED_CORRELATION(PREFIX, 3, 2) \
+  FLOW_PRECOMPILED_CORRELATION(PREFIX, 3, 3) \
+  FLOW_PRECOMPILED_CORRELATION(PREFIX, 4, 1) \
+  FLOW_PRECOMPILED_CORRELATION(PREFIX, 4, 2) \
+  FLOW_PRECOMPILED_CORRELATION(PREFIX, 4, 3)
+
+FLOW_PRECOMPILED_CORRELATIONS(extern)
+
+}
+}
+#endif //FLOW_CORRELATION_INCLUDE_PRECOMPILEDCORRELATIONS_H_
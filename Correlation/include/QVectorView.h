@@ -0,0 +1,142 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_CORRELATION_INCLUDE_QVECTORVIEW_H_
+#define FLOW_CORRELATION_INCLUDE_QVECTORVIEW_H_
+
+#include <bitset>
+#include <string>
+#include <type_traits>
+
+#include "QVector.h"
+
+namespace Qn {
+namespace Correlation {
+
+/**
+ * @class QVectorView
+ * @brief Read-only view of a Q-vector with a set of harmonics known at compile time.
+ * The storage positions of the harmonics are resolved at compile time, such that the access to the components
+ * does not need to test the harmonic bitset and has no exception path. It is used as the argument of correlation
+ * functions. The compatibility of the harmonics of the input Q-vectors with the view is checked once during the
+ * initialization of the correlation.
+ * @tparam Harmonics activated harmonics of the viewed Q-vector in increasing order.
+ */
+template<unsigned int... Harmonics>
+class QVectorView {
+ public:
+  static_assert(sizeof...(Harmonics) > 0, "QVectorView needs at least one harmonic.");
+  static_assert(((Harmonics > 0 && Harmonics <= QVector::kmaxharmonics) && ...), "Harmonic out of range.");
+
+  /**
+   * Bitset of the harmonics of the view.
+   */
+  static constexpr unsigned long kBits = ((1UL << (Harmonics - 1)) | ...);
+
+  /**
+   * Constructor. Implicit to allow passing Q-vectors to correlation functions taking views.
+   * @param q viewed Q-vector. Needs to have exactly the harmonics of the view.
+   */
+  QVectorView(const QVector &q) : q_(&q) {}
+
+  /**
+   * Checks if a Q-vector can be viewed with this view.
+   * @param q Q-vector
+   * @return true if the activated harmonics of the Q-vector are identical to the harmonics of the view.
+   */
+  static bool IsCompatible(const QVector &q) { return q.GetHarmonics()==std::bitset<QVector::kmaxharmonics>(kBits); }
+
+  /**
+   * Returns x-component of Q-vector of the harmonic h.
+   * @tparam h harmonic
+   * @return x-component
+   */
+  template<unsigned int h>
+  float x() const { return q_->GetComponent(Position<h>()).x; }
+
+  /**
+   * Returns y-component of Q-vector of the harmonic h.
+   * @tparam h harmonic
+   * @return y-component
+   */
+  template<unsigned int h>
+  float y() const { return q_->GetComponent(Position<h>()).y; }
+
+  /**
+   * Returns the sum of weights of the Q-Vector.
+   * @return Sum of weights of the Q-Vector.
+   */
+  float sumweights() const { return q_->sumweights(); }
+
+  /**
+   * Returns the number of contributors of the Q-Vector.
+   * @return number of contributors of the Q-Vector.
+   */
+  float n() const { return q_->n(); }
+
+  /**
+   * Returns the viewed Q-vector.
+   * @return viewed Q-vector
+   */
+  const QVector &Get() const { return *q_; }
+
+ private:
+  /**
+   * Storage position of harmonic h. Counts the harmonics of the view below h.
+   * @tparam h harmonic
+   * @return storage position
+   */
+  template<unsigned int h>
+  static constexpr std::size_t Position() {
+    static_assert(((h==Harmonics) || ...), "Harmonic is not part of the QVectorView.");
+    return ((Harmonics < h ? 1 : 0) + ...);
+  }
+
+  const QVector *q_ = nullptr; ///< viewed Q-vector
+};
+
+/**
+ * Scalar product of the harmonic h of two Q-vector views.
+ * @tparam h harmonic
+ * @param a first Q-vector view
+ * @param b second Q-vector view
+ * @return scalar product
+ */
+template<unsigned int h, unsigned int... HarmonicsA, unsigned int... HarmonicsB>
+inline double ScalarProduct(QVectorView<HarmonicsA...> a, QVectorView<HarmonicsB...> b) {
+  return a.template x<h>()*b.template x<h>() + a.template y<h>()*b.template y<h>();
+}
+
+namespace Impl {
+/**
+ * Checks the compatibility of a Q-vector with the argument type of a correlation function.
+ * Q-vectors are always compatible with themselves.
+ * @tparam T argument type of the correlation function
+ */
+template<typename T>
+struct QVectorArgument {
+  static bool IsCompatible(const QVector &) { return true; }
+};
+
+template<unsigned int... Harmonics>
+struct QVectorArgument<QVectorView<Harmonics...>> {
+  static bool IsCompatible(const QVector &q) { return QVectorView<Harmonics...>::IsCompatible(q); }
+};
+}
+
+}
+}
+#endif //FLOW_CORRELATION_INCLUDE_QVECTORVIEW_H_
@@ -17,38 +17,188 @@
 #ifndef FLOW_DATAFRAMECORRELATION_INCLUDE_DATAFRAMERESAMPLER_H_
 #define FLOW_DATAFRAMECORRELATION_INCLUDE_DATAFRAMERESAMPLER_H_
 
-#include <random>
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <vector>
 #include <algorithm>
 #include "RtypesCore.h"
 #include "ROOT/RVec.hxx"
+#include "TROOT.h"
 
 namespace Qn {
 namespace Correlation {
+/**
+ * Multiplicities of an event in the bootstrap samples. The Poisson(1) multiplicities drawn by the ReSampler are
+ * at most 16.
+ */
+using SampleMultiplicities = ROOT::RVec<UChar_t>;
 
+namespace Impl {
+/**
+ * Counter-based Philox4x32-10 generator (J. K. Salmon et al., "Parallel random numbers: as easy as 1, 2, 3", SC11).
+ * Returns four independent 32 bit random numbers for a given counter and key.
+ * @param counter counter
+ * @param key key
+ * @return random numbers
+ */
+inline std::array<std::uint32_t, 4> Philox4x32(std::array<std::uint32_t, 4> counter,
+                                               std::array<std::uint32_t, 2> key) {
+  constexpr std::uint64_t kMultiplier0 = 0xD2511F53;
+  constexpr std::uint64_t kMultiplier1 = 0xCD9E8D57;
+  constexpr std::uint32_t kWeyl0 = 0x9E3779B9;
+  constexpr std::uint32_t kWeyl1 = 0xBB67AE85;
+  for (int round = 0; round < 10; ++round) {
+    const std::uint64_t product0 = kMultiplier0*counter[0];
+    const std::uint64_t product1 = kMultiplier1*counter[2];
+    counter = {static_cast<std::uint32_t>(product1 >> 32u) ^ counter[1] ^ key[0],
+               static_cast<std::uint32_t>(product1),
+               static_cast<std::uint32_t>(product0 >> 32u) ^ counter[3] ^ key[1],
+               static_cast<std::uint32_t>(product0)};
+    key[0] += kWeyl0;
+    key[1] += kWeyl1;
+  }
+  return counter;
+}
+
+/**
+ * Inverse cumulative distribution function of the Poisson distribution with mean 1 in units of 2^-32.
+ * The multiplicity of a uniform 32 bit random number u is the number of entries smaller or equal than u.
+ */
+class PoissonTable {
+ public:
+  static constexpr std::size_t kSize = 16;
+  static const std::array<std::uint32_t, kSize> &Get() {
+    static const std::array<std::uint32_t, kSize> table = Make();
+    return table;
+  }
+ private:
+  static std::array<std::uint32_t, kSize> Make() {
+    std::array<std::uint32_t, kSize> table{};
+    double probability = std::exp(-1.);
+    double cumulative = 0.;
+    for (std::size_t k = 0; k < kSize; ++k) {
+      cumulative += probability;
+      probability /= static_cast<double>(k + 1);
+      table[k] = static_cast<std::uint32_t>(std::min(cumulative*4294967296., 4294967295.));
+    }
+    return table;
+  }
+};
+}
+
+/**
+ * @class ReSampler
+ * @brief Generates the multiplicities of an event in the bootstrap samples.
+ * The multiplicities are drawn from a Poisson distribution with mean 1. A counter-based generator keyed by the
+ * seed, the entry number of the event and the index of the sample is used. The multiplicities are
+ * therefore independent of the number of threads and the order of processing and are reproducible by using the
+ * same seed. The multiplicities only depend on the entry, such that all slots can use the generator concurrently.
+ * Use it with DefineSlot to obtain the multiplicities as a view of a buffer of the slot, which is reused for every
+ * event instead of allocating a new vector.
+ */
 class ReSampler {
  public:
   ReSampler() = default;
-  ReSampler(std::size_t n) :
+  explicit ReSampler(std::size_t n, ULong64_t seed = 0) :
       n_(n),
-      poisson_(1) {
-    std::random_device rd;
-    generator_ = std::mt19937{rd()};
+      seed_(seed) {
+    const auto n_slots = ROOT::IsImplicitMTEnabled() ? ROOT::GetImplicitMTPoolSize() : 1;
+    buffers_.resize(n_slots);
   }
 
-  ROOT::RVec<ULong64_t> operator()() {
-    ROOT::RVec<ULong64_t> vec(n_);
-    for (auto &entry : vec) {
-      entry = poisson_(generator_);
-    }
+  /**
+   * Returns the multiplicities of an event in the samples as a view of the buffer of the slot. The view is valid
+   * until the next event of the slot is processed.
+   * @param slot slot processing the event
+   * @param entry entry number of the event. Use the column "rdfentry_" of the RDataFrame.
+   * @return multiplicities
+   */
+  SampleMultiplicities operator()(unsigned int slot, ULong64_t entry) {
+    auto &buffer = buffers_[slot];
+    buffer.resize(n_);
+    Generate(entry, buffer.data());
+    return SampleMultiplicities(buffer.data(), buffer.size());
+  }
+
+  /**
+   * Returns the multiplicities of an event in the samples.
+   * @param entry entry number of the event. Use the column "rdfentry_" of the RDataFrame.
+   * @return multiplicities
+   */
+  SampleMultiplicities operator()(ULong64_t entry) const {
+    SampleMultiplicities vec(n_);
+    Generate(entry, vec.data());
     return vec;
   }
 
+  /**
+   * Writes the multiplicities of an event in the samples.
+   * @tparam T type of the multiplicities
+   * @param entry entry number of the event
+   * @param multiplicities array of length N(), which is filled.
+   */
+  template<typename T>
+  void Generate(ULong64_t entry, T *multiplicities) const {
+    const auto &table = Impl::PoissonTable::Get();
+    const std::array<std::uint32_t, 2> key{static_cast<std::uint32_t>(seed_), static_cast<std::uint32_t>(seed_ >> 32u)};
+    const auto entry_low = static_cast<std::uint32_t>(entry);
+    const auto entry_high = static_cast<std::uint32_t>(entry >> 32u);
+    for (std::size_t first = 0; first < n_; first += 4) {
+      const auto block = static_cast<std::uint64_t>(first/4);
+      const auto random = Impl::Philox4x32({entry_low, entry_high,
+                                            static_cast<std::uint32_t>(block),
+                                            static_cast<std::uint32_t>(block >> 32u)}, key);
+      const auto n_block = std::min<std::size_t>(4, n_ - first);
+      for (std::size_t j = 0; j < n_block; ++j) {
+        unsigned int multiplicity = 0;
+        for (const auto threshold : table) {
+          multiplicity += random[j] >= threshold;
+        }
+        multiplicities[first + j] = static_cast<T>(multiplicity);
+      }
+    }
+  }
+
+  std::size_t N() const { return n_; }
+  ULong64_t Seed() const { return seed_; }
+ private:
+  std::size_t n_{10};
+  ULong64_t seed_{0};
+  std::vector<std::vector<UChar_t>> buffers_; //!<! multiplicities of the current event of each slot
+};
+
+/**
+ * @class SubSampler
+ * @brief Assigns every event to one of n disjoint sub-samples.
+ * The sub-sample is obtained from the counter-based generator keyed by the seed and the entry number of the event,
+ * such that the assignment is reproducible and independent of the number of threads.
+ * Used for the resampling method ReSamples::Method::kSubSamples, which fills a single sample per event.
+ */
+class SubSampler {
+ public:
+  SubSampler() = default;
+  explicit SubSampler(std::size_t n, ULong64_t seed = 0) :
+      n_(n),
+      seed_(seed) {}
+
+  /**
+   * Returns the sub-sample of an event.
+   * @param entry entry number of the event. Use the column "rdfentry_" of the RDataFrame.
+   * @return sub-sample
+   */
+  ULong64_t operator()(ULong64_t entry) const {
+    const auto random = Impl::Philox4x32({static_cast<std::uint32_t>(entry), static_cast<std::uint32_t>(entry >> 32u),
+                                          0xFFFFFFFFu, 0xFFFFFFFFu},
+                                         {static_cast<std::uint32_t>(seed_), static_cast<std::uint32_t>(seed_ >> 32u)});
+    return (static_cast<std::uint64_t>(random[0])*n_) >> 32u;
+  }
+
   std::size_t N() const { return n_; }
+  ULong64_t Seed() const { return seed_; }
  private:
   std::size_t n_{10};
-  std::mt19937 generator_;
-  std::poisson_distribution<> poisson_;
+  ULong64_t seed_{0};
 };
 
 }
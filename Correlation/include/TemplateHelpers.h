@@ -74,6 +74,8 @@ struct FunctionTraits<ReturnType(ClassType::*)(Args...) const> {
   };
   // arity is the number of arguments.
   typedef ReturnType result_type;
+  // tuple of the argument types without references and cv-qualifiers.
+  using DecayedArgumentTuple = std::tuple<std::decay_t<Args>...>;
 
   template<size_t i>
   struct Arg {
@@ -0,0 +1,128 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "ToyMCDataSource.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "ROOT/RDF/Utils.hxx"
+
+namespace Qn {
+
+ToyMCDataSource::ToyMCDataSource(ULong64_t n_events,
+                                 std::shared_ptr<Qn::CorrectionManager> manager,
+                                 std::vector<std::string> q_vectors,
+                                 std::vector<std::pair<std::string, unsigned int>> event_variables,
+                                 EventFunction function,
+                                 ULong64_t seed) :
+    n_events_(n_events),
+    seed_(seed),
+    manager_(std::move(manager)),
+    q_vector_names_(std::move(q_vectors)),
+    event_variables_(std::move(event_variables)),
+    function_(std::move(function)) {
+  column_names_ = q_vector_names_;
+  for (const auto &variable : event_variables_) column_names_.push_back(variable.first);
+}
+
+void ToyMCDataSource::SetNSlots(unsigned int n_slots) {
+  if (manager_->GetNumberOfSlots() < n_slots) {
+    throw std::logic_error("The correction manager needs one slot per thread of the data frame.");
+  }
+  n_slots_ = n_slots;
+  engines_.resize(n_slots);
+  q_vectors_.assign(q_vector_names_.size(), std::vector<const Qn::DataContainerQVector *>(n_slots, nullptr));
+  variables_.assign(event_variables_.size(), std::vector<const double *>(n_slots, nullptr));
+}
+
+std::size_t ToyMCDataSource::FindColumn(std::string_view name) const {
+  const auto column = std::find(column_names_.begin(), column_names_.end(), name);
+  if (column==column_names_.end()) {
+    throw std::runtime_error("The column " + std::string(name) + " is not provided by the ToyMC.");
+  }
+  return std::distance(column_names_.begin(), column);
+}
+
+bool ToyMCDataSource::HasColumn(std::string_view name) const {
+  return std::find(column_names_.begin(), column_names_.end(), name)!=column_names_.end();
+}
+
+std::string ToyMCDataSource::GetTypeName(std::string_view name) const {
+  if (FindColumn(name) < q_vector_names_.size()) {
+    return ROOT::Internal::RDF::TypeID2TypeName(typeid(Qn::DataContainerQVector));
+  }
+  return "double";
+}
+
+std::vector<std::pair<ULong64_t, ULong64_t>> ToyMCDataSource::GetEntryRanges() {
+  // all entries are distributed in one call. The data frame asks for ranges until none are returned.
+  std::vector<std::pair<ULong64_t, ULong64_t>> ranges;
+  if (ranges_created_) return ranges;
+  ranges_created_ = true;
+  for (unsigned int slot = 0; slot < n_slots_; ++slot) {
+    const auto first = n_events_*slot/n_slots_;
+    const auto last = n_events_*(slot + 1)/n_slots_;
+    if (first < last) ranges.emplace_back(first, last);
+  }
+  return ranges;
+}
+
+bool ToyMCDataSource::SetEntry(unsigned int slot, ULong64_t entry) {
+  auto &manager = manager_->GetSlot(slot);
+  auto &engine = engines_[slot];
+  engine.seed(EventSeed(seed_, entry));
+  manager.Reset();
+  const auto passed = function_(slot, manager, engine);
+  manager.ProcessCorrections();
+  return passed;
+}
+
+void ToyMCDataSource::Initialize() {
+  ranges_created_ = false;
+  for (unsigned int slot = 0; slot < n_slots_; ++slot) {
+    auto &manager = manager_->GetSlot(slot);
+    for (std::size_t i = 0; i < q_vector_names_.size(); ++i) {
+      q_vectors_[i][slot] = manager.GetQVector(q_vector_names_[i]);
+      if (!q_vectors_[i][slot]) {
+        throw std::runtime_error("The Q-vector " + q_vector_names_[i] + " is not provided by the correction manager. "
+                                 "Set the current run before the event loop.");
+      }
+    }
+    for (std::size_t i = 0; i < event_variables_.size(); ++i) {
+      variables_[i][slot] = manager.GetVariableContainer() + event_variables_[i].second;
+    }
+  }
+}
+
+ToyMCDataSource::Record_t ToyMCDataSource::GetColumnReadersImpl(std::string_view name, const std::type_info &type) {
+  const auto column = FindColumn(name);
+  Record_t readers;
+  if (column < q_vector_names_.size()) {
+    if (type!=typeid(Qn::DataContainerQVector)) {
+      throw std::runtime_error("The column " + std::string(name) + " needs to be read as Qn::DataContainerQVector.");
+    }
+    for (auto &q_vector : q_vectors_[column]) readers.push_back(&q_vector);
+  } else {
+    if (type!=typeid(double)) {
+      throw std::runtime_error("The column " + std::string(name) + " needs to be read as double.");
+    }
+    for (auto &variable : variables_[column - q_vector_names_.size()]) readers.push_back(&variable);
+  }
+  return readers;
+}
+
+}
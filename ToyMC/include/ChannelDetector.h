@@ -20,6 +20,7 @@
 #include <utility>
 #include <functional>
 #include <algorithm>
+#include <vector>
 
 #include "Axis.h"
 
@@ -52,6 +53,24 @@ class ChannelDetector {
     multiplicity_true_[bin] = multiplicity_true_[bin] + 1;
   }
 
+  /**
+   * Adds all particles of an event to the multiplicities of the channels. The channels of all particles are found
+   * in one pass, such that the uniform binning is used without a search. Particles outside of the acceptance are
+   * skipped.
+   * @param phis angles of the particles
+   * @param n number of particles
+   */
+  void DetectBatch(const double *phis, std::size_t n) {
+    bins_.assign(n, 0);
+    axis_.AccumulateBins(phis, n, 1, bins_.data());
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto bin = bins_[i];
+      if (bin < 0) continue;
+      if (!cuts_ || cuts_(phis[i])) multiplicity_rec_[bin] += 1;
+      multiplicity_true_[bin] += 1;
+    }
+  }
+
   void FillDataRec(double *values_array, std::size_t position_phi, std::size_t position_weights) {
     for (std::size_t i = 0; i < n_channels_; ++i) {
       values_array[position_phi + i] = phi_.at(i);
@@ -98,6 +117,7 @@ class ChannelDetector {
   std::vector<double> multiplicity_true_;
   std::vector<double> efficiencies_;
   std::function<bool(double)> cuts_;
+  std::vector<long> bins_; ///< channels of the particles of the current batch
 };
 
 #endif //FLOW_TOYMC_INCLUDE_CHANNELDETECTOR_H_
@@ -17,23 +17,63 @@
 #ifndef FLOW_TOYMC_INCLUDE_PARTICLEGENERATOR_H_
 #define FLOW_TOYMC_INCLUDE_PARTICLEGENERATOR_H_
 
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <cstdint>
 #include <random>
+#include <vector>
 
+/**
+ * @class ParticleGenerator
+ * @brief Generates azimuthal angles of particles according to the Fourier harmonics of a flow distribution.
+ * The distribution is approximated by a piecewise linear function on nphi_slices slices. The slice is drawn from
+ * an alias table and the angle within the slice by inverting the linear cumulative distribution, such that the
+ * cost of an angle does not depend on the number of slices.
+ */
 template<typename RandomEngine, std::size_t n_harmonics_, std::size_t nphi_slices = 100>
 class ParticleGenerator {
   static constexpr double kPi = M_PI;
+  static constexpr double kSliceWidth = 2*kPi/nphi_slices;
  public:
   ParticleGenerator(std::array<double, n_harmonics_> harmonics) :
-      vns_(harmonics),
-      phi_dist_(nphi_slices, 0, 2*kPi, [&](const double x) { return PhiPdf(x); }) {}
+      vns_(harmonics) {
+    for (std::size_t i = 0; i <= nphi_slices; ++i) {
+      pdf_[i] = std::max(0., PhiPdf(i*kSliceWidth));
+    }
+    BuildAliasTable();
+  }
+
   double GetPhi(RandomEngine &engine, double psi) {
-    return phi_dist_(engine) + psi;
+    const auto u = uniform_(engine)*nphi_slices;
+    auto slice = std::min(static_cast<std::size_t>(u), nphi_slices - 1);
+    if (u - slice >= probabilities_[slice]) slice = aliases_[slice];
+    const auto f0 = pdf_[slice];
+    const auto f1 = pdf_[slice + 1];
+    const auto v = uniform_(engine);
+    // inverse of the cumulative distribution of the linear density between f0 and f1 in the slice.
+    const auto denominator = f0 + std::sqrt(f0*f0 + (f1*f1 - f0*f0)*v);
+    const auto t = denominator > 0. ? v*(f0 + f1)/denominator : v;
+    return (slice + t)*kSliceWidth + psi;
   }
+
+  /**
+   * Generates the angles of a number of particles with the same symmetry plane.
+   * @param engine random engine
+   * @param psi angle of the symmetry plane
+   * @param phis array of length n, which is filled.
+   * @param n number of particles
+   */
+  void GeneratePhis(RandomEngine &engine, double psi, double *phis, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) phis[i] = GetPhi(engine, psi);
+  }
+
  private:
   std::array<double, n_harmonics_> vns_;
-  std::piecewise_linear_distribution<> phi_dist_;
+  std::vector<double> pdf_ = std::vector<double>(nphi_slices + 1); ///< density at the edges of the slices
+  std::vector<double> probabilities_ = std::vector<double>(nphi_slices); ///< probability to keep a slice
+  std::vector<std::uint32_t> aliases_ = std::vector<std::uint32_t>(nphi_slices); ///< alias of a slice
+  std::uniform_real_distribution<double> uniform_{0., 1.};
 
   double PhiPdf(double phi) {
     double value = 1.;
@@ -43,6 +83,38 @@ class ParticleGenerator {
     return value;
   }
 
+  /**
+   * Builds the alias table of the slices weighted with their integral with the method of Vose.
+   */
+  void BuildAliasTable() {
+    std::vector<double> weights(nphi_slices);
+    double sum = 0.;
+    for (std::size_t i = 0; i < nphi_slices; ++i) {
+      weights[i] = pdf_[i] + pdf_[i + 1];
+      sum += weights[i];
+    }
+    std::vector<std::uint32_t> small, large;
+    for (std::size_t i = 0; i < nphi_slices; ++i) {
+      weights[i] *= nphi_slices/sum;
+      aliases_[i] = i;
+      (weights[i] < 1. ? small : large).push_back(i);
+    }
+    while (!small.empty() && !large.empty()) {
+      const auto less = small.back();
+      small.pop_back();
+      const auto more = large.back();
+      probabilities_[less] = weights[less];
+      aliases_[less] = more;
+      weights[more] -= 1. - weights[less];
+      if (weights[more] < 1.) {
+        large.pop_back();
+        small.push_back(more);
+      }
+    }
+    for (const auto i : small) probabilities_[i] = 1.;
+    for (const auto i : large) probabilities_[i] = 1.;
+  }
+
 };
 
 #endif //FLOW_TOYMC_INCLUDE_PARTICLEGENERATOR_H_
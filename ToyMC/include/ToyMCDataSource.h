@@ -0,0 +1,134 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#ifndef FLOW_TOYMC_INCLUDE_TOYMCDATASOURCE_H_
+#define FLOW_TOYMC_INCLUDE_TOYMCDATASOURCE_H_
+
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ROOT/RDataFrame.hxx"
+#include "ROOT/RDataSource.hxx"
+#include "ROOT/RStringView.hxx"
+
+#include "CorrectionManager.h"
+
+namespace Qn {
+/**
+ * @class ToyMCDataSource
+ * @brief RDataFrame data source generating the events of the ToyMC in the event loop, such that the correlations
+ * are calculated from generated events without writing and reading the Q-vectors. Each slot of the data frame
+ * generates its events into the correction manager of the slot, which builds the Q-vectors and applies the
+ * configured corrections. The columns refer in place to the Q-vectors and to the event variables of the manager of
+ * the slot.
+ * The random engine is seeded for each event from the seed and the entry number, such that the events do not
+ * depend on the number of threads and the order of processing.
+ *
+ * auto df = Qn::MakeToyMCDataFrame(n_events, manager, {"DetTrk0_PLAIN", "DetPsi_PLAIN"}, {{"Event", kEvent}},
+ *     [&](unsigned int slot, Qn::CorrectionManager &manager, std::mt19937_64 &engine) {...});
+ */
+class ToyMCDataSource final : public ROOT::RDF::RDataSource {
+ public:
+  using RandomEngine = std::mt19937_64;
+  /**
+   * Function generating an event into the correction manager of a slot. It is called with the slot, the manager and
+   * the random engine of the slot. It sets the event variables, calls ProcessEvent and fills the detectors, if the
+   * event passes the event cuts. The state of the detector simulation needs to be kept per slot.
+   * @return the result of ProcessEvent. Events, which do not pass the event cuts, are skipped by the data frame.
+   */
+  using EventFunction = std::function<bool(unsigned int, Qn::CorrectionManager &, RandomEngine &)>;
+
+  /**
+   * Constructor
+   * @param n_events number of generated events
+   * @param manager initialized correction manager with one slot per thread of the data frame. The current run
+   * needs to be set, such that the Q-vectors are available.
+   * @param q_vectors names of the Q-vectors provided as columns, e.g. "<detector>_RECENTERED"
+   * @param event_variables names and positions in the variable container of the event variables provided as columns
+   * @param function function generating an event
+   * @param seed seed of the random engine
+   */
+  ToyMCDataSource(ULong64_t n_events,
+                  std::shared_ptr<Qn::CorrectionManager> manager,
+                  std::vector<std::string> q_vectors,
+                  std::vector<std::pair<std::string, unsigned int>> event_variables,
+                  EventFunction function,
+                  ULong64_t seed = 0);
+
+  void SetNSlots(unsigned int n_slots) override;
+  const std::vector<std::string> &GetColumnNames() const override { return column_names_; }
+  bool HasColumn(std::string_view name) const override;
+  std::string GetTypeName(std::string_view name) const override;
+  std::vector<std::pair<ULong64_t, ULong64_t>> GetEntryRanges() override;
+  bool SetEntry(unsigned int slot, ULong64_t entry) override;
+  void Initialize() override;
+  /**
+   * Finalizes the correction manager, which merges the calibration and QA histograms of the slots.
+   */
+  void Finalize() override { manager_->Finalize(); }
+  std::string GetLabel() override { return "ToyMC"; }
+
+ protected:
+  Record_t GetColumnReadersImpl(std::string_view name, const std::type_info &type) override;
+
+ private:
+  /**
+   * Seed of the random engine of an event. The seed and the entry number are mixed with the finalizer of
+   * SplitMix64, such that neighbouring entries get uncorrelated seeds.
+   */
+  static ULong64_t EventSeed(ULong64_t seed, ULong64_t entry) {
+    auto z = seed + 0x9E3779B97F4A7C15ULL*(entry + 1);
+    z = (z ^ (z >> 30u))*0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27u))*0x94D049BB133111EBULL;
+    return z ^ (z >> 31u);
+  }
+
+  std::size_t FindColumn(std::string_view name) const;
+
+  ULong64_t n_events_; ///< number of generated events
+  ULong64_t seed_; ///< seed of the random engine
+  std::shared_ptr<Qn::CorrectionManager> manager_; ///< correction manager with one slot per thread
+  std::vector<std::string> q_vector_names_; ///< names of the Q-vector columns
+  std::vector<std::pair<std::string, unsigned int>> event_variables_; ///< event variable columns
+  std::vector<std::string> column_names_; ///< names of all columns. The Q-vectors are followed by the variables.
+  EventFunction function_; ///< function generating an event
+  unsigned int n_slots_ = 0; ///< number of slots
+  bool ranges_created_ = false; ///< true if the entry ranges of the event loop are created
+  std::vector<RandomEngine> engines_; ///< random engine of each slot
+  std::vector<std::vector<const Qn::DataContainerQVector *>> q_vectors_; ///< Q-vectors of each column and slot
+  std::vector<std::vector<const double *>> variables_; ///< event variables of each column and slot
+};
+
+/**
+ * Creates a data frame generating the events of the ToyMC. See ToyMCDataSource for the parameters.
+ * @return the data frame
+ */
+inline ROOT::RDataFrame MakeToyMCDataFrame(ULong64_t n_events,
+                                           std::shared_ptr<Qn::CorrectionManager> manager,
+                                           std::vector<std::string> q_vectors,
+                                           std::vector<std::pair<std::string, unsigned int>> event_variables,
+                                           ToyMCDataSource::EventFunction function,
+                                           ULong64_t seed = 0) {
+  return ROOT::RDataFrame(std::make_unique<ToyMCDataSource>(n_events, std::move(manager), std::move(q_vectors),
+                                                            std::move(event_variables), std::move(function), seed));
+}
+}
+
+#endif //FLOW_TOYMC_INCLUDE_TOYMCDATASOURCE_H_
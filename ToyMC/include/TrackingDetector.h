@@ -16,6 +16,14 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef FLOW_TOYMC_INCLUDE_TRACKINGDETECTOR_H_
 #define FLOW_TOYMC_INCLUDE_TRACKINGDETECTOR_H_
+
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "Axis.h"
+
 template<typename RandomEngine>
 class TrackingDetector {
  public:
@@ -45,6 +53,26 @@ class TrackingDetector {
     }
   }
 
+  /**
+   * Simulates the response of the detector to all particles of an event. The efficiency bins of all particles are
+   * found in one pass, such that the uniform binning is used without a search. Particles outside of the acceptance
+   * or rejected by the cuts get a weight of 0. The weights can be passed as a column to
+   * CorrectionManager::FillTracks.
+   * @param engine random engine
+   * @param phis angles of the particles
+   * @param n number of particles
+   * @param weights array of length n, which is filled with the reconstructed weights.
+   */
+  void DetectBatch(RandomEngine &engine, const double *phis, std::size_t n, double *weights) {
+    bins_.assign(n, 0);
+    axis_.AccumulateBins(phis, n, 1, bins_.data());
+    for (std::size_t i = 0; i < n; ++i) {
+      const auto bin = bins_[i];
+      const bool accepted = bin > -1 && (!cuts_ || cuts_(phis[i]));
+      weights[i] = accepted && detection_efficiency_(engine) < efficiencies_[bin] ? 1. : 0.;
+    }
+  }
+
   std::string Name() const {return axis_.Name();}
 
   void FillDataTruth(double *values_array, std::size_t position_phi, std::size_t position_weight) {
@@ -66,6 +94,7 @@ class TrackingDetector {
   double phi_;
   std::vector<double> efficiencies_;
   std::function<bool(double)> cuts_;
+  std::vector<long> bins_; ///< efficiency bins of the particles of the current batch
 };
 
 #endif //FLOW_TOYMC_INCLUDE_TRACKINGDETECTOR_H_
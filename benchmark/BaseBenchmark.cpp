@@ -0,0 +1,134 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <random>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Axis.h"
+#include "DataContainer.h"
+#include "QVector.h"
+#include "Stats.h"
+
+namespace {
+std::bitset<Qn::QVector::kmaxharmonics> FirstHarmonics(const long n) { return {(1ul << n) - 1}; }
+
+std::vector<float> RandomAngles(const long n) {
+  std::mt19937 engine(42);
+  std::uniform_real_distribution<float> distribution(0., 2*Qn::QVector::kPi);
+  std::vector<float> angles(n);
+  for (auto &angle : angles) angle = distribution(engine);
+  return angles;
+}
+
+/**
+ * Adds the particles of an event one by one.
+ * Arguments: multiplicity, number of harmonics
+ */
+void BM_QVectorAdd(benchmark::State &state) {
+  const auto phi = RandomAngles(state.range(0));
+  Qn::QVector q(FirstHarmonics(state.range(1)), Qn::QVector::CorrectionStep::PLAIN);
+  for (auto _ : state) {
+    q.Reset();
+    for (const auto angle : phi) q.Add(angle, 1.);
+    benchmark::DoNotOptimize(q);
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_QVectorAdd)->ArgsProduct({{10, 100, 1000, 10000}, {1, 2, 4, 8}});
+
+/**
+ * Adds the particles of an event in a batch.
+ * Arguments: multiplicity, number of harmonics
+ */
+void BM_QVectorAddBatch(benchmark::State &state) {
+  const auto phi = RandomAngles(state.range(0));
+  const std::vector<float> weights(phi.size(), 1.);
+  Qn::QVector q(FirstHarmonics(state.range(1)), Qn::QVector::CorrectionStep::PLAIN);
+  for (auto _ : state) {
+    q.Reset();
+    q.AddBatch(phi.data(), nullptr, weights.data(), phi.size());
+    benchmark::DoNotOptimize(q);
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_QVectorAddBatch)->ArgsProduct({{10, 100, 1000, 10000}, {1, 2, 4, 8}});
+
+/**
+ * Finds the bins of a set of values.
+ * Arguments: number of bins, uniform (1) or variable (0) bin edges
+ */
+void BM_AxisFindBin(benchmark::State &state) {
+  const auto n_bins = state.range(0);
+  std::vector<double> edges;
+  for (long i = 0; i <= n_bins; ++i) edges.push_back(state.range(1) ? i : i*i);
+  const Qn::AxisD axis("axis", edges);
+  std::mt19937 engine(42);
+  std::uniform_real_distribution<double> distribution(edges.front(), edges.back());
+  std::vector<double> values(1024);
+  for (auto &value : values) value = distribution(engine);
+  for (auto _ : state) {
+    for (const auto value : values) benchmark::DoNotOptimize(axis.FindBin(value));
+  }
+  state.SetItemsProcessed(state.iterations()*values.size());
+}
+BENCHMARK(BM_AxisFindBin)->ArgsProduct({{10, 100, 1000}, {0, 1}});
+
+/**
+ * Fills the result of an event into the bootstrap samples.
+ * Arguments: number of samples
+ */
+void BM_StatsFillPoisson(benchmark::State &state) {
+  const auto n_samples = state.range(0);
+  Qn::Stats stats;
+  stats.SetNumberOfReSamples(n_samples);
+  std::mt19937 engine(42);
+  std::poisson_distribution<int> poisson(1.);
+  std::vector<std::vector<unsigned char>> multiplicities(64, std::vector<unsigned char>(n_samples));
+  for (auto &event : multiplicities) {
+    for (auto &multiplicity : event) multiplicity = poisson(engine);
+  }
+  std::size_t ievent = 0;
+  for (auto _ : state) {
+    stats.FillPoisson(0.1, 1., multiplicities[ievent++%multiplicities.size()]);
+  }
+  benchmark::DoNotOptimize(stats);
+  state.SetItemsProcessed(state.iterations()*n_samples);
+}
+BENCHMARK(BM_StatsFillPoisson)->RangeMultiplier(10)->Range(10, 1000);
+
+/**
+ * Projects a three dimensional container of Stats on one of its axes.
+ * Arguments: number of bins of each axis, number of samples
+ */
+void BM_DataContainerProjection(benchmark::State &state) {
+  const auto n_bins = static_cast<int>(state.range(0));
+  Qn::DataContainerStats container;
+  container.AddAxes({{"centrality", n_bins, 0., 100.}, {"pT", n_bins, 0., 3.}, {"eta", n_bins, -1., 1.}});
+  std::vector<unsigned char> multiplicities(state.range(1), 1);
+  for (auto &bin : container) {
+    bin.SetNumberOfReSamples(state.range(1));
+    bin.FillPoisson(0.1, 1., multiplicities);
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(container.Projection({"centrality"}));
+  }
+  state.SetItemsProcessed(state.iterations()*container.size());
+}
+BENCHMARK(BM_DataContainerProjection)->ArgsProduct({{5, 10, 20}, {10, 100}});
+}
@@ -0,0 +1,58 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+#include "Detector.h"
+#include "InputVariableManager.h"
+#include "SubEventTracks.h"
+
+namespace {
+/**
+ * Builds the plain Q-vector of a track sub event from its data vectors.
+ * Arguments: multiplicity, number of harmonics
+ */
+void BM_SubEventBuildQnVector(benchmark::State &state) {
+  const std::bitset<Qn::QVector::kmaxharmonics> harmonics((1ul << state.range(1)) - 1);
+  Qn::InputVariableManager variables;
+  variables.CreateVariable("phi", 1, 1);
+  variables.Initialize();
+  Qn::Detector detector("tracks", Qn::DetectorType::TRACK, {}, variables.FindVariable("phi"),
+                        variables.FindVariable("Ones"), variables.FindVariable("Ones"), harmonics,
+                        Qn::QVector::Normalization::M);
+  Qn::CorrectionAxisSet event_classes;
+  Qn::SubEventTracks sub_event(0, &event_classes, harmonics);
+  sub_event.SetDetector(&detector);
+  sub_event.CreateSupportQVectors();
+  std::mt19937 engine(42);
+  std::uniform_real_distribution<float> distribution(0., 2*Qn::QVector::kPi);
+  std::vector<float> phi(state.range(0));
+  for (auto &angle : phi) angle = distribution(engine);
+  for (auto _ : state) {
+    state.PauseTiming();
+    sub_event.Clear();
+    for (const auto angle : phi) sub_event.AddDataVector(0, angle, 1., 1.);
+    state.ResumeTiming();
+    sub_event.BuildQnVector();
+    benchmark::DoNotOptimize(sub_event.GetCurrentQnVector());
+  }
+  state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+BENCHMARK(BM_SubEventBuildQnVector)->ArgsProduct({{10, 100, 1000, 10000}, {1, 4, 8}});
+}
@@ -0,0 +1,62 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <random>
+
+#include <benchmark/benchmark.h>
+
+#include "Correlation.h"
+
+namespace {
+/**
+ * Fills the bins of a Q-vector container with the Q-vectors of random events.
+ */
+void FillRandom(Qn::DataContainerQVector &container, const int multiplicity, std::mt19937 &engine) {
+  std::uniform_real_distribution<double> distribution(0., 2*Qn::QVector::kPi);
+  for (auto &q : container) {
+    q = Qn::QVector(std::bitset<Qn::QVector::kmaxharmonics>(0b11), Qn::QVector::CorrectionStep::PLAIN);
+    for (int i = 0; i < multiplicity; ++i) q.Add(distribution(engine), 1.);
+    q.Normalize(Qn::QVector::Normalization::M);
+  }
+}
+
+/**
+ * Correlates the differential Q-vectors of an event with an integrated reference Q-vector.
+ * Arguments: number of bins of the differential Q-vectors, multiplicity of each bin
+ */
+void BM_CorrelationCorrelate(benchmark::State &state) {
+  std::mt19937 engine(42);
+  Qn::DataContainerQVector observable;
+  observable.AddAxes({{"pT", static_cast<int>(state.range(0)), 0., 3.}});
+  Qn::DataContainerQVector reference;
+  FillRandom(observable, state.range(1), engine);
+  FillRandom(reference, state.range(1), engine);
+  auto function = [](const Qn::QVector &a, const Qn::QVector &b) { return a.x(2)*b.x(2) + a.y(2)*b.y(2); };
+  using Function = decltype(function);
+  using Arguments = typename Qn::Correlation::TemplateHelpers::FunctionTraits<Function>::DecayedArgumentTuple;
+  Qn::Correlation::Correlation<Function, Arguments, Qn::Correlation::Impl::InputDataContainers<Arguments>::type>
+      correlation(function);
+  correlation.SetInputNames("observable", "reference");
+  correlation.SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE);
+  correlation.Initialize({{&observable, &reference}});
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(correlation.Correlate(observable, reference));
+  }
+  state.SetItemsProcessed(state.iterations()*observable.size());
+}
+BENCHMARK(BM_CorrelationCorrelate)->ArgsProduct({{1, 10, 100, 1000}, {10, 100}});
+}
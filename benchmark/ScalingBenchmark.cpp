@@ -0,0 +1,474 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Scaling benchmark of the full chain on events of the ToyMC. The events are corrected in a number of passes, of
+// which each uses the calibration of the previous one, and the corrected Q-vectors are correlated afterwards.
+// Both parts are timed separately. The events are distributed over the slots of the correction manager and the
+// correlations use the implicit multithreading of ROOT, such that the strong scaling is measured by increasing
+// --threads at a fixed number of events and the weak scaling by increasing --events together with --threads.
+// With --in-memory 1 the last pass generates the events with the ToyMCDataSource and correlates them in the same
+// event loop without writing the Q-vectors.
+//
+// flow_scaling --events 5000 --multiplicity 100 --detectors 5 --bins 1 --harmonics 2 --samples 1000 --threads 1
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+#include "ROOT/RDataFrame.hxx"
+#include "TChain.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+#include "TTreeReader.h"
+
+#include "CorrectionManager.h"
+#include "CorrelationHelper.h"
+#include "ReSampler.h"
+#include "ParticleGenerator.h"
+#include "ToyMCDataSource.h"
+#include "TrackingDetector.h"
+
+namespace {
+struct Options {
+  std::size_t events = 5000; ///< number of events
+  std::size_t multiplicity = 100; ///< number of tracks of each event
+  std::size_t detectors = 5; ///< number of tracking detectors
+  std::size_t bins = 1; ///< number of transverse momentum bins of the differential Q-vectors
+  std::size_t harmonics = 2; ///< number of harmonics of the Q-vectors
+  std::size_t samples = 1000; ///< number of bootstrap samples
+  std::size_t threads = 1; ///< number of threads of the correction and the correlation
+  std::size_t passes = 2; ///< number of correction passes
+  std::size_t in_memory = 0; ///< correlates the events of the last pass in the same event loop if not 0
+  std::string output = "flow_scaling"; ///< prefix of the written files
+};
+
+enum Variables {
+  kEvent = 0,
+  kPsi,
+  kPsiWeight,
+  kPhi,
+  kPt,
+  kWeight,
+};
+
+constexpr std::size_t kGranularity = 1000;
+constexpr std::size_t kMaxHarmonics = 4;
+
+void PrintUsage() {
+  Options defaults;
+  std::cout << "Usage: flow_scaling [options]\n"
+            << "  --events N        number of events (" << defaults.events << ")\n"
+            << "  --multiplicity N  tracks per event (" << defaults.multiplicity << ")\n"
+            << "  --detectors N     tracking detectors (" << defaults.detectors << ")\n"
+            << "  --bins N          pT bins of the differential Q-vectors (" << defaults.bins << ")\n"
+            << "  --harmonics N     harmonics of the Q-vectors, at most " << kMaxHarmonics
+            << " (" << defaults.harmonics << ")\n"
+            << "  --samples N       bootstrap samples (" << defaults.samples << ")\n"
+            << "  --threads N       threads of the correction and the correlation (" << defaults.threads << ")\n"
+            << "  --passes N        correction passes (" << defaults.passes << ")\n"
+            << "  --in-memory 0|1   correlates the last pass without writing the Q-vectors (" << defaults.in_memory
+            << ")\n"
+            << "  --output PREFIX   prefix of the written files (" << defaults.output << ")" << std::endl;
+}
+
+Options ParseOptions(int argc, char **argv) {
+  Options options;
+  const std::map<std::string, std::size_t *> counts{
+      {"--events", &options.events}, {"--multiplicity", &options.multiplicity},
+      {"--detectors", &options.detectors}, {"--bins", &options.bins}, {"--harmonics", &options.harmonics},
+      {"--samples", &options.samples}, {"--threads", &options.threads}, {"--passes", &options.passes},
+      {"--in-memory", &options.in_memory}};
+  for (int i = 1; i < argc; ++i) {
+    const std::string argument(argv[i]);
+    if (argument=="--help" || argument=="-h") {
+      PrintUsage();
+      std::exit(0);
+    }
+    if (i + 1==argc) throw std::invalid_argument("Missing value of " + argument + ".");
+    const std::string value(argv[++i]);
+    if (argument=="--output") {
+      options.output = value;
+      continue;
+    }
+    const auto count = counts.find(argument);
+    if (count==counts.end()) throw std::invalid_argument("Unknown option " + argument + ".");
+    *count->second = std::stoul(value);
+  }
+  if (options.events==0 || options.detectors==0 || options.bins==0 || options.threads==0 || options.passes==0) {
+    throw std::invalid_argument("The events, detectors, bins, threads and passes need to be positive.");
+  }
+  if (options.harmonics==0 || options.harmonics > kMaxHarmonics) {
+    throw std::invalid_argument("The number of harmonics needs to be between 1 and 4.");
+  }
+  return options;
+}
+
+/**
+ * Peak resident set size of the process.
+ * @return peak RSS in MB
+ */
+double PeakRSS() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss/1024.;
+}
+
+std::string DetectorName(std::size_t i) { return "DetTrk" + std::to_string(i); }
+
+std::string TreeFileName(const Options &options, std::size_t slot) {
+  return options.output + "_tree_" + std::to_string(slot) + ".root";
+}
+
+void AddTrackDetector(Qn::CorrectionManager &manager, const std::string &name, const std::string &phi,
+                      const std::string &weight, const std::vector<Qn::AxisD> &axes, std::size_t n_harmonics) {
+  switch (n_harmonics) {
+    case 1: manager.AddDetector(name, Qn::DetectorType::TRACK, phi, weight, axes, {1});
+      break;
+    case 2: manager.AddDetector(name, Qn::DetectorType::TRACK, phi, weight, axes, {1, 2});
+      break;
+    case 3: manager.AddDetector(name, Qn::DetectorType::TRACK, phi, weight, axes, {1, 2, 3});
+      break;
+    default: manager.AddDetector(name, Qn::DetectorType::TRACK, phi, weight, axes, {1, 2, 3, 4});
+      break;
+  }
+}
+
+/**
+ * Configures a correction manager. Called for the manager of each slot.
+ */
+void ConfigureManager(Qn::CorrectionManager &manager, const Options &options) {
+  manager.SetFillOutputTree(true);
+  manager.SetFillCalibrationQA(false);
+  manager.SetFillValidationQA(false);
+  manager.AddVariable("Event", kEvent, 1);
+  manager.AddVariable("psi", kPsi, 1);
+  manager.AddVariable("weight_psi", kPsiWeight, 1);
+  manager.AddVariable("phi", kPhi, 1);
+  manager.AddVariable("pT", kPt, 1);
+  for (std::size_t i = 0; i < options.detectors; ++i) {
+    manager.AddVariable("weight_trk_" + std::to_string(i), kWeight + i, 1);
+  }
+  manager.AddEventVariable("Event");
+  manager.AddCorrectionAxis({"Event", 1, 0, 1});
+  const std::vector<Qn::AxisD> axes{{"pT", static_cast<int>(options.bins), 0., 1.}};
+  for (std::size_t i = 0; i < options.detectors; ++i) {
+    const auto name = DetectorName(i);
+    AddTrackDetector(manager, name, "phi", "weight_trk_" + std::to_string(i), axes, options.harmonics);
+    Qn::Recentering recentering;
+    recentering.SetApplyWidthEqualization(false);
+    manager.AddCorrectionOnQnVector(name, recentering);
+    manager.SetOutputQVectors(name, {Qn::QVector::CorrectionStep::PLAIN, Qn::QVector::CorrectionStep::RECENTERED});
+  }
+  AddTrackDetector(manager, "DetPsi", "psi", "weight_psi", {}, options.harmonics);
+  manager.SetOutputQVectors("DetPsi", {Qn::QVector::CorrectionStep::PLAIN});
+}
+
+/**
+ * Creates the tracking detectors of the ToyMC. Every second detector has an azimuthal efficiency modulation, which
+ * is removed by the recentering.
+ */
+std::vector<TrackingDetector<std::mt19937_64>> CreateDetectors(const Options &options) {
+  std::vector<TrackingDetector<std::mt19937_64>> detectors;
+  std::vector<double> efficiencies(kGranularity);
+  for (std::size_t i = 0; i < options.detectors; ++i) {
+    for (std::size_t j = 0; j < kGranularity; ++j) {
+      const auto phi = (2.*M_PI/kGranularity)*j;
+      efficiencies[j] = i%2==0 ? 1. : (1. + 0.1*std::cos(2*phi))/1.1;
+    }
+    TrackingDetector<std::mt19937_64> detector({DetectorName(i), kGranularity, 0, 2*M_PI}, [](double) { return true; });
+    detector.SetChannelEfficencies(efficiencies);
+    detectors.push_back(detector);
+  }
+  return detectors;
+}
+
+/**
+ * Generator of the events of the ToyMC. Each slot uses its own generator, as the detectors keep the state of the
+ * current particle. The response of the tracking detectors is simulated for all particles at once and the tracks
+ * are filled as columns.
+ */
+class ToyEvent {
+ public:
+  explicit ToyEvent(const Options &options) :
+      detectors_(CreateDetectors(options)),
+      detector_psi_({"DetPsi", kGranularity, 0, 2*M_PI}, [](double) { return true; }),
+      phis_(options.multiplicity),
+      pts_(options.multiplicity),
+      weights_(options.detectors, std::vector<double>(options.multiplicity)) {
+    columns_.emplace_back("phi", phis_.data());
+    columns_.emplace_back("pT", pts_.data());
+    for (std::size_t i = 0; i < weights_.size(); ++i) {
+      columns_.emplace_back("weight_trk_" + std::to_string(i), weights_[i].data());
+    }
+  }
+
+  ToyEvent(const ToyEvent &) = delete;
+  ToyEvent &operator=(const ToyEvent &) = delete;
+
+  /**
+   * Generates an event into a correction manager.
+   * @return true if the event passes the event cuts
+   */
+  bool Generate(Qn::CorrectionManager &manager, std::mt19937_64 &engine) {
+    auto values = manager.GetVariableContainer();
+    values[kEvent] = 0.5;
+    if (!manager.ProcessEvent()) return false;
+    const auto psi = psi_distribution_(engine);
+    detector_psi_.Detect(psi);
+    detector_psi_.FillDataRec(engine, values, kPsi, kPsiWeight);
+    generator_.GeneratePhis(engine, psi, phis_.data(), phis_.size());
+    for (auto &phi : phis_) phi = std::atan2(std::sin(phi), std::cos(phi)) + M_PI;
+    for (auto &pt : pts_) pt = pt_distribution_(engine);
+    for (std::size_t i = 0; i < detectors_.size(); ++i) {
+      detectors_[i].DetectBatch(engine, phis_.data(), phis_.size(), weights_[i].data());
+    }
+    manager.FillTracks(phis_.size(), columns_);
+    return true;
+  }
+
+ private:
+  std::uniform_real_distribution<> psi_distribution_{0, 2*M_PI};
+  std::uniform_real_distribution<> pt_distribution_{0., 1.};
+  ParticleGenerator<std::mt19937_64, 2, 10000> generator_{{0., 0.05}};
+  std::vector<TrackingDetector<std::mt19937_64>> detectors_;
+  TrackingDetector<std::mt19937_64> detector_psi_;
+  std::vector<double> phis_;
+  std::vector<double> pts_;
+  std::vector<std::vector<double>> weights_;
+  std::vector<std::pair<std::string, const double *>> columns_; ///< track columns referring to the arrays
+};
+
+/**
+ * Generates and corrects the events of one slot.
+ * @param manager correction manager of the slot
+ * @param seed seed of the random numbers of the slot
+ */
+void ProcessSlot(Qn::CorrectionManager &manager, const Options &options, std::size_t n_events, unsigned long seed) {
+  std::mt19937_64 engine(seed);
+  ToyEvent event(options);
+  for (std::size_t i = 0; i < n_events; ++i) {
+    manager.Reset();
+    event.Generate(manager, engine);
+    manager.ProcessCorrections();
+  }
+}
+
+/**
+ * Creates the correction manager of a pass with one slot per thread, which uses the calibration of the previous
+ * pass.
+ */
+std::shared_ptr<Qn::CorrectionManager> CreateManager(const Options &options, std::size_t pass) {
+  auto manager = std::make_shared<Qn::CorrectionManager>();
+  ConfigureManager(*manager, options);
+  if (options.threads > 1) {
+    manager->SetNumberOfSlots(options.threads, [&options](Qn::CorrectionManager &slot) {
+      ConfigureManager(slot, options);
+    });
+  }
+  if (pass > 0) manager->SetCalibrationInputFileName(options.output + "_calibration_" + std::to_string(pass) + ".root");
+  return manager;
+}
+
+/**
+ * Writes the calibration of a pass, which is used as input of the next pass.
+ */
+void WriteCalibration(const Options &options, std::size_t pass, Qn::CorrectionManager &manager) {
+  auto calibration = TFile::Open((options.output + "_calibration_" + std::to_string(pass + 1) + ".root").data(),
+                                 "RECREATE");
+  calibration->cd();
+  manager.GetCorrectionList()->Write("CorrectionHistograms", TObject::kSingleKey);
+  calibration->Close();
+  delete calibration;
+}
+
+/**
+ * Books the correlations of the recentered Q-vectors of the tracking detectors with the Q-vector of the reaction
+ * plane in all harmonics.
+ * @param event axis of the event variable. Its type needs to match the type of the column.
+ * @param book function booking a configured correlation helper with the names of its inputs
+ */
+template<typename EventAxis, typename Book>
+void BookCorrelations(const Options &options, const EventAxis &event, Book &&book) {
+  const std::string step = options.passes > 1 ? "_RECENTERED" : "_PLAIN";
+  for (std::size_t i = 0; i < options.detectors; ++i) {
+    for (unsigned int h = 1; h <= options.harmonics; ++h) {
+      auto scalar_product = [h](const Qn::QVector &a, const Qn::QVector &b) { return Qn::ScalarProduct(a, b, h); };
+      const auto observable = DetectorName(i) + step;
+      book(Qn::Correlation::MakeCorrelation("v" + std::to_string(h), scalar_product, Qn::Correlation::MakeAxes(event))
+               .SetInputNames(observable, "DetPsi_PLAIN")
+               .SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE),
+           observable, "DetPsi_PLAIN");
+    }
+  }
+}
+
+void WriteCorrelations(const Options &options,
+                       std::vector<ROOT::RDF::RResultPtr<Qn::DataContainerStats>> &correlations) {
+  auto out_file = TFile::Open((options.output + "_correlations.root").data(), "RECREATE");
+  out_file->cd();
+  for (std::size_t i = 0; i < correlations.size(); ++i) {
+    correlations[i].GetValue().Write(("correlation_" + std::to_string(i)).data());
+  }
+  out_file->Close();
+  delete out_file;
+}
+
+/**
+ * Runs one correction pass. The calibration of the previous pass is used as input and the calibration of this pass
+ * is written. The Q-vectors are written only in the last pass, one file for each slot.
+ * @return the time of the event loop in seconds
+ */
+double CorrectionPass(const Options &options, std::size_t pass) {
+  const bool last_pass = pass + 1==options.passes;
+  auto manager_ptr = CreateManager(options, pass);
+  auto &manager = *manager_ptr;
+  std::vector<std::unique_ptr<TFile>> tree_files;
+  for (std::size_t slot = 0; slot < options.threads && last_pass; ++slot) {
+    tree_files.emplace_back(TFile::Open(TreeFileName(options, slot).data(), "RECREATE"));
+    tree_files.back()->cd();
+    manager.GetSlot(slot).ConnectOutputTree(new TTree("tree", "tree"));
+  }
+  manager.InitializeOnNode();
+  manager.SetCurrentRunName("scaling");
+  const auto begin = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (std::size_t slot = 0; slot < options.threads; ++slot) {
+    const auto first = options.events*slot/options.threads;
+    const auto last = options.events*(slot + 1)/options.threads;
+    threads.emplace_back(ProcessSlot, std::ref(manager.GetSlot(slot)), std::cref(options), last - first,
+                         1000*pass + slot);
+  }
+  for (auto &thread : threads) thread.join();
+  manager.Finalize();
+  const std::chrono::duration<double> time = std::chrono::steady_clock::now() - begin;
+  for (auto &file : tree_files) {
+    file->Write();
+    file->Close();
+  }
+  WriteCalibration(options, pass, manager);
+  return time.count();
+}
+
+/**
+ * Correlates the Q-vectors written in the last correction pass.
+ * @return the time of the event loop in seconds
+ */
+double Correlate(const Options &options) {
+  if (options.threads > 1) ROOT::EnableImplicitMT(options.threads);
+  std::vector<std::string> file_names;
+  TChain chain("tree");
+  for (std::size_t slot = 0; slot < options.threads; ++slot) {
+    file_names.push_back(TreeFileName(options, slot));
+    chain.Add(file_names.back().data());
+  }
+  TTreeReader reader(&chain);
+  const auto begin = std::chrono::steady_clock::now();
+  Qn::Correlation::ReSampler re_sampler(options.samples);
+  ROOT::RDataFrame df("tree", file_names);
+  auto df_samples = df.DefineSlot("Samples", re_sampler, {"rdfentry_"});
+  std::vector<ROOT::RDF::RResultPtr<Qn::DataContainerStats>> correlations;
+  // the event variables are written as float.
+  BookCorrelations(options, Qn::AxisF("Event", 1, 0, 1), [&](auto helper, const std::string &, const std::string &) {
+    correlations.push_back(helper.BookMe(df_samples, reader, options.samples));
+  });
+  WriteCorrelations(options, correlations);
+  const std::chrono::duration<double> time = std::chrono::steady_clock::now() - begin;
+  return time.count();
+}
+
+/**
+ * Runs the last correction pass on the events generated by the ToyMCDataSource and correlates the corrected
+ * Q-vectors in the same event loop.
+ * @return the time of the event loop in seconds
+ */
+double CorrectAndCorrelate(const Options &options, std::size_t pass) {
+  if (options.threads > 1) ROOT::EnableImplicitMT(options.threads);
+  auto manager = CreateManager(options, pass);
+  manager->InitializeOnNode();
+  manager->SetCurrentRunName("scaling");
+  std::vector<std::string> q_vectors{"DetPsi_PLAIN"};
+  const std::string step = options.passes > 1 ? "_RECENTERED" : "_PLAIN";
+  for (std::size_t i = 0; i < options.detectors; ++i) q_vectors.push_back(DetectorName(i) + step);
+  std::vector<std::unique_ptr<ToyEvent>> events;
+  for (std::size_t slot = 0; slot < options.threads; ++slot) events.emplace_back(std::make_unique<ToyEvent>(options));
+  const auto begin = std::chrono::steady_clock::now();
+  auto df = Qn::MakeToyMCDataFrame(options.events, manager, q_vectors, {{"Event", kEvent}},
+                                   [&events](unsigned int slot, Qn::CorrectionManager &slot_manager,
+                                             std::mt19937_64 &engine) {
+                                     return events[slot]->Generate(slot_manager, engine);
+                                   }, 1000*pass);
+  Qn::Correlation::ReSampler re_sampler(options.samples);
+  auto df_samples = df.DefineSlot("Samples", re_sampler, {"rdfentry_"});
+  std::vector<ROOT::RDF::RResultPtr<Qn::DataContainerStats>> correlations;
+  BookCorrelations(options, Qn::AxisD("Event", 1, 0, 1),
+                   [&](auto helper, const std::string &observable, const std::string &reference) {
+                     std::array<const Qn::DataContainerQVector *, 2> inputs{{manager->GetQVector(observable),
+                                                                             manager->GetQVector(reference)}};
+                     correlations.push_back(helper.BookMe(df_samples, inputs, options.samples));
+                   });
+  WriteCorrelations(options, correlations);
+  const std::chrono::duration<double> time = std::chrono::steady_clock::now() - begin;
+  WriteCalibration(options, pass, *manager);
+  return time.count();
+}
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  try {
+    options = ParseOptions(argc, argv);
+  } catch (std::exception &exception) {
+    std::cerr << exception.what() << std::endl;
+    PrintUsage();
+    return 1;
+  }
+  if (options.threads > 1) ROOT::EnableThreadSafety();
+  double correction_time = 0.;
+  const auto n_file_passes = options.in_memory ? options.passes - 1 : options.passes;
+  for (std::size_t pass = 0; pass < n_file_passes; ++pass) {
+    const auto time = CorrectionPass(options, pass);
+    std::cout << "correction pass " << pass << ": " << time << " s, " << options.events/time << " events/s"
+              << std::endl;
+    correction_time += time;
+  }
+  const auto correction_rss = PeakRSS();
+  const auto correlation_time = options.in_memory ? CorrectAndCorrelate(options, n_file_passes) : Correlate(options);
+  const auto events = static_cast<double>(options.events);
+  std::cout << "events " << options.events << " multiplicity " << options.multiplicity
+            << " detectors " << options.detectors << " bins " << options.bins << " harmonics " << options.harmonics
+            << " samples " << options.samples << " threads " << options.threads << " passes " << options.passes
+            << " in-memory " << options.in_memory << "\n";
+  if (n_file_passes > 0) {
+    std::cout << "correction:  " << correction_time << " s, " << n_file_passes*events/correction_time
+              << " events/s, peak RSS " << correction_rss << " MB\n";
+  }
+  std::cout << (options.in_memory ? "correction and correlation: " : "correlation: ") << correlation_time << " s, "
+            << events/correlation_time << " events/s, peak RSS " << PeakRSS() << " MB" << std::endl;
+  return 0;
+}
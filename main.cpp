@@ -224,13 +224,15 @@ int main() {
   using Q = const Qn::QVector&;
 
   auto v2_2 = [](Q a) {
-    auto Q = a.DeNormal();
+    Qn::QVectorDeNormalView Q(a);
     auto M = Q.sumweights();
     return (Qn::ScalarProduct(Q, Q, 2) - M)/(M*(M - 1));
   };
 
-  auto v2 = [](const Qn::QVector &a, const Qn::QVector &b) {
-    return a.x(2)*b.x(2) + a.y(2)*b.y(2);
+  using Q12 = Qn::Correlation::QVectorView<1, 2>;
+
+  auto v2 = [](Q12 a, Q12 b) {
+    return a.x<2>()*b.x<2>() + a.y<2>()*b.y<2>();
   };
 
   auto scalar = [](const Qn::QVector &a, const Qn::QVector &b) {
@@ -249,7 +251,7 @@ int main() {
   Qn::AxisD event("Event", 1, 0, 1);
   Qn::Correlation::ReSampler re_sampler(n_samples);
   ROOT::RDataFrame df("tree", tree_file_name);
-  auto df_samples = df.Define("Samples", re_sampler, {});
+  auto df_samples = df.DefineSlot("Samples", re_sampler, {"rdfentry_"});
 
   auto detector_names_trk = CreateDetectorNames(detectors_trk.size(), "DetTrk", correction_steps);
 
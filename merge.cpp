@@ -0,0 +1,117 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Merges the result files of many jobs, replacing hadd for the outputs of the framework. The input files are read
+// in batches, such that only the merged result and one batch are kept in memory. See Qn::ResultFileMerger.
+//
+// flow_merge --threads 8 --batch 32 merged.root job_*.root
+// flow_merge --threads 8 merged.root --list inputs.txt
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "TH1.h"
+#include "TROOT.h"
+
+#include "ResultFileMerger.h"
+
+namespace {
+struct Options {
+  std::size_t threads = 1; ///< number of threads reading the files and merging the bins
+  std::size_t batch = 16; ///< number of files read and merged at once
+  std::string output; ///< name of the merged file
+  std::vector<std::string> inputs; ///< names of the input files
+};
+
+void PrintUsage() {
+  Options defaults;
+  std::cout << "Usage: flow_merge [options] output.root input.root [input.root ...]\n"
+            << "  --threads N   threads reading the files and merging the bins (" << defaults.threads << ")\n"
+            << "  --batch N     files read and merged at once (" << defaults.batch << ")\n"
+            << "  --list FILE   file with the names of the input files, one per line" << std::endl;
+}
+
+Options ParseOptions(int argc, char **argv) {
+  Options options;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; ++i) {
+    const std::string argument(argv[i]);
+    if (argument=="--help" || argument=="-h") {
+      PrintUsage();
+      std::exit(0);
+    }
+    if (argument.compare(0, 2, "--")!=0) {
+      files.push_back(argument);
+      continue;
+    }
+    if (i + 1==argc) throw std::invalid_argument("Missing value of " + argument + ".");
+    const std::string value(argv[++i]);
+    if (argument=="--threads") {
+      options.threads = std::stoul(value);
+    } else if (argument=="--batch") {
+      options.batch = std::stoul(value);
+    } else if (argument=="--list") {
+      std::ifstream list(value);
+      if (!list) throw std::invalid_argument("Cannot open the list " + value + ".");
+      std::string line;
+      while (std::getline(list, line)) {
+        if (!line.empty() && line[0]!='#') options.inputs.push_back(line);
+      }
+    } else {
+      throw std::invalid_argument("Unknown option " + argument + ".");
+    }
+  }
+  if (files.empty()) throw std::invalid_argument("Missing output file.");
+  options.output = files.front();
+  options.inputs.insert(options.inputs.end(), files.begin() + 1, files.end());
+  if (options.inputs.empty()) throw std::invalid_argument("Missing input files.");
+  options.threads = std::max<std::size_t>(options.threads, 1);
+  options.batch = std::max<std::size_t>(options.batch, 1);
+  return options;
+}
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  try {
+    options = ParseOptions(argc, argv);
+  } catch (const std::exception &error) {
+    std::cerr << "flow_merge: " << error.what() << std::endl;
+    PrintUsage();
+    return 1;
+  }
+  ROOT::EnableThreadSafety();
+  if (options.threads > 1) ROOT::EnableImplicitMT(options.threads);
+  TH1::AddDirectory(false);
+  try {
+    Qn::ResultFileMerger merger(options.threads);
+    for (std::size_t first = 0; first < options.inputs.size(); first += options.batch) {
+      const auto last = std::min(first + options.batch, options.inputs.size());
+      merger.MergeBatch(std::vector<std::string>(options.inputs.begin() + first, options.inputs.begin() + last));
+      std::cout << "flow_merge: merged " << last << " of " << options.inputs.size() << " files" << std::endl;
+    }
+    merger.Write(options.output);
+  } catch (const std::exception &error) {
+    std::cerr << "flow_merge: " << error.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
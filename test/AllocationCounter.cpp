@@ -0,0 +1,60 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace Qn {
+namespace Test {
+std::size_t &AllocationCounter::Count() {
+  // trivially constructed, such that it is usable in allocations before the start of main.
+  static thread_local std::size_t count = 0;
+  return count;
+}
+}
+}
+
+namespace {
+void *Allocate(std::size_t size) {
+  ++Qn::Test::AllocationCounter::Count();
+  if (auto pointer = std::malloc(size ? size : 1)) return pointer;
+  throw std::bad_alloc();
+}
+
+void *AllocateAligned(std::size_t size, std::align_val_t alignment) {
+  ++Qn::Test::AllocationCounter::Count();
+  const auto align = static_cast<std::size_t>(alignment);
+  // the size passed to aligned_alloc needs to be a multiple of the alignment.
+  if (auto pointer = std::aligned_alloc(align, (size + align - 1)/align*align)) return pointer;
+  throw std::bad_alloc();
+}
+}
+
+void *operator new(std::size_t size) { return Allocate(size); }
+void *operator new[](std::size_t size) { return Allocate(size); }
+void *operator new(std::size_t size, std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+void *operator new[](std::size_t size, std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, std::size_t) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept { std::free(pointer); }
@@ -0,0 +1,56 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLOW_TEST_ALLOCATIONCOUNTER_H
+#define FLOW_TEST_ALLOCATIONCOUNTER_H
+
+#include <cstddef>
+
+namespace Qn {
+namespace Test {
+/**
+ * @class AllocationCounter
+ * @brief Counts the heap allocations of the current thread while it is alive.
+ * The global operator new of the test executable is replaced in AllocationCounter.cpp, such that every allocation
+ * through new, including the ones of the standard containers, is counted.
+ * {
+ *   AllocationCounter counter;
+ *   ProcessEvent();
+ *   EXPECT_EQ(counter.Allocations(), 0);
+ * }
+ */
+class AllocationCounter {
+ public:
+  AllocationCounter() : start_(Count()) {}
+
+  /**
+   * Returns the number of allocations of the current thread since the construction of the counter.
+   */
+  std::size_t Allocations() const { return Count() - start_; }
+
+  /**
+   * Returns the number of allocations of the current thread since the start of the program.
+   */
+  static std::size_t &Count();
+
+ private:
+  std::size_t start_; ///< number of allocations at the construction
+};
+}
+}
+
+#endif //FLOW_TEST_ALLOCATIONCOUNTER_H
@@ -0,0 +1,135 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// The per-event paths are run for a number of warm-up events, after which the buffers have reached their steady
+// state size. The following events must not allocate.
+
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include "AllocationCounter.h"
+#include "CorrectionManager.h"
+#include "CorrelationHelper.h"
+#include "DataContainer.h"
+#include "ReSampler.h"
+
+namespace {
+constexpr int kWarmUpEvents = 100;
+constexpr int kEvents = 100;
+
+void FillRandom(Qn::DataContainerQVector &container, std::mt19937 &engine) {
+  std::uniform_real_distribution<double> distribution(0., 2*Qn::QVector::kPi);
+  for (auto &q : container) {
+    q = Qn::QVector(std::bitset<Qn::QVector::kmaxharmonics>(0b11), Qn::QVector::CorrectionStep::PLAIN);
+    for (int i = 0; i < 10; ++i) q.Add(distribution(engine), 1.);
+    q = q.Normal(Qn::QVector::Normalization::M);
+  }
+}
+}
+
+TEST(AllocationTest, DataContainerGetIndex) {
+  Qn::DataContainerStats container;
+  container.AddAxes({{"a", 10, 0., 10.}, {"b", 10, 0., 10.}});
+  std::array<Qn::DataContainerStats::size_type, 2> indices{};
+  Qn::Test::AllocationCounter counter;
+  for (std::size_t i = 0; i < container.size(); ++i) {
+    container.GetIndex(indices, i);
+  }
+  EXPECT_EQ(counter.Allocations(), 0);
+}
+
+TEST(AllocationTest, ReSamplerSteadyState) {
+  Qn::Correlation::ReSampler re_sampler(100);
+  for (ULong64_t entry = 0; entry < kWarmUpEvents; ++entry) re_sampler(0, entry);
+  Qn::Test::AllocationCounter counter;
+  for (ULong64_t entry = kWarmUpEvents; entry < kWarmUpEvents + kEvents; ++entry) re_sampler(0, entry);
+  EXPECT_EQ(counter.Allocations(), 0);
+}
+
+TEST(AllocationTest, CorrelationSteadyState) {
+  std::mt19937 engine(42);
+  Qn::DataContainerQVector observable;
+  observable.AddAxes({{"pT", 10, 0., 3.}});
+  Qn::DataContainerQVector reference;
+  auto function = [](const Qn::QVector &a, const Qn::QVector &b) { return a.x(2)*b.x(2) + a.y(2)*b.y(2); };
+  auto helper = Qn::Correlation::MakeCorrelation("v2", function, Qn::Correlation::MakeAxes(Qn::AxisD("Ev", 10, 0., 10.)))
+      .SetInputNames("observable", "reference")
+      .SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE);
+  std::array<const Qn::DataContainerQVector *, 2> inputs{{&observable, &reference}};
+  helper.Configure(inputs, 100);
+  helper.InitTask(nullptr, 0);
+  Qn::Correlation::ReSampler re_sampler(100);
+  auto process = [&](ULong64_t entry) {
+    FillRandom(observable, engine);
+    FillRandom(reference, engine);
+    helper.Exec(0, re_sampler(0, entry), observable, reference, static_cast<double>(entry%10));
+  };
+  for (ULong64_t entry = 0; entry < kWarmUpEvents; ++entry) process(entry);
+  Qn::Test::AllocationCounter counter;
+  for (ULong64_t entry = kWarmUpEvents; entry < kWarmUpEvents + kEvents; ++entry) process(entry);
+  EXPECT_EQ(counter.Allocations(), 0);
+}
+
+TEST(AllocationTest, CorrectionManagerSteadyState) {
+  enum Variables { kEvent = 0, kPhi, kPt };
+  Qn::CorrectionManager manager;
+  manager.SetFillOutputTree(false);
+  manager.SetFillCalibrationQA(false);
+  manager.SetFillValidationQA(false);
+  manager.AddVariable("Event", kEvent, 1);
+  manager.AddVariable("phi", kPhi, 1);
+  manager.AddVariable("pT", kPt, 1);
+  manager.AddCorrectionAxis({"Event", 1, 0., 1.});
+  manager.AddDetector("tracks", Qn::DetectorType::TRACK, "phi", "Ones", {{"pT", 5, 0., 1.}}, {1, 2});
+  Qn::Recentering recentering;
+  manager.AddCorrectionOnQnVector("tracks", recentering);
+  manager.InitializeOnNode();
+  manager.SetCurrentRunName("test");
+  std::mt19937 engine(42);
+  std::uniform_real_distribution<double> phi(0., 2*Qn::QVector::kPi);
+  std::uniform_real_distribution<double> pt(0., 1.);
+  std::poisson_distribution<int> multiplicity(100);
+  auto values = manager.GetVariableContainer();
+  auto process = [&]() {
+    manager.Reset();
+    values[kEvent] = 0.5;
+    if (manager.ProcessEvent()) {
+      const auto n = multiplicity(engine);
+      for (int i = 0; i < n; ++i) {
+        values[kPhi] = phi(engine);
+        values[kPt] = pt(engine);
+        manager.FillTrackingDetectors();
+      }
+    }
+    manager.ProcessCorrections();
+  };
+  // the multiplicity of the warm-up events exceeds the ones of the following events, such that the data vectors
+  // do not grow anymore.
+  manager.Reset();
+  values[kEvent] = 0.5;
+  values[kPhi] = 0.;
+  values[kPt] = 0.5;
+  if (manager.ProcessEvent()) {
+    for (int i = 0; i < 1000; ++i) manager.FillTrackingDetectors();
+  }
+  manager.ProcessCorrections();
+  for (int i = 0; i < kWarmUpEvents; ++i) process();
+  Qn::Test::AllocationCounter counter;
+  for (int i = 0; i < kEvents; ++i) process();
+  EXPECT_EQ(counter.Allocations(), 0);
+}
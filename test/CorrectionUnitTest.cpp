@@ -1,8 +1,27 @@
 
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <memory>
 #include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 #include "gtest/gtest.h"
 #include "CorrectionManager.h"
+#include "CorrectionCalibrationCache.h"
+#include "CorrectionCalibrationFile.h"
+#include "CorrectionTreeWriter.h"
+#include "EventTrace.h"
+#include "FlatQVectorReader.h"
+#include "THashList.h"
+#include "TNamed.h"
 
 TEST(CorrectionUnitTest, Correction) {
   int kNEvents = 1000;
@@ -73,4 +92,838 @@ TEST(CorrectionUnitTest, Correction) {
   tree->Write();
   file->Write();
   file->Close();
-}
\ No newline at end of file
+}
+
+namespace {
+/**
+ * Configures four tracking detectors, of which the ones in the map are aligned to other detectors.
+ */
+void ConfigureDetectors(Qn::DetectorList &detectors, Qn::InputVariableManager &variables,
+                        const std::map<std::string, std::string> &alignments) {
+  variables.CreateVariable("phi", 0, 1);
+  for (const auto &name : {"A", "B", "C", "D"}) {
+    detectors.AddDetector(name, Qn::DetectorType::TRACK, variables.FindVariable("phi"),
+                          variables.FindVariable("Ones"), variables.FindVariable("Ones"), {},
+                          std::bitset<Qn::QVector::kmaxharmonics>(0b11), Qn::QVector::Normalization::M);
+  }
+  for (const auto &alignment : alignments) {
+    Qn::Alignment step;
+    step.SetHarmonicNumberForAlignment(2);
+    step.SetReferenceConfigurationForAlignment(alignment.second.data());
+    detectors.FindDetector(alignment.first).AddCorrectionOnQnVector(step);
+  }
+  variables.Initialize();
+}
+}
+
+TEST(CorrectionUnitTest, CorrectionLevels) {
+  Qn::DetectorList detectors;
+  Qn::InputVariableManager variables;
+  Qn::CorrectionAxisSet axes;
+  ConfigureDetectors(detectors, variables, {{"B", "A"}, {"C", "B"}});
+  axes.Initialize(variables);
+  detectors.Initialize(detectors, variables, axes);
+  const auto &levels = detectors.GetCorrectionLevels();
+  ASSERT_EQ(levels.size(), 3);
+  ASSERT_EQ(levels[0].size(), 2);
+  EXPECT_EQ(levels[0][0]->GetName(), "A");
+  EXPECT_EQ(levels[0][1]->GetName(), "D");
+  ASSERT_EQ(levels[1].size(), 1);
+  EXPECT_EQ(levels[1][0]->GetName(), "B");
+  ASSERT_EQ(levels[2].size(), 1);
+  EXPECT_EQ(levels[2][0]->GetName(), "C");
+}
+
+TEST(CorrectionUnitTest, CorrectionLevelsCycle) {
+  Qn::DetectorList detectors;
+  Qn::InputVariableManager variables;
+  Qn::CorrectionAxisSet axes;
+  ConfigureDetectors(detectors, variables, {{"A", "C"}, {"B", "A"}, {"C", "B"}});
+  axes.Initialize(variables);
+  EXPECT_THROW(detectors.Initialize(detectors, variables, axes), std::logic_error);
+}
+
+TEST(CorrectionUnitTest, MakeHashedList) {
+  auto run = new TList();
+  run->SetName("run");
+  run->SetOwner(true);
+  for (const auto sub_event : {"A_0", "A_1"}) {
+    auto list = new TList();
+    list->SetName(sub_event);
+    list->SetOwner(true);
+    list->Add(new TNamed("recentering", ""));
+    list->Add(new TNamed("twist", ""));
+    run->Add(list);
+  }
+  std::unique_ptr<TList> hashed(Qn::MakeHashedList(run));
+  ASSERT_NE(dynamic_cast<THashList *>(hashed.get()), nullptr);
+  EXPECT_STREQ(hashed->GetName(), "run");
+  EXPECT_EQ(hashed->GetSize(), 2);
+  for (const auto sub_event : {"A_0", "A_1"}) {
+    auto list = dynamic_cast<THashList *>(hashed->FindObject(sub_event));
+    ASSERT_NE(list, nullptr);
+    EXPECT_EQ(list->GetSize(), 2);
+    EXPECT_NE(list->FindObject("recentering"), nullptr);
+    EXPECT_NE(list->FindObject("twist"), nullptr);
+  }
+}
+
+TEST(CorrectionUnitTest, RunListNext) {
+  Qn::RunList runs({"run1", "run2", "run3"});
+  EXPECT_TRUE(runs.GetNext().empty());
+  runs.SetCurrentRun("run1");
+  EXPECT_EQ(runs.GetNext(), "run2");
+  runs.SetCurrentRun("run3");
+  EXPECT_TRUE(runs.GetNext().empty());
+  runs.SetCurrentRun("run4");
+  EXPECT_TRUE(runs.GetNext().empty());
+}
+
+namespace {
+constexpr int kNEquivalenceEvents = 300;
+enum EquivalenceVariables {
+  kEquivalencePhi,
+  kEquivalenceCentrality
+};
+
+/**
+ * Configures a tracking detector, which is recentered, twisted and rescaled in classes of centrality, such that
+ * three passes are needed to apply all corrections.
+ */
+void ConfigureEquivalence(Qn::CorrectionManager &manager) {
+  manager.SetFillCalibrationQA(true);
+  manager.SetFillValidationQA(true);
+  manager.AddVariable("phi", kEquivalencePhi, 1);
+  manager.AddVariable("centrality", kEquivalenceCentrality, 1);
+  manager.AddCorrectionAxis({"centrality", 5, 0., 100.});
+  manager.AddDetector("TEST", Qn::DetectorType::TRACK, "phi", "Ones", {}, {1, 2}, Qn::QVector::Normalization::M);
+  Qn::Recentering recentering;
+  recentering.SetApplyWidthEqualization(true);
+  manager.AddCorrectionOnQnVector("TEST", recentering);
+  Qn::TwistAndRescale twist;
+  twist.SetTwistAndRescaleMethod(Qn::TwistAndRescale::Method::DOUBLE_HARMONIC);
+  twist.SetApplyTwist(true);
+  twist.SetApplyRescale(true);
+  manager.AddCorrectionOnQnVector("TEST", twist);
+  manager.AddHisto1D("TEST", {"phi", 100, 0, 2*TMath::Pi()});
+  manager.AddEventHisto1D({"centrality", 20, 0., 100.});
+}
+
+/**
+ * Processes the events of a run. An event is generated from its number, such that the input does not depend on
+ * how the events are distributed.
+ * @param run index of the run
+ * @param first first processed event of the run
+ * @param step distance between the processed events
+ */
+void ProcessEquivalenceEvents(Qn::CorrectionManager &manager, int run, int first = 0, int step = 1) {
+  auto variables = manager.GetVariableContainer();
+  for (int i = first; i < kNEquivalenceEvents; i += step) {
+    std::mt19937 gen(run*kNEquivalenceEvents + i);
+    std::uniform_real_distribution<double> centrality(0., 100.);
+    std::uniform_real_distribution<double> phi(0., 2*TMath::Pi());
+    manager.Reset();
+    variables[kEquivalenceCentrality] = centrality(gen);
+    if (!manager.ProcessEvent()) continue;
+    const int n_tracks = 10 + i%20;
+    for (int j = 0; j < n_tracks; ++j) {
+      // the acceptance is not uniform, such that all corrections have an effect.
+      const auto angle = phi(gen);
+      variables[kEquivalencePhi] = angle + 0.3*std::sin(angle) + 0.1*std::sin(2*angle);
+      manager.FillTrackingDetectors();
+    }
+    manager.ProcessCorrections();
+  }
+}
+
+/**
+ * Processes a pass over the runs with one correction manager.
+ * @param input calibration input file. No input if empty.
+ */
+void ProcessEquivalencePass(Qn::CorrectionManager &manager, const std::vector<std::string> &runs,
+                            const std::string &input) {
+  ConfigureEquivalence(manager);
+  if (!input.empty()) manager.SetCalibrationInputFileName(input);
+  manager.InitializeOnNode();
+  for (std::size_t run = 0; run < runs.size(); ++run) {
+    manager.SetCurrentRunName(runs[run]);
+    ProcessEquivalenceEvents(manager, run);
+  }
+  manager.Finalize();
+}
+
+void WriteEquivalenceOutput(Qn::CorrectionManager &manager, const std::string &file_name) {
+  TFile file(file_name.data(), "RECREATE");
+  manager.GetCorrectionList()->Write("CorrectionHistograms", TObject::kSingleKey);
+  manager.GetCorrectionQAList()->Write("QA_histograms", TObject::kSingleKey);
+  file.Close();
+}
+
+/**
+ * Finds the n-th object with a name in a list.
+ */
+TObject *FindNthObject(TList *list, const std::string &name, int n) {
+  for (auto object : *list) {
+    if (name==object->GetName() && n--==0) return object;
+  }
+  return nullptr;
+}
+
+/**
+ * Expects the same histograms in two lists, which are compared by name and recursively. Objects with the same name
+ * are compared in the order of the lists. The tolerance allows for the single precision sums in a different order.
+ * @param skipped name of objects, which are not compared
+ */
+void ExpectEqualHistograms(TList *expected, TList *actual, const std::string &skipped = "") {
+  ASSERT_NE(actual, nullptr) << expected->GetName();
+  EXPECT_EQ(expected->GetSize(), actual->GetSize()) << expected->GetName();
+  auto expect_near = [](double value, double other, const char *name) {
+    EXPECT_NEAR(value, other, 1e-5*(1. + std::abs(value))) << name;
+  };
+  std::map<std::string, int> occurrences;
+  for (auto object : *expected) {
+    if (skipped==object->GetName()) continue;
+    auto other = FindNthObject(actual, object->GetName(), occurrences[object->GetName()]++);
+    ASSERT_NE(other, nullptr) << object->GetName();
+    if (auto list = dynamic_cast<TList *>(object)) {
+      ExpectEqualHistograms(list, dynamic_cast<TList *>(other), skipped);
+    } else if (auto histogram = dynamic_cast<THnBase *>(object)) {
+      auto other_histogram = dynamic_cast<THnBase *>(other);
+      ASSERT_NE(other_histogram, nullptr) << object->GetName();
+      ASSERT_EQ(histogram->GetNbins(), other_histogram->GetNbins()) << object->GetName();
+      expect_near(histogram->GetEntries(), other_histogram->GetEntries(), object->GetName());
+      for (Long64_t bin = 0; bin < histogram->GetNbins(); ++bin) {
+        expect_near(histogram->GetBinContent(bin), other_histogram->GetBinContent(bin), object->GetName());
+        expect_near(histogram->GetBinError2(bin), other_histogram->GetBinError2(bin), object->GetName());
+      }
+    } else if (auto histogram = dynamic_cast<TH1 *>(object)) {
+      auto other_histogram = dynamic_cast<TH1 *>(other);
+      ASSERT_NE(other_histogram, nullptr) << object->GetName();
+      ASSERT_EQ(histogram->GetNcells(), other_histogram->GetNcells()) << object->GetName();
+      expect_near(histogram->GetEntries(), other_histogram->GetEntries(), object->GetName());
+      for (Int_t bin = 0; bin < histogram->GetNcells(); ++bin) {
+        expect_near(histogram->GetBinContent(bin), other_histogram->GetBinContent(bin), object->GetName());
+        expect_near(histogram->GetBinError(bin), other_histogram->GetBinError(bin), object->GetName());
+      }
+    }
+  }
+}
+}
+
+TEST(CorrectionUnitTest, ReplayEqualsPasses) {
+  const std::vector<std::string> runs{"run1", "run2"};
+  Qn::CorrectionManager first;
+  ProcessEquivalencePass(first, runs, "");
+  WriteEquivalenceOutput(first, "replay_pass1.root");
+  Qn::CorrectionManager second;
+  ProcessEquivalencePass(second, runs, "replay_pass1.root");
+  EXPECT_FALSE(second.IsCalibrated());
+  WriteEquivalenceOutput(second, "replay_pass2.root");
+  Qn::CorrectionManager third;
+  ProcessEquivalencePass(third, runs, "replay_pass2.root");
+  EXPECT_TRUE(third.IsCalibrated());
+  for (const std::string spill_file : {"", "replay_spill.bin"}) {
+    Qn::CorrectionManager replay;
+    replay.SetRecordEvents(spill_file);
+    ProcessEquivalencePass(replay, runs, "");
+    EXPECT_EQ(replay.ReplayRecordedEvents(), 2);
+    EXPECT_TRUE(replay.IsCalibrated());
+    ExpectEqualHistograms(third.GetCorrectionList(), replay.GetCorrectionList());
+    ExpectEqualHistograms(third.GetCorrectionQAList(), replay.GetCorrectionQAList());
+  }
+}
+
+TEST(CorrectionUnitTest, SlotsEqualSerial) {
+  constexpr unsigned int kNSlots = 3;
+  const std::vector<std::string> runs{"run1", "run2"};
+  // the second pass applies the recentering from the calibration input shared by the slots.
+  for (const std::string input : {"", "slots_pass1.root"}) {
+    Qn::CorrectionManager serial;
+    ProcessEquivalencePass(serial, runs, input);
+    Qn::CorrectionManager slotted;
+    ConfigureEquivalence(slotted);
+    if (!input.empty()) slotted.SetCalibrationInputFileName(input);
+    slotted.SetNumberOfSlots(kNSlots, ConfigureEquivalence);
+    slotted.InitializeOnNode();
+    for (std::size_t run = 0; run < runs.size(); ++run) {
+      slotted.SetCurrentRunName(runs[run]);
+      std::vector<std::thread> threads;
+      for (unsigned int slot = 0; slot < kNSlots; ++slot) {
+        threads.emplace_back([&slotted, run, slot]() {
+          ProcessEquivalenceEvents(slotted.GetSlot(slot), run, slot, kNSlots);
+        });
+      }
+      for (auto &thread : threads) thread.join();
+    }
+    slotted.Finalize();
+    ExpectEqualHistograms(serial.GetCorrectionList(), slotted.GetCorrectionList());
+    ExpectEqualHistograms(serial.GetCorrectionQAList(), slotted.GetCorrectionQAList());
+    if (input.empty()) WriteEquivalenceOutput(serial, "slots_pass1.root");
+  }
+}
+
+TEST(CorrectionUnitTest, ProcessRunsEqualsSequential) {
+  const std::vector<std::string> runs{"run1", "run2", "run3"};
+  std::vector<Qn::CorrectionManager::RunInput> run_inputs;
+  for (const auto &run : runs) run_inputs.push_back({run, {}});
+  // the second pass applies the recentering from the calibration input shared by the runs.
+  for (const std::string input : {"", "runs_pass1.root"}) {
+    Qn::CorrectionManager sequential;
+    ProcessEquivalencePass(sequential, runs, input);
+    Qn::CorrectionManager concurrent;
+    ConfigureEquivalence(concurrent);
+    if (!input.empty()) concurrent.SetCalibrationInputFileName(input);
+    concurrent.InitializeOnNode();
+    concurrent.ProcessRuns(run_inputs, 2, ConfigureEquivalence,
+                           [&runs](Qn::CorrectionManager &manager, const Qn::CorrectionManager::RunInput &run) {
+                             const auto index = std::find(runs.begin(), runs.end(), run.name) - runs.begin();
+                             ProcessEquivalenceEvents(manager, index);
+                           });
+    ExpectEqualHistograms(sequential.GetCorrectionList(), concurrent.GetCorrectionList());
+    ExpectEqualHistograms(sequential.GetCorrectionQAList(), concurrent.GetCorrectionQAList());
+    if (input.empty()) WriteEquivalenceOutput(sequential, "runs_pass1.root");
+  }
+}
+
+TEST(CorrectionUnitTest, CalibrationCache) {
+  const std::string directory = "calibration_cache_test";
+  std::filesystem::remove_all(directory);
+  const std::vector<std::string> runs{"run1", "run2"};
+  auto configure_cut = [](double high) {
+    return [high](Qn::CorrectionManager &manager) {
+      ConfigureEquivalence(manager);
+      manager.AddRangeCutOnDetector("TEST", "phi", 0., high, "phi");
+    };
+  };
+  auto key = [](const std::function<void(Qn::CorrectionManager &)> &configuration,
+                const std::vector<std::string> &dataset_ids) {
+    Qn::CorrectionManager manager;
+    configuration(manager);
+    manager.SetCalibrationCache("", dataset_ids);
+    manager.InitializeOnNode();
+    std::ostringstream stream;
+    manager.WriteConfiguration(stream);
+    return Qn::CorrectionCalibrationCache::Hash(stream.str());
+  };
+  EXPECT_EQ(key(ConfigureEquivalence, {"data"}), key(ConfigureEquivalence, {"data"}));
+  EXPECT_NE(key(ConfigureEquivalence, {"data"}), key(ConfigureEquivalence, {"other"}));
+  EXPECT_NE(key(configure_cut(6.), {"data"}), key(configure_cut(6.2), {"data"}));
+  // each production with the cache takes the calibration input of the previous production.
+  auto produce = [&](Qn::CorrectionManager &manager, const std::function<void(Qn::CorrectionManager &)> &configuration,
+                     const std::string &dataset_id) {
+    configuration(manager);
+    manager.SetCalibrationCache(directory, {dataset_id});
+    manager.InitializeOnNode();
+    bool calibrated = true;
+    for (std::size_t run = 0; run < runs.size(); ++run) {
+      manager.SetCurrentRunName(runs[run]);
+      calibrated = calibrated && manager.IsCalibrated();
+      ProcessEquivalenceEvents(manager, run);
+    }
+    manager.Finalize();
+    return calibrated;
+  };
+  Qn::CorrectionManager first;
+  ProcessEquivalencePass(first, runs, "");
+  WriteEquivalenceOutput(first, "cache_pass1.root");
+  Qn::CorrectionManager second;
+  ProcessEquivalencePass(second, runs, "cache_pass1.root");
+  WriteEquivalenceOutput(second, "cache_pass2.root");
+  Qn::CorrectionManager third;
+  ProcessEquivalencePass(third, runs, "cache_pass2.root");
+  for (int production = 0; production < 3; ++production) {
+    Qn::CorrectionManager cached;
+    EXPECT_EQ(produce(cached, ConfigureEquivalence, "data"), production==2) << production;
+    auto &expected = production==0 ? first : production==1 ? second : third;
+    ExpectEqualHistograms(expected.GetCorrectionList(), cached.GetCorrectionList());
+  }
+  // a production with another configuration or other input data does not find the calibration input.
+  Qn::CorrectionManager other_data;
+  EXPECT_FALSE(produce(other_data, ConfigureEquivalence, "other"));
+  ExpectEqualHistograms(first.GetCorrectionList(), other_data.GetCorrectionList());
+  Qn::CorrectionManager other_configuration;
+  EXPECT_FALSE(produce(other_configuration, configure_cut(2*TMath::Pi()), "data"));
+  EXPECT_EQ(other_configuration.GetCorrectionList()->GetSize(), first.GetCorrectionList()->GetSize());
+  std::filesystem::remove_all(directory);
+}
+
+TEST(CorrectionUnitTest, MergeCalibrationInputs) {
+  const std::vector<std::string> runs{"run1", "run2"};
+  Qn::CorrectionManager reference;
+  ProcessEquivalencePass(reference, runs, "");
+  WriteEquivalenceOutput(reference, "merge_reference.root");
+  // the first job processes half of the first run and the second run, the second job the other half of the first run.
+  Qn::CorrectionManager first_job;
+  ConfigureEquivalence(first_job);
+  first_job.InitializeOnNode();
+  first_job.SetCurrentRunName("run1");
+  ProcessEquivalenceEvents(first_job, 0, 0, 2);
+  first_job.SetCurrentRunName("run2");
+  ProcessEquivalenceEvents(first_job, 1);
+  first_job.Finalize();
+  WriteEquivalenceOutput(first_job, "merge_job1.root");
+  Qn::CorrectionManager second_job;
+  ConfigureEquivalence(second_job);
+  second_job.InitializeOnNode();
+  second_job.SetCurrentRunName("run1");
+  ProcessEquivalenceEvents(second_job, 0, 1, 2);
+  second_job.Finalize();
+  WriteEquivalenceOutput(second_job, "merge_job2.root");
+  Qn::CorrectionManager merged;
+  ConfigureEquivalence(merged);
+  merged.MergeCalibrationInputs({"merge_job1.root", "merge_job2.root"}, 2, "merge_merged.root");
+  {
+    TFile file("merge_merged.root", "READ");
+    std::unique_ptr<TList> corrections(dynamic_cast<TList *>(file.Get("CorrectionHistograms")));
+    std::unique_ptr<TList> qa(dynamic_cast<TList *>(file.Get("QA_histograms")));
+    ASSERT_NE(corrections, nullptr);
+    // the list of all runs of a job is a copy of its last run and is not merged by run.
+    ExpectEqualHistograms(reference.GetCorrectionList(), corrections.get(), "all");
+    ASSERT_NE(qa, nullptr);
+    ExpectEqualHistograms(reference.GetCorrectionQAList(), qa.get());
+  }
+  // the merged input is applied like the input of the single job.
+  merged.InitializeOnNode();
+  for (std::size_t run = 0; run < runs.size(); ++run) {
+    merged.SetCurrentRunName(runs[run]);
+    ProcessEquivalenceEvents(merged, run);
+  }
+  merged.Finalize();
+  Qn::CorrectionManager applied;
+  ProcessEquivalencePass(applied, runs, "merge_reference.root");
+  ExpectEqualHistograms(applied.GetCorrectionList(), merged.GetCorrectionList());
+  ExpectEqualHistograms(applied.GetCorrectionQAList(), merged.GetCorrectionQAList());
+}
+
+TEST(CorrectionUnitTest, CollectionConvergence) {
+  // the events with the same tracks give the same averages at every check, random tracks change them.
+  auto configure = [](Qn::CorrectionManager &manager, double tolerance) {
+    manager.AddVariable("phi", kEquivalencePhi, 1);
+    manager.AddVariable("centrality", kEquivalenceCentrality, 1);
+    manager.AddCorrectionAxis({"centrality", 1, 0., 100.});
+    manager.AddDetector("TEST", Qn::DetectorType::TRACK, "phi", "Ones", {}, {1, 2}, Qn::QVector::Normalization::M);
+    Qn::Recentering recentering;
+    recentering.SetConvergenceCheck(50, tolerance);
+    manager.AddCorrectionOnQnVector("TEST", recentering);
+    manager.InitializeOnNode();
+    manager.SetCurrentRunName("run1");
+  };
+  std::mt19937 gen(5);
+  std::uniform_real_distribution<double> phi(0., 2*TMath::Pi());
+  auto process = [&gen, &phi](Qn::CorrectionManager &manager, bool random) {
+    auto variables = manager.GetVariableContainer();
+    manager.Reset();
+    variables[kEquivalenceCentrality] = 50.;
+    if (!manager.ProcessEvent()) return;
+    for (const double angle : {0.3, 1.2, 2.5}) {
+      variables[kEquivalencePhi] = random ? phi(gen) : angle;
+      manager.FillTrackingDetectors();
+    }
+    manager.ProcessCorrections();
+  };
+  Qn::CorrectionManager constant;
+  configure(constant, 1e-3);
+  Qn::CorrectionManager collected;
+  configure(collected, 1e-3);
+  Qn::CorrectionManager random;
+  configure(random, 0.);
+  // the first check records the averages, the second finds them unchanged.
+  for (int event = 1; event <= 300; ++event) {
+    process(constant, false);
+    if (event < 100) process(collected, false);
+    process(random, true);
+    EXPECT_EQ(constant.IsCollectionConverged(), event >= 100) << event;
+    EXPECT_FALSE(random.IsCollectionConverged()) << event;
+  }
+  // the converged manager stopped filling its calibration histograms, starting with the event of the second check.
+  constant.Finalize();
+  collected.Finalize();
+  ExpectEqualHistograms(collected.GetCorrectionList(), constant.GetCorrectionList());
+  // the check restarts with the histograms of a new run.
+  Qn::CorrectionManager restarted;
+  configure(restarted, 1e-3);
+  for (int event = 0; event < 100; ++event) process(restarted, false);
+  EXPECT_TRUE(restarted.IsCollectionConverged());
+  restarted.SetCurrentRunName("run2");
+  EXPECT_FALSE(restarted.IsCollectionConverged());
+}
+
+namespace {
+/**
+ * Finds an object by name in a list and its sub lists.
+ */
+TObject *FindObjectRecursive(TList *list, const std::string &name) {
+  for (auto object : *list) {
+    if (name==object->GetName()) return object;
+    if (auto sub_list = dynamic_cast<TList *>(object)) {
+      if (auto found = FindObjectRecursive(sub_list, name)) return found;
+    }
+  }
+  return nullptr;
+}
+}
+
+TEST(CorrectionUnitTest, OnlineRecentering) {
+  constexpr int kWarmUp = 5;
+  constexpr int kNClasses = 2;
+  const std::vector<int> harmonics{1, 2};
+  auto configure = [](Qn::CorrectionManager &manager, int warm_up) {
+    manager.SetFillCalibrationQA(true);
+    manager.AddVariable("phi", kEquivalencePhi, 1);
+    manager.AddVariable("centrality", kEquivalenceCentrality, 1);
+    manager.AddCorrectionAxis({"centrality", kNClasses, 0., 100.});
+    manager.AddDetector("TEST", Qn::DetectorType::TRACK, "phi", "Ones", {}, {1, 2}, Qn::QVector::Normalization::M);
+    Qn::Recentering recentering;
+    recentering.SetOnlineMode(warm_up);
+    manager.AddCorrectionOnQnVector("TEST", recentering);
+    manager.InitializeOnNode();
+    manager.SetCurrentRunName("run1");
+  };
+  Qn::CorrectionManager online;
+  configure(online, kWarmUp);
+  Qn::CorrectionManager offline;
+  configure(offline, 0);
+  // running sums of the plain Q-vectors of the previous events and sums of the expected corrected Q-vectors of each
+  // event class and harmonic.
+  std::vector<std::vector<double>> previous(kNClasses, std::vector<double>(4));
+  std::vector<std::vector<double>> corrected(kNClasses, std::vector<double>(4));
+  std::vector<int> n_previous(kNClasses);
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<double> phi(0., 2*TMath::Pi());
+  for (int event = 0; event < 200; ++event) {
+    const int event_class = (event*7)%3==0 ? 1 : 0;
+    std::vector<double> angles(5 + event%10);
+    for (auto &angle : angles) angle = phi(gen) + 0.4*std::sin(phi(gen));
+    for (auto manager : {&online, &offline}) {
+      auto variables = manager->GetVariableContainer();
+      manager->Reset();
+      variables[kEquivalenceCentrality] = 25. + 50.*event_class;
+      ASSERT_TRUE(manager->ProcessEvent());
+      for (const auto angle : angles) {
+        variables[kEquivalencePhi] = angle;
+        manager->FillTrackingDetectors();
+      }
+      manager->ProcessCorrections();
+    }
+    const auto &plain = online.GetQVector("TEST_PLAIN")->At(0);
+    ASSERT_TRUE(plain.IsGoodQuality());
+    // the averages of the class are applied after the warm-up and do not contain the current event.
+    auto &sums = previous[event_class];
+    for (std::size_t i = 0; i < harmonics.size(); ++i) {
+      const double q[2] = {plain.x(harmonics[i]), plain.y(harmonics[i])};
+      for (int component = 0; component < 2; ++component) {
+        if (n_previous[event_class] >= kWarmUp) {
+          corrected[event_class][2*i + component] += q[component] - sums[2*i + component]/n_previous[event_class];
+        }
+        sums[2*i + component] += q[component];
+      }
+    }
+    ++n_previous[event_class];
+  }
+  online.Finalize();
+  offline.Finalize();
+  // the online mode collects the same calibration histograms.
+  ExpectEqualHistograms(offline.GetCorrectionList(), online.GetCorrectionList());
+  // the corrected Q-vectors of the events after the warm-up are summed in the QA histograms.
+  const std::string name = "Rec Qn avg _TEST";
+  for (auto manager : {&online, &offline}) {
+    auto entries = dynamic_cast<THnBase *>(FindObjectRecursive(manager->GetCorrectionQAList(), name + "XY_entries"));
+    ASSERT_NE(entries, nullptr);
+    for (int event_class = 0; event_class < kNClasses; ++event_class) {
+      const double centrality = 25. + 50.*event_class;
+      const auto bin = entries->GetBin(&centrality);
+      const double n_corrected = manager==&online ? n_previous[event_class] - kWarmUp : 0.;
+      EXPECT_EQ(entries->GetBinContent(bin), n_corrected) << event_class;
+      for (std::size_t i = 0; i < harmonics.size(); ++i) {
+        for (int component = 0; component < 2; ++component) {
+          const auto histogram_name = name + (component==0 ? "X" : "Y") + "_h" + std::to_string(harmonics[i]);
+          auto histogram = dynamic_cast<THnBase *>(FindObjectRecursive(manager->GetCorrectionQAList(), histogram_name));
+          ASSERT_NE(histogram, nullptr) << histogram_name;
+          const double expected = manager==&online ? corrected[event_class][2*i + component] : 0.;
+          EXPECT_NEAR(histogram->GetBinContent(bin), expected, 1e-5) << histogram_name << " " << event_class;
+        }
+      }
+    }
+  }
+}
+
+TEST(CorrectionUnitTest, EventTrace) {
+  Qn::EventTrace trace(2, 3);
+  EXPECT_TRUE(trace.IsSampled(0));
+  EXPECT_TRUE(!trace.IsSampled(1));
+  const auto correct = trace.AddName("correct");
+  EXPECT_EQ(trace.AddName("fill \"tree\""), 1u);
+  EXPECT_EQ(trace.AddName("correct"), correct);
+  const auto start = Qn::EventTrace::Clock::now();
+  for (int i = 0; i < 5; ++i) trace.Record(correct, start, start + std::chrono::microseconds(i));
+  { Qn::EventTrace::Scope scope(&trace, 1); }
+  // the ring keeps the latest spans of the thread.
+  EXPECT_EQ(trace.GetNumberOfSpans(), 3u);
+  std::ostringstream stream;
+  trace.Write(stream);
+  const auto json = stream.str();
+  EXPECT_TRUE(json.find("\"dur\":4.000") != std::string::npos);
+  EXPECT_TRUE(json.find("\"dur\":1.000") == std::string::npos);
+  EXPECT_TRUE(json.find("fill \\\"tree\\\"") != std::string::npos);
+}
+
+namespace {
+/**
+ * Tree, which fails to fill the entries after the first ones.
+ */
+class FailingTree : public TTree {
+ public:
+  explicit FailingTree(Long64_t n_filled) : n_filled_(n_filled) {}
+  Int_t Fill() override { return GetEntries() < n_filled_ ? TTree::Fill() : -1; }
+ private:
+  Long64_t n_filled_;
+};
+
+/**
+ * Reads the event variable and the Q-vectors of all entries of the tree.
+ */
+std::vector<std::vector<double>> ReadTreeWriterEntries(TTree &tree, bool flat, std::size_t n_bins) {
+  double variable = 0.;
+  Qn::DataContainerQVector *q_vectors = nullptr;
+  std::vector<float> x(2*n_bins), y(2*n_bins), sumw(n_bins);
+  std::vector<int> n(n_bins);
+  std::vector<unsigned char> quality(n_bins);
+  tree.SetBranchAddress("variable", &variable);
+  if (flat) {
+    tree.SetBranchAddress("q_x", x.data());
+    tree.SetBranchAddress("q_y", y.data());
+    tree.SetBranchAddress("q_n", n.data());
+    tree.SetBranchAddress("q_sumw", sumw.data());
+    tree.SetBranchAddress("q_quality", quality.data());
+  } else {
+    tree.SetBranchAddress("q", &q_vectors);
+  }
+  std::vector<std::vector<double>> entries;
+  for (Long64_t ientry = 0; ientry < tree.GetEntries(); ++ientry) {
+    tree.GetEntry(ientry);
+    std::vector<double> entry{variable};
+    for (std::size_t ibin = 0; ibin < n_bins; ++ibin) {
+      if (flat) {
+        entry.insert(entry.end(), {x[2*ibin], y[2*ibin], x[2*ibin + 1], y[2*ibin + 1]});
+        entry.insert(entry.end(), {static_cast<double>(n[ibin]), sumw[ibin], static_cast<double>(quality[ibin])});
+      } else {
+        const auto &q = q_vectors->At(ibin);
+        entry.insert(entry.end(), {q.x(2), q.y(2), q.x(3), q.y(3)});
+        entry.insert(entry.end(), {static_cast<double>(q.n()), q.sumweights(), q.IsGoodQuality() ? 1. : 0.});
+      }
+    }
+    entries.push_back(entry);
+  }
+  tree.ResetBranchAddresses();
+  delete q_vectors;
+  return entries;
+}
+}
+
+TEST(CorrectionUnitTest, AsynchronousTreeWriter) {
+  constexpr int kNEvents = 20;
+  const std::bitset<Qn::QVector::kmaxharmonics> harmonics("00000110");
+  Qn::DataContainerQVector q_vectors;
+  q_vectors.AddAxis({"pt", 3, 0., 1.});
+  for (auto &q : q_vectors) q = Qn::QVector(harmonics, Qn::QVector::CorrectionStep::PLAIN);
+  double variable = 0.;
+  auto process = [&](Qn::CorrectionTreeWriter &writer, TTree &tree, unsigned int n_buffers, bool flat) {
+    writer.SetAsynchronous(n_buffers);
+    writer.SetFlatQVectors(flat);
+    writer.Connect(&tree);
+    writer.Branch("variable", &variable);
+    writer.BranchQVectors("q", &q_vectors);
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<> component(-1., 1.);
+    for (int ievent = 0; ievent < kNEvents; ++ievent) {
+      variable = ievent;
+      for (std::size_t ibin = 0; ibin < q_vectors.size(); ++ibin) {
+        auto &q = q_vectors[ibin];
+        for (unsigned int h = 2; h <= 3; ++h) {
+          q.SetX(h, component(gen));
+          q.SetY(h, component(gen));
+        }
+        q.SetNumberOfContributors(ievent + ibin, 0.5*ievent, ievent%3!=0);
+      }
+      writer.Fill();
+      if (ievent==kNEvents/2) {
+        writer.Flush();
+        EXPECT_EQ(tree.GetEntries(), ievent + 1);
+      }
+    }
+  };
+  for (auto flat : {false, true}) {
+    TTree synchronous("synchronous", "");
+    Qn::CorrectionTreeWriter synchronous_writer;
+    process(synchronous_writer, synchronous, 0, flat);
+    synchronous_writer.Finish();
+    // the branches refer to the output objects, which cannot be buffered afterwards.
+    EXPECT_THROW(synchronous_writer.SetAsynchronous(2), std::logic_error);
+    const auto expected = ReadTreeWriterEntries(synchronous, flat, q_vectors.size());
+    ASSERT_EQ(expected.size(), static_cast<std::size_t>(kNEvents));
+    for (unsigned int n_buffers : {1u, 2u, 5u}) {
+      TTree asynchronous("asynchronous", "");
+      Qn::CorrectionTreeWriter asynchronous_writer;
+      process(asynchronous_writer, asynchronous, n_buffers, flat);
+      asynchronous_writer.Finish();
+      EXPECT_EQ(ReadTreeWriterEntries(asynchronous, flat, q_vectors.size()), expected) << n_buffers;
+    }
+  }
+  // a failure of the writer thread is reported by the next Fill or by Finish.
+  FailingTree failing(3);
+  Qn::CorrectionTreeWriter failing_writer;
+  failing_writer.SetAsynchronous(2);
+  failing_writer.Connect(&failing);
+  failing_writer.Branch("variable", &variable);
+  for (int ievent = 0; ievent < kNEvents; ++ievent) {
+    try {
+      failing_writer.Fill();
+    } catch (const std::runtime_error &) {
+      break;
+    }
+  }
+  EXPECT_THROW(failing_writer.Finish(), std::runtime_error);
+  EXPECT_NO_THROW(failing_writer.Finish());
+  EXPECT_EQ(failing.GetEntries(), 3);
+}
+
+TEST(CorrectionUnitTest, FlatQVectorRoundTrip) {
+  constexpr int kNEvents = 12;
+  const std::bitset<Qn::QVector::kmaxharmonics> harmonics("00001010");
+  Qn::DataContainerQVector q_vectors;
+  q_vectors.AddAxes({{"pt", 3, 0., 1.}, {"eta", 2, -1., 1.}});
+  for (auto &q : q_vectors) q = Qn::QVector(harmonics, Qn::QVector::CorrectionStep::RECENTERED);
+  const std::vector<Qn::FlatQVectors::Encoding> encodings{{}, Qn::FlatQVectors::Encoding::Truncated(10),
+                                                          Qn::FlatQVectors::Encoding::FixedPoint(2.)};
+  for (const auto &encoding : encodings) {
+    TTree tree("flat", "");
+    Qn::CorrectionTreeWriter writer;
+    writer.SetFlatQVectors(true);
+    writer.SetQVectorEncoding(encoding);
+    writer.Connect(&tree);
+    writer.BranchQVectors("TEST_RECENTERED", &q_vectors);
+    std::mt19937 gen(9);
+    std::uniform_real_distribution<> component(-1.5, 1.5);
+    std::vector<Qn::DataContainerQVector> written;
+    for (int ievent = 0; ievent < kNEvents; ++ievent) {
+      for (std::size_t ibin = 0; ibin < q_vectors.size(); ++ibin) {
+        auto &q = q_vectors[ibin];
+        for (unsigned int h : {2u, 4u}) {
+          q.SetX(h, component(gen));
+          q.SetY(h, component(gen));
+        }
+        q.SetNumberOfContributors(ievent + ibin, 0.25*ievent + ibin, (ievent + ibin)%3!=0);
+      }
+      writer.Fill();
+      written.push_back(q_vectors);
+    }
+    writer.Finish();
+    // the reader restores the layout from the user info of the tree and the Q-vectors of each entry.
+    TTreeReader reader(&tree);
+    Qn::Correlation::FlatQVectorReader flat(reader, "TEST_RECENTERED");
+    EXPECT_EQ(flat.GetEncoding().ToString(), encoding.ToString());
+    ASSERT_EQ(flat.size(), q_vectors.size());
+    const auto &layout = flat.GetLayout();
+    ASSERT_EQ(layout.GetAxes().size(), 2u);
+    for (std::size_t iaxis = 0; iaxis < 2; ++iaxis) {
+      EXPECT_EQ(layout.GetAxes()[iaxis].Name(), q_vectors.GetAxes()[iaxis].Name());
+      EXPECT_EQ(layout.GetAxes()[iaxis].size(), q_vectors.GetAxes()[iaxis].size());
+    }
+    EXPECT_EQ(layout.At(0).GetHarmonics(), harmonics);
+    const auto error_bound = encoding.GetErrorBound();
+    auto tolerance = [&encoding, error_bound](double value) {
+      return encoding.method==Qn::FlatQVectors::Encoding::Method::kFixedPoint ? error_bound + 1e-6
+                                                                                : error_bound*std::abs(value) + 1e-7;
+    };
+    int ievent = 0;
+    while (reader.Next()) {
+      ASSERT_LT(ievent, kNEvents);
+      const auto &expected = written[ievent];
+      const auto &restored = flat.Get();
+      for (std::size_t ibin = 0; ibin < expected.size(); ++ibin) {
+        const auto &q = expected[ibin];
+        const auto view = flat.View(ibin);
+        EXPECT_EQ(restored[ibin].n(), q.n());
+        EXPECT_FLOAT_EQ(restored[ibin].sumweights(), q.sumweights());
+        EXPECT_EQ(restored[ibin].IsGoodQuality(), q.IsGoodQuality());
+        EXPECT_EQ(view.n(), q.n());
+        EXPECT_FLOAT_EQ(view.sumweights(), q.sumweights());
+        EXPECT_EQ(view.IsGoodQuality(), q.IsGoodQuality());
+        for (unsigned int h : {2u, 4u}) {
+          EXPECT_NEAR(restored[ibin].x(h), q.x(h), tolerance(q.x(h))) << ievent << " " << ibin << " " << h;
+          EXPECT_NEAR(restored[ibin].y(h), q.y(h), tolerance(q.y(h))) << ievent << " " << ibin << " " << h;
+          EXPECT_EQ(view.x(h), restored[ibin].x(h));
+          EXPECT_EQ(view.y(h), restored[ibin].y(h));
+        }
+      }
+      ++ievent;
+    }
+    EXPECT_EQ(ievent, kNEvents);
+  }
+}
+
+TEST(CorrectionUnitTest, CalibrationFileRoundTrip) {
+  // the tables are found by the run, the sub event and the step and refer to the parameters in the mapped file.
+  const std::vector<int> keys{1, 2, 4};
+  const std::vector<std::pair<std::string, std::string>> sub_events{{"run1", "tpc"}, {"run1", "fwd"}, {"run2", "tpc"}};
+  std::vector<Qn::CorrectionParameterTable> tables(sub_events.size());
+  for (std::size_t itable = 0; itable < tables.size(); ++itable) {
+    auto &table = tables[itable];
+    table.Initialize(5 + itable, keys, 2);
+    for (long long bin = 0; bin < table.GetNumberOfBins(); ++bin) {
+      for (auto key : keys) {
+        table.SetValidated(bin, key, (bin + key)%3!=0);
+        table.EditParameters(bin, key)[0] = 100.*itable + 10.*bin + key;
+        table.EditParameters(bin, key)[1] = -0.5*key;
+      }
+    }
+  }
+  {
+    Qn::CorrectionCalibrationWriter writer("calibration_test.qncalib");
+    for (std::size_t itable = 0; itable < tables.size(); ++itable) {
+      writer.Add(sub_events[itable].first, sub_events[itable].second, "recentering", tables[itable]);
+    }
+    writer.Add("run2", "fwd", "recentering", Qn::CorrectionParameterTable());
+    writer.Close();
+  }
+  Qn::CorrectionCalibrationFile file;
+  file.Open("calibration_test.qncalib");
+  ASSERT_TRUE(file.IsOpen());
+  EXPECT_THROW(file.Open("calibration_test.qncalib"), std::logic_error);
+  EXPECT_TRUE(file.HasRun("run1"));
+  EXPECT_TRUE(file.HasRun("run2"));
+  EXPECT_FALSE(file.HasRun("run3"));
+  EXPECT_TRUE(file.HasSubEvent("run1", "fwd"));
+  EXPECT_FALSE(file.HasSubEvent("run2", "fwd"));
+  EXPECT_FALSE(file.Find("run1", "tpc", "twist").IsInitialized());
+  EXPECT_FALSE(file.Find("run2", "fwd", "recentering").IsInitialized());
+  for (std::size_t itable = 0; itable < tables.size(); ++itable) {
+    const auto &expected = tables[itable];
+    const auto table = file.Find(sub_events[itable].first, sub_events[itable].second, "recentering");
+    ASSERT_TRUE(table.Matches(expected.GetNumberOfBins(), keys, 2));
+    EXPECT_EQ(table.GetKeys(), keys);
+    for (long long bin = 0; bin < table.GetNumberOfBins(); ++bin) {
+      for (auto key : keys) {
+        EXPECT_EQ(table.IsValidated(bin, key), expected.IsValidated(bin, key));
+        EXPECT_EQ(table.GetParameters(bin, key)[0], expected.GetParameters(bin, key)[0]);
+        EXPECT_EQ(table.GetParameters(bin, key)[1], expected.GetParameters(bin, key)[1]);
+      }
+    }
+  }
+  // an invalid file is not kept open, such that a valid file is opened afterwards.
+  {
+    std::FILE *invalid = std::fopen("calibration_invalid.qncalib", "wb");
+    const std::vector<char> garbage(64, 'x');
+    std::fwrite(garbage.data(), 1, garbage.size(), invalid);
+    std::fclose(invalid);
+  }
+  Qn::CorrectionCalibrationFile reopened;
+  EXPECT_THROW(reopened.Open("calibration_invalid.qncalib"), std::runtime_error);
+  EXPECT_FALSE(reopened.IsOpen());
+  EXPECT_THROW(reopened.Open("calibration_missing.qncalib"), std::runtime_error);
+  reopened.Open("calibration_test.qncalib");
+  EXPECT_TRUE(reopened.IsOpen());
+  EXPECT_TRUE(reopened.Find("run2", "tpc", "recentering").IsInitialized());
+  std::remove("calibration_test.qncalib");
+  std::remove("calibration_invalid.qncalib");
+}
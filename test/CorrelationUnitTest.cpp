@@ -1,70 +1,587 @@
+//
 // Created by Lukas Kreis on 30.01.18.
 //
 
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <vector>
 #include "Correlation.h"
+#include "CorrelationHelper.h"
+#include "CorrelationSet.h"
 #include "DataContainer.h"
+#include "GenericFramework.h"
+
+namespace {
+template<std::size_t N>
+using Inputs = decltype(std::tuple_cat(std::declval<std::array<Qn::DataContainerQVector, N>>()));
+template<std::size_t N>
+using QVectors = decltype(std::tuple_cat(std::declval<std::array<Qn::QVector, N>>()));
+
+auto two_inputs = [](const Qn::QVector &a, const Qn::QVector &b) { return a.x(1) + b.x(1); };
+auto three_inputs = [](const Qn::QVector &a, const Qn::QVector &b, const Qn::QVector &c) {
+  return a.x(1) + b.x(1) + c.x(1);
+};
+
+Qn::DataContainerQVector MakeInput(std::vector<Qn::AxisD> axes) {
+  Qn::DataContainerQVector container;
+  container.AddAxes(axes);
+  for (auto &bin : container) {
+    bin = Qn::QVector(std::bitset<Qn::QVector::kmaxharmonics>(1), Qn::QVector::CorrectionStep::PLAIN);
+    bin.SetX(1, 1.);
+    bin.SetNumberOfContributors(1, 1., true);
+  }
+  return container;
+}
+
+struct Particle {
+  double phi;
+  double weight;
+};
+
+/**
+ * Sums the weighted correlations over all ordered tuples of distinct particles.
+ * @param numerator sum of the products of the weights times the cosine of the sum of the harmonics
+ * @param denominator sum of the products of the weights
+ */
+void BruteForceSums(const std::vector<Particle> &particles, const std::vector<int> &harmonics,
+                    std::vector<std::size_t> &tuple, double &numerator, double &denominator) {
+  if (tuple.size()==harmonics.size()) {
+    double product = 1.;
+    double angle = 0.;
+    for (std::size_t i = 0; i < tuple.size(); ++i) {
+      product *= particles[tuple[i]].weight;
+      angle += harmonics[i]*particles[tuple[i]].phi;
+    }
+    numerator += product*std::cos(angle);
+    denominator += product;
+    return;
+  }
+  for (std::size_t i = 0; i < particles.size(); ++i) {
+    if (std::find(tuple.begin(), tuple.end(), i)!=tuple.end()) continue;
+    tuple.push_back(i);
+    BruteForceSums(particles, harmonics, tuple, numerator, denominator);
+    tuple.pop_back();
+  }
+}
+
+Qn::CorrelationResult BruteForceCorrelation(const std::vector<Particle> &particles, const std::vector<int> &harmonics) {
+  std::vector<std::size_t> tuple;
+  double numerator = 0.;
+  double denominator = 0.;
+  BruteForceSums(particles, harmonics, tuple, numerator, denominator);
+  return {numerator/denominator, true, denominator};
+}
+
+std::vector<Particle> MakeEvent(std::mt19937 &engine, std::size_t n) {
+  std::uniform_real_distribution<double> phi(-M_PI, M_PI);
+  std::uniform_real_distribution<double> weight(0.5, 1.5);
+  std::vector<Particle> particles(n);
+  for (auto &particle : particles) particle = {phi(engine), weight(engine)};
+  return particles;
+}
+
+Qn::QVectorGF MakeQVectorGF(const std::vector<Particle> &particles) {
+  Qn::QVectorGF q(16, 8);
+  for (const auto &particle : particles) q.Add(particle.phi, particle.weight);
+  return q;
+}
+}
 
 TEST(CorrelationTest, ConfigSameDetSameAxis) {
-  auto lambda = [](const std::vector<Qn::QVectorPtr>& q) {return q[0].x(1) + q[1].x(1);};
-  Qn::Correlation correlation("test",{"A","A","B"},lambda,{Qn::Weight::OBSERVABLE, Qn::Weight::REFERENCE});
-  auto mappy = new std::map<std::string, Qn::DataContainerQVector*>;
-  auto conta = new Qn::DataContainerQVector();
-  conta->AddAxes({{"a",10,0,10}});
-  mappy->emplace("A",conta);
-  auto contb = new Qn::DataContainerQVector();
-  contb->AddAxes({{"b",10,0,10}});
-  mappy->emplace("B",contb);
-  std::vector<Qn::AxisF> eventaxes = {{"Ev",10,0,10}};
-  correlation.Configure(mappy, eventaxes);
-  auto axes = correlation.GetResult().GetAxes();
-  EXPECT_STREQ(axes[0].Name().data(), "Ev");
-  EXPECT_STREQ(axes[1].Name().data(), "0_A_a");
-  EXPECT_STREQ(axes[2].Name().data(), "1_A_a");
-  EXPECT_STREQ(axes[3].Name().data(), "b");
-  delete conta;
-  delete mappy;
+  auto a = MakeInput({{"a", 10, 0, 10}});
+  auto b = MakeInput({{"b", 10, 0, 10}});
+  Qn::Correlation::Correlation<decltype(three_inputs), QVectors<3>, Inputs<3>> correlation{three_inputs};
+  correlation.SetInputNames("A", "A", "B");
+  correlation.SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE,
+                         Qn::Stats::Weights::REFERENCE);
+  correlation.Initialize({{&a, &a, &b}});
+  auto axes = correlation.GetCorrelationAxes();
+  ASSERT_EQ(axes.size(), 3);
+  EXPECT_STREQ(axes[0].Name().data(), "0_A_a");
+  EXPECT_STREQ(axes[1].Name().data(), "1_A_a");
+  EXPECT_STREQ(axes[2].Name().data(), "b");
 }
 
 TEST(CorrelationTest, ConfigSameAxis) {
-  auto lambda = [](const std::vector<Qn::QVectorPtr>& q) {return q[0].x(1) + q[1].x(1);};
-  Qn::Correlation correlation("test",{"A","B"},lambda,{Qn::Weight::OBSERVABLE, Qn::Weight::REFERENCE});
-  auto mappy = new std::map<std::string, Qn::DataContainerQVector*>;
-  auto conta = new Qn::DataContainerQVector();
-  conta->AddAxes({{"a",10,0,10}});
-  auto contb = new Qn::DataContainerQVector();
-  contb->AddAxes({{"a",10,0,10}});
-  mappy->emplace("A",conta);
-  mappy->emplace("B",contb);
-  std::vector<Qn::AxisF> eventaxes = {{"Ev",10,0,10}};
-  correlation.Configure(mappy, eventaxes);
-  auto axes = correlation.GetResult().GetAxes();
-  EXPECT_STREQ(axes[0].Name().data(), "Ev");
-  EXPECT_STREQ(axes[1].Name().data(), "A_a");
-  EXPECT_STREQ(axes[2].Name().data(), "B_a");
-  delete conta;
-  delete contb;
-  delete mappy;
+  auto a = MakeInput({{"a", 10, 0, 10}});
+  auto b = MakeInput({{"a", 10, 0, 10}});
+  Qn::Correlation::Correlation<decltype(two_inputs), QVectors<2>, Inputs<2>> correlation{two_inputs};
+  correlation.SetInputNames("A", "B");
+  correlation.SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE);
+  correlation.Initialize({{&a, &b}});
+  auto axes = correlation.GetCorrelationAxes();
+  ASSERT_EQ(axes.size(), 2);
+  EXPECT_STREQ(axes[0].Name().data(), "A_a");
+  EXPECT_STREQ(axes[1].Name().data(), "B_a");
 }
 
 TEST(CorrelationTest, ConfigDifferentAxes) {
-  auto lambda = [](const std::vector<Qn::QVectorPtr>& q) {return q[0].x(1) + q[1].x(1);};
-  Qn::Correlation correlation("test",{"A","B"},lambda,{Qn::Weight::OBSERVABLE, Qn::Weight::REFERENCE});
-  auto mappy = new std::map<std::string, Qn::DataContainerQVector*>;
-  auto conta = new Qn::DataContainerQVector();
-  conta->AddAxes({{"a",10,0,10}});
-  auto contb = new Qn::DataContainerQVector();
-  contb->AddAxes({{"b",10,0,10}});
-  mappy->emplace("A",conta);
-  mappy->emplace("B",contb);
-  std::vector<Qn::AxisF> eventaxes = {{"Ev",10,0,10}};
-  correlation.Configure(mappy, eventaxes);
-  auto axes = correlation.GetResult().GetAxes();
-  EXPECT_STREQ(axes[0].Name().data(), "Ev");
-  EXPECT_STREQ(axes[1].Name().data(), "a");
-  EXPECT_STREQ(axes[2].Name().data(), "b");
-  delete conta;
-  delete contb;
-  delete mappy;
-}
\ No newline at end of file
+  auto a = MakeInput({{"a", 10, 0, 10}});
+  auto b = MakeInput({{"b", 10, 0, 10}});
+  Qn::Correlation::Correlation<decltype(two_inputs), QVectors<2>, Inputs<2>> correlation{two_inputs};
+  correlation.SetInputNames("A", "B");
+  correlation.SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE);
+  correlation.Initialize({{&a, &b}});
+  auto axes = correlation.GetCorrelationAxes();
+  ASSERT_EQ(axes.size(), 2);
+  EXPECT_STREQ(axes[0].Name().data(), "a");
+  EXPECT_STREQ(axes[1].Name().data(), "b");
+}
+
+TEST(CorrelationTest, ConfigMatchedAxes) {
+  auto a = MakeInput({{"pt", 4, 0, 2}, {"eta", 2, -1, 1}});
+  auto b = MakeInput({{"pt", 4, 0, 2}});
+  Qn::Correlation::Correlation<decltype(two_inputs), QVectors<2>, Inputs<2>> correlation{two_inputs};
+  correlation.SetInputNames("A", "B");
+  correlation.SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE);
+  correlation.SetMatchedAxes({"pt"});
+  correlation.Initialize({{&a, &b}});
+  auto axes = correlation.GetCorrelationAxes();
+  ASSERT_EQ(axes.size(), 2);
+  EXPECT_STREQ(axes[0].Name().data(), "pt");
+  EXPECT_STREQ(axes[1].Name().data(), "eta");
+  const auto &result = correlation.Correlate(a, b);
+  EXPECT_EQ(result.CountValid(), 8);
+}
+
+TEST(CorrelationTest, ConfigMatchedAxesDifferentBinning) {
+  auto a = MakeInput({{"pt", 4, 0, 2}});
+  auto b = MakeInput({{"pt", 4, 0, 4}});
+  auto c = MakeInput({{"pt", std::vector<double>{0., 0.5, 1., 1.2, 2.}}});
+  for (auto other : {&b, &c}) {
+    Qn::Correlation::Correlation<decltype(two_inputs), QVectors<2>, Inputs<2>> correlation{two_inputs};
+    correlation.SetInputNames("A", "B");
+    correlation.SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE);
+    correlation.SetMatchedAxes({"pt"});
+    EXPECT_THROW(correlation.Initialize({{&a, other}}), std::logic_error);
+  }
+}
+
+TEST(CorrelationTest, GenericFrameworkRecursion) {
+  std::mt19937 engine(42);
+  const auto particles = MakeEvent(engine, 9);
+  const auto q = MakeQVectorGF(particles);
+  for (int n = -3; n <= 3; ++n) {
+    for (unsigned int p = 0; p <= 8; ++p) {
+      std::complex<double> expected;
+      for (const auto &particle : particles) {
+        expected += std::pow(particle.weight, p)*std::polar(1., n*particle.phi);
+      }
+      EXPECT_NEAR(q.Q(n, p).real(), expected.real(), 1e-9);
+      EXPECT_NEAR(q.Q(n, p).imag(), expected.imag(), 1e-9);
+    }
+  }
+  auto expect_equal = [](const Qn::CorrelationResult &result, const Qn::CorrelationResult &expected) {
+    EXPECT_TRUE(result.validity);
+    EXPECT_NEAR(result.result, expected.result, 1e-9);
+    EXPECT_NEAR(result.weight, expected.weight, 1e-9*expected.weight);
+  };
+  using namespace Qn::Correlation;
+  expect_equal(TwoParticleCorrelation(q, 2), BruteForceCorrelation(particles, {2, -2}));
+  expect_equal(FourParticleCorrelation(q, 2), BruteForceCorrelation(particles, {2, 2, -2, -2}));
+  expect_equal(SixParticleCorrelation(q, 2), BruteForceCorrelation(particles, {2, 2, 2, -2, -2, -2}));
+  expect_equal(EightParticleCorrelation(q, 2), BruteForceCorrelation(particles, {2, 2, 2, 2, -2, -2, -2, -2}));
+  expect_equal(MultiParticleCorrelation<3>(q, {{2, 3, -5}}), BruteForceCorrelation(particles, {2, 3, -5}));
+  EXPECT_FALSE(EightParticleCorrelation(MakeQVectorGF({particles.begin(), particles.begin() + 7}), 2).validity);
+}
+
+TEST(CorrelationTest, GenericFrameworkCumulants) {
+  constexpr unsigned int kSamples = 5;
+  constexpr std::size_t kEvents = 6;
+  std::mt19937 engine(7);
+  std::poisson_distribution<int> poisson(1.);
+  const std::array<std::vector<int>, 4> harmonics{{{2, -2}, {2, 2, -2, -2}, {2, 2, 2, -2, -2, -2},
+                                                   {2, 2, 2, 2, -2, -2, -2, -2}}};
+  std::array<Qn::DataContainerStats, 4> correlations;
+  for (auto &correlation : correlations) {
+    correlation.AddAxis({"x", 1, 0., 1.});
+    correlation[0].SetNumberOfReSamples(kSamples);
+  }
+  // event averages of the full sample and of the resamples from the brute-force sums.
+  std::array<std::array<double, kSamples + 1>, 4> numerators{};
+  std::array<std::array<double, kSamples + 1>, 4> denominators{};
+  for (std::size_t ievent = 0; ievent < kEvents; ++ievent) {
+    const auto particles = MakeEvent(engine, 8 + ievent%3);
+    const auto q = MakeQVectorGF(particles);
+    std::vector<UChar_t> multiplicities(kSamples);
+    for (auto &multiplicity : multiplicities) multiplicity = poisson(engine);
+    const std::array<Qn::CorrelationResult, 4> results{{Qn::Correlation::TwoParticleCorrelation(q, 2),
+                                                        Qn::Correlation::FourParticleCorrelation(q, 2),
+                                                        Qn::Correlation::SixParticleCorrelation(q, 2),
+                                                        Qn::Correlation::EightParticleCorrelation(q, 2)}};
+    for (std::size_t k = 0; k < 4; ++k) {
+      correlations[k][0].FillPoisson(results[k], multiplicities);
+      const auto expected = BruteForceCorrelation(particles, harmonics[k]);
+      for (unsigned int i = 0; i <= kSamples; ++i) {
+        const double multiplicity = i < kSamples ? multiplicities[i] : 1.;
+        numerators[k][i] += multiplicity*expected.result*expected.weight;
+        denominators[k][i] += multiplicity*expected.weight;
+      }
+    }
+  }
+  auto cumulants = [&](unsigned int i) {
+    std::array<double, 4> c;
+    for (std::size_t k = 0; k < 4; ++k) c[k] = numerators[k][i]/denominators[k][i];
+    return std::array<double, 3>{{c[1] - 2*c[0]*c[0],
+                                  c[2] - 9*c[1]*c[0] + 12*c[0]*c[0]*c[0],
+                                  c[3] - 16*c[2]*c[0] - 18*c[1]*c[1] + 144*c[1]*c[0]*c[0]
+                                      - 144*c[0]*c[0]*c[0]*c[0]}};
+  };
+  const std::array<Qn::DataContainerStats, 3> results{
+      {Qn::Correlation::FourParticleCumulant(correlations[0], correlations[1]),
+       Qn::Correlation::SixParticleCumulant(correlations[0], correlations[1], correlations[2]),
+       Qn::Correlation::EightParticleCumulant(correlations[0], correlations[1], correlations[2], correlations[3])}};
+  const auto expected = cumulants(kSamples);
+  for (std::size_t k = 0; k < 3; ++k) {
+    EXPECT_NEAR(results[k][0].Mean(), expected[k], 1e-9);
+    ASSERT_EQ(results[k][0].GetNSamples(), kSamples);
+    for (unsigned int i = 0; i < kSamples; ++i) {
+      if (denominators[0][i]==0.) continue;
+      EXPECT_NEAR(results[k][0].GetReSamples().GetSampleMean(i), cumulants(i)[k], 1e-9);
+    }
+  }
+  auto different_samples = correlations[1];
+  different_samples[0].SetNumberOfReSamples(kSamples - 1);
+  EXPECT_THROW(Qn::Correlation::FourParticleCumulant(correlations[0], different_samples), std::logic_error);
+}
+
+TEST(CorrelationTest, CorrelationResultWeight) {
+  auto a = MakeInput({{"a", 2, 0, 2}});
+  auto b = MakeInput({{"b", 2, 0, 2}});
+  for (auto &bin : a) bin.SetNumberOfContributors(2, 2., true);
+  auto with_weight = [](const Qn::QVector &a, const Qn::QVector &b) {
+    return Qn::CorrelationResult{a.x(1)*b.x(1), true, 3.};
+  };
+  Qn::Correlation::Correlation<decltype(with_weight), QVectors<2>, Inputs<2>> correlation{with_weight};
+  correlation.SetInputNames("A", "B");
+  correlation.SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE);
+  correlation.Initialize({{&a, &b}});
+  const auto &result = correlation.Correlate(a, b);
+  ASSERT_EQ(result.size(), 4);
+  for (std::size_t ibin = 0; ibin < result.size(); ++ibin) {
+    EXPECT_TRUE(result.IsValid(ibin));
+    EXPECT_DOUBLE_EQ(result.Value(ibin), 1.);
+    EXPECT_DOUBLE_EQ(result.Weight(ibin), 3.);
+  }
+}
+
+TEST(CorrelationTest, CorrelationSetEqualsCorrelations) {
+  const std::bitset<Qn::QVector::kmaxharmonics> harmonics("00000010");
+  auto tracks = MakeInput({{"pt", 4, 0., 2.}});
+  auto psi = MakeInput({});
+  auto v2 = [](const Qn::QVector &a, const Qn::QVector &b) { return Qn::ScalarProduct(a, b, 2); };
+  auto resolution = [](const Qn::QVector &a, const Qn::QVector &b) { return a.x(2)*b.x(2); };
+  const auto event_axes = Qn::Correlation::MakeAxes(Qn::AxisD{"centrality", 3, 0., 60.});
+  constexpr std::size_t n_resamples = 10;
+  const std::array<const Qn::DataContainerQVector *, 2> track_inputs{{&tracks, &psi}};
+  const std::array<const Qn::DataContainerQVector *, 2> psi_inputs{{&psi, &psi}};
+  auto set = Qn::Correlation::MakeCorrelationSet("set", event_axes, "tracks", "psi");
+  set.AddCorrelation("v2", v2, {"tracks", "psi"}, {Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE});
+  set.AddCorrelation("resolution", resolution, {"psi", "psi"},
+                     {Qn::Stats::Weights::REFERENCE, Qn::Stats::Weights::REFERENCE});
+  set.Configure(track_inputs, n_resamples);
+  auto v2_helper = Qn::Correlation::MakeCorrelation("v2", v2, event_axes)
+      .SetInputNames("tracks", "psi")
+      .SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE)
+      .SetCollectStatistics();
+  v2_helper.Configure(track_inputs, n_resamples);
+  auto resolution_helper = Qn::Correlation::MakeCorrelation("resolution", resolution, event_axes)
+      .SetInputNames("psi", "psi")
+      .SetWeights(Qn::Stats::Weights::REFERENCE, Qn::Stats::Weights::REFERENCE);
+  resolution_helper.Configure(psi_inputs, n_resamples);
+  set.InitTask(nullptr, 0);
+  v2_helper.InitTask(nullptr, 0);
+  resolution_helper.InitTask(nullptr, 0);
+  std::mt19937 gen(17);
+  std::uniform_real_distribution<> component(-1., 1.);
+  std::uniform_real_distribution<> centrality(0., 80.);
+  std::poisson_distribution<> multiplicity(1.);
+  for (int event = 0; event < 200; ++event) {
+    for (auto container : {&tracks, &psi}) {
+      for (auto &q : *container) {
+        q = Qn::QVector(harmonics, Qn::QVector::CorrectionStep::PLAIN);
+        q.SetX(2, component(gen));
+        q.SetY(2, component(gen));
+        q.SetNumberOfContributors(event%7==3 ? 0 : 5, 5., true);
+      }
+    }
+    Qn::Correlation::SampleMultiplicities samples(n_resamples);
+    for (auto &sample : samples) sample = multiplicity(gen);
+    const auto event_centrality = centrality(gen);
+    set.Exec(0, samples, tracks, psi, event_centrality);
+    v2_helper.Exec(0, samples, tracks, psi, event_centrality);
+    resolution_helper.Exec(0, samples, psi, psi, event_centrality);
+  }
+  set.Finalize();
+  v2_helper.Finalize();
+  resolution_helper.Finalize();
+  // the statistics are only collected by the helper, which enabled them.
+  EXPECT_EQ(v2_helper.GetStatistics()->events, 200u);
+  EXPECT_GT(v2_helper.GetStatistics()->events_in_range, 0u);
+  EXPECT_LT(v2_helper.GetStatistics()->events_in_range, 200u);
+  EXPECT_GT(v2_helper.GetStatistics()->sample_fills, 0u);
+  EXPECT_EQ(resolution_helper.GetStatistics()->events, 0u);
+  EXPECT_EQ(resolution_helper.GetStatistics()->sample_fills, 0u);
+  const auto &set_result = *set.GetResultPtr();
+  for (const auto &expected : {std::make_pair("v2", v2_helper.GetResultPtr()),
+                               std::make_pair("resolution", resolution_helper.GetResultPtr())}) {
+    const auto &actual = set_result.at(expected.first);
+    ASSERT_EQ(actual.size(), expected.second->size());
+    for (std::size_t ibin = 0; ibin < actual.size(); ++ibin) {
+      const auto &bin = actual[ibin];
+      const auto &expected_bin = expected.second->At(ibin);
+      EXPECT_EQ(bin.N(), expected_bin.N());
+      EXPECT_EQ(bin.IsObservable(), expected_bin.IsObservable());
+      EXPECT_EQ(bin.GetNSamples(), expected_bin.GetNSamples());
+      if (expected_bin.N()==0) continue;
+      EXPECT_EQ(bin.Mean(), expected_bin.Mean());
+      EXPECT_EQ(bin.MeanError(), expected_bin.MeanError());
+      for (std::size_t i = 0; i < n_resamples; ++i) {
+        EXPECT_EQ(bin.GetReSamples().GetSampleMean(i), expected_bin.GetReSamples().GetSampleMean(i));
+      }
+    }
+  }
+}
+
+TEST(CorrelationTest, SharedResultEqualsSlotResults) {
+  constexpr unsigned int n_slots = 4;
+  constexpr std::size_t n_resamples = 8;
+  const std::bitset<Qn::QVector::kmaxharmonics> harmonics("00000010");
+  const auto event_axes = Qn::Correlation::MakeAxes(Qn::AxisD{"centrality", 2, 0., 100.});
+  auto v2 = [](const Qn::QVector &a, const Qn::QVector &b) { return Qn::ScalarProduct(a, b, 2); };
+  auto make_helper = [&](Qn::Correlation::ResultSharing sharing, std::size_t threshold) {
+    return Qn::Correlation::MakeCorrelation("v2", v2, event_axes)
+        .SetInputNames("tracks", "psi")
+        .SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE)
+        .SetResultSharing(sharing, threshold);
+  };
+  // the slots of the helpers are the threads of the implicit multithreading.
+  ROOT::EnableImplicitMT(n_slots);
+  auto per_slot = make_helper(Qn::Correlation::ResultSharing::kPerSlot, 0);
+  auto shared = make_helper(Qn::Correlation::ResultSharing::kShared, 0);
+  auto automatic = make_helper(Qn::Correlation::ResultSharing::kAutomatic, 1);
+  ROOT::DisableImplicitMT();
+  std::vector<Qn::DataContainerQVector> tracks(n_slots, MakeInput({{"pt", 5, 0., 2.}, {"eta", 4, -1., 1.}}));
+  std::vector<Qn::DataContainerQVector> psi(n_slots, MakeInput({}));
+  const std::array<const Qn::DataContainerQVector *, 2> inputs{{&tracks[0], &psi[0]}};
+  per_slot.Configure(inputs, n_resamples);
+  shared.Configure(inputs, n_resamples);
+  automatic.Configure(inputs, n_resamples);
+  std::vector<std::thread> threads;
+  for (unsigned int slot = 0; slot < n_slots; ++slot) {
+    threads.emplace_back([&, slot]() {
+      per_slot.InitTask(nullptr, slot);
+      shared.InitTask(nullptr, slot);
+      automatic.InitTask(nullptr, slot);
+      for (unsigned int event = slot; event < 400; event += n_slots) {
+        // the events are generated from their number, such that they do not depend on the slot.
+        std::mt19937 gen(event);
+        std::uniform_real_distribution<> component(-1., 1.);
+        std::poisson_distribution<> multiplicity(1.);
+        for (auto container : {&tracks[slot], &psi[slot]}) {
+          for (auto &q : *container) {
+            q = Qn::QVector(harmonics, Qn::QVector::CorrectionStep::PLAIN);
+            q.SetX(2, component(gen));
+            q.SetY(2, component(gen));
+            q.SetNumberOfContributors(event%5==2 ? 0 : 4, 4., true);
+          }
+        }
+        Qn::Correlation::SampleMultiplicities samples(n_resamples);
+        for (auto &sample : samples) sample = multiplicity(gen);
+        const double centrality = 25. + 50.*(event%2);
+        per_slot.Exec(slot, samples, tracks[slot], psi[slot], centrality);
+        shared.Exec(slot, samples, tracks[slot], psi[slot], centrality);
+        automatic.Exec(slot, samples, tracks[slot], psi[slot], centrality);
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  EXPECT_NE(&per_slot.PartialUpdate(0), &per_slot.PartialUpdate(1));
+  EXPECT_EQ(&shared.PartialUpdate(0), &shared.PartialUpdate(1));
+  EXPECT_EQ(&automatic.PartialUpdate(0), &automatic.PartialUpdate(1));
+  per_slot.Finalize();
+  shared.Finalize();
+  automatic.Finalize();
+  const auto &expected = *per_slot.GetResultPtr();
+  for (const auto &result : {shared.GetResultPtr(), automatic.GetResultPtr()}) {
+    ASSERT_EQ(result->size(), expected.size());
+    for (std::size_t ibin = 0; ibin < expected.size(); ++ibin) {
+      const auto &bin = result->At(ibin);
+      const auto &expected_bin = expected.At(ibin);
+      ASSERT_GT(expected_bin.N(), 0.);
+      // the bins are filled in another order, which only changes the rounding of the sums.
+      EXPECT_DOUBLE_EQ(bin.N(), expected_bin.N());
+      EXPECT_NEAR(bin.Mean(), expected_bin.Mean(), 1e-12);
+      EXPECT_NEAR(bin.MeanError(), expected_bin.MeanError(), 1e-12);
+      ASSERT_EQ(bin.GetNSamples(), expected_bin.GetNSamples());
+      for (std::size_t i = 0; i < n_resamples; ++i) {
+        EXPECT_NEAR(bin.GetReSamples().GetSampleMean(i), expected_bin.GetReSamples().GetSampleMean(i), 1e-12);
+      }
+    }
+  }
+}
+
+TEST(CorrelationTest, Kernels) {
+  // The batched kernels give the same results as the equivalent correlation functions evaluated bin by bin.
+  const std::bitset<Qn::QVector::kmaxharmonics> harmonics("00000110");
+  Qn::DataContainerQVector tracks;
+  tracks.AddAxis({"pt", 10, 0., 2.});
+  Qn::DataContainerQVector psi_a;
+  Qn::DataContainerQVector psi_b;
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<> component(-1., 1.);
+  auto fill = [&](Qn::DataContainerQVector &container, bool empty_bins) {
+    for (std::size_t ibin = 0; ibin < container.size(); ++ibin) {
+      Qn::QVector q(harmonics, Qn::QVector::CorrectionStep::PLAIN, Qn::QVector::Normalization::M);
+      for (unsigned int h = 2; h <= 3; ++h) {
+        q.SetX(h, component(gen));
+        q.SetY(h, component(gen));
+      }
+      q.SetNumberOfContributors(empty_bins && ibin%4==1 ? 0 : 5, 2.5 + ibin, true);
+      container[ibin] = q;
+    }
+  };
+  fill(tracks, true);
+  fill(psi_a, false);
+  fill(psi_b, false);
+  using Kernel = Qn::Correlation::Kernels::ThreeSubEvent<2, Qn::Correlation::Kernels::Scale::kDeNormal>;
+  auto function = [](const Qn::QVector &a, const Qn::QVector &b, const Qn::QVector &c) {
+    const auto da = a.DeNormal();
+    const auto db = b.DeNormal();
+    const auto dc = c.DeNormal();
+    return std::array<double, 3>{Qn::ScalarProduct(da, db, 2), Qn::ScalarProduct(da, dc, 2),
+                                 Qn::ScalarProduct(db, dc, 2)};
+  };
+  Qn::Correlation::Correlation<Kernel, QVectors<3>, Inputs<3>> batched{Kernel()};
+  Qn::Correlation::Correlation<decltype(function), QVectors<3>, Inputs<3>> scalar{function};
+  const std::array<const Qn::DataContainerQVector *, 3> inputs{{&tracks, &psi_a, &psi_b}};
+  batched.SetInputNames("tracks", "psi_a", "psi_b");
+  scalar.SetInputNames("tracks", "psi_a", "psi_b");
+  batched.SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE, Qn::Stats::Weights::OBSERVABLE);
+  scalar.SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE, Qn::Stats::Weights::OBSERVABLE);
+  batched.Initialize(inputs);
+  scalar.Initialize(inputs);
+  const auto &batched_result = batched.Correlate(tracks, psi_a, psi_b);
+  const auto &scalar_result = scalar.Correlate(tracks, psi_a, psi_b);
+  ASSERT_EQ(batched_result.size(), 30);
+  EXPECT_EQ(batched_result.CountValid(), scalar_result.CountValid());
+  for (std::size_t ibin = 0; ibin < batched_result.size(); ++ibin) {
+    ASSERT_EQ(batched_result.IsValid(ibin), scalar_result.IsValid(ibin));
+    if (!scalar_result.IsValid(ibin)) continue;
+    EXPECT_NEAR(batched_result.Value(ibin), scalar_result.Value(ibin), 1e-5);
+    EXPECT_DOUBLE_EQ(batched_result.Weight(ibin), scalar_result.Weight(ibin));
+  }
+}
+
+TEST(CorrelationTest, SymmetricInputs) {
+  // Only the upper triangle of the pairs of bins of the same input is evaluated.
+  const std::bitset<Qn::QVector::kmaxharmonics> harmonics("00000010");
+  Qn::DataContainerQVector tracks;
+  tracks.AddAxis({"pt", 6, 0., 2.});
+  Qn::DataContainerQVector psi;
+  for (std::size_t ibin = 0; ibin < tracks.size(); ++ibin) {
+    Qn::QVector q(harmonics, Qn::QVector::CorrectionStep::PLAIN);
+    q.SetX(2, 0.1*ibin);
+    q.SetY(2, 1. - 0.2*ibin);
+    q.SetNumberOfContributors(ibin==2 ? 0 : 3, 1., true);
+    tracks[ibin] = q;
+  }
+  psi.At(0) = tracks[1];
+  auto function = [](const Qn::QVector &a, const Qn::QVector &psi, const Qn::QVector &b) {
+    return std::array<double, 2>{Qn::ScalarProduct(a, b, 2), Qn::ScalarProduct(a, b, 2)*psi.x(2)};
+  };
+  const std::array<const Qn::DataContainerQVector *, 3> inputs{{&tracks, &psi, &tracks}};
+  Qn::Correlation::Correlation<decltype(function), QVectors<3>, Inputs<3>> full{function};
+  Qn::Correlation::Correlation<decltype(function), QVectors<3>, Inputs<3>> symmetric{function};
+  for (auto correlation : {&full, &symmetric}) {
+    correlation->SetInputNames("tracks", "psi", "tracks");
+    correlation->SetWeights(Qn::Stats::Weights::REFERENCE, Qn::Stats::Weights::REFERENCE,
+                            Qn::Stats::Weights::REFERENCE);
+  }
+  symmetric.SetSymmetricInputs(0, 2, false);
+  full.Initialize(inputs);
+  symmetric.Initialize(inputs);
+  const auto &full_result = full.Correlate(tracks, psi, tracks);
+  const auto &symmetric_result = symmetric.Correlate(tracks, psi, tracks);
+  ASSERT_EQ(symmetric_result.size(), 72);
+  EXPECT_EQ(symmetric_result.CountValid(), 2*10);
+  for (std::size_t ibin = 0; ibin < full_result.size(); ++ibin) {
+    const auto a = ibin/12;
+    const auto b = (ibin/2)%6;
+    EXPECT_EQ(symmetric.IsEvaluated(ibin), a < b);
+    EXPECT_EQ(symmetric_result.IsValid(ibin), a < b && full_result.IsValid(ibin));
+    const auto mirror = symmetric.GetMirrorBin(ibin);
+    EXPECT_EQ(mirror, a > b ? b*12 + a*2 + ibin%2 : ibin);
+    if (full_result.IsValid(ibin) && a!=b) {
+      EXPECT_EQ(full_result.Value(ibin), symmetric_result.Value(mirror));
+    }
+  }
+}
+
+TEST(CorrelationTest, ParallelBlocks) {
+  // The blocks of the bins of the first input evaluated in parallel give the results of the serial evaluation.
+  const std::bitset<Qn::QVector::kmaxharmonics> harmonics("00000010");
+  Qn::DataContainerQVector tracks;
+  tracks.AddAxes({{"pt", 10, 0., 2.}, {"eta", 7, -1., 1.}});
+  Qn::DataContainerQVector psi;
+  std::mt19937 gen(11);
+  std::uniform_real_distribution<> component(-1., 1.);
+  for (std::size_t ibin = 0; ibin < tracks.size(); ++ibin) {
+    Qn::QVector q(harmonics, Qn::QVector::CorrectionStep::PLAIN, Qn::QVector::Normalization::M);
+    q.SetX(2, component(gen));
+    q.SetY(2, component(gen));
+    q.SetNumberOfContributors(ibin%5==3 ? 0 : 4, 1.5 + ibin, true);
+    tracks[ibin] = q;
+  }
+  psi.At(0) = tracks[1];
+  using Kernel = Qn::Correlation::Kernels::ScalarProduct<2, Qn::Correlation::Kernels::Scale::kDeNormal>;
+  auto function = [](const Qn::QVector &a, const Qn::QVector &b) {
+    return Qn::ScalarProduct(a.DeNormal(), b.DeNormal(), 2);
+  };
+  Qn::Correlation::Correlation<Kernel, QVectors<2>, Inputs<2>> batched{Kernel()};
+  Qn::Correlation::Correlation<decltype(function), QVectors<2>, Inputs<2>> scalar{function};
+  Qn::Correlation::Correlation<decltype(function), QVectors<2>, Inputs<2>> symmetric{function};
+  auto run = [&](auto &correlation, const Qn::DataContainerQVector &second) {
+    correlation.SetInputNames("tracks", &second==&tracks ? "tracks" : "psi");
+    correlation.SetWeights(Qn::Stats::Weights::OBSERVABLE, Qn::Stats::Weights::REFERENCE);
+    correlation.Initialize(std::array<const Qn::DataContainerQVector *, 2>{{&tracks, &second}});
+    const auto serial = correlation.Correlate(tracks, second);
+    ROOT::EnableImplicitMT(2);
+    correlation.SetParallelBlocks(3);
+    const auto parallel = correlation.Correlate(tracks, second);
+    ROOT::DisableImplicitMT();
+    correlation.SetParallelBlocks(0);
+    ASSERT_EQ(serial.size(), parallel.size());
+    EXPECT_EQ(serial.CountValid(), parallel.CountValid());
+    for (std::size_t ibin = 0; ibin < serial.size(); ++ibin) {
+      ASSERT_EQ(serial.IsValid(ibin), parallel.IsValid(ibin));
+      if (!serial.IsValid(ibin)) continue;
+      EXPECT_EQ(serial.Value(ibin), parallel.Value(ibin));
+      EXPECT_EQ(serial.Weight(ibin), parallel.Weight(ibin));
+    }
+  };
+  run(batched, psi);
+  run(scalar, psi);
+  symmetric.SetSymmetricInputs(0, 1);
+  run(symmetric, tracks);
+  // the valid bins of a range are visited in increasing order.
+  const auto &result = scalar.Correlate(tracks, psi);
+  std::size_t previous = 0;
+  std::size_t n_valid = 0;
+  result.ForEachValid(13, 61, [&](std::size_t ibin, double, double) {
+    EXPECT_TRUE(ibin >= 13 && ibin < 61 && (n_valid==0 || ibin > previous));
+    previous = ibin;
+    ++n_valid;
+  });
+  std::size_t expected = 0;
+  for (std::size_t ibin = 13; ibin < 61; ++ibin) expected += result.IsValid(ibin);
+  EXPECT_EQ(n_valid, expected);
+}
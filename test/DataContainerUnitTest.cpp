@@ -4,11 +4,16 @@
 #include <gtest/gtest.h>
 
 #include "DataContainer.h"
+#include "SparseDataContainer.h"
 
 #include <TList.h>
 #include <TFile.h>
 #include <TRandom3.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include <random>
+#include <utility>
 #include <TProfile.h>
 #include <ROOT/RDataFrame.hxx>
 #include "CorrectionFillHelper.h"
@@ -39,7 +44,7 @@ TEST(DataContainerTest, equalbinning) {
       ++hist2[bin];
     }
   }
-0  for (int i = 0; i < hist1.size(); ++i) {
+  for (int i = 0; i < hist1.size(); ++i) {
     std::cout << hist1[i] << " " << hist2[i] << std::endl;
   }
 }
@@ -444,4 +449,243 @@ TEST(DataContainerTest, AddAxes) {
 //  for (const auto &bin : result) {
 //    EXPECT_FLOAT_EQ(bin, 2 + (ibin++ / 5));
 //  }
-//}
\ No newline at end of file
+//}
+long FindBinReference(const Qn::AxisD &axis, const double value) {
+  const std::vector<double> edges(axis.begin(), axis.end());
+  if (value < edges.front()) return -1;
+  auto lb = std::lower_bound(edges.begin(), edges.end(), value);
+  long bin = (lb==edges.begin() || *lb==value) ? lb - edges.begin() : lb - edges.begin() - 1;
+  return bin >= static_cast<long>(edges.size()) - 1 ? -1 : bin;
+}
+
+TEST(DataContainerTest, UniformAxisFindBin) {
+  Qn::AxisD uniform("uniform", 1000, 0., 2*M_PI);
+  std::vector<double> shifted(uniform.begin(), uniform.end());
+  shifted[1] += 1e-3;
+  Qn::AxisD reference("reference", shifted);
+  std::vector<double> values{std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::infinity(),
+                             -std::numeric_limits<double>::infinity(), -1e-12, 2*M_PI, 2*M_PI + 1e-12,
+                             uniform.GetLastBinEdge(), std::nextafter(uniform.GetLastBinEdge(), 0.)};
+  for (auto edge : uniform) {
+    values.push_back(edge);
+    values.push_back(std::nextafter(edge, -1.));
+    values.push_back(std::nextafter(edge, 10.));
+  }
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> distribution(-0.1, 2*M_PI + 0.1);
+  for (int i = 0; i < 10000; ++i) values.push_back(distribution(generator));
+  for (auto value : values) {
+    EXPECT_EQ(uniform.FindBin(value), FindBinReference(uniform, value)) << value;
+    EXPECT_EQ(reference.FindBin(value), FindBinReference(reference, value)) << value;
+  }
+  EXPECT_EQ(uniform.FindBin(std::numeric_limits<double>::quiet_NaN()), 0);
+  EXPECT_EQ(uniform.FindBin(uniform.GetLastBinEdge()), -1);
+  EXPECT_EQ(reference.FindBin(0.0065), 0);
+}
+
+TEST(DataContainerTest, VariableAxisFindBin) {
+  std::vector<double> edges{0.};
+  for (int i = 1; i < 200; ++i) edges.push_back(edges.back() + (i < 100 ? 0.001*i : std::exp(0.05*i)));
+  Qn::AxisD variable("variable", edges);
+  auto search = [&edges](double value) {
+    if (value < edges.front()) return -1l;
+    auto lb = std::lower_bound(edges.begin(), edges.end(), value);
+    long bin = (lb==edges.begin() || (lb!=edges.end() && *lb==value)) ? lb - edges.begin() : lb - edges.begin() - 1;
+    return bin >= (long) edges.size() - 1 ? -1l : bin;
+  };
+  for (std::size_t i = 0; i < edges.size(); ++i) {
+    EXPECT_EQ(variable.FindBin(edges[i]), search(edges[i]));
+    EXPECT_EQ(variable.FindBin(std::nextafter(edges[i], -1.)), search(std::nextafter(edges[i], -1.)));
+  }
+  const int n = 100000;
+  for (int i = 0; i < n; ++i) {
+    const double value = -1. + (edges.back() + 2.)*i/n;
+    EXPECT_EQ(variable.FindBin(value), search(value));
+  }
+}
+
+TEST(DataContainerTest, AllocationFreeIndexing) {
+  Qn::DataContainer<double, Qn::AxisD> container;
+  container.AddAxes({{"a1", 10, 0, 10}, {"a2", 5, 0, 1}});
+  const std::array<double, 2> coordinates{{3.5, 0.5}};
+  const auto bin = container.FindBin(coordinates);
+  EXPECT_EQ(17, bin);
+  EXPECT_EQ(bin, container.FindBin(3.5, 0.5));
+  EXPECT_EQ(bin, container.FindBin(coordinates.data()));
+  EXPECT_EQ(-1, container.FindBin(11., 0.5));
+  std::array<std::size_t, 2> indices{};
+  container.GetIndex(indices, bin);
+  EXPECT_EQ(3, indices[0]);
+  EXPECT_EQ(2, indices[1]);
+  EXPECT_EQ(bin, container.GetLinearIndex(indices));
+  Qn::DataContainerIndexer<Qn::AxisD, 2> indexer(container);
+  EXPECT_EQ(bin, indexer.FindBin(coordinates));
+  EXPECT_EQ(bin, indexer.GetLinearIndex(indices));
+  EXPECT_EQ(container.size(), indexer.size());
+  EXPECT_THROW((Qn::DataContainerIndexer<Qn::AxisD, 3>(container)), std::logic_error);
+}
+
+TEST(DataContainerTest, BatchedFindBins) {
+  Qn::DataContainer<double, Qn::AxisD> container;
+  container.AddAxes({{"a1", 10, 0, 10}, {"a2", std::vector<double>{0., 0.1, 0.5, 1.}}});
+  const std::vector<double> a1{3.5, 11., 0., 9.99, 5.};
+  const std::vector<double> a2{0.5, 0.5, 0.05, 0.99, -0.1};
+  const double *coordinates[] = {a1.data(), a2.data()};
+  std::vector<long> bins(a1.size());
+  container.FindBins(coordinates, a1.size(), bins.data());
+  for (std::size_t i = 0; i < a1.size(); ++i) {
+    EXPECT_EQ(container.FindBin(a1[i], a2[i]), bins[i]);
+  }
+  EXPECT_EQ(-1, bins[1]);
+  EXPECT_EQ(-1, bins[4]);
+}
+
+TEST(DataContainerTest, StrideProjection) {
+  Qn::DataContainer<double, Qn::AxisD> container;
+  container.AddAxes({{"a1", 4, 0, 4}, {"a2", 6, 0, 6}, {"a3", 5, 0, 5}});
+  for (auto &bin : container) {
+    bin = 1.;
+  }
+  auto add = [](double a, double b) { return a + b; };
+  auto projection = container.Projection({"a1", "a3"}, add);
+  ASSERT_EQ(20, projection.size());
+  for (const auto &bin : projection) {
+    EXPECT_EQ(6., bin);
+  }
+  auto rebinned = container.Rebin({"a2", std::vector<double>{0., 2., 6.}}, add);
+  ASSERT_EQ(40, rebinned.size());
+  EXPECT_EQ(2., rebinned.At(std::array<std::size_t, 3>{{0, 0, 0}}));
+  EXPECT_EQ(4., rebinned.At(std::array<std::size_t, 3>{{3, 1, 4}}));
+}
+
+TEST(DataContainerTest, ParallelBinwiseOperations) {
+  Qn::DataContainer<double, Qn::AxisD> container;
+  container.AddAxes({{"a1", 20, 0, 20}, {"a2", 20, 0, 20}, {"a3", 15, 0, 15}});
+  Qn::DataContainer<double, Qn::AxisD> integrated;
+  integrated.AddAxes({{"a1", 20, 0, 20}, {"a2", 20, 0, 20}});
+  for (std::size_t i = 0; i < container.size(); ++i) container[i] = 0.5*i + 1.;
+  for (std::size_t i = 0; i < integrated.size(); ++i) integrated[i] = i + 2.;
+  auto merge = [](double a, double b) { return 0.9*a + b; };
+  auto run = [&](Qn::Execution execution) {
+    std::vector<Qn::DataContainer<double, Qn::AxisD>> results;
+    results.push_back(container.Projection({"a1", "a3"}, merge, execution));
+    results.push_back(container.Rebin({"a2", std::vector<double>{0., 3., 7., 20.}}, merge, execution));
+    results.push_back(container.Map([](double x) { return x*x; }, execution));
+    results.push_back(container.Apply(integrated, [](double a, double b) { return a/b; }, execution));
+    results.push_back(container.Apply(container, [](double a, double b) { return a + b; }, execution));
+    return results;
+  };
+  const auto serial = run(Qn::Execution::kSequential);
+  ROOT::EnableImplicitMT(2);
+  const auto parallel = run(Qn::Execution::kParallel);
+  // without the parallel execution the functions are called in the order of the bins by the calling thread.
+  std::vector<double> calls;
+  container.Map([&calls](double x) {
+    calls.push_back(x);
+    return x;
+  });
+  ROOT::DisableImplicitMT();
+  ASSERT_EQ(calls.size(), container.size());
+  for (std::size_t ibin = 0; ibin < container.size(); ++ibin) EXPECT_EQ(calls[ibin], container[ibin]);
+  ASSERT_EQ(serial.size(), parallel.size());
+  for (std::size_t i = 0; i < serial.size(); ++i) {
+    ASSERT_EQ(serial[i].size(), parallel[i].size());
+    for (std::size_t ibin = 0; ibin < serial[i].size(); ++ibin) {
+      EXPECT_EQ(serial[i].At(ibin), parallel[i].At(ibin));
+    }
+  }
+}
+
+TEST(DataContainerTest, LazyArithmetic) {
+  Qn::DataContainer<double, Qn::AxisD> a;
+  a.AddAxes({{"a1", 4, 0, 4}, {"a2", 3, 0, 3}});
+  Qn::DataContainer<double, Qn::AxisD> b;
+  b.AddAxes({{"a1", 4, 0, 4}});
+  for (std::size_t i = 0; i < a.size(); ++i) a[i] = i + 1.;
+  for (std::size_t i = 0; i < b.size(); ++i) b[i] = i + 2.;
+  auto multiply = [](double x, double y) { return x*y; };
+  auto divide = [](double x, double y) { return x/y; };
+  const auto expected = a.Apply(a, multiply).Apply(b, divide).Map([](double x) { return 2.*x; });
+  static_assert(std::is_same<decltype(a*a/b*2.), Qn::DataContainer<double, Qn::AxisD>>::value,
+                "The operations on DataContainers are eager.");
+  const auto eager = a*a/b*2.;
+  Qn::DataContainer<double, Qn::AxisD> result = Qn::Lazy(a)*a/b*2.;
+  Qn::DataContainer<double, Qn::AxisD> temporary = Qn::Lazy(a*a)/b*2.;
+  ASSERT_EQ(expected.size(), result.size());
+  ASSERT_EQ(expected.size(), eager.size());
+  for (std::size_t i = 0; i < result.size(); ++i) {
+    EXPECT_DOUBLE_EQ(expected[i], result[i]);
+    EXPECT_DOUBLE_EQ(expected[i], eager[i]);
+    EXPECT_DOUBLE_EQ(expected[i], temporary[i]);
+  }
+  a = Qn::Lazy(a)/b;
+  EXPECT_DOUBLE_EQ(1./2., a.At(0));
+}
+
+TEST(DataContainerTest, CompoundAssignment) {
+  Qn::DataContainer<double, Qn::AxisD> a;
+  a.AddAxes({{"a1", 4, 0, 4}, {"a2", 3, 0, 3}});
+  Qn::DataContainer<double, Qn::AxisD> b;
+  b.AddAxes({{"a1", 4, 0, 4}});
+  for (std::size_t i = 0; i < a.size(); ++i) a[i] = i + 1.;
+  for (std::size_t i = 0; i < b.size(); ++i) b[i] = i + 2.;
+  Qn::DataContainer<double, Qn::AxisD> expected = (a + a)*b*0.5;
+  a += a;
+  a *= b;
+  a *= 0.5;
+  ASSERT_EQ(expected.size(), a.size());
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    EXPECT_DOUBLE_EQ(expected[i], a[i]);
+  }
+}
+
+TEST(DataContainerTest, SparseStorage) {
+  Qn::SparseDataContainer<Qn::Statistic, Qn::AxisD> sparse({{"a1", 10, 0, 10}, {"a2", 5, 0, 5}, {"a3", 4, 0, 4}});
+  EXPECT_EQ(200, sparse.size());
+  EXPECT_EQ(0, sparse.GetNFilled());
+  sparse.CallOnElement(std::vector<double>{1.5, 0.5, 2.5}, [](Qn::Statistic &s) { s.Fill(1., 1.); });
+  sparse.CallOnElement(std::vector<double>{1.5, 3.5, 2.5}, [](Qn::Statistic &s) { s.Fill(3., 1.); });
+  EXPECT_EQ(2, sparse.GetNFilled());
+  EXPECT_EQ(0., std::as_const(sparse).At(sparse.FindBin(5.5, 0.5, 0.5)).SumWeights());
+  auto projection = sparse.Projection({"a1"});
+  EXPECT_EQ(10, projection.size());
+  EXPECT_DOUBLE_EQ(2., projection.At(1).Mean());
+  auto dense = sparse.ToDataContainer();
+  EXPECT_EQ(200, dense.size());
+  EXPECT_EQ(1., dense.At(sparse.FindBin(1.5, 0.5, 2.5)).SumWeights());
+  auto merged = sparse;
+  TList list;
+  list.Add(&sparse);
+  merged.Merge(&list);
+  EXPECT_EQ(2, merged.GetNFilled());
+  EXPECT_EQ(2., merged.At(sparse.FindBin(1.5, 0.5, 2.5)).SumWeights());
+}
+
+TEST(DataContainerTest, LazyFinalize) {
+  // The results read from the bins before the finalization are identical to the finalized ones.
+  Qn::DataContainerStats container;
+  container.AddAxis({"pt", 4, 0., 2.});
+  for (auto &bin : container) bin.SetNumberOfReSamples(10);
+  std::mt19937 gen(3);
+  std::normal_distribution<> value(1., 0.5);
+  std::poisson_distribution<> multiplicity(1.);
+  for (int event = 0; event < 200; ++event) {
+    std::vector<UChar_t> samples(10);
+    for (auto &sample : samples) sample = multiplicity(gen);
+    for (auto &bin : container) bin.FillPoisson(value(gen), 1., samples);
+  }
+  std::vector<double> means;
+  std::vector<double> errors;
+  for (const auto &bin : container) {
+    means.push_back(bin.Mean());
+    errors.push_back(bin.MeanError());
+  }
+  container[0].FillPoisson(value(gen), 1., std::vector<UChar_t>(10, 1));
+  EXPECT_NE(container[0].MeanError(), errors[0]);
+  container.Finalize();
+  for (std::size_t ibin = 1; ibin < container.size(); ++ibin) {
+    EXPECT_TRUE(container[ibin].GetState()==Qn::Stats::State::MEAN_ERROR);
+    EXPECT_EQ(container[ibin].Mean(), means[ibin]);
+    EXPECT_EQ(container[ibin].MeanError(), errors[ibin]);
+  }
+}
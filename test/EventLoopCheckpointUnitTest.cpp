@@ -0,0 +1,134 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "TH1D.h"
+
+#include "EventLoopCheckpoint.h"
+
+namespace {
+constexpr unsigned int kSlots = 2;
+constexpr int kEntries = 100;
+
+/**
+ * Job of an event loop, which fills the entries into one histogram per slot. The entries are distributed over the
+ * slots round robin.
+ */
+struct Job {
+  Qn::EventLoopCheckpoint checkpoint{"checkpoint_test", 10, 0., kSlots};
+  std::vector<std::unique_ptr<TH1D>> histograms;
+
+  Job() {
+    for (unsigned int slot = 0; slot < kSlots; ++slot) {
+      histograms.emplace_back(new TH1D(("entries" + std::to_string(slot)).data(), "", kEntries, 0., kEntries));
+    }
+    checkpoint.Register("entries", [this](unsigned int slot) { return histograms[slot].get(); });
+    checkpoint.Restore();
+  }
+
+  /**
+   * Processes the entries up to last, the entries completed by the previous jobs are skipped.
+   * @return number of processed entries
+   */
+  int Process(int last) {
+    int processed = 0;
+    for (int entry = 0; entry < last; ++entry) {
+      const auto slot = entry%kSlots;
+      if (!checkpoint.Next(slot, entry)) continue;
+      histograms[slot]->Fill(entry + 0.5);
+      ++processed;
+    }
+    return processed;
+  }
+
+  /**
+   * Returns how often an entry is filled in the histograms of this job and in the results of the previous jobs.
+   */
+  double Count(int entry) const {
+    double count = 0.;
+    for (const auto &histogram : histograms) count += histogram->GetBinContent(entry + 1);
+    if (auto restored = dynamic_cast<TH1D *>(checkpoint.GetRestored("entries"))) {
+      count += restored->GetBinContent(entry + 1);
+    }
+    return count;
+  }
+
+  double Restored() const {
+    auto restored = dynamic_cast<TH1D *>(checkpoint.GetRestored("entries"));
+    return restored ? restored->GetEntries() : 0.;
+  }
+};
+}
+
+TEST(EventLoopCheckpointUnitTest, ResumePreemptedJobs) {
+  std::remove("checkpoint_test_checkpoint.txt");
+  {
+    // the first job is preempted after 57 entries. Each slot wrote its checkpoint before its 11th and 21st entry,
+    // which hold the entries 0 to 39.
+    Job job;
+    EXPECT_EQ(job.checkpoint.GetNumberOfCompletedEntries(), 0u);
+    EXPECT_EQ(job.checkpoint.GetRestored("entries"), nullptr);
+    EXPECT_EQ(job.Process(57), 57);
+    EXPECT_THROW(job.checkpoint.Register("late", [](unsigned int) { return nullptr; }), std::logic_error);
+  }
+  {
+    // the second job restores the consistent checkpoint, completes the event loop and is preempted before the
+    // results are written.
+    Job job;
+    EXPECT_EQ(job.checkpoint.GetNumberOfCompletedEntries(), 40u);
+    EXPECT_EQ(job.Restored(), 40.);
+    for (int entry = 0; entry < kEntries; ++entry) EXPECT_EQ(job.checkpoint.IsCompleted(entry), entry < 40) << entry;
+    EXPECT_EQ(job.Process(kEntries), kEntries - 40);
+    for (int entry = 0; entry < kEntries; ++entry) EXPECT_EQ(job.Count(entry), 1.) << entry;
+    for (unsigned int slot = 0; slot < kSlots; ++slot) job.checkpoint.Write(slot);
+  }
+  {
+    // the third job is preempted right after Restore, such that the fourth job restores the merged checkpoint of
+    // the third job, which already contains the results of the previous generations.
+    Job job;
+    EXPECT_EQ(job.checkpoint.GetNumberOfCompletedEntries(), static_cast<ULong64_t>(kEntries));
+  }
+  {
+    Job job;
+    EXPECT_EQ(job.checkpoint.GetNumberOfCompletedEntries(), static_cast<ULong64_t>(kEntries));
+    EXPECT_EQ(job.Restored(), static_cast<double>(kEntries));
+    EXPECT_EQ(job.Process(kEntries), 0);
+    for (int entry = 0; entry < kEntries; ++entry) EXPECT_EQ(job.Count(entry), 1.) << entry;
+    EXPECT_THROW(job.checkpoint.Restore(), std::logic_error);
+    job.checkpoint.Clear();
+  }
+  EXPECT_FALSE(std::ifstream("checkpoint_test_checkpoint.txt").good());
+  Job job;
+  EXPECT_EQ(job.checkpoint.GetNumberOfCompletedEntries(), 0u);
+  job.checkpoint.Clear();
+}
+
+TEST(EventLoopCheckpointUnitTest, UseBeforeRestore) {
+  Qn::EventLoopCheckpoint checkpoint("checkpoint_unrestored", 10, 0., 1);
+  checkpoint.Register("entries", [](unsigned int) { return nullptr; });
+  EXPECT_THROW(checkpoint.Register("entries", [](unsigned int) { return nullptr; }), std::logic_error);
+  EXPECT_THROW(checkpoint.Next(0, 0), std::logic_error);
+  EXPECT_THROW(checkpoint.Write(0), std::logic_error);
+}
@@ -0,0 +1,222 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "BoundedQueue.h"
+#include "EventPipeline.h"
+
+namespace {
+struct Event {
+  int number = -1;
+};
+
+/**
+ * Source of the events 0 to n_events - 1.
+ */
+Qn::EventPipeline<Event>::Source MakeSource(int n_events) {
+  auto next = std::make_shared<int>(0);
+  return [next, n_events](Event &event) {
+    if (*next==n_events) return false;
+    event.number = (*next)++;
+    return true;
+  };
+}
+}
+
+TEST(EventPipelineUnitTest, BoundedQueueCapacity) {
+  Qn::BoundedQueue<int> queue(5);
+  EXPECT_EQ(queue.capacity(), 8u);
+  int value = 0;
+  EXPECT_FALSE(queue.TryPop(value));
+  for (int i = 0; i < 8; ++i) EXPECT_TRUE(queue.TryPush(int(i)));
+  EXPECT_FALSE(queue.TryPush(8));
+  // the ring wraps around after the first round.
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 8; ++i) {
+      ASSERT_TRUE(queue.TryPop(value));
+      EXPECT_EQ(value, 8*round + i);
+      EXPECT_TRUE(queue.TryPush(8*(round + 1) + i));
+    }
+  }
+}
+
+TEST(EventPipelineUnitTest, BoundedQueueConservation) {
+  constexpr int n_producers = 4;
+  constexpr int n_consumers = 4;
+  constexpr int n_elements = 20000;
+  Qn::BoundedQueue<int> queue(16);
+  std::atomic<int> popped{0};
+  std::vector<std::vector<int>> received(n_consumers);
+  std::vector<std::thread> threads;
+  for (int producer = 0; producer < n_producers; ++producer) {
+    threads.emplace_back([&queue, producer]() {
+      for (int i = 0; i < n_elements; ++i) {
+        while (!queue.TryPush(producer*n_elements + i)) std::this_thread::yield();
+      }
+    });
+  }
+  for (int consumer = 0; consumer < n_consumers; ++consumer) {
+    threads.emplace_back([&, consumer]() {
+      int value = 0;
+      while (popped.load() < n_producers*n_elements) {
+        if (queue.TryPop(value)) {
+          received[consumer].push_back(value);
+          ++popped;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+  // every element is received exactly once and the elements of a producer are received in the order of the pushes.
+  std::vector<int> all;
+  for (const auto &elements : received) {
+    std::vector<int> last(n_producers, -1);
+    for (auto element : elements) {
+      auto &previous = last[element/n_elements];
+      EXPECT_GT(element, previous);
+      previous = element;
+    }
+    all.insert(all.end(), elements.begin(), elements.end());
+  }
+  std::sort(all.begin(), all.end());
+  ASSERT_EQ(all.size(), static_cast<std::size_t>(n_producers*n_elements));
+  for (int i = 0; i < n_producers*n_elements; ++i) ASSERT_EQ(all[i], i);
+  int value = 0;
+  EXPECT_FALSE(queue.TryPop(value));
+}
+
+TEST(EventPipelineUnitTest, OrderedStagesKeepSourceOrder) {
+  constexpr int n_events = 5000;
+  constexpr unsigned int n_workers = 4;
+  std::vector<int> corrected;
+  std::vector<int> written;
+  std::vector<std::atomic<int>> correlated(n_events);
+  Qn::EventPipeline<Event> pipeline(4);
+  pipeline.SetSource(MakeSource(n_events))
+      .AddOrderedStage("correction", [&](Event &event) { corrected.push_back(event.number); })
+      .AddOrderedStage("output", [&](Event &event) { written.push_back(event.number); })
+      .AddParallelStage("correlation", [&](unsigned int worker, Event &event) {
+        EXPECT_LT(worker, n_workers);
+        ++correlated[event.number];
+      }, n_workers);
+  EXPECT_THROW(pipeline.AddOrderedStage("late", [](Event &) {}), std::logic_error);
+  EXPECT_EQ(pipeline.Run(), static_cast<unsigned long long>(n_events));
+  ASSERT_EQ(corrected.size(), static_cast<std::size_t>(n_events));
+  ASSERT_EQ(written.size(), static_cast<std::size_t>(n_events));
+  for (int i = 0; i < n_events; ++i) {
+    EXPECT_EQ(corrected[i], i);
+    EXPECT_EQ(written[i], i);
+    EXPECT_EQ(correlated[i].load(), 1);
+  }
+  const auto &statistics = pipeline.GetStatistics();
+  ASSERT_EQ(statistics.size(), 4u);
+  EXPECT_EQ(statistics[0].name, "source");
+  EXPECT_EQ(statistics[3].name, "correlation");
+  EXPECT_EQ(statistics[3].n_workers, n_workers);
+  for (const auto &stage : statistics) EXPECT_EQ(stage.events, static_cast<unsigned long long>(n_events));
+}
+
+TEST(EventPipelineUnitTest, SourceOnly) {
+  constexpr int n_events = 1000;
+  int read = 0;
+  auto source = MakeSource(n_events);
+  Qn::EventPipeline<Event> pipeline(2);
+  pipeline.SetSource([&](Event &event) {
+    if (!source(event)) return false;
+    ++read;
+    return true;
+  });
+  EXPECT_EQ(pipeline.Run(), static_cast<unsigned long long>(n_events));
+  EXPECT_EQ(read, n_events);
+  ASSERT_EQ(pipeline.GetStatistics().size(), 1u);
+  EXPECT_EQ(pipeline.GetStatistics()[0].events, static_cast<unsigned long long>(n_events));
+  Qn::EventPipeline<Event> without_source;
+  EXPECT_THROW(without_source.Run(), std::logic_error);
+}
+
+TEST(EventPipelineUnitTest, ParallelStagesOnly) {
+  constexpr int n_events = 5000;
+  std::vector<std::atomic<int>> first(n_events);
+  std::vector<std::atomic<int>> second(n_events);
+  Qn::EventPipeline<Event> pipeline(8);
+  pipeline.SetSource(MakeSource(n_events))
+      .AddParallelStage("first", [&](unsigned int, Event &event) { ++first[event.number]; }, 3)
+      .AddParallelStage("second", [&](unsigned int, Event &event) {
+        // the second stage sees the event after the first stage has processed it.
+        EXPECT_EQ(first[event.number].load(), 1);
+        ++second[event.number];
+      }, 3);
+  EXPECT_EQ(pipeline.Run(), static_cast<unsigned long long>(n_events));
+  for (int i = 0; i < n_events; ++i) {
+    EXPECT_EQ(first[i].load(), 1);
+    EXPECT_EQ(second[i].load(), 1);
+  }
+}
+
+TEST(EventPipelineUnitTest, StageExceptionStopsPipeline) {
+  constexpr int n_events = 100000;
+  constexpr int failing_event = 50;
+  bool fail = true;
+  std::atomic<int> correlated{0};
+  Qn::EventPipeline<Event> pipeline(4);
+  pipeline.SetSource(MakeSource(n_events))
+      .AddOrderedStage("correction", [](Event &) {})
+      .AddOrderedStage("output", [&](Event &event) {
+        if (fail && event.number==failing_event) throw std::runtime_error("output failed");
+      })
+      .AddParallelStage("correlation", [&](unsigned int, Event &) { ++correlated; }, 2);
+  try {
+    pipeline.Run();
+    FAIL() << "The exception of the stage is not rethrown.";
+  } catch (const std::runtime_error &error) {
+    EXPECT_STREQ(error.what(), "output failed");
+  }
+  // the events before the failing one passed the stage, but the pipeline stopped long before the end of the source.
+  EXPECT_LE(correlated.load(), failing_event);
+  EXPECT_LT(pipeline.GetStatistics()[0].events, static_cast<unsigned long long>(n_events));
+  EXPECT_EQ(pipeline.GetStatistics()[2].events, static_cast<unsigned long long>(failing_event));
+  // the pipeline is reset by the next run.
+  fail = false;
+  pipeline.SetSource(MakeSource(200));
+  correlated = 0;
+  EXPECT_EQ(pipeline.Run(), 200u);
+  EXPECT_EQ(correlated.load(), 200);
+}
+
+TEST(EventPipelineUnitTest, SourceExceptionStopsPipeline) {
+  int next = 0;
+  Qn::EventPipeline<Event> pipeline(4);
+  pipeline.SetSource([&](Event &event) {
+        if (next==30) throw std::runtime_error("read failed");
+        event.number = next++;
+        return true;
+      })
+      .AddParallelStage("correlation", [](unsigned int, Event &) {}, 2);
+  EXPECT_THROW(pipeline.Run(), std::runtime_error);
+  EXPECT_EQ(pipeline.GetStatistics()[0].events, 30u);
+  EXPECT_EQ(pipeline.GetStatistics()[1].events, 30u);
+}
@@ -1,7 +1,16 @@
 
 #include "gtest/gtest.h"
 #include <array>
+#include <bitset>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 #include <QVector.h>
+#include <FlatQVectors.h>
+#include <SinCos.h>
 TEST(QVectorUnitTest, test) {
 //  static constexpr std::array<unsigned char, 8> kharmonicmask = {0x01, // 0000 0001
 //                                                                 0x02, // 0000 0010
@@ -42,4 +51,190 @@ TEST(QVectorUnitTest, test) {
   a.x(1);
   EXPECT_EQ(1, a.x(1));
 
-}
\ No newline at end of file
+}
+TEST(QVectorUnitTest, AddRecurrence) {
+  std::bitset<8> bits;
+  bits.set(0);
+  bits.set(2);
+  bits.set(3);
+  for (unsigned char mult = 1; mult <= 2; ++mult) {
+    Qn::QVector a(bits, Qn::QVector::CorrectionStep::PLAIN);
+    a.SetHarmonicMultiplier(mult);
+    double x[3] = {0., 0., 0.};
+    double y[3] = {0., 0., 0.};
+    const unsigned int harmonics[3] = {1, 3, 4};
+    for (int i = 0; i < 100; ++i) {
+      const double phi = 0.0628*i;
+      a.Add(phi, 0.5, 2.);
+      for (int j = 0; j < 3; ++j) {
+        x[j] += 0.5*2.*std::cos(harmonics[j]*mult*phi);
+        y[j] += 0.5*2.*std::sin(harmonics[j]*mult*phi);
+      }
+    }
+    for (int j = 0; j < 3; ++j) {
+      EXPECT_NEAR(x[j], a.x(harmonics[j]), 1e-4);
+      EXPECT_NEAR(y[j], a.y(harmonics[j]), 1e-4);
+    }
+  }
+}
+
+TEST(QVectorUnitTest, HarmonicSlots) {
+  EXPECT_TRUE(std::is_trivially_copyable<Qn::QVector>::value);
+  std::bitset<8> bits;
+  bits.set(1);
+  bits.set(4);
+  bits.set(7);
+  Qn::QVector a(bits, Qn::QVector::CorrectionStep::PLAIN);
+  a.SetX(2, 1.);
+  a.SetY(5, 2.);
+  a.SetX(8, 3.);
+  Qn::QVector b = a;
+  EXPECT_EQ(1., b.x(2));
+  EXPECT_EQ(2., b.y(5));
+  EXPECT_EQ(3., b.x(8));
+  EXPECT_THROW(b.x(1), std::out_of_range);
+  Qn::QVector c(std::bitset<8>(), Qn::QVector::CorrectionStep::PLAIN);
+  std::memcpy(&c, &a, sizeof(Qn::QVector));
+  EXPECT_EQ(1., c.x(2));
+  EXPECT_EQ(2., c.y(5));
+  EXPECT_EQ(3., c.x(8));
+  std::bitset<8> all;
+  all.set();
+  Qn::QVector d(all, Qn::QVector::CorrectionStep::PLAIN);
+  for (unsigned int h = 1; h <= 8; ++h) d.SetX(h, h);
+  for (unsigned int h = 1; h <= 8; ++h) EXPECT_EQ(h, d.x(h));
+}
+
+TEST(QVectorUnitTest, InPlaceNormalization) {
+  Qn::QVector raw(std::bitset<Qn::QVector::kmaxharmonics>(0b101), Qn::QVector::CorrectionStep::PLAIN);
+  for (int i = 0; i < 20; ++i) raw.Add(0.3*i, 1. + 0.1*i);
+  for (auto norm : {Qn::QVector::Normalization::NONE, Qn::QVector::Normalization::M,
+                    Qn::QVector::Normalization::SQRT_M, Qn::QVector::Normalization::MAGNITUDE}) {
+    const auto copy = raw.Normal(norm);
+    auto q = raw;
+    q.Normalize(norm);
+    const auto denormal = copy.DeNormal();
+    const Qn::QVectorDeNormalView view(copy);
+    for (unsigned int h : {1u, 3u}) {
+      EXPECT_EQ(q.x(h), copy.x(h));
+      EXPECT_EQ(q.y(h), copy.y(h));
+      EXPECT_EQ(view.x(h), denormal.x(h));
+      EXPECT_EQ(view.y(h), denormal.y(h));
+      EXPECT_EQ(Qn::ScalarProduct(view, view, h), Qn::ScalarProduct(denormal, denormal, h));
+    }
+    q.Denormalize();
+    EXPECT_TRUE(q.GetNorm()==Qn::QVector::Normalization::NONE);
+    EXPECT_EQ(q.x(3), denormal.x(3));
+  }
+}
+
+TEST(QVectorUnitTest, Reset) {
+  Qn::QVector q(std::bitset<Qn::QVector::kmaxharmonics>(0b11), Qn::QVector::CorrectionStep::PLAIN);
+  for (int i = 0; i < 10; ++i) q.Add(0.4*i, 1.);
+  q.Normalize(Qn::QVector::Normalization::M);
+  q.Reset();
+  q.SetNormalization(Qn::QVector::Normalization::NONE);
+  q.Add(0.5, 2.);
+  EXPECT_EQ(q.n(), 1);
+  EXPECT_FLOAT_EQ(q.sumweights(), 2.);
+  EXPECT_FLOAT_EQ(q.x(1), 2*std::cos(0.5));
+  EXPECT_FLOAT_EQ(q.y(1), 2*std::sin(0.5));
+  EXPECT_FLOAT_EQ(q.x(2), 2*std::cos(1.));
+  EXPECT_FLOAT_EQ(q.y(2), 2*std::sin(1.));
+}
+
+TEST(QVectorUnitTest, CompactEncoding) {
+  const std::bitset<Qn::QVector::kmaxharmonics> harmonics("00000110");
+  Qn::DataContainerQVector q_vectors;
+  q_vectors.AddAxis({"pt", 5, 0., 1.});
+  std::mt19937 gen(3);
+  std::uniform_real_distribution<> component(-1., 1.);
+  for (std::size_t ibin = 0; ibin < q_vectors.size(); ++ibin) {
+    Qn::QVector q(harmonics, Qn::QVector::CorrectionStep::PLAIN, Qn::QVector::Normalization::M);
+    for (unsigned int h = 2; h <= 3; ++h) {
+      q.SetX(h, component(gen));
+      q.SetY(h, ibin==4 ? 2.5 : component(gen));
+    }
+    q.SetNumberOfContributors(10, 1.5, ibin!=1);
+    q_vectors[ibin] = q;
+  }
+  auto restore = [&q_vectors](const Qn::FlatQVectors &flat) {
+    Qn::DataContainerQVector restored(q_vectors);
+    const auto n_components = flat.GetNumberOfBins()*flat.GetNumberOfHarmonics();
+    std::vector<float> x(flat.GetX());
+    std::vector<float> y(flat.GetY());
+    if (flat.GetEncoding().method==Qn::FlatQVectors::Encoding::Method::kFixedPoint) {
+      x.resize(n_components);
+      y.resize(n_components);
+      Qn::FlatQVectors::Decode(flat.GetXFixed().data(), n_components, flat.GetEncoding().GetStep(), x.data());
+      Qn::FlatQVectors::Decode(flat.GetYFixed().data(), n_components, flat.GetEncoding().GetStep(), y.data());
+    }
+    std::vector<unsigned char> quality(flat.GetNumberOfBins());
+    Qn::FlatQVectors::UnpackQuality(flat.GetQualityBits().data(), quality.size(), quality.data());
+    EXPECT_EQ(quality[1] & Qn::FlatQVectors::kGood, 0);
+    EXPECT_EQ(quality[2] & Qn::FlatQVectors::kGood, Qn::FlatQVectors::kGood);
+    Qn::FlatQVectors::Unpack(x.data(), y.data(), flat.GetN().data(), flat.GetSumW().data(), quality.data(),
+                             restored);
+    return restored;
+  };
+  const auto truncated_encoding = Qn::FlatQVectors::Encoding::FromString("truncated:10");
+  EXPECT_EQ(truncated_encoding.ToString(), "truncated:10");
+  Qn::FlatQVectors truncated(q_vectors, truncated_encoding);
+  truncated.Set(q_vectors);
+  const auto truncated_q = restore(truncated);
+  for (std::size_t ibin = 0; ibin < q_vectors.size(); ++ibin) {
+    EXPECT_EQ(truncated_q[ibin].IsGoodQuality(), q_vectors[ibin].IsGoodQuality());
+    for (unsigned int h = 2; h <= 3; ++h) {
+      const double x = q_vectors[ibin].x(h);
+      EXPECT_NEAR(truncated_q[ibin].x(h), x, truncated_encoding.GetErrorBound()*std::abs(x));
+    }
+  }
+  const auto fixed_encoding = Qn::FlatQVectors::Encoding::FixedPoint(2.);
+  Qn::FlatQVectors fixed(q_vectors, fixed_encoding);
+  fixed.Set(q_vectors);
+  const auto fixed_q = restore(fixed);
+  std::vector<unsigned char> quality(q_vectors.size());
+  Qn::FlatQVectors::UnpackQuality(fixed.GetQualityBits().data(), quality.size(), quality.data());
+  for (std::size_t ibin = 0; ibin < q_vectors.size(); ++ibin) {
+    // the components outside of the range are clamped and flagged.
+    EXPECT_EQ((quality[ibin] & Qn::FlatQVectors::kSaturated)!=0, ibin==4);
+    for (unsigned int h = 2; h <= 3; ++h) {
+      EXPECT_NEAR(fixed_q[ibin].x(h), q_vectors[ibin].x(h), fixed_encoding.GetErrorBound() + 1e-6);
+      if (ibin!=4) EXPECT_NEAR(fixed_q[ibin].y(h), q_vectors[ibin].y(h), fixed_encoding.GetErrorBound() + 1e-6);
+    }
+  }
+  EXPECT_NEAR(fixed_q[4].y(2), 2., 1e-6);
+}
+
+TEST(QVectorUnitTest, FastSinCos) {
+  std::mt19937 gen(5);
+  std::uniform_real_distribution<> angle(-Qn::kFastSinCosMaxAngle, Qn::kFastSinCosMaxAngle);
+  std::vector<double> angles(100000);
+  for (auto &a : angles) a = angle(gen);
+  std::vector<double> sin(angles.size());
+  std::vector<double> cos(angles.size());
+  Qn::SetSinCosMode(Qn::SinCosMode::FAST);
+  EXPECT_TRUE(Qn::GetSinCosMode()==Qn::SinCosMode::FAST);
+  Qn::SinCos(angles.data(), angles.size(), sin.data(), cos.data());
+  for (std::size_t i = 0; i < angles.size(); ++i) {
+    const auto a = static_cast<long double>(angles[i]);
+    EXPECT_NEAR(sin[i], static_cast<double>(std::sin(a)), Qn::kFastSinCosMaxError);
+    EXPECT_NEAR(cos[i], static_cast<double>(std::cos(a)), Qn::kFastSinCosMaxError);
+  }
+  // the Q-vectors built in both modes agree within the rounding of their components.
+  const std::bitset<Qn::QVector::kmaxharmonics> harmonics("00001111");
+  std::uniform_real_distribution<float> phi_distribution(0., 2*M_PI);
+  std::vector<float> phi(1000);
+  for (auto &p : phi) p = phi_distribution(gen);
+  const std::vector<float> weight(phi.size(), 1.f);
+  Qn::QVector fast(harmonics, Qn::QVector::CorrectionStep::PLAIN);
+  fast.AddBatch(phi.data(), nullptr, weight.data(), phi.size());
+  Qn::SetSinCosMode(Qn::SinCosMode::EXACT);
+  Qn::QVector exact(harmonics, Qn::QVector::CorrectionStep::PLAIN);
+  exact.AddBatch(phi.data(), nullptr, weight.data(), phi.size());
+  Qn::SetSinCosMode(Qn::kDefaultSinCosMode);
+  for (unsigned int h = 1; h <= 4; ++h) {
+    EXPECT_NEAR(fast.x(h), exact.x(h), 1e-4);
+    EXPECT_NEAR(fast.y(h), exact.y(h), 1e-4);
+  }
+}
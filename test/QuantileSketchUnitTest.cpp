@@ -0,0 +1,137 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "EqualEntriesBinner.h"
+#include "QuantileSketch.h"
+
+namespace {
+constexpr double kMaxRankError = 0.02;
+
+/**
+ * Exact fraction of the sorted values, which are smaller than a value.
+ */
+double ExactRank(const std::vector<double> &sorted, double value) {
+  const auto position = std::lower_bound(sorted.begin(), sorted.end(), value) - sorted.begin();
+  return static_cast<double>(position)/sorted.size();
+}
+
+/**
+ * Expects the estimated quantiles and ranks of a sketch to lie within the rank error of the exact ones.
+ */
+void ExpectRankError(const Qn::QuantileSketch &sketch, std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  ASSERT_EQ(sketch.N(), values.size());
+  EXPECT_EQ(sketch.Min(), values.front());
+  EXPECT_EQ(sketch.Max(), values.back());
+  EXPECT_EQ(sketch.Quantile(0.), values.front());
+  EXPECT_EQ(sketch.Quantile(1.), values.back());
+  // the compactions and merges conserve the total weight of the values.
+  EXPECT_EQ(sketch.Rank(values.back() + 1.), static_cast<double>(values.size()));
+  for (int i = 1; i < 100; ++i) {
+    const double q = i/100.;
+    EXPECT_NEAR(ExactRank(values, sketch.Quantile(q)), q, kMaxRankError) << q;
+    const auto exact = values[static_cast<std::size_t>(q*values.size())];
+    EXPECT_NEAR(sketch.Rank(exact)/values.size(), ExactRank(values, exact), kMaxRankError) << q;
+  }
+}
+}
+
+TEST(QuantileSketchUnitTest, RankError) {
+  Qn::QuantileSketch sketch;
+  EXPECT_TRUE(std::isnan(sketch.Quantile(0.5)));
+  std::mt19937 gen(3);
+  std::exponential_distribution<double> multiplicity(0.01);
+  std::vector<double> values(200000);
+  for (auto &value : values) {
+    value = multiplicity(gen);
+    sketch.Fill(value);
+  }
+  ExpectRankError(sketch, values);
+  // the memory grows only logarithmically with the number of values.
+  EXPECT_LT(sketch.Size(), 2000u);
+}
+
+TEST(QuantileSketchUnitTest, MergeRankError) {
+  // the sketches of the slots see different distributions, such that the merged quantiles differ from the ones of
+  // each sketch.
+  constexpr int n_sketches = 8;
+  std::vector<Qn::QuantileSketch> sketches;
+  std::vector<double> values;
+  std::mt19937 gen(4);
+  for (int i = 0; i < n_sketches; ++i) {
+    sketches.emplace_back(200, i + 1);
+    std::normal_distribution<double> centrality(10.*i, 1. + i);
+    for (int j = 0; j < 10000*(1 + i%3); ++j) {
+      values.push_back(centrality(gen));
+      sketches.back().Fill(values.back());
+    }
+  }
+  Qn::QuantileSketch merged;
+  merged.Merge(Qn::QuantileSketch());
+  for (const auto &sketch : sketches) merged.Merge(sketch);
+  ExpectRankError(merged, values);
+  EXPECT_LT(merged.Size(), 2000u);
+  // a sketch merged into a filled one gives the same accuracy.
+  Qn::QuantileSketch combined = sketches[0];
+  for (int i = 1; i < n_sketches; ++i) combined.Merge(sketches[i]);
+  ExpectRankError(combined, values);
+}
+
+TEST(QuantileSketchUnitTest, EqualEntriesBinsFromSketch) {
+  constexpr unsigned int n_bins = 10;
+  Qn::QuantileSketch sketch;
+  std::mt19937 gen(5);
+  std::gamma_distribution<double> multiplicity(2., 50.);
+  std::vector<double> values(100000);
+  for (auto &value : values) {
+    value = multiplicity(gen);
+    sketch.Fill(value);
+  }
+  Qn::EqualEntriesBinner binner;
+  const auto exact_edges = binner.CalculateBins(values, n_bins);
+  std::sort(values.begin(), values.end());
+  const auto edges = binner.CalculateBins(sketch, n_bins);
+  ASSERT_EQ(edges.size(), n_bins + 1);
+  EXPECT_EQ(edges.front(), values.front());
+  EXPECT_EQ(edges.back(), exact_edges.back());
+  // the bins of the sketch hold the same fraction of the values as the ones of the exact calculation.
+  for (unsigned int ibin = 0; ibin < n_bins; ++ibin) {
+    EXPECT_LT(edges[ibin], edges[ibin + 1]);
+    const auto fraction = ExactRank(values, edges[ibin + 1]) - ExactRank(values, edges[ibin]);
+    EXPECT_NEAR(fraction, 1./n_bins, kMaxRankError) << ibin;
+    EXPECT_NEAR(ExactRank(values, edges[ibin]), ExactRank(values, exact_edges[ibin]), kMaxRankError) << ibin;
+  }
+  // the bins between the limits hold equal fractions of the values between them.
+  const double low = 50.;
+  const double high = 300.;
+  const auto limited_edges = binner.CalculateBins(sketch, n_bins, low, high);
+  ASSERT_EQ(limited_edges.size(), n_bins + 1);
+  EXPECT_EQ(limited_edges.front(), low);
+  EXPECT_EQ(limited_edges.back(), high);
+  const auto fraction_in_limits = ExactRank(values, high) - ExactRank(values, low);
+  for (unsigned int ibin = 0; ibin < n_bins; ++ibin) {
+    const auto fraction = ExactRank(values, limited_edges[ibin + 1]) - ExactRank(values, limited_edges[ibin]);
+    EXPECT_NEAR(fraction, fraction_in_limits/n_bins, kMaxRankError) << ibin;
+  }
+}
@@ -2,6 +2,10 @@
 // Created by Lukas Kreis on 18.04.18.
 //
 #include <random>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <set>
 #include <TPaveText.h>
 #include <TLegend.h>
 #include <algorithm>
@@ -11,6 +15,50 @@
 #include "TCanvas.h"
 #include "TAxis.h"
 #include "ReSamples.h"
+#include "ReSampler.h"
+#include "StatisticArray.h"
+#include "Stats.h"
+
+namespace {
+void ExpectEqualStatistic(const Qn::Statistic &statistic, const Qn::Statistic &expected) {
+  EXPECT_EQ(statistic.SumWeights(), expected.SumWeights());
+  EXPECT_EQ(statistic.Mean(), expected.Mean());
+  EXPECT_EQ(statistic.SumSq(), expected.SumSq());
+  EXPECT_EQ(statistic.Neff(), expected.Neff());
+  EXPECT_EQ(statistic.Entries(), expected.Entries());
+  EXPECT_EQ(statistic.Min(), expected.Min());
+  EXPECT_EQ(statistic.Max(), expected.Max());
+}
+
+void ExpectNearStatistic(const Qn::Statistic &statistic, const Qn::Statistic &expected, double tolerance) {
+  auto near = [tolerance](double value, double expected_value) {
+    EXPECT_NEAR(value, expected_value, tolerance*std::max(1., std::fabs(expected_value)));
+  };
+  near(statistic.SumWeights(), expected.SumWeights());
+  near(statistic.Mean(), expected.Mean());
+  near(statistic.SumSq(), expected.SumSq());
+  near(statistic.Neff(), expected.Neff());
+  EXPECT_EQ(statistic.Entries(), expected.Entries());
+}
+
+/**
+ * Fills the events into the array and into a vector of statistics, which was the storage of the samples before the
+ * structure of arrays.
+ */
+void FillBoth(Qn::StatisticArray &array, std::vector<Qn::Statistic> &statistics, std::mt19937 &gen,
+              unsigned int n_events) {
+  std::normal_distribution<> distribution(1., 0.5);
+  std::uniform_real_distribution<> weights(0.5, 2.);
+  std::uniform_int_distribution<std::size_t> sample(0, statistics.size() - 1);
+  for (unsigned int i = 0; i < n_events; ++i) {
+    const auto value = distribution(gen);
+    const auto weight = weights(gen);
+    const auto id = sample(gen);
+    array.Fill(id, value, weight);
+    statistics[id].Fill(value, weight);
+  }
+}
+}
 
 TEST(ReSampleUnitTest, test) {
 
@@ -233,4 +281,397 @@ TEST(ReSampleUnitTest, Bagging) {
     }
 //    samples.
   }
-}
\ No newline at end of file
+}
+TEST(ReSampleUnitTest, StatisticArrayStorage) {
+  const std::size_t nsamples = 37;
+  std::mt19937 gen(1);
+  Qn::StatisticArray array(nsamples);
+  std::vector<Qn::Statistic> statistics(nsamples);
+  FillBoth(array, statistics, gen, 5000);
+  ASSERT_EQ(array.size(), nsamples);
+  for (std::size_t i = 0; i < nsamples; ++i) ExpectEqualStatistic(array.Get(i), statistics[i]);
+  Qn::StatisticArray other(nsamples);
+  std::vector<Qn::Statistic> other_statistics(nsamples);
+  FillBoth(other, other_statistics, gen, 3000);
+  array.MergeInto(other);
+  for (std::size_t i = 0; i < nsamples; ++i) {
+    Qn::MergeInto(statistics[i], other_statistics[i]);
+    ExpectEqualStatistic(array.Get(i), statistics[i]);
+  }
+  array.Append(other);
+  ASSERT_EQ(array.size(), 2*nsamples);
+  for (std::size_t i = 0; i < nsamples; ++i) ExpectEqualStatistic(array.Get(nsamples + i), other_statistics[i]);
+  array.resize(nsamples + 1);
+  ExpectEqualStatistic(array.Get(nsamples), other_statistics[0]);
+  array.resize(nsamples + 2);
+  ExpectEqualStatistic(array.Get(nsamples + 1), Qn::Statistic());
+}
+
+TEST(ReSampleUnitTest, StatisticArrayReadRule) {
+  // The read rule of ReSamples version 2 converts the vector of statistics on file with StatisticArray::Assign.
+  const std::size_t nsamples = 11;
+  std::mt19937 gen(2);
+  Qn::StatisticArray filled(nsamples);
+  std::vector<Qn::Statistic> onfile(nsamples);
+  FillBoth(filled, onfile, gen, 1000);
+  Qn::StatisticArray read(3);
+  read.Assign(onfile);
+  ASSERT_EQ(read.size(), nsamples);
+  std::vector<Qn::Statistic> written(nsamples);
+  for (std::size_t i = 0; i < nsamples; ++i) {
+    ExpectEqualStatistic(read.Get(i), onfile[i]);
+    written[i] = read.Get(i);
+  }
+  Qn::StatisticArray reread;
+  reread.Assign(written);
+  for (std::size_t i = 0; i < nsamples; ++i) ExpectEqualStatistic(reread.Get(i), onfile[i]);
+  // the read samples are filled further like the samples filled in memory.
+  std::vector<Qn::Statistic> unused(nsamples);
+  FillBoth(read, unused, gen, 500);
+  gen.seed(3);
+  FillBoth(filled, onfile, gen, 500);
+  gen.seed(3);
+  Qn::StatisticArray refilled;
+  refilled.Assign(written);
+  FillBoth(refilled, written, gen, 500);
+  for (std::size_t i = 0; i < nsamples; ++i) ExpectEqualStatistic(refilled.Get(i), filled.Get(i));
+}
+
+TEST(ReSampleUnitTest, FillMultiplicities) {
+  const std::size_t nsamples = 23;
+  std::mt19937 gen(4);
+  std::normal_distribution<> distribution(1., 0.5);
+  std::uniform_real_distribution<> weights(0.5, 2.);
+  std::poisson_distribution<> poisson(1.);
+  for (auto accumulation : {Qn::Statistic::Accumulation::kIncremental, Qn::Statistic::Accumulation::kRawMoments,
+                            Qn::Statistic::Accumulation::kCompensatedRawMoments}) {
+    Qn::StatisticArray weighted(nsamples);
+    Qn::StatisticArray repeated(nsamples);
+    weighted.SetAccumulation(accumulation);
+    repeated.SetAccumulation(accumulation);
+    std::vector<std::uint8_t> multiplicities(nsamples);
+    for (int event = 0; event < 2000; ++event) {
+      const auto value = distribution(gen);
+      const auto weight = weights(gen);
+      for (auto &multiplicity : multiplicities) multiplicity = poisson(gen);
+      multiplicities[event%nsamples] = 0;
+      weighted.FillMultiplicities(value, weight, multiplicities);
+      for (std::size_t i = 0; i < nsamples; ++i) {
+        for (unsigned int k = 0; k < multiplicities[i]; ++k) repeated.Fill(i, value, weight);
+      }
+    }
+    for (std::size_t i = 0; i < nsamples; ++i) {
+      ExpectNearStatistic(weighted.Get(i), repeated.Get(i), 1e-10);
+      if (accumulation==Qn::Statistic::Accumulation::kIncremental) {
+        EXPECT_EQ(weighted.Get(i).Min(), repeated.Get(i).Min());
+        EXPECT_EQ(weighted.Get(i).Max(), repeated.Get(i).Max());
+      }
+    }
+  }
+}
+
+TEST(ReSampleUnitTest, RawMoments) {
+  // The raw moments lose the precision of the variance, when the mean is large compared to the standard deviation.
+  // The compensated sums keep it.
+  struct Case {
+    double mean;
+    double sigma;
+    double raw_tolerance;
+    double compensated_tolerance;
+  };
+  for (const auto &test : {Case{1., 0.5, 1e-10, 1e-10}, Case{1e4, 1., 1e-5, 1e-7}}) {
+    const std::size_t nsamples = 4;
+    std::mt19937 gen(5);
+    std::normal_distribution<> distribution(test.mean, test.sigma);
+    std::uniform_real_distribution<> weights(0.5, 2.);
+    Qn::StatisticArray incremental(nsamples);
+    Qn::StatisticArray raw(nsamples);
+    Qn::StatisticArray compensated(nsamples);
+    raw.SetAccumulation(Qn::Statistic::Accumulation::kRawMoments);
+    compensated.SetAccumulation(Qn::Statistic::Accumulation::kCompensatedRawMoments);
+    for (int event = 0; event < 100000; ++event) {
+      const auto value = distribution(gen);
+      const auto weight = weights(gen);
+      const auto id = event%nsamples;
+      incremental.Fill(id, value, weight);
+      raw.Fill(id, value, weight);
+      compensated.Fill(id, value, weight);
+    }
+    for (std::size_t i = 0; i < nsamples; ++i) {
+      const auto expected = incremental.Get(i);
+      EXPECT_NEAR(raw.Get(i).Mean(), expected.Mean(), 1e-12*test.mean);
+      EXPECT_NEAR(compensated.Get(i).Mean(), expected.Mean(), 1e-12*test.mean);
+      EXPECT_NEAR(raw.Get(i).Variance(), expected.Variance(), test.raw_tolerance*expected.Variance());
+      EXPECT_NEAR(compensated.Get(i).Variance(), expected.Variance(),
+                  test.compensated_tolerance*expected.Variance());
+      EXPECT_EQ(raw.Get(i).SumWeights(), expected.SumWeights());
+      EXPECT_EQ(raw.Get(i).Entries(), expected.Entries());
+    }
+    // the merge of the raw moments is the sum of the fields.
+    auto merged = raw;
+    merged.MergeInto(raw);
+    auto merged_incremental = incremental;
+    merged_incremental.MergeInto(incremental);
+    for (std::size_t i = 0; i < nsamples; ++i) {
+      EXPECT_NEAR(merged.Get(i).Mean(), merged_incremental.Get(i).Mean(), 1e-12*test.mean);
+      EXPECT_NEAR(merged.Get(i).SumSq(), merged_incremental.Get(i).SumSq(),
+                  test.raw_tolerance*merged_incremental.Get(i).SumSq());
+    }
+  }
+}
+
+TEST(ReSampleUnitTest, CompactStorage) {
+  const std::size_t nsamples = 19;
+  std::mt19937 gen(6);
+  std::normal_distribution<> distribution(1., 0.5);
+  std::uniform_real_distribution<> weights(0.5, 2.);
+  std::poisson_distribution<> poisson(1.);
+  Qn::StatisticArray full(nsamples);
+  Qn::StatisticArray sums(nsamples, Qn::StatisticArray::Storage::kSums);
+  Qn::StatisticArray sums_float(nsamples, Qn::StatisticArray::Storage::kSumsFloat);
+  std::vector<UChar_t> multiplicities(nsamples);
+  for (int event = 0; event < 10000; ++event) {
+    const auto value = distribution(gen);
+    const auto weight = weights(gen);
+    for (auto &multiplicity : multiplicities) multiplicity = poisson(gen);
+    full.FillMultiplicities(value, weight, multiplicities);
+    sums.FillMultiplicities(value, weight, multiplicities);
+    sums_float.FillMultiplicities(value, weight, multiplicities);
+    full.Fill(event%nsamples, value, weight);
+    sums.Fill(event%nsamples, value, weight);
+    sums_float.Fill(event%nsamples, value, weight);
+  }
+  auto expect_near = [&](const Qn::StatisticArray &full, const Qn::StatisticArray &sums,
+                         const Qn::StatisticArray &sums_float) {
+    for (std::size_t i = 0; i < nsamples; ++i) {
+      EXPECT_NEAR(sums.Mean(i), full.Mean(i), 1e-12);
+      EXPECT_NEAR(sums.SumWeights(i), full.SumWeights(i), 1e-12*full.SumWeights(i));
+      EXPECT_NEAR(sums_float.Mean(i), full.Mean(i), 1e-4);
+      EXPECT_NEAR(sums_float.SumWeights(i), full.SumWeights(i), 1e-5*full.SumWeights(i));
+      EXPECT_NEAR(sums.Get(i).Mean(), full.Mean(i), 1e-12);
+    }
+  };
+  expect_near(full, sums, sums_float);
+  auto merged_full = full;
+  auto merged_sums = sums;
+  auto merged_float = sums_float;
+  merged_full.MergeInto(full);
+  merged_sums.MergeInto(sums);
+  merged_float.MergeInto(sums_float);
+  expect_near(merged_full, merged_sums, merged_float);
+  auto converted = full;
+  converted.SetStorage(Qn::StatisticArray::Storage::kSums);
+  expect_near(full, converted, sums_float);
+  EXPECT_LT(Qn::StatisticArray::EstimateHeapBytes(nsamples, Qn::StatisticArray::Storage::kSumsFloat,
+                                                  Qn::Statistic::Accumulation::kIncremental),
+            Qn::StatisticArray::EstimateHeapBytes(nsamples, Qn::StatisticArray::Storage::kSums,
+                                                  Qn::Statistic::Accumulation::kIncremental));
+}
+
+TEST(ReSampleUnitTest, PhiloxStreams) {
+  // known answers of the Philox4x32-10 generator of Random123.
+  using Counter = std::array<std::uint32_t, 4>;
+  EXPECT_EQ(Qn::Correlation::Impl::Philox4x32({0, 0, 0, 0}, {0, 0}),
+            (Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}));
+  EXPECT_EQ(Qn::Correlation::Impl::Philox4x32({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff},
+                                              {0xffffffff, 0xffffffff}),
+            (Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}));
+  EXPECT_EQ(Qn::Correlation::Impl::Philox4x32({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+                                              {0xa4093822, 0x299f31d0}),
+            (Counter{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}));
+  const std::size_t nsamples = 101;
+  const Qn::Correlation::ReSampler sampler(nsamples, 42);
+  const Qn::Correlation::ReSampler same_seed(nsamples, 42);
+  const Qn::Correlation::ReSampler other_seed(nsamples, 43);
+  const Qn::Correlation::ReSampler fewer_samples(10, 42);
+  // the multiplicities only depend on the seed and the entry, not on the order of the events.
+  std::vector<std::vector<UChar_t>> forward;
+  for (ULong64_t entry = 0; entry < 100; ++entry) {
+    const auto multiplicities = sampler(entry);
+    forward.emplace_back(multiplicities.begin(), multiplicities.end());
+  }
+  for (ULong64_t entry = 100; entry-- > 0;) {
+    const auto multiplicities = same_seed(entry);
+    EXPECT_EQ(std::vector<UChar_t>(multiplicities.begin(), multiplicities.end()), forward[entry]);
+    const auto first = fewer_samples(entry);
+    EXPECT_TRUE(std::equal(first.begin(), first.end(), forward[entry].begin()));
+  }
+  std::size_t equal = 0;
+  for (ULong64_t entry = 0; entry < 100; ++entry) {
+    const auto multiplicities = other_seed(entry);
+    equal += std::equal(multiplicities.begin(), multiplicities.end(), forward[entry].begin());
+  }
+  EXPECT_EQ(equal, 0);
+  EXPECT_NE(forward[0], forward[1]);
+  // the multiplicities of a slot are written to the buffer of the slot.
+  Qn::Correlation::ReSampler slots(nsamples, 42);
+  const auto view = slots(0u, 7);
+  EXPECT_EQ(std::vector<UChar_t>(view.begin(), view.end()), forward[7]);
+}
+
+TEST(ReSampleUnitTest, PoissonMultiplicities) {
+  // the multiplicities are Poisson(1) distributed and bounded by the size of the table, which fits into UChar_t.
+  const auto &table = Qn::Correlation::Impl::PoissonTable::Get();
+  EXPECT_TRUE(std::is_sorted(table.begin(), table.end()));
+  EXPECT_EQ(table.back(), 0xffffffffu);
+  EXPECT_LE(Qn::Correlation::Impl::PoissonTable::kSize, std::numeric_limits<UChar_t>::max());
+  const std::size_t nsamples = 1000;
+  const Qn::Correlation::ReSampler sampler(nsamples, 7);
+  std::vector<UChar_t> multiplicities(nsamples);
+  std::array<double, Qn::Correlation::Impl::PoissonTable::kSize + 1> counts{};
+  const ULong64_t n_events = 2000;
+  for (ULong64_t entry = 0; entry < n_events; ++entry) {
+    sampler.Generate(entry, multiplicities.data());
+    for (const auto multiplicity : multiplicities) {
+      ASSERT_LE(multiplicity, Qn::Correlation::Impl::PoissonTable::kSize);
+      ++counts[multiplicity];
+    }
+  }
+  // the largest multiplicity is reached for the largest random number.
+  unsigned int multiplicity = 0;
+  for (const auto threshold : table) multiplicity += 0xffffffffu >= threshold;
+  EXPECT_EQ(multiplicity, Qn::Correlation::Impl::PoissonTable::kSize);
+  const double n = nsamples*n_events;
+  double probability = std::exp(-1.);
+  for (unsigned int k = 0; k < 5; ++k) {
+    EXPECT_NEAR(counts[k]/n, probability, 5*std::sqrt(probability/n));
+    probability /= k + 1;
+  }
+}
+
+TEST(ReSampleUnitTest, SubSampleMerging) {
+  const unsigned int nsamples = 8;
+  auto make = [nsamples]() {
+    Qn::ReSamples samples;
+    samples.SetMethod(Qn::ReSamples::Method::kSubSamples);
+    samples.SetNumberOfSamples(nsamples);
+    return samples;
+  };
+  auto slot_a = make();
+  auto slot_b = make();
+  auto serial = make();
+  const Qn::Correlation::SubSampler sub_sampler(nsamples, 3);
+  std::mt19937 gen(8);
+  std::normal_distribution<> distribution(1., 0.5);
+  std::set<ULong64_t> filled_a;
+  for (ULong64_t entry = 0; entry < 1000; ++entry) {
+    const auto value = distribution(gen);
+    const auto sample = sub_sampler(entry);
+    ASSERT_LT(sample, nsamples);
+    // the slot a only processes the first events, such that some of its sub-samples may be empty.
+    if (entry < 5) {
+      slot_a.FillSample(value, 1., sample);
+      filled_a.insert(sample);
+    } else {
+      slot_b.FillSample(value, 1., sample);
+    }
+    serial.FillSample(value, 1., sample);
+  }
+  EXPECT_LT(filled_a.size(), nsamples);
+  Qn::ReSamples::MergeStatisticsInto(slot_a, slot_b);
+  EXPECT_EQ(slot_a.GetMethod(), Qn::ReSamples::Method::kSubSamples);
+  slot_a.CalculateMeans();
+  serial.CalculateMeans();
+  ASSERT_EQ(slot_a.size(), nsamples);
+  for (unsigned int i = 0; i < nsamples; ++i) {
+    EXPECT_NEAR(slot_a.GetSampleMean(i), serial.GetSampleMean(i), 1e-12);
+  }
+  const auto merged_ci = slot_a.GetConfidenceInterval(1., Qn::ReSamples::CIMethod::normal);
+  const auto serial_ci = serial.GetConfidenceInterval(1., Qn::ReSamples::CIMethod::normal);
+  EXPECT_NEAR(merged_ci.lower_limit, serial_ci.lower_limit, 1e-12);
+  EXPECT_NEAR(merged_ci.upper_limit, serial_ci.upper_limit, 1e-12);
+  // an empty merge target takes over the method of the merged sub-samples.
+  Qn::ReSamples empty;
+  Qn::ReSamples::MergeStatisticsInto(empty, slot_b);
+  EXPECT_EQ(empty.GetMethod(), Qn::ReSamples::Method::kSubSamples);
+}
+
+TEST(ReSampleUnitTest, SubSampleConfidenceInterval) {
+  // the interval of the filled sub-samples is scaled by 1/sqrt(n).
+  Qn::ReSamples samples;
+  samples.SetMethod(Qn::ReSamples::Method::kSubSamples);
+  samples.SetNumberOfSamples(6);
+  const std::array<double, 4> means{{0., 2., 0., 2.}};
+  for (unsigned int i = 0; i < means.size(); ++i) samples.FillSample(means[i], 1., i);
+  samples.CalculateMeans();
+  const auto ci = samples.GetConfidenceInterval(1., Qn::ReSamples::CIMethod::normal);
+  const double stddev = std::sqrt(4./3.);
+  EXPECT_NEAR(ci.lower_limit, 1. - stddev/2., 1e-12);
+  EXPECT_NEAR(ci.upper_limit, 1. + stddev/2., 1e-12);
+}
+
+TEST(ReSampleUnitTest, ConfidenceIntervalSelection) {
+  // reference of the intervals by sorting a copy of the sample means.
+  auto reference = [](std::vector<double> means, double mean, Qn::ReSamples::CIMethod method) {
+    const double alpha = 0.3173;
+    const auto n = means.size();
+    std::sort(means.begin(), means.end());
+    const auto low = means[static_cast<std::size_t>(std::round(n*alpha/2.))];
+    const auto high = means[static_cast<std::size_t>(std::floor(n*(1 - alpha/2.)))];
+    if (method==Qn::ReSamples::CIMethod::percentile) return Qn::ConfidenceInterval{low, high};
+    return Qn::ConfidenceInterval{2*mean - high, 2*mean - low};
+  };
+  std::mt19937 gen(9);
+  std::normal_distribution<> distribution(1., 0.5);
+  std::poisson_distribution<> poisson(1.);
+  for (const unsigned int nsamples : {1u, 2u, 7u, 100u, 1001u}) {
+    Qn::ReSamples samples(nsamples);
+    std::vector<std::size_t> multiplicities(nsamples);
+    for (int event = 0; event < 200; ++event) {
+      for (auto &multiplicity : multiplicities) multiplicity = poisson(gen);
+      samples.FillPoisson({distribution(gen), true, 1.}, multiplicities);
+    }
+    samples.CalculateMeans();
+    const auto means = samples.GetMeans();
+    for (const auto method : {Qn::ReSamples::CIMethod::percentile, Qn::ReSamples::CIMethod::pivot}) {
+      const auto expected = reference(means, 1.1, method);
+      const auto ci = samples.GetConfidenceInterval(1.1, method);
+      EXPECT_EQ(ci.lower_limit, expected.lower_limit);
+      EXPECT_EQ(ci.upper_limit, expected.upper_limit);
+      // the means are not reordered by the selection and the cached interval is returned again.
+      EXPECT_EQ(samples.GetMeans(), means);
+      const auto cached = samples.GetConfidenceInterval(1.1, method);
+      EXPECT_EQ(cached.lower_limit, ci.lower_limit);
+      EXPECT_EQ(cached.upper_limit, ci.upper_limit);
+    }
+    // the cache is reset, when the means change.
+    const auto before = samples.GetConfidenceInterval(1.1, Qn::ReSamples::CIMethod::percentile);
+    samples *= 2.;
+    const auto after = samples.GetConfidenceInterval(1.1, Qn::ReSamples::CIMethod::percentile);
+    EXPECT_EQ(after.lower_limit, 2*before.lower_limit);
+    EXPECT_EQ(after.upper_limit, 2*before.upper_limit);
+  }
+  Qn::ReSamples empty(0);
+  EXPECT_THROW(empty.GetConfidenceInterval(1., Qn::ReSamples::CIMethod::percentile), std::out_of_range);
+}
+
+TEST(ReSampleUnitTest, AdaptiveNumberOfSamples) {
+  // The means of the samples alternate between -1 and 1, such that the width of the normal interval of the first n
+  // samples is 2 sqrt(n/(n-1)). The widths of 2, 4, 8, 16 and 32 samples differ from the width of all 64 samples
+  // by 40%, 15%, 6%, 2.5% and 0.8%.
+  Qn::ReSamples samples(64);
+  for (unsigned int i = 0; i < samples.size(); ++i) samples.FillSample(i%2 ? 1. : -1., 1., i);
+  const auto method = Qn::ReSamples::CIMethod::normal;
+  EXPECT_EQ(samples.ConvergedNumberOfSamples(0., 0.5, 2, method), 2);
+  EXPECT_EQ(samples.ConvergedNumberOfSamples(0., 0.1, 2, method), 8);
+  EXPECT_EQ(samples.ConvergedNumberOfSamples(0., 0.03, 2, method), 16);
+  EXPECT_EQ(samples.ConvergedNumberOfSamples(0., 0.01, 2, method), 32);
+  EXPECT_EQ(samples.ConvergedNumberOfSamples(0., 0.03, 32, method), 32);
+  // not converged
+  EXPECT_EQ(samples.ConvergedNumberOfSamples(0., 0.001, 2, method), 64);
+  // the widths of all larger numbers of samples need to agree. With the amplitude a = sqrt(0.7) of the first 4
+  // samples and the means 0 of the next 4 samples, the width of the first 4 samples agrees with the width of all
+  // samples, but the widths of the first 8 and 16 samples differ by 35% and 12%.
+  Qn::ReSamples non_monotonic(64);
+  for (unsigned int i = 0; i < non_monotonic.size(); ++i) {
+    const double amplitude = i < 4 ? std::sqrt(0.7) : (i < 8 ? 0. : 1.);
+    non_monotonic.FillSample(i%2 ? amplitude : -amplitude, 1., i);
+  }
+  EXPECT_EQ(non_monotonic.ConvergedNumberOfSamples(0., 0.05, 2, method), 32);
+  // adaptive truncation of the resamples of a Stats
+  Qn::Stats stats;
+  stats.SetNumberOfReSamples(64);
+  for (unsigned int i = 0; i < 64; ++i) stats.FillSubSample(i%2 ? 1. : -1., 1., i);
+  stats.TruncateReSamples(stats.ConvergedNumberOfReSamples(0.03, 2));
+  EXPECT_EQ(stats.GetNSamples(), 16);
+}
@@ -0,0 +1,100 @@
+// Flow Vector Correction Framework
+//
+// Copyright (C) 2019  Lukas Kreis, Ilya Selyuzhenkov
+// Contact: l.kreis@gsi.de; ilya.selyuzhenkov@gmail.com
+// For a full list of contributors please see docs/Credits
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "TFile.h"
+#include "TH1D.h"
+#include "TList.h"
+
+#include "ResultFileMerger.h"
+
+namespace {
+TH1D *MakeHistogram(const std::string &name, double x) {
+  auto histogram = new TH1D(name.data(), "", 4, 0., 4.);
+  histogram->Fill(x);
+  return histogram;
+}
+
+/**
+ * Writes the corrections of the runs and the QA histograms of a job.
+ */
+void WriteJob(const std::string &file_name, const std::vector<std::string> &runs, const std::string &qa, double x) {
+  TFile file(file_name.data(), "RECREATE");
+  TList corrections;
+  corrections.SetName("corrections");
+  corrections.SetOwner(true);
+  for (const auto &run : runs) {
+    auto list = new TList();
+    list->SetName(run.data());
+    list->SetOwner(true);
+    list->Add(MakeHistogram("recentering", x));
+    corrections.Add(list);
+  }
+  corrections.Add(MakeHistogram("all", x));
+  corrections.Write("corrections", TObject::kSingleKey);
+  std::unique_ptr<TH1D> histogram(MakeHistogram(qa, x));
+  histogram->Write(qa.data());
+  file.Close();
+}
+}
+
+TEST(ResultFileMergerUnitTest, DisjointRuns) {
+  WriteJob("merger_job1.root", {"run1", "run2"}, "qa_job1", 0.5);
+  WriteJob("merger_job2.root", {"run3"}, "qa_job2", 1.5);
+  WriteJob("merger_job3.root", {"run3", "run4"}, "qa_job2", 2.5);
+  const std::vector<std::string> jobs{"merger_job1.root", "merger_job2.root", "merger_job3.root"};
+  // once in a single batch and once in batches of one file, in which the objects missing in the result appear in
+  // the later batches.
+  for (std::size_t batch : {3u, 1u}) {
+    Qn::ResultFileMerger merger(2);
+    for (std::size_t first = 0; first < jobs.size(); first += batch) {
+      merger.MergeBatch(std::vector<std::string>(jobs.begin() + first, jobs.begin() + first + batch));
+    }
+    merger.Write("merger_merged.root");
+    TFile file("merger_merged.root", "READ");
+    std::unique_ptr<TList> corrections(dynamic_cast<TList *>(file.Get("corrections")));
+    ASSERT_NE(corrections, nullptr);
+    EXPECT_EQ(corrections->GetEntries(), 5);
+    const std::vector<std::pair<std::string, std::vector<double>>> runs{
+        {"run1", {0.5}}, {"run2", {0.5}}, {"run3", {1.5, 2.5}}, {"run4", {2.5}}};
+    for (const auto &run : runs) {
+      auto list = dynamic_cast<TList *>(corrections->FindObject(run.first.data()));
+      ASSERT_NE(list, nullptr) << run.first;
+      auto histogram = dynamic_cast<TH1D *>(list->FindObject("recentering"));
+      ASSERT_NE(histogram, nullptr) << run.first;
+      EXPECT_EQ(histogram->GetEntries(), static_cast<double>(run.second.size())) << run.first;
+      for (auto x : run.second) EXPECT_EQ(histogram->GetBinContent(histogram->GetXaxis()->FindBin(x)), 1.) << run.first;
+    }
+    auto all = dynamic_cast<TH1D *>(corrections->FindObject("all"));
+    ASSERT_NE(all, nullptr);
+    EXPECT_EQ(all->GetEntries(), 3.);
+    std::unique_ptr<TH1D> qa_job1(dynamic_cast<TH1D *>(file.Get("qa_job1")));
+    std::unique_ptr<TH1D> qa_job2(dynamic_cast<TH1D *>(file.Get("qa_job2")));
+    ASSERT_NE(qa_job1, nullptr);
+    ASSERT_NE(qa_job2, nullptr);
+    EXPECT_EQ(qa_job1->GetEntries(), 1.);
+    EXPECT_EQ(qa_job2->GetEntries(), 2.);
+  }
+  for (const auto &job : jobs) std::remove(job.data());
+  std::remove("merger_merged.root");
+}
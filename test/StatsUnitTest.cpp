@@ -1,10 +1,15 @@
 
+#include <cstdio>
 #include <random>
+#include <stdexcept>
 #include <algorithm>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "DataContainer.h"
 #include "Stats.h"
-#include "Sampler.h"
+#include "StatsColumnarFile.h"
+#include "StatsFillBatch.h"
 #include "TH1F.h"
 #include "TCanvas.h"
 #include "TF1.h"
@@ -67,4 +72,109 @@ TEST(StatsUnitTest, Merging) {
   EXPECT_NEAR(op_merged.MeanError(),truth.MeanError(),truth.MeanError()*0.001);
   EXPECT_NEAR(noop_merged.MeanError(), truth.MeanError(),truth.MeanError()*0.001);
 
-}
\ No newline at end of file
+}
+
+TEST(StatsUnitTest, FillBatch) {
+  // Filling the events in batches bin by bin gives the same result as filling every event directly.
+  constexpr std::size_t n_bins = 5;
+  constexpr std::size_t n_samples = 20;
+  std::vector<Qn::Stats> direct(n_bins);
+  std::vector<Qn::Stats> batched(n_bins);
+  for (std::size_t ibin = 0; ibin < n_bins; ++ibin) {
+    direct[ibin].SetNumberOfReSamples(n_samples);
+    batched[ibin].SetNumberOfReSamples(n_samples);
+  }
+  Qn::StatsFillBatch batch(7);
+  Qn::CorrelationResultBuffer results;
+  results.Resize(n_bins);
+  std::mt19937 gen(42);
+  std::normal_distribution<> value(1., 0.5);
+  std::poisson_distribution<> multiplicity(1.);
+  std::bernoulli_distribution valid(0.8);
+  for (int event = 0; event < 100; ++event) {
+    results.Invalidate();
+    for (std::size_t ibin = 0; ibin < n_bins; ++ibin) results.Set(ibin, value(gen), valid(gen), 1. + event%3);
+    std::vector<UChar_t> samples(n_samples);
+    for (auto &sample : samples) sample = multiplicity(gen);
+    Qn::Stats::FillPoisson(direct.data(), results, samples);
+    batch.Add(batched.data(), results, samples);
+  }
+  batch.Flush();
+  EXPECT_EQ(batch.GetNumberOfEvents(), 0);
+  for (std::size_t ibin = 0; ibin < n_bins; ++ibin) {
+    direct[ibin].CalculateMeanAndError();
+    batched[ibin].CalculateMeanAndError();
+    EXPECT_EQ(direct[ibin].N(), batched[ibin].N());
+    EXPECT_EQ(direct[ibin].Mean(), batched[ibin].Mean());
+    for (std::size_t i = 0; i < n_samples; ++i) {
+      EXPECT_EQ(direct[ibin].GetReSamples().GetSampleMean(i), batched[ibin].GetReSamples().GetSampleMean(i));
+    }
+  }
+}
+
+TEST(StatsUnitTest, ColumnarFileRoundTrip) {
+  // The bins read from the columnar file agree with the written bins after CalculateMeanAndError.
+  constexpr std::size_t n_samples = 10;
+  Qn::DataContainerStats written({{"pt", 3, 0., 3.}, {"eta", 2, -1., 1.}});
+  for (auto &bin : written) bin.SetNumberOfReSamples(n_samples);
+  std::mt19937 gen(7);
+  std::normal_distribution<> value(1., 0.5);
+  std::poisson_distribution<> multiplicity(1.);
+  for (int event = 0; event < 200; ++event) {
+    std::vector<UChar_t> samples(n_samples);
+    for (auto &sample : samples) sample = multiplicity(gen);
+    // the last bin stays empty.
+    for (std::size_t ibin = 0; ibin + 1 < written.size(); ++ibin) {
+      written[ibin].FillPoisson(value(gen), 1. + event%3, samples);
+    }
+  }
+  Qn::StatsColumnarFile::Write("stats_columnar.qnstats", written);
+  // an invalid file is not kept open, such that a valid file is opened afterwards.
+  {
+    std::FILE *invalid = std::fopen("stats_invalid.qnstats", "wb");
+    const std::vector<char> garbage(512, 'x');
+    std::fwrite(garbage.data(), 1, garbage.size(), invalid);
+    std::fclose(invalid);
+  }
+  Qn::StatsColumnarFile file;
+  EXPECT_THROW(file.Open("stats_invalid.qnstats"), std::runtime_error);
+  EXPECT_FALSE(file.IsOpen());
+  std::remove("stats_invalid.qnstats");
+  file.Open("stats_columnar.qnstats");
+  EXPECT_THROW(file.Open("stats_columnar.qnstats"), std::logic_error);
+  const auto read = file.ToDataContainer();
+  ASSERT_EQ(read.size(), written.size());
+  ASSERT_EQ(read.GetAxes().size(), written.GetAxes().size());
+  for (std::size_t i = 0; i < read.GetAxes().size(); ++i) {
+    EXPECT_EQ(read.GetAxes()[i].Name(), written.GetAxes()[i].Name());
+    EXPECT_EQ(read.GetAxes()[i].size(), written.GetAxes()[i].size());
+    for (std::size_t j = 0; j <= read.GetAxes()[i].size(); ++j) {
+      EXPECT_EQ(read.GetAxes()[i].GetLowerBinEdge(j), written.GetAxes()[i].GetLowerBinEdge(j));
+    }
+  }
+  auto expected = written;
+  for (std::size_t ibin = 0; ibin < read.size(); ++ibin) {
+    expected[ibin].CalculateMeanAndError();
+    const auto &bin = read[ibin];
+    const auto &expected_bin = expected[ibin];
+    EXPECT_EQ(bin.N(), expected_bin.N());
+    EXPECT_DOUBLE_EQ(bin.Neff(), expected_bin.Neff());
+    EXPECT_DOUBLE_EQ(bin.SumWeights(), expected_bin.SumWeights());
+    EXPECT_EQ(bin.Mean(), expected_bin.Mean());
+    EXPECT_EQ(bin.MeanErrorStat(), expected_bin.MeanErrorStat());
+    EXPECT_EQ(bin.MeanError(), expected_bin.MeanError());
+    EXPECT_EQ(bin.Weight(), expected_bin.Weight());
+    EXPECT_EQ(bin.IsObservable(), expected_bin.IsObservable());
+    EXPECT_NEAR(bin.GetStatistic().MeanError(), expected_bin.GetStatistic().MeanError(), 1e-12);
+    ASSERT_EQ(bin.GetNSamples(), expected_bin.GetNSamples());
+    for (std::size_t i = 0; i < n_samples; ++i) {
+      EXPECT_EQ(bin.GetReSamples().GetSampleMean(i), expected_bin.GetReSamples().GetSampleMean(i));
+    }
+  }
+  EXPECT_GT(read[0].N(), 0.);
+  EXPECT_EQ(read[read.size() - 1].N(), 0.);
+  // the moments of the samples are not stored, such that the bins of the file are not merged.
+  auto merged = read[0];
+  EXPECT_THROW(Qn::MergeInto(merged, read[1]), std::logic_error);
+  std::remove("stats_columnar.qnstats");
+}